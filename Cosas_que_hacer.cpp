@@ -51,7 +51,7 @@
 // TODO [ ] Comando: test de 10 mensajes -> actualizar contadores internos
 // TODO [ ] Comando: imprimir por consola contador general + estadísticas (sin contar test)
 // TODO [ ] Comando (extra): recibir arreglo de 8 temperaturas y mostrarlas
-// TODO [ ] Diseñar tareas/RTOS o timers para parpadeo estable independientemente de recepción
+// TODO [x] Diseñar tareas/RTOS o timers para parpadeo estable independientemente de recepción
 
 // ===== Contadores y Estadísticas =====
 // TODO [ ] Receptor: contar mensajes recibidos correctamente (generales)
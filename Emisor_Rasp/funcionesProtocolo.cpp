@@ -7,35 +7,13 @@
 
 
 unsigned short fcs(BYTE * array, int tam){
-    unsigned short res= 0;
-    for (int i = 0; i < tam; i++)
-    {
-        for (int j = 0; j < 8; j++)
-        {
-            res += (array[i] >> j) & 0x01;  
-        }
-        
-    }
-    return res;
+    return FrameEstandar::fcsDe(array, tam);
 }
 
 int empaquetar(protocolo & proto){
-    proto.frame[0] = (proto.cmd & 0x0F)<<2;
-    proto.frame[1] = (proto.lng & 0x3F)<<1;
-    int index=0;
-    
-    for (int i = 0; i < proto.lng; i++)
-    {
-        proto.frame[i+2] = proto.data[i]; 
-        index++;
-    } 
-
-    proto.fcs = fcs(proto.frame, index + 2); 
-
-    proto.frame[index+2] = (proto.fcs >> 8) & 0xFF; 
-    proto.frame[index+3] = proto.fcs & 0xFF;      
-    
-    return index + 4; 
+    int largo = FrameEstandar::codificar(proto.frame, proto.cmd, proto.data, proto.lng);
+    proto.fcs = FrameEstandar::fcsEscrito(proto.frame, proto.lng);
+    return largo; 
 }
     
 void enviarFrame(int pin, int speed, protocolo proto, int largo){
@@ -9,10 +9,13 @@
 #include <stdexcept>    // Para std::invalid_argument (para la validación)
 #include <sstream>      // Para std::ostringstream (para formatear array)
 #include <unistd.h>     // Para usleep() / sleep() (si es necesario un delay)
+#include "frameProtocolo.h" // Formato del frame, común con el receptor (../Protocolo_Comun)
 
 #define BYTE unsigned char
 #define LARGO_DATA 63
 #define BYTES_EXTRA 4 // CMD + LNG + FCS[2]
+static_assert(LARGO_DATA == FrameEstandar::PAYLOAD_MAX && BYTES_EXTRA == FrameEstandar::BYTES_CONTROL,
+              "structProtocolo.h no coincide con FrameEstandar");
 #define TX_PIN 17
 #define SPEED 10
 
@@ -0,0 +1,175 @@
+/**
+ * @file cacheEmisor.cpp
+ * @brief Implementación del espejo de la caché del receptor.
+ * @details La política (hash, inserción, LRU) tiene que ser idéntica a la
+ * de Receptor_Esp32/cacheFrames.cpp.
+ */
+
+#include "cacheEmisor.h"
+#include <stdio.h>
+#include <string.h>
+
+bool g_cache_activa = false;
+cacheEmisor g_cache_emisor;
+
+/**
+ * @brief FNV-1a de 32 bits sobre (cmd, lng, data).
+ */
+static uint32_t hashPayload(BYTE cmd, BYTE lng, const BYTE* data) {
+    uint32_t h = 2166136261u;
+    h = (h ^ cmd) * 16777619u;
+    h = (h ^ lng) * 16777619u;
+    for (int i = 0; i < lng; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    return h;
+}
+
+static bool esCacheable(BYTE cmd, BYTE lng) {
+    return cmd < 8 && lng > CACHE_LNG_MINIMO; // Ni telemetría ni control
+}
+
+static entradaCacheEmisor* buscar(cacheEmisor& cache, uint32_t hash) {
+    for (int i = 0; i < CACHE_ENTRADAS; i++) {
+        if (cache.entradas[i].ocupada && cache.entradas[i].hash == hash) {
+            return &cache.entradas[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Inserta (o refresca) un payload. Desaloja la entrada usada hace más tiempo.
+ */
+static entradaCacheEmisor* insertar(cacheEmisor& cache, uint32_t hash, BYTE cmd, BYTE lng, const BYTE* data) {
+    entradaCacheEmisor* e = buscar(cache, hash);
+    if (e == NULL) {
+        e = &cache.entradas[0];
+        for (int i = 0; i < CACHE_ENTRADAS; i++) {
+            entradaCacheEmisor& candidata = cache.entradas[i];
+            if (!candidata.ocupada) { e = &candidata; break; }
+            if (candidata.ultimo_uso < e->ultimo_uso) e = &candidata;
+        }
+        e->ocupada = true;
+        e->hash = hash;
+        e->cmd = cmd;
+        e->lng = lng;
+        memcpy(e->data, data, lng);
+    }
+    e->ultimo_uso = ++cache.reloj;
+    e->repeticiones = 0;
+    return e;
+}
+
+static void escribirHash(BYTE* destino, uint32_t hash) {
+    destino[0] = (hash >> 24) & 0xFF;
+    destino[1] = (hash >> 16) & 0xFF;
+    destino[2] = (hash >> 8) & 0xFF;
+    destino[3] = hash & 0xFF;
+}
+
+/**
+ * @brief Codifica las diferencias de 'nuevo' respecto de 'base' como
+ * tramos [offset][largo][bytes]. Dos tramos separados por menos de 3
+ * bytes iguales se unen (la cabecera de un tramo cuesta 2 bytes).
+ * @return Bytes escritos, o -1 si no cabe en 'max_bytes'.
+ */
+static int codificarParche(const BYTE* base, int lng_base, const BYTE* nuevo, int lng_nuevo,
+                           BYTE* salida, int max_bytes) {
+    int pos = 0;
+    int i = 0;
+    while (i < lng_nuevo) {
+        if (i < lng_base && nuevo[i] == base[i]) { i++; continue; }
+
+        int inicio = i;
+        int fin = i + 1; // Exclusivo: último byte distinto + 1
+        for (int j = i + 1; j < lng_nuevo; j++) {
+            if (j >= lng_base || nuevo[j] != base[j]) fin = j + 1;
+            else if (j + 1 - fin > 2) break;
+        }
+
+        int largo = fin - inicio;
+        if (pos + 2 + largo > max_bytes) return -1;
+        salida[pos++] = (BYTE)inicio;
+        salida[pos++] = (BYTE)largo;
+        memcpy(salida + pos, nuevo + inicio, largo);
+        pos += largo;
+        i = fin;
+    }
+    return pos;
+}
+
+void cacheEmisorIniciar(cacheEmisor& cache) {
+    memset(&cache, 0, sizeof(cacheEmisor));
+}
+
+bool cacheEmisorComprimir(cacheEmisor& cache, const protocolo& original, protocolo& salida) {
+    if (!esCacheable(original.cmd, original.lng)) return false;
+
+    uint32_t hash = hashPayload(original.cmd, original.lng, original.data);
+    memset(&salida, 0, sizeof(protocolo));
+    salida.cmd = CMD_CACHE;
+    salida.t_pedido_ns = original.t_pedido_ns; // La latencia por etapas sigue al mensaje
+    salida.t_encolado_ns = original.t_encolado_ns;
+
+    // --- REPETIR: el receptor ya tiene exactamente este payload ---
+    entradaCacheEmisor* e = buscar(cache, hash);
+    if (e != NULL && e->repeticiones < CACHE_REFRESCO) {
+        e->ultimo_uso = ++cache.reloj;
+        e->repeticiones++;
+        salida.data[0] = CACHE_OP_REPETIR;
+        escribirHash(salida.data + 1, hash);
+        salida.lng = 5;
+        cache.repetidos++;
+        cache.bytes_ahorrados += original.lng - salida.lng;
+        return true;
+    }
+
+    // --- DELTA: parche sobre el payload más parecido del mismo comando ---
+    BYTE parche[LARGO_DATA];
+    int mejor_largo = -1;
+    entradaCacheEmisor* mejor = NULL;
+    const int CABECERA_DELTA = 7; // op + hash base + cmd + lng
+    if (e == NULL) {
+        for (int i = 0; i < CACHE_ENTRADAS; i++) {
+            entradaCacheEmisor& base = cache.entradas[i];
+            if (!base.ocupada || base.cmd != original.cmd) continue;
+            int largo = codificarParche(base.data, base.lng, original.data, original.lng,
+                                        parche, original.lng - CABECERA_DELTA - 1);
+            if (largo >= 0 && (mejor == NULL || largo < mejor_largo)) {
+                mejor = &base;
+                mejor_largo = largo;
+            }
+        }
+    }
+
+    if (mejor != NULL) {
+        salida.data[0] = CACHE_OP_DELTA;
+        escribirHash(salida.data + 1, mejor->hash);
+        salida.data[5] = original.cmd;
+        salida.data[6] = original.lng;
+        codificarParche(mejor->data, mejor->lng, original.data, original.lng,
+                        salida.data + CABECERA_DELTA, LARGO_DATA - CABECERA_DELTA);
+        salida.lng = CABECERA_DELTA + mejor_largo;
+        mejor->ultimo_uso = ++cache.reloj; // El receptor también toca la base
+        insertar(cache, hash, original.cmd, original.lng, original.data);
+        cache.deltas++;
+        cache.bytes_ahorrados += original.lng - salida.lng;
+        return true;
+    }
+
+    // --- Completo: el receptor lo va a guardar al recibirlo ---
+    insertar(cache, hash, original.cmd, original.lng, original.data);
+    cache.completos++;
+    return false;
+}
+
+bool cacheEmisorEsCacheable(BYTE cmd, BYTE lng) {
+    return esCacheable(cmd, lng);
+}
+
+void cacheEmisorImprimir(const cacheEmisor& cache) {
+    printf("--- Caché de frames (CMD 9) ---\n");
+    printf("Completos: %lu | Repetidos: %lu | Deltas: %lu | Bytes de datos ahorrados: %lu\n",
+           cache.completos, cache.repetidos, cache.deltas, cache.bytes_ahorrados);
+}
@@ -0,0 +1,97 @@
+/**
+ * @file cacheEmisor.h
+ * @brief Espejo de la caché de frames del receptor (CMD 9).
+ * @details El receptor guarda los últimos payloads que recibió (cmd, lng, data)
+ * en una caché LRU de CACHE_ENTRADAS entradas, identificadas por un hash
+ * de 32 bits. El emisor repite EXACTAMENTE las mismas inserciones y
+ * desalojos, así sabe qué tiene el receptor sin preguntarle, y en lugar
+ * del frame completo puede mandar:
+ *
+ *   REPETIR: [0] [hash 4B]                                   (9 bytes en la línea)
+ *   DELTA:   [1] [hash base 4B] [cmd] [lng] [offset len bytes...]...
+ *
+ * Si el receptor perdió un frame y no tiene la entrada, el hash no coincide
+ * con nada y el CMD 9 se descarta: nunca se ejecuta un contenido equivocado.
+ * Cada CACHE_REFRESCO repeticiones se manda el frame completo otra vez.
+ */
+
+#ifndef CACHE_EMISOR_H
+#define CACHE_EMISOR_H
+
+#include "structProtocolo.h"
+#include <stdint.h>
+
+/**
+ * @brief Comando de los frames que referencian la caché del receptor.
+ */
+#define CMD_CACHE 9
+
+#define CACHE_OP_REPETIR 0
+#define CACHE_OP_DELTA 1
+
+/**
+ * @brief Entradas de la caché. DEBE ser igual en el emisor y en el receptor.
+ * @details 16 entradas de ~72 bytes: ~1.1 KB de RAM en la ESP32.
+ */
+#define CACHE_ENTRADAS 16
+
+/**
+ * @brief Payloads de hasta este largo no se guardan: repetirlos no ahorra nada.
+ */
+#define CACHE_LNG_MINIMO 5
+
+/**
+ * @brief Repeticiones seguidas de una entrada antes de reenviarla completa.
+ */
+#define CACHE_REFRESCO 8
+
+typedef struct
+{
+    uint32_t hash;
+    uint32_t ultimo_uso;  // Reloj lógico de la LRU
+    BYTE cmd;
+    BYTE lng;
+    BYTE repeticiones;    // Desde el último envío completo
+    bool ocupada;
+    BYTE data[LARGO_DATA];
+} entradaCacheEmisor;
+
+typedef struct
+{
+    entradaCacheEmisor entradas[CACHE_ENTRADAS];
+    uint32_t reloj;
+
+    // Estadísticas
+    unsigned long completos;
+    unsigned long repetidos;
+    unsigned long deltas;
+    unsigned long bytes_ahorrados;
+} cacheEmisor;
+
+/**
+ * @brief Activada con --cache. Sin ella se envía siempre el frame completo.
+ */
+extern bool g_cache_activa;
+extern cacheEmisor g_cache_emisor;
+
+void cacheEmisorIniciar(cacheEmisor& cache);
+
+/**
+ * @brief Decide cómo enviar 'original' y actualiza el espejo.
+ * @param salida Si retorna true, el frame CMD 9 (sin empaquetar) a enviar en su lugar.
+ * @return false si conviene enviar el frame original.
+ */
+bool cacheEmisorComprimir(cacheEmisor& cache, const protocolo& original, protocolo& salida);
+
+/**
+ * @brief true si un frame con este cmd/lng entra en la caché del receptor.
+ * @details Junto con los CMD 9, son los frames que cambian su estado.
+ */
+bool cacheEmisorEsCacheable(BYTE cmd, BYTE lng);
+
+/**
+ * @brief Imprime cuántos frames se reemplazaron y cuántos bytes se ahorraron.
+ */
+void cacheEmisorImprimir(const cacheEmisor& cache);
+
+#endif // CACHE_EMISOR_H
@@ -0,0 +1,159 @@
+/**
+ * @file formaOndaSpi.cpp
+ * @brief Implementación de la salida por el MOSI del SPI.
+ */
+
+#include "formaOndaSpi.h"
+#include "trazas.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+
+#define SPI_RUTA_BUFSIZ "/sys/module/spidev/parameters/bufsiz"
+
+salidaSpi g_spi = {SPI_DISPOSITIVO, SPI_RELOJ_NUCLEO_HZ, false, -1, SPI_BUFSIZ_DEFECTO, 0, 0, 0};
+
+void ondaSpiPreparar(formaOndaSpi& f, int muestras, bool invertida) {
+    BYTE alto = invertida ? 0x00 : 0xFF;
+    int por_bit = muestras / 8;
+    f.muestras = muestras;
+    f.invertida = invertida;
+    for (int v = 0; v < 256; v++) {
+        int unos = 0;
+        for (int i = 0; i < 8; i++) { // LSB primero, como nivelesFrame()
+            int nivel = (v >> i) & 1;
+            memset(f.datos[v] + i * por_bit, nivel ? alto : (BYTE)~alto, por_bit);
+            unos += nivel;
+        }
+        f.paridad[v] = (BYTE)(unos & 1);
+    }
+}
+
+int ondaSpiDibujar(const formaOndaSpi& f, const protocolo& proto, int largo, BYTE* destino,
+                   const FormatoLinea& formato) {
+    BYTE alto = f.invertida ? 0x00 : 0xFF;
+    BYTE bajo = (BYTE)~alto;
+    int por_bit = f.muestras / 8;
+    int parada = formato.bits_parada * por_bit;
+    BYTE* p = destino;
+
+    memset(p, alto, SPI_REPOSO_BITS * por_bit);
+    p += SPI_REPOSO_BITS * por_bit;
+    BYTE paridad = 0;
+    for (int j = 0; j < largo; j++) {
+        BYTE b = proto.frame[j];
+        memset(p, bajo, por_bit); // Bit de inicio
+        p += por_bit;
+        memcpy(p, f.datos[b], f.muestras);
+        p += f.muestras;
+        memset(p, alto, parada);
+        p += parada;
+        paridad ^= f.paridad[b];
+    }
+    memset(p, paridad ? alto : bajo, por_bit); // Paridad del frame
+    p += por_bit;
+    memset(p, alto, por_bit);                  // Stop final
+    p += por_bit;
+    return (int)(p - destino);
+}
+
+int spiElegirMuestras(int speed, long reloj_nucleo_hz, int bytes_max, int bits_parada, uint32_t* hz_real) {
+    int elegidas = 0;
+    double mejor = 0;
+    for (int m = 8; m <= SPI_MUESTRAS_MAX; m += 8) {
+        if (SPI_BYTES_FRAME(FrameEstandar::LARGO_MAX, bits_parada, m) > bytes_max) break;
+        long hz = (long)speed * m;
+        // Como spi-bcm2835: el divisor más chico que no pasa de 'hz', y par
+        long divisor = (reloj_nucleo_hz + hz - 1) / hz;
+        divisor += divisor % 2;
+        if (divisor < 2) divisor = 2;
+        if (divisor > SPI_DIVISOR_MAX) continue;
+        double real = (double)reloj_nucleo_hz / divisor;
+        double error = 1.0 - real / hz; // El bit sale un 'error' más largo
+        if (elegidas == 0 || error < mejor) {
+            elegidas = m;
+            mejor = error;
+            if (hz_real != NULL) *hz_real = (uint32_t)real;
+        }
+    }
+    return elegidas;
+}
+
+/**
+ * @brief El tamaño máximo de una transferencia de spidev.
+ */
+static int leerBufsiz() {
+    FILE* f = fopen(SPI_RUTA_BUFSIZ, "r");
+    if (f == NULL) return SPI_BUFSIZ_DEFECTO;
+    int bufsiz = SPI_BUFSIZ_DEFECTO;
+    if (fscanf(f, "%d", &bufsiz) != 1 || bufsiz <= 0) bufsiz = SPI_BUFSIZ_DEFECTO;
+    fclose(f);
+    return bufsiz;
+}
+
+bool spiAbrir(salidaSpi& s) {
+    int fd = open(s.ruta, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        printf("ERROR: No se pudo abrir %s: %s (¿está activado el SPI con dtparam=spi=on?)\n", s.ruta,
+               strerror(errno));
+        return false;
+    }
+    uint8_t modo = SPI_MODE_0;
+    uint8_t bits = 8;
+    if (ioctl(fd, SPI_IOC_WR_MODE, &modo) < 0 || ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0) {
+        printf("ERROR: %s no es un dispositivo spidev: %s\n", s.ruta, strerror(errno));
+        close(fd);
+        return false;
+    }
+    s.fd = fd;
+    s.bytes_max = leerBufsiz();
+    s.speed = 0;
+    return true;
+}
+
+void spiCerrar(salidaSpi& s) {
+    if (s.fd < 0) return;
+    close(s.fd);
+    s.fd = -1;
+    s.speed = 0;
+}
+
+bool enviarFrameSpi(salidaSpi& s, int speed, const protocolo& proto, int largo, const FormatoLinea& formato) {
+    TRAZA_AMBITO_VALOR("enviarFrameSpi", largo);
+    if (speed != s.speed || formato.bits_parada != s.bits_parada) {
+        uint32_t hz_real = 0;
+        int muestras = spiElegirMuestras(speed, s.reloj_nucleo_hz, s.bytes_max, formato.bits_parada, &hz_real);
+        s.speed = speed;
+        s.bits_parada = formato.bits_parada;
+        s.hz = 0;
+        if (muestras == 0) {
+            // Una vez por velocidad: los frames siguientes fallan sin repetirlo
+            printf("ERROR: %d bps no se pueden sacar por el SPI (reloj del núcleo de %ld Hz, "
+                   "transferencias de hasta %d bytes).\n",
+                   speed, s.reloj_nucleo_hz, s.bytes_max);
+            return false;
+        }
+        ondaSpiPreparar(s.onda, muestras, s.invertida);
+        s.hz = (uint32_t)(speed * muestras);
+        printf("SPI: %d bps con %d muestras por bit, reloj de %u Hz (bit %.3f%% más largo)\n", speed, muestras,
+               hz_real, 100.0 * ((double)s.hz / hz_real - 1.0));
+    }
+    if (s.hz == 0) return false;
+
+    int n = ondaSpiDibujar(s.onda, proto, largo, s.buffer, formato);
+    struct spi_ioc_transfer t;
+    memset(&t, 0, sizeof(t));
+    t.tx_buf = (unsigned long)s.buffer;
+    t.len = n;
+    t.speed_hz = s.hz;
+    t.bits_per_word = 8;
+    if (ioctl(s.fd, SPI_IOC_MESSAGE(1), &t) < 0) {
+        printf("ERROR: Falló la transferencia SPI: %s\n", strerror(errno));
+        return false;
+    }
+    return true;
+}
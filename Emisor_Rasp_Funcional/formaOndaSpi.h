@@ -0,0 +1,140 @@
+/**
+ * @file formaOndaSpi.h
+ * @brief Salida por el MOSI del SPI (/dev/spidev0.0): el frame entero se
+ * arma como forma de onda y sale con un solo ioctl.
+ * @details Con wiringPi o gpiomem cada flanco depende de cuándo despierta
+ * el hilo. Acá el frame se dibuja antes en un buffer, con 'muestras' bits
+ * del SPI por cada bit de la línea (inicio, datos, paradas, paridad y stop
+ * final, en el mismo orden que nivelesFrame()), y el controlador SPI lo
+ * saca con su propio reloj: la CPU no toca la temporización y el jitter
+ * de los flancos es el del reloj del SPI.
+ *
+ * Las muestras por bit son múltiplo de 8, así cada bit de la línea ocupa
+ * bytes enteros del buffer (0x00 o 0xFF): el inicio y las paradas son un
+ * memset y los 8 bits de datos de cada byte salen de una tabla de 256
+ * entradas ya dibujadas (un memcpy por byte del frame).
+ *
+ * El reloj del SPI es el del núcleo (core_freq) dividido por un número par
+ * de hasta 65536: las velocidades lentas necesitan más muestras por bit
+ * (o no entran, ver spiElegirMuestras()) y el bit sale un poco más largo
+ * que el ideal por el redondeo del divisor. En la RPi 3 y 4 core_freq
+ * cambia con la frecuencia de la CPU: hay que fijarlo en config.txt
+ * (core_freq y core_freq_min iguales) o el bit cambia de largo entre frames.
+ * spidev no acepta transferencias de más de 'bufsiz' bytes (4096 por
+ * defecto, se sube con spidev.bufsiz=N en cmdline.txt).
+ *
+ * El pin de salida es siempre el MOSI (GPIO10), no TX_PIN. Si entre
+ * transferencias el controlador deja el MOSI en LOW, la línea necesita un
+ * inversor y la forma de onda se dibuja invertida (--spi-invertida): así
+ * el reposo entre frames queda en HIGH del otro lado del inversor.
+ */
+
+#ifndef FORMA_ONDA_SPI_H
+#define FORMA_ONDA_SPI_H
+
+#include "funcionesProtocolo.h"
+#include <stdint.h>
+
+#define SPI_DISPOSITIVO "/dev/spidev0.0"
+
+/**
+ * @brief Reloj del núcleo del que sale el del SPI (RPi 3 con core_freq=250).
+ * @details En la RPi 4 es 500 MHz por defecto: --spi-reloj.
+ */
+#define SPI_RELOJ_NUCLEO_HZ 250000000L
+
+#define SPI_DIVISOR_MAX 65536
+#define SPI_BUFSIZ_DEFECTO 4096
+
+/**
+ * @brief Muestras por bit de la línea: múltiplo de 8, de 8 a SPI_MUESTRAS_MAX.
+ */
+#define SPI_MUESTRAS_MAX 64
+
+/**
+ * @brief Bits de reposo (HIGH) antes del inicio, mientras arranca el reloj del SPI.
+ */
+#define SPI_REPOSO_BITS 1
+
+/**
+ * @brief Bytes del buffer para un frame de 'largo' bytes con 'muestras' por bit.
+ */
+#define SPI_BYTES_FRAME(largo, bits_parada, muestras) \
+    ((SPI_REPOSO_BITS + BITS_FRAME(largo, bits_parada)) * (muestras) / 8)
+
+#define SPI_BUFFER_MAX SPI_BYTES_FRAME(FrameEstandar::LARGO_MAX, 4, SPI_MUESTRAS_MAX)
+
+/**
+ * @brief Tabla de la forma de onda para unas muestras por bit.
+ */
+typedef struct
+{
+    int muestras;                           // Por bit de la línea (0 = sin preparar)
+    bool invertida;
+    BYTE datos[256][SPI_MUESTRAS_MAX];      // Los 8 bits de datos de cada byte, 'muestras' bytes
+    BYTE paridad[256];                      // 1 si el byte tiene una cantidad impar de unos
+} formaOndaSpi;
+
+/**
+ * @brief Dibuja la tabla para 'muestras' por bit (múltiplo de 8).
+ */
+void ondaSpiPreparar(formaOndaSpi& f, int muestras, bool invertida);
+
+/**
+ * @brief Dibuja el frame en 'destino' (SPI_BYTES_FRAME(largo, ...) bytes).
+ * @details El primer bit del buffer es el MSB de destino[0], como lo saca
+ * el SPI. Empieza con SPI_REPOSO_BITS en HIGH y termina en el stop final.
+ * @return Los bytes escritos.
+ */
+int ondaSpiDibujar(const formaOndaSpi& f, const protocolo& proto, int largo, BYTE* destino,
+                   const FormatoLinea& formato = FORMATO_LINEA_ESTANDAR);
+
+/**
+ * @brief Elige las muestras por bit para 'speed' bps: las que dejan el bit
+ * más cerca del ideal con un divisor par de hasta SPI_DIVISOR_MAX y un
+ * frame de LARGO_MAX bytes en 'bytes_max'.
+ * @param hz_real Si no es NULL, el reloj que va a dar el SPI.
+ * @return Las muestras por bit, o 0 si la velocidad no se puede sacar.
+ */
+int spiElegirMuestras(int speed, long reloj_nucleo_hz, int bytes_max, int bits_parada,
+                      uint32_t* hz_real = NULL);
+
+/**
+ * @brief Un dispositivo spidev y el buffer de un frame.
+ */
+typedef struct
+{
+    const char* ruta;
+    long reloj_nucleo_hz;
+    bool invertida;
+    int fd;                        // -1 = cerrado
+    int bytes_max;                 // 'bufsiz' de spidev
+    int speed;                     // Para la que está elegido 'hz' (0 = ninguna)
+    int bits_parada;
+    uint32_t hz;                   // Reloj pedido al driver (speed * muestras)
+    formaOndaSpi onda;
+    BYTE buffer[SPI_BUFFER_MAX];
+} salidaSpi;
+
+/**
+ * @brief Salida usada por el transporte "spi".
+ */
+extern salidaSpi g_spi;
+
+/**
+ * @brief Abre 's.ruta' y lo configura (modo 0, 8 bits por palabra).
+ * @details 'ruta', 'reloj_nucleo_hz' e 'invertida' se eligen antes.
+ * @return false si no se pudo (el motivo va por stdout).
+ */
+bool spiAbrir(salidaSpi& s);
+
+void spiCerrar(salidaSpi& s);
+
+/**
+ * @brief Dibuja el frame y lo transmite con un ioctl (vuelve cuando salió entero).
+ * @return false si la velocidad no se puede sacar por el SPI o falló la transferencia.
+ */
+bool enviarFrameSpi(salidaSpi& s, int speed, const protocolo& proto, int largo,
+                    const FormatoLinea& formato = FORMATO_LINEA_ESTANDAR);
+
+#endif // FORMA_ONDA_SPI_H
@@ -6,6 +6,19 @@
  */
 
 #include "funcionesMenu.h"
+#include "registroCaptura.h"
+#include "telemetria.h"
+#include "cacheEmisor.h"
+#include "velocidadAdaptativa.h"
+#include "tiempoReal.h"
+#include "histogramaFlancos.h"
+#include "prioridadEnvio.h"
+#include "rpcEmisor.h"
+#include "multiEnlace.h"
+#include "sesionesEmisor.h"
+#include "negociacionEmisor.h"
+#include "ingestaSocket.h"
+#include "latenciaEtapas.h"
 #include <iostream>     // Para std::cin, std::getline
 #include <string>       // Para std::string, std::stof, std::stoi
 #include <string.h>     // Para memset, memcpy, strlen, strncpy
@@ -16,7 +29,7 @@
 // --- Constantes y variables globales (Definición) ---
 
 // Definición del array de strings para el menú (declarado 'extern' en el .h)
-const char* menu[11] = {
+const char* menu[18] = {
         "===== MENÚ EMISOR (PREVIA) =====",
         "1) Mostrar mensaje de control/imagen en OLED",
         "2) Enviar 10 mensajes de prueba",
@@ -27,6 +40,13 @@ const char* menu[11] = {
         "7) Solicitar impresión de contador/estadísticas (receptor)",
         "8) Enviar arreglo con últimas 8 temperaturas (extra)",
         "9) Mostrar contador local de mensajes enviados",
+        "10) Transmitir telemetría continua de temperatura",
+        "11) Medir latencia de despertar (jitter) y sugerir velocidad",
+        "12) Histograma de desvío de los flancos transmitidos",
+        "13) Consultar estadísticas, configuración y salud del receptor (RPC)",
+        "14) Enviar 10 mensajes de prueba por cada enlace (--enlaces)",
+        "15) Negociar parámetros del enlace con el receptor (CMD 10)",
+        "16) Latencia por etapas, del menú al OLED (RPC)",
         "0) Salir"
     };
 
@@ -34,15 +54,121 @@ protocolo tx; // Variable global para la estructura del protocolo
 int g_contador_local_emisor = 0; // Contador para Opción 9
 float g_temperaturas[8] = {0.0f};    // Array rotativo para Opción 8
 int g_temp_index = 0;              // Índice del array rotativo
+int g_reenvio_destino = -1;
+int g_reenvio_saltos = REENVIO_SALTOS_DEFECTO;
+static uint8_t s_reenvio_secuencia = 0;
+static bucleSesiones s_sesiones;     // Opción 14
+
+/**
+ * @brief Con --destino, pone el frame dentro de un sobre CMD 13 para los
+ * repetidores. El control del enlace (CMD 10) no se envuelve: se acuerda
+ * con el receptor del otro lado del cable.
+ * @return false si el payload no entra en el sobre.
+ */
+static bool envolverParaReenvio(const protocolo& envio, protocolo& sobre, int& largo) {
+    int lng = reenvioEnvolver(sobre.data, envio.cmd, envio.frame + FrameEstandar::BYTES_CABECERA, envio.lng,
+                              (uint8_t)g_reenvio_destino, (uint8_t)g_reenvio_saltos, REENVIO_ORIGEN_EMISOR,
+                              s_reenvio_secuencia);
+    if (lng < 0) {
+        printf("Error: payload de %d bytes, dentro del sobre CMD 13 entran hasta %d.\n", envio.lng, REENVIO_LNG_MAX);
+        return false;
+    }
+    s_reenvio_secuencia++;
+    sobre.t_pedido_ns = envio.t_pedido_ns;
+    sobre.t_encolado_ns = envio.t_encolado_ns;
+    sobre.cmd = CMD_REENVIO;
+    sobre.lng = (BYTE)lng;
+    largo = empaquetar(sobre);
+    return true;
+}
+
+/**
+ * @brief Transmite un frame ya empaquetado a g_velocidad (SPEED, salvo
+ * con --adaptativo).
+ * @details Envía por el transporte activo, incrementa el contador local
+ * de mensajes enviados y, si hay captura activa, registra el frame.
+ * El registro se hace DESPUÉS de transmitir, así no toca la temporización
+ * de los bits. Con --prioridades corre en el hilo de envío. Con --destino,
+ * lo que sale (y se registra) es el sobre CMD 13.
+ */
+void transmitirConContador(protocolo& frame, int largo) {
+    protocolo sobre;
+    bool envolver = (g_reenvio_destino >= 0 && frame.cmd != CMD_ENLACE);
+    if (envolver && !envolverParaReenvio(frame, sobre, largo)) {
+        return;
+    }
+    protocolo& envio = envolver ? sobre : frame;
+
+    if (envio.lng > g_config_enlace.lng_max) {
+        // Más de lo que acordó el receptor: lo descartaría
+        printf("Error: payload de %d bytes, el enlace acepta hasta %d.\n", envio.lng, g_config_enlace.lng_max);
+        return;
+    }
+    uint64_t t_inicio = capturaAhoraNs();
+    bool ok = g_transporte->enviar(TX_PIN, g_velocidad, envio, largo);
+    uint64_t t_fin = capturaAhoraNs();
+
+    if (ok) {
+        g_contador_local_emisor++; // Incrementa el contador local (Opción 9)
+        latenciaRegistrarEnvio(g_latencia, envio, t_inicio, t_fin);
+    }
+    capturaRegistrar(envio, largo, g_velocidad, g_config_enlace, t_inicio, (uint32_t)((t_fin - t_inicio) / 1000),
+                     ok ? CAPTURA_ENVIADO : CAPTURA_ERROR_TRANSPORTE);
+
+    // Con --adaptativo, cada tantos frames se evalúa la velocidad
+    adaptativoDespuesDeEnviar();
+}
 
 /**
  * @brief Función auxiliar (wrapper) para enviar un frame.
- * @details Llama a la función 'enviarFrame' original y luego
- * incrementa el contador local de mensajes enviados.
+ * @details Con --prioridades solo lo encola en su clase y vuelve: el hilo
+ * de envío lo transmite (en fragmentos si es largo, ver prioridadEnvio.h).
+ * Si no, con la caché activa (--cache) un payload que el receptor ya
+ * tiene se reemplaza por un frame corto CMD 9 (ver cacheEmisor.h) y se
+ * transmite enseguida.
  */
 void enviarFrameConContador(int pin, int speed, protocolo& proto, int largo) {
-    enviarFrame(pin, speed, proto, largo);
-    g_contador_local_emisor++; // Incrementa el contador local (Opción 9)
+    latenciaSellar(proto);
+    if (g_prioridades_activas) {
+        envioEncolar(proto);
+        return;
+    }
+
+    protocolo comprimido;
+    protocolo* envio = &proto;
+    if (g_cache_activa && cacheEmisorComprimir(g_cache_emisor, proto, comprimido)) {
+        largo = empaquetar(comprimido);
+        envio = &comprimido;
+    }
+    transmitirConContador(*envio, largo);
+}
+
+void enviarPedidoRpc(protocolo& pedido) {
+    int largo = empaquetar(pedido);
+    enviarFrameConContador(TX_PIN, g_velocidad, pedido, largo);
+    if (!g_prioridades_activas) {
+        delay(RPC_SEPARACION_BITS * 1000 / g_velocidad); // Antes del próximo pedido
+    }
+}
+
+// Frames sin payload de las opciones 1, 5 y 7: quedan armados al compilar
+static constexpr FrameEstandar::Fijo FRAME_CONTROL = FrameEstandar::fijo<0>();
+static constexpr FrameEstandar::Fijo FRAME_TOGGLE_LED = FrameEstandar::fijo<4>();
+static constexpr FrameEstandar::Fijo FRAME_PEDIR_CONTADOR = FrameEstandar::fijo<6>();
+
+/**
+ * @brief Carga en 'proto' un frame fijo, sin pasar por empaquetar().
+ * @return El largo del frame, como empaquetar().
+ */
+static int cargarFijo(protocolo& proto, const FrameEstandar::Fijo& fijo) {
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = fijo.cmd;
+    memcpy(proto.frame, fijo.bytes, fijo.largo);
+    if (g_config_enlace.fcs != NEG_FCS_CONTEO) {
+        cerrarSegun(g_config_enlace.fcs, proto.frame, fijo.cmd, 0); // Armado con el FCS base
+    }
+    proto.fcs = FrameEstandar::fcsEscrito(proto.frame, 0);
+    return fijo.largo;
 }
 
 
@@ -52,16 +178,10 @@ void enviarFrameConContador(int pin, int speed, protocolo& proto, int largo) {
  * @brief Opción 1: Envía un comando de control simple (CMD 0).
  */
 void opcion_1(){
-    // Limpiar TODA la estructura 'tx' al inicio.
-    // Esto es necesario para poner 'tx.lng' en 0 y evitar que se
-    // envíen datos de una opción anterior.
-    memset(&tx, 0, sizeof(protocolo));
-    
-    tx.cmd = 0;
-    // tx.lng es 0 (gracias al memset)
-    int largo = empaquetar(tx);
+    // cargarFijo() limpia 'tx', así no se envían datos de una opción anterior
+    int largo = cargarFijo(tx, FRAME_CONTROL);
     printf("Mensaje de control enviado (CMD 0).\n");
-    enviarFrameConContador(TX_PIN,SPEED,tx,largo);
+    enviarFrameConContador(TX_PIN,g_velocidad,tx,largo);
 }
 
 /**
@@ -73,6 +193,7 @@ void opcion_2(){
     
     printf("Ingrese un mensaje de prueba (se enviará 10 veces, max 62 char): ");
     std::cin.getline(reinterpret_cast<char*>(tx.data), 63); // Leer 62 chars + 1 nulo
+    latenciaMarcarPedido();
     
     tx.lng = strlen(reinterpret_cast<const char*>(tx.data)); 
 
@@ -86,7 +207,9 @@ void opcion_2(){
     // Bucle para enviar 10 veces
     printf("Enviando 10 mensajes de prueba...\n");
     for (int i = 0; i < 10; i++) {
-        enviarFrameConContador(TX_PIN, SPEED, tx, largo);
+        tx.t_pedido_ns = 0; // Cada repetición cuenta desde que sale del bucle
+        latenciaMarcarPedido();
+        enviarFrameConContador(TX_PIN, g_velocidad, tx, largo);
         printf("Mensaje %d/10 enviado.\n", i + 1);
         
         // Pausa entre mensajes.
@@ -107,12 +230,13 @@ void opcion_3(){
     
     printf("Ingrese un mensaje para mostrar en OLED (max 62 char): ");
     std::cin.getline(reinterpret_cast<char*>(tx.data), 63); 
+    latenciaMarcarPedido();
     
     tx.lng = strlen( reinterpret_cast<const char*>(tx.data) ); 
     
     if (tx.lng > 0) {
         int largo = empaquetar(tx);
-        enviarFrameConContador(TX_PIN,SPEED,tx,largo);
+        enviarFrameConContador(TX_PIN,g_velocidad,tx,largo);
         printf("Mensaje OLED enviado.\n");
     } else {
         printf("Mensaje vacío. No se envió nada.\n");
@@ -131,6 +255,7 @@ void opcion_4(){
     
     std::string input;
     std::getline(std::cin, input); // Leer como string
+    latenciaMarcarPedido();
 
     try {
         // --- Validación ---
@@ -143,7 +268,7 @@ void opcion_4(){
             tx.lng = strlen(reinterpret_cast<const char*>(tx.data));
             
             int largo = empaquetar(tx);
-            enviarFrameConContador(TX_PIN,SPEED,tx,largo);
+            enviarFrameConContador(TX_PIN,g_velocidad,tx,largo);
 
             // --- Lógica Array Rotativo ---
             g_temperaturas[g_temp_index] = temp;
@@ -163,11 +288,9 @@ void opcion_4(){
  * @brief Opción 5: Envía comando para "Togglear" el LED (CMD 4).
  */
 void opcion_5(){
-    memset(&tx, 0, sizeof(protocolo));
     printf("Activando/Desactivando parpadeo del LED (gpio 25)\n");
-    tx.cmd = 4;
-    int largo = empaquetar(tx);
-    enviarFrameConContador(TX_PIN,SPEED,tx,largo);
+    int largo = cargarFijo(tx, FRAME_TOGGLE_LED);
+    enviarFrameConContador(TX_PIN,g_velocidad,tx,largo);
 }
 
 /**
@@ -181,6 +304,7 @@ void opcion_6(){
     
     std::string input;
     std::getline(std::cin, input); 
+    latenciaMarcarPedido();
 
     try {
         // --- Validación ---
@@ -193,7 +317,7 @@ void opcion_6(){
             tx.lng = strlen(reinterpret_cast<const char*>(tx.data));
             
             int largo = empaquetar(tx);
-            enviarFrameConContador(TX_PIN,SPEED,tx,largo);
+            enviarFrameConContador(TX_PIN,g_velocidad,tx,largo);
             printf("Frecuencia %d Hz enviada.\n", freq);
             
         } else {
@@ -208,11 +332,9 @@ void opcion_6(){
  * @brief Opción 7: Envía comando para pedir estadísticas al receptor (CMD 6).
  */
 void opcion_7(){
-    memset(&tx, 0, sizeof(protocolo));
     printf("Solicitando impresión de contador/estadísticas (receptor)\n");
-    tx.cmd = 6;
-    int largo = empaquetar(tx);
-    enviarFrameConContador(TX_PIN,SPEED,tx,largo);
+    int largo = cargarFijo(tx, FRAME_PEDIR_CONTADOR);
+    enviarFrameConContador(TX_PIN,g_velocidad,tx,largo);
 }
 
 /**
@@ -241,7 +363,7 @@ void opcion_8(){
     tx.lng = strlen(reinterpret_cast<const char*>(tx.data));
 
     int largo = empaquetar(tx);
-    enviarFrameConContador(TX_PIN,SPEED,tx,largo);
+    enviarFrameConContador(TX_PIN,g_velocidad,tx,largo);
 }
 
 /**
@@ -252,4 +374,237 @@ void opcion_9(){
     // Solo muestra el contador local en la RPi.
     printf("--- Contador Local del Emisor ---\n");
     printf("Total de mensajes enviados hasta ahora: %d\n", g_contador_local_emisor);
-}
\ No newline at end of file
+    if (g_cache_activa) {
+        cacheEmisorImprimir(g_cache_emisor);
+    }
+    if (g_adaptativo_activo) {
+        adaptativoImprimir();
+    }
+    if (g_prioridades_activas) {
+        prioridadesImprimir();
+    }
+    if (g_rpc_activo) {
+        rpcImprimir();
+    }
+    if (g_multienlace_activo) {
+        multiEnlaceImprimir();
+    }
+    if (g_ingesta_activa) {
+        ingestaImprimir();
+    }
+    negociacionImprimir();
+}
+
+/**
+ * @brief Envía un frame de telemetría ya empaquetado (callback de transmitirTelemetria).
+ */
+static void enviarTelemetria(protocolo& proto, int largo) {
+    proto.t_pedido_ns = capturaAhoraNs(); // El lote se pide al armarse, no en el menú
+    enviarFrameConContador(TX_PIN, g_velocidad, proto, largo);
+}
+
+/**
+ * @brief Opción 10: Telemetría continua de temperatura (CMD 8).
+ * @details Muestrea un archivo (un valor por línea) o un sensor simulado
+ * a la frecuencia pedida y envía las muestras en lotes codificados por
+ * diferencias (ver telemetria.h).
+ */
+void opcion_10(){
+    std::string input;
+    float hz = 0.0f;
+    float duracion = 0.0f;
+
+    printf("Archivo de temperaturas (Enter = sensor simulado): ");
+    std::string ruta;
+    std::getline(std::cin, ruta);
+
+    try {
+        printf("Frecuencia de muestreo [0.1..100] Hz: ");
+        std::getline(std::cin, input);
+        hz = std::stof(input);
+
+        printf("Duración de la transmisión en segundos: ");
+        std::getline(std::cin, input);
+        duracion = std::stof(input);
+    } catch (const std::invalid_argument& e) {
+        printf("Error: Entrada no válida. Debe ser un número. No se envió.\n");
+        return;
+    }
+
+    if (hz < 0.1f || hz > 100.0f || duracion <= 0.0f) {
+        printf("Error: Frecuencia o duración fuera de rango. No se envió.\n");
+        return;
+    }
+
+    fuenteTemperatura fuente;
+    if (!fuenteAbrir(fuente, ruta.c_str())) {
+        printf("Error: No se pudo abrir '%s'.\n", ruta.c_str());
+        return;
+    }
+
+    printf("Transmitiendo telemetría a %.1f Hz durante %.0f s...\n", hz, duracion);
+    transmitirTelemetria(fuente, hz, duracion, enviarTelemetria);
+    fuenteCerrar(fuente);
+}
+
+/**
+ * @brief Opción 11: Sonda de latencia (no envía nada).
+ * @details Mide desde el mismo hilo que transmite, así el resultado incluye
+ * el modo de tiempo real si se activó con --tiempo-real.
+ */
+void opcion_11(){
+    printf("Midiendo %d despertares cada %d us (~%d s)...\n", SONDA_MUESTRAS_DEFECTO,
+           SONDA_PERIODO_US_DEFECTO, SONDA_MUESTRAS_DEFECTO * SONDA_PERIODO_US_DEFECTO / 1000000);
+    resultadoLatencia r;
+    if (medirLatencia(SONDA_PERIODO_US_DEFECTO, SONDA_MUESTRAS_DEFECTO, r)) {
+        imprimirLatencia(r);
+        printf("Velocidad en uso: %d bps.\n", g_velocidad);
+    }
+}
+
+/**
+ * @brief Opción 12: Desvío de los flancos (no envía nada).
+ * @details Muestra el último frame y el acumulado, y opcionalmente
+ * exporta el acumulado en formato .hgrm (ver histogramaFlancos.h).
+ */
+void opcion_12(){
+    printf("--- Desvío de flancos (%lu frames) ---\n", g_flancos_frames.load());
+    resumenHistograma ultimo;
+    flancosUltimoFrame(ultimo);
+    flancosImprimir("Último frame", ultimo, g_velocidad);
+    resumenHistograma acumulado;
+    histogramaResumir(g_flancos_acumulado, acumulado);
+    flancosImprimir("Acumulado", acumulado, g_velocidad);
+
+    printf("Exportar el acumulado a un archivo (Enter = no exportar, '-' = pantalla): ");
+    std::string ruta;
+    std::getline(std::cin, ruta);
+    if (ruta.empty()) return;
+    if (ruta == "-") {
+        histogramaExportar(g_flancos_acumulado, stdout);
+        return;
+    }
+    FILE* archivo = fopen(ruta.c_str(), "w");
+    if (archivo == NULL) {
+        printf("Error: No se pudo crear '%s'.\n", ruta.c_str());
+        return;
+    }
+    histogramaExportar(g_flancos_acumulado, archivo);
+    fclose(archivo);
+    printf("Histograma exportado en %s\n", ruta.c_str());
+}
+
+/**
+ * @brief Opción 13: Tres pedidos al receptor (CMD 12), sin esperar entre uno y otro.
+ * @details Los tres salen seguidos y las respuestas vuelven por la línea de
+ * retorno mientras tanto: el total es una ida y vuelta más el tiempo en la
+ * línea, no tres idas y vueltas.
+ */
+void opcion_13(){
+    if (!g_rpc_activo) {
+        printf("Error: Los pedidos necesitan la línea de retorno (iniciar con --rpc).\n");
+        return;
+    }
+    const BYTE METODOS[] = {RPC_ESTADISTICAS, RPC_CONFIGURACION, RPC_SALUD};
+    const char* NOMBRES[] = {"Estadísticas", "Configuración", "Salud"};
+    const int N = sizeof(METODOS) / sizeof(METODOS[0]);
+
+    printf("Enviando %d pedidos a %d bps...\n", N, g_velocidad);
+    unsigned long inicio = millis();
+    std::future<respuestaRpc> futuros[N];
+    for (int i = 0; i < N; i++) {
+        futuros[i] = rpcLlamar(METODOS[i], NULL, 0);
+    }
+    for (int i = 0; i < N; i++) {
+        respuestaRpc r = futuros[i].get(); // Llega la respuesta o vence el plazo
+        printf("%s (%.1f s):\n", NOMBRES[i], r.ida_y_vuelta_ms / 1000.0);
+        rpcImprimirRespuesta(METODOS[i], r);
+    }
+    printf("Total: %.1f s\n", (millis() - inicio) / 1000.0);
+}
+
+/**
+ * @brief Opción 14: 10 mensajes de prueba (CMD 1) a cada enlace a la vez.
+ * @details Una sesión por enlace (sesionPruebaEnlace) en un solo bucle:
+ * el hilo de temporización transmite los enlaces en paralelo, un frame
+ * detrás de otro en cada uno. Al final, el receptor del enlace con la
+ * línea de retorno acusa con un REPORTE lo que recibió (con reintentos).
+ */
+void opcion_14(){
+    if (!g_multienlace_activo) {
+        printf("Error: No hay varios enlaces (iniciar con --enlaces P1,P2,...).\n");
+        return;
+    }
+    const int MENSAJES = 10;
+    int n = multiEnlaceCantidad();
+    sesion sesiones[ME_MAX_ENLACES];
+    pruebaEnlace pruebas[ME_MAX_ENLACES];
+    enlacePrepararRetorno(RX_RETORNO_PIN);
+    sesionesIniciar(s_sesiones, sesionesRelojMs, sesionesEsperarRetorno);
+    for (int e = 0; e < n; e++) {
+        int enlace = sesionesAgregarEnlace(s_sesiones, sesionesEnviarMultiEnlace, g_velocidad,
+                                           g_config_enlace.bits_parada);
+        pruebas[e].mensajes = MENSAJES;
+        pruebas[e].confirmar = (enlace == SES_ENLACE_RETORNO);
+        sesionIniciar(s_sesiones, sesiones[e], sesionPruebaEnlace, &pruebas[e], enlace);
+    }
+
+    unsigned long inicio = millis();
+    sesionesCorrer(s_sesiones);
+    multiEnlaceEsperar(-1);
+    double segundos = (millis() - inicio) / 1000.0;
+    for (int e = 0; e < n; e++) g_contador_local_emisor += pruebas[e].enviados;
+    printf("%d frames en %.1f s (%.2f frames/s entre todos los enlaces)\n", MENSAJES * n, segundos,
+           segundos > 0 ? MENSAJES * n / segundos : 0.0);
+    const pruebaEnlace& p = pruebas[SES_ENLACE_RETORNO];
+    if (p.confirmado) {
+        printf("Enlace %d: el receptor acusa %d frames válidos (%d consultas sin respuesta)\n",
+               SES_ENLACE_RETORNO, p.ok_receptor, p.intento);
+    } else {
+        printf("Enlace %d: el receptor no respondió a %d consultas\n", SES_ENLACE_RETORNO, SES_INTENTOS_CONSULTA);
+    }
+    multiEnlaceImprimir();
+    sesionesImprimir(s_sesiones);
+}
+
+/**
+ * @brief Opción 15: Negocia velocidad, bits de parada, FCS y payload
+ * máximo con el receptor (CMD 10, ver negociacionEmisor.h).
+ */
+void opcion_15(){
+    if (g_multienlace_activo) {
+        printf("Error: Con varios enlaces la trama queda fija.\n");
+        return;
+    }
+    negociarEnlace(RX_RETORNO_PIN);
+    negociacionImprimir();
+}
+
+/**
+ * @brief Opción 16: Pide a la ESP32 sus registros de latencia (RPC_ETAPAS),
+ * los empareja con los frames enviados y muestra los percentiles de cada
+ * etapa por comando (ver latenciaEtapas.h).
+ */
+void opcion_16(){
+    if (!g_rpc_activo) {
+        printf("Error: Los registros de la ESP32 llegan por la línea de retorno (iniciar con --rpc).\n");
+        return;
+    }
+    // Cada pedido también queda registrado: se pide hasta que la respuesta
+    // no viene llena, si no el último pedido siempre dejaría uno más
+    for (;;) {
+        BYTE args[2] = {(BYTE)(g_latencia.desde >> 8), (BYTE)g_latencia.desde};
+        respuestaRpc r = rpcLlamar(RPC_ETAPAS, args, sizeof(args)).get();
+        if (r.estado != RPC_OK) {
+            rpcImprimirRespuesta(RPC_ETAPAS, r);
+            break;
+        }
+        int cantidad = latenciaProcesarRespuesta(g_latencia, r.datos, r.lng);
+        if (cantidad < 0) {
+            printf("Error: Respuesta de RPC_ETAPAS mal formada (%d bytes).\n", r.lng);
+            break;
+        }
+        if (cantidad < ETAPAS_POR_RESPUESTA) break;
+    }
+    latenciaImprimir(g_latencia);
+}
@@ -7,6 +7,7 @@
 // Incluimos el protocolo para que las funciones
 // sepan cómo llamar a empaquetar() y enviarFrame().
 #include "funcionesProtocolo.h"
+#include "reenvioFrame.h"
 
 #ifndef FUNCIONES_MENU_H
 #define FUNCIONES_MENU_H
@@ -15,7 +16,28 @@
  * @brief Array 'extern' que contiene el texto del menú.
  * 'extern' significa que está definido en otro archivo (funcionesMenu.cpp).
  */
-extern const char* menu[11];
+extern const char* menu[18];
+
+/**
+ * @brief Con --destino, dirección del receptor al que van los frames a
+ * través de los repetidores (-1 = directo al receptor del cable; ver reenvioFrame.h).
+ */
+extern int g_reenvio_destino;
+
+/**
+ * @brief Repetidores que puede cruzar un frame con --destino (--saltos).
+ */
+extern int g_reenvio_saltos;
+
+/**
+ * @brief Transmite un frame empaquetado y lo cuenta (lo usa el hilo de envío).
+ */
+void transmitirConContador(protocolo& envio, int largo);
+
+/**
+ * @brief Envía un pedido RPC (CMD 12) por el mismo camino que el menú.
+ */
+void enviarPedidoRpc(protocolo& pedido);
 
 // --- Declaraciones de Funciones de Opción ---
 
@@ -28,6 +50,13 @@ void opcion_6();
 void opcion_7();
 void opcion_8();
 void opcion_9();
+void opcion_10();
+void opcion_11();
+void opcion_12();
+void opcion_13();
+void opcion_14();
+void opcion_15();
+void opcion_16();
 // (opcion_0 se maneja en el main.cpp, por eso no se declara aquí)
 
 #endif // FUNCIONES_MENU_H
\ No newline at end of file
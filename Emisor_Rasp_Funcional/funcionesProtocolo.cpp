@@ -8,62 +8,48 @@
 #include <stdlib.h>
 #include <string.h>
 #include <wiringPi.h> // Necesario para pinMode, digitalWrite, delay
+#include "histogramaFlancos.h" // Desvío de cada flanco (opción 12)
+#include "trazas.h"
+
+ConfiguracionEnlace g_config_enlace = CONFIGURACION_BASE;
+
+FormatoLinea formatoIda() {
+    FormatoLinea f = FORMATO_LINEA_ESTANDAR;
+    f.bits_parada = g_config_enlace.bits_parada;
+    return f;
+}
 
 /**
  * @brief Calcula el Frame Check Sequence (FCS) (conteo de bits activos).
  */
 unsigned short fcs(BYTE * array, int tam){
-    unsigned short res= 0;
-    for (int i = 0; i < tam; i++) // Recorre cada byte
-    {
-        for (int j = 0; j < 8; j++) // Recorre cada bit
-        {
-            res += (array[i] >> j) & 0x01;  
-        }
-    }
-    return res;
+    // La política de FCS (conteo de bits) está en frameProtocolo.h
+    return FrameEstandar::fcsDe(array, tam);
 }
 
 /**
  * @brief Arma el frame completo para la transmisión.
  */
 int empaquetar(protocolo & proto){
-    // --- Empaquetado de bits ---
-    // El CMD (4 bits) se desplaza 2 bits a la izquierda.
-    // (Ej: CMD 2 (0b0010) se guarda como 0b1000)
-    proto.frame[0] = (proto.cmd & 0x0F)<<2;
-    // El LNG (6 bits) se desplaza 1 bit a la izquierda.
-    proto.frame[1] = (proto.lng & 0x3F)<<1;
-    
-    int index=0;
-    
-    // Copia los datos (payload) al frame
-    for (int i = 0; i < proto.lng; i++)
-    {
-        proto.frame[i+2] = proto.data[i]; 
-        index++;
-    } 
+    TRAZA_AMBITO_VALOR("empaquetar", proto.lng);
+    // El CMD (4 bits) va desplazado 2 bits y el LNG (6 bits) 1 bit; después
+    // van los datos y el FCS (Big Endian). Los anchos y desplazamientos los
+    // fija FrameEstandar en frameProtocolo.h y se verifican al compilar.
+    // El FCS es el acordado con el receptor (conteo, salvo negociación).
+    memmove(proto.frame + FrameEstandar::BYTES_CABECERA, proto.data, proto.lng);
+    int largo = cerrarSegun(g_config_enlace.fcs, proto.frame, proto.cmd, proto.lng);
+    proto.fcs = FrameEstandar::fcsEscrito(proto.frame, proto.lng);
 
-    // --- Cálculo y guardado del FCS ---
-    
-    // Calculamos el FCS DESPUÉS de haber copiado CMD, LNG y DATA al frame.
-    // El FCS se calcula sobre los 2 primeros bytes + los N bytes de datos.
-    proto.fcs = fcs(proto.frame, index + 2); 
-
-    // Guardamos el FCS (unsigned short de 2 bytes) en los siguientes dos
-    // bytes del frame (formato Big Endian: Byte Alto primero, Byte Bajo después).
-    proto.frame[index+2] = (proto.fcs >> 8) & 0xFF; // Byte Alto
-    proto.frame[index+3] = proto.fcs & 0xFF;      // Byte Bajo
-    
     // Retorna el largo total: 2 (cmd/lng) + N (data) + 2 (fcs)
-    return index + 4; 
+    return largo; 
 }
 
 /**
  * @brief Transmite el frame completo, bit por bit (bit-banging).
  */
-void enviarFrame(int pin, int speed, protocolo proto, int largo){
-    
+void enviarFrame(int pin, int speed, protocolo proto, int largo, const FormatoLinea& formato){
+    TRAZA_AMBITO_VALOR("enviarFrame", largo);
+
     // Calcula el tiempo de delay por cada bit.
     // (1000ms / 10 bits/s = 100ms por bit)
     unsigned long msTime = 1000 / speed; 
@@ -71,6 +57,7 @@ void enviarFrame(int pin, int speed, protocolo proto, int largo){
     pinMode(pin, OUTPUT);
     bool level;
     int paridad=0; // Acumulador para la paridad de todo el frame
+    flancosInicioFrame(speed, formato.bits_parada);
 
     // --- Bucle de Bytes ---
     // Recorre cada byte del frame (cmd, lng, data, fcs...)
@@ -78,6 +65,7 @@ void enviarFrame(int pin, int speed, protocolo proto, int largo){
         
         // 1. Bit de Inicio
         digitalWrite(pin, LOW);
+        flancosInicioByte(); // Referencia de los bits de este byte
         delay(msTime); 
         
         BYTE byteEnvio = proto.frame[j];
@@ -87,6 +75,7 @@ void enviarFrame(int pin, int speed, protocolo proto, int largo){
         for(int i=0;i<8;i++){
             level = ((0x01) & (byteEnvio>>i)); // Aísla el bit 'i'
             digitalWrite(pin, level); 
+            flancosRegistrar(i + 1);
             
             // Acumula la paridad (cuenta bits '1')
             if(level)
@@ -97,7 +86,8 @@ void enviarFrame(int pin, int speed, protocolo proto, int largo){
         
         // 2. Bits de Parada
         digitalWrite(pin, HIGH); 
-        delay(msTime * 2); // 2 bits de parada para dar tiempo al receptor
+        flancosRegistrar(9);
+        delay(msTime * formato.bits_parada); // 2 bits de parada (en producción) para dar tiempo al receptor
     }
     
     // --- Bit de Paridad del Frame ---
@@ -106,10 +96,35 @@ void enviarFrame(int pin, int speed, protocolo proto, int largo){
         digitalWrite(pin, LOW); // Paridad Par
     else
         digitalWrite(pin, HIGH); // Paridad Impar
+    flancosRegistrar(9 + formato.bits_parada); // Donde empezaría el próximo byte
     
     delay(msTime); // Duración del bit de paridad
     
     // 3. Bit de Parada Final y Reposo
     // Dejamos la línea en HIGH (estado de reposo)
     digitalWrite(pin, HIGH);
-}
\ No newline at end of file
+    flancosRegistrar(10 + formato.bits_parada);
+    flancosFinFrame();
+}
+
+/**
+ * @brief Niveles bit a bit del frame, sin transmitirlo.
+ */
+int nivelesFrame(const protocolo& proto, int largo, BYTE* niveles, const FormatoLinea& formato){
+    int n = 0;
+    int paridad = 0;
+    for (int j = 0; j < largo; j++) {
+        niveles[n++] = LOW; // Bit de inicio
+        for (int i = 0; i < 8; i++) {
+            BYTE level = (proto.frame[j] >> i) & 0x01;
+            niveles[n++] = level;
+            paridad += level;
+        }
+        for (int i = 0; i < formato.bits_parada; i++) {
+            niveles[n++] = HIGH;
+        }
+    }
+    niveles[n++] = (paridad % 2 == 0) ? LOW : HIGH; // Paridad del frame
+    niveles[n++] = HIGH;                            // Stop final
+    return n;
+}
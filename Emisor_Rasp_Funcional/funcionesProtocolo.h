@@ -5,9 +5,25 @@
  * calculan el checksum (fcs) y envían los bits (enviarFrame).
  */
 
+#ifndef FUNCIONES_PROTOCOLO_H
+#define FUNCIONES_PROTOCOLO_H
+
 // Incluimos la estructura principal para que las funciones
 // sepan qué es un 'protocolo' y un 'BYTE'.
 #include "structProtocolo.h"
+#include "negociacionEnlace.h" // FCS y formato según lo acordado (../Protocolo_Comun)
+
+/**
+ * @brief Configuración de la línea de ida acordada con el receptor (ver negociacionEmisor.h).
+ * @details empaquetar() usa su FCS y el transporte sus bits de parada; la
+ * velocidad en uso sigue siendo g_velocidad. Arranca en CONFIGURACION_BASE.
+ */
+extern ConfiguracionEnlace g_config_enlace;
+
+/**
+ * @brief Formato de la línea de ida según g_config_enlace.
+ */
+FormatoLinea formatoIda();
 
 /**
  * @brief Arma el 'proto.frame' a partir de los datos en 'proto.data'.
@@ -37,5 +53,27 @@ unsigned short fcs(BYTE * array,int tam);
  * @param speed La velocidad (ej: 10) para calcular el delay.
  * @param proto La estructura que contiene el 'proto.frame' a enviar.
  * @param largo El largo total del frame (devuelto por empaquetar()).
+ * @param formato Bits de parada y punto de muestreo; el receptor tiene que
+ * usar el mismo (por defecto el de producción: 2 bits de parada).
  */
-void enviarFrame(int pin, int speed, protocolo proto, int largo);
\ No newline at end of file
+void enviarFrame(int pin, int speed, protocolo proto, int largo,
+                 const FormatoLinea& formato = FORMATO_LINEA_ESTANDAR);
+
+/**
+ * @brief Bits de línea de un frame de 'largo' bytes (inicio, 8 datos y las
+ * paradas por byte, más la paridad y el stop final).
+ */
+#define BITS_FRAME(largo, bits_parada) ((largo) * (9 + (bits_parada)) + 2)
+
+/**
+ * @brief Nivel de la línea en cada bit de un frame, en el mismo orden que
+ * lo transmite enviarFrame().
+ * @details Para los que temporizan los bits por su cuenta (ej: varios
+ * enlaces desde un solo hilo, multiEnlace.h) en lugar de un delay() por bit.
+ * @param niveles Destino, con lugar para BITS_FRAME(largo, bits_parada) valores.
+ * @return La cantidad de bits escritos; el último es el stop final (HIGH).
+ */
+int nivelesFrame(const protocolo& proto, int largo, BYTE* niveles,
+                 const FormatoLinea& formato = FORMATO_LINEA_ESTANDAR);
+
+#endif // FUNCIONES_PROTOCOLO_H
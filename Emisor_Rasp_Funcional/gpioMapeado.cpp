@@ -0,0 +1,106 @@
+/**
+ * @file gpioMapeado.cpp
+ * @brief Implementación de la salida por registros GPIO mapeados.
+ */
+
+#include "gpioMapeado.h"
+#include "histogramaFlancos.h"
+#include "trazas.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+bloqueGpio g_gpio = {NULL, -1};
+
+bool gpioAbrir(bloqueGpio& g, const char* ruta) {
+    int fd = open(ruta, O_RDWR | O_SYNC | O_CLOEXEC);
+    if (fd < 0) {
+        printf("ERROR: No se pudo abrir %s: %s (¿el usuario está en el grupo 'gpio'?)\n", ruta,
+               strerror(errno));
+        return false;
+    }
+    // Un archivo de prueba más chico que el bloque daría SIGBUS al escribirlo
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size < GPIO_BLOQUE_BYTES) {
+        printf("ERROR: %s tiene %lld bytes, se necesitan %d.\n", ruta, (long long)st.st_size,
+               GPIO_BLOQUE_BYTES);
+        close(fd);
+        return false;
+    }
+    void* p = mmap(NULL, GPIO_BLOQUE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        printf("ERROR: No se pudo mapear %s: %s\n", ruta, strerror(errno));
+        close(fd);
+        return false;
+    }
+    g.registros = (volatile uint32_t*)p;
+    g.fd = fd;
+    return true;
+}
+
+void gpioCerrar(bloqueGpio& g) {
+    if (g.registros == NULL) return;
+    munmap((void*)g.registros, GPIO_BLOQUE_BYTES);
+    close(g.fd);
+    g.registros = NULL;
+    g.fd = -1;
+}
+
+void gpioModoSalida(bloqueGpio& g, int pin) {
+    volatile uint32_t& fsel = g.registros[GPIO_GPFSEL0 + pin / 10];
+    int desplazamiento = (pin % 10) * 3;
+    fsel = (fsel & ~(7u << desplazamiento)) | ((uint32_t)GPIO_FUNCION_SALIDA << desplazamiento);
+}
+
+/**
+ * @brief Duerme hasta el instante absoluto 'ns' de CLOCK_MONOTONIC.
+ */
+static void esperarHastaNs(uint64_t ns) {
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+static uint64_t ahoraNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int enviarFrameGpio(bloqueGpio& g, int pin, int speed, const protocolo& proto, int largo,
+                    const FormatoLinea& formato) {
+    TRAZA_AMBITO_VALOR("enviarFrameGpio", largo);
+    BYTE niveles[BITS_FRAME(FrameEstandar::LARGO_MAX, 4)];
+    int n = nivelesFrame(proto, largo, niveles, formato);
+    int bits_byte = 9 + formato.bits_parada;
+    uint64_t bit_ns = 1000000000ULL / speed;
+    uint32_t mascara = 1u << pin;
+
+    flancosInicioFrame(speed, formato.bits_parada);
+    int escrituras = 0;
+    BYTE nivel = 1; // Reposo (HIGH)
+    uint64_t inicio = ahoraNs();
+    for (int i = 0; i < n; i++) {
+        if (niveles[i] == nivel) continue;
+        esperarHastaNs(inicio + i * bit_ns);
+        nivel = niveles[i];
+        gpioEscribir(g, nivel ? mascara : 0, nivel ? 0 : mascara);
+        escrituras++;
+
+        // Bits desde el último inicio de byte, como en enviarFrame()
+        int ultimo_inicio = (i / bits_byte < largo) ? (i / bits_byte) * bits_byte : (largo - 1) * bits_byte;
+        if (i == ultimo_inicio) flancosInicioByte();
+        else flancosRegistrar(i - ultimo_inicio);
+    }
+    // Como enviarFrame(): vuelve en el instante del stop final (aunque no
+    // haya flanco), el reposo entre frames lo pone el que llama
+    esperarHastaNs(inicio + (n - 1) * bit_ns);
+    flancosFinFrame();
+    return escrituras;
+}
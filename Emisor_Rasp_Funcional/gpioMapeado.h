@@ -0,0 +1,96 @@
+/**
+ * @file gpioMapeado.h
+ * @brief Salida por los registros GPIO mapeados en memoria (/dev/gpiomem).
+ * @details digitalWrite() de wiringPi pasa por su camino genérico de pines
+ * (varios microsegundos por flanco) y wiringPiSetupGpio() pide root. Acá
+ * se mapea el bloque de registros GPIO del BCM283x/BCM2711 desde
+ * /dev/gpiomem (alcanza con pertenecer al grupo 'gpio') y cada flanco es
+ * un store en GPSET0 o GPCLR0: varios pines cambian con una sola
+ * escritura y el flanco sale en decenas de nanosegundos.
+ *
+ * El bloque se abre con mmap() sobre cualquier archivo: con un archivo
+ * común de GPIO_BLOQUE_BYTES bytes en lugar de /dev/gpiomem, la lógica y
+ * la temporización se prueban en cualquier Linux (Herramientas_Host,
+ * escenario "gpiomem"). En ese caso los registros son memoria: GPSET0 y
+ * GPCLR0 guardan la última máscara escrita en lugar de cambiar GPLEV0.
+ *
+ * La Raspberry Pi 5 tiene los GPIO en el RP1, con otro mapa de registros:
+ * ahí hay que seguir con wiringPi.
+ */
+
+#ifndef GPIO_MAPEADO_H
+#define GPIO_MAPEADO_H
+
+#include "funcionesProtocolo.h"
+#include <stdint.h>
+
+#define GPIO_DISPOSITIVO "/dev/gpiomem"
+
+/**
+ * @brief Lo que se mapea: una página con todos los registros GPIO.
+ */
+#define GPIO_BLOQUE_BYTES 4096
+
+/**
+ * @brief Registros usados, como índice de palabra de 32 bits (offset / 4).
+ */
+#define GPIO_GPFSEL0 0   // 0x00: función de los pines, 3 bits por pin, 10 pines por registro
+#define GPIO_GPSET0 7    // 0x1C: bit N en 1 = pin N a HIGH
+#define GPIO_GPCLR0 10   // 0x28: bit N en 1 = pin N a LOW
+#define GPIO_GPLEV0 13   // 0x34: nivel de los pines 0..31
+
+#define GPIO_FUNCION_SALIDA 1
+
+/**
+ * @brief Un bloque de registros mapeado.
+ */
+typedef struct
+{
+    volatile uint32_t* registros;  // NULL = sin mapear
+    int fd;
+} bloqueGpio;
+
+/**
+ * @brief Bloque usado por el transporte "gpiomem" y la salida SALIDA_GPIOMEM.
+ */
+extern bloqueGpio g_gpio;
+
+/**
+ * @brief Mapea el bloque de registros desde 'ruta' (/dev/gpiomem o un archivo de prueba).
+ * @return false si no se pudo abrir o mapear (el motivo va por stdout).
+ */
+bool gpioAbrir(bloqueGpio& g, const char* ruta = GPIO_DISPOSITIVO);
+
+void gpioCerrar(bloqueGpio& g);
+
+/**
+ * @brief Configura 'pin' (BCM 0..31) como salida.
+ */
+void gpioModoSalida(bloqueGpio& g, int pin);
+
+/**
+ * @brief Pone en HIGH los pines de 'poner' y en LOW los de 'borrar' (bit N = pin BCM N).
+ * @details Un store por registro: todos los pines de una máscara cambian juntos.
+ */
+static inline void gpioEscribir(const bloqueGpio& g, uint32_t poner, uint32_t borrar) {
+    if (poner) g.registros[GPIO_GPSET0] = poner;
+    if (borrar) g.registros[GPIO_GPCLR0] = borrar;
+}
+
+static inline uint32_t gpioNiveles(const bloqueGpio& g) {
+    return g.registros[GPIO_GPLEV0];
+}
+
+/**
+ * @brief Transmite un frame por 'pin' escribiendo los registros.
+ * @details Los niveles salen de nivelesFrame() y cada bit se espera hasta
+ * su instante absoluto (clock_nanosleep con TIMER_ABSTIME) desde el
+ * inicio del frame: los atrasos de un despertar no se acumulan en los
+ * bits siguientes, como pasa con un delay() por bit. Solo se escribe
+ * cuando el nivel cambia. Los flancos van al histograma de la opción 12.
+ * @return La cantidad de escrituras en los registros.
+ */
+int enviarFrameGpio(bloqueGpio& g, int pin, int speed, const protocolo& proto, int largo,
+                    const FormatoLinea& formato = FORMATO_LINEA_ESTANDAR);
+
+#endif // GPIO_MAPEADO_H
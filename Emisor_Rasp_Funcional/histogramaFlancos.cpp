@@ -0,0 +1,215 @@
+/**
+ * @file histogramaFlancos.cpp
+ * @brief Implementación de los histogramas de desvío de flancos.
+ */
+
+#include "histogramaFlancos.h"
+#include <math.h>
+#include <time.h>
+
+histogramaNs g_flancos_acumulado;
+std::atomic<unsigned long> g_flancos_frames(0);
+bool g_flancos_activos = true;
+
+// Resumen del último frame, publicado con un seqlock: impar = escribiendo
+static resumenHistograma s_ultimo_frame;
+static std::atomic<uint32_t> s_ultimo_secuencia(0);
+
+// Estado del frame en curso (solo lo toca el hilo que transmite)
+static histogramaNs s_frame;
+static uint64_t s_bit_ns = 0;
+static int s_bits_byte = 11;         // Inicio + 8 datos + bits de parada
+static uint64_t s_referencia_ns = 0; // Último bit de inicio (0 = ninguno todavía)
+
+static inline uint64_t ahoraNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// --- Histograma genérico ---
+
+/**
+ * @brief Bucket de un valor: exacto por debajo de 2*HIST_SUB y después
+ * HIST_SUB buckets por potencia de 2.
+ */
+static inline int indiceDe(uint64_t v) {
+    if (v < 2 * HIST_SUB) return (int)v;
+    int exp = 63 - __builtin_clzll(v);
+    if (exp > HIST_EXP_MAX) return HIST_BUCKETS - 1;
+    int mantisa = (int)(v >> (exp - HIST_BITS_SUB)) - HIST_SUB;
+    return 2 * HIST_SUB + (exp - HIST_BITS_SUB - 1) * HIST_SUB + mantisa;
+}
+
+/**
+ * @brief Valor más alto que cae en el bucket 'i' (como HdrHistogram).
+ */
+static uint64_t valorDe(int i) {
+    if (i < 2 * HIST_SUB) return (uint64_t)i;
+    int k = i - 2 * HIST_SUB;
+    int exp = k / HIST_SUB + HIST_BITS_SUB + 1;
+    uint64_t mantisa = (uint64_t)(k % HIST_SUB + HIST_SUB);
+    return ((mantisa + 1) << (exp - HIST_BITS_SUB)) - 1;
+}
+
+void histogramaReiniciar(histogramaNs& h) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        h.cuentas[i].store(0, std::memory_order_relaxed);
+    }
+    h.total.store(0, std::memory_order_relaxed);
+    h.suma_ns.store(0, std::memory_order_relaxed);
+    h.maximo_ns.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Suma sin instrucción atómica de lectura-modificación-escritura.
+ * @details Hay un solo escritor (el hilo que transmite), así que alcanza
+ * con load + store; los lectores nunca ven un valor a medio escribir.
+ */
+static inline void sumar(std::atomic<uint64_t>& contador, uint64_t valor) {
+    contador.store(contador.load(std::memory_order_relaxed) + valor, std::memory_order_relaxed);
+}
+
+void histogramaRegistrar(histogramaNs& h, uint64_t valor_ns) {
+    sumar(h.cuentas[indiceDe(valor_ns)], 1);
+    sumar(h.total, 1);
+    sumar(h.suma_ns, valor_ns);
+    if (valor_ns > h.maximo_ns.load(std::memory_order_relaxed)) {
+        h.maximo_ns.store(valor_ns, std::memory_order_relaxed);
+    }
+}
+
+uint64_t histogramaPercentil(const histogramaNs& h, double p) {
+    uint64_t total = h.total.load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+    uint64_t objetivo = (uint64_t)(p * total + 0.5);
+    if (objetivo < 1) objetivo = 1;
+
+    uint64_t acumulado = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        acumulado += h.cuentas[i].load(std::memory_order_relaxed);
+        if (acumulado >= objetivo) {
+            uint64_t valor = valorDe(i);
+            uint64_t maximo = h.maximo_ns.load(std::memory_order_relaxed);
+            return (valor < maximo) ? valor : maximo;
+        }
+    }
+    return h.maximo_ns.load(std::memory_order_relaxed);
+}
+
+void histogramaResumir(const histogramaNs& h, resumenHistograma& r) {
+    r.total = h.total.load(std::memory_order_relaxed);
+    r.p50_ns = histogramaPercentil(h, 0.50);
+    r.p90_ns = histogramaPercentil(h, 0.90);
+    r.p99_ns = histogramaPercentil(h, 0.99);
+    r.p999_ns = histogramaPercentil(h, 0.999);
+    r.maximo_ns = h.maximo_ns.load(std::memory_order_relaxed);
+    r.promedio_ns = r.total ? (double)h.suma_ns.load(std::memory_order_relaxed) / r.total : 0.0;
+}
+
+void histogramaExportar(const histogramaNs& h, FILE* salida) {
+    // Copia instantánea: el emisor puede seguir registrando mientras tanto
+    static uint64_t cuentas[HIST_BUCKETS];
+    uint64_t total = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        cuentas[i] = h.cuentas[i].load(std::memory_order_relaxed);
+        total += cuentas[i];
+    }
+
+    fprintf(salida, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+    uint64_t acumulado = 0;
+    double suma_us = 0, suma_cuad_us = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        if (cuentas[i] == 0) continue;
+        acumulado += cuentas[i];
+        double valor_us = valorDe(i) / 1000.0;
+        suma_us += valor_us * cuentas[i];
+        suma_cuad_us += valor_us * valor_us * cuentas[i];
+        double percentil = (double)acumulado / total;
+        if (acumulado < total) {
+            fprintf(salida, "%12.3f %14.12f %10llu %14.2f\n", valor_us, percentil,
+                    (unsigned long long)acumulado, 1.0 / (1.0 - percentil));
+        } else {
+            fprintf(salida, "%12.3f %14.12f %10llu\n", valor_us, percentil,
+                    (unsigned long long)acumulado);
+        }
+    }
+
+    double promedio = total ? suma_us / total : 0.0;
+    double varianza = total ? suma_cuad_us / total - promedio * promedio : 0.0;
+    fprintf(salida, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", promedio,
+            varianza > 0 ? sqrt(varianza) : 0.0);
+    fprintf(salida, "#[Max     = %12.3f, Total count    = %12llu]\n",
+            h.maximo_ns.load(std::memory_order_relaxed) / 1000.0, (unsigned long long)total);
+    fprintf(salida, "#[Buckets = %12d, SubBuckets     = %12d]\n", HIST_BUCKETS, HIST_SUB);
+}
+
+// --- Instrumentación de enviarFrame() ---
+
+void flancosInicioFrame(int speed, int bits_parada) {
+    if (!g_flancos_activos) return;
+    histogramaReiniciar(s_frame);
+    s_bits_byte = 9 + bits_parada;
+    s_bit_ns = 1000000000ULL / speed;
+    s_referencia_ns = 0;
+}
+
+/**
+ * @brief Registra cuánto tarde (o temprano) ocurrió un flanco.
+ */
+static inline void registrarDesvio(uint64_t ahora, uint64_t ideal) {
+    uint64_t desvio = (ahora > ideal) ? ahora - ideal : ideal - ahora;
+    histogramaRegistrar(s_frame, desvio);
+    histogramaRegistrar(g_flancos_acumulado, desvio);
+}
+
+void flancosInicioByte() {
+    if (!g_flancos_activos) return;
+    uint64_t ahora = ahoraNs();
+    if (s_referencia_ns != 0) {
+        // 1 inicio + 8 datos + los de parada desde el byte anterior
+        registrarDesvio(ahora, s_referencia_ns + s_bits_byte * s_bit_ns);
+    }
+    s_referencia_ns = ahora;
+}
+
+void flancosRegistrar(int bits) {
+    if (!g_flancos_activos) return;
+    registrarDesvio(ahoraNs(), s_referencia_ns + bits * s_bit_ns);
+}
+
+void flancosFinFrame() {
+    if (!g_flancos_activos) return;
+    // Se resume afuera: la ventana en que la secuencia queda impar es solo la copia
+    resumenHistograma r;
+    histogramaResumir(s_frame, r);
+
+    uint32_t secuencia = s_ultimo_secuencia.load(std::memory_order_relaxed);
+    s_ultimo_secuencia.store(secuencia + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s_ultimo_frame = r;
+    s_ultimo_secuencia.store(secuencia + 2, std::memory_order_release);
+    g_flancos_frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void flancosUltimoFrame(resumenHistograma& r) {
+    for (;;) {
+        uint32_t antes = s_ultimo_secuencia.load(std::memory_order_acquire);
+        if (antes & 1) continue; // El hilo que transmite está copiando
+        r = s_ultimo_frame;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s_ultimo_secuencia.load(std::memory_order_relaxed) == antes) return;
+    }
+}
+
+void flancosImprimir(const char* titulo, const resumenHistograma& r, int speed) {
+    printf("%s: %llu flancos | p50 %.1f | p90 %.1f | p99 %.1f | p99.9 %.1f | max %.1f us (prom %.1f)\n",
+           titulo, (unsigned long long)r.total, r.p50_ns / 1000.0, r.p90_ns / 1000.0,
+           r.p99_ns / 1000.0, r.p999_ns / 1000.0, r.maximo_ns / 1000.0, r.promedio_ns / 1000.0);
+    if (r.total == 0) return;
+
+    // El receptor muestrea en el centro del bit: tolera hasta medio bit de desvío
+    double medio_bit_us = 500000.0 / speed;
+    printf("  Margen a %d bps (medio bit = %.0f us): %.1f us con p99.9, %.1f us con el máximo\n",
+           speed, medio_bit_us, medio_bit_us - r.p999_ns / 1000.0, medio_bit_us - r.maximo_ns / 1000.0);
+}
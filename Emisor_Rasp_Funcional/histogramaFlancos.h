@@ -0,0 +1,133 @@
+/**
+ * @file histogramaFlancos.h
+ * @brief Desvío de cada flanco transmitido respecto de su instante ideal.
+ * @details enviarFrame() toma la hora después de cada digitalWrite() y la
+ * compara con el instante en que debería haber ocurrido: el bit de inicio
+ * de su byte más N tiempos de bit. El bit de inicio es la referencia
+ * porque es donde el receptor se resincroniza; el margen de cada velocidad
+ * es entonces medio bit menos el desvío.
+ *
+ * Los desvíos van a histogramas tipo HDR (log-lineales, ~3% de precisión)
+ * con contadores atómicos. Solo escribe el hilo que transmite, así que
+ * registrar un flanco es un clock_gettime() y unos pocos load/store, sin
+ * locks (~60 ns en total): la medición queda siempre activa y el menú
+ * puede leer mientras se transmite. El resumen del último frame no cabe en
+ * un atómico: se publica con un seqlock (ver flancosUltimoFrame()).
+ */
+
+#ifndef HISTOGRAMA_FLANCOS_H
+#define HISTOGRAMA_FLANCOS_H
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Sub-buckets por potencia de 2 (2^5 = 32, error relativo <= 1/32).
+ */
+#define HIST_BITS_SUB 5
+#define HIST_SUB (1 << HIST_BITS_SUB)
+
+/**
+ * @brief Potencia de 2 más alta representable: 2^40 ns (~18 min).
+ * @details Los valores más grandes se cuentan en el último bucket.
+ */
+#define HIST_EXP_MAX 40
+
+/**
+ * @brief Cantidad de buckets: los valores < 2*HIST_SUB son exactos y
+ * cada potencia de 2 siguiente tiene HIST_SUB buckets.
+ */
+#define HIST_BUCKETS (2 * HIST_SUB + (HIST_EXP_MAX - HIST_BITS_SUB) * HIST_SUB)
+
+/**
+ * @brief Histograma de valores en nanosegundos.
+ */
+typedef struct
+{
+    std::atomic<uint64_t> cuentas[HIST_BUCKETS];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> suma_ns;
+    std::atomic<uint64_t> maximo_ns;
+} histogramaNs;
+
+/**
+ * @brief Percentiles de un histograma, en nanosegundos.
+ */
+typedef struct
+{
+    uint64_t total;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t maximo_ns;
+    double promedio_ns;
+} resumenHistograma;
+
+// --- Histograma genérico ---
+void histogramaReiniciar(histogramaNs& h);
+void histogramaRegistrar(histogramaNs& h, uint64_t valor_ns);
+uint64_t histogramaPercentil(const histogramaNs& h, double p);
+void histogramaResumir(const histogramaNs& h, resumenHistograma& r);
+
+/**
+ * @brief Escribe la distribución de percentiles en el formato .hgrm de
+ * HdrHistogram (valores en microsegundos), que se puede graficar con sus
+ * herramientas o leer con cualquier script.
+ */
+void histogramaExportar(const histogramaNs& h, FILE* salida);
+
+// --- Instrumentación de enviarFrame() ---
+
+/**
+ * @brief Todos los flancos enviados desde que arrancó el programa.
+ */
+extern histogramaNs g_flancos_acumulado;
+
+/**
+ * @brief Cantidad de frames medidos.
+ */
+extern std::atomic<unsigned long> g_flancos_frames;
+
+/**
+ * @brief Copia el resumen del último frame enviado.
+ * @details Se puede llamar desde cualquier hilo mientras se transmite: si
+ * flancosFinFrame() publica a mitad de la copia, se vuelve a copiar.
+ */
+void flancosUltimoFrame(resumenHistograma& r);
+
+/**
+ * @brief false = enviarFrame() no mide nada. El barrido de parámetros de
+ * Herramientas_Host transmite desde varios hilos a la vez y las apaga.
+ */
+extern bool g_flancos_activos;
+
+/**
+ * @brief Empieza un frame a 'speed' bps con 'bits_parada' después de cada byte.
+ */
+void flancosInicioFrame(int speed, int bits_parada);
+
+/**
+ * @brief Se llama justo después de escribir un bit de inicio. Registra su
+ * desvío respecto del byte anterior y lo toma como nueva referencia.
+ */
+void flancosInicioByte();
+
+/**
+ * @brief Se llama justo después de escribir un flanco que debería estar
+ * 'bits' tiempos de bit después del último bit de inicio.
+ */
+void flancosRegistrar(int bits);
+
+/**
+ * @brief Cierra el frame y publica su resumen (ver flancosUltimoFrame()).
+ */
+void flancosFinFrame();
+
+/**
+ * @brief Imprime un resumen y el margen respecto de medio bit a 'speed'.
+ */
+void flancosImprimir(const char* titulo, const resumenHistograma& r, int speed);
+
+#endif // HISTOGRAMA_FLANCOS_H
@@ -0,0 +1,374 @@
+/**
+ * @file ingestaSocket.cpp
+ * @brief Implementación de la ingesta de mensajes por socket Unix.
+ */
+
+#include "ingestaSocket.h"
+#include "funcionesProtocolo.h"
+#include "trazas.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <thread>
+
+estadisticasIngesta g_ingesta;
+bool g_ingesta_activa = false;
+
+// --- Cola sin locks ---
+
+void colaIngestaIniciar(colaIngesta& c) {
+    for (uint32_t i = 0; i < ING_COLA; i++) {
+        c.celdas[i].secuencia.store(i, std::memory_order_relaxed);
+    }
+    c.cola.store(0, std::memory_order_relaxed);
+    c.cabeza = 0;
+}
+
+bool colaIngestaPublicar(colaIngesta& c, const mensajeIngesta& m) {
+    uint32_t pos = c.cola.load(std::memory_order_relaxed);
+    for (;;) {
+        colaIngesta::celda& celda = c.celdas[pos & (ING_COLA - 1)];
+        int32_t dif = (int32_t)(celda.secuencia.load(std::memory_order_acquire) - pos);
+        if (dif == 0) {
+            // Libre en esta vuelta: reservarla (si otro productor ganó, 'pos' se actualiza)
+            if (c.cola.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                celda.mensaje = m;
+                celda.secuencia.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (dif < 0) {
+            return false; // El consumidor todavía no liberó la celda: llena
+        } else {
+            pos = c.cola.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool colaIngestaTomar(colaIngesta& c, mensajeIngesta& m) {
+    colaIngesta::celda& celda = c.celdas[c.cabeza & (ING_COLA - 1)];
+    if ((int32_t)(celda.secuencia.load(std::memory_order_acquire) - (c.cabeza + 1)) < 0) {
+        return false;
+    }
+    m = celda.mensaje;
+    celda.secuencia.store(c.cabeza + ING_COLA, std::memory_order_release);
+    c.cabeza++;
+    return true;
+}
+
+// --- Estado del bucle de epoll ---
+
+typedef struct
+{
+    int fd;                            // -1 = libre
+    BYTE lote[2 + ING_LOTE_MAX];
+    int tengo;                         // Bytes leídos del lote actual
+    std::atomic<int> en_cola;          // Aceptados que el empaquetador no entregó
+} clienteIngesta;
+
+#define EV_ESCUCHA ING_MAX_CLIENTES
+#define EV_DESPERTAR (ING_MAX_CLIENTES + 1)
+
+static colaIngesta s_cola;
+static clienteIngesta s_clientes[ING_MAX_CLIENTES];
+static int s_escucha = -1;
+static int s_epoll = -1;
+static int s_evento = -1;              // eventfd: despierta al empaquetador
+static int s_despertar = -1;           // eventfd: saca al bucle de epoll de la espera
+static std::atomic<int> s_conectados(0);
+static char s_ruta[sizeof(((struct sockaddr_un*)0)->sun_path)];
+
+static std::thread s_hilo;
+static std::thread s_hilo_epoll;
+static std::atomic<bool> s_detener(false);
+static std::atomic<bool> s_detener_epoll(false);
+static void (*s_entregar)(protocolo& proto, int largo) = NULL;
+
+static uint64_t ahoraNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// --- Empaquetador ---
+
+static void entregar(const mensajeIngesta& m) {
+    TRAZA_AMBITO_VALOR("ingestaEntregar", m.cliente);
+    protocolo proto;
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = m.cmd;
+    proto.lng = m.lng;
+    memcpy(proto.data, m.data, m.lng);
+    proto.t_pedido_ns = m.t_aceptado_ns; // Para la latencia por etapas, el mensaje se pidió al aceptarlo
+    int largo = empaquetar(proto);
+    s_entregar(proto, largo);
+
+    s_clientes[m.cliente].en_cola.fetch_sub(1);
+    g_ingesta.entregados++;
+    histogramaRegistrar(g_ingesta.espera, ahoraNs() - m.t_aceptado_ns);
+}
+
+static void hiloEmpaquetador() {
+    TRAZA_HILO("empaquetador");
+    mensajeIngesta m;
+    for (;;) {
+        while (colaIngestaTomar(s_cola, m)) entregar(m);
+        if (s_detener.load()) {
+            while (colaIngestaTomar(s_cola, m)) entregar(m); // Lo publicado justo antes
+            return;
+        }
+        uint64_t avisos;
+        if (read(s_evento, &avisos, sizeof(avisos)) < 0 && errno != EINTR) return;
+    }
+}
+
+// --- Clientes ---
+
+static void cerrarCliente(int i) {
+    epoll_ctl(s_epoll, EPOLL_CTL_DEL, s_clientes[i].fd, NULL);
+    close(s_clientes[i].fd);
+    s_clientes[i].fd = -1;
+    s_clientes[i].tengo = 0;
+    s_conectados--;
+}
+
+static void aceptarClientes() {
+    for (;;) {
+        int fd = accept4(s_escucha, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return; // EAGAIN: no hay más
+        // Un lugar libre y sin mensajes del cliente anterior todavía en la cola
+        int i = 0;
+        while (i < ING_MAX_CLIENTES && (s_clientes[i].fd >= 0 || s_clientes[i].en_cola.load() > 0)) i++;
+        if (i == ING_MAX_CLIENTES) {
+            close(fd);
+            continue;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        if (epoll_ctl(s_epoll, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            continue;
+        }
+        s_clientes[i].fd = fd;
+        s_clientes[i].tengo = 0;
+        s_conectados++;
+        g_ingesta.clientes++;
+    }
+}
+
+/**
+ * @brief Pasa a la cola los registros del lote completo del cliente 'i'.
+ * @return Cuántos se aceptaron.
+ */
+static int procesarLote(int i, int largo) {
+    clienteIngesta& cl = s_clientes[i];
+    int conectados = s_conectados.load();
+    int cuota = ING_COLA / (conectados > 0 ? conectados : 1);
+    if (cuota < ING_CUOTA_MIN) cuota = ING_CUOTA_MIN;
+
+    const BYTE* p = cl.lote + 2;
+    const BYTE* fin = p + largo;
+    int aceptados = 0;
+    BYTE estado = ING_OK;
+    uint64_t ahora = ahoraNs();
+    while (p < fin) {
+        if (fin - p < 2 || p[1] > g_config_enlace.lng_max || fin - p < 2 + p[1] ||
+            p[0] >= ING_CMD_LIMITE) {
+            estado = ING_INVALIDO;
+            g_ingesta.invalidos++;
+            break;
+        }
+        if (cl.en_cola.load() >= cuota) {
+            estado = ING_LLENO;
+            break;
+        }
+        mensajeIngesta m;
+        m.cmd = p[0];
+        m.lng = p[1];
+        memcpy(m.data, p + 2, m.lng);
+        m.cliente = i;
+        m.t_aceptado_ns = ahora;
+        cl.en_cola.fetch_add(1); // Antes de publicar: el empaquetador lo puede entregar enseguida
+        if (!colaIngestaPublicar(s_cola, m)) {
+            cl.en_cola.fetch_sub(1);
+            estado = ING_LLENO;
+            break;
+        }
+        aceptados++;
+        p += 2 + m.lng;
+    }
+    if (estado == ING_LLENO) {
+        // Los que faltan del lote (sin validarlos: el cliente los reenvía)
+        const BYTE* q = p;
+        while (fin - q >= 2 && fin - q >= 2 + q[1]) {
+            g_ingesta.rechazados++;
+            q += 2 + q[1];
+        }
+    }
+    g_ingesta.lotes++;
+    g_ingesta.aceptados += aceptados;
+
+    BYTE acuse[ING_BYTES_ACUSE] = {estado, (BYTE)(aceptados & 0xFF), (BYTE)(aceptados >> 8)};
+    if (send(cl.fd, acuse, sizeof(acuse), MSG_NOSIGNAL | MSG_DONTWAIT) != (ssize_t)sizeof(acuse)) {
+        cerrarCliente(i); // No lee los acuses
+    }
+    return aceptados;
+}
+
+/**
+ * @brief Lee del cliente 'i' hasta completar UN lote (o hasta que no haya más datos).
+ * @return Mensajes aceptados.
+ */
+static int leerCliente(int i) {
+    TRAZA_AMBITO_VALOR("ingestaLeer", i);
+    clienteIngesta& cl = s_clientes[i];
+    for (;;) {
+        int largo = (cl.tengo >= 2) ? (cl.lote[0] | (cl.lote[1] << 8)) : 0;
+        int falta = (cl.tengo < 2) ? 2 - cl.tengo : 2 + largo - cl.tengo;
+        if (falta > 0) {
+            ssize_t n = recv(cl.fd, cl.lote + cl.tengo, falta, MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+                cerrarCliente(i);
+                return 0;
+            }
+            if (n < 0) return 0;
+            cl.tengo += (int)n;
+            if (cl.tengo == 2 && (cl.lote[0] | (cl.lote[1] << 8)) > ING_LOTE_MAX) {
+                BYTE acuse[ING_BYTES_ACUSE] = {ING_INVALIDO, 0, 0};
+                send(cl.fd, acuse, sizeof(acuse), MSG_NOSIGNAL | MSG_DONTWAIT);
+                g_ingesta.invalidos++;
+                cerrarCliente(i); // Ya no se sabe dónde empieza el próximo lote
+                return 0;
+            }
+            continue;
+        }
+        cl.tengo = 0;
+        return procesarLote(i, largo); // Uno por ronda: los demás clientes no esperan
+    }
+}
+
+// --- Bucle de epoll (hilo propio) ---
+
+/**
+ * @brief Una vuelta del bucle de epoll: conexiones nuevas y un lote por cliente.
+ */
+static void atender() {
+    struct epoll_event eventos[ING_MAX_CLIENTES + 2];
+    int n = epoll_wait(s_epoll, eventos, ING_MAX_CLIENTES + 2, -1);
+    int publicados = 0;
+    for (int k = 0; k < n; k++) {
+        uint32_t id = eventos[k].data.u32;
+        if (id == EV_ESCUCHA) aceptarClientes();
+        else if (id == EV_DESPERTAR) continue; // s_detener_epoll ya está puesto
+        else if (s_clientes[id].fd >= 0) publicados += leerCliente((int)id);
+    }
+    if (publicados > 0) {
+        uint64_t uno = 1;
+        if (write(s_evento, &uno, sizeof(uno)) < 0) {
+            // Con el contador del eventfd al máximo el empaquetador ya está avisado
+        }
+    }
+}
+
+static void hiloEpoll() {
+    TRAZA_HILO("ingesta");
+    while (!s_detener_epoll.load()) atender();
+}
+
+bool ingestaIniciar(const char* ruta, void (*entregar_frame)(protocolo& proto, int largo)) {
+    if (strlen(ruta) >= sizeof(s_ruta)) {
+        printf("ERROR: la ruta del socket es demasiado larga.\n");
+        return false;
+    }
+    s_escucha = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    struct sockaddr_un dir;
+    memset(&dir, 0, sizeof(dir));
+    dir.sun_family = AF_UNIX;
+    strcpy(dir.sun_path, ruta);
+    unlink(ruta); // Un socket que quedó de una corrida anterior
+    if (s_escucha < 0 || bind(s_escucha, (struct sockaddr*)&dir, sizeof(dir)) < 0 ||
+        listen(s_escucha, ING_MAX_CLIENTES) < 0) {
+        printf("ERROR: No se pudo crear el socket %s: %s\n", ruta, strerror(errno));
+        if (s_escucha >= 0) close(s_escucha);
+        s_escucha = -1;
+        return false;
+    }
+    strcpy(s_ruta, ruta);
+
+    s_epoll = epoll_create1(EPOLL_CLOEXEC);
+    s_evento = eventfd(0, EFD_CLOEXEC);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = EV_ESCUCHA;
+    epoll_ctl(s_epoll, EPOLL_CTL_ADD, s_escucha, &ev);
+    s_despertar = eventfd(0, EFD_CLOEXEC);
+    ev.data.u32 = EV_DESPERTAR;
+    epoll_ctl(s_epoll, EPOLL_CTL_ADD, s_despertar, &ev);
+
+    for (int i = 0; i < ING_MAX_CLIENTES; i++) {
+        s_clientes[i].fd = -1;
+        s_clientes[i].tengo = 0;
+        s_clientes[i].en_cola.store(0);
+    }
+    s_conectados.store(0);
+    colaIngestaIniciar(s_cola);
+    g_ingesta.clientes = g_ingesta.lotes = g_ingesta.aceptados = 0;
+    g_ingesta.rechazados = g_ingesta.invalidos = g_ingesta.entregados = 0;
+    histogramaReiniciar(g_ingesta.espera);
+
+    s_entregar = entregar_frame;
+    s_detener.store(false);
+    s_hilo = std::thread(hiloEmpaquetador);
+    s_detener_epoll.store(false);
+    s_hilo_epoll = std::thread(hiloEpoll);
+    g_ingesta_activa = true;
+    return true;
+}
+
+void ingestaDetener() {
+    if (!g_ingesta_activa) return;
+    // Primero el bucle de epoll: después nadie más toca los clientes
+    s_detener_epoll.store(true);
+    uint64_t uno = 1;
+    if (write(s_despertar, &uno, sizeof(uno)) < 0) {
+        // No puede fallar con el contador en 0
+    }
+    s_hilo_epoll.join();
+    for (int i = 0; i < ING_MAX_CLIENTES; i++) {
+        if (s_clientes[i].fd >= 0) cerrarCliente(i);
+    }
+    close(s_escucha);
+    unlink(s_ruta);
+    s_escucha = -1;
+
+    s_detener.store(true);
+    if (write(s_evento, &uno, sizeof(uno)) < 0) {
+        // El empaquetador igual ve s_detener en su próxima vuelta
+    }
+    s_hilo.join();
+    close(s_evento);
+    close(s_despertar);
+    close(s_epoll);
+    g_ingesta_activa = false;
+}
+
+void ingestaImprimir() {
+    printf("--- Ingesta por socket (%s) ---\n", s_ruta);
+    printf("Clientes: %lu (conectados: %d) | Lotes: %lu | Aceptados: %lu | Entregados: %lu\n",
+           g_ingesta.clientes.load(), s_conectados.load(), g_ingesta.lotes.load(),
+           g_ingesta.aceptados.load(), g_ingesta.entregados.load());
+    printf("Rechazados por cola llena: %lu | Inválidos: %lu\n", g_ingesta.rechazados.load(),
+           g_ingesta.invalidos.load());
+    resumenHistograma r;
+    histogramaResumir(g_ingesta.espera, r);
+    if (r.total > 0) {
+        printf("Espera en la cola: p50 %.1f | p99 %.1f | max %.1f us\n", r.p50_ns / 1000.0,
+               r.p99_ns / 1000.0, r.maximo_ns / 1000.0);
+    }
+}
@@ -0,0 +1,148 @@
+/**
+ * @file ingestaSocket.h
+ * @brief Mensajes de otros procesos por un socket Unix local (--socket RUTA).
+ * @details Hasta ahora un mensaje solo entraba tipeado en el menú. Con
+ * --socket, los servicios de la Raspberry se conectan a RUTA (SOCK_STREAM)
+ * y mandan lotes de mensajes ya armados:
+ *
+ *   lote      [largo: 2 bytes LE][registro][registro]...   cliente -> emisor
+ *   registro  [cmd][lng][datos: lng bytes]
+ *   acuse     [estado][aceptados: 2 bytes LE]               emisor -> cliente
+ *
+ * 'largo' cuenta los bytes de los registros (hasta ING_LOTE_MAX). Cada
+ * lote recibe un acuse con cuántos registros, desde el primero, entraron
+ * a la cola. Con ING_LLENO el cliente reintenta los que faltan más tarde
+ * (contrapresión); con ING_INVALIDO el registro que sigue está mal formado
+ * o es un comando del protocolo que no se acepta de afuera (CMD 8 en
+ * adelante) y se descarta el resto del lote.
+ *
+ * Un bucle de epoll en su propio hilo atiende el socket y los clientes:
+ * siguen atendidos mientras el menú espera una opción, hace sus preguntas
+ * o corre una opción larga (ej: telemetría). Por ronda se lee a lo sumo un
+ * lote por cliente, y cada cliente puede tener en la cola hasta su parte
+ * (ING_COLA repartida entre los conectados): uno que manda mucho no deja
+ * sin lugar a los demás.
+ *
+ * Los aceptados pasan por una cola sin locks de varios productores y un
+ * consumidor (anillo de Vyukov) a un hilo empaquetador, que los entrega a
+ * la cola de prioridades (--socket activa --prioridades: un solo hilo
+ * escribe la línea aunque el menú también envíe).
+ */
+
+#ifndef INGESTA_SOCKET_H
+#define INGESTA_SOCKET_H
+
+#include "structProtocolo.h"
+#include "histogramaFlancos.h"
+#include <stdint.h>
+#include <atomic>
+
+#define ING_RUTA_DEFECTO "/tmp/emisor.sock"
+
+/**
+ * @brief Mensajes en la cola entre el bucle de epoll y el empaquetador (potencia de 2).
+ */
+#define ING_COLA 256
+
+/**
+ * @brief Parte mínima de la cola por cliente, aunque haya muchos conectados.
+ */
+#define ING_CUOTA_MIN 4
+
+#define ING_MAX_CLIENTES 64
+#define ING_LOTE_MAX 1024
+
+/**
+ * @brief Primer comando que no se acepta por el socket (telemetría, caché,
+ * control del enlace, fragmentos y RPC los arma el propio emisor).
+ */
+#define ING_CMD_LIMITE 8
+
+/**
+ * @brief Estados del acuse.
+ */
+#define ING_OK 0
+#define ING_LLENO 1
+#define ING_INVALIDO 2
+
+#define ING_BYTES_ACUSE 3
+
+/**
+ * @brief Un mensaje aceptado, todavía sin empaquetar.
+ */
+typedef struct
+{
+    BYTE cmd;
+    BYTE lng;
+    BYTE data[LARGO_DATA];
+    int cliente;               // Para devolverle su parte de la cola
+    uint64_t t_aceptado_ns;
+} mensajeIngesta;
+
+/**
+ * @brief Anillo acotado de varios productores y un consumidor, sin locks.
+ * @details Cada celda tiene un número de secuencia: un productor reserva
+ * una posición con compare-exchange sobre 'cola' y publica la celda
+ * poniendo su secuencia en posición + 1; el consumidor la libera para la
+ * vuelta siguiente con posición + ING_COLA.
+ */
+typedef struct
+{
+    struct celda
+    {
+        std::atomic<uint32_t> secuencia;
+        mensajeIngesta mensaje;
+    } celdas[ING_COLA];
+    alignas(64) std::atomic<uint32_t> cola;   // Próxima posición a reservar (productores)
+    alignas(64) uint32_t cabeza;              // Próxima posición a leer (solo el consumidor)
+} colaIngesta;
+
+void colaIngestaIniciar(colaIngesta& c);
+
+/**
+ * @brief Publica un mensaje. Se puede llamar desde varios hilos a la vez.
+ * @return false si la cola está llena.
+ */
+bool colaIngestaPublicar(colaIngesta& c, const mensajeIngesta& m);
+
+/**
+ * @brief Saca el mensaje más viejo. Solo desde el hilo consumidor.
+ * @return false si la cola está vacía.
+ */
+bool colaIngestaTomar(colaIngesta& c, mensajeIngesta& m);
+
+/**
+ * @brief Contadores de la ingesta.
+ */
+typedef struct
+{
+    std::atomic<unsigned long> clientes;      // Conexiones aceptadas
+    std::atomic<unsigned long> lotes;
+    std::atomic<unsigned long> aceptados;
+    std::atomic<unsigned long> rechazados;    // Por contrapresión (ING_LLENO)
+    std::atomic<unsigned long> invalidos;
+    std::atomic<unsigned long> entregados;    // Empaquetados y entregados al envío
+    histogramaNs espera;                      // De aceptado a entregado
+} estadisticasIngesta;
+
+extern estadisticasIngesta g_ingesta;
+
+/**
+ * @brief Activa con --socket.
+ */
+extern bool g_ingesta_activa;
+
+/**
+ * @brief Crea el socket en 'ruta' y arranca los hilos de epoll y empaquetador.
+ * @param entregar Recibe cada mensaje empaquetado (corre en el empaquetador).
+ */
+bool ingestaIniciar(const char* ruta, void (*entregar)(protocolo& proto, int largo));
+
+/**
+ * @brief Cierra el socket y los clientes y espera a que se entregue lo aceptado.
+ */
+void ingestaDetener();
+
+void ingestaImprimir();
+
+#endif // INGESTA_SOCKET_H
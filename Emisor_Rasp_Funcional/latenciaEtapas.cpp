@@ -0,0 +1,210 @@
+/**
+ * @file latenciaEtapas.cpp
+ * @brief Implementación de la latencia por etapas: envíos anotados,
+ * emparejamiento con los registros de la ESP32 y percentiles por comando.
+ */
+
+#include "latenciaEtapas.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+
+medicionLatencia g_latencia;
+
+static std::atomic<uint64_t> s_pedido_ns(0);
+
+static const char* NOMBRE_ETAPA[LAT_NUM_ETAPAS] = {"preparar", "cola", "línea", "pipeline", "desempaquetar",
+                                                    "ejecutar", "display", "total"};
+
+// El reloj de capturaAhoraNs(), con el que transmitirConContador() mide los envíos
+static uint64_t ahoraNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void latenciaIniciar(medicionLatencia& m) {
+    std::lock_guard<std::mutex> bloqueo(m.mutex);
+    memset(m.envios, 0, sizeof(m.envios));
+    m.num_envios = 0;
+    m.buscar_desde = 0;
+    m.con_desfase = false;
+    m.desfase_us = 0;
+    m.desde = 0;
+    for (int c = 0; c < LAT_CMDS; c++) {
+        if (m.etapas[c] == NULL) continue;
+        for (int e = 0; e < LAT_NUM_ETAPAS; e++) {
+            histogramaReiniciar(m.etapas[c][e]);
+        }
+    }
+    m.emparejados = m.sin_envio = m.perdidos = m.ambiguos = m.sin_ejecutar = 0;
+}
+
+void latenciaMarcarPedido() {
+    s_pedido_ns.store(ahoraNs());
+}
+
+void latenciaSellar(protocolo& proto) {
+    proto.t_encolado_ns = ahoraNs();
+    if (proto.t_pedido_ns == 0) {
+        proto.t_pedido_ns = s_pedido_ns.load();
+    }
+}
+
+void latenciaRegistrarEnvio(medicionLatencia& m, const protocolo& envio, uint64_t tx_inicio_ns,
+                            uint64_t tx_fin_ns) {
+    std::lock_guard<std::mutex> bloqueo(m.mutex);
+    envioMedido& e = m.envios[m.num_envios % LAT_ENVIOS];
+    e.clave = etapasClave(envio.cmd, envio.data, envio.fcs);
+    e.cmd = envio.cmd;
+    e.emparejado = false;
+    e.tx_inicio_ns = tx_inicio_ns;
+    e.tx_fin_ns = tx_fin_ns;
+    // Un frame sin sellar (ej: armado fuera de enviarFrameConContador) empieza en la línea
+    e.encolado_ns = (envio.t_encolado_ns != 0 && envio.t_encolado_ns <= tx_inicio_ns) ? envio.t_encolado_ns
+                                                                                        : tx_inicio_ns;
+    e.pedido_ns = (envio.t_pedido_ns != 0 && envio.t_pedido_ns <= e.encolado_ns) ? envio.t_pedido_ns
+                                                                                   : e.encolado_ns;
+    m.num_envios++;
+}
+
+/**
+ * @brief Distancia entre el desfase de los relojes que daría este envío y
+ * el del emparejamiento anterior (con signo: micros() da la vuelta).
+ */
+static uint32_t distanciaDesfase(const medicionLatencia& m, const envioMedido& e, const registroEtapas& r) {
+    uint32_t desfase = (uint32_t)(e.tx_fin_ns / 1000) - r.fin_us;
+    int32_t diferencia = (int32_t)(desfase - m.desfase_us);
+    return (diferencia < 0) ? (uint32_t)-(int64_t)diferencia : (uint32_t)diferencia;
+}
+
+static void sumarEtapas(medicionLatencia& m, const envioMedido& e, const registroEtapas& r) {
+    if (r.cmd == ETAPAS_SIN_EJECUTAR || r.cmd >= LAT_CMDS) {
+        m.sin_ejecutar++;
+        return;
+    }
+    if (m.etapas[r.cmd] == NULL) {
+        m.etapas[r.cmd] = new histogramaNs[LAT_NUM_ETAPAS];
+        for (int i = 0; i < LAT_NUM_ETAPAS; i++) {
+            histogramaReiniciar(m.etapas[r.cmd][i]);
+        }
+    }
+    uint64_t ns[LAT_NUM_ETAPAS];
+    ns[LAT_PREPARAR] = e.encolado_ns - e.pedido_ns;
+    ns[LAT_COLA] = e.tx_inicio_ns - e.encolado_ns;
+    ns[LAT_LINEA] = e.tx_fin_ns - e.tx_inicio_ns;
+    ns[LAT_PIPELINE] = (uint64_t)r.pipeline_us * 1000;
+    ns[LAT_DECODIFICAR] = (uint64_t)r.decodificar_us * 1000;
+    ns[LAT_EJECUTAR] = (uint64_t)r.ejecutar_us * 1000;
+    ns[LAT_DISPLAY] = (uint64_t)r.display_us * 1000;
+    ns[LAT_TOTAL] = 0;
+    for (int i = 0; i < LAT_TOTAL; i++) {
+        ns[LAT_TOTAL] += ns[i];
+    }
+    for (int i = 0; i < LAT_NUM_ETAPAS; i++) {
+        histogramaRegistrar(m.etapas[r.cmd][i], ns[i]);
+    }
+}
+
+/**
+ * @brief Busca el envío de 'r' desde el último emparejado (la ESP32 anota
+ * los frames en el orden en que salieron). Los que quedan en el medio sin
+ * emparejar no llegaron (o llegaron con el FCS mal).
+ */
+static bool emparejar(medicionLatencia& m, const registroEtapas& r) {
+    unsigned long primero = m.buscar_desde;
+    if (m.num_envios > LAT_ENVIOS && primero < m.num_envios - LAT_ENVIOS) {
+        primero = m.num_envios - LAT_ENVIOS;
+    }
+    long elegido = -1;
+    int candidatos = 0;
+    uint32_t mejor = 0;
+    uint32_t segundo = UINT32_MAX;
+    for (unsigned long i = primero; i < m.num_envios; i++) {
+        const envioMedido& e = m.envios[i % LAT_ENVIOS];
+        if (e.emparejado || e.cmd != r.cmd_linea || e.clave != r.clave) continue;
+        candidatos++;
+        uint32_t distancia = m.con_desfase ? distanciaDesfase(m, e, r) : 0;
+        if (elegido < 0 || distancia < mejor) {
+            segundo = (elegido < 0) ? UINT32_MAX : mejor;
+            elegido = (long)i;
+            mejor = distancia;
+        } else if (distancia < segundo) {
+            segundo = distancia;
+        }
+    }
+    if (elegido < 0) {
+        m.sin_envio++;
+        return false;
+    }
+    // Sin referencia, cualquiera de los candidatos podría ser; con ella, el
+    // segundo tiene que quedar claramente más lejos que el elegido (el
+    // desfase real se corre hasta un bit y medio entre frames, y dos envíos
+    // con la misma clave están al menos un frame entero uno del otro)
+    if (candidatos > 1 && (!m.con_desfase || segundo < 2 * (uint64_t)mejor + LAT_MARGEN_DESFASE_US)) {
+        m.ambiguos++;
+        return false;
+    }
+
+    envioMedido& e = m.envios[elegido % LAT_ENVIOS];
+    e.emparejado = true;
+    m.buscar_desde = (unsigned long)elegido + 1;
+    m.desfase_us = (uint32_t)(e.tx_fin_ns / 1000) - r.fin_us;
+    m.con_desfase = true;
+    m.emparejados++;
+    sumarEtapas(m, e, r);
+    return true;
+}
+
+bool latenciaEmparejar(medicionLatencia& m, const registroEtapas& r) {
+    std::lock_guard<std::mutex> bloqueo(m.mutex);
+    return emparejar(m, r);
+}
+
+int latenciaProcesarRespuesta(medicionLatencia& m, const BYTE* datos, int lng) {
+    if (lng < ETAPAS_CABECERA_RESPUESTA) return -1;
+    int cantidad = datos[0];
+    uint16_t primero = (uint16_t)((datos[1] << 8) | datos[2]);
+    if (cantidad > ETAPAS_POR_RESPUESTA || lng != ETAPAS_CABECERA_RESPUESTA + cantidad * ETAPAS_REGISTRO_BYTES) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> bloqueo(m.mutex);
+    // Un 'primero' anterior a 'desde' es una ESP32 que se reinició: no se perdió nada
+    uint16_t salteados = (uint16_t)(primero - m.desde);
+    if (salteados < 0x8000) {
+        m.perdidos += salteados;
+    }
+    for (int i = 0; i < cantidad; i++) {
+        registroEtapas r;
+        etapasLeer(datos + ETAPAS_CABECERA_RESPUESTA + i * ETAPAS_REGISTRO_BYTES, r);
+        emparejar(m, r);
+    }
+    m.desde = (uint16_t)(primero + cantidad);
+    return cantidad;
+}
+
+const histogramaNs* latenciaEtapa(const medicionLatencia& m, int cmd, int etapa) {
+    if (cmd < 0 || cmd >= LAT_CMDS || m.etapas[cmd] == NULL) return NULL;
+    return &m.etapas[cmd][etapa];
+}
+
+void latenciaImprimir(medicionLatencia& m) {
+    std::lock_guard<std::mutex> bloqueo(m.mutex);
+    printf("--- Latencia por etapas (ms) ---\n");
+    printf("Envíos: %lu | Emparejados: %lu (sin ejecutar: %lu) | Sin envío: %lu | Ambiguos: %lu | "
+           "Pisados en la ESP32: %lu\n",
+           m.num_envios, m.emparejados, m.sin_ejecutar, m.sin_envio, m.ambiguos, m.perdidos);
+    for (int c = 0; c < LAT_CMDS; c++) {
+        if (m.etapas[c] == NULL) continue;
+        resumenHistograma total;
+        histogramaResumir(m.etapas[c][LAT_TOTAL], total);
+        printf("CMD %d, %llu frames:      p50       p90       p99\n", c, (unsigned long long)total.total);
+        for (int e = 0; e < LAT_NUM_ETAPAS; e++) {
+            resumenHistograma r;
+            histogramaResumir(m.etapas[c][e], r);
+            printf("  %-14s %9.1f %9.1f %9.1f\n", NOMBRE_ETAPA[e], r.p50_ns / 1e6, r.p90_ns / 1e6, r.p99_ns / 1e6);
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/**
+ * @file latenciaEtapas.h
+ * @brief Latencia de punta a punta por etapas: desde que se pide un mensaje
+ * en el menú hasta que la ESP32 termina de escribirlo en el OLED.
+ * @details Cada frame pasa por ocho tramos, medidos en dos relojes:
+ *
+ *   emisor  preparar (pedido -> entregado), cola (-> empieza a salir), línea
+ *   ESP32   pipeline (fin de la línea -> tarea de comandos), desempaquetar,
+ *           ejecutar y display (display.display(), aparte de ejecutar)
+ *
+ * El emisor anota cada frame que transmite (latenciaRegistrarEnvio) y la
+ * ESP32 anota cada frame válido (etapasLatencia.h); la opción 16 pide los
+ * registros de la ESP32 con RPC_ETAPAS y los empareja con los envíos por
+ * la clave del frame. Los dos relojes no se sincronizan: las dos partes se
+ * pegan en el fin de la línea, que es casi el mismo instante para las dos
+ * puntas (la ESP32 termina de leer la paridad y el stop hasta un bit y
+ * medio después; con repetidores, más el retardo de los saltos). Entre
+ * envíos con la misma clave (frames idénticos, o distintos con el mismo
+ * FCS: el conteo de unos choca seguido) gana el que coincide con el
+ * desfase entre los relojes del emparejamiento anterior. Si no hay uno
+ * anterior, o el desfase no separa a los candidatos, el registro se
+ * descarta y se cuenta como ambiguo en vez de elegir uno al azar.
+ *
+ * Los percentiles van por comando ejecutado: un mensaje en fragmentos
+ * cuenta una vez, con el último fragmento (que es el que lo ejecuta); los
+ * fragmentos intermedios, los CMD 9 que fallan y los CMD 13 que no se
+ * pueden abrir cuentan como sin ejecutar.
+ * Solo se miden los frames del enlace principal (no los de --enlaces).
+ */
+
+#ifndef LATENCIA_ETAPAS_H
+#define LATENCIA_ETAPAS_H
+
+#include "structProtocolo.h"
+#include "histogramaFlancos.h"
+#include "etapasLatencia.h"
+#include <stdint.h>
+#include <mutex>
+
+/**
+ * @brief Envíos recordados para emparejar (los registros de la ESP32 llegan
+ * cuando se piden con la opción 16).
+ */
+#define LAT_ENVIOS 256
+
+/**
+ * @brief Comandos con percentiles propios (el cmd ocupa 4 bits).
+ */
+#define LAT_CMDS 16
+
+/**
+ * @brief Margen (us) con el que el segundo candidato tiene que quedar más
+ * lejos del desfase que el doble de la distancia del elegido.
+ */
+#define LAT_MARGEN_DESFASE_US 200
+
+enum etapaLatencia
+{
+    LAT_PREPARAR,
+    LAT_COLA,
+    LAT_LINEA,
+    LAT_PIPELINE,
+    LAT_DECODIFICAR,
+    LAT_EJECUTAR,
+    LAT_DISPLAY,
+    LAT_TOTAL,
+    LAT_NUM_ETAPAS
+};
+
+/**
+ * @brief Un frame que salió por la línea.
+ */
+typedef struct
+{
+    uint16_t clave;
+    uint8_t cmd;               // En la línea
+    bool emparejado;
+    uint64_t pedido_ns;
+    uint64_t encolado_ns;
+    uint64_t tx_inicio_ns;
+    uint64_t tx_fin_ns;
+} envioMedido;
+
+typedef struct
+{
+    envioMedido envios[LAT_ENVIOS];
+    unsigned long num_envios;      // Desde el inicio (el anillo guarda los últimos LAT_ENVIOS)
+    unsigned long buscar_desde;    // El siguiente al último emparejado
+    bool con_desfase;
+    uint32_t desfase_us;           // Fin de la línea en el emisor - en la ESP32 (último emparejado)
+    uint16_t desde;                // Próximo registro de la ESP32 a pedir
+    histogramaNs* etapas[LAT_CMDS]; // LAT_NUM_ETAPAS por comando, al aparecer el primero
+    unsigned long emparejados;
+    unsigned long sin_envio;       // Registros de la ESP32 sin envío (ya salió del anillo o es de otro emisor)
+    unsigned long perdidos;        // Registros que la ESP32 pisó antes de que se pidieran
+    unsigned long ambiguos;        // Misma clave y el desfase no separa a los candidatos
+    unsigned long sin_ejecutar;
+    std::mutex mutex;              // El hilo de envío anota, el menú empareja
+} medicionLatencia;
+
+extern medicionLatencia g_latencia;
+
+void latenciaIniciar(medicionLatencia& m);
+
+/**
+ * @brief Marca el pedido del mensaje que se está armando (ej: el Enter
+ * del texto en el menú). La toman los frames que se entregan sin marca propia.
+ */
+void latenciaMarcarPedido();
+
+/**
+ * @brief Marca 'proto' como entregado para transmitir ahora (y como pedido
+ * en la última marca, si no trae una propia).
+ */
+void latenciaSellar(protocolo& proto);
+
+/**
+ * @brief Anota un frame transmitido. 'envio' es el que salió por la línea
+ * (con el sobre CMD 13, la caché o el fragmento ya aplicados).
+ */
+void latenciaRegistrarEnvio(medicionLatencia& m, const protocolo& envio, uint64_t tx_inicio_ns,
+                            uint64_t tx_fin_ns);
+
+/**
+ * @brief Empareja un registro de la ESP32 con su envío y suma sus etapas.
+ * @return false si no se encontró el envío.
+ */
+bool latenciaEmparejar(medicionLatencia& m, const registroEtapas& r);
+
+/**
+ * @brief Procesa los datos de una respuesta de RPC_ETAPAS (y avanza 'desde').
+ * @return Cuántos registros traía, o -1 si está mal formada.
+ */
+int latenciaProcesarRespuesta(medicionLatencia& m, const BYTE* datos, int lng);
+
+/**
+ * @brief Percentiles de un tramo (NULL si el comando no tiene frames).
+ */
+const histogramaNs* latenciaEtapa(const medicionLatencia& m, int cmd, int etapa);
+
+void latenciaImprimir(medicionLatencia& m);
+
+#endif // LATENCIA_ETAPAS_H
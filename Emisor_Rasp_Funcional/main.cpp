@@ -1,32 +1,325 @@
 /**
  * @file main.cpp
  * @brief Punto de entrada principal para el programa Emisor (Raspberry Pi).
- * @details Este archivo inicializa wiringPi, muestra el menú en un bucle
+ * @details Este archivo lee las opciones de línea de comandos, inicializa el
+ * transporte (wiringPi por defecto), muestra el menú en un bucle
  * y despacha las acciones a las funciones 'opcion_X'.
  */
 
 #include "funcionesMenu.h"
+#include "registroCaptura.h"
+#include "cacheEmisor.h"
+#include "velocidadAdaptativa.h"
+#include "tiempoReal.h"
+#include "prioridadEnvio.h"
+#include "rpcEmisor.h"
+#include "multiEnlace.h"
+#include "negociacionEmisor.h"
+#include "gpioMapeado.h"
+#include "ingestaSocket.h"
+#include "trazas.h"
+#include "latenciaEtapas.h"
+#include "formaOndaSpi.h"
 #include <iostream>  // Para std::cout, std::cin, std::getline
 #include <string>    // Para std::string, std::stol
 #include <stdexcept> // Para std::invalid_argument (manejo de errores de conversión)
 
-int main() {
-    
+/**
+ * @brief Mensajes del socket: a su clase de prioridad (--socket activa
+ * --prioridades), que los parte en fragmentos si hace falta.
+ */
+static void entregarIngesta(protocolo& proto, int largo) {
+    latenciaSellar(proto);
+    envioEncolar(proto);
+}
+
+/**
+ * @brief Vuelca los eventos de traza en 'ruta' (JSON de Chrome / Perfetto).
+ */
+static void volcarTrazas(const char* ruta) {
+    FILE* f = fopen(ruta, "w");
+    if (f == NULL) {
+        perror("ERROR al abrir el archivo de trazas");
+        return;
+    }
+    unsigned long eventos = trazaExportar(trazaEscribirArchivo, f);
+    fclose(f);
+    printf("Trazas: %lu eventos en %s (%lu perdidos por falta de anillo)\n", eventos, ruta,
+           trazaConjunto().perdidos.load());
+}
+
+/**
+ * @brief Muestra las opciones de línea de comandos.
+ */
+static void mostrarUso(const char* programa) {
+    printf("Uso: %s [opciones]\n", programa);
+    printf("  --transporte NOMBRE   Backend de transmisión (por defecto: wiringpi)\n");
+    printf("  --gpiomem             Escribe los registros GPIO de %s: sin wiringPi ni root\n",
+           GPIO_DISPOSITIVO);
+    printf("                        (transporte gpiomem, o la salida de --enlaces)\n");
+    printf("  --gpiomem-archivo F   Mapea el archivo F en lugar de %s (pruebas)\n", GPIO_DISPOSITIVO);
+    printf("  --spi-dispositivo D   Transporte spi por el dispositivo D (defecto: %s)\n", SPI_DISPOSITIVO);
+    printf("  --spi-reloj HZ        Reloj del núcleo del que sale el del SPI (defecto: %ld)\n",
+           SPI_RELOJ_NUCLEO_HZ);
+    printf("  --spi-invertida       Dibuja la forma de onda invertida (con un inversor en el MOSI)\n");
+    printf("  --captura ARCHIVO     Registra cada frame enviado en ARCHIVO\n");
+    printf("  --registros N         Capacidad del anillo de captura (defecto: %d)\n", CAPTURA_REGISTROS_DEFECTO);
+    printf("  --reproducir ARCHIVO  Reenvía una captura y sale\n");
+    printf("  --rapido              Al reproducir, no respetar los tiempos originales\n");
+    printf("  --cache               Reemplaza los payloads repetidos por frames CMD 9 cortos\n");
+    printf("  --adaptativo          Ajusta la velocidad según los reportes del receptor\n");
+    printf("                        (requiere la línea de retorno en el GPIO %d)\n", RX_RETORNO_PIN);
+    printf("  --prioridades         Control antes que lo interactivo y lo masivo, con los\n");
+    printf("                        payloads largos partidos en fragmentos (CMD 11)\n");
+    printf("  --conflacion          Un valor nuevo para el OLED o el LED (CMD 2, 3, 5) pisa al\n");
+    printf("                        pendiente que todavía no salió (activa --prioridades)\n");
+    printf("  --rpc                 Pedidos al receptor con respuesta (opción 13, CMD 12)\n");
+    printf("                        (requiere la línea de retorno en el GPIO %d)\n", RX_RETORNO_PIN);
+    printf("  --socket RUTA         Acepta lotes de mensajes de otros procesos por un socket\n");
+    printf("                        Unix (ej: %s; activa --prioridades)\n", ING_RUTA_DEFECTO);
+    printf("  --negociar            Acuerda velocidad, bits de parada, FCS y payload con el\n");
+    printf("                        receptor al arrancar (opción 15, CMD 10)\n");
+    printf("  --enlaces P1,P2,...   Un enlace por pin BCM (hasta %d) desde un solo hilo;\n", ME_MAX_ENLACES);
+    printf("                        el menú usa el primero (transporte multienlace)\n");
+    printf("  --fragmento N         Datos por fragmento %d..%d, 0 = sin partir (defecto: %d)\n",
+           FRAG_DATOS_MIN, FRAG_DATOS_MAX, FRAG_DATOS_DEFECTO);
+    printf("  --destino N           Envía al receptor N (1..254, 255 = todos) a través de\n");
+    printf("                        receptores en modo repetidor (CMD 13)\n");
+    printf("  --saltos N            Repetidores que puede cruzar cada frame (defecto: %d)\n",
+           REENVIO_SALTOS_DEFECTO);
+    printf("  --trazas ARCHIVO      Al salir, vuelca los puntos de traza en ARCHIVO (JSON de\n");
+    printf("                        Chrome / Perfetto; requiere compilar con make TRAZAS=1)\n");
+    printf("  --tiempo-real         SCHED_FIFO, memoria bloqueada y core fijo (requiere root)\n");
+    printf("  --prioridad N         Prioridad SCHED_FIFO 1..99 (defecto: %d)\n", TR_PRIORIDAD_DEFECTO);
+    printf("  --cpu N               Core del emisor (defecto: el último core aislado)\n");
+    printf("  --medir-latencia N    Mide N despertares de 1 ms, sugiere una velocidad y sale\n");
+    printf("Transportes disponibles:\n");
+    listarTransportes();
+}
+
+int main(int argc, char** argv) {
+
+    // --- Opciones de línea de comandos ---
+    const char* ruta_captura = NULL;
+    const char* ruta_reproducir = NULL;
+    uint32_t registros = CAPTURA_REGISTROS_DEFECTO;
+    bool rapido = false;
+    bool adaptativo = false;
+    bool tiempo_real = false;
+    int prioridad = TR_PRIORIDAD_DEFECTO;
+    int cpu = -1;
+    unsigned long muestras_latencia = 0;
+    bool prioridades = false;
+    bool rpc = false;
+    bool negociar = false;
+    bool gpiomem = false;
+    const char* ruta_gpio = GPIO_DISPOSITIVO;
+    const char* ruta_socket = NULL;
+    const char* ruta_trazas = NULL;
+    int frag_datos = FRAG_DATOS_DEFECTO;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hay_valor = (i + 1 < argc);
+
+        if (arg == "--transporte" && hay_valor) {
+            g_transporte = buscarTransporte(argv[++i]);
+            if (g_transporte == NULL) {
+                printf("ERROR: transporte desconocido '%s'.\n", argv[i]);
+                mostrarUso(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--captura" && hay_valor) {
+            ruta_captura = argv[++i];
+        } else if (arg == "--registros" && hay_valor) {
+            registros = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--reproducir" && hay_valor) {
+            ruta_reproducir = argv[++i];
+        } else if (arg == "--rapido") {
+            rapido = true;
+        } else if (arg == "--adaptativo") {
+            adaptativo = true;
+        } else if (arg == "--prioridades") {
+            prioridades = true;
+        } else if (arg == "--conflacion") {
+            g_conflacion_activa = true;
+        } else if (arg == "--rpc") {
+            rpc = true;
+        } else if (arg == "--socket" && hay_valor) {
+            ruta_socket = argv[++i];
+        } else if (arg == "--negociar") {
+            negociar = true;
+        } else if (arg == "--enlaces" && hay_valor) {
+            int pines[ME_MAX_ENLACES];
+            int n = 0;
+            char* resto = argv[++i];
+            while (*resto != '\0' && n < ME_MAX_ENLACES) {
+                pines[n++] = (int)strtol(resto, &resto, 10);
+                if (*resto == ',') resto++;
+            }
+            multiEnlaceConfigurar(pines, n);
+            g_transporte = buscarTransporte("multienlace");
+        } else if (arg == "--gpiomem") {
+            gpiomem = true;
+        } else if (arg == "--gpiomem-archivo" && hay_valor) {
+            gpiomem = true;
+            ruta_gpio = argv[++i];
+        } else if (arg == "--spi-dispositivo" && hay_valor) {
+            g_spi.ruta = argv[++i];
+            g_transporte = buscarTransporte("spi");
+        } else if (arg == "--spi-reloj" && hay_valor) {
+            g_spi.reloj_nucleo_hz = atol(argv[++i]);
+        } else if (arg == "--spi-invertida") {
+            g_spi.invertida = true;
+        } else if (arg == "--destino" && hay_valor) {
+            g_reenvio_destino = atoi(argv[++i]);
+        } else if (arg == "--saltos" && hay_valor) {
+            g_reenvio_saltos = atoi(argv[++i]);
+        } else if (arg == "--trazas" && hay_valor) {
+            ruta_trazas = argv[++i];
+        } else if (arg == "--fragmento" && hay_valor) {
+            frag_datos = atoi(argv[++i]);
+        } else if (arg == "--tiempo-real") {
+            tiempo_real = true;
+        } else if (arg == "--prioridad" && hay_valor) {
+            prioridad = atoi(argv[++i]);
+        } else if (arg == "--cpu" && hay_valor) {
+            cpu = atoi(argv[++i]);
+        } else if (arg == "--medir-latencia" && hay_valor) {
+            muestras_latencia = strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--cache") {
+            cacheEmisorIniciar(g_cache_emisor);
+            g_cache_activa = true;
+        } else {
+            mostrarUso(argv[0]);
+            return 1;
+        }
+    }
+
+    if (prioridad < 1 || prioridad > 99) {
+        printf("ERROR: la prioridad debe estar entre 1 y 99.\n");
+        return 1;
+    }
+#ifndef TRAZAS
+    if (ruta_trazas != NULL) {
+        printf("Aviso: compilado sin TRAZAS, el archivo de trazas queda vacío (make clean; make TRAZAS=1).\n");
+    }
+#endif
+    if (g_reenvio_destino != -1 && (g_reenvio_destino < 1 || g_reenvio_destino > REENVIO_DIFUSION)) {
+        printf("ERROR: --destino debe estar entre 1 y %d.\n", REENVIO_DIFUSION);
+        return 1;
+    }
+    if (g_reenvio_saltos < 1 || g_reenvio_saltos > 255) {
+        printf("ERROR: --saltos debe estar entre 1 y 255.\n");
+        return 1;
+    }
+    if (g_spi.reloj_nucleo_hz <= 0) {
+        printf("ERROR: --spi-reloj debe ser positivo.\n");
+        return 1;
+    }
+    if (frag_datos != 0 && (frag_datos < FRAG_DATOS_MIN || frag_datos > FRAG_DATOS_MAX)) {
+        printf("ERROR: --fragmento debe ser 0 o estar entre %d y %d.\n", FRAG_DATOS_MIN, FRAG_DATOS_MAX);
+        return 1;
+    }
+
+    // Los mensajes del socket y los del menú llegan de hilos distintos:
+    // la línea la escribe solo el hilo de envío
+    if (ruta_socket != NULL) {
+        prioridades = true;
+    }
+    // La conflación pisa mensajes en las colas del hilo de envío
+    if (g_conflacion_activa) {
+        prioridades = true;
+    }
+
+    // Con --enlaces, los registros los escribe el hilo de temporización
+    if (gpiomem) {
+        if (!gpioAbrir(g_gpio, ruta_gpio)) {
+            return 1;
+        }
+        if (g_transporte == buscarTransporte("multienlace")) {
+            g_salida_multienlace = &SALIDA_GPIOMEM;
+        } else {
+            g_transporte = buscarTransporte("gpiomem");
+        }
+    }
+
+    // --- Modo de tiempo real ---
+    // Antes que nada: mlockall(MCL_FUTURE) cubre también lo que se reserve
+    // después, y los hilos que se creen heredan la prioridad y el core.
+    if (tiempo_real && !activarTiempoReal(prioridad, cpu)) {
+        return 1;
+    }
+
+    // --- Modo medición: sonda de latencia y termina ---
+    if (muestras_latencia > 0) {
+        resultadoLatencia r;
+        if (!medirLatencia(SONDA_PERIODO_US_DEFECTO, muestras_latencia, r)) {
+            return 1;
+        }
+        imprimirLatencia(r);
+        return 0;
+    }
+
     // --- Inicialización de Hardware (RPi) ---
-    
-    //Usamos 'wiringPiSetupGpio()' como depuramos.
-    // Esto nos permite referirnos a los pines por su número BCM (ej: TX_PIN 17).
-    if (wiringPiSetupGpio() == -1) {
-        printf("ERROR: No se pudo inicializar WiringPi. (¿Ejecutaste con sudo?)\n");
+    // El transporte configura el pin de transmisión y deja la línea en HIGH.
+    if (!g_transporte->iniciar(TX_PIN)) {
         return 1; // Salir con error
     }
-    
-    // Configura el pin de transmisión como SALIDA
-    pinMode(TX_PIN, OUTPUT);
-    // Pone la línea en HIGH (estado de reposo) inmediatamente.
-    // Esto evita que el receptor (ESP32) detecte ruido al inicio.
-    digitalWrite(TX_PIN, HIGH); 
 
+    // --- Modo reproducción: reenvía la captura y termina ---
+    if (ruta_reproducir != NULL) {
+        if (ruta_captura != NULL && strcmp(ruta_captura, ruta_reproducir) == 0) {
+            printf("ERROR: no se puede reproducir y capturar en el mismo archivo.\n");
+            return 1;
+        }
+        if (ruta_captura != NULL && !capturaAbrir(ruta_captura, registros)) {
+            return 1;
+        }
+        long enviados = reproducirCaptura(ruta_reproducir, rapido, g_transporte);
+        capturaCerrar();
+        return (enviados < 0) ? 1 : 0;
+    }
+
+    if (ruta_captura != NULL) {
+        if (!capturaAbrir(ruta_captura, registros)) {
+            return 1;
+        }
+        printf("Capturando frames enviados en %s\n", ruta_captura);
+    }
+
+    if (adaptativo && adaptativoIniciar(RX_RETORNO_PIN)) {
+        printf("Velocidad adaptativa: arrancando a %d bps\n", g_velocidad);
+    }
+
+    // Después de la caché y del adaptativo: el hilo de envío los usa
+    if (prioridades) {
+        envioIniciar(frag_datos, transmitirConContador);
+        printf("Prioridades: control > interactiva > masiva, fragmentos de %d bytes%s\n", frag_datos,
+               g_conflacion_activa ? ", con conflación (CMD 2, 3 y 5)" : "");
+    }
+
+    // El hilo lector queda como único lector de la línea de retorno
+    // (las respuestas del adaptativo también le llegan a él)
+    if (rpc) {
+        rpcIniciar(enviarPedidoRpc);
+        rpcLectorIniciar(RX_RETORNO_PIN);
+        printf("RPC: hasta %d pedidos en vuelo por la línea de retorno\n", RPC_EN_VUELO);
+    }
+
+    if (ruta_socket != NULL) {
+        if (!ingestaIniciar(ruta_socket, entregarIngesta)) {
+            return 1;
+        }
+        printf("Socket: aceptando lotes de mensajes en %s\n", ruta_socket);
+    }
+
+    // Con --adaptativo, la velocidad acordada queda como techo
+    if (negociar && !g_multienlace_activo) {
+        negociarEnlace(RX_RETORNO_PIN);
+    }
+
+    TRAZA_HILO("menú");
     std::string input_linea; // Variable para leer la entrada del usuario
     long opt = 0;
 
@@ -37,7 +330,7 @@ int main() {
         for (size_t i = 0; i < sizeof(menu)/sizeof(menu[0]); ++i) {
             puts(menu[i]);
         }
-        printf("Seleccione opción [0-9]: ");
+        printf("Seleccione opción [0-16]: ");
 
         // --- Lectura de Opción ---
         
@@ -64,11 +357,12 @@ int main() {
             puts("Entrada inválida."); 
             continue; 
         }
+        latenciaMarcarPedido(); // Las opciones sin más preguntas se piden acá
         // --- Fin Lectura ---
 
         // Validación de rango
-        if (opt < 0 || opt > 9) { 
-            puts("Fuera de rango (0-9)."); 
+        if (opt < 0 || opt > 16) { 
+            puts("Fuera de rango (0-16)."); 
             continue; 
         }
         // Opción de salida
@@ -79,6 +373,7 @@ int main() {
 
         // --- Despacho de Opción ---
         // Llama a la función correspondiente según el número.
+        TRAZA_AMBITO_VALOR("opcion", opt);
         switch ((int)opt) {
             case 1: opcion_1(); break;
             case 2: opcion_2(); break;
@@ -89,9 +384,24 @@ int main() {
             case 7: opcion_7(); break;
             case 8: opcion_8(); break;
             case 9: opcion_9(); break;
+            case 10: opcion_10(); break;
+            case 11: opcion_11(); break;
+            case 12: opcion_12(); break;
+            case 13: opcion_13(); break;
+            case 14: opcion_14(); break;
+            case 15: opcion_15(); break;
+            case 16: opcion_16(); break;
             default: puts("Opción no reconocida."); break; 
         }
     } // Fin del bucle 'for (;;)'
-    
+
+    ingestaDetener(); // Lo aceptado pasa a las colas de envío
+    envioDetener(); // Termina de transmitir lo que quedó en las colas
+    rpcDetener();
+    multiEnlaceDetener(); // Después de los que todavía pueden encolar
+    capturaCerrar(); // Deja la captura sincronizada en disco
+    if (ruta_trazas != NULL) {
+        volcarTrazas(ruta_trazas); // Con todos los hilos ya detenidos
+    }
     return 0; // Salir del programa
 }
\ No newline at end of file
@@ -0,0 +1,397 @@
+/**
+ * @file multiEnlace.cpp
+ * @brief Implementación del hilo de temporización de varios enlaces.
+ */
+
+#include "multiEnlace.h"
+#include "velocidadAdaptativa.h"
+#include "gpioMapeado.h"
+#include <wiringPi.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <deque>
+#include <queue>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/**
+ * @brief Un frame en la cola de un enlace.
+ */
+typedef struct
+{
+    protocolo proto;
+    int largo;
+} frameEnCola;
+
+/**
+ * @brief Estado de un enlace. 'bits' = 0: no hay frame en el aire.
+ */
+typedef struct
+{
+    int pin;
+    std::deque<frameEnCola> cola;
+    BYTE niveles[BITS_FRAME(FrameEstandar::LARGO_MAX, 2)];
+    int bits;               // Bits del frame en el aire
+    int largo;              // Bytes del frame en el aire
+    uint64_t inicio_us;     // Cuándo empezó su bit de inicio
+    int nivel;              // Nivel actual del pin
+    uint64_t libre_us;      // Fin del reposo tras el último frame
+    contadoresEnlace contadores;
+} enlaceTx;
+
+/**
+ * @brief Próximo evento de un enlace: en 'inicio_us + bit * bit_us' el pin
+ * toma niveles[bit] (o, con bit == bits, termina el frame).
+ */
+typedef struct
+{
+    uint64_t t_us;
+    int enlace;
+    int bit;
+} eventoEnlace;
+
+static bool operator>(const eventoEnlace& a, const eventoEnlace& b) {
+    return a.t_us > b.t_us;
+}
+
+bool g_multienlace_activo = false;
+
+static enlaceTx s_enlaces[ME_MAX_ENLACES];
+static int s_num_enlaces = 0;
+static uint64_t s_bit_us = 0;
+static const salidaGpio* s_salida = NULL;
+static contadoresMultiEnlace s_totales;
+
+static int s_pines_configurados[ME_MAX_ENLACES];
+static int s_num_configurados = 0;
+
+static std::mutex s_mutex;
+static std::condition_variable s_hay_frames;
+static std::condition_variable s_enlace_libre;
+static std::thread s_hilo;
+static bool s_detener = false;
+
+// --- Reloj de 64 bits ---
+// micros() de wiringPi es de 32 bits y da la vuelta cada ~71 minutos.
+
+static uint32_t s_micros_anterior = 0;
+static uint64_t s_reloj_us = 0;
+
+static uint64_t relojUs() {
+    uint32_t ahora = (uint32_t)micros();
+    s_reloj_us += (uint32_t)(ahora - s_micros_anterior);
+    s_micros_anterior = ahora;
+    return s_reloj_us;
+}
+
+static uint64_t cpuHiloNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// --- Salida "wiringpi" ---
+
+static bool iniciarSalidaWiringPi(const int* pines, int n) {
+    if (wiringPiSetupGpio() == -1) {
+        printf("ERROR: No se pudo inicializar WiringPi. (¿Ejecutaste con sudo?)\n");
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        pinMode(pines[i], OUTPUT);
+        digitalWrite(pines[i], HIGH);
+    }
+    return true;
+}
+
+static void escribirSalidaWiringPi(uint32_t poner, uint32_t borrar) {
+    // wiringPi no expone los registros GPSET0/GPCLR0: un pin por llamada
+    for (int pin = 0; pin < 32; pin++) {
+        if (poner & (1u << pin)) digitalWrite(pin, HIGH);
+        else if (borrar & (1u << pin)) digitalWrite(pin, LOW);
+    }
+}
+
+const salidaGpio SALIDA_WIRINGPI = {"wiringpi", iniciarSalidaWiringPi, escribirSalidaWiringPi};
+
+// --- Salida "gpiomem" ---
+
+static bool iniciarSalidaGpiomem(const int* pines, int n) {
+    if (g_gpio.registros == NULL && !gpioAbrir(g_gpio)) return false;
+    uint32_t mascara = 0;
+    for (int i = 0; i < n; i++) {
+        gpioModoSalida(g_gpio, pines[i]);
+        mascara |= 1u << pines[i];
+    }
+    gpioEscribir(g_gpio, mascara, 0);
+    return true;
+}
+
+static void escribirSalidaGpiomem(uint32_t poner, uint32_t borrar) {
+    gpioEscribir(g_gpio, poner, borrar);
+}
+
+const salidaGpio SALIDA_GPIOMEM = {"gpiomem", iniciarSalidaGpiomem, escribirSalidaGpiomem};
+
+const salidaGpio* g_salida_multienlace = &SALIDA_WIRINGPI;
+
+// --- Hilo de temporización ---
+
+/**
+ * @brief Primer bit desde 'desde' cuyo nivel difiere del actual (o el fin del frame).
+ */
+static int proximoCambio(const enlaceTx& e, int desde) {
+    int bit = desde;
+    while (bit < e.bits && e.niveles[bit] == e.nivel) bit++;
+    return bit;
+}
+
+/**
+ * @brief Saca el próximo frame de un enlace libre (con s_mutex tomado).
+ * @return true si hay un frame nuevo en el aire; 'ev' es su primer evento.
+ */
+static bool cargarFrame(enlaceTx& e, int idx, uint64_t ahora_us, eventoEnlace& ev) {
+    if (e.bits > 0 || e.cola.empty()) return false;
+    const frameEnCola& f = e.cola.front();
+    e.bits = nivelesFrame(f.proto, f.largo, e.niveles);
+    e.largo = f.largo;
+    e.cola.pop_front();
+
+    // Alineado a la grilla de bits: coincide con los flancos de los demás enlaces
+    uint64_t desde = (ahora_us > e.libre_us) ? ahora_us : e.libre_us;
+    e.inicio_us = (desde + s_bit_us - 1) / s_bit_us * s_bit_us;
+
+    ev.enlace = idx;
+    ev.bit = proximoCambio(e, 0);
+    ev.t_us = e.inicio_us + ev.bit * s_bit_us;
+    return true;
+}
+
+static void hiloTemporizacion() {
+    if (!s_salida->iniciar(s_pines_configurados, s_num_enlaces)) {
+        std::lock_guard<std::mutex> bloqueo(s_mutex);
+        g_multienlace_activo = false;
+        s_enlace_libre.notify_all();
+        return;
+    }
+    s_micros_anterior = (uint32_t)micros(); // El reloj es el de este hilo
+    s_reloj_us = 0;
+
+    std::priority_queue<eventoEnlace, std::vector<eventoEnlace>, std::greater<eventoEnlace> > eventos;
+    uint64_t cpu_inicio = cpuHiloNs();
+    bool hubo_flancos = false;
+    uint64_t primero_us = 0;
+    uint64_t ultimo_us = 0;
+
+    for (;;) {
+        // 1. Los enlaces libres toman su próximo frame
+        {
+            std::unique_lock<std::mutex> bloqueo(s_mutex);
+            uint64_t ahora = relojUs();
+            for (int i = 0; i < s_num_enlaces; i++) {
+                eventoEnlace ev;
+                if (cargarFrame(s_enlaces[i], i, ahora, ev)) eventos.push(ev);
+            }
+            if (eventos.empty()) {
+                if (s_detener) break;
+                s_hay_frames.wait(bloqueo);
+                continue;
+            }
+        }
+
+        // 2. Dormir hasta el próximo instante con algún evento
+        uint64_t t = eventos.top().t_us;
+        uint64_t ahora = relojUs();
+        if (t > ahora) {
+            delayMicroseconds((unsigned int)(t - ahora));
+            ahora = relojUs();
+        }
+        long atraso = (long)(ahora - t);
+
+        // 3. Todos los que vencieron van en la misma escritura
+        uint32_t poner = 0;
+        uint32_t borrar = 0;
+        int flancos = 0;
+        int terminados[ME_MAX_ENLACES];
+        int num_terminados = 0;
+        while (!eventos.empty() && eventos.top().t_us <= ahora) {
+            eventoEnlace ev = eventos.top();
+            eventos.pop();
+            enlaceTx& e = s_enlaces[ev.enlace];
+            if (ev.bit >= e.bits) {
+                e.libre_us = ev.t_us + ME_REPOSO_BITS * s_bit_us;
+                terminados[num_terminados++] = ev.enlace;
+                continue;
+            }
+            e.nivel = e.niveles[ev.bit];
+            if (e.nivel) poner |= 1u << e.pin;
+            else borrar |= 1u << e.pin;
+            flancos++;
+            ev.bit = proximoCambio(e, ev.bit + 1);
+            ev.t_us = e.inicio_us + ev.bit * s_bit_us;
+            eventos.push(ev);
+        }
+        if (flancos > 0) {
+            s_salida->escribir(poner, borrar);
+            if (!hubo_flancos) primero_us = t;
+            hubo_flancos = true;
+            ultimo_us = t;
+        }
+
+        std::lock_guard<std::mutex> bloqueo(s_mutex);
+        if (flancos > 0) {
+            s_totales.escrituras++;
+            s_totales.flancos += flancos;
+            if (atraso > (long)(s_bit_us / 4)) s_totales.atrasados++;
+            if (atraso > s_totales.atraso_max_us) s_totales.atraso_max_us = atraso;
+        }
+        for (int i = 0; i < num_terminados; i++) {
+            enlaceTx& e = s_enlaces[terminados[i]];
+            e.contadores.frames++;
+            e.contadores.bytes += e.largo;
+            e.bits = 0; // cargarFrame() le da el próximo en la siguiente vuelta
+        }
+        if (num_terminados > 0) s_enlace_libre.notify_all();
+    }
+
+    std::lock_guard<std::mutex> bloqueo(s_mutex);
+    s_totales.cpu_ns = cpuHiloNs() - cpu_inicio;
+    s_totales.activo_us = ultimo_us - primero_us;
+    s_enlace_libre.notify_all();
+}
+
+// --- API ---
+
+void multiEnlaceConfigurar(const int* pines, int n) {
+    s_num_configurados = (n < ME_MAX_ENLACES) ? n : ME_MAX_ENLACES;
+    memcpy(s_pines_configurados, pines, s_num_configurados * sizeof(int));
+}
+
+bool multiEnlaceIniciar(const int* pines, int n, int speed, const salidaGpio* salida) {
+    if (n < 1 || n > ME_MAX_ENLACES || speed <= 0) return false;
+    for (int i = 0; i < n; i++) {
+        if (pines[i] < 0 || pines[i] > 31) {
+            printf("ERROR: el pin %d no entra en la máscara de la salida (0..31).\n", pines[i]);
+            return false;
+        }
+    }
+    multiEnlaceConfigurar(pines, n);
+    s_num_enlaces = n;
+    s_bit_us = (uint64_t)(1000 / speed) * 1000; // Igual que el delay() de enviarFrame()
+    s_salida = salida;
+    memset(&s_totales, 0, sizeof(s_totales));
+    for (int i = 0; i < n; i++) {
+        enlaceTx& e = s_enlaces[i];
+        e.pin = pines[i];
+        e.cola.clear();
+        e.bits = 0;
+        e.nivel = HIGH;
+        e.libre_us = 0;
+        memset(&e.contadores, 0, sizeof(e.contadores));
+        e.contadores.pin = pines[i];
+    }
+    s_detener = false;
+    g_multienlace_activo = true;
+    s_hilo = std::thread(hiloTemporizacion);
+    return true;
+}
+
+bool multiEnlaceEncolar(int enlace, const protocolo& proto, int largo) {
+    std::lock_guard<std::mutex> bloqueo(s_mutex);
+    if (enlace < 0 || enlace >= s_num_enlaces) return false;
+    enlaceTx& e = s_enlaces[enlace];
+    if ((int)e.cola.size() >= ME_COLA_MAX) {
+        e.contadores.rechazados++;
+        return false;
+    }
+    frameEnCola f;
+    f.proto = proto;
+    f.largo = largo;
+    e.cola.push_back(f);
+    if ((int)e.cola.size() > e.contadores.cola_max) e.contadores.cola_max = e.cola.size();
+    s_hay_frames.notify_one();
+    return true;
+}
+
+static bool enlaceVacio(int i) {
+    return s_enlaces[i].cola.empty() && s_enlaces[i].bits == 0;
+}
+
+void multiEnlaceEsperar(int enlace) {
+    std::unique_lock<std::mutex> bloqueo(s_mutex);
+    s_enlace_libre.wait(bloqueo, [enlace] {
+        if (!g_multienlace_activo) return true;
+        if (enlace >= 0) return enlaceVacio(enlace);
+        for (int i = 0; i < s_num_enlaces; i++) {
+            if (!enlaceVacio(i)) return false;
+        }
+        return true;
+    });
+}
+
+void multiEnlaceDetener() {
+    if (!s_hilo.joinable()) return;
+    {
+        std::lock_guard<std::mutex> bloqueo(s_mutex);
+        s_detener = true;
+        s_hay_frames.notify_one();
+    }
+    s_hilo.join();
+    g_multienlace_activo = false;
+}
+
+int multiEnlaceCantidad() {
+    return s_num_enlaces;
+}
+
+contadoresEnlace multiEnlaceContadores(int enlace) {
+    std::lock_guard<std::mutex> bloqueo(s_mutex);
+    return s_enlaces[enlace].contadores;
+}
+
+contadoresMultiEnlace multiEnlaceTotales() {
+    std::lock_guard<std::mutex> bloqueo(s_mutex);
+    return s_totales;
+}
+
+// --- Transporte "multienlace" ---
+
+bool iniciarMultiEnlace(int pin) {
+    if (s_num_configurados == 0) {
+        multiEnlaceConfigurar(&pin, 1);
+    }
+    int pines[ME_MAX_ENLACES];
+    memcpy(pines, s_pines_configurados, s_num_configurados * sizeof(int));
+    return multiEnlaceIniciar(pines, s_num_configurados, g_velocidad, g_salida_multienlace);
+}
+
+bool enviarMultiEnlace(int pin, int speed, protocolo& proto, int largo) {
+    int enlace = 0;
+    for (int i = 0; i < s_num_enlaces; i++) {
+        if (s_enlaces[i].pin == pin) enlace = i;
+    }
+    while (!multiEnlaceEncolar(enlace, proto, largo)) {
+        if (!g_multienlace_activo) return false;
+        multiEnlaceEsperar(enlace); // Cola llena: que se vacíe un poco
+    }
+    multiEnlaceEsperar(enlace);
+    return true;
+}
+
+void multiEnlaceImprimir() {
+    contadoresMultiEnlace t = multiEnlaceTotales();
+    printf("--- Enlaces desde un hilo (%d a %d bps) ---\n", s_num_enlaces,
+           s_bit_us ? (int)(1000000 / s_bit_us) : 0);
+    for (int i = 0; i < s_num_enlaces; i++) {
+        contadoresEnlace c = multiEnlaceContadores(i);
+        printf("  GPIO %2d: %lu frames, %lu bytes, %lu rechazados (cola llena), cola máx %d\n",
+               c.pin, c.frames, c.bytes, c.rechazados, c.cola_max);
+    }
+    printf("Escrituras: %lu | Flancos: %lu (%.2f por escritura) | Atrasados > 1/4 bit: %lu (máx %ld us)\n",
+           t.escrituras, t.flancos, t.escrituras ? (double)t.flancos / t.escrituras : 0.0,
+           t.atrasados, t.atraso_max_us);
+}
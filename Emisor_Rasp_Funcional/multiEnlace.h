@@ -0,0 +1,148 @@
+/**
+ * @file multiEnlace.h
+ * @brief Varios enlaces (un GPIO y un receptor cada uno) desde un solo hilo.
+ * @details Con enviarFrame() cada enlace necesita su propio proceso, que
+ * pasa todo el tiempo dormido en un delay() por bit. Acá un único hilo de
+ * temporización lleva los flancos de todos los enlaces en una cola de
+ * eventos ordenada por tiempo: duerme hasta el próximo instante con algún
+ * flanco y escribe juntos todos los que vencen en ese instante (una sola
+ * escritura de set/clear en la salida GPIO).
+ *
+ * Los frames de cada enlace arrancan alineados a su grilla de bits
+ * (múltiplos de 1000/speed ms desde que arrancó el hilo): con la misma
+ * velocidad, los flancos de todos los enlaces caen en los mismos instantes
+ * y la cantidad de despertares no crece con la cantidad de enlaces.
+ *
+ * Cada enlace tiene su propia cola de frames y sus contadores.
+ */
+
+#ifndef MULTI_ENLACE_H
+#define MULTI_ENLACE_H
+
+#include "funcionesProtocolo.h"
+#include <stdint.h>
+
+/**
+ * @brief Enlaces como máximo (un bit de la máscara por pin BCM 0..31).
+ */
+#define ME_MAX_ENLACES 8
+
+/**
+ * @brief Frames pendientes por enlace. multiEnlaceEncolar() rechaza si está llena.
+ */
+#define ME_COLA_MAX 32
+
+/**
+ * @brief Reposo entre frames seguidos del mismo enlace: el receptor lee la
+ * paridad y el stop final hasta 3 bits después del último byte.
+ */
+#define ME_REPOSO_BITS 3
+
+/**
+ * @brief Salida GPIO del hilo de temporización.
+ */
+typedef struct
+{
+    const char* nombre;
+
+    /**
+     * @brief Configura los pines como salida en reposo (HIGH).
+     * @details Se llama desde el hilo de temporización, antes del primer flanco.
+     */
+    bool (*iniciar)(const int* pines, int n);
+
+    /**
+     * @brief Pone en HIGH los pines de 'poner' y en LOW los de 'borrar'
+     * (bit N = pin BCM N), todos en el mismo instante.
+     */
+    void (*escribir)(uint32_t poner, uint32_t borrar);
+} salidaGpio;
+
+/**
+ * @brief Salida con wiringPi: un digitalWrite() por pin de la máscara.
+ */
+extern const salidaGpio SALIDA_WIRINGPI;
+
+/**
+ * @brief Salida por los registros mapeados (gpioMapeado.h): un store en
+ * GPSET0 y otro en GPCLR0 por instante, sin importar cuántos pines cambian.
+ */
+extern const salidaGpio SALIDA_GPIOMEM;
+
+/**
+ * @brief Salida del transporte "multienlace" (SALIDA_WIRINGPI salvo con --gpiomem).
+ */
+extern const salidaGpio* g_salida_multienlace;
+
+/**
+ * @brief Contadores de un enlace.
+ */
+typedef struct
+{
+    int pin;
+    unsigned long frames;
+    unsigned long bytes;
+    unsigned long rechazados;   // Cola llena al encolar
+    int cola_max;
+} contadoresEnlace;
+
+/**
+ * @brief Contadores del hilo de temporización.
+ */
+typedef struct
+{
+    unsigned long escrituras;   // Escrituras en la salida (una por instante con flancos)
+    unsigned long flancos;      // Cambios de nivel, sumando todos los pines
+    unsigned long atrasados;    // Despertares más de 1/4 de bit tarde
+    long atraso_max_us;
+    uint64_t cpu_ns;            // CPU del hilo (CLOCK_THREAD_CPUTIME_ID)
+    uint64_t activo_us;         // Desde el primer flanco hasta el último
+} contadoresMultiEnlace;
+
+/**
+ * @brief Activo con --enlaces (o --transporte multienlace).
+ */
+extern bool g_multienlace_activo;
+
+/**
+ * @brief Pines de --enlaces antes de iniciar el transporte "multienlace".
+ * @details Si no se configuró ninguno, el transporte usa solo el pin del menú.
+ */
+void multiEnlaceConfigurar(const int* pines, int n);
+
+/**
+ * @brief Arranca el hilo de temporización con un enlace por pin.
+ * @param speed Velocidad de todos los enlaces (1000/speed ms por bit).
+ */
+bool multiEnlaceIniciar(const int* pines, int n, int speed, const salidaGpio* salida);
+
+/**
+ * @brief Encola un frame ya empaquetado en un enlace. No espera.
+ * @return false si la cola del enlace está llena.
+ */
+bool multiEnlaceEncolar(int enlace, const protocolo& proto, int largo);
+
+/**
+ * @brief Espera a que un enlace (o todos, con -1) termine lo encolado.
+ */
+void multiEnlaceEsperar(int enlace);
+
+/**
+ * @brief Transmite lo pendiente y detiene el hilo.
+ */
+void multiEnlaceDetener();
+
+int multiEnlaceCantidad();
+contadoresEnlace multiEnlaceContadores(int enlace);
+contadoresMultiEnlace multiEnlaceTotales();
+
+/**
+ * @brief Backend de transporte "multienlace" (ver transporte.h): el frame
+ * va a la cola del enlace de 'pin' (o al primero) y espera a que salga.
+ */
+bool iniciarMultiEnlace(int pin);
+bool enviarMultiEnlace(int pin, int speed, protocolo& proto, int largo);
+
+void multiEnlaceImprimir();
+
+#endif // MULTI_ENLACE_H
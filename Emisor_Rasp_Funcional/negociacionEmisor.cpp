@@ -0,0 +1,74 @@
+/**
+ * @file negociacionEmisor.cpp
+ * @brief Implementación de la negociación de los parámetros del enlace.
+ */
+
+#include "negociacionEmisor.h"
+#include "velocidadAdaptativa.h"
+#include <wiringPi.h>
+#include <stdio.h>
+#include <string.h>
+
+static unsigned long s_acuerdos = 0;
+static unsigned long s_sin_respuesta = 0;    // Receptores que no negocian (o respuesta perdida)
+static unsigned long s_verificaciones_fallidas = 0;
+
+static const char* nombreFcs(int fcs) {
+    return (fcs == NEG_FCS_CRC16) ? "CRC-16" : "conteo";
+}
+
+bool negociarEnlace(int pin_retorno, const CapacidadesEnlace& capacidades) {
+    enlacePrepararRetorno(pin_retorno);
+
+    protocolo proto;
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = CMD_ENLACE;
+    proto.data[0] = ENLACE_NEGOCIA;
+    proto.data[1] = enlaceProximaSecuencia();
+    escribirCapacidades(proto.data + 2, capacidades);
+    proto.lng = 2 + NEG_BYTES_CAPACIDADES;
+    enlaceEnviarControl(proto);
+
+    protocolo respuesta;
+    if (!enlaceEsperarRespuesta(ENLACE_ACUERDO, proto.data[1], respuesta) ||
+        respuesta.lng < 2 + NEG_BYTES_CONFIGURACION) {
+        s_sin_respuesta++;
+        printf("Negociación: el receptor no respondió, se sigue a %d bps.\n", g_velocidad);
+        return false;
+    }
+    ConfiguracionEnlace acuerdo = leerConfiguracion(respuesta.data + 2);
+    if (!configuracionValida(acuerdo, NUM_VELOCIDADES)) {
+        // El receptor ya la aplicó: con su prueba vuelve a la base
+        s_verificaciones_fallidas++;
+        enlaceResincronizar();
+        return false;
+    }
+
+    int velocidad_anterior = g_velocidad;
+    g_config_enlace = acuerdo;
+    adaptativoAcordar(acuerdo.idx_velocidad);
+    s_acuerdos++;
+    delay(NEG_SEPARACION_BITS * 1000 / velocidad_anterior);
+
+    // La primera consulta con la configuración nueva confirma el cambio en el receptor
+    int ok, idx_receptor, bits_parada, fcs;
+    if (!enlaceConsultar(ok, idx_receptor, bits_parada, fcs) || idx_receptor != acuerdo.idx_velocidad ||
+        bits_parada != acuerdo.bits_parada || fcs != acuerdo.fcs) {
+        s_verificaciones_fallidas++;
+        printf("Negociación: la configuración acordada no funciona, vuelta a la base.\n");
+        enlaceResincronizar();
+        return false;
+    }
+    printf("Negociación: %d bps, %d bits de parada, FCS %s, payload hasta %d bytes.\n", g_velocidad,
+           acuerdo.bits_parada, nombreFcs(acuerdo.fcs), acuerdo.lng_max);
+    return true;
+}
+
+void negociacionImprimir() {
+    printf("--- Configuración del enlace (CMD 10) ---\n");
+    printf("En uso: %d bps (techo %d bps), %d bits de parada, FCS %s, payload hasta %d bytes\n",
+           g_velocidad, velocidadDeEscalon(g_config_enlace.idx_velocidad), g_config_enlace.bits_parada,
+           nombreFcs(g_config_enlace.fcs), g_config_enlace.lng_max);
+    printf("Acuerdos: %lu | Sin respuesta: %lu | Verificaciones fallidas: %lu\n", s_acuerdos,
+           s_sin_respuesta, s_verificaciones_fallidas);
+}
@@ -0,0 +1,51 @@
+/**
+ * @file negociacionEmisor.h
+ * @brief Negociación de los parámetros del enlace con el receptor (CMD 10).
+ * @details Velocidad, bits de parada, FCS y payload máximo estaban fijos por
+ * separado en cada punta: con una diferencia los frames fallan sin aviso.
+ * Con --negociar (al arrancar) o con la opción 15, el emisor le manda al
+ * receptor lo que soporta y el receptor contesta con la mejor configuración
+ * común (ver Protocolo_Comun/negociacionEnlace.h). Las dos puntas cambian
+ * juntas después del ACUERDO y el emisor lo verifica con una CONSULTA con
+ * la configuración nueva. Si no llega el ACUERDO (un receptor que no
+ * negocia) todo sigue como estaba; si falla la verificación, las dos
+ * puntas vuelven a CONFIGURACION_BASE (el receptor, por su prueba de
+ * ENLACE_PRUEBA_MS o por el primer frame que falla).
+ *
+ * Lo acordado queda en g_config_enlace (funcionesProtocolo.h). La línea de
+ * retorno sigue con 2 bits de parada y el FCS por conteo; solo acompaña la
+ * velocidad.
+ */
+
+#ifndef NEGOCIACION_EMISOR_H
+#define NEGOCIACION_EMISOR_H
+
+#include "funcionesProtocolo.h"
+
+/**
+ * @brief Lo que soporta este emisor: las 8 velocidades de la escalera,
+ * de 1 a 4 bits de parada (enviarFrame()), los dos FCS y 63 bytes de payload.
+ */
+static constexpr CapacidadesEnlace CAPACIDADES_EMISOR = {
+    NEGOCIACION_VERSION, 0xFF, 0x1E, (1 << NEG_FCS_CONTEO) | (1 << NEG_FCS_CRC16), LARGO_DATA};
+
+/**
+ * @brief Bits de reposo entre el ACUERDO y la primera consulta: el receptor
+ * cambia de configuración recién cuando termina de enviar la respuesta.
+ */
+#define NEG_SEPARACION_BITS 3
+
+/**
+ * @brief Negocia con el receptor y, si hay acuerdo, lo aplica y lo verifica.
+ * @param pin_retorno Pin de la línea de retorno (se prepara si hace falta).
+ * @param capacidades Lo que se ofrece (CAPACIDADES_EMISOR, salvo pruebas).
+ * @return true si quedó en uso la configuración acordada.
+ */
+bool negociarEnlace(int pin_retorno, const CapacidadesEnlace& capacidades = CAPACIDADES_EMISOR);
+
+/**
+ * @brief Configuración en uso y resultado de las negociaciones.
+ */
+void negociacionImprimir();
+
+#endif // NEGOCIACION_EMISOR_H
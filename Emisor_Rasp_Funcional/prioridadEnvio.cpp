@@ -0,0 +1,358 @@
+/**
+ * @file prioridadEnvio.cpp
+ * @brief Implementación de las clases de prioridad y del hilo de envío.
+ */
+
+#include "prioridadEnvio.h"
+#include "funcionesProtocolo.h"
+#include "trazas.h"
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+/**
+ * @brief Clase de cada CMD (los que no figuran van como masivos).
+ */
+static const BYTE CLASE_POR_CMD[16] = {
+    PRIO_CONTROL,     // 0: mensaje de control
+    PRIO_INTERACTIVA, // 1: mensaje de prueba
+    PRIO_MASIVA,      // 2: texto al OLED
+    PRIO_INTERACTIVA, // 3: temperatura
+    PRIO_CONTROL,     // 4: toggle del LED
+    PRIO_CONTROL,     // 5: frecuencia del LED
+    PRIO_CONTROL,     // 6: pedir estadísticas
+    PRIO_MASIVA,      // 7: arreglo de temperaturas
+    PRIO_MASIVA,      // 8: telemetría
+    PRIO_MASIVA,      // 9: caché (se comprime al transmitir, no se encola)
+    PRIO_CONTROL,     // 10: control del enlace
+    PRIO_MASIVA,      // 11: fragmento (lo arma el hilo de envío, no se encola)
+    PRIO_CONTROL,     // 12: pedido RPC (se espera la respuesta)
+    PRIO_MASIVA, PRIO_MASIVA, PRIO_MASIVA,
+};
+
+static const char* NOMBRE_CLASE[NUM_PRIORIDADES] = {"control", "interactiva", "masiva"};
+
+/**
+ * @brief Clave de conflación de cada CMD.
+ */
+static const signed char CLAVE_POR_CMD[16] = {
+    CONF_SIN_CLAVE, CONF_SIN_CLAVE, // 0, 1
+    CONF_OLED,                      // 2: texto al OLED
+    CONF_OLED,                      // 3: temperatura (también reescribe el OLED)
+    CONF_SIN_CLAVE,                 // 4: toggle (dos seguidos se cancelan, no se pisan)
+    CONF_LED,                       // 5: frecuencia del LED
+    CONF_SIN_CLAVE, CONF_SIN_CLAVE, CONF_SIN_CLAVE, CONF_SIN_CLAVE, CONF_SIN_CLAVE,
+    CONF_SIN_CLAVE, CONF_SIN_CLAVE, CONF_SIN_CLAVE, CONF_SIN_CLAVE, CONF_SIN_CLAVE,
+};
+
+int clasePorCmd(int cmd) {
+    return CLASE_POR_CMD[cmd & 0x0F];
+}
+
+int claveConflacion(int cmd) {
+    return CLAVE_POR_CMD[cmd & 0x0F];
+}
+
+void prioridadesIniciar(colaPrioridades& c, int frag_datos, bool con_prioridad, cacheEmisor* cache) {
+    for (int i = 0; i <= COLA_CLAVES; i++) {
+        c.clases[i].pendientes.clear();
+        c.clases[i].en_curso = false;
+        c.clases[i].fragmento = 0;
+        c.clases[i].total = 0;
+        c.clases[i].secuencia = 0;
+    }
+    c.frag_datos = frag_datos;
+    c.con_prioridad = con_prioridad;
+    c.conflar = false;
+    for (int k = 0; k < NUM_CLAVES_CONF; k++) {
+        c.turno_clave[k] = 0;
+    }
+    c.turnos = 0;
+    c.turno_sin_clave = false;
+    c.cache = cache;
+    c.mensajes = 0;
+    c.fragmentos = 0;
+    c.conflados = 0;
+}
+
+/**
+ * @brief Cola en la que va un comando: COLA_CLAVES si tiene clave y hay
+ * conflación; si no, la de su clase, o la única (la masiva) sin prioridad.
+ */
+static int colaDe(const colaPrioridades& c, int cmd) {
+    if (c.conflar && claveConflacion(cmd) != CONF_SIN_CLAVE) return COLA_CLAVES;
+    return c.con_prioridad ? clasePorCmd(cmd) : PRIO_MASIVA;
+}
+
+/**
+ * @brief El pendiente con la clave de 'cmd' (a lo sumo hay uno), o false.
+ */
+static bool buscarClave(const colaPrioridades& c, int cmd, size_t& posicion) {
+    int clave = claveConflacion(cmd);
+    if (!c.conflar || clave == CONF_SIN_CLAVE) return false;
+    const std::deque<mensajeEnvio>& pendientes = c.clases[COLA_CLAVES].pendientes;
+    for (size_t j = 0; j < pendientes.size(); j++) {
+        if (pendientes[j].clave == clave) {
+            posicion = j;
+            return true;
+        }
+    }
+    return false;
+}
+
+void prioridadesEncolar(colaPrioridades& c, const protocolo& proto, uint64_t ahora_ns) {
+    mensajeEnvio m;
+    m.proto = proto;
+    m.clase = clasePorCmd(proto.cmd);
+    m.clave = claveConflacion(proto.cmd);
+    m.t_encolado_ns = ahora_ns;
+    std::deque<mensajeEnvio>& destino = c.clases[colaDe(c, proto.cmd)].pendientes;
+
+    size_t posicion;
+    if (buscarClave(c, proto.cmd, posicion)) {
+        c.conflados++;
+        destino[posicion] = m; // En su lugar: no vuelve al final de la cola
+        return;
+    }
+    destino.push_back(m);
+}
+
+bool prioridadesConflaria(const colaPrioridades& c, const protocolo& proto) {
+    size_t posicion;
+    return buscarClave(c, proto.cmd, posicion);
+}
+
+size_t prioridadesPendientes(const colaPrioridades& c, int cmd) {
+    const claseEnvio& clase = c.clases[colaDe(c, cmd)];
+    return clase.pendientes.size() + (clase.en_curso ? 1 : 0);
+}
+
+static bool tocaCache(const colaPrioridades& c, const protocolo& proto) {
+    return c.cache != NULL && (proto.cmd == CMD_CACHE || cacheEmisorEsCacheable(proto.cmd, proto.lng));
+}
+
+/**
+ * @brief Empieza el próximo mensaje de la clase: lo comprime con la caché
+ * (en el orden en que sale, igual que lo verá el receptor) y decide si va
+ * entero o en fragmentos.
+ */
+static void empezarMensaje(colaPrioridades& c, claseEnvio& clase) {
+    clase.actual = clase.pendientes.front();
+    clase.pendientes.pop_front();
+
+    protocolo comprimido;
+    if (c.cache != NULL && cacheEmisorComprimir(*c.cache, clase.actual.proto, comprimido)) {
+        clase.actual.proto = comprimido;
+    }
+
+    int lng = clase.actual.proto.lng;
+    clase.total = 1;
+    if (c.frag_datos > 0 && lng > c.frag_datos) {
+        clase.total = (lng + c.frag_datos - 1) / c.frag_datos;
+        clase.secuencia = (BYTE)((clase.secuencia + 1) & 0x03);
+    }
+    clase.fragmento = 0;
+    clase.en_curso = true;
+    c.mensajes++;
+    if (clase.actual.clave != CONF_SIN_CLAVE) {
+        c.turno_clave[clase.actual.clave] = ++c.turnos;
+    }
+}
+
+/**
+ * @brief Deja en curso un mensaje de COLA_CLAVES, si hay alguno que pueda salir.
+ * @details Sigue el que está a medio enviar; si no, empieza la clave que
+ * hace más que no sale.
+ */
+static bool claveLista(colaPrioridades& c, bool cache_a_medias) {
+    claseEnvio& claves = c.clases[COLA_CLAVES];
+    if (claves.en_curso) return true;
+    if (claves.pendientes.empty()) return false;
+
+    size_t elegido = 0;
+    for (size_t j = 1; j < claves.pendientes.size(); j++) {
+        if (c.turno_clave[claves.pendientes[j].clave] < c.turno_clave[claves.pendientes[elegido].clave]) {
+            elegido = j;
+        }
+    }
+    if (cache_a_medias && tocaCache(c, claves.pendientes[elegido].proto)) return false;
+    if (elegido != 0) {
+        mensajeEnvio m = claves.pendientes[elegido];
+        claves.pendientes.erase(claves.pendientes.begin() + elegido);
+        claves.pendientes.push_front(m);
+    }
+    empezarMensaje(c, claves);
+    return true;
+}
+
+/**
+ * @brief Arma el próximo frame del mensaje en curso de la cola 'cola' (entero o fragmento).
+ */
+static void armarFrame(colaPrioridades& c, int cola, unidadEnvio& u) {
+    claseEnvio& clase = c.clases[cola];
+    const protocolo& original = clase.actual.proto;
+    memset(&u.proto, 0, sizeof(protocolo));
+    if (clase.total == 1) {
+        u.proto.cmd = original.cmd;
+        u.proto.lng = original.lng;
+        memcpy(u.proto.data, original.data, original.lng);
+    } else {
+        int desde = clase.fragmento * c.frag_datos;
+        int largo = original.lng - desde;
+        if (largo > c.frag_datos) largo = c.frag_datos;
+        u.proto.cmd = CMD_FRAGMENTO;
+        u.proto.lng = (BYTE)(FRAG_CABECERA + largo);
+        u.proto.data[0] = (BYTE)((clase.secuencia << 6) | (cola << 4) | (original.cmd & 0x0F));
+        u.proto.data[1] = (BYTE)((clase.fragmento << 4) | (clase.total - 1));
+        memcpy(u.proto.data + FRAG_CABECERA, original.data + desde, largo);
+        c.fragmentos++;
+    }
+    u.largo = empaquetar(u.proto);
+    u.proto.t_pedido_ns = original.t_pedido_ns; // Cada fragmento lleva los sellos del mensaje
+    u.proto.t_encolado_ns = original.t_encolado_ns;
+    u.clase = clase.actual.clase;
+    u.t_encolado_ns = clase.actual.t_encolado_ns;
+
+    clase.fragmento++;
+    u.ultimo = (clase.fragmento >= clase.total);
+    if (u.ultimo) clase.en_curso = false;
+    // Un mensaje con clave que termina le deja el turno a un frame sin clave
+    c.turno_sin_clave = (cola == COLA_CLAVES) && u.ultimo;
+}
+
+bool prioridadesSiguiente(colaPrioridades& c, unidadEnvio& u) {
+    // Con caché, un mensaje que la toca no se mete en medio de otro que
+    // también la toca: el receptor lo insertaría antes que el espejo.
+    bool cache_a_medias = false;
+    for (int i = 0; i <= COLA_CLAVES; i++) {
+        const claseEnvio& clase = c.clases[i];
+        if (clase.en_curso && clase.fragmento > 0 && tocaCache(c, clase.actual.proto)) cache_a_medias = true;
+    }
+
+    // Los valores con clave salen apenas termina lo que está en la línea,
+    // salvo el frame sin clave que se ganó el turno el último que terminó
+    if (c.conflar && !c.turno_sin_clave && claveLista(c, cache_a_medias)) {
+        armarFrame(c, COLA_CLAVES, u);
+        return true;
+    }
+
+    for (int i = 0; i < NUM_PRIORIDADES; i++) {
+        claseEnvio& clase = c.clases[i];
+        if (!clase.en_curso) {
+            if (clase.pendientes.empty()) continue;
+            if (cache_a_medias && tocaCache(c, clase.pendientes.front().proto)) continue;
+            empezarMensaje(c, clase);
+        }
+        armarFrame(c, i, u);
+        return true;
+    }
+
+    // Nada sin clave esperando: el turno vuelve a las claves
+    if (c.conflar && claveLista(c, cache_a_medias)) {
+        armarFrame(c, COLA_CLAVES, u);
+        return true;
+    }
+    return false;
+}
+
+// --- Envío asíncrono ---
+
+bool g_prioridades_activas = false;
+bool g_conflacion_activa = false;
+histogramaNs g_latencia_clase[NUM_PRIORIDADES];
+
+static colaPrioridades s_cola;
+static std::mutex s_mutex;
+static std::condition_variable s_hay_mensajes;
+static std::condition_variable s_hay_lugar;
+static std::thread s_hilo;
+static bool s_detener = false;
+static void (*s_transmitir)(protocolo& proto, int largo) = NULL;
+
+static uint64_t ahoraNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Hilo de envío: transmite de a un frame y vuelve a elegir la clase.
+ */
+static void hiloEnvio() {
+    TRAZA_HILO("envío");
+    for (;;) {
+        unidadEnvio u;
+        {
+            std::unique_lock<std::mutex> bloqueo(s_mutex);
+            while (!prioridadesSiguiente(s_cola, u)) {
+                if (s_detener) return;
+                s_hay_mensajes.wait(bloqueo);
+            }
+        }
+        s_hay_lugar.notify_all();
+
+        {
+            TRAZA_AMBITO_VALOR("transmitir", u.clase);
+            s_transmitir(u.proto, u.largo);
+        }
+        if (u.ultimo) {
+            histogramaRegistrar(g_latencia_clase[u.clase], ahoraNs() - u.t_encolado_ns);
+        }
+    }
+}
+
+void envioIniciar(int frag_datos, void (*transmitir)(protocolo& proto, int largo)) {
+    prioridadesIniciar(s_cola, frag_datos, true, g_cache_activa ? &g_cache_emisor : NULL);
+    s_cola.conflar = g_conflacion_activa;
+    for (int i = 0; i < NUM_PRIORIDADES; i++) {
+        histogramaReiniciar(g_latencia_clase[i]);
+    }
+    s_transmitir = transmitir;
+    s_detener = false;
+    s_hilo = std::thread(hiloEnvio);
+    g_prioridades_activas = true;
+}
+
+void envioEncolar(const protocolo& proto) {
+    TRAZA_AMBITO_VALOR("envioEncolar", proto.cmd); // Incluye la espera por lugar en la cola
+    std::unique_lock<std::mutex> bloqueo(s_mutex);
+    // Un valor que pisa a otro pendiente no ocupa lugar: no espera
+    while (!prioridadesConflaria(s_cola, proto) && prioridadesPendientes(s_cola, proto.cmd) >= PRIO_COLA_MAX) {
+        s_hay_lugar.wait(bloqueo); // Ej: la telemetría produce más rápido que la línea
+    }
+    prioridadesEncolar(s_cola, proto, ahoraNs());
+    s_hay_mensajes.notify_one();
+}
+
+void envioDetener() {
+    if (!g_prioridades_activas) return;
+    {
+        std::lock_guard<std::mutex> bloqueo(s_mutex);
+        s_detener = true;
+    }
+    s_hay_mensajes.notify_one();
+    s_hilo.join(); // Sale cuando ya no queda nada por transmitir
+    g_prioridades_activas = false;
+}
+
+void prioridadesImprimir() {
+    printf("--- Prioridades (fragmentos de %d bytes) ---\n", s_cola.frag_datos);
+    {
+        std::lock_guard<std::mutex> bloqueo(s_mutex);
+        printf("Mensajes: %lu | Fragmentos CMD 11: %lu | Pisados por conflación: %lu | En cola: %zu/%zu/%zu + %zu con clave\n",
+               s_cola.mensajes, s_cola.fragmentos, s_cola.conflados,
+               s_cola.clases[PRIO_CONTROL].pendientes.size(),
+               s_cola.clases[PRIO_INTERACTIVA].pendientes.size(),
+               s_cola.clases[PRIO_MASIVA].pendientes.size(),
+               s_cola.clases[COLA_CLAVES].pendientes.size());
+    }
+    for (int i = 0; i < NUM_PRIORIDADES; i++) {
+        resumenHistograma r;
+        histogramaResumir(g_latencia_clase[i], r);
+        if (r.total == 0) continue;
+        printf("  %-12s %6llu mensajes  p50 %8.1f s  p99 %8.1f s  máx %8.1f s\n", NOMBRE_CLASE[i],
+               (unsigned long long)r.total, r.p50_ns / 1e9, r.p99_ns / 1e9, r.maximo_ns / 1e9);
+    }
+}
@@ -0,0 +1,229 @@
+/**
+ * @file prioridadEnvio.h
+ * @brief Clases de prioridad en el envío y fragmentación de payloads largos (CMD 11).
+ * @details Con --prioridades el menú no transmite: encola el mensaje en su
+ * clase (control, interactiva o masiva) y un hilo de envío lo transmite.
+ * Los payloads de más de 'frag_datos' bytes se parten en fragmentos:
+ *
+ *   [sec << 6 | flujo << 4 | cmd original] [índice << 4 | total - 1] [datos...]
+ *
+ * Antes de cada frame el hilo elige la clase más alta con algo pendiente,
+ * así un comando de control espera como mucho UN fragmento (lo que esté
+ * en el aire) en lugar de un frame completo de 63 bytes. Cada clase usa su
+ * propio flujo y tiene a lo sumo un mensaje a medio enviar, que el
+ * receptor reensambla aparte (Receptor_Esp32/reensambleFrames.h). 'sec'
+ * numera los mensajes partidos de cada flujo (2 bits) para no pegar
+ * fragmentos de dos mensajes distintos cuando se pierden frames.
+ *
+ * Con la caché (CMD 9) activa, un mensaje que toca la caché no interrumpe
+ * a otro a medio enviar: el espejo del emisor y la caché del receptor
+ * tienen que ver las inserciones en el mismo orden.
+ *
+ * Con conflación (--conflacion), los comandos que fijan un estado (el
+ * texto del OLED, la temperatura, la frecuencia del LED) tienen una clave
+ * y van a una cola propia (COLA_CLAVES, con su flujo de fragmentos): un
+ * valor nuevo reemplaza en su lugar al pendiente de la misma clave que
+ * todavía no empezó a salir, así la línea lleva solo el último y la cola
+ * no pasa de una entrada por clave. Esa cola va antes que las clases: un
+ * valor nuevo sale apenas termina lo que está en la línea. El que está
+ * saliendo (o a medio enviar en fragmentos) no se toca: el receptor ya lo
+ * está reensamblando, y cortarlo dejaría sin terminar nunca a una clave
+ * que cambia más rápido que la línea. Entre las claves sale primero la que
+ * hace más que no sale, y después de cada mensaje con clave va un frame
+ * sin clave si hay alguno esperando: un estado que cambia sin parar no
+ * deja sin turno a los comandos de control.
+ */
+
+#ifndef PRIORIDAD_ENVIO_H
+#define PRIORIDAD_ENVIO_H
+
+#include "structProtocolo.h"
+#include "cacheEmisor.h"
+#include "histogramaFlancos.h"
+#include <stdint.h>
+#include <deque>
+
+/**
+ * @brief Comando de los fragmentos.
+ */
+#define CMD_FRAGMENTO 11
+
+/**
+ * @brief Clases de prioridad, de la más urgente a la menos urgente.
+ * @details El número de clase es también el flujo de sus fragmentos.
+ */
+#define PRIO_CONTROL 0      // CMD 0, 4, 5, 6, 10, 12: acciones cortas y pedidos
+#define PRIO_INTERACTIVA 1  // CMD 1, 3: mensajes de prueba, temperatura suelta
+#define PRIO_MASIVA 2       // CMD 2, 7, 8: texto del OLED, arreglo, telemetría
+#define NUM_PRIORIDADES 3
+
+/**
+ * @brief Cola de los mensajes con clave (con conflación), después de las clases.
+ * @details Es también su flujo de fragmentos (el receptor tiene FRAG_FLUJOS = 4).
+ */
+#define COLA_CLAVES NUM_PRIORIDADES
+
+/**
+ * @brief Claves de conflación: los comandos con la misma clave se pisan.
+ * @details CMD 2 y CMD 3 comparten la del OLED porque los dos lo
+ * reescriben entero: si un texto reemplazara solo a otro texto, una
+ * temperatura vieja encolada en el medio quedaría en pantalla al final.
+ */
+#define CONF_SIN_CLAVE -1   // Cada mensaje sale (acciones, pedidos, lotes)
+#define CONF_OLED 0         // CMD 2 y 3
+#define CONF_LED 1          // CMD 5: frecuencia del LED
+#define NUM_CLAVES_CONF 2
+
+/**
+ * @brief Bytes de cabecera de cada fragmento (flujo/cmd e índice/total).
+ */
+#define FRAG_CABECERA 2
+
+/**
+ * @brief Datos por fragmento por defecto (--fragmento N).
+ * @details 16 bytes = frames de 22 bytes: un control espera ~1/3 de un
+ * frame completo y un payload de 63 bytes ocupa 88 bytes en lugar de 67.
+ */
+#define FRAG_DATOS_DEFECTO 16
+
+/**
+ * @brief Mínimo de datos por fragmento: con 4, 63 bytes son 16 fragmentos
+ * (el índice ocupa 4 bits).
+ */
+#define FRAG_DATOS_MIN 4
+#define FRAG_DATOS_MAX (LARGO_DATA - FRAG_CABECERA)
+
+/**
+ * @brief Mensajes pendientes por clase. Encolar espera si la clase está llena.
+ */
+#define PRIO_COLA_MAX 8
+
+/**
+ * @brief Un mensaje encolado, sin empaquetar.
+ */
+typedef struct
+{
+    protocolo proto;
+    int clase;                 // Según el CMD original (la caché lo puede cambiar)
+    int clave;                 // De conflación, también según el CMD original
+    uint64_t t_encolado_ns;
+} mensajeEnvio;
+
+/**
+ * @brief Una clase: sus mensajes pendientes y el que está a medio enviar.
+ */
+typedef struct
+{
+    std::deque<mensajeEnvio> pendientes;
+    mensajeEnvio actual;       // Ya comprimido por la caché si correspondía
+    bool en_curso;
+    int fragmento;             // Próximo fragmento de 'actual'
+    int total;                 // Fragmentos de 'actual' (1 = va entero)
+    BYTE secuencia;            // Mensajes partidos de este flujo (2 bits)
+} claseEnvio;
+
+/**
+ * @brief Las colas de todas las clases (sin locks: ver envioIniciar()).
+ */
+typedef struct
+{
+    claseEnvio clases[NUM_PRIORIDADES + 1]; // + COLA_CLAVES
+    int frag_datos;            // 0 = no fragmentar
+    bool con_prioridad;        // false = una sola cola FIFO, como sin --prioridades
+    bool conflar;              // Los valores nuevos pisan a los pendientes de su clave
+    unsigned long turno_clave[NUM_CLAVES_CONF]; // Cuándo empezó a salir el último de cada clave
+    unsigned long turnos;      // Mensajes con clave empezados
+    bool turno_sin_clave;      // Terminó uno con clave: sigue un frame sin clave, si hay
+    cacheEmisor* cache;        // NULL = sin caché
+
+    unsigned long mensajes;
+    unsigned long fragmentos;
+    unsigned long conflados;   // Valores pisados por uno más nuevo sin llegar a salir
+} colaPrioridades;
+
+/**
+ * @brief Lo que sale por la línea: un frame empaquetado (entero o fragmento).
+ */
+typedef struct
+{
+    protocolo proto;
+    int largo;
+    int clase;
+    bool ultimo;               // Termina su mensaje
+    uint64_t t_encolado_ns;    // Del mensaje al que pertenece
+} unidadEnvio;
+
+/**
+ * @brief Clase de un comando.
+ */
+int clasePorCmd(int cmd);
+
+/**
+ * @brief Clave de conflación de un comando (CONF_SIN_CLAVE si no tiene).
+ */
+int claveConflacion(int cmd);
+
+/**
+ * @brief Deja las colas vacías y sin conflación ('conflar' se activa después).
+ */
+void prioridadesIniciar(colaPrioridades& c, int frag_datos, bool con_prioridad, cacheEmisor* cache);
+
+/**
+ * @brief Encola un mensaje en su clase (o en la cola única sin prioridad).
+ * @details Con 'conflar', los que tienen clave van a COLA_CLAVES y, si hay
+ * uno pendiente de la misma clave, lo reemplazan en su lugar.
+ */
+void prioridadesEncolar(colaPrioridades& c, const protocolo& proto, uint64_t ahora_ns);
+
+/**
+ * @brief true si encolar 'proto' pisaría a uno pendiente (no ocupa lugar nuevo).
+ */
+bool prioridadesConflaria(const colaPrioridades& c, const protocolo& proto);
+
+/**
+ * @brief Mensajes encolados en la clase de 'cmd', contando el que está en curso.
+ */
+size_t prioridadesPendientes(const colaPrioridades& c, int cmd);
+
+/**
+ * @brief Arma el próximo frame a transmitir.
+ * @return false si no hay nada pendiente.
+ */
+bool prioridadesSiguiente(colaPrioridades& c, unidadEnvio& u);
+
+// --- Envío asíncrono (--prioridades) ---
+
+/**
+ * @brief Activado con --prioridades.
+ */
+extern bool g_prioridades_activas;
+
+/**
+ * @brief Activado con --conflacion (antes de envioIniciar()).
+ */
+extern bool g_conflacion_activa;
+
+/**
+ * @brief Latencia de cada clase: de encolar a terminar de transmitir el mensaje.
+ */
+extern histogramaNs g_latencia_clase[NUM_PRIORIDADES];
+
+/**
+ * @brief Arranca el hilo de envío.
+ * @param transmitir Envía un frame empaquetado (corre en el hilo de envío).
+ */
+void envioIniciar(int frag_datos, void (*transmitir)(protocolo& proto, int largo));
+
+/**
+ * @brief Encola un mensaje y vuelve enseguida (espera si su clase está llena).
+ */
+void envioEncolar(const protocolo& proto);
+
+/**
+ * @brief Espera a que se transmita todo lo encolado y detiene el hilo.
+ */
+void envioDetener();
+
+void prioridadesImprimir();
+
+#endif // PRIORIDAD_ENVIO_H
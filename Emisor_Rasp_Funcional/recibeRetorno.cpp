@@ -0,0 +1,90 @@
+/**
+ * @file recibeRetorno.cpp
+ * @brief Implementación de la recepción por la línea de retorno.
+ * @details Misma lógica que recibirFrame() del receptor (muestreo en el
+ * centro de cada bit), pero con timeouts: la RPi no puede quedarse
+ * bloqueada si la ESP32 no responde.
+ */
+
+#include "recibeRetorno.h"
+#include "funcionesProtocolo.h"
+#include <wiringPi.h>
+
+void iniciarRecepcionRetorno(int pin) {
+    pinMode(pin, INPUT);
+    pullUpDnControl(pin, PUD_UP);
+}
+
+/**
+ * @brief Espera un bit de inicio hasta 'timeout_ms'.
+ */
+static bool esperarInicio(int pin, unsigned long timeout_ms) {
+    unsigned long inicio = millis();
+    while (digitalRead(pin) == HIGH) {
+        if (millis() - inicio > timeout_ms) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Lee un byte ya detectado su bit de inicio.
+ * @return Cantidad de bits '1' (para la paridad) o -1 si fallan los stop bits.
+ */
+static int leerByte(int pin, unsigned long msTime, BYTE* byte) {
+    *byte = 0;
+    int unos = 0;
+
+    delay(msTime / 2); // Centro del bit de inicio
+    if (digitalRead(pin) == HIGH) return -1;
+    delay(msTime);
+
+    for (int i = 0; i < 8; i++) {
+        if (digitalRead(pin)) {
+            *byte |= (1 << i);
+            unos++;
+        }
+        delay(msTime);
+    }
+
+    if (digitalRead(pin) == LOW) return -1; // Primer bit de parada
+    delay(msTime);
+    if (digitalRead(pin) == LOW) return -1; // Segundo bit de parada
+    return unos;
+}
+
+bool recibirRetorno(int pin, int speed, protocolo& proto, unsigned long timeout_ms) {
+    memset(&proto, 0, sizeof(protocolo));
+    unsigned long msTime = 1000 / speed;
+    int paridad = 0;
+    int total = 2; // cmd + lng, después se suma el resto
+
+    for (int j = 0; j < total; j++) {
+        // Entre bytes solo se esperan unos pocos bits de reposo
+        if (!esperarInicio(pin, (j == 0) ? timeout_ms : msTime * 4)) return false;
+        int unos = leerByte(pin, msTime, &proto.frame[j]);
+        if (unos < 0) return false;
+        paridad += unos;
+
+        if (j == 1) {
+            proto.cmd = FrameEstandar::cmdDe(proto.frame);
+            proto.lng = FrameEstandar::lngDe(proto.frame);
+            total = FrameEstandar::largo(proto.lng);
+        }
+    }
+
+    // Bit de paridad del frame: LOW = par. Si la línea sigue en HIGH
+    // 1.5 bits, la paridad es impar.
+    unsigned long inicio = millis();
+    while (digitalRead(pin) == HIGH && millis() - inicio <= msTime * 1.5);
+    delay(msTime / 2);
+    bool impar = digitalRead(pin);
+    if (impar != (paridad % 2 != 0)) return false;
+
+    for (int i = 0; i < proto.lng; i++) {
+        proto.data[i] = proto.frame[i + 2];
+    }
+    proto.fcs = FrameEstandar::fcsEscrito(proto.frame, proto.lng);
+    return FrameEstandar::fcsValido(proto.frame, proto.lng);
+}
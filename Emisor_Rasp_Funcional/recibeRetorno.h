@@ -0,0 +1,26 @@
+/**
+ * @file recibeRetorno.h
+ * @brief Recepción de la línea de retorno (ESP32 -> RPi).
+ * @details La ESP32 responde por un segundo cable con el mismo formato de
+ * frame que la línea de ida. Lo usa el control adaptativo de velocidad
+ * para recibir las confirmaciones y los reportes del receptor.
+ */
+
+#ifndef RECIBE_RETORNO_H
+#define RECIBE_RETORNO_H
+
+#include "structProtocolo.h"
+
+/**
+ * @brief Configura el pin de retorno como entrada con pull-up (reposo = HIGH).
+ */
+void iniciarRecepcionRetorno(int pin);
+
+/**
+ * @brief Espera y recibe un frame por la línea de retorno.
+ * @param timeout_ms Tiempo máximo de espera del primer bit de inicio.
+ * @return true si llegó un frame completo con stop bits, paridad y FCS correctos.
+ */
+bool recibirRetorno(int pin, int speed, protocolo& proto, unsigned long timeout_ms);
+
+#endif // RECIBE_RETORNO_H
@@ -0,0 +1,219 @@
+/**
+ * @file registroCaptura.cpp
+ * @brief Implementación del registro de capturas mapeado en memoria y su reproducción.
+ */
+
+#include "registroCaptura.h"
+#include "funcionesProtocolo.h" // g_config_enlace
+#include <wiringPi.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Un registro por línea de caché y media: nunca cruza más de 2 líneas.
+static_assert(sizeof(registroFrame) == 96, "registroFrame debe medir 96 bytes");
+
+static cabeceraCaptura* s_cabecera = NULL;
+static registroFrame* s_registros = NULL;
+static size_t s_tam_mapa = 0;
+
+static size_t tamArchivo(uint32_t capacidad) {
+    return CAPTURA_TAM_CABECERA + (size_t)capacidad * sizeof(registroFrame);
+}
+
+uint64_t capturaAhoraNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+bool capturaAbrir(const char* ruta, uint32_t capacidad) {
+    if (capacidad == 0) return false;
+
+    int fd = open(ruta, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror("capturaAbrir: open");
+        return false;
+    }
+
+    // Si el archivo no es una captura compatible, se reinicia
+    cabeceraCaptura previa;
+    memset(&previa, 0, sizeof(previa));
+    bool continuar = (pread(fd, &previa, sizeof(previa), 0) == (ssize_t)sizeof(previa)) &&
+                     previa.magia == CAPTURA_MAGIA && previa.version == CAPTURA_VERSION &&
+                     previa.tam_registro == sizeof(registroFrame) && previa.capacidad == capacidad;
+
+    size_t tam = tamArchivo(capacidad);
+    if (ftruncate(fd, tam) != 0) {
+        perror("capturaAbrir: ftruncate");
+        close(fd);
+        return false;
+    }
+
+    void* mapa = mmap(NULL, tam, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // El mapeo sigue vivo sin el descriptor
+    if (mapa == MAP_FAILED) {
+        perror("capturaAbrir: mmap");
+        return false;
+    }
+
+    s_cabecera = (cabeceraCaptura*)mapa;
+    s_registros = (registroFrame*)((BYTE*)mapa + CAPTURA_TAM_CABECERA);
+    s_tam_mapa = tam;
+
+    if (!continuar) {
+        memset(mapa, 0, tam);
+        s_cabecera->magia = CAPTURA_MAGIA;
+        s_cabecera->version = CAPTURA_VERSION;
+        s_cabecera->tam_registro = sizeof(registroFrame);
+        s_cabecera->capacidad = capacidad;
+        s_cabecera->escritos = 0;
+    }
+
+    // Se tocan todas las páginas ahora para que el primer envío
+    // no pague los fallos de página.
+    madvise(mapa, tam, MADV_WILLNEED);
+    for (size_t i = 0; i < tam; i += 4096) {
+        ((volatile BYTE*)mapa)[i] = ((volatile BYTE*)mapa)[i];
+    }
+    return true;
+}
+
+void capturaCerrar() {
+    if (s_cabecera == NULL) return;
+    msync(s_cabecera, s_tam_mapa, MS_SYNC);
+    munmap(s_cabecera, s_tam_mapa);
+    s_cabecera = NULL;
+    s_registros = NULL;
+    s_tam_mapa = 0;
+}
+
+bool capturaActiva() {
+    return s_cabecera != NULL;
+}
+
+void capturaRegistrar(const protocolo& proto, int largo, int velocidad, const ConfiguracionEnlace& config,
+                      uint64_t t_inicio_ns, uint32_t duracion_us, BYTE resultado) {
+    if (s_cabecera == NULL) return;
+
+    uint64_t n = s_cabecera->escritos;
+    registroFrame& r = s_registros[n % s_cabecera->capacidad];
+
+    // 'secuencia' en 0 mientras se escribe: un lector (o un corte de
+    // luz a mitad de camino) nunca ve un registro a medio armar como válido.
+    __atomic_store_n(&r.secuencia, 0u, __ATOMIC_RELAXED);
+    r.t_ns = t_inicio_ns;
+    r.duracion_us = duracion_us;
+    r.cmd = proto.cmd;
+    r.lng = proto.lng;
+    r.largo = (BYTE)largo;
+    r.resultado = resultado;
+    memcpy(r.frame, proto.frame, largo);
+    r.velocidad = (uint16_t)velocidad;
+    r.bits_parada = config.bits_parada;
+    r.fcs = config.fcs;
+    __atomic_store_n(&r.secuencia, (uint32_t)(n + 1), __ATOMIC_RELEASE);
+    __atomic_store_n(&s_cabecera->escritos, n + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Duerme hasta el instante monotónico 'objetivo_ns'.
+ */
+static void dormirHasta(uint64_t objetivo_ns) {
+    struct timespec ts;
+    ts.tv_sec = objetivo_ns / 1000000000ull;
+    ts.tv_nsec = objetivo_ns % 1000000000ull;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+        // Interrumpido por una señal: se vuelve a dormir
+    }
+}
+
+long reproducirCaptura(const char* ruta, bool rapido, const transporte* trans) {
+    int fd = open(ruta, O_RDONLY);
+    if (fd < 0) {
+        perror("reproducirCaptura: open");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < CAPTURA_TAM_CABECERA) {
+        close(fd);
+        printf("Error: %s no es una captura.\n", ruta);
+        return -1;
+    }
+    const BYTE* mapa = (const BYTE*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapa == MAP_FAILED) {
+        perror("reproducirCaptura: mmap");
+        return -1;
+    }
+
+    const cabeceraCaptura* cab = (const cabeceraCaptura*)mapa;
+    if (cab->magia != CAPTURA_MAGIA || cab->version != CAPTURA_VERSION ||
+        cab->tam_registro != sizeof(registroFrame) ||
+        (size_t)st.st_size < tamArchivo(cab->capacidad)) {
+        munmap((void*)mapa, st.st_size);
+        printf("Error: %s no es una captura compatible.\n", ruta);
+        return -1;
+    }
+
+    const registroFrame* regs = (const registroFrame*)(mapa + CAPTURA_TAM_CABECERA);
+    uint64_t escritos = cab->escritos;
+    uint64_t primero = (escritos > cab->capacidad) ? escritos - cab->capacidad : 0;
+
+    // El kernel puede leer por adelantado: se recorre en orden
+    madvise((void*)mapa, st.st_size, MADV_SEQUENTIAL);
+
+    printf("Reproduciendo %llu frames de %s (%s)...\n",
+           (unsigned long long)(escritos - primero), ruta, rapido ? "máxima velocidad" : "tiempos originales");
+
+    protocolo proto;
+    long enviados = 0;
+    long cambios = 0;
+    ConfiguracionEnlace config_previa = g_config_enlace;
+    int velocidad_anterior = 0;
+    uint64_t t_captura0 = 0;
+    uint64_t t_inicio = capturaAhoraNs();
+
+    for (uint64_t n = primero; n < escritos; n++) {
+        const registroFrame& r = regs[n % cab->capacidad];
+        if (r.secuencia != (uint32_t)(n + 1) || r.largo > LARGO_DATA + BYTES_EXTRA) {
+            continue; // Registro incompleto o pisado: se salta
+        }
+        if (enviados == 0) t_captura0 = r.t_ns;
+
+        if (!rapido) {
+            dormirHasta(t_inicio + (r.t_ns - t_captura0));
+        }
+
+        memset(&proto, 0, sizeof(protocolo));
+        proto.cmd = r.cmd;
+        proto.lng = r.lng;
+        memcpy(proto.frame, r.frame, r.largo);
+
+        // El transporte toma los bits de parada de g_config_enlace (formatoIda());
+        // el FCS ya viene dentro del frame capturado.
+        g_config_enlace.bits_parada = r.bits_parada;
+        g_config_enlace.fcs = r.fcs;
+        if (velocidad_anterior != 0 && r.velocidad != velocidad_anterior) cambios++;
+        velocidad_anterior = r.velocidad;
+
+        if (trans->enviar(TX_PIN, r.velocidad, proto, r.largo)) {
+            enviados++;
+        }
+        if (rapido) {
+            delay(CAPTURA_SEPARACION_BITS * 1000 / r.velocidad);
+        }
+    }
+    g_config_enlace = config_previa;
+
+    double segundos = (capturaAhoraNs() - t_inicio) / 1e9;
+    printf("Reproducción terminada: %ld frames en %.3f s (%.1f frames/s), %ld cambios de velocidad.\n",
+           enviados, segundos, segundos > 0 ? enviados / segundos : 0.0, cambios);
+
+    munmap((void*)mapa, st.st_size);
+    return enviados;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file registroCaptura.h
+ * @brief Registro de todos los frames enviados en un archivo mapeado en memoria.
+ * @details El archivo es un anillo de registros de tamaño fijo. Agregar un
+ * registro es solo copiar memoria (sin write() ni ninguna otra llamada al
+ * sistema por frame). Una captura se puede reproducir después con
+ * su temporización original o a máxima velocidad, y con la velocidad y el
+ * formato de línea con que salió cada frame.
+ */
+
+#ifndef REGISTRO_CAPTURA_H
+#define REGISTRO_CAPTURA_H
+
+#include "transporte.h"
+#include "negociacionEnlace.h" // ConfiguracionEnlace (../Protocolo_Comun)
+#include <stdint.h>
+
+/**
+ * @brief "CAPT" en little endian. Identifica un archivo de captura.
+ */
+#define CAPTURA_MAGIA 0x54504143u
+#define CAPTURA_VERSION 2 // 2: velocidad, bits de parada y FCS por registro
+
+/**
+ * @brief Registros del anillo si no se indica otro valor (6 MB de archivo).
+ */
+#define CAPTURA_REGISTROS_DEFECTO 65536
+
+/**
+ * @brief Tamaño de la cabecera del archivo (una página).
+ * @details Así el primer registro queda alineado a página.
+ */
+#define CAPTURA_TAM_CABECERA 4096
+
+/**
+ * @brief Línea en reposo después de cada frame reproducido, en bits.
+ * @details enviarFrame() deja el stop final sin duración: a máxima
+ * velocidad el próximo bit de inicio lo taparía y el receptor descartaría
+ * el frame (como RPC_SEPARACION_BITS y NEG_SEPARACION_BITS).
+ */
+#define CAPTURA_SEPARACION_BITS 3
+
+// --- Resultado de cada envío ---
+#define CAPTURA_ENVIADO 0          // El transporte aceptó el frame
+#define CAPTURA_ERROR_TRANSPORTE 1 // El transporte falló
+
+/**
+ * @brief Cabecera al inicio del archivo.
+ */
+typedef struct
+{
+    uint32_t magia;
+    uint32_t version;
+    uint32_t tam_registro;
+    uint32_t capacidad;   // Cantidad de registros del anillo
+    uint64_t escritos;    // Total de registros agregados (no se reinicia al dar la vuelta)
+} cabeceraCaptura;
+
+/**
+ * @brief Un frame enviado. Tamaño fijo de 96 bytes.
+ */
+typedef struct
+{
+    uint64_t t_ns;        // CLOCK_MONOTONIC al empezar la transmisión
+    uint32_t secuencia;   // Número de registro + 1 (0 = vacío). Se escribe al final.
+    uint32_t duracion_us; // Tiempo que tomó la transmisión
+    BYTE cmd;
+    BYTE lng;
+    BYTE largo;           // Bytes del frame (devuelto por empaquetar())
+    BYTE resultado;       // CAPTURA_ENVIADO / CAPTURA_ERROR_TRANSPORTE
+    BYTE bits_parada;     // Formato de la línea de ida en ese momento
+    BYTE fcs;             // NEG_FCS_* con que se armó el frame
+    uint16_t velocidad;   // bps con que salió (g_velocidad)
+    BYTE frame[LARGO_DATA + BYTES_EXTRA];
+    BYTE relleno[5];
+} registroFrame;
+
+/**
+ * @brief Abre (o crea) el archivo de captura y lo mapea en memoria.
+ * @details Si el archivo ya existe con la misma capacidad, se sigue
+ * agregando a continuación de lo que tenía.
+ * @return false si no se pudo crear o mapear.
+ */
+bool capturaAbrir(const char* ruta, uint32_t capacidad);
+
+/**
+ * @brief Sincroniza el archivo con el disco y lo desmapea.
+ */
+void capturaCerrar();
+
+bool capturaActiva();
+
+/**
+ * @brief Agrega un frame enviado al anillo. No hace llamadas al sistema.
+ * @param velocidad bps con que salió el frame.
+ * @param config Configuración de la línea de ida en uso (bits de parada y FCS).
+ */
+void capturaRegistrar(const protocolo& proto, int largo, int velocidad, const ConfiguracionEnlace& config,
+                      uint64_t t_inicio_ns, uint32_t duracion_us, BYTE resultado);
+
+/**
+ * @brief Hora monotónica en nanosegundos (clock_gettime por vDSO, sin syscall).
+ */
+uint64_t capturaAhoraNs();
+
+/**
+ * @brief Reenvía una captura por el transporte indicado.
+ * @details Cada frame sale a la velocidad y con los bits de parada con que
+ * se capturó. Los cambios de enlace quedan en la captura como frames CMD 10,
+ * así que el receptor los sigue igual que en la sesión original.
+ * g_config_enlace vuelve a su valor al terminar.
+ * @param ruta Archivo de captura.
+ * @param rapido true = frames seguidos, con solo CAPTURA_SEPARACION_BITS
+ * entre uno y otro (saturar la línea);
+ * false = respetar los tiempos originales entre frames.
+ * @param trans Backend por el que se reenvía.
+ * @return Cantidad de frames reenviados, o -1 si el archivo no es válido.
+ */
+long reproducirCaptura(const char* ruta, bool rapido, const transporte* trans);
+
+#endif // REGISTRO_CAPTURA_H
@@ -0,0 +1,272 @@
+/**
+ * @file rpcEmisor.cpp
+ * @brief Implementación de los pedidos con respuesta (CMD 12) y del hilo lector.
+ */
+
+#include "rpcEmisor.h"
+#include "recibeRetorno.h"
+#include "velocidadAdaptativa.h"
+#include <wiringPi.h>
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+/**
+ * @brief Un pedido en vuelo.
+ */
+typedef struct
+{
+    bool usado;
+    BYTE id;
+    BYTE metodo;
+    unsigned long enviado_ms;
+    unsigned long plazo_ms;
+    std::promise<respuestaRpc> promesa;
+} pedidoRpc;
+
+bool g_rpc_activo = false;
+
+static pedidoRpc s_pedidos[RPC_EN_VUELO];
+static int s_en_vuelo = 0;
+static BYTE s_proximo_id = 0;
+static void (*s_enviar)(protocolo& pedido) = NULL;
+
+static std::mutex s_mutex;
+static std::condition_variable s_hay_lugar;
+static std::condition_variable s_hay_otro;
+static std::deque<protocolo> s_buzon;
+static std::thread s_hilo;
+static bool s_detener = false;
+static int s_pin_retorno = RX_RETORNO_PIN;
+
+// Estadísticas
+static unsigned long s_llamadas = 0;
+static unsigned long s_respondidas = 0;
+static unsigned long s_vencidas = 0;
+static unsigned long s_huerfanas = 0;   // Respuestas sin pedido (llegaron tarde)
+static unsigned long s_ida_y_vuelta_total_ms = 0;
+static int s_max_en_vuelo = 0;
+
+/**
+ * @brief Tiempo en la línea de 'largo' bytes a 'bps' (11 bits por byte + paridad).
+ */
+static unsigned long aireMs(int largo, int bps) {
+    return ((unsigned long)largo * 11 + 2) * 1000UL / bps;
+}
+
+void rpcIniciar(void (*enviar)(protocolo& pedido)) {
+    std::lock_guard<std::mutex> bloqueo(s_mutex);
+    for (int i = 0; i < RPC_EN_VUELO; i++) {
+        s_pedidos[i].usado = false;
+    }
+    s_en_vuelo = 0;
+    s_enviar = enviar;
+    s_buzon.clear();
+    s_llamadas = s_respondidas = s_vencidas = s_huerfanas = 0;
+    s_ida_y_vuelta_total_ms = 0;
+    s_max_en_vuelo = 0;
+}
+
+/**
+ * @brief Completa un pedido y libera su lugar (con s_mutex tomado).
+ */
+static void completar(pedidoRpc& p, const respuestaRpc& r) {
+    p.promesa.set_value(r);
+    p.promesa = std::promise<respuestaRpc>();
+    p.usado = false;
+    s_en_vuelo--;
+    s_hay_lugar.notify_one();
+}
+
+std::future<respuestaRpc> rpcLlamar(BYTE metodo, const BYTE* args, int lng) {
+    if (lng < 0) lng = 0;
+    if (lng > RPC_DATOS_MAX) lng = RPC_DATOS_MAX;
+
+    protocolo pedido;
+    memset(&pedido, 0, sizeof(protocolo));
+    pedido.cmd = CMD_RPC;
+    pedido.lng = (BYTE)(RPC_CABECERA + lng);
+    pedido.data[0] = RPC_PEDIDO;
+    pedido.data[2] = metodo;
+    if (lng > 0) memcpy(pedido.data + RPC_CABECERA, args, lng);
+
+    std::future<respuestaRpc> futuro;
+    {
+        std::unique_lock<std::mutex> bloqueo(s_mutex);
+        while (s_en_vuelo >= RPC_EN_VUELO) {
+            s_hay_lugar.wait(bloqueo); // Lo libera una respuesta o un plazo vencido
+        }
+        int libre = 0;
+        while (s_pedidos[libre].usado) libre++;
+
+        pedidoRpc& p = s_pedidos[libre];
+        p.usado = true;
+        p.id = s_proximo_id++;
+        p.metodo = metodo;
+        p.enviado_ms = millis();
+        // Cada pedido en vuelo antes que este ocupa la ida y la vuelta
+        s_en_vuelo++;
+        p.plazo_ms = s_en_vuelo * (aireMs(FrameEstandar::largo(pedido.lng), g_velocidad) +
+                                   aireMs(FrameEstandar::LARGO_MAX, g_velocidad)) + RPC_MARGEN_MS;
+        if (s_en_vuelo > s_max_en_vuelo) s_max_en_vuelo = s_en_vuelo;
+        s_llamadas++;
+
+        pedido.data[1] = p.id;
+        futuro = p.promesa.get_future();
+    }
+
+    // Fuera del lock: el lector puede ir completando otros pedidos mientras tanto
+    s_enviar(pedido);
+    return futuro;
+}
+
+void rpcProcesarRetorno(const protocolo& frame) {
+    if (frame.cmd != CMD_RPC || frame.lng < RPC_CABECERA || frame.data[0] != RPC_RESPUESTA) return;
+
+    std::lock_guard<std::mutex> bloqueo(s_mutex);
+    for (int i = 0; i < RPC_EN_VUELO; i++) {
+        pedidoRpc& p = s_pedidos[i];
+        if (!p.usado || p.id != frame.data[1]) continue;
+
+        respuestaRpc r;
+        r.estado = frame.data[2];
+        r.lng = frame.lng - RPC_CABECERA;
+        memcpy(r.datos, frame.data + RPC_CABECERA, r.lng);
+        r.ida_y_vuelta_ms = millis() - p.enviado_ms;
+        s_respondidas++;
+        s_ida_y_vuelta_total_ms += r.ida_y_vuelta_ms;
+        completar(p, r);
+        return;
+    }
+    s_huerfanas++;
+}
+
+/**
+ * @brief Completa con RPC_SIN_RESPUESTA los vencidos, o todos si 'todos'.
+ * @details 'ahora_ms' puede ser un poco anterior al envío de un pedido
+ * registrado mientras tanto: ese pedido todavía no vence.
+ */
+static void vencer(unsigned long ahora_ms, bool todos) {
+    std::lock_guard<std::mutex> bloqueo(s_mutex);
+    for (int i = 0; i < RPC_EN_VUELO; i++) {
+        pedidoRpc& p = s_pedidos[i];
+        if (!p.usado) continue;
+        long transcurrido = (long)(ahora_ms - p.enviado_ms);
+        if (!todos && transcurrido <= (long)p.plazo_ms) continue;
+
+        respuestaRpc r;
+        r.estado = RPC_SIN_RESPUESTA;
+        r.lng = 0;
+        r.ida_y_vuelta_ms = (transcurrido > 0) ? transcurrido : 0;
+        s_vencidas++;
+        completar(p, r);
+    }
+}
+
+void rpcVencer(unsigned long ahora_ms) {
+    vencer(ahora_ms, false);
+}
+
+// --- Hilo lector ---
+
+/**
+ * @brief Lee la línea de retorno y reparte lo que llega.
+ */
+static void hiloLector() {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> bloqueo(s_mutex);
+            if (s_detener) return;
+        }
+        protocolo frame;
+        if (recibirRetorno(s_pin_retorno, g_velocidad, frame, RPC_ESPERA_LECTOR_MS)) {
+            if (frame.cmd == CMD_RPC) {
+                rpcProcesarRetorno(frame);
+            } else {
+                std::lock_guard<std::mutex> bloqueo(s_mutex);
+                if (s_buzon.size() >= RPC_BUZON_MAX) s_buzon.pop_front();
+                s_buzon.push_back(frame);
+                s_hay_otro.notify_one();
+            }
+        }
+        rpcVencer(millis());
+    }
+}
+
+bool rpcLectorIniciar(int pin_retorno) {
+    s_pin_retorno = pin_retorno;
+    iniciarRecepcionRetorno(pin_retorno);
+    s_detener = false;
+    s_hilo = std::thread(hiloLector);
+    g_rpc_activo = true;
+    return true;
+}
+
+void rpcDetener() {
+    if (!g_rpc_activo) return;
+    {
+        std::lock_guard<std::mutex> bloqueo(s_mutex);
+        s_detener = true;
+    }
+    s_hilo.join();
+    vencer(millis(), true); // Ningún futuro queda sin completar
+    g_rpc_activo = false;
+}
+
+bool rpcOtroFrame(protocolo& frame, unsigned long timeout_ms) {
+    std::unique_lock<std::mutex> bloqueo(s_mutex);
+    if (!s_hay_otro.wait_for(bloqueo, std::chrono::milliseconds(timeout_ms),
+                             [] { return !s_buzon.empty(); })) {
+        return false;
+    }
+    frame = s_buzon.front();
+    s_buzon.pop_front();
+    return true;
+}
+
+// --- Impresión ---
+
+void rpcImprimir() {
+    std::lock_guard<std::mutex> bloqueo(s_mutex);
+    printf("--- Pedidos RPC (CMD 12) ---\n");
+    printf("Llamadas: %lu | Respondidas: %lu | Sin respuesta: %lu | Respuestas tardías: %lu\n",
+           s_llamadas, s_respondidas, s_vencidas, s_huerfanas);
+    printf("En vuelo: %d (máx %d de %d) | Ida y vuelta promedio: %.1f s\n", s_en_vuelo,
+           s_max_en_vuelo, RPC_EN_VUELO,
+           s_respondidas ? s_ida_y_vuelta_total_ms / 1000.0 / s_respondidas : 0.0);
+}
+
+void rpcImprimirRespuesta(int metodo, const respuestaRpc& r) {
+    if (r.estado != RPC_OK) {
+        printf("  %s\n", r.estado == RPC_SIN_RESPUESTA ? "sin respuesta (venció el plazo)"
+                         : r.estado == RPC_METODO_DESCONOCIDO ? "método desconocido"
+                         : "argumentos inválidos");
+        return;
+    }
+    const BYTE* d = r.datos;
+    switch (metodo) {
+        case RPC_ESTADISTICAS:
+            if (r.lng < 36) break;
+            printf("  Paquetes OK: %u | Fallo FCS: %u | Fallo paridad/sync: %u | Sin buffer: %u\n",
+                   rpcLeer32(d), rpcLeer32(d + 4), rpcLeer32(d + 8), rpcLeer32(d + 12));
+            printf("  Caché CMD 9: %u aciertos, %u fallos | Fragmentos: %u armados, %u descartados\n",
+                   rpcLeer32(d + 16), rpcLeer32(d + 20), rpcLeer32(d + 24), rpcLeer32(d + 28));
+            printf("  Telemetría: %u muestras\n", rpcLeer32(d + 32));
+            return;
+        case RPC_CONFIGURACION:
+            if (r.lng < 8) break;
+            printf("  SPEED %u bps | Enlace a %u bps (escalón %u) | %u buffers | LED %u Hz, %s\n",
+                   rpcLeer16(d), rpcLeer16(d + 2), d[4], d[5], d[6], d[7] ? "parpadeando" : "apagado");
+            return;
+        case RPC_SALUD:
+            if (r.lng < 9) break;
+            printf("  Encendido hace %.0f s | Heap libre: %u bytes | Pico de buffers: %u\n",
+                   rpcLeer32(d) / 1000.0, rpcLeer32(d + 4), d[8]);
+            return;
+    }
+    printf("  %d bytes de datos\n", r.lng);
+}
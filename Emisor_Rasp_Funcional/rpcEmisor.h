@@ -0,0 +1,157 @@
+/**
+ * @file rpcEmisor.h
+ * @brief Pedidos al receptor con respuesta por la línea de retorno (CMD 12).
+ * @details Cada pedido lleva un id de 8 bits que la ESP32 repite en su
+ * respuesta, así pueden quedar varios pedidos en vuelo a la vez (hasta
+ * RPC_EN_VUELO): no hace falta esperar una respuesta para enviar el
+ * pedido siguiente. rpcLlamar() vuelve enseguida con un std::future que
+ * se completa cuando llega la respuesta o cuando vence su plazo.
+ *
+ * Protocolo (payload del CMD 12, igual que en Receptor_Esp32/rpcReceptor.h):
+ *
+ *   PEDIDO    [0][id][método][argumentos...]   emisor -> receptor
+ *   RESPUESTA [1][id][estado][datos...]        receptor -> emisor
+ *
+ * Con --rpc un hilo lector es el único que lee la línea de retorno: las
+ * respuestas CMD 12 completan su pedido y los demás frames (ej: las del
+ * control del enlace, CMD 10) quedan para rpcOtroFrame().
+ */
+
+#ifndef RPC_EMISOR_H
+#define RPC_EMISOR_H
+
+#include "structProtocolo.h"
+#include <stdint.h>
+#include <future>
+
+/**
+ * @brief Comando de los pedidos y las respuestas.
+ */
+#define CMD_RPC 12
+
+#define RPC_PEDIDO 0
+#define RPC_RESPUESTA 1
+
+/**
+ * @brief Bytes de cabecera del payload: tipo, id y método (o estado).
+ */
+#define RPC_CABECERA 3
+#define RPC_DATOS_MAX (LARGO_DATA - RPC_CABECERA)
+
+/**
+ * @brief Métodos del receptor.
+ */
+#define RPC_ESTADISTICAS 0   // 9 contadores de 32 bits (ver rpcImprimirRespuesta)
+#define RPC_CONFIGURACION 1  // SPEED, velocidad actual, escalón, buffers, LED
+#define RPC_SALUD 2          // Tiempo encendido, heap libre, pico del pipeline
+#define RPC_ETAPAS 3         // Latencia por etapas de los últimos frames (ver latenciaEtapas.h)
+
+/**
+ * @brief Estados de la respuesta. RPC_SIN_RESPUESTA lo pone el emisor.
+ */
+#define RPC_OK 0
+#define RPC_METODO_DESCONOCIDO 1
+#define RPC_ARGUMENTOS_INVALIDOS 2
+#define RPC_SIN_RESPUESTA 255
+
+/**
+ * @brief Pedidos sin respuesta a la vez. rpcLlamar() espera si no hay lugar.
+ */
+#define RPC_EN_VUELO 8
+
+/**
+ * @brief Reposo tras cada pedido antes de enviar el siguiente: el receptor
+ * lee la paridad y el stop final hasta 3 bits después del último byte.
+ */
+#define RPC_SEPARACION_BITS 3
+
+/**
+ * @brief Margen del plazo de cada pedido, además del tiempo en la línea
+ * (la ESP32 atiende los pedidos entre otros comandos).
+ */
+#define RPC_MARGEN_MS 1000
+
+/**
+ * @brief Cada cuánto el hilo lector deja de esperar para vencer plazos.
+ */
+#define RPC_ESPERA_LECTOR_MS 100
+
+/**
+ * @brief Frames de retorno que no son CMD 12 guardados para rpcOtroFrame().
+ */
+#define RPC_BUZON_MAX 4
+
+/**
+ * @brief Resultado de un pedido.
+ */
+typedef struct
+{
+    int estado;                   // RPC_OK, ..., RPC_SIN_RESPUESTA
+    int lng;                      // Bytes en 'datos'
+    BYTE datos[RPC_DATOS_MAX];
+    unsigned long ida_y_vuelta_ms;
+} respuestaRpc;
+
+/**
+ * @brief Activado con --rpc: el hilo lector es dueño de la línea de retorno.
+ */
+extern bool g_rpc_activo;
+
+/**
+ * @brief Prepara los pedidos.
+ * @param enviar Transmite un pedido sin empaquetar (en el emisor, por el
+ * mismo camino que el menú: caché, prioridades, captura).
+ */
+void rpcIniciar(void (*enviar)(protocolo& pedido));
+
+/**
+ * @brief Arranca el hilo lector de la línea de retorno.
+ */
+bool rpcLectorIniciar(int pin_retorno);
+
+/**
+ * @brief Detiene el hilo lector (espera a que termine el frame que esté leyendo).
+ */
+void rpcDetener();
+
+/**
+ * @brief Envía un pedido y vuelve sin esperar la respuesta.
+ * @param args Argumentos del método (hasta RPC_DATOS_MAX bytes).
+ */
+std::future<respuestaRpc> rpcLlamar(BYTE metodo, const BYTE* args, int lng);
+
+/**
+ * @brief Entrega un frame CMD 12 recibido por el retorno a su pedido.
+ * @details La llama el hilo lector (o el simulador, que lee la línea virtual).
+ */
+void rpcProcesarRetorno(const protocolo& frame);
+
+/**
+ * @brief Completa con RPC_SIN_RESPUESTA los pedidos con el plazo vencido.
+ */
+void rpcVencer(unsigned long ahora_ms);
+
+/**
+ * @brief Espera un frame de retorno que no sea CMD 12 (solo con el lector activo).
+ */
+bool rpcOtroFrame(protocolo& frame, unsigned long timeout_ms);
+
+void rpcImprimir();
+
+/**
+ * @brief Muestra los datos de una respuesta según el método.
+ */
+void rpcImprimirRespuesta(int metodo, const respuestaRpc& r);
+
+/**
+ * @brief Enteros en big endian, como los escribe el receptor.
+ */
+static inline uint16_t rpcLeer16(const BYTE* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t rpcLeer32(const BYTE* p) {
+    return ((uint32_t)rpcLeer16(p) << 16) | rpcLeer16(p + 2);
+}
+
+#endif // RPC_EMISOR_H
@@ -0,0 +1,372 @@
+/**
+ * @file sesionesEmisor.cpp
+ * @brief Implementación del bucle de sesiones: cola de listas, rueda de
+ * temporizadores y turnos de los enlaces.
+ */
+
+#include "sesionesEmisor.h"
+#include "multiEnlace.h"
+#include "velocidadAdaptativa.h"
+#include "recibeRetorno.h"
+#include "rpcEmisor.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SES_MASCARA (SES_RUEDA_RANURAS - 1)
+
+static_assert((SES_RUEDA_RANURAS & SES_MASCARA) == 0, "SES_RUEDA_RANURAS tiene que ser potencia de 2");
+
+static uint32_t claveEspera(int enlace, uint32_t clave) {
+    return ((uint32_t)enlace << 24) | (clave & 0xFFFFFF);
+}
+
+// --- Cola de listas ---
+
+static void encolarLista(bucleSesiones& b, sesion& s) {
+    s.estado = SES_LISTA;
+    s.siguiente = NULL;
+    if (b.ultima_lista != NULL) b.ultima_lista->siguiente = &s;
+    else b.listas = &s;
+    b.ultima_lista = &s;
+}
+
+// --- Rueda de temporizadores ---
+
+static void agregarRueda(bucleSesiones& b, sesion& s, uint64_t vence_ms) {
+    // Lo ya vencido va a la próxima ranura: las revisadas no se vuelven a mirar
+    if (vence_ms <= b.procesado_ms) vence_ms = b.procesado_ms + 1;
+    s.vence_ms = vence_ms;
+    sesion*& ranura = b.ranuras[vence_ms & SES_MASCARA];
+    s.anterior = NULL;
+    s.siguiente = ranura;
+    if (ranura != NULL) ranura->anterior = &s;
+    ranura = &s;
+    b.en_rueda++;
+}
+
+static void quitarRueda(bucleSesiones& b, sesion& s) {
+    if (s.anterior != NULL) s.anterior->siguiente = s.siguiente;
+    else b.ranuras[s.vence_ms & SES_MASCARA] = s.siguiente;
+    if (s.siguiente != NULL) s.siguiente->anterior = s.anterior;
+    b.en_rueda--;
+}
+
+static void salirALinea(bucleSesiones& b, sesion& s, uint64_t inicio_ms) {
+    enlaceSesiones& e = b.enlaces[s.enlace];
+    e.ocupado = true;
+    e.enviar(s.enlace, s.trama, s.largo);
+    e.frames++;
+    b.contadores.enviados++;
+    s.estado = SES_ENVIANDO;
+    agregarRueda(b, s, inicio_ms + sesionesDuracionMs(e, s.largo));
+}
+
+/**
+ * @brief Lo que pasa cuando vence el temporizador de una sesión.
+ */
+static void vencer(bucleSesiones& b, sesion& s) {
+    switch (s.estado) {
+        case SES_ENVIANDO: {
+            // Terminó el frame: la línea pasa a la siguiente en turno
+            enlaceSesiones& e = b.enlaces[s.enlace];
+            sesion* proxima = e.turno;
+            if (proxima != NULL) {
+                e.turno = proxima->siguiente;
+                if (e.turno == NULL) e.ultimo_turno = NULL;
+                salirALinea(b, *proxima, s.vence_ms);
+            } else {
+                e.ocupado = false;
+            }
+            encolarLista(b, s);
+            break;
+        }
+        case SES_RECIBIENDO:
+            b.esperando.erase(claveEspera(s.enlace, s.clave));
+            s.recibio = false;
+            b.contadores.vencidas++;
+            encolarLista(b, s);
+            break;
+        default: // SES_DURMIENDO
+            encolarLista(b, s);
+            break;
+    }
+}
+
+/**
+ * @brief Revisa las ranuras hasta 'ahora_ms' y despierta lo vencido.
+ */
+static void avanzarRueda(bucleSesiones& b, uint64_t ahora_ms) {
+    if (b.en_rueda == 0) {
+        if (ahora_ms > b.procesado_ms) b.procesado_ms = ahora_ms;
+        return;
+    }
+    while (b.procesado_ms < ahora_ms) {
+        b.procesado_ms++;
+        sesion* s = b.ranuras[b.procesado_ms & SES_MASCARA];
+        while (s != NULL) {
+            sesion* siguiente = s->siguiente;
+            if (s->vence_ms <= b.procesado_ms) {
+                quitarRueda(b, *s);
+                vencer(b, *s);
+            }
+            s = siguiente; // Las de vueltas siguientes quedan
+        }
+        if (b.en_rueda == 0) {
+            b.procesado_ms = ahora_ms;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief El próximo vencimiento de la rueda (o UINT64_MAX si está vacía).
+ */
+static uint64_t proximoVencimiento(const bucleSesiones& b) {
+    if (b.en_rueda == 0) return UINT64_MAX;
+    for (uint64_t t = b.procesado_ms + 1; t <= b.procesado_ms + SES_RUEDA_RANURAS; t++) {
+        for (const sesion* s = b.ranuras[t & SES_MASCARA]; s != NULL; s = s->siguiente) {
+            if (s->vence_ms == t) return t;
+        }
+    }
+    // Nada en esta vuelta: el mínimo de las siguientes
+    uint64_t minimo = UINT64_MAX;
+    for (int r = 0; r < SES_RUEDA_RANURAS; r++) {
+        for (const sesion* s = b.ranuras[r]; s != NULL; s = s->siguiente) {
+            if (s->vence_ms < minimo) minimo = s->vence_ms;
+        }
+    }
+    return minimo;
+}
+
+// --- Bucle ---
+
+static void esperarDurmiendo(bucleSesiones& b, uint64_t hasta_ms) {
+    uint64_t ahora = b.reloj();
+    if (hasta_ms > ahora) usleep((useconds_t)((hasta_ms - ahora) * 1000));
+}
+
+uint64_t sesionesRelojMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+uint64_t sesionesDuracionMs(const enlaceSesiones& e, int largo) {
+    int bits = BITS_FRAME(largo, e.bits_parada) + SES_REPOSO_BITS;
+    return ((uint64_t)bits * 1000 + e.speed - 1) / e.speed;
+}
+
+void sesionesIniciar(bucleSesiones& b, uint64_t (*reloj)(),
+                     void (*esperar)(bucleSesiones& b, uint64_t hasta_ms)) {
+    b.num_enlaces = 0;
+    b.reloj = reloj;
+    b.esperar = (esperar != NULL) ? esperar : esperarDurmiendo;
+    memset(b.ranuras, 0, sizeof(b.ranuras));
+    b.procesado_ms = reloj();
+    b.en_rueda = 0;
+    b.listas = NULL;
+    b.ultima_lista = NULL;
+    b.esperando.clear();
+    b.vivas = 0;
+    memset(&b.contadores, 0, sizeof(b.contadores));
+}
+
+int sesionesAgregarEnlace(bucleSesiones& b, void (*enviar)(int enlace, const protocolo& proto, int largo),
+                          int speed, int bits_parada) {
+    if (b.num_enlaces >= SES_MAX_ENLACES || speed <= 0) return -1;
+    enlaceSesiones& e = b.enlaces[b.num_enlaces];
+    e.enviar = enviar;
+    e.speed = speed;
+    e.bits_parada = bits_parada;
+    e.ocupado = false;
+    e.turno = NULL;
+    e.ultimo_turno = NULL;
+    e.frames = 0;
+    return b.num_enlaces++;
+}
+
+void sesionIniciar(bucleSesiones& b, sesion& s, cuerpoSesion cuerpo, void* datos, int enlace) {
+    s.cuerpo = cuerpo;
+    s.datos = datos;
+    s.enlace = enlace;
+    s.punto = 0;
+    s.recibio = false;
+    s.bucle = &b;
+    b.vivas++;
+    encolarLista(b, s);
+}
+
+void sesionesCorrer(bucleSesiones& b) {
+    while (b.vivas > 0) {
+        avanzarRueda(b, b.reloj());
+        if (b.listas == NULL) {
+            uint64_t proximo = proximoVencimiento(b);
+            if (proximo == UINT64_MAX) {
+                // Sin listas ni temporizadores: ninguna sesión puede seguir
+                printf("Sesiones: %lu sesiones sin nada que esperar\n", b.vivas);
+                return;
+            }
+            b.esperar(b, proximo);
+            continue;
+        }
+
+        // Las listas de esta vuelta; las que cedan quedan para la siguiente
+        sesion* s = b.listas;
+        b.listas = NULL;
+        b.ultima_lista = NULL;
+        while (s != NULL) {
+            sesion* siguiente = s->siguiente;
+            b.contadores.reanudaciones++;
+            if (s->cuerpo(*s) == SES_TERMINO) {
+                s->estado = SES_TERMINADA;
+                b.vivas--;
+                b.contadores.terminadas++;
+            }
+            s = siguiente;
+        }
+    }
+}
+
+bool sesionesEntregar(bucleSesiones& b, int enlace, uint32_t clave, const protocolo& proto) {
+    std::unordered_map<uint32_t, sesion*>::iterator it = b.esperando.find(claveEspera(enlace, clave));
+    if (it == b.esperando.end()) {
+        b.contadores.huerfanas++;
+        return false;
+    }
+    sesion& s = *it->second;
+    b.esperando.erase(it);
+    quitarRueda(b, s);
+    s.respuesta = proto;
+    s.recibio = true;
+    b.contadores.entregadas++;
+    encolarLista(b, s);
+    return true;
+}
+
+void sesionesEnviarMultiEnlace(int enlace, const protocolo& proto, int largo) {
+    if (!multiEnlaceEncolar(enlace, proto, largo)) {
+        printf("Sesiones: la cola del enlace %d está llena, se pierde un frame\n", enlace);
+    }
+}
+
+// --- Línea de retorno ---
+
+bool sesionesClaveRetorno(const protocolo& frame, uint32_t& clave) {
+    int pos_secuencia = (frame.data[0] == ENLACE_CONFIRMA) ? 2 : 1;
+    if (frame.cmd != CMD_ENLACE || frame.lng <= pos_secuencia) return false;
+    clave = ((uint32_t)frame.data[0] << 8) | frame.data[pos_secuencia];
+    return true;
+}
+
+void sesionesEsperarRetorno(bucleSesiones& b, uint64_t hasta_ms) {
+    uint64_t ahora = b.reloj();
+    if (hasta_ms <= ahora || b.num_enlaces <= SES_ENLACE_RETORNO) return;
+    unsigned long timeout_ms = (unsigned long)(hasta_ms - ahora);
+    protocolo frame;
+    // Con --rpc la línea de retorno la lee el hilo lector de rpcEmisor
+    bool llego = g_rpc_activo ? rpcOtroFrame(frame, timeout_ms)
+                              : recibirRetorno(RX_RETORNO_PIN, b.enlaces[SES_ENLACE_RETORNO].speed, frame,
+                                               timeout_ms);
+    uint32_t clave;
+    if (llego && sesionesClaveRetorno(frame, clave)) {
+        sesionesEntregar(b, SES_ENLACE_RETORNO, clave, frame);
+    }
+}
+
+// --- Opción 14 ---
+
+/**
+ * @brief Plazo de un REPORTE: el frame de respuesta más largo (2 bits de
+ * parada en el retorno) más lo que tarda la ESP32 en atenderlo.
+ */
+static unsigned long plazoReporteMs(const enlaceSesiones& e) {
+    return (unsigned long)BITS_FRAME(9 + BYTES_EXTRA, 2) * 1000UL / e.speed + SES_MARGEN_RESPUESTA_MS;
+}
+
+static uint32_t claveReporte(BYTE secuencia) {
+    return ((uint32_t)ENLACE_REPORTE << 8) | secuencia;
+}
+
+int sesionPruebaEnlace(sesion& s) {
+    pruebaEnlace& p = *(pruebaEnlace*)s.datos;
+    SESION_INICIO(s);
+    p.confirmado = false;
+    p.ok_receptor = -1;
+    for (p.enviados = 0; p.enviados < p.mensajes; p.enviados++) {
+        memset(&p.pedido, 0, sizeof(protocolo));
+        p.pedido.cmd = 1;
+        p.pedido.lng = snprintf(reinterpret_cast<char*>(p.pedido.data), LARGO_DATA, "Enlace %d, mensaje %d",
+                                s.enlace, p.enviados + 1);
+        SESION_ENVIAR(s, p.pedido);
+    }
+    // El REPORTE acusa lo recibido: ok = frames válidos desde el reporte anterior
+    for (p.intento = 0; p.confirmar && p.intento < SES_INTENTOS_CONSULTA; p.intento++) {
+        memset(&p.pedido, 0, sizeof(protocolo));
+        p.pedido.cmd = CMD_ENLACE;
+        p.pedido.data[0] = ENLACE_CONSULTA;
+        p.pedido.data[1] = enlaceProximaSecuencia();
+        p.pedido.lng = 2;
+        SESION_ENVIAR(s, p.pedido);
+        SESION_RECIBIR(s, claveReporte(p.pedido.data[1]), plazoReporteMs(s.bucle->enlaces[s.enlace]));
+        if (s.recibio && s.respuesta.lng >= 7) {
+            p.confirmado = true;
+            p.ok_receptor = (s.respuesta.data[2] << 8) | s.respuesta.data[3];
+            break;
+        }
+    }
+    SESION_FIN(s);
+}
+
+// --- Pedidos de las macros ---
+
+void sesionDormirHasta(sesion& s, uint64_t t_ms) {
+    s.estado = SES_DURMIENDO;
+    agregarRueda(*s.bucle, s, t_ms);
+}
+
+void sesionEnviar(sesion& s, const protocolo& proto) {
+    bucleSesiones& b = *s.bucle;
+    enlaceSesiones& e = b.enlaces[s.enlace];
+    if (&proto != &s.trama) s.trama = proto;
+    s.largo = empaquetar(s.trama);
+
+    if (!e.ocupado) {
+        salirALinea(b, s, b.reloj());
+        return;
+    }
+    s.estado = SES_EN_LINEA;
+    s.siguiente = NULL;
+    if (e.ultimo_turno != NULL) e.ultimo_turno->siguiente = &s;
+    else e.turno = &s;
+    e.ultimo_turno = &s;
+}
+
+void sesionRecibir(sesion& s, uint32_t clave, unsigned long timeout_ms) {
+    bucleSesiones& b = *s.bucle;
+    s.clave = clave;
+    // Una sola sesión por clave: la segunda no recibe nada
+    if (!b.esperando.insert(std::make_pair(claveEspera(s.enlace, clave), &s)).second) {
+        s.recibio = false;
+        encolarLista(b, s);
+        return;
+    }
+    s.estado = SES_RECIBIENDO;
+    agregarRueda(b, s, b.reloj() + timeout_ms);
+}
+
+void sesionCeder(sesion& s) {
+    encolarLista(*s.bucle, s);
+}
+
+void sesionesImprimir(const bucleSesiones& b) {
+    const contadoresSesiones& c = b.contadores;
+    printf("--- Sesiones ---\n");
+    printf("Vivas: %lu, terminadas: %lu, reanudaciones: %lu\n", b.vivas, c.terminadas, c.reanudaciones);
+    printf("Frames enviados: %lu, respuestas entregadas: %lu, vencidas: %lu, sin sesión: %lu\n",
+           c.enviados, c.entregadas, c.vencidas, c.huerfanas);
+    for (int i = 0; i < b.num_enlaces; i++) {
+        printf("  Enlace %d: %lu frames a %d bps\n", i, b.enlaces[i].frames, b.enlaces[i].speed);
+    }
+}
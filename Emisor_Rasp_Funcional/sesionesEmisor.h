@@ -0,0 +1,306 @@
+/**
+ * @file sesionesEmisor.h
+ * @brief Sesiones sin pila propia: "enviar, esperar el acuse, reintentar"
+ * escrito en línea recta, con miles de sesiones en un solo hilo.
+ * @details Las opciones del menú son código bloqueante (armar el frame,
+ * enviarlo, usleep): una conversación con reintentos por receptor
+ * necesitaría un hilo por conversación o una máquina de estados a mano.
+ * Una sesión es una función que se suspende en cada espera y sigue desde
+ * ahí cuando la espera termina:
+ *
+ *   static int conversar(sesion& s) {
+ *       estadoConversacion& c = *(estadoConversacion*)s.datos;
+ *       SESION_INICIO(s);
+ *       for (c.intento = 0; c.intento < 3; c.intento++) {
+ *           SESION_ENVIAR(s, c.pedido);
+ *           SESION_RECIBIR(s, c.clave, 500);
+ *           if (s.recibio) break;
+ *       }
+ *       SESION_FIN(s);
+ *   }
+ *
+ * Las macros guardan el punto donde sigue la función (como los
+ * protothreads: un switch sobre __LINE__) y no una pila: lo que tenga que
+ * sobrevivir a una espera va en 'datos', no en variables locales. Dentro
+ * del cuerpo no puede haber otro switch que encierre una espera, ni dos
+ * esperas en la misma línea. Es C++11, como el resto del emisor: las
+ * corrutinas de C++20 (co_await) no están en los compiladores de la
+ * Raspberry que compilan este programa.
+ *
+ * Un bucle de sesiones corre todas en un solo hilo: una cola de listas y
+ * una rueda de temporizadores de 1 ms por ranura (dormir, fin de un envío,
+ * vencimiento de una recepción). Cada enlace atiende los envíos en orden
+ * de pedido: un frame ocupa la línea lo que dura más el reposo, la sesión
+ * sigue cuando terminó de salir y recién ahí sale el de la siguiente (las
+ * que esperan turno no están en la rueda). Las respuestas entran
+ * con sesionesEntregar(), con la clave que eligió la sesión que espera
+ * (por ejemplo la secuencia y el receptor de la conversación).
+ *
+ * En el emisor, la opción 14 corre una sesión por enlace de --enlaces
+ * (sesionPruebaEnlace) y, mientras no hay nada listo, el bucle lee la
+ * línea de retorno (sesionesEsperarRetorno): cada respuesta CMD 10 le
+ * llega a la sesión del enlace SES_ENLACE_RETORNO con la clave de
+ * sesionesClaveRetorno().
+ */
+
+#ifndef SESIONES_EMISOR_H
+#define SESIONES_EMISOR_H
+
+#include "funcionesProtocolo.h"
+#include <stdint.h>
+#include <unordered_map>
+
+/**
+ * @brief Ranuras de la rueda de temporizadores (1 ms cada una, potencia de 2).
+ * @details Los vencimientos a más de una vuelta esperan en su ranura las
+ * vueltas que falten.
+ */
+#define SES_RUEDA_RANURAS 1024
+
+#define SES_MAX_ENLACES 8
+
+/**
+ * @brief Reposo entre frames seguidos del mismo enlace (como ME_REPOSO_BITS).
+ */
+#define SES_REPOSO_BITS 3
+
+/**
+ * @brief Enlace cuyo receptor contesta por la línea de retorno: el primero
+ * de --enlaces, que también lleva los frames del menú (enviarMultiEnlace).
+ */
+#define SES_ENLACE_RETORNO 0
+
+/**
+ * @brief Consultas (CMD 10) de sesionPruebaEnlace antes de dar el acuse por perdido.
+ */
+#define SES_INTENTOS_CONSULTA 3
+
+/**
+ * @brief Margen del plazo de una respuesta, además del tiempo en la línea
+ * (lo que tarda la ESP32 en atenderla, como en enlaceEsperarRespuesta()).
+ */
+#define SES_MARGEN_RESPUESTA_MS 500
+
+/**
+ * @brief Lo que devuelve el cuerpo de una sesión (lo arman las macros).
+ */
+#define SES_SIGUE 0
+#define SES_TERMINO 1
+
+/**
+ * @brief En qué está una sesión.
+ */
+#define SES_LISTA 0        // En la cola de listas
+#define SES_DURMIENDO 1    // En la rueda hasta 'vence_ms'
+#define SES_EN_LINEA 2     // En la cola de turnos de su enlace
+#define SES_ENVIANDO 3     // Su frame está saliendo
+#define SES_RECIBIENDO 4   // Esperando una respuesta con su clave (y en la rueda)
+#define SES_TERMINADA 5
+
+struct sesion;
+struct bucleSesiones;
+
+typedef int (*cuerpoSesion)(sesion& s);
+
+/**
+ * @brief Una sesión. La memoria es del que la crea (sin reservas del bucle).
+ */
+struct sesion
+{
+    cuerpoSesion cuerpo;
+    void* datos;            // Estado que sobrevive a las esperas
+    int enlace;             // Enlace de SESION_ENVIAR y SESION_RECIBIR
+    int punto;              // Dónde sigue el cuerpo (0 = desde el principio)
+
+    // Resultado de la última SESION_RECIBIR
+    bool recibio;           // false = venció el plazo
+    protocolo respuesta;
+
+    // Del bucle
+    bucleSesiones* bucle;
+    int estado;
+    uint64_t vence_ms;
+    uint32_t clave;
+    protocolo trama;        // Frame a enviar cuando le toque la línea
+    int largo;
+    sesion* anterior;       // Lista de la ranura, de listas o de turnos
+    sesion* siguiente;
+};
+
+/**
+ * @brief Un enlace del bucle: cómo sale un frame y cuánto ocupa la línea.
+ */
+typedef struct
+{
+    /**
+     * @brief Entrega el frame ya empaquetado al transporte. No espera a que salga
+     * (ej: multiEnlaceEncolar); el bucle no le pasa otro hasta que este terminó.
+     */
+    void (*enviar)(int enlace, const protocolo& proto, int largo);
+    int speed;
+    int bits_parada;
+    bool ocupado;           // Hay un frame saliendo
+    sesion* turno;          // Sesiones esperando la línea, en orden de pedido
+    sesion* ultimo_turno;
+    unsigned long frames;
+} enlaceSesiones;
+
+/**
+ * @brief Contadores del bucle.
+ */
+typedef struct
+{
+    unsigned long reanudaciones;   // Veces que se corrió un cuerpo
+    unsigned long enviados;
+    unsigned long entregadas;      // Respuestas que despertaron a una sesión
+    unsigned long huerfanas;       // Respuestas sin nadie esperando su clave
+    unsigned long vencidas;        // Recepciones que vencieron
+    unsigned long terminadas;
+} contadoresSesiones;
+
+struct bucleSesiones
+{
+    enlaceSesiones enlaces[SES_MAX_ENLACES];
+    int num_enlaces;
+
+    /**
+     * @brief Reloj en ms (el de CLOCK_MONOTONIC o uno virtual en las pruebas).
+     */
+    uint64_t (*reloj)();
+
+    /**
+     * @brief Sin nada listo: espera hasta 'hasta_ms' o hasta que llegue una
+     * respuesta (que entra con sesionesEntregar() desde este mismo hilo).
+     */
+    void (*esperar)(bucleSesiones& b, uint64_t hasta_ms);
+
+    sesion* ranuras[SES_RUEDA_RANURAS];
+    uint64_t procesado_ms;          // Ranuras revisadas hasta este instante
+    unsigned long en_rueda;
+    sesion* listas;                 // Cola de listas: primera...
+    sesion* ultima_lista;           // ...y última
+    std::unordered_map<uint32_t, sesion*> esperando;   // (enlace, clave) -> sesión
+    unsigned long vivas;
+    contadoresSesiones contadores;
+};
+
+/**
+ * @brief Deja el bucle vacío. 'esperar' NULL = dormir con usleep().
+ */
+void sesionesIniciar(bucleSesiones& b, uint64_t (*reloj)(),
+                     void (*esperar)(bucleSesiones& b, uint64_t hasta_ms));
+
+/**
+ * @brief Agrega un enlace y retorna su número (-1 si ya hay SES_MAX_ENLACES).
+ */
+int sesionesAgregarEnlace(bucleSesiones& b, void (*enviar)(int enlace, const protocolo& proto, int largo),
+                          int speed, int bits_parada);
+
+/**
+ * @brief Pone una sesión en la cola de listas; corre desde el principio del cuerpo.
+ */
+void sesionIniciar(bucleSesiones& b, sesion& s, cuerpoSesion cuerpo, void* datos, int enlace);
+
+/**
+ * @brief Corre las sesiones hasta que terminen todas.
+ */
+void sesionesCorrer(bucleSesiones& b);
+
+/**
+ * @brief Una respuesta para la sesión que espera 'clave' en 'enlace'.
+ * @return false si nadie la esperaba (se descarta).
+ */
+bool sesionesEntregar(bucleSesiones& b, int enlace, uint32_t clave, const protocolo& proto);
+
+/**
+ * @brief 'enviar' para los enlaces de --enlaces: encola en multiEnlace.h.
+ */
+void sesionesEnviarMultiEnlace(int enlace, const protocolo& proto, int largo);
+
+/**
+ * @brief 'esperar' del emisor: lee la línea de retorno (o el hilo lector,
+ * con --rpc) hasta 'hasta_ms' y entrega la respuesta CMD 10 que llegue a
+ * SES_ENLACE_RETORNO. Vuelve con el primer frame.
+ * @details Antes hay que preparar la línea con enlacePrepararRetorno().
+ */
+void sesionesEsperarRetorno(bucleSesiones& b, uint64_t hasta_ms);
+
+/**
+ * @brief Clave de una respuesta CMD 10 que llega por la línea de retorno:
+ * subtipo y secuencia del pedido.
+ * @return false si el frame no es una respuesta CMD 10.
+ */
+bool sesionesClaveRetorno(const protocolo& frame, uint32_t& clave);
+
+/**
+ * @brief Estado de sesionPruebaEnlace (en 'datos').
+ */
+typedef struct
+{
+    int mensajes;           // CMD 1 a enviar
+    bool confirmar;         // Pedir el REPORTE al final (solo SES_ENLACE_RETORNO)
+    // Resultado
+    int enviados;
+    int intento;            // Consultas que vencieron antes del REPORTE
+    bool confirmado;
+    int ok_receptor;        // Frames válidos según el REPORTE
+    protocolo pedido;
+} pruebaEnlace;
+
+/**
+ * @brief Opción 14 en una sesión: 'mensajes' de prueba por el enlace y,
+ * con 'confirmar', una CONSULTA (CMD 10) que espera su REPORTE y se
+ * reintenta hasta SES_INTENTOS_CONSULTA veces.
+ */
+int sesionPruebaEnlace(sesion& s);
+
+/**
+ * @brief Reloj de CLOCK_MONOTONIC en ms (el del emisor).
+ */
+uint64_t sesionesRelojMs();
+
+/**
+ * @brief Milisegundos que ocupa un frame de 'largo' bytes, con el reposo.
+ */
+uint64_t sesionesDuracionMs(const enlaceSesiones& e, int largo);
+
+// --- Pedidos de las macros (no llamar fuera de ellas) ---
+void sesionDormirHasta(sesion& s, uint64_t t_ms);
+void sesionEnviar(sesion& s, const protocolo& proto);
+void sesionRecibir(sesion& s, uint32_t clave, unsigned long timeout_ms);
+void sesionCeder(sesion& s);
+
+// --- Macros del cuerpo de una sesión ---
+
+#define SESION_INICIO(s) switch ((s).punto) { case 0:
+#define SESION_FIN(s) } (s).punto = -1; return SES_TERMINO
+
+#define SESION_ESPERAR_(s, pedido) \
+    do { (s).punto = __LINE__; pedido; return SES_SIGUE; case __LINE__:; } while (0)
+
+/**
+ * @brief Sigue en el instante 't_ms' del reloj del bucle.
+ */
+#define SESION_DORMIR_HASTA(s, t_ms) SESION_ESPERAR_(s, sesionDormirHasta(s, t_ms))
+#define SESION_DORMIR(s, ms) SESION_ESPERAR_(s, sesionDormirHasta(s, (s).bucle->reloj() + (ms)))
+
+/**
+ * @brief Empaqueta 'proto' (cmd, lng y data), lo envía por el enlace de la
+ * sesión y sigue cuando el frame terminó de salir.
+ */
+#define SESION_ENVIAR(s, proto) SESION_ESPERAR_(s, sesionEnviar(s, proto))
+
+/**
+ * @brief Espera una respuesta con 'clave' hasta 'timeout_ms'. Después:
+ * s.recibio y s.respuesta.
+ */
+#define SESION_RECIBIR(s, clave, timeout_ms) SESION_ESPERAR_(s, sesionRecibir(s, clave, timeout_ms))
+
+/**
+ * @brief Vuelve al final de la cola de listas (deja correr a las demás).
+ */
+#define SESION_CEDER(s) SESION_ESPERAR_(s, sesionCeder(s))
+
+void sesionesImprimir(const bucleSesiones& b);
+
+#endif // SESIONES_EMISOR_H
@@ -18,6 +18,7 @@
 #include <stdexcept>    // Para std::invalid_argument (para la validación)
 #include <sstream>      // Para std::ostringstream (para formatear array)
 #include <unistd.h>     // Para usleep() / sleep() (si es necesario un delay)
+#include "frameProtocolo.h" // Formato del frame, común con el receptor (../Protocolo_Comun)
 
 
 // --- Definiciones del Protocolo ---
@@ -40,6 +41,9 @@
  */
 #define BYTES_EXTRA 4 
 
+static_assert(LARGO_DATA == FrameEstandar::PAYLOAD_MAX && BYTES_EXTRA == FrameEstandar::BYTES_CONTROL,
+              "structProtocolo.h no coincide con FrameEstandar (frameProtocolo.h)");
+
 // --- Definiciones de Hardware (Específicas del Emisor - RPi) ---
 
 /**
@@ -57,6 +61,24 @@
  */
 #define SPEED 10
 
+/**
+ * @brief Escalera de velocidades del control adaptativo (--adaptativo).
+ * @details El índice 0 es SPEED: la velocidad de arranque y a la que
+ * vuelven las dos puntas si se pierde una confirmación. 1000/bps tiene
+ * que ser entero porque el bit se mide en ms. Debe ser igual en el receptor.
+ */
+#define VELOCIDADES_BPS {10, 20, 25, 50, 100, 125, 200, 250}
+
+/**
+ * @brief Cantidad de escalones de VELOCIDADES_BPS.
+ */
+#define NUM_VELOCIDADES 8
+
+/**
+ * @brief Pin GPIO de la RPi (BCM) que RECIBE la línea de retorno de la ESP32.
+ */
+#define RX_RETORNO_PIN 27
+
 // --- Estructura Principal del Protocolo ---
 
 typedef struct 
@@ -95,8 +117,15 @@ typedef struct
      */
     unsigned short fcs;
 
+    /**
+     * @brief Instantes de la latencia por etapas (ver latenciaEtapas.h), en
+     * ns de CLOCK_MONOTONIC: cuándo se pidió el mensaje y cuándo se entregó
+     * para transmitir (0 = sin marcar). No viajan por el cable.
+     */
+    uint64_t t_pedido_ns;
+    uint64_t t_encolado_ns;
+
 } protocolo;
 
 
 #endif // STRUCT_PROTOCOLO_H
-#endif
@@ -0,0 +1,219 @@
+/**
+ * @file telemetria.cpp
+ * @brief Implementación de la telemetría continua de temperatura.
+ */
+
+#include "telemetria.h"
+#include "funcionesProtocolo.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+typedef std::chrono::steady_clock reloj;
+
+// --- Fuente de temperaturas ---
+
+bool fuenteAbrir(fuenteTemperatura& fuente, const char* ruta) {
+    fuente.n = 0;
+    fuente.semilla = 12345;
+    fuente.archivo = NULL;
+    if (ruta != NULL && ruta[0] != '\0') {
+        fuente.archivo = fopen(ruta, "r");
+        if (fuente.archivo == NULL) {
+            perror(ruta);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool fuenteLeer(fuenteTemperatura& fuente, float hz, float& temperatura) {
+    if (fuente.archivo != NULL) {
+        for (int intento = 0; intento < 2; intento++) {
+            if (fscanf(fuente.archivo, "%f", &temperatura) == 1) {
+                fuente.n++;
+                return true;
+            }
+            rewind(fuente.archivo); // Fin del archivo: se vuelve a empezar
+        }
+        return false;
+    }
+
+    // Sensor simulado: ciclo lento de 10 minutos + ruido de +-0.05 °C
+    double t = fuente.n / hz;
+    fuente.semilla = fuente.semilla * 1103515245u + 12345u;
+    double ruido = ((fuente.semilla >> 16) % 1001) / 10000.0 - 0.05;
+    temperatura = (float)(22.0 + 8.0 * sin(2.0 * M_PI * t / 600.0) + ruido);
+    fuente.n++;
+    return true;
+}
+
+void fuenteCerrar(fuenteTemperatura& fuente) {
+    if (fuente.archivo != NULL) fclose(fuente.archivo);
+    fuente.archivo = NULL;
+}
+
+// --- Codificación ---
+
+int16_t temperaturaAFijo(float temperatura) {
+    float v = roundf(temperatura * TELEMETRIA_ESCALA);
+    if (v > 32767.0f) v = 32767.0f;
+    if (v < -32768.0f) v = -32768.0f;
+    return (int16_t)v;
+}
+
+/**
+ * @brief ZigZag: los enteros chicos (positivos o negativos) quedan chicos.
+ * (0 -> 0, -1 -> 1, 1 -> 2, -2 -> 3...)
+ */
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+/**
+ * @brief Escribe 'v' como varint (7 bits por byte, bit alto = continúa).
+ * @return Bytes escritos, o 0 si no cabe.
+ */
+static int escribirVarint(uint32_t v, BYTE* salida, int espacio) {
+    int n = 0;
+    do {
+        if (n >= espacio) return 0;
+        BYTE b = v & 0x7F;
+        v >>= 7;
+        salida[n++] = b | (v ? 0x80 : 0);
+    } while (v);
+    return n;
+}
+
+int codificarTelemetria(BYTE secuencia, uint16_t periodo_ms, const int16_t* muestras, int n,
+                        BYTE* salida, int max_bytes, int* usadas) {
+    *usadas = 0;
+    if (max_bytes < 1) return 0;
+
+    int pos = 0;
+    salida[pos++] = secuencia;
+    int w = escribirVarint(periodo_ms, salida + pos, max_bytes - pos);
+    if (w == 0) return 0;
+    pos += w;
+
+    int32_t anterior = 0;
+    for (int i = 0; i < n; i++) {
+        // La primera va completa, las demás como diferencia con la anterior
+        int32_t valor = (i == 0) ? muestras[0] : muestras[i] - anterior;
+        w = escribirVarint(zigzag(valor), salida + pos, max_bytes - pos);
+        if (w == 0) break; // Frame lleno
+        pos += w;
+        anterior = muestras[i];
+        (*usadas)++;
+    }
+    return pos;
+}
+
+// --- Transmisión continua ---
+
+/**
+ * @brief Una muestra esperando lugar en un frame, con la hora en que se tomó.
+ */
+typedef struct
+{
+    int16_t valor;
+    reloj::time_point llegada;
+} muestraEncolada;
+
+void transmitirTelemetria(fuenteTemperatura& fuente, float hz, float duracion_s,
+                          void (*enviar)(protocolo& proto, int largo)) {
+    std::deque<muestraEncolada> cola; // La más antigua adelante: su llegada marca la latencia
+    std::mutex mutex;
+    std::condition_variable hay_muestras;
+    bool muestreo_terminado = false;
+    unsigned long descartadas = 0;
+
+    long total = (long)(hz * duracion_s);
+    std::chrono::nanoseconds periodo((long long)(1e9 / hz));
+    uint16_t periodo_ms = (uint16_t)(1000.0f / hz + 0.5f);
+
+    // --- Hilo de muestreo: no se detiene mientras se transmite ---
+    std::thread muestreo([&]() {
+        reloj::time_point proxima = reloj::now();
+        for (long i = 0; i < total; i++) {
+            std::this_thread::sleep_until(proxima);
+            proxima += periodo;
+
+            float temperatura;
+            if (!fuenteLeer(fuente, hz, temperatura)) break;
+
+            muestraEncolada m;
+            m.valor = temperaturaAFijo(temperatura);
+            m.llegada = reloj::now();
+
+            std::lock_guard<std::mutex> bloqueo(mutex);
+            if (cola.size() >= TELEMETRIA_COLA_MAX) {
+                cola.pop_front(); // La línea no da abasto: se pierde la más vieja
+                descartadas++;
+            }
+            cola.push_back(m);
+            hay_muestras.notify_one();
+        }
+        std::lock_guard<std::mutex> bloqueo(mutex);
+        muestreo_terminado = true;
+        hay_muestras.notify_one();
+    });
+
+    protocolo proto;
+    BYTE secuencia = 0;
+    int16_t lote[LARGO_DATA];
+    unsigned long muestras_enviadas = 0;
+    unsigned long bytes_enviados = 0;
+
+    for (;;) {
+        int n = 0;
+        {
+            std::unique_lock<std::mutex> bloqueo(mutex);
+            // Se espera a tener un frame lleno, a que la muestra más vieja
+            // llegue a la latencia máxima, o al fin del muestreo.
+            for (;;) {
+                if (muestreo_terminado) break;
+                if (cola.size() >= (size_t)LARGO_DATA - 2) break;
+                if (!cola.empty() && reloj::now() - cola.front().llegada >=
+                                         std::chrono::duration<double>(TELEMETRIA_LATENCIA_MAX_S)) {
+                    break;
+                }
+                hay_muestras.wait_for(bloqueo, std::chrono::milliseconds(100));
+            }
+            if (cola.empty() && muestreo_terminado) break;
+
+            n = (int)std::min(cola.size(), (size_t)LARGO_DATA);
+            for (int i = 0; i < n; i++) lote[i] = cola[i].valor;
+        }
+
+        memset(&proto, 0, sizeof(protocolo));
+        proto.cmd = CMD_TELEMETRIA;
+        int usadas = 0;
+        proto.lng = (BYTE)codificarTelemetria(secuencia, periodo_ms, lote, n, proto.data, LARGO_DATA, &usadas);
+
+        {
+            std::lock_guard<std::mutex> bloqueo(mutex);
+            // Las que no entraron conservan su llegada: la próxima espera cuenta desde ahí
+            cola.erase(cola.begin(), cola.begin() + usadas);
+        }
+
+        int largo = empaquetar(proto);
+        enviar(proto, largo);
+        muestras_enviadas += usadas;
+        bytes_enviados += largo;
+        printf("Telemetría: frame %u con %d muestras (%d bytes de datos).\n", secuencia, usadas, proto.lng);
+        secuencia++;
+    }
+
+    muestreo.join();
+    printf("Telemetría terminada: %lu muestras en %u frames, %.2f bytes/muestra, %lu descartadas.\n",
+           muestras_enviadas, secuencia,
+           muestras_enviadas ? (double)bytes_enviados / muestras_enviadas : 0.0, descartadas);
+}
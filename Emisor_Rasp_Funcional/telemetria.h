@@ -0,0 +1,86 @@
+/**
+ * @file telemetria.h
+ * @brief Telemetría continua de temperatura (CMD 8).
+ * @details En lugar de una temperatura como texto por frame (opción 4),
+ * se muestrea una fuente a una frecuencia fija y se juntan muchas
+ * muestras por frame, codificadas como:
+ *
+ *   [SEQ] [periodo_ms varint] [1ra muestra zigzag varint] [deltas zigzag varint...]
+ *
+ * Las muestras van en punto fijo (centésimas de grado). Como la temperatura
+ * cambia poco entre muestras, casi todos los deltas ocupan 1 byte.
+ */
+
+#ifndef TELEMETRIA_H
+#define TELEMETRIA_H
+
+#include "structProtocolo.h"
+#include <stdint.h>
+
+/**
+ * @brief Comando de los frames de telemetría.
+ */
+#define CMD_TELEMETRIA 8
+
+/**
+ * @brief Escala del punto fijo: 2350 = 23.50 °C.
+ */
+#define TELEMETRIA_ESCALA 100
+
+/**
+ * @brief Espera máxima para completar un frame antes de enviarlo igual (s).
+ */
+#define TELEMETRIA_LATENCIA_MAX_S 10.0
+
+/**
+ * @brief Muestras que se pueden acumular si la línea no da abasto.
+ * @details Si se llena, se descartan las más antiguas.
+ */
+#define TELEMETRIA_COLA_MAX 4096
+
+/**
+ * @brief Fuente de temperaturas: un archivo (un valor por línea) o un sensor simulado.
+ */
+typedef struct
+{
+    FILE* archivo;      // NULL = sensor simulado
+    unsigned long n;    // Muestras entregadas
+    unsigned semilla;   // Ruido del sensor simulado
+} fuenteTemperatura;
+
+/**
+ * @brief Abre la fuente. ruta = NULL o vacía usa el sensor simulado.
+ * @return false si no se pudo abrir el archivo.
+ */
+bool fuenteAbrir(fuenteTemperatura& fuente, const char* ruta);
+
+/**
+ * @brief Lee la próxima muestra. Al terminar el archivo vuelve al inicio.
+ */
+bool fuenteLeer(fuenteTemperatura& fuente, float hz, float& temperatura);
+
+void fuenteCerrar(fuenteTemperatura& fuente);
+
+/**
+ * @brief Convierte una temperatura a punto fijo, saturando al rango de int16_t.
+ */
+int16_t temperaturaAFijo(float temperatura);
+
+/**
+ * @brief Codifica todas las muestras que quepan en 'max_bytes'.
+ * @param usadas Devuelve cuántas muestras entraron.
+ * @return Bytes escritos en 'salida'.
+ */
+int codificarTelemetria(BYTE secuencia, uint16_t periodo_ms, const int16_t* muestras, int n,
+                        BYTE* salida, int max_bytes, int* usadas);
+
+/**
+ * @brief Muestrea la fuente durante 'duracion_s' y transmite los lotes.
+ * @details Un hilo muestrea a 'hz' mientras este hilo envía: así el
+ * muestreo no se detiene durante el tiempo de aire de cada frame.
+ * @param enviar Función que transmite un frame empaquetado.
+ */
+void transmitirTelemetria(fuenteTemperatura& fuente, float hz, float duracion_s,
+                          void (*enviar)(protocolo& proto, int largo));
+
+#endif // TELEMETRIA_H
@@ -0,0 +1,172 @@
+/**
+ * @file tiempoReal.cpp
+ * @brief Implementación del modo de tiempo real y de la sonda de latencia.
+ */
+
+#include "tiempoReal.h"
+#include "structProtocolo.h"
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+
+#define NS_POR_S 1000000000L
+
+static bool s_activo = false;
+
+/**
+ * @brief Último core de /sys/devices/system/cpu/isolated, o -1 si no hay.
+ * @details El archivo tiene listas como "2-3" o "1,3".
+ */
+static int ultimoCoreAislado() {
+    FILE* f = fopen("/sys/devices/system/cpu/isolated", "r");
+    if (f == NULL) return -1;
+    char linea[128] = {0};
+    bool leido = (fgets(linea, sizeof(linea), f) != NULL);
+    fclose(f);
+    if (!leido) return -1;
+
+    int ultimo = -1;
+    for (char* p = linea; *p != '\0'; p++) {
+        if (*p >= '0' && *p <= '9') {
+            int cpu = (int)strtol(p, &p, 10);
+            if (cpu > ultimo) ultimo = cpu;
+            p--;
+        }
+    }
+    return ultimo;
+}
+
+/**
+ * @brief Toca el stack para que sus páginas ya estén mapeadas (y bloqueadas).
+ */
+static void prefallarStack() {
+    volatile unsigned char stack[TR_STACK_PREFALLADO];
+    for (size_t i = 0; i < sizeof(stack); i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+bool activarTiempoReal(int prioridad, int cpu) {
+    bool ok = true;
+
+    // 1. Memoria: nada de lo que usa el proceso se puede ir a swap
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        printf("ERROR: mlockall: %s\n", strerror(errno));
+        ok = false;
+    }
+    prefallarStack();
+
+    // 2. Afinidad: un core aislado no recibe otras tareas del scheduler
+    int aislado = ultimoCoreAislado();
+    if (cpu < 0) {
+        cpu = (aislado >= 0) ? aislado : (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    }
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(cpu, &cores);
+    if (sched_setaffinity(0, sizeof(cores), &cores) != 0) {
+        printf("ERROR: no se pudo fijar el hilo al core %d: %s\n", cpu, strerror(errno));
+        ok = false;
+    } else if (aislado < 0) {
+        printf("Aviso: no hay cores aislados (isolcpus=); el core %d se comparte.\n", cpu);
+    }
+
+    // 3. Planificación: SCHED_FIFO desaloja a todo proceso normal
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = prioridad;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+        printf("ERROR: SCHED_FIFO %d: %s (¿se ejecutó como root?)\n", prioridad, strerror(errno));
+        ok = false;
+    }
+
+    s_activo = ok;
+    if (ok) {
+        printf("Tiempo real: SCHED_FIFO %d, core %d, memoria bloqueada.\n", prioridad, cpu);
+    }
+    return ok;
+}
+
+bool tiempoRealActivo() {
+    return s_activo;
+}
+
+static long percentil(const std::vector<long>& ordenadas, double p) {
+    size_t i = (size_t)(p * (ordenadas.size() - 1) + 0.5);
+    return ordenadas[i];
+}
+
+bool medirLatencia(int periodo_us, unsigned long muestras, resultadoLatencia& r) {
+    memset(&r, 0, sizeof(resultadoLatencia));
+    if (periodo_us <= 0 || muestras == 0) return false;
+
+    // Reservada antes de medir: en el bucle no hay ninguna asignación
+    std::vector<long> latencias(muestras);
+
+    struct timespec siguiente, ahora;
+    clock_gettime(CLOCK_MONOTONIC, &siguiente);
+    for (unsigned long i = 0; i < muestras; i++) {
+        siguiente.tv_nsec += periodo_us * 1000L;
+        while (siguiente.tv_nsec >= NS_POR_S) {
+            siguiente.tv_nsec -= NS_POR_S;
+            siguiente.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &siguiente, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &ahora);
+        long tarde_ns = (ahora.tv_sec - siguiente.tv_sec) * NS_POR_S +
+                        (ahora.tv_nsec - siguiente.tv_nsec);
+        latencias[i] = tarde_ns / 1000;
+    }
+
+    double suma = 0;
+    for (unsigned long i = 0; i < muestras; i++) suma += latencias[i];
+    std::sort(latencias.begin(), latencias.end());
+
+    r.muestras = muestras;
+    r.minimo_us = latencias.front();
+    r.p50_us = percentil(latencias, 0.50);
+    r.p90_us = percentil(latencias, 0.90);
+    r.p99_us = percentil(latencias, 0.99);
+    r.p999_us = percentil(latencias, 0.999);
+    r.maximo_us = latencias.back();
+    r.promedio_us = suma / muestras;
+    return true;
+}
+
+int velocidadSegura(const resultadoLatencia& r) {
+    static const int VELOCIDADES[NUM_VELOCIDADES] = VELOCIDADES_BPS;
+    // Un despertar puntual nunca es 0: 1 us como piso
+    long atraso_byte_us = SONDA_BITS_POR_BYTE * std::max(r.p999_us, 1L);
+
+    int segura = 0;
+    for (int i = 0; i < NUM_VELOCIDADES; i++) {
+        long bit_us = 1000000L / VELOCIDADES[i];
+        if (atraso_byte_us * SONDA_FRACCION_BIT <= bit_us) segura = VELOCIDADES[i];
+    }
+    return segura;
+}
+
+void imprimirLatencia(const resultadoLatencia& r) {
+    printf("--- Latencia de despertar (%lu muestras%s) ---\n", r.muestras,
+           s_activo ? ", tiempo real" : ", prioridad normal");
+    printf("min %ld | p50 %ld | p90 %ld | p99 %ld | p99.9 %ld | max %ld us (prom %.1f)\n",
+           r.minimo_us, r.p50_us, r.p90_us, r.p99_us, r.p999_us, r.maximo_us, r.promedio_us);
+
+    int segura = velocidadSegura(r);
+    if (segura == 0) {
+        printf("Ninguna velocidad de la escalera tiene margen con esta carga.\n");
+        return;
+    }
+    long bit_us = 1000000L / segura;
+    printf("Velocidad más alta con margen: %d bps (bit de %ld us).\n", segura, bit_us);
+    if (r.maximo_us * SONDA_BITS_POR_BYTE * SONDA_FRACCION_BIT > bit_us) {
+        printf("Aviso: el máximo (%ld us) supera el margen; puede haber frames con error.\n", r.maximo_us);
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ * @file tiempoReal.h
+ * @brief Modo de tiempo real opcional y sonda de latencia de despertar.
+ * @details Cada bit se temporiza con un delay(): si el kernel despierta tarde
+ * al proceso, el bit sale más largo. El modo de tiempo real reduce esa
+ * demora (SCHED_FIFO, memoria bloqueada, stack prefallado y el hilo fijo a
+ * un core, idealmente aislado con isolcpus=). La sonda la mide como
+ * cyclictest: duerme hasta instantes absolutos y registra cuánto tarde se
+ * despertó cada vez.
+ */
+
+#ifndef TIEMPO_REAL_H
+#define TIEMPO_REAL_H
+
+/**
+ * @brief Prioridad SCHED_FIFO por defecto (1..99).
+ * @details Por debajo de los hilos de interrupción del kernel (50) no
+ * alcanza; 80 queda por encima sin competir con el watchdog (99).
+ */
+#define TR_PRIORIDAD_DEFECTO 80
+
+/**
+ * @brief Stack que se toca al activar el modo para que no haya fallos de página después.
+ */
+#define TR_STACK_PREFALLADO (256 * 1024)
+
+/**
+ * @brief Parámetros por defecto de la sonda: 10000 despertares cada 1 ms.
+ */
+#define SONDA_PERIODO_US_DEFECTO 1000
+#define SONDA_MUESTRAS_DEFECTO 10000
+
+/**
+ * @brief Margen de la velocidad sugerida.
+ * @details El receptor muestrea en el centro del bit y se resincroniza con
+ * cada bit de inicio, así que dentro de un byte se acumulan los atrasos de
+ * 10 delay() hasta el último bit de parada. Se pide que esa suma (con la
+ * latencia p99.9) no pase de 1/4 de bit: bit >= 40 * p99.9.
+ */
+#define SONDA_BITS_POR_BYTE 10
+#define SONDA_FRACCION_BIT 4
+
+/**
+ * @brief Resultado de una medición, en microsegundos.
+ */
+typedef struct
+{
+    unsigned long muestras;
+    long minimo_us;
+    long p50_us;
+    long p90_us;
+    long p99_us;
+    long p999_us;
+    long maximo_us;
+    double promedio_us;
+} resultadoLatencia;
+
+/**
+ * @brief Activa el modo de tiempo real para el hilo que llama.
+ * @param prioridad Prioridad SCHED_FIFO (1..99).
+ * @param cpu Core al que se fija el hilo; -1 = el último core aislado
+ * (o el último core si no hay ninguno aislado).
+ * @return false si alguna parte falló (normalmente por falta de permisos).
+ */
+bool activarTiempoReal(int prioridad, int cpu);
+
+/**
+ * @brief Indica si el modo de tiempo real está activo.
+ */
+bool tiempoRealActivo();
+
+/**
+ * @brief Mide la latencia de despertar del hilo actual con la carga actual.
+ */
+bool medirLatencia(int periodo_us, unsigned long muestras, resultadoLatencia& r);
+
+/**
+ * @brief Velocidad más alta de la escalera cuyo bit cumple el margen.
+ * @return 0 si ni la velocidad más baja es segura.
+ */
+int velocidadSegura(const resultadoLatencia& r);
+
+/**
+ * @brief Imprime los percentiles y la velocidad sugerida.
+ */
+void imprimirLatencia(const resultadoLatencia& r);
+
+#endif // TIEMPO_REAL_H
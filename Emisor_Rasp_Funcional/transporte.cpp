@@ -0,0 +1,101 @@
+/**
+ * @file transporte.cpp
+ * @brief Implementación de los backends de transmisión.
+ */
+
+#include "transporte.h"
+#include "multiEnlace.h"
+#include "gpioMapeado.h"
+#include "formaOndaSpi.h"
+#include <stdio.h>
+#include <string.h>
+#include <wiringPi.h>
+
+// --- Backend "wiringpi": bit-banging con enviarFrame() ---
+
+static bool iniciarWiringPi(int pin) {
+    // Usamos 'wiringPiSetupGpio()' para referirnos a los pines por su número BCM.
+    if (wiringPiSetupGpio() == -1) {
+        printf("ERROR: No se pudo inicializar WiringPi. (¿Ejecutaste con sudo?)\n");
+        return false;
+    }
+    pinMode(pin, OUTPUT);
+    // Pone la línea en HIGH (estado de reposo) inmediatamente.
+    // Esto evita que el receptor (ESP32) detecte ruido al inicio.
+    digitalWrite(pin, HIGH);
+    return true;
+}
+
+static bool enviarWiringPi(int pin, int speed, protocolo& proto, int largo) {
+    enviarFrame(pin, speed, proto, largo, formatoIda());
+    return true;
+}
+
+// --- Backend "gpiomem": registros GPIO mapeados, sin wiringPi ni root ---
+// Ver gpioMapeado.h. Cada bit se espera hasta su instante absoluto.
+
+static bool iniciarGpiomem(int pin) {
+    if (g_gpio.registros == NULL && !gpioAbrir(g_gpio)) {
+        return false;
+    }
+    gpioModoSalida(g_gpio, pin);
+    gpioEscribir(g_gpio, 1u << pin, 0); // Reposo en HIGH
+    return true;
+}
+
+static bool enviarGpiomem(int pin, int speed, protocolo& proto, int largo) {
+    enviarFrameGpio(g_gpio, pin, speed, proto, largo, formatoIda());
+    return true;
+}
+
+// --- Backend "spi": el frame entero sale por el MOSI con un ioctl ---
+// Ver formaOndaSpi.h. Los flancos los temporiza el reloj del SPI.
+
+static bool iniciarSpi(int pin) {
+    if (g_spi.fd < 0 && !spiAbrir(g_spi)) {
+        return false;
+    }
+    printf("Transporte spi: la línea sale por el MOSI (GPIO10), no por el GPIO %d.\n", pin);
+    return true;
+}
+
+static bool enviarSpi(int pin, int speed, protocolo& proto, int largo) {
+    return enviarFrameSpi(g_spi, speed, proto, largo, formatoIda());
+}
+
+// --- Backend "nulo": descarta los frames ---
+// Sirve para medir el costo del emisor sin la línea (ej: reproducir
+// una captura a máxima velocidad o medir el registro de capturas).
+
+static bool iniciarNulo(int pin) {
+    return true;
+}
+
+static bool enviarNulo(int pin, int speed, protocolo& proto, int largo) {
+    return true;
+}
+
+static const transporte TRANSPORTES[] = {
+    {"wiringpi", iniciarWiringPi, enviarWiringPi},
+    {"gpiomem", iniciarGpiomem, enviarGpiomem},
+    {"spi", iniciarSpi, enviarSpi},
+    {"nulo", iniciarNulo, enviarNulo},
+    {"multienlace", iniciarMultiEnlace, enviarMultiEnlace}, // Ver multiEnlace.h
+};
+
+const transporte* g_transporte = &TRANSPORTES[0];
+
+const transporte* buscarTransporte(const char* nombre) {
+    for (size_t i = 0; i < sizeof(TRANSPORTES) / sizeof(TRANSPORTES[0]); ++i) {
+        if (strcmp(TRANSPORTES[i].nombre, nombre) == 0) {
+            return &TRANSPORTES[i];
+        }
+    }
+    return NULL;
+}
+
+void listarTransportes() {
+    for (size_t i = 0; i < sizeof(TRANSPORTES) / sizeof(TRANSPORTES[0]); ++i) {
+        printf("  %s\n", TRANSPORTES[i].nombre);
+    }
+}
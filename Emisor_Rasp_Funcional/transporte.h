@@ -0,0 +1,53 @@
+/**
+ * @file transporte.h
+ * @brief Backends de transmisión intercambiables del emisor.
+ * @details Todo lo que sale por la línea pasa por 'g_transporte', así el
+ * menú, la reproducción de capturas y las pruebas usan el mismo camino
+ * sin importar CÓMO se generan los bits (wiringPi, registros, SPI, etc.).
+ */
+
+#ifndef TRANSPORTE_H
+#define TRANSPORTE_H
+
+#include "funcionesProtocolo.h"
+
+/**
+ * @brief Un backend de transmisión.
+ */
+typedef struct
+{
+    /**
+     * @brief Nombre para elegirlo por línea de comandos (ej: "wiringpi").
+     */
+    const char* nombre;
+
+    /**
+     * @brief Inicializa el hardware y deja la línea en reposo (HIGH).
+     * @return false si no se pudo inicializar.
+     */
+    bool (*iniciar)(int pin);
+
+    /**
+     * @brief Transmite un frame ya empaquetado.
+     * @return false si el backend no pudo enviarlo.
+     */
+    bool (*enviar)(int pin, int speed, protocolo& proto, int largo);
+} transporte;
+
+/**
+ * @brief Backend activo (por defecto, wiringPi).
+ */
+extern const transporte* g_transporte;
+
+/**
+ * @brief Busca un backend por nombre.
+ * @return El backend, o NULL si no existe.
+ */
+const transporte* buscarTransporte(const char* nombre);
+
+/**
+ * @brief Imprime la lista de backends disponibles.
+ */
+void listarTransportes();
+
+#endif // TRANSPORTE_H
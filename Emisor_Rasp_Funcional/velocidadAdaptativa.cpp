@@ -0,0 +1,312 @@
+/**
+ * @file velocidadAdaptativa.cpp
+ * @brief Implementación del control adaptativo de velocidad.
+ */
+
+#include "velocidadAdaptativa.h"
+#include "funcionesProtocolo.h"
+#include "transporte.h"
+#include "recibeRetorno.h"
+#include "rpcEmisor.h"
+#include <wiringPi.h>
+#include <stdio.h>
+#include <string.h>
+
+static const int VELOCIDADES[NUM_VELOCIDADES] = VELOCIDADES_BPS;
+
+// --- Controlador ---
+
+void controlIniciar(controlVelocidad& c) {
+    memset(&c, 0, sizeof(controlVelocidad));
+    c.idx_max = NUM_VELOCIDADES - 1;
+    for (int i = 0; i < NUM_VELOCIDADES; i++) {
+        c.bloqueo_ms[i] = ADAPT_BLOQUEO_MIN_MS;
+    }
+}
+
+int velocidadDeEscalon(int idx) {
+    return VELOCIDADES[idx];
+}
+
+bool controlBloqueado(const controlVelocidad& c, int idx, unsigned long ahora_ms) {
+    return c.bloqueado[idx] && (long)(ahora_ms - c.bloqueo_hasta_ms[idx]) < 0;
+}
+
+/**
+ * @brief La velocidad 'idx' falló: se bloquea (al menos 'minimo_ms') y el
+ * próximo bloqueo se duplica, hasta 'maximo_ms'.
+ */
+static void penalizar(controlVelocidad& c, int idx, unsigned long ahora_ms, unsigned long minimo_ms,
+                      unsigned long maximo_ms) {
+    if (c.bloqueo_ms[idx] < minimo_ms) c.bloqueo_ms[idx] = minimo_ms;
+    c.bloqueado[idx] = true;
+    c.bloqueo_hasta_ms[idx] = ahora_ms + c.bloqueo_ms[idx];
+    c.bloqueo_ms[idx] *= 2;
+    if (c.bloqueo_ms[idx] > maximo_ms) c.bloqueo_ms[idx] = maximo_ms;
+}
+
+/**
+ * @brief El escalón de arriba se puede probar: no es el techo ni está bloqueado.
+ */
+static bool puedeSubir(const controlVelocidad& c, unsigned long ahora_ms) {
+    int siguiente = c.idx + 1;
+    return siguiente <= c.idx_max && !controlBloqueado(c, siguiente, ahora_ms);
+}
+
+int controlFramesVentana(const controlVelocidad& c, unsigned long ahora_ms) {
+    return puedeSubir(c, ahora_ms) ? ADAPT_VENTANA_SONDEO : ADAPT_VENTANA;
+}
+
+int controlDecidir(controlVelocidad& c, int enviados, int ok, bool hubo_reporte, unsigned long ahora_ms) {
+    c.ventana++;
+    int fallos = hubo_reporte ? enviados - ok : enviados;
+    if (fallos < 0) fallos = 0;
+
+    if (fallos >= ADAPT_FALLOS_BAJAR) {
+        c.ventanas_limpias = 0;
+        if (c.idx == 0) return 0;
+        penalizar(c, c.idx, ahora_ms, ADAPT_BLOQUEO_CAIDA_MS, ADAPT_BLOQUEO_CAIDA_MAX_MS);
+        return -1;
+    }
+
+    if (fallos > 0) {
+        c.ventanas_limpias = 0;
+        return 0;
+    }
+
+    c.ventanas_limpias++;
+    if (c.ventanas_limpias >= ADAPT_VENTANAS_ESTABLE) {
+        // Mucho tiempo estable aquí: esta velocidad vuelve al bloqueo mínimo
+        c.bloqueo_ms[c.idx] = ADAPT_BLOQUEO_MIN_MS;
+    }
+    if (c.ventanas_limpias >= ADAPT_VENTANAS_SUBIR) {
+        if (puedeSubir(c, ahora_ms)) {
+            c.ventanas_limpias = 0;
+            return +1;
+        }
+    }
+    return 0;
+}
+
+// --- Protocolo con el receptor ---
+
+int g_velocidad = SPEED;
+bool g_adaptativo_activo = false;
+bool g_enlace_avisos = true;
+
+static controlVelocidad s_control;
+static int s_pin_retorno = RX_RETORNO_PIN;
+static int s_enviados = 0;   // Frames de datos en la ventana actual
+static BYTE s_secuencia = 0;
+static unsigned long s_cambios = 0;
+static unsigned long s_resincronizaciones = 0;
+static unsigned long s_rechazados = 0;   // Cambios que no anduvieron, sin resincronizar
+
+BYTE enlaceProximaSecuencia() {
+    return ++s_secuencia;
+}
+
+void enlaceEnviarControl(protocolo& proto) {
+    int largo = empaquetar(proto);
+    g_transporte->enviar(TX_PIN, g_velocidad, proto, largo);
+}
+
+/**
+ * @details El timeout alcanza para un REPORTE (el frame más largo) a la
+ * velocidad actual, más el tiempo que tarda la ESP32 en atenderlo.
+ */
+bool enlaceEsperarRespuesta(BYTE subtipo, BYTE secuencia, protocolo& respuesta) {
+    const int BYTES_REPORTE = 9 + BYTES_EXTRA;
+    unsigned long timeout_ms = (BYTES_REPORTE * 11 + 1) * 1000UL / g_velocidad + 500;
+    // Con --rpc la línea de retorno la lee el hilo lector de rpcEmisor
+    bool llego = g_rpc_activo ? rpcOtroFrame(respuesta, timeout_ms)
+                              : recibirRetorno(s_pin_retorno, g_velocidad, respuesta, timeout_ms);
+    if (!llego) return false;
+
+    int pos_secuencia = (subtipo == ENLACE_CONFIRMA) ? 2 : 1;
+    return respuesta.cmd == CMD_ENLACE && respuesta.lng > pos_secuencia &&
+           respuesta.data[0] == subtipo && respuesta.data[pos_secuencia] == secuencia;
+}
+
+/**
+ * @details ok = frames válidos desde el reporte anterior.
+ */
+bool enlaceConsultar(int& ok, int& idx_receptor, int& bits_parada, int& fcs) {
+    protocolo proto;
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = CMD_ENLACE;
+    proto.data[0] = ENLACE_CONSULTA;
+    proto.data[1] = enlaceProximaSecuencia();
+    proto.lng = 2;
+    enlaceEnviarControl(proto);
+
+    protocolo respuesta;
+    if (!enlaceEsperarRespuesta(ENLACE_REPORTE, s_secuencia, respuesta) || respuesta.lng < 7) {
+        return false;
+    }
+    ok = (respuesta.data[2] << 8) | respuesta.data[3];
+    idx_receptor = respuesta.data[6];
+    bits_parada = (respuesta.lng >= 9) ? respuesta.data[7] : -1;
+    fcs = (respuesta.lng >= 9) ? respuesta.data[8] : -1;
+    return true;
+}
+
+static bool consultar(int& ok, int& idx_receptor) {
+    int bits_parada, fcs;
+    return enlaceConsultar(ok, idx_receptor, bits_parada, fcs);
+}
+
+void enlaceResincronizar() {
+    s_resincronizaciones++;
+    g_velocidad = VELOCIDADES[0];
+    g_config_enlace = CONFIGURACION_BASE; // El receptor vuelve a la base entera
+    s_control.idx = 0;
+    s_enviados = 0;
+
+    for (int intento = 0; intento < ADAPT_INTENTOS_RESYNC; intento++) {
+        delay(ADAPT_SILENCIO_MS); // El receptor sale de flushRX y detecta los fallos
+        int ok, idx_receptor;
+        if (consultar(ok, idx_receptor) && idx_receptor == 0) {
+            if (g_enlace_avisos) printf("Enlace: resincronizado a %d bps.\n", g_velocidad);
+            return;
+        }
+    }
+    if (g_enlace_avisos) printf("Enlace: el receptor no responde, se sigue a %d bps.\n", g_velocidad);
+}
+
+/**
+ * @brief Cómo terminó un pedido de cambio de escalón.
+ */
+enum resultadoCambio
+{
+    CAMBIO_HECHO,       // Las dos puntas en el escalón nuevo
+    CAMBIO_RECHAZADO,   // No anduvo y las dos volvieron al de antes (controlEnlace.h)
+    CAMBIO_PERDIDO      // No se sabe dónde quedó el receptor: hay que resincronizar
+};
+
+/**
+ * @brief Negocia el cambio al escalón 'idx' y lo verifica con una consulta.
+ * @details Si la consulta a la velocidad nueva no vuelve, el receptor ya
+ * regresó a la anterior (o lo hace al vencer la prueba): se lo verifica
+ * ahí antes de dar el estado por perdido.
+ */
+static resultadoCambio cambiarVelocidad(int idx) {
+    protocolo proto;
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = CMD_ENLACE;
+    proto.data[0] = ENLACE_CAMBIO;
+    proto.data[1] = (BYTE)idx;
+    proto.data[2] = enlaceProximaSecuencia();
+    proto.lng = 3;
+    enlaceEnviarControl(proto);
+
+    protocolo respuesta;
+    if (!enlaceEsperarRespuesta(ENLACE_CONFIRMA, s_secuencia, respuesta) || respuesta.data[1] != idx) {
+        return CAMBIO_PERDIDO; // Sin confirmación: no se sabe en qué velocidad quedó el receptor
+    }
+
+    int anterior = s_control.idx;
+    g_velocidad = VELOCIDADES[idx];
+    s_control.idx = idx;
+    s_cambios++;
+
+    // El primer frame a la nueva velocidad confirma el cambio en el receptor
+    int ok, idx_receptor;
+    if (consultar(ok, idx_receptor) && idx_receptor == idx) return CAMBIO_HECHO;
+
+    g_velocidad = VELOCIDADES[anterior];
+    s_control.idx = anterior;
+    delay(ADAPT_SILENCIO_MS); // El receptor descarta lo que leyó mal y sale de flushRX
+    if (consultar(ok, idx_receptor) && idx_receptor == anterior) {
+        s_rechazados++;
+        return CAMBIO_RECHAZADO;
+    }
+    return CAMBIO_PERDIDO;
+}
+
+/**
+ * @brief Después de caer a SPEED, salta directo al escalón no bloqueado más
+ * alto con la mitad (o menos) de la velocidad que falló, en vez de volver a
+ * subir de a uno desde la base. Si el salto también falla se bloquea y se
+ * vuelve a partir a la mitad. Los escalones salteados no quedan bloqueados:
+ * con la ventana de sondeo se vuelven a probar enseguida.
+ */
+static void recuperar(int fallido) {
+    enlaceResincronizar();
+    for (int destino = fallido - 1; destino > 0; destino--) {
+        if (controlBloqueado(s_control, destino, millis())) continue;
+        if (2 * VELOCIDADES[destino] > VELOCIDADES[fallido]) continue;
+        resultadoCambio r = cambiarVelocidad(destino);
+        if (r == CAMBIO_HECHO) {
+            if (g_enlace_avisos) printf("Enlace: %d bps.\n", g_velocidad);
+            return;
+        }
+        penalizar(s_control, destino, millis(), ADAPT_BLOQUEO_MIN_MS, ADAPT_BLOQUEO_MAX_MS);
+        if (r == CAMBIO_PERDIDO) enlaceResincronizar();
+        fallido = destino;
+    }
+}
+
+void enlacePrepararRetorno(int pin_retorno) {
+    s_pin_retorno = pin_retorno;
+    iniciarRecepcionRetorno(pin_retorno);
+}
+
+bool adaptativoIniciar(int pin_retorno) {
+    enlacePrepararRetorno(pin_retorno);
+    controlIniciar(s_control);
+    g_velocidad = VELOCIDADES[0];
+    s_enviados = 0;
+    g_adaptativo_activo = true;
+    return true;
+}
+
+void adaptativoDespuesDeEnviar() {
+    if (!g_adaptativo_activo || ++s_enviados < controlFramesVentana(s_control, millis())) return;
+
+    // Si el último frame falló, el receptor está en flushRX esperando 1 s
+    // de silencio: una consulta enviada enseguida se perdería.
+    delay(ADAPT_SILENCIO_MS);
+
+    int ok = 0, idx_receptor = -1;
+    bool hubo_reporte = consultar(ok, idx_receptor);
+    int enviados = s_enviados + 1; // + la consulta
+    s_enviados = 0;
+
+    if (!hubo_reporte || idx_receptor != s_control.idx) {
+        int fallido = s_control.idx;
+        controlDecidir(s_control, enviados, 0, false, millis());
+        recuperar(fallido);
+        return;
+    }
+
+    int accion = controlDecidir(s_control, enviados, ok, true, millis());
+    if (accion == 0) return;
+
+    int destino = s_control.idx + accion;
+    resultadoCambio r = cambiarVelocidad(destino);
+    if (r == CAMBIO_HECHO) {
+        if (g_enlace_avisos) printf("Enlace: %d bps.\n", g_velocidad);
+    } else if (accion > 0) {
+        // Subir no anduvo: se bloquea ese escalón y, si las dos puntas
+        // volvieron juntas, se sigue donde se estaba sin pasar por SPEED
+        penalizar(s_control, destino, millis(), ADAPT_BLOQUEO_MIN_MS, ADAPT_BLOQUEO_MAX_MS);
+        if (r == CAMBIO_PERDIDO) recuperar(destino);
+    } else {
+        recuperar(s_control.idx);
+    }
+}
+
+void adaptativoAcordar(int idx) {
+    g_velocidad = VELOCIDADES[idx];
+    s_control.idx = idx;
+    s_control.idx_max = idx;
+    s_control.ventanas_limpias = 0;
+    s_enviados = 0;
+}
+
+void adaptativoImprimir() {
+    printf("--- Velocidad adaptativa ---\n");
+    printf("Velocidad actual: %d bps | Cambios: %lu (%lu no anduvieron) | Resincronizaciones: %lu\n",
+           g_velocidad, s_cambios, s_rechazados, s_resincronizaciones);
+}
@@ -0,0 +1,206 @@
+/**
+ * @file velocidadAdaptativa.h
+ * @brief Control adaptativo de la velocidad de la línea (CMD 10).
+ * @details SPEED = 10 bps es la velocidad que funciona siempre, pero con la
+ * línea limpia se puede ir mucho más rápido. Con --adaptativo, cada
+ * ventana de frames el emisor consulta al receptor cuántos llegaron bien
+ * (la respuesta vuelve por la línea de retorno) y decide:
+ * - Subir un escalón tras ADAPT_VENTANAS_SUBIR ventanas sin fallos.
+ * - Bajar un escalón con ADAPT_FALLOS_BAJAR fallos en una ventana.
+ * - Histéresis: la velocidad que falló queda bloqueada un tiempo que se
+ *   duplica cada vez que vuelve a fallar. Es tiempo y no ventanas porque
+ *   una ventana a 10 bps dura lo que veinte a 250: contado en ventanas, un
+ *   bloqueo puesto en la base duraba más que el ruido que lo causó.
+ * - La ventana es de ADAPT_VENTANA_SONDEO frames mientras el escalón de
+ *   arriba se puede probar, y de ADAPT_VENTANA cuando no: a 10 bps una
+ *   ventana de 8 frames son 7 minutos, y subir de a uno desde la base
+ *   llevaba más de un cuarto de hora con la línea limpia.
+ * - Tras caer a SPEED se salta al escalón no bloqueado más alto con la
+ *   mitad de la velocidad que falló; si ese tampoco anda se vuelve a partir
+ *   a la mitad (no se queda en SPEED por un solo intento fallido).
+ *
+ * Protocolo (payload del CMD 10, igual que en Receptor_Esp32/controlEnlace.h):
+ *
+ *   CAMBIO   [0][idx][seq]                     emisor -> receptor
+ *   CONFIRMA [1][idx][seq]                     receptor -> emisor
+ *   CONSULTA [2][seq]                          emisor -> receptor
+ *   REPORTE  [3][seq][ok 2B][errores 2B][idx][bits_parada][fcs]  receptor -> emisor
+ *   NEGOCIA / ACUERDO                          ver negociacionEmisor.h
+ *
+ * Los receptores que no negocian mandan el REPORTE sin los dos últimos bytes.
+ * Si no llega la confirmación o un reporte, el emisor vuelve a SPEED (y a
+ * CONFIGURACION_BASE) y espera a que el receptor haga lo mismo (ver controlEnlace.h).
+ * Si el cambio se confirmó pero la consulta a la velocidad nueva no vuelve,
+ * las dos puntas regresan a la velocidad de antes del cambio, sin pasar por SPEED.
+ */
+
+#ifndef VELOCIDAD_ADAPTATIVA_H
+#define VELOCIDAD_ADAPTATIVA_H
+
+#include "structProtocolo.h"
+
+/**
+ * @brief Comando de control del enlace.
+ */
+#define CMD_ENLACE 10
+
+#define ENLACE_CAMBIO 0
+#define ENLACE_CONFIRMA 1
+#define ENLACE_CONSULTA 2
+#define ENLACE_REPORTE 3
+
+/**
+ * @brief Frames de datos por ventana de evaluación.
+ */
+#define ADAPT_VENTANA 8
+
+/**
+ * @brief Frames por ventana mientras el escalón de arriba se puede probar.
+ */
+#define ADAPT_VENTANA_SONDEO 1
+
+/**
+ * @brief Ventanas seguidas sin fallos para subir un escalón.
+ */
+#define ADAPT_VENTANAS_SUBIR 1
+
+/**
+ * @brief Ventanas seguidas sin fallos para que una velocidad que falló
+ * vuelva al bloqueo mínimo (con menos, una velocidad que pierde la mitad
+ * de los frames se reintentaba cada ADAPT_BLOQUEO_MIN_MS).
+ */
+#define ADAPT_VENTANAS_ESTABLE 8
+
+/**
+ * @brief Fallos en una ventana para bajar un escalón.
+ */
+#define ADAPT_FALLOS_BAJAR 2
+
+/**
+ * @brief Bloqueo inicial y máximo (en ms) de una velocidad que falló.
+ * @details Un cambio que no anduvo cuesta unos segundos (las dos puntas
+ * vuelven solas a la anterior): bloqueo corto. Una velocidad que anduvo y
+ * después cayó en uso (CAIDA) cuesta una ventana perdida y una
+ * resincronización en SPEED: bloqueo más largo.
+ */
+#define ADAPT_BLOQUEO_MIN_MS 120000UL
+#define ADAPT_BLOQUEO_MAX_MS 480000UL
+#define ADAPT_BLOQUEO_CAIDA_MS 480000UL
+#define ADAPT_BLOQUEO_CAIDA_MAX_MS 960000UL
+
+/**
+ * @brief Silencio antes de cada intento de resincronización (el receptor
+ * necesita 1 s de línea quieta para salir de flushRX).
+ */
+#define ADAPT_SILENCIO_MS 1500
+#define ADAPT_INTENTOS_RESYNC 5
+
+/**
+ * @brief Estado del controlador. No toca la línea: se puede probar en el PC.
+ */
+typedef struct
+{
+    int idx;                               // Escalón actual
+    int idx_max;                           // Techo acordado con el receptor (negociacionEmisor.h)
+    int ventana;                           // Ventanas evaluadas
+    int ventanas_limpias;                  // Seguidas sin fallos
+    bool bloqueado[NUM_VELOCIDADES];       // Falló alguna vez (bloqueo_hasta_ms vale)
+    unsigned long bloqueo_hasta_ms[NUM_VELOCIDADES]; // No subir a ese escalón antes de este millis()
+    unsigned long bloqueo_ms[NUM_VELOCIDADES];       // Próximo bloqueo si vuelve a fallar
+} controlVelocidad;
+
+void controlIniciar(controlVelocidad& c);
+
+/**
+ * @brief Frames de datos de la ventana que empieza (ADAPT_VENTANA_SONDEO o ADAPT_VENTANA).
+ */
+int controlFramesVentana(const controlVelocidad& c, unsigned long ahora_ms);
+
+/**
+ * @brief Si el escalón 'idx' todavía está bloqueado por un fallo.
+ */
+bool controlBloqueado(const controlVelocidad& c, int idx, unsigned long ahora_ms);
+
+/**
+ * @brief Evalúa una ventana.
+ * @param enviados Frames enviados en la ventana (incluida la consulta).
+ * @param ok Frames que el receptor reportó como válidos.
+ * @param hubo_reporte false si no llegó el reporte.
+ * @param ahora_ms millis(): los bloqueos se cuentan en tiempo.
+ * @return +1 subir, -1 bajar, 0 mantener.
+ */
+int controlDecidir(controlVelocidad& c, int enviados, int ok, bool hubo_reporte, unsigned long ahora_ms);
+
+/**
+ * @brief bps de un escalón de la escalera.
+ */
+int velocidadDeEscalon(int idx);
+
+/**
+ * @brief Velocidad actual de la línea de ida (y de retorno).
+ */
+extern int g_velocidad;
+extern bool g_adaptativo_activo;
+
+/**
+ * @brief Si se imprimen los cambios de velocidad y las resincronizaciones
+ * (el simulador lo apaga para que no se mezclen con sus tablas).
+ */
+extern bool g_enlace_avisos;
+
+/**
+ * @brief Prepara la línea de retorno y arranca en SPEED.
+ */
+bool adaptativoIniciar(int pin_retorno);
+
+/**
+ * @brief Se llama después de cada frame de datos enviado. Al cerrar una
+ * ventana consulta al receptor y, si corresponde, cambia la velocidad.
+ */
+void adaptativoDespuesDeEnviar();
+
+/**
+ * @brief Imprime la velocidad actual y cuántos cambios hubo.
+ */
+void adaptativoImprimir();
+
+// --- Compartido con la negociación (negociacionEmisor.cpp) ---
+
+/**
+ * @brief Prepara la línea de retorno donde llegan las respuestas CMD 10.
+ */
+void enlacePrepararRetorno(int pin_retorno);
+
+/**
+ * @brief Número de secuencia para el próximo pedido CMD 10.
+ */
+BYTE enlaceProximaSecuencia();
+
+/**
+ * @brief Empaqueta y envía un frame de control a la velocidad actual.
+ */
+void enlaceEnviarControl(protocolo& proto);
+
+/**
+ * @brief Espera la respuesta CMD 10 del subtipo y la secuencia indicados
+ * por la línea de retorno (o del hilo lector, con --rpc).
+ */
+bool enlaceEsperarRespuesta(BYTE subtipo, BYTE secuencia, protocolo& respuesta);
+
+/**
+ * @brief Pide un REPORTE. 'bits_parada' y 'fcs' quedan en -1 si el
+ * receptor no los informa (no negocia).
+ */
+bool enlaceConsultar(int& ok, int& idx_receptor, int& bits_parada, int& fcs);
+
+/**
+ * @brief Vuelve a SPEED y CONFIGURACION_BASE y consulta hasta que el receptor responda ahí.
+ */
+void enlaceResincronizar();
+
+/**
+ * @brief Después de un acuerdo: la velocidad pasa a 'idx' y el adaptativo no sube de ahí.
+ */
+void adaptativoAcordar(int idx);
+
+#endif // VELOCIDAD_ADAPTATIVA_H
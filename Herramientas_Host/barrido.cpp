@@ -0,0 +1,570 @@
+/**
+ * @file barrido.cpp
+ * @brief Barrido paralelo de parámetros de la línea: velocidad, bits de
+ * parada, punto de muestreo, FCS y ruido.
+ * @details Cada celda de la grilla transmite N frames al azar con el
+ * empaquetar()/enviarFrame() reales del emisor sobre una línea virtual,
+ * les agrega el ruido de la celda y los recibe con recibirFrame() y
+ * desempaquetar() del receptor, incluido el flushRX() después de un error.
+ * Por celda se mide:
+ *  - goodput: bits de payload entregados bien por segundo de línea ocupada
+ *    (sin contar la pausa entre frames, que depende del uso y no del formato),
+ *  - BER: bits distintos en los frames que se recibieron sincronizados,
+ *  - no detectados: frames aceptados por el FCS con contenido distinto del
+ *    enviado (o que nadie envió), sobre los enviados.
+ *
+ * Las celdas se reparten entre todos los cores con robo de trabajo: cada
+ * hilo tiene su cola y cuando se vacía le saca celdas a otro. La línea
+ * virtual es de cada hilo (halHost.h) y cada celda usa una semilla que
+ * depende solo de su índice, así el resultado no cambia con los hilos.
+ */
+
+#include "Arduino.h"
+#include "halHost.h"
+#include "recibe.h"
+#include "funcionesProtocolo.h"
+#include "histogramaFlancos.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+
+#define PIN_SIMULADO 0
+#define PAUSA_MS 1200                 // Entre frames: más que el silencio de flushRX()
+#define SILENCIO_FLUSH_MS 1000        // El de flushRX()
+#define GLITCH_MIN_NS 50000LL         // Duración de un pulso de ruido: 50 us ...
+#define GLITCH_MAX_NS 1000000LL       // ... a 1 ms
+#define NS_POR_S 1000000000LL
+
+// FCS de la celda
+#define FCS_CONTEO 0                  // FrameEstandar: el de producción
+#define FCS_CRC16 1
+static const char* const NOMBRE_FCS[] = {"conteo", "crc16"};
+
+typedef Frame<63, FcsCrc16> FrameCrc16;
+static_assert(FrameCrc16::LARGO_MAX == LARGO_FRAME, "el frame con CRC-16 tiene que entrar en el buffer");
+
+typedef struct
+{
+    int velocidad;
+    FormatoLinea formato;
+    int fcs;
+    int jitter_us;            // Atraso medio de cada delay() del emisor
+    double glitches_por_s;    // Pulsos que invierten la línea
+} celdaBarrido;
+
+typedef struct
+{
+    unsigned long enviados;
+    unsigned long entregados;     // Aceptados e iguales al enviado
+    unsigned long rechazados;     // Sincronizados pero con FCS distinto
+    unsigned long desincronizados;
+    unsigned long no_detectados;
+    unsigned long long bits_comparados;
+    unsigned long long bits_errados;
+    unsigned long long bits_payload;
+    int64_t aire_ns;              // Línea ocupada por los frames enviados
+} resultadoCelda;
+
+typedef struct
+{
+    std::vector<int> velocidades;
+    std::vector<int> paradas;
+    std::vector<int> muestreos;
+    std::vector<int> fcs;
+    std::vector<int> jitters_us;
+    std::vector<double> glitches;
+    int frames;
+    int hilos;
+    uint64_t semilla;
+    bool json;
+    bool escalado;
+    const char* salida;
+} opcionesBarrido;
+
+/**
+ * @brief Frame transmitido: cuándo empezó y qué bytes llevaba.
+ */
+typedef struct
+{
+    int64_t t_inicio;
+    int largo;
+    BYTE frame[LARGO_FRAME];
+} frameEnviado;
+
+// ===================== Azar reproducible =====================
+
+static uint64_t mezclar(uint64_t x) {
+    // splitmix64: semillas distintas y bien repartidas para índices seguidos
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t azar(uint64_t& estado) {
+    estado ^= estado << 13;
+    estado ^= estado >> 7;
+    estado ^= estado << 17;
+    return estado;
+}
+
+static double azarUniforme(uint64_t& estado) {
+    return ((azar(estado) >> 11) + 0.5) / 9007199254740992.0; // (0, 1)
+}
+
+// ===================== Una celda =====================
+
+/**
+ * @brief Invierte la línea en pulsos al azar (Poisson, 'por_s' por segundo).
+ * @details Cada pulso son dos cambios; donde se superponen se cancelan.
+ */
+static void agregarRuido(lineaVirtual& linea, double por_s, uint64_t& estado) {
+    if (por_s <= 0.0) return;
+    std::vector<int64_t> cambios;
+    double t = 0.0;
+    for (;;) {
+        t += -log(azarUniforme(estado)) * NS_POR_S / por_s;
+        if (t >= linea.fin_ns) break;
+        int64_t ini = (int64_t)t;
+        int64_t dur = GLITCH_MIN_NS + (int64_t)(azarUniforme(estado) * (GLITCH_MAX_NS - GLITCH_MIN_NS));
+        cambios.push_back(ini);
+        cambios.push_back(ini + dur);
+    }
+    std::sort(cambios.begin(), cambios.end());
+
+    std::vector<flanco> resultado;
+    resultado.reserve(linea.flancos.size() + cambios.size());
+    int original = linea.nivel_reposo;
+    int invertido = 0;
+    int nivel = original;
+    size_t i = 0, j = 0;
+    while (i < linea.flancos.size() || j < cambios.size()) {
+        int64_t t_ev;
+        if (j >= cambios.size() || (i < linea.flancos.size() && linea.flancos[i].t_ns <= cambios[j])) {
+            t_ev = linea.flancos[i].t_ns;
+            original = linea.flancos[i].nivel;
+            i++;
+        } else {
+            t_ev = cambios[j];
+            invertido ^= 1;
+            j++;
+        }
+        int nuevo = original ^ invertido;
+        if (nuevo != nivel) {
+            flanco f = {t_ev, (uint8_t)nuevo};
+            resultado.push_back(f);
+            nivel = nuevo;
+        }
+    }
+    linea.flancos.swap(resultado);
+}
+
+/**
+ * @brief Bits distintos entre lo enviado y lo recibido. Los bytes que
+ * faltan o sobran cuentan enteros.
+ */
+static unsigned bitsDistintos(const frameEnviado& tx, const frameReceptor& rx, int largo_rx) {
+    int comun = std::min(tx.largo, largo_rx);
+    unsigned distintos = 8 * (unsigned)abs(tx.largo - largo_rx);
+    for (int i = 0; i < comun; i++) {
+        distintos += bitsEnUno(tx.frame[i] ^ rx.frame[i]);
+    }
+    return distintos;
+}
+
+static bool fcsAceptado(const celdaBarrido& c, frameReceptor& rx) {
+    if (c.fcs == FCS_CRC16) return FrameCrc16::fcsValido(rx.frame, rx.lng);
+    return desempaquetar(rx);
+}
+
+static void simularCelda(const celdaBarrido& c, int frames, uint64_t semilla, resultadoCelda& r) {
+    memset(&r, 0, sizeof(r));
+    uint64_t estado = semilla | 1;
+    lineaVirtual linea;
+    linea.jitter_medio_ns = (int64_t)c.jitter_us * 1000;
+    linea.semilla_jitter = mezclar(semilla) | 1;
+    halUsarLinea(&linea);
+
+    // --- Emisor: todos los frames, con la pausa de la opción 2 entre medio ---
+    std::vector<frameEnviado> enviados(frames);
+    for (int k = 0; k < frames; k++) {
+        protocolo tx;
+        memset(&tx, 0, sizeof(protocolo));
+        tx.cmd = (BYTE)(azar(estado) % (FrameEstandar::CMD_MAX + 1));
+        tx.lng = (BYTE)(1 + azar(estado) % FrameEstandar::PAYLOAD_MAX);
+        for (int i = 0; i < tx.lng; i++) tx.data[i] = (BYTE)azar(estado);
+
+        int largo = (c.fcs == FCS_CRC16) ? FrameCrc16::codificar(tx.frame, tx.cmd, tx.data, tx.lng)
+                                         : empaquetar(tx);
+        // La pausa va antes: una bajada en t = 0 no se vería como bit de inicio
+        linea.ahora_ns += (int64_t)PAUSA_MS * 1000000;
+        frameEnviado& e = enviados[k];
+        e.t_inicio = linea.ahora_ns;
+        e.largo = largo;
+        memcpy(e.frame, tx.frame, largo);
+
+        enviarFrame(PIN_SIMULADO, c.velocidad, tx, largo, c.formato);
+        r.aire_ns += linea.ahora_ns - e.t_inicio;
+    }
+    r.enviados = frames;
+    linea.fin_ns = linea.ahora_ns + (int64_t)PAUSA_MS * 1000000;
+    agregarRuido(linea, c.glitches_por_s, estado);
+
+    // --- Receptor: como decodificador.cpp, salta el reposo hasta cada bajada ---
+    linea.jitter_medio_ns = 0; // El reloj de la ESP32 es preciso
+    linea.cursor = 0;
+    const int64_t medio_bit_ns = (int64_t)(1000 / c.velocidad) * 1000000 / 2;
+    size_t proximo = 0; // Primer enviado que todavía puede aparecer
+    int64_t t = 0;
+    for (;;) {
+        int64_t inicio = lineaProximaBajada(linea, t);
+        if (inicio < 0) break;
+        linea.ahora_ns = inicio;
+
+        frameReceptor rx;
+        bool sincronizado;
+        try {
+            sincronizado = recibirFrame(RX_PIN, c.velocidad, rx, c.formato);
+        } catch (const finDeLinea&) {
+            break;
+        }
+        t = linea.ahora_ns;
+
+        // ¿Qué frame enviado es? El que empezó a menos de medio bit
+        while (proximo < enviados.size() && enviados[proximo].t_inicio < inicio - medio_bit_ns) proximo++;
+        const frameEnviado* tx = NULL;
+        if (proximo < enviados.size() && enviados[proximo].t_inicio <= inicio + medio_bit_ns) {
+            tx = &enviados[proximo++];
+        }
+
+        if (!sincronizado) {
+            r.desincronizados++;
+        } else {
+            int largo_rx = FrameEstandar::largo(rx.lng);
+            if (tx != NULL) {
+                r.bits_comparados += 8ULL * tx->largo;
+                r.bits_errados += bitsDistintos(*tx, rx, largo_rx);
+            }
+            // desempaquetar() pisa el primer byte del FCS: se compara antes
+            bool igual = (tx != NULL && largo_rx == tx->largo && memcmp(tx->frame, rx.frame, largo_rx) == 0);
+            if (!fcsAceptado(c, rx)) {
+                r.rechazados++;
+            } else if (igual) {
+                r.entregados++;
+                r.bits_payload += 8ULL * rx.lng;
+                continue;
+            } else {
+                r.no_detectados++;
+            }
+        }
+
+        // Error: flushRX()
+        t = lineaFinSilencio(linea, t, (int64_t)SILENCIO_FLUSH_MS * 1000000);
+        if (t < 0) break;
+    }
+    halUsarLinea(NULL);
+}
+
+// ===================== Grilla y hilos =====================
+
+static std::vector<celdaBarrido> armarGrilla(const opcionesBarrido& op) {
+    std::vector<celdaBarrido> grilla;
+    for (size_t a = 0; a < op.velocidades.size(); a++)
+    for (size_t b = 0; b < op.paradas.size(); b++)
+    for (size_t m = 0; m < op.muestreos.size(); m++)
+    for (size_t f = 0; f < op.fcs.size(); f++)
+    for (size_t j = 0; j < op.jitters_us.size(); j++)
+    for (size_t g = 0; g < op.glitches.size(); g++) {
+        celdaBarrido c;
+        c.velocidad = op.velocidades[a];
+        c.formato.bits_parada = op.paradas[b];
+        c.formato.muestreo_pct = op.muestreos[m];
+        c.fcs = op.fcs[f];
+        c.jitter_us = op.jitters_us[j];
+        c.glitches_por_s = op.glitches[g];
+        grilla.push_back(c);
+    }
+    return grilla;
+}
+
+/**
+ * @brief Cola de celdas de un hilo. El dueño saca del final y los demás
+ * roban del principio: así el dueño sigue con celdas vecinas y el que roba
+ * se lleva las que el dueño tardaría más en alcanzar.
+ */
+typedef struct
+{
+    std::mutex mutex;
+    std::deque<size_t> celdas;
+} colaTrabajo;
+
+static bool tomarCelda(std::vector<colaTrabajo>& colas, int propia, size_t& celda) {
+    {
+        std::lock_guard<std::mutex> lock(colas[propia].mutex);
+        if (!colas[propia].celdas.empty()) {
+            celda = colas[propia].celdas.back();
+            colas[propia].celdas.pop_back();
+            return true;
+        }
+    }
+    // Vacía: robar, empezando por la cola siguiente para no ir todos a la misma
+    int n = (int)colas.size();
+    for (int k = 1; k < n; k++) {
+        colaTrabajo& otra = colas[(propia + k) % n];
+        std::lock_guard<std::mutex> lock(otra.mutex);
+        if (!otra.celdas.empty()) {
+            celda = otra.celdas.front();
+            otra.celdas.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+static void correrGrilla(const std::vector<celdaBarrido>& grilla, const opcionesBarrido& op, int hilos,
+                         std::vector<resultadoCelda>& resultados, unsigned long& robadas) {
+    resultados.assign(grilla.size(), resultadoCelda());
+    std::vector<colaTrabajo> colas(hilos);
+    // Bloques seguidos por hilo: las celdas vecinas cuestan parecido, el
+    // robo reparte lo que sobre
+    for (size_t i = 0; i < grilla.size(); i++) {
+        colas[i * hilos / grilla.size()].celdas.push_back(i);
+    }
+
+    std::atomic<unsigned long> robos(0);
+    std::vector<std::thread> trabajadores;
+    for (int h = 0; h < hilos; h++) {
+        trabajadores.push_back(std::thread([&, h]() {
+            size_t celda;
+            size_t propias_fin = (h + 1) * grilla.size() / hilos;
+            size_t propias_ini = h * grilla.size() / hilos;
+            while (tomarCelda(colas, h, celda)) {
+                if (celda < propias_ini || celda >= propias_fin) robos++;
+                simularCelda(grilla[celda], op.frames, mezclar(op.semilla ^ mezclar(celda)), resultados[celda]);
+            }
+        }));
+    }
+    for (size_t i = 0; i < trabajadores.size(); i++) trabajadores[i].join();
+    robadas = robos.load();
+}
+
+// ===================== Salida =====================
+
+static double goodput(const resultadoCelda& r) {
+    return r.aire_ns ? (double)r.bits_payload * NS_POR_S / r.aire_ns : 0.0;
+}
+
+static double ber(const resultadoCelda& r) {
+    return r.bits_comparados ? (double)r.bits_errados / r.bits_comparados : 0.0;
+}
+
+static double tasaNoDetectados(const resultadoCelda& r) {
+    return r.enviados ? (double)r.no_detectados / r.enviados : 0.0;
+}
+
+static void escribirCsv(FILE* f, const std::vector<celdaBarrido>& grilla, const std::vector<resultadoCelda>& res) {
+    fprintf(f, "bps,bps_real,bits_parada,muestreo_pct,fcs,jitter_us,glitches_s,"
+               "enviados,entregados,rechazados,desincronizados,no_detectados,"
+               "goodput_bps,ber,tasa_no_detectados\n");
+    for (size_t i = 0; i < grilla.size(); i++) {
+        const celdaBarrido& c = grilla[i];
+        const resultadoCelda& r = res[i];
+        fprintf(f, "%d,%.1f,%d,%d,%s,%d,%g,%lu,%lu,%lu,%lu,%lu,%.3f,%.3e,%.3e\n", c.velocidad,
+                1000.0 / (1000 / c.velocidad), c.formato.bits_parada, c.formato.muestreo_pct,
+                NOMBRE_FCS[c.fcs], c.jitter_us, c.glitches_por_s, r.enviados, r.entregados, r.rechazados,
+                r.desincronizados, r.no_detectados, goodput(r), ber(r), tasaNoDetectados(r));
+    }
+}
+
+static void escribirJson(FILE* f, const std::vector<celdaBarrido>& grilla, const std::vector<resultadoCelda>& res) {
+    fprintf(f, "[\n");
+    for (size_t i = 0; i < grilla.size(); i++) {
+        const celdaBarrido& c = grilla[i];
+        const resultadoCelda& r = res[i];
+        fprintf(f, "  {\"bps\": %d, \"bps_real\": %.1f, \"bits_parada\": %d, \"muestreo_pct\": %d, "
+                   "\"fcs\": \"%s\", \"jitter_us\": %d, \"glitches_s\": %g, \"enviados\": %lu, "
+                   "\"entregados\": %lu, \"rechazados\": %lu, \"desincronizados\": %lu, "
+                   "\"no_detectados\": %lu, \"goodput_bps\": %.3f, \"ber\": %.3e, "
+                   "\"tasa_no_detectados\": %.3e}%s\n",
+                c.velocidad, 1000.0 / (1000 / c.velocidad), c.formato.bits_parada, c.formato.muestreo_pct,
+                NOMBRE_FCS[c.fcs], c.jitter_us, c.glitches_por_s, r.enviados, r.entregados, r.rechazados,
+                r.desincronizados, r.no_detectados, goodput(r), ber(r), tasaNoDetectados(r),
+                (i + 1 < grilla.size()) ? "," : "");
+    }
+    fprintf(f, "]\n");
+}
+
+// ===================== Programa =====================
+
+static bool leerLista(const char* texto, std::vector<int>& lista) {
+    lista.clear();
+    char* fin;
+    for (const char* p = texto; *p; p = (*fin == ',') ? fin + 1 : fin) {
+        long v = strtol(p, &fin, 10);
+        if (fin == p) return false;
+        lista.push_back((int)v);
+    }
+    return !lista.empty();
+}
+
+static bool leerLista(const char* texto, std::vector<double>& lista) {
+    lista.clear();
+    char* fin;
+    for (const char* p = texto; *p; p = (*fin == ',') ? fin + 1 : fin) {
+        double v = strtod(p, &fin);
+        if (fin == p) return false;
+        lista.push_back(v);
+    }
+    return !lista.empty();
+}
+
+static bool leerFcs(const char* texto, std::vector<int>& lista) {
+    lista.clear();
+    std::string s(texto);
+    size_t ini = 0;
+    while (ini <= s.size()) {
+        size_t coma = s.find(',', ini);
+        std::string nombre = s.substr(ini, coma == std::string::npos ? std::string::npos : coma - ini);
+        if (nombre == NOMBRE_FCS[FCS_CONTEO]) lista.push_back(FCS_CONTEO);
+        else if (nombre == NOMBRE_FCS[FCS_CRC16]) lista.push_back(FCS_CRC16);
+        else return false;
+        if (coma == std::string::npos) break;
+        ini = coma + 1;
+    }
+    return !lista.empty();
+}
+
+static bool opcionesValidas(const opcionesBarrido& op) {
+    for (size_t i = 0; i < op.velocidades.size(); i++) {
+        if (op.velocidades[i] < 1 || op.velocidades[i] > 1000) return false;
+    }
+    for (size_t i = 0; i < op.paradas.size(); i++) {
+        if (op.paradas[i] < 1 || op.paradas[i] > 4) return false;
+    }
+    for (size_t i = 0; i < op.muestreos.size(); i++) {
+        if (op.muestreos[i] < 1 || op.muestreos[i] > 99) return false;
+    }
+    for (size_t i = 0; i < op.jitters_us.size(); i++) {
+        if (op.jitters_us[i] < 0) return false;
+    }
+    for (size_t i = 0; i < op.glitches.size(); i++) {
+        if (op.glitches[i] < 0.0) return false;
+    }
+    return op.frames >= 1 && op.hilos >= 1;
+}
+
+static void mostrarUso() {
+    printf("Uso: ./barrido [opciones]\n");
+    printf("  --velocidades A,B,...  bits/s (defecto 10,20,50,100,200,250,500)\n");
+    printf("  --paradas A,B,...      Bits de parada (defecto 1,2)\n");
+    printf("  --muestreo A,B,...     Punto de muestreo en %% del bit (defecto 30,50,70)\n");
+    printf("  --fcs A,B              conteo y/o crc16 (defecto los dos)\n");
+    printf("  --jitter A,B,...       Atraso medio de cada delay() del emisor en us (defecto 20,300,1000)\n");
+    printf("  --glitches A,B,...     Pulsos de ruido por segundo (defecto 0,0.1)\n");
+    printf("  --frames N             Frames por celda (defecto 200)\n");
+    printf("  --hilos N              Hilos (defecto: todos los cores)\n");
+    printf("  --semilla N            Semilla base (defecto 1)\n");
+    printf("  --json                 Salida JSON en lugar de CSV\n");
+    printf("  --salida ARCHIVO       Escribir la tabla en ARCHIVO (defecto: stdout)\n");
+    printf("  --escalado             Medir el tiempo con 1, 2, 4... hilos (en stderr)\n");
+}
+
+int main(int argc, char** argv) {
+    opcionesBarrido op;
+    leerLista("10,20,50,100,200,250,500", op.velocidades);
+    leerLista("1,2", op.paradas);
+    leerLista("30,50,70", op.muestreos);
+    leerFcs("conteo,crc16", op.fcs);
+    leerLista("20,300,1000", op.jitters_us);
+    leerLista("0,0.1", op.glitches);
+    op.frames = 200;
+    op.hilos = (int)std::thread::hardware_concurrency();
+    op.semilla = 1;
+    op.json = false;
+    op.escalado = false;
+    op.salida = NULL;
+    if (op.hilos < 1) op.hilos = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hay_valor = (i + 1 < argc);
+        bool ok = true;
+        if (arg == "--json") op.json = true;
+        else if (arg == "--escalado") op.escalado = true;
+        else if (arg == "--velocidades" && hay_valor) ok = leerLista(argv[++i], op.velocidades);
+        else if (arg == "--paradas" && hay_valor) ok = leerLista(argv[++i], op.paradas);
+        else if (arg == "--muestreo" && hay_valor) ok = leerLista(argv[++i], op.muestreos);
+        else if (arg == "--fcs" && hay_valor) ok = leerFcs(argv[++i], op.fcs);
+        else if (arg == "--jitter" && hay_valor) ok = leerLista(argv[++i], op.jitters_us);
+        else if (arg == "--glitches" && hay_valor) ok = leerLista(argv[++i], op.glitches);
+        else if (arg == "--frames" && hay_valor) op.frames = atoi(argv[++i]);
+        else if (arg == "--hilos" && hay_valor) op.hilos = atoi(argv[++i]);
+        else if (arg == "--semilla" && hay_valor) op.semilla = strtoull(argv[++i], NULL, 10);
+        else if (arg == "--salida" && hay_valor) op.salida = argv[++i];
+        else ok = false;
+        if (!ok) {
+            mostrarUso();
+            return 1;
+        }
+    }
+    if (!opcionesValidas(op)) {
+        mostrarUso();
+        return 1;
+    }
+
+    g_hal_serial_silencio = true; // desempaquetar() imprime el FCS por Serial
+    g_flancos_activos = false;    // Las mediciones de enviarFrame() son de un solo hilo
+
+    std::vector<celdaBarrido> grilla = armarGrilla(op);
+    std::vector<resultadoCelda> resultados;
+    unsigned long robadas = 0;
+
+    if (op.escalado) {
+        // Mismo barrido con cada cantidad de hilos: el resultado tiene que ser idéntico
+        std::vector<resultadoCelda> referencia;
+        double seg_uno = 0.0;
+        fprintf(stderr, "%6s %10s %9s %10s %8s\n", "hilos", "segundos", "speedup", "eficiencia", "robadas");
+        for (int h = 1;; h = std::min(h * 2, op.hilos)) {
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            correrGrilla(grilla, op, h, resultados, robadas);
+            double seg = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            if (h == 1) {
+                seg_uno = seg;
+                referencia = resultados;
+            }
+            bool igual = memcmp(referencia.data(), resultados.data(),
+                                resultados.size() * sizeof(resultadoCelda)) == 0;
+            fprintf(stderr, "%6d %10.3f %8.2fx %9.0f%% %8lu%s\n", h, seg, seg_uno / seg,
+                    100.0 * seg_uno / seg / h, robadas, igual ? "" : "  (¡resultado distinto!)");
+            if (h == op.hilos) break;
+        }
+    } else {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        correrGrilla(grilla, op, op.hilos, resultados, robadas);
+        double seg = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        fprintf(stderr, "%zu celdas x %d frames en %.3f s con %d hilos (%lu celdas robadas)\n",
+                grilla.size(), op.frames, seg, op.hilos, robadas);
+    }
+
+    FILE* f = stdout;
+    if (op.salida != NULL) {
+        f = fopen(op.salida, "w");
+        if (f == NULL) {
+            perror(op.salida);
+            return 1;
+        }
+    }
+    if (op.json) escribirJson(f, grilla, resultados);
+    else escribirCsv(f, grilla, resultados);
+    if (f != stdout) fclose(f);
+    return 0;
+}
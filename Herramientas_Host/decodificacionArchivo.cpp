@@ -0,0 +1,311 @@
+/**
+ * @file decodificacionArchivo.cpp
+ * @brief Implementación de la decodificación de capturas (ver decodificacionArchivo.h).
+ */
+
+#include "decodificacionArchivo.h"
+#include "Arduino.h"
+#include "recibe.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__SSE2__) && !defined(SIN_SSE2)
+#include <emmintrin.h>
+#define CON_SSE2
+#endif
+
+// ===================== Extracción de flancos (crudo) =====================
+
+// Cola del bloque, muestra por muestra
+static void buscarFlancosCola(const uint8_t* p, size_t i, size_t fin, int canal, unsigned prev,
+                              std::vector<uint64_t>& salida) {
+    for (; i < fin; i++) {
+        unsigned nivel = (p[i] >> canal) & 1;
+        if (nivel != prev) salida.push_back(i);
+        prev = nivel;
+    }
+}
+
+void buscarFlancosPalabra(const uint8_t* p, size_t ini, size_t fin, int canal, int previo,
+                          std::vector<uint64_t>& salida) {
+    size_t i = ini;
+    uint64_t prev = (uint64_t)previo;
+
+    // Palabra a la vez: 8 muestras, un bit por byte
+    const uint64_t UNOS = 0x0101010101010101ULL;
+    for (; i + 8 <= fin; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        uint64_t niveles = (w >> canal) & UNOS;
+        uint64_t cambios = niveles ^ ((niveles << 8) | prev);
+        prev = niveles >> 56;
+        while (cambios) {
+            salida.push_back(i + (__builtin_ctzll(cambios) >> 3));
+            cambios &= cambios - 1;
+        }
+    }
+    buscarFlancosCola(p, i, fin, canal, (unsigned)prev, salida);
+}
+
+void buscarFlancos(const uint8_t* p, size_t ini, size_t fin, int canal, int previo, std::vector<uint64_t>& salida) {
+#if defined(CON_SSE2)
+    size_t i = ini;
+    unsigned prev = (unsigned)previo;
+
+    // El bit 'canal' de cada byte pasa al bit 7 y movemask junta los 16 niveles.
+    // (Lo que cruza de un byte al otro dentro del lane de 16 bits nunca llega al bit 7.)
+    for (; i + 16 <= fin; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        v = _mm_slli_epi16(v, 7 - canal);
+        unsigned niveles = (unsigned)_mm_movemask_epi8(v);
+        unsigned cambios = niveles ^ (((niveles << 1) | prev) & 0xFFFF);
+        prev = niveles >> 15;
+        while (cambios) {
+            salida.push_back(i + __builtin_ctz(cambios));
+            cambios &= cambios - 1;
+        }
+    }
+    buscarFlancosCola(p, i, fin, canal, prev, salida);
+#else
+    buscarFlancosPalabra(p, ini, fin, canal, previo, salida);
+#endif
+}
+
+void flancosCrudo(const uint8_t* p, size_t n, const opcionesDecodificador& op, lineaVirtual& linea) {
+    int hilos = op.hilos;
+    if ((size_t)hilos > n / 4096 + 1) hilos = (int)(n / 4096 + 1);
+
+    std::vector<std::vector<uint64_t> > parciales(hilos);
+    std::vector<std::thread> trabajadores;
+    size_t tam_bloque = ((n / hilos) + 63) & ~(size_t)63;
+
+    for (int h = 0; h < hilos; h++) {
+        size_t ini = std::min(n, (size_t)h * tam_bloque);
+        size_t fin = std::min(n, ini + tam_bloque);
+        trabajadores.push_back(std::thread([&, h, ini, fin]() {
+            if (ini >= fin) return;
+            int previo = (p[ini > 0 ? ini - 1 : 0] >> op.canal) & 1;
+            buscarFlancos(p, ini, fin, op.canal, previo, parciales[h]);
+        }));
+    }
+    for (size_t h = 0; h < trabajadores.size(); h++) trabajadores[h].join();
+
+    // Los flancos alternan, basta conocer el nivel inicial
+    int nivel = (n > 0) ? (p[0] >> op.canal) & 1 : HIGH;
+    linea.nivel_reposo = nivel;
+    double ns_por_muestra = 1e9 / op.frecuencia_hz;
+    for (int h = 0; h < hilos; h++) {
+        for (size_t k = 0; k < parciales[h].size(); k++) {
+            nivel = !nivel;
+            flanco f = {(int64_t)(parciales[h][k] * ns_por_muestra), (uint8_t)nivel};
+            linea.flancos.push_back(f);
+        }
+        std::vector<uint64_t>().swap(parciales[h]);
+    }
+    linea.fin_ns = (int64_t)(n * ns_por_muestra);
+}
+
+// ===================== Extracción de flancos (VCD) =====================
+
+static const char* saltarEspacios(const char* p, const char* fin) {
+    while (p < fin && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+static std::string leerToken(const char*& p, const char* fin) {
+    p = saltarEspacios(p, fin);
+    const char* ini = p;
+    while (p < fin && !(*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return std::string(ini, p - ini);
+}
+
+static double unidadEnNs(const std::string& unidad) {
+    if (unidad == "s") return 1e9;
+    if (unidad == "ms") return 1e6;
+    if (unidad == "us") return 1e3;
+    if (unidad == "ns") return 1.0;
+    if (unidad == "ps") return 1e-3;
+    if (unidad == "fs") return 1e-6;
+    return 0.0;
+}
+
+bool flancosVcd(const char* p, size_t n, const opcionesDecodificador& op, lineaVirtual& linea) {
+    const char* fin = p + n;
+    double escala_ns = 1.0;
+    std::string id;
+
+    // --- Cabecera: $timescale y $var hasta $enddefinitions ---
+    while (p < fin) {
+        std::string tok = leerToken(p, fin);
+        if (tok.empty()) break;
+        if (tok == "$timescale") {
+            std::string valor = leerToken(p, fin);
+            size_t corte = valor.find_first_not_of("0123456789");
+            std::string unidad = (corte == std::string::npos) ? leerToken(p, fin) : valor.substr(corte);
+            if (unidad == "$end") unidad = "s";
+            escala_ns = atof(valor.c_str()) * unidadEnNs(unidad);
+        } else if (tok == "$var") {
+            leerToken(p, fin); // tipo
+            std::string ancho = leerToken(p, fin);
+            std::string codigo = leerToken(p, fin);
+            std::string nombre = leerToken(p, fin);
+            if (id.empty() && ancho == "1" && (op.senal == NULL || nombre == op.senal)) {
+                id = codigo;
+            }
+        } else if (tok == "$enddefinitions") {
+            break;
+        }
+        if (tok[0] == '$' && tok != "$end") {
+            // Saltar hasta el $end del bloque
+            while (p < fin && leerToken(p, fin) != "$end") {}
+        }
+    }
+    if (id.empty()) return false;
+
+    // --- Cuerpo: "#tiempo" y cambios de valor "0id" / "1id" ---
+    int64_t t = 0;
+    int nivel = -1;
+    while (p < fin) {
+        p = saltarEspacios(p, fin);
+        if (p >= fin) break;
+        const char* ini = p;
+        while (p < fin && *p != '\n' && *p != ' ' && *p != '\r') p++;
+        size_t largo = p - ini;
+
+        if (ini[0] == '#') {
+            t = (int64_t)(strtod(std::string(ini + 1, largo - 1).c_str(), NULL) * escala_ns);
+        } else if ((ini[0] == '0' || ini[0] == '1') && largo - 1 == id.size() &&
+                   memcmp(ini + 1, id.data(), id.size()) == 0) {
+            int v = ini[0] - '0';
+            if (nivel < 0) {
+                linea.nivel_reposo = v; // Valor inicial ($dumpvars)
+            } else if (v != nivel) {
+                flanco f = {t, (uint8_t)v};
+                linea.flancos.push_back(f);
+            }
+            nivel = v;
+        }
+    }
+    linea.fin_ns = t;
+    return true;
+}
+
+bool leerFlancos(const opcionesDecodificador& op, lineaVirtual& linea, size_t* bytes) {
+    int fd = open(op.ruta, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(op.ruta);
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    size_t n = st.st_size;
+    void* mapa = (n > 0) ? mmap(NULL, n, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (mapa == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    if (mapa != NULL) madvise(mapa, n, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    bool ok = true;
+    if (op.vcd) {
+        ok = flancosVcd((const char*)mapa, n, op, linea);
+        if (!ok) printf("Error: no se encontró la señal en el VCD.\n");
+    } else {
+        flancosCrudo((const uint8_t*)mapa, n, op, linea);
+    }
+    if (mapa != NULL) munmap(mapa, n);
+    if (bytes != NULL) *bytes = n;
+    return ok;
+}
+
+// ===================== Decodificación de frames =====================
+
+/**
+ * @brief Error de cada flanco del frame respecto del límite de bit en que
+ * tendría que caer, contado desde el último bit de inicio.
+ * @details Cada byte se mide desde su propio bit de inicio (el receptor se
+ * vuelve a sincronizar en cada uno): una bajada después de los 8 bits de
+ * datos es el inicio del próximo byte (o la paridad en LOW) y su error es
+ * contra el fin de los bits de parada del anterior, así un inicio atrasado
+ * cuenta entero aunque pase de medio bit.
+ */
+static void erroresDeTiempo(lineaVirtual& linea, int64_t ini, int64_t fin, int64_t bit_ns, int bits_parada,
+                            double& max_pct, double& rms_pct) {
+    const int64_t proximo_inicio = (9 + bits_parada) * bit_ns; // Inicio + 8 datos + parada
+    const int64_t fin_datos = 9 * bit_ns - bit_ns / 2;
+    double suma2 = 0.0;
+    int n = 0;
+    int64_t inicio_byte = ini;
+    max_pct = 0.0;
+    lineaNivel(linea, ini - 1);
+    for (size_t i = linea.cursor; i < linea.flancos.size() && linea.flancos[i].t_ns <= fin; i++) {
+        const flanco& f = linea.flancos[i];
+        int64_t rel = f.t_ns - inicio_byte;
+        int64_t ideal;
+        if (f.nivel == LOW && rel > fin_datos) {
+            ideal = proximo_inicio;
+            inicio_byte = f.t_ns;
+        } else {
+            ideal = ((rel + bit_ns / 2) / bit_ns) * bit_ns;
+        }
+        double pct = 100.0 * fabs((double)(rel - ideal)) / bit_ns;
+        if (pct > max_pct) max_pct = pct;
+        suma2 += pct * pct;
+        n++;
+    }
+    rms_pct = n ? sqrt(suma2 / n) : 0.0;
+}
+
+void decodificarLinea(lineaVirtual& linea, int speed, std::vector<frameDecodificado>& frames) {
+    const int64_t bit_ns = (int64_t)(1000 / speed) * 1000000; // Misma cuenta entera que el receptor
+    halUsarLinea(&linea);
+
+    frameReceptor proto;
+    int64_t t = 0;
+    for (;;) {
+        // Mientras la línea está en reposo el receptor solo espera: se salta
+        // directo a la próxima bajada.
+        int64_t inicio = lineaProximaBajada(linea, t);
+        if (inicio < 0) break;
+        linea.ahora_ns = inicio;
+
+        bool frame_ok;
+        try {
+            frame_ok = recibirFrame(RX_PIN, speed, proto);
+        } catch (const finDeLinea&) {
+            break; // La captura terminó a mitad de un frame
+        }
+        int64_t fin = linea.ahora_ns;
+
+        frameDecodificado d;
+        d.inicio_ns = inicio;
+        erroresDeTiempo(linea, inicio, fin, bit_ns, FORMATO_LINEA_ESTANDAR.bits_parada, d.error_max_pct,
+                        d.error_rms_pct);
+        if (!frame_ok) {
+            d.estado = DECODIFICADO_SYNC;
+            proto.lng = 0;
+        } else {
+            d.estado = desempaquetar(proto) ? DECODIFICADO_OK : DECODIFICADO_FCS;
+        }
+        d.cmd = frame_ok ? proto.cmd : -1;
+        d.lng = proto.lng;
+        memcpy(d.datos, payload(proto), proto.lng);
+        frames.push_back(d);
+
+        // Después de un error el receptor hace flushRX()
+        t = fin;
+        if (d.estado != DECODIFICADO_OK) {
+            t = lineaFinSilencio(linea, fin, (int64_t)SILENCIO_FLUSH_MS * 1000000);
+            if (t < 0) break;
+        }
+    }
+    halUsarLinea(NULL);
+}
@@ -0,0 +1,100 @@
+/**
+ * @file decodificacionArchivo.h
+ * @brief Decodificación de capturas de analizador lógico de la línea: lo
+ * que usan el programa decodificador y el escenario "decodificacion-archivo".
+ * @details Formatos de entrada:
+ *  - VCD (sigrok: "sigrok-cli ... -O vcd"), se elige la señal por nombre.
+ *  - Volcado crudo: 1 byte por muestra, la línea en el bit 'canal'
+ *    (sigrok: "-O binary"), con la frecuencia de muestreo aparte.
+ *
+ * El archivo se mapea en memoria. En el volcado crudo los flancos se buscan
+ * en paralelo por bloques, 16 muestras por instrucción (SSE2) o 8 por
+ * palabra de 64 bits en otras arquitecturas (o con -DSIN_SSE2, ver el
+ * makefile). Con la lista de flancos se arma una línea virtual y se
+ * ejecutan recibirFrame()/desempaquetar() del receptor tal cual, incluido
+ * el flushRX() después de un error.
+ */
+
+#ifndef DECODIFICACION_ARCHIVO_H
+#define DECODIFICACION_ARCHIVO_H
+
+#include "halHost.h"
+#include "structProtocolo.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Silencio que exige flushRX() después de un error (ms)
+#define SILENCIO_FLUSH_MS 1000
+
+typedef struct
+{
+    const char* ruta;
+    bool vcd;
+    double frecuencia_hz;   // Solo volcado crudo
+    int canal;              // Solo volcado crudo
+    const char* senal;      // Solo VCD (NULL = primera señal de 1 bit)
+    int speed;
+    int hilos;
+    bool solo_errores;
+} opcionesDecodificador;
+
+enum estadoDecodificado
+{
+    DECODIFICADO_OK,
+    DECODIFICADO_FCS,
+    DECODIFICADO_SYNC      // Error de sincronización o de paridad
+};
+
+/**
+ * @brief Un frame leído de la captura.
+ */
+typedef struct
+{
+    int64_t inicio_ns;     // Bajada del bit de inicio del primer byte
+    estadoDecodificado estado;
+    int cmd;               // -1 si no se sincronizó
+    int lng;
+    BYTE datos[LARGO_DATA];
+    double error_max_pct;  // Peor flanco del frame, en % del bit
+    double error_rms_pct;
+} frameDecodificado;
+
+/**
+ * @brief Transiciones del bit 'canal' en p[ini, fin), con la versión que
+ * corresponde a la arquitectura (SSE2, o palabras de 64 bits).
+ * @param previo Nivel de la muestra anterior a 'ini'.
+ * @param salida Índices de muestra donde cambia el nivel.
+ */
+void buscarFlancos(const uint8_t* p, size_t ini, size_t fin, int canal, int previo, std::vector<uint64_t>& salida);
+
+/**
+ * @brief Lo mismo que buscarFlancos(), siempre de a 8 muestras por palabra
+ * de 64 bits (la versión de las arquitecturas sin SSE2).
+ */
+void buscarFlancosPalabra(const uint8_t* p, size_t ini, size_t fin, int canal, int previo,
+                          std::vector<uint64_t>& salida);
+
+/**
+ * @brief Extrae los flancos de un volcado crudo en paralelo por bloques (op.hilos).
+ */
+void flancosCrudo(const uint8_t* p, size_t n, const opcionesDecodificador& op, lineaVirtual& linea);
+
+/**
+ * @brief Lee un VCD en una sola pasada.
+ * @return false si no se encontró la señal.
+ */
+bool flancosVcd(const char* p, size_t n, const opcionesDecodificador& op, lineaVirtual& linea);
+
+/**
+ * @brief Mapea op.ruta y extrae sus flancos (VCD o crudo según op.vcd).
+ * @return false si no se pudo leer (con el error ya impreso).
+ */
+bool leerFlancos(const opcionesDecodificador& op, lineaVirtual& linea, size_t* bytes);
+
+/**
+ * @brief Ejecuta el receptor sobre la línea y agrega cada frame a 'frames'.
+ */
+void decodificarLinea(lineaVirtual& linea, int speed, std::vector<frameDecodificado>& frames);
+
+#endif // DECODIFICACION_ARCHIVO_H
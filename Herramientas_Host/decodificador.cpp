@@ -0,0 +1,119 @@
+/**
+ * @file decodificador.cpp
+ * @brief Decodifica capturas de analizador lógico de la línea (GPIO 17).
+ * @details Los formatos de entrada y cómo se leen están en
+ * decodificacionArchivo.h; este programa solo toma las opciones e imprime
+ * cada frame con el error de sus flancos.
+ */
+
+#include "Arduino.h"
+#include "decodificacionArchivo.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <chrono>
+
+static void imprimirDatos(const frameDecodificado& d) {
+    putchar('"');
+    for (int i = 0; i < d.lng; i++) {
+        BYTE c = d.datos[i];
+        if (c >= 32 && c < 127 && c != '"' && c != '\\') putchar(c);
+        else printf("\\x%02x", c);
+    }
+    putchar('"');
+}
+
+static void imprimirFrames(const std::vector<frameDecodificado>& frames, bool solo_errores) {
+    static const char* ESTADOS[] = {"OK", "FCS", "SYNC"};
+    unsigned long cuentas[3] = {0, 0, 0};
+    double peor_pct = 0.0;
+
+    printf("%14s %-6s %4s %4s %9s %9s  %s\n", "tiempo_s", "estado", "cmd", "lng", "err_max%", "err_rms%", "datos");
+    for (size_t i = 0; i < frames.size(); i++) {
+        const frameDecodificado& d = frames[i];
+        cuentas[d.estado]++;
+        if (d.error_max_pct > peor_pct) peor_pct = d.error_max_pct;
+        if (solo_errores && d.estado == DECODIFICADO_OK) continue;
+        printf("%14.6f %-6s %4d %4d %9.2f %9.2f  ", d.inicio_ns / 1e9, ESTADOS[d.estado], d.cmd, d.lng,
+               d.error_max_pct, d.error_rms_pct);
+        imprimirDatos(d);
+        putchar('\n');
+    }
+    printf("\nFrames OK: %lu | Error FCS: %lu | Error sync/paridad: %lu | Peor error de flanco: %.2f%% del bit\n",
+           cuentas[DECODIFICADO_OK], cuentas[DECODIFICADO_FCS], cuentas[DECODIFICADO_SYNC], peor_pct);
+}
+
+// ===================== Programa =====================
+
+static void mostrarUso() {
+    printf("Uso: ./decodificador ARCHIVO [opciones]\n");
+    printf("  --vcd               Forzar formato VCD (por defecto si termina en .vcd)\n");
+    printf("  --senal NOMBRE      Señal del VCD (por defecto la primera de 1 bit)\n");
+    printf("  --frecuencia HZ     Frecuencia de muestreo del volcado crudo\n");
+    printf("  --canal N           Bit de la línea en cada byte crudo (0-7, defecto 0)\n");
+    printf("  --speed N           Velocidad de la línea en bits/s (defecto %d)\n", SPEED);
+    printf("  --hilos N           Hilos para buscar flancos (defecto: todos los cores)\n");
+    printf("  --errores           Mostrar solo los frames con error\n");
+}
+
+int main(int argc, char** argv) {
+    opcionesDecodificador op;
+    op.ruta = NULL;
+    op.vcd = false;
+    op.frecuencia_hz = 0.0;
+    op.canal = 0;
+    op.senal = NULL;
+    op.speed = SPEED;
+    op.hilos = (int)std::thread::hardware_concurrency();
+    op.solo_errores = false;
+    if (op.hilos < 1) op.hilos = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hay_valor = (i + 1 < argc);
+        if (arg == "--vcd") op.vcd = true;
+        else if (arg == "--errores") op.solo_errores = true;
+        else if (arg == "--senal" && hay_valor) op.senal = argv[++i];
+        else if (arg == "--frecuencia" && hay_valor) op.frecuencia_hz = atof(argv[++i]);
+        else if (arg == "--canal" && hay_valor) op.canal = atoi(argv[++i]);
+        else if (arg == "--speed" && hay_valor) op.speed = atoi(argv[++i]);
+        else if (arg == "--hilos" && hay_valor) op.hilos = atoi(argv[++i]);
+        else if (arg[0] != '-' && op.ruta == NULL) op.ruta = argv[i];
+        else {
+            mostrarUso();
+            return 1;
+        }
+    }
+    if (op.ruta == NULL || op.speed < 1 || op.speed > 1000 || op.canal < 0 || op.canal > 7 || op.hilos < 1) {
+        mostrarUso();
+        return 1;
+    }
+    size_t largo_ruta = strlen(op.ruta);
+    if (largo_ruta > 4 && strcmp(op.ruta + largo_ruta - 4, ".vcd") == 0) op.vcd = true;
+    if (!op.vcd && op.frecuencia_hz <= 0.0) {
+        printf("Error: el volcado crudo necesita --frecuencia.\n");
+        return 1;
+    }
+
+    g_hal_serial_silencio = true; // desempaquetar() imprime el FCS por Serial
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    lineaVirtual linea;
+    size_t n = 0;
+    if (!leerFlancos(op, linea, &n)) {
+        return 1;
+    }
+    double seg_flancos = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::vector<frameDecodificado> frames;
+    decodificarLinea(linea, op.speed, frames);
+    double seg_total = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    imprimirFrames(frames, op.solo_errores);
+
+    fprintf(stderr, "%zu flancos en %.1f MB: extracción %.3f s (%.0f MB/s), total %.3f s\n",
+            linea.flancos.size(), n / 1e6, seg_flancos, seg_flancos > 0 ? n / 1e6 / seg_flancos : 0.0,
+            seg_total);
+    return 0;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file escenarioCache.cpp
+ * @brief Consistencia de la caché de frames (CMD 9) con pérdidas en la línea.
+ * @details El espejo del emisor (cacheEmisor) comprime una carga parecida al
+ * uso real del menú: mensajes de prueba repetidos 10 veces (opción 2), el
+ * arreglo de temperaturas que cambia de a una (opción 8), textos al OLED
+ * elegidos de un conjunto mayor que la caché (opción 3) y temperaturas
+ * sueltas (opción 4). Cada frame se pierde con cierta probabilidad y el
+ * receptor (desempaquetar + cacheProcesar) reconstruye el resto.
+ * Se verifica que NUNCA se ejecute un payload distinto al original.
+ */
+
+#include "escenarios.h"
+#include "cacheFrames.h"
+#include "recibe.h"
+#include "cacheEmisor.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdlib.h>
+#include <vector>
+#include <random>
+
+#define TEXTOS_OLED 24 // Más que CACHE_ENTRADAS: obliga a desalojar
+
+typedef struct
+{
+    unsigned long enviados;
+    unsigned long perdidos;
+    unsigned long ejecutados;
+    unsigned long incorrectos;  // Se ejecutó algo distinto al original (no debe pasar)
+    unsigned long fallos_cache; // CMD 9 sin su entrada en el receptor
+    unsigned long bytes_sin_cache;
+    unsigned long bytes_con_cache;
+    bool espejo_igual;          // Sin pérdidas, el espejo coincide con el receptor
+} resultadoCache;
+
+static void textoAleatorio(std::mt19937& rng, char* destino, int largo) {
+    for (int i = 0; i < largo; i++) destino[i] = 'a' + rng() % 26;
+    destino[largo] = '\0';
+}
+
+/**
+ * Genera la carga: cada llamada agrega uno o más frames originales.
+ */
+static void generarCarga(std::mt19937& rng, std::vector<protocolo>& salida, int cantidad) {
+    char textos[TEXTOS_OLED][LARGO_DATA];
+    for (int i = 0; i < TEXTOS_OLED; i++) textoAleatorio(rng, textos[i], 20 + rng() % 40);
+    float temperaturas[8] = {20, 21, 22, 23, 24, 25, 26, 27};
+    int indice_temp = 0;
+
+    while ((int)salida.size() < cantidad) {
+        protocolo p;
+        memset(&p, 0, sizeof(protocolo));
+        int tipo = rng() % 10;
+        if (tipo < 2) { // Opción 2: el mismo mensaje 10 veces
+            p.cmd = 1;
+            textoAleatorio(rng, (char*)p.data, 20 + rng() % 42);
+            p.lng = strlen((char*)p.data);
+            for (int i = 0; i < 10; i++) salida.push_back(p);
+            continue;
+        } else if (tipo < 5) { // Opción 8: cambia una temperatura por vez
+            temperaturas[indice_temp] += (rng() % 21 - 10) / 10.0f;
+            indice_temp = (indice_temp + 1) % 8;
+            p.cmd = 7;
+            int n = snprintf((char*)p.data, LARGO_DATA, "Ultimas 8 Temps: ");
+            for (int i = 0; i < 8 && n < LARGO_DATA - 1; i++) {
+                n += snprintf((char*)p.data + n, LARGO_DATA - n, "%.1fC ", temperaturas[i]);
+            }
+            p.lng = strlen((char*)p.data);
+        } else if (tipo < 8) { // Opción 3: texto de un conjunto fijo
+            p.cmd = 2;
+            strcpy((char*)p.data, textos[rng() % TEXTOS_OLED]);
+            p.lng = strlen((char*)p.data);
+        } else { // Opción 4: temperatura suelta (muy corta para la caché)
+            p.cmd = 3;
+            p.lng = snprintf((char*)p.data, LARGO_DATA, "%.1f", (rng() % 800 - 400) / 10.0f);
+        }
+        salida.push_back(p);
+    }
+    salida.resize(cantidad);
+}
+
+static resultadoCache simular(const std::vector<protocolo>& carga, double perdida, unsigned semilla) {
+    resultadoCache r;
+    memset(&r, 0, sizeof(r));
+    std::mt19937 rng(semilla);
+    std::uniform_real_distribution<double> azar(0.0, 1.0);
+
+    cacheEmisor espejo;
+    cacheEmisorIniciar(espejo);
+    cacheFrames receptor;
+    cacheIniciar(receptor);
+
+    for (size_t i = 0; i < carga.size(); i++) {
+        protocolo original = carga[i];
+        protocolo tx = original;
+        r.bytes_sin_cache += empaquetar(tx);
+
+        protocolo comprimido;
+        protocolo* envio = &tx;
+        int largo = tx.lng + BYTES_EXTRA;
+        if (cacheEmisorComprimir(espejo, original, comprimido)) {
+            largo = empaquetar(comprimido);
+            envio = &comprimido;
+        }
+        r.bytes_con_cache += largo;
+        r.enviados++;
+
+        if (azar(rng) < perdida) {
+            r.perdidos++;
+            continue;
+        }
+
+        // Lo que deja recibirFrame(): el frame crudo, cmd y lng decodificados
+        frameReceptor rx;
+        memcpy(rx.frame, envio->frame, largo);
+        rx.cmd = FrameEstandar::cmdDe(rx.frame);
+        rx.lng = FrameEstandar::lngDe(rx.frame);
+        if (!desempaquetar(rx)) continue;
+
+        if (!cacheProcesar(receptor, rx)) {
+            continue; // Fallo de caché: el frame no se ejecuta
+        }
+        r.ejecutados++;
+        if (rx.cmd != original.cmd || rx.lng != original.lng ||
+            memcmp(payload(rx), original.data, original.lng) != 0) {
+            r.incorrectos++;
+        }
+    }
+    r.fallos_cache = receptor.fallos;
+
+    // Mismos payloads y mismo orden LRU en las dos puntas
+    r.espejo_igual = true;
+    for (int i = 0; i < CACHE_ENTRADAS; i++) {
+        const entradaCacheEmisor& e = espejo.entradas[i];
+        const entradaCache& c = receptor.entradas[i];
+        if (e.ocupada != c.ocupada || (e.ocupada && (e.hash != c.hash || e.ultimo_uso != c.ultimo_uso))) {
+            r.espejo_igual = false;
+        }
+    }
+    return r;
+}
+
+int escenarioCache(int argc, char** argv) {
+    int cantidad = (argc > 0) ? atoi(argv[0]) : 5000;
+    unsigned semilla = (argc > 1) ? (unsigned)atoi(argv[1]) : 1;
+    if (cantidad <= 0) {
+        printf("Uso: ./simulador cache [frames] [semilla]\n");
+        return 1;
+    }
+
+    std::mt19937 rng(semilla);
+    std::vector<protocolo> carga;
+    generarCarga(rng, carga, cantidad);
+
+    const double PERDIDAS[] = {0.0, 0.01, 0.05, 0.20};
+    bool ok = true;
+    g_hal_serial_silencio = true; // desempaquetar() imprime los FCS
+
+    printf("Caché de frames: %d frames, %d entradas, semilla %u\n", cantidad, CACHE_ENTRADAS, semilla);
+    printf("  %-8s %9s %9s %9s %11s %11s %8s %7s\n", "pérdida", "perdidos", "ejecut.", "fallos",
+           "incorrectos", "bytes", "ahorro", "espejo");
+    for (size_t i = 0; i < sizeof(PERDIDAS) / sizeof(PERDIDAS[0]); i++) {
+        resultadoCache r = simular(carga, PERDIDAS[i], semilla + (unsigned)i);
+        printf("  %6.0f%% %9lu %9lu %9lu %11lu %5lu/%-5lu %7.1f%% %7s\n", PERDIDAS[i] * 100,
+               r.perdidos, r.ejecutados, r.fallos_cache, r.incorrectos, r.bytes_con_cache,
+               r.bytes_sin_cache, 100.0 * (1.0 - (double)r.bytes_con_cache / r.bytes_sin_cache),
+               r.espejo_igual ? "igual" : "distinto");
+
+        // Nunca un payload equivocado; sin pérdidas, ni un fallo y el espejo exacto
+        if (r.incorrectos != 0) ok = false;
+        if (PERDIDAS[i] == 0.0 && (r.fallos_cache != 0 || !r.espejo_igual)) ok = false;
+    }
+    g_hal_serial_silencio = false;
+    printf("%s\n", ok ? "Consistencia OK." : "ERROR: la caché del receptor no es consistente.");
+    return ok ? 0 : 1;
+}
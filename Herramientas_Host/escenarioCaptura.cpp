@@ -0,0 +1,290 @@
+/**
+ * @file escenarioCaptura.cpp
+ * @brief Registro de capturas (registroCaptura.cpp) sobre un archivo temporal.
+ * @details Se verifica:
+ * - El anillo: con más frames que registros, el archivo guarda los últimos
+ *   'capacidad' y reproducirCaptura() los reenvía en orden. Un registro
+ *   con la 'secuencia' en 0 (a medio escribir) o de la vuelta anterior se
+ *   salta.
+ * - El costo de cada capturaRegistrar(), medido de a uno como lo paga
+ *   transmitirConContador() después de cada envío, contra el tiempo de un
+ *   bit a la velocidad más alta del enlace.
+ * - La reproducción a máxima velocidad por el transporte "nulo" (solo el
+ *   costo del emisor) y por el "wiringpi" sobre una línea virtual: el
+ *   recibirFrame() real decodifica lo mismo que se capturó y la línea queda
+ *   ocupada casi todo el tiempo.
+ */
+
+#include "escenarios.h"
+#include "halHost.h"
+#include "recibe.h"
+#include "registroCaptura.h"
+#include "histogramaFlancos.h"
+#include "transporte.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <random>
+#include <vector>
+
+#define CAPACIDAD 64
+#define VELOCIDAD 500
+#define VELOCIDAD_MAXIMA 115200       // La más alta que negocia el enlace (negociacionEnlace.h)
+#define REGISTROS_MEDIDOS 200000
+#define MARGEN_FIN_NS 100000000LL     // Línea quieta después del último frame
+#define INICIO_NS 1000000000LL        // Un flanco en t = 0 no se ve como bajada
+#define PAUSA_RAPIDA_NS 1000000LL     // Entre frames capturados a VELOCIDAD_MAXIMA
+#define PAUSA_MENU_NS 100000000LL     // Entre frames capturados a VELOCIDAD (alguien usando el menú)
+#define OCUPACION_MINIMA 0.95
+
+/**
+ * Un frame con un texto distinto cada vez, como los del menú.
+ */
+static int armarFrame(std::mt19937& rng, int numero, protocolo& proto) {
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = (BYTE)(1 + numero % 3);
+    int n = snprintf((char*)proto.data, LARGO_DATA, "F%d ", numero);
+    int largo = n + rng() % 12;
+    while (n < largo) proto.data[n++] = (BYTE)('a' + rng() % 26);
+    proto.lng = (BYTE)n;
+    return empaquetar(proto);
+}
+
+/**
+ * Pisa la 'secuencia' del registro 'numero' (desde 0) en el archivo.
+ */
+static bool pisarSecuencia(const char* ruta, uint64_t numero, uint32_t secuencia) {
+    int fd = open(ruta, O_RDWR);
+    if (fd < 0) return false;
+    off_t pos = CAPTURA_TAM_CABECERA + (off_t)(numero % CAPACIDAD) * sizeof(registroFrame) +
+                offsetof(registroFrame, secuencia);
+    bool ok = pwrite(fd, &secuencia, sizeof(secuencia), pos) == (ssize_t)sizeof(secuencia);
+    close(fd);
+    return ok;
+}
+
+/**
+ * Decodifica la línea y cuenta los frames iguales a los esperados, en orden.
+ */
+static int verificarLinea(lineaVirtual& linea, const std::vector<protocolo>& esperados, int& decodificados) {
+    linea.ahora_ns = 0;
+    linea.fin_ns = (linea.flancos.empty() ? 0 : linea.flancos.back().t_ns) + MARGEN_FIN_NS;
+    halUsarLinea(&linea);
+    size_t siguiente = 0;
+    int correctos = 0;
+    decodificados = 0;
+    try {
+        for (;;) {
+            while (digitalRead(RX_PIN) == HIGH);
+            frameReceptor rx;
+            if (!recibirFrame(RX_PIN, VELOCIDAD, rx) || !desempaquetar(rx)) continue;
+            decodificados++;
+            if (siguiente < esperados.size() && rx.cmd == esperados[siguiente].cmd &&
+                rx.lng == esperados[siguiente].lng &&
+                memcmp(payload(rx), esperados[siguiente].data, rx.lng) == 0) {
+                correctos++;
+            }
+            siguiente++;
+        }
+    } catch (const finDeLinea&) {
+        // Fin de lo escrito
+    }
+    halUsarLinea(NULL);
+    return correctos;
+}
+
+/**
+ * Lo que dura un frame de 'largo' bytes en la línea: inicio, 8 bits y los
+ * de parada por byte, y el bit de paridad al final.
+ */
+static int64_t duracionFrameNs(int largo, int velocidad) {
+    return (int64_t)(largo * (9 + g_config_enlace.bits_parada) + 1) * 1000000000LL / velocidad;
+}
+
+/**
+ * Escribe 'frames' frames enviados a 'velocidad', con 'pausa_ns' entre uno y
+ * otro, en un anillo de CAPACIDAD y deja en 'ultimos' los que tienen que
+ * quedar (los últimos CAPACIDAD) y en 'largos' sus largos. Devuelve cuánto
+ * después del primero empezó el último.
+ */
+static int64_t capturar(const char* ruta, int frames, int velocidad, int64_t pausa_ns,
+                        std::vector<protocolo>& ultimos, std::vector<int>& largos) {
+    if (!capturaAbrir(ruta, CAPACIDAD)) return -1;
+    std::mt19937 rng(1);
+    uint64_t t0 = capturaAhoraNs();
+    uint64_t t_ns = t0;
+    uint64_t t_ultimo = t0;
+    for (int i = 0; i < frames; i++) {
+        protocolo proto;
+        int largo = armarFrame(rng, i, proto);
+        int64_t duracion_ns = duracionFrameNs(largo, velocidad);
+        capturaRegistrar(proto, largo, velocidad, g_config_enlace, t_ns, (uint32_t)(duracion_ns / 1000),
+                         CAPTURA_ENVIADO);
+        t_ultimo = t_ns;
+        t_ns += duracion_ns + pausa_ns;
+        if (i >= frames - CAPACIDAD) {
+            ultimos.push_back(proto);
+            largos.push_back(largo);
+        }
+    }
+    capturaCerrar();
+    return (int64_t)(t_ultimo - t0);
+}
+
+static bool verificarAnillo(const char* ruta) {
+    const int FRAMES = 3 * CAPACIDAD + 10;
+    std::vector<protocolo> ultimos;
+    std::vector<int> largos;
+    if (capturar(ruta, FRAMES, VELOCIDAD, PAUSA_MENU_NS, ultimos, largos) < 0) return false;
+
+    cabeceraCaptura cab;
+    int fd = open(ruta, O_RDONLY);
+    bool leida = fd >= 0 && pread(fd, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab);
+    if (fd >= 0) close(fd);
+    bool cabecera_ok = leida && cab.escritos == (uint64_t)FRAMES && cab.capacidad == CAPACIDAD;
+    printf("  %d frames en un anillo de %d: escritos %llu, %s\n", FRAMES, CAPACIDAD,
+           leida ? (unsigned long long)cab.escritos : 0ULL, cabecera_ok ? "bien" : "MAL");
+
+    // Los últimos CAPACIDAD, por la línea virtual y en orden
+    lineaVirtual linea;
+    linea.ahora_ns = INICIO_NS;
+    halUsarLinea(&linea);
+    long reenviados = reproducirCaptura(ruta, true, buscarTransporte("wiringpi"));
+    halUsarLinea(NULL);
+    int decodificados = 0;
+    int correctos = verificarLinea(linea, ultimos, decodificados);
+    bool vuelta_ok = reenviados == CAPACIDAD && correctos == CAPACIDAD;
+    printf("  Reproducidos %ld, decodificados %d, iguales a los últimos %d capturados: %d\n", reenviados,
+           decodificados, CAPACIDAD, correctos);
+
+    // Uno a medio escribir y uno de la vuelta anterior (el número del registro
+    // que estaba en su lugar): los dos se saltan
+    uint64_t primero = FRAMES - CAPACIDAD;
+    bool pisados = pisarSecuencia(ruta, primero + 5, 0) &&
+                   pisarSecuencia(ruta, primero + 20, (uint32_t)(primero + 20 - CAPACIDAD + 1));
+    long con_pisados = reproducirCaptura(ruta, true, buscarTransporte("nulo"));
+    bool guarda_ok = pisados && con_pisados == CAPACIDAD - 2;
+    printf("  Con un registro a medio escribir y uno de la vuelta anterior: %ld reproducidos (esperados %d)\n",
+           con_pisados, CAPACIDAD - 2);
+    return cabecera_ok && vuelta_ok && guarda_ok;
+}
+
+/**
+ * Cada capturaRegistrar() medido por separado, con el reloj que usa
+ * transmitirConContador() alrededor del envío.
+ */
+static bool medirRegistro(const char* ruta) {
+    if (!capturaAbrir(ruta, CAPTURA_REGISTROS_DEFECTO)) return false;
+    std::mt19937 rng(2);
+    protocolo frames[16];
+    int largos[16];
+    for (int i = 0; i < 16; i++) largos[i] = armarFrame(rng, i, frames[i]);
+
+    histogramaNs* h = new histogramaNs();
+    histogramaReiniciar(*h);
+    for (int i = 0; i < REGISTROS_MEDIDOS; i++) {
+        const protocolo& proto = frames[i % 16];
+        uint64_t t0 = capturaAhoraNs();
+        capturaRegistrar(proto, largos[i % 16], VELOCIDAD, g_config_enlace, t0, 1000, CAPTURA_ENVIADO);
+        histogramaRegistrar(*h, capturaAhoraNs() - t0);
+    }
+    capturaCerrar();
+
+    resumenHistograma r;
+    histogramaResumir(*h, r);
+    delete h;
+    uint64_t bit_ns = 1000000000ULL / VELOCIDAD_MAXIMA;
+    bool ok = r.p99_ns < bit_ns;
+    printf("  capturaRegistrar(), %d llamadas: p50 %llu ns, p99 %llu ns, máx %llu ns (un bit a %d bps: %llu ns)\n",
+           REGISTROS_MEDIDOS, (unsigned long long)r.p50_ns, (unsigned long long)r.p99_ns,
+           (unsigned long long)r.maximo_ns, VELOCIDAD_MAXIMA, (unsigned long long)bit_ns);
+    return ok;
+}
+
+/**
+ * Reproducción por el transporte "nulo" (solo el costo del emisor): a
+ * máxima velocidad no espera nada; con los tiempos originales tarda lo que
+ * duró la sesión capturada (frames a VELOCIDAD_MAXIMA para que sea corta).
+ */
+static bool verificarNulo(const char* ruta) {
+    std::vector<protocolo> ultimos;
+    std::vector<int> largos;
+    int64_t sesion_ns = capturar(ruta, CAPACIDAD, VELOCIDAD_MAXIMA, PAUSA_RAPIDA_NS, ultimos, largos);
+    if (sesion_ns < 0) return false;
+
+    uint64_t t0 = capturaAhoraNs();
+    long rapidos = reproducirCaptura(ruta, true, buscarTransporte("nulo"));
+    uint64_t t1 = capturaAhoraNs();
+    long originales = reproducirCaptura(ruta, false, buscarTransporte("nulo"));
+    uint64_t t2 = capturaAhoraNs();
+    double rapido_ms = (t1 - t0) / 1e6, original_ms = (t2 - t1) / 1e6, sesion_ms = sesion_ns / 1e6;
+    printf("  Transporte nulo: %ld frames en %.3f ms a máxima velocidad; %ld en %.1f ms con los tiempos "
+           "originales (el último empezó a los %.1f ms)\n", rapidos, rapido_ms, originales, original_ms, sesion_ms);
+    return rapidos == CAPACIDAD && originales == CAPACIDAD && original_ms >= sesion_ms &&
+           rapido_ms < sesion_ms / 10;
+}
+
+/**
+ * Reproducción a máxima velocidad por la línea virtual: los frames salen
+ * pegados, sin las pausas de la sesión original, y el receptor los
+ * decodifica igual que los capturados.
+ */
+static bool verificarSaturacion(const char* ruta) {
+    std::vector<protocolo> ultimos;
+    std::vector<int> largos;
+    int64_t sesion_ns = capturar(ruta, CAPACIDAD, VELOCIDAD, PAUSA_MENU_NS, ultimos, largos);
+    if (sesion_ns < 0) return false;
+
+    lineaVirtual linea;
+    linea.ahora_ns = INICIO_NS;
+    halUsarLinea(&linea);
+    long reenviados = reproducirCaptura(ruta, true, buscarTransporte("wiringpi"));
+    halUsarLinea(NULL);
+
+    // Ocupada: del primer flanco al último, lo que duran los frames en sí
+    double ocupado_ns = 0;
+    for (size_t i = 0; i < largos.size(); i++) {
+        ocupado_ns += (double)duracionFrameNs(largos[i], VELOCIDAD);
+    }
+    double total_ns = linea.flancos.empty() ? 0 : (double)(linea.flancos.back().t_ns - linea.flancos.front().t_ns);
+    double ocupacion = total_ns > 0 ? ocupado_ns / total_ns : 0;
+    int decodificados = 0;
+    int correctos = verificarLinea(linea, ultimos, decodificados);
+    printf("  Línea virtual a %d bps: %ld reproducidos, %d decodificados, %d iguales a los capturados\n", VELOCIDAD,
+           reenviados, decodificados, correctos);
+    double sesion_total_ns = (double)(sesion_ns + duracionFrameNs(largos.back(), VELOCIDAD));
+    printf("  Ocupación de la línea: %.1f%% (en la sesión original, %.1f%%)\n", 100.0 * ocupacion,
+           100.0 * ocupado_ns / sesion_total_ns);
+    return reenviados == CAPACIDAD && correctos == CAPACIDAD && ocupacion >= OCUPACION_MINIMA;
+}
+
+int escenarioCaptura(int argc, char** argv) {
+    char ruta[] = "/tmp/captura_XXXXXX";
+    int fd = mkstemp(ruta);
+    if (fd < 0) {
+        printf("No se pudo crear el archivo de prueba en /tmp.\n");
+        return 1;
+    }
+    close(fd);
+
+    printf("Registro de capturas mapeado en memoria (%d bytes por registro)\n", (int)sizeof(registroFrame));
+    bool ok_anillo = verificarAnillo(ruta);
+    unlink(ruta);
+    bool ok_costo = medirRegistro(ruta);
+    unlink(ruta);
+    bool ok_nulo = verificarNulo(ruta);
+    unlink(ruta);
+    bool ok_saturacion = verificarSaturacion(ruta);
+    unlink(ruta);
+
+    printf("\n  El anillo guarda los últimos y salta los registros incompletos: %s\n", ok_anillo ? "sí" : "NO");
+    printf("  Registrar cuesta menos de un bit a la velocidad más alta (p99): %s\n", ok_costo ? "sí" : "NO");
+    printf("  Por el transporte nulo, sin esperas o con los tiempos originales: %s\n", ok_nulo ? "sí" : "NO");
+    printf("  A máxima velocidad la línea queda ocupada más del %.0f%% y llega todo: %s\n",
+           100.0 * OCUPACION_MINIMA, ok_saturacion ? "sí" : "NO");
+    return (ok_anillo && ok_costo && ok_nulo && ok_saturacion) ? 0 : 1;
+}
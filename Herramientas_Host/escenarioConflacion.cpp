@@ -0,0 +1,306 @@
+/**
+ * @file escenarioConflacion.cpp
+ * @brief Conflación por clave en las colas del emisor (prioridadEnvio.cpp)
+ * con un productor mucho más rápido que la línea.
+ * @details Como el escenario "prioridades": las colas sobre una línea
+ * virtual de SPEED bps, donde cada frame ocupa la línea hasta su último
+ * bit. El productor manda textos al OLED (CMD 2), temperaturas (CMD 3) y
+ * frecuencias del LED (CMD 5) varias veces por segundo, más algunos
+ * toggles (CMD 4) y arreglos (CMD 7) que no tienen clave. Todo pasa por
+ * desempaquetar() y reensambleProcesar() del receptor.
+ *
+ * El retraso de un valor es desde que se produce hasta que el receptor
+ * muestra ese valor o uno más nuevo de su clave. Con conflación:
+ * - Con solo el OLED produciendo, el retraso no pasa de lo que está en la
+ *   línea (un frame, o el resto de un mensaje en fragmentos) más el mensaje
+ *   del valor nuevo.
+ * - Con todas las fuentes, cada clave y cada frame sin clave que se gana
+ *   el turno entre dos mensajes con clave suman uno: sin ese turno, una
+ *   clave que cambia más rápido que la línea dejaría sin salir al control.
+ *   No depende de cuántos sin clave haya en la cola.
+ * La cola no crece más que las claves y al final el OLED y el LED tienen
+ * el último valor. 'conflados' tiene que ser exactamente lo producido
+ * menos lo entregado.
+ */
+
+#include "escenarios.h"
+#include "prioridadEnvio.h"
+#include "recibe.h"
+#include "reensambleFrames.h"
+#include "Arduino.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#define NS_POR_S 1000000000ULL
+#define BITS_POR_BYTE 11        // Inicio + 8 datos + 2 de parada
+#define BITS_FIN_FRAME 2        // Paridad del frame + stop final
+
+// Período medio de cada fuente (s): las de clave, muy por encima de lo que
+// lleva la línea; las sin clave, de vez en cuando
+static const int CMD_FUENTE[] = {2, 3, 5, 4, 7};
+static const double PERIODO_FUENTE_S[] = {0.5, 2.0, 1.0, 300.0, 900.0};
+#define NUM_FUENTES (int)(sizeof(CMD_FUENTE) / sizeof(CMD_FUENTE[0]))
+
+typedef struct
+{
+    const char* nombre;
+    bool conflar;
+    int frag_datos;
+} varianteConflacion;
+
+static const varianteConflacion VARIANTES[] = {
+    {"sin conflación (hoy)", false, 0},
+    {"conflación, sin fragmentar", true, 0},
+    {"conflación, fragmentos de 16", true, 16},
+};
+
+typedef struct
+{
+    uint64_t t_ns;
+    protocolo proto;
+    int indice;                // Orden de producción dentro de su clave (-1 sin clave)
+} valorProducido;
+
+typedef struct
+{
+    unsigned long frames;
+    unsigned long conflados;
+    unsigned long producidos_clave;
+    unsigned long entregados_clave;
+    unsigned long incorrectos;
+    size_t cola_max;               // Mensajes pendientes, todas las clases
+    size_t sin_clave_max;          // De esos, sin clave
+    double aire_frame_max_s;       // El frame más largo (entero o fragmento)
+    double aire_clave_max_s;       // El mensaje con clave más largo, con todos sus fragmentos
+    double retraso_p50_s[NUM_CLAVES_CONF];
+    double retraso_max_s[NUM_CLAVES_CONF];
+    bool ultimo_visto[NUM_CLAVES_CONF];
+    double duracion_s;             // Hasta vaciar las colas
+} resultadoConflacion;
+
+static uint64_t aireNs(int largo) {
+    return (uint64_t)(largo * BITS_POR_BYTE + BITS_FIN_FRAME) * NS_POR_S / SPEED;
+}
+
+static std::vector<valorProducido> generarTrafico(double duracion_s, unsigned semilla, bool solo_oled,
+                                                  int producidos[NUM_CLAVES_CONF]) {
+    std::mt19937 rng(semilla);
+    std::vector<valorProducido> llegadas;
+    for (int f = 0; f < NUM_FUENTES; f++) {
+        if (solo_oled && claveConflacion(CMD_FUENTE[f]) != CONF_OLED) continue;
+        std::exponential_distribution<double> intervalo(1.0 / PERIODO_FUENTE_S[f]);
+        for (double t = intervalo(rng); t < duracion_s; t += intervalo(rng)) {
+            valorProducido l;
+            l.t_ns = (uint64_t)(t * NS_POR_S);
+            memset(&l.proto, 0, sizeof(protocolo));
+            l.proto.cmd = CMD_FUENTE[f];
+            char texto[LARGO_DATA + 1];
+            switch (l.proto.cmd) {
+                case 2:
+                    l.proto.lng = (BYTE)(20 + rng() % 21);
+                    for (int i = 0; i < l.proto.lng; i++) l.proto.data[i] = (BYTE)('a' + rng() % 26);
+                    break;
+                case 3:
+                    l.proto.lng = (BYTE)snprintf(texto, sizeof(texto), "%d.%d", 15 + (int)(rng() % 20),
+                                                 (int)(rng() % 10));
+                    memcpy(l.proto.data, texto, l.proto.lng);
+                    break;
+                case 5:
+                    l.proto.lng = (BYTE)snprintf(texto, sizeof(texto), "%d", 1 + (int)(rng() % 100));
+                    memcpy(l.proto.data, texto, l.proto.lng);
+                    break;
+                case 7:
+                    l.proto.lng = 40;
+                    for (int i = 0; i < l.proto.lng; i++) l.proto.data[i] = (BYTE)rng();
+                    break;
+                default:
+                    break;
+            }
+            llegadas.push_back(l);
+        }
+    }
+    std::sort(llegadas.begin(), llegadas.end(),
+              [](const valorProducido& a, const valorProducido& b) { return a.t_ns < b.t_ns; });
+    for (int k = 0; k < NUM_CLAVES_CONF; k++) producidos[k] = 0;
+    for (size_t i = 0; i < llegadas.size(); i++) {
+        int clave = claveConflacion(llegadas[i].proto.cmd);
+        llegadas[i].indice = (clave == CONF_SIN_CLAVE) ? -1 : producidos[clave]++;
+    }
+    return llegadas;
+}
+
+static bool recibir(reensambleFrames& reensamble, const unidadEnvio& u, frameReceptor& rx) {
+    memcpy(rx.frame, u.proto.frame, u.largo);
+    rx.cmd = FrameEstandar::cmdDe(rx.frame);
+    rx.lng = FrameEstandar::lngDe(rx.frame);
+    if (!desempaquetar(rx)) return false;
+    resultadoFragmento r = reensambleProcesar(reensamble, rx);
+    return r == FRAG_NO_ES || r == FRAG_COMPLETO;
+}
+
+/**
+ * Retraso de cada valor producido: hasta que se muestra él o uno más nuevo.
+ * 'mostrados' son (instante, índice) en el orden en que llegaron al receptor.
+ */
+static void calcularRetrasos(const std::vector<valorProducido>& llegadas, int clave,
+                             const std::vector<std::pair<uint64_t, int> >& mostrados, double& p50, double& maximo) {
+    std::vector<double> retrasos;
+    size_t m = 0;
+    int mayor = -1; // El valor más nuevo mostrado hasta mostrados[m - 1]
+    for (size_t i = 0; i < llegadas.size(); i++) {
+        const valorProducido& l = llegadas[i];
+        if (claveConflacion(l.proto.cmd) != clave) continue;
+        while (mayor < l.indice && m < mostrados.size()) {
+            mayor = std::max(mayor, mostrados[m++].second);
+        }
+        if (mayor < l.indice) break; // No se mostró nunca (no pasa si se vacían las colas)
+        retrasos.push_back((mostrados[m - 1].first - l.t_ns) / (double)NS_POR_S);
+    }
+    std::sort(retrasos.begin(), retrasos.end());
+    p50 = retrasos.empty() ? 0 : retrasos[retrasos.size() / 2];
+    maximo = retrasos.empty() ? 0 : retrasos.back();
+}
+
+static void simular(const varianteConflacion& v, const std::vector<valorProducido>& llegadas,
+                    const int producidos[NUM_CLAVES_CONF], resultadoConflacion& r) {
+    static colaPrioridades cola;
+    prioridadesIniciar(cola, v.frag_datos, true, NULL);
+    cola.conflar = v.conflar;
+    static reensambleFrames reensamble;
+    reensambleIniciar(reensamble);
+
+    std::map<uint64_t, const valorProducido*> originales; // La hora de valorProducido es única
+    for (size_t i = 0; i < llegadas.size(); i++) originales[llegadas[i].t_ns] = &llegadas[i];
+
+    std::vector<std::pair<uint64_t, int> > mostrados[NUM_CLAVES_CONF];
+    std::map<uint64_t, uint64_t> aire_mensaje; // Por mensaje (t_encolado_ns), sumando fragmentos
+    memset(&r, 0, sizeof(r));
+
+    uint64_t ahora = 0;
+    size_t siguiente = 0;
+    frameReceptor rx;
+    for (;;) {
+        while (siguiente < llegadas.size() && llegadas[siguiente].t_ns <= ahora) {
+            const valorProducido& l = llegadas[siguiente++];
+            prioridadesEncolar(cola, l.proto, l.t_ns);
+            size_t total = 0, sin_clave = 0;
+            for (int i = 0; i <= COLA_CLAVES; i++) {
+                const std::deque<mensajeEnvio>& pendientes = cola.clases[i].pendientes;
+                total += pendientes.size();
+                for (size_t j = 0; j < pendientes.size(); j++) {
+                    if (pendientes[j].clave == CONF_SIN_CLAVE) sin_clave++;
+                }
+            }
+            r.cola_max = std::max(r.cola_max, total);
+            r.sin_clave_max = std::max(r.sin_clave_max, sin_clave);
+        }
+
+        unidadEnvio u;
+        if (!prioridadesSiguiente(cola, u)) {
+            if (siguiente >= llegadas.size()) break;
+            ahora = llegadas[siguiente].t_ns;
+            continue;
+        }
+        uint64_t aire = aireNs(u.largo);
+        ahora += aire;
+        r.frames++;
+        r.aire_frame_max_s = std::max(r.aire_frame_max_s, aire / (double)NS_POR_S);
+        uint64_t& aire_total = aire_mensaje[u.t_encolado_ns];
+        aire_total += aire;
+        if (u.ultimo && claveConflacion(originales[u.t_encolado_ns]->proto.cmd) != CONF_SIN_CLAVE) {
+            r.aire_clave_max_s = std::max(r.aire_clave_max_s, aire_total / (double)NS_POR_S);
+        }
+
+        if (!recibir(reensamble, u, rx) || !u.ultimo) continue;
+        const valorProducido* original = originales[u.t_encolado_ns];
+        if (original == NULL || rx.cmd != original->proto.cmd || rx.lng != original->proto.lng ||
+            memcmp(payload(rx), original->proto.data, rx.lng) != 0) {
+            r.incorrectos++;
+            continue;
+        }
+        int clave = claveConflacion(rx.cmd);
+        if (clave != CONF_SIN_CLAVE) {
+            mostrados[clave].push_back(std::make_pair(ahora, original->indice));
+            r.entregados_clave++;
+        }
+    }
+    r.duracion_s = ahora / (double)NS_POR_S;
+    r.conflados = cola.conflados;
+    for (int k = 0; k < NUM_CLAVES_CONF; k++) {
+        r.producidos_clave += producidos[k];
+        calcularRetrasos(llegadas, k, mostrados[k], r.retraso_p50_s[k], r.retraso_max_s[k]);
+        r.ultimo_visto[k] = !mostrados[k].empty() && mostrados[k].back().second == producidos[k] - 1;
+    }
+}
+
+/**
+ * Corre las variantes sobre un mismo tráfico. Con 'solo_oled' la cota es
+ * la estricta: lo que está en la línea más el mensaje del valor nuevo.
+ */
+static bool correrTrafico(double duracion_s, unsigned semilla, bool solo_oled) {
+    int producidos[NUM_CLAVES_CONF];
+    std::vector<valorProducido> llegadas = generarTrafico(duracion_s, semilla, solo_oled, producidos);
+    printf("%s: %zu mensajes en %.0f s (%d para el OLED, %d para el LED)\n",
+           solo_oled ? "Solo el OLED" : "Todas las fuentes", llegadas.size(), duracion_s, producidos[CONF_OLED],
+           producidos[CONF_LED]);
+    printf("  %-30s %7s %9s %6s %18s %18s %10s\n", "variante", "frames", "pisados", "cola", "OLED p50/máx (s)",
+           "LED p50/máx (s)", "vaciar (s)");
+
+    bool ok = true;
+    double retraso_sin = 0;
+    for (size_t v = 0; v < sizeof(VARIANTES) / sizeof(VARIANTES[0]); v++) {
+        resultadoConflacion r;
+        simular(VARIANTES[v], llegadas, producidos, r);
+        printf("  %-30s %7lu %9lu %6zu %8.0f / %-8.0f %8.0f / %-8.0f %10.0f\n", VARIANTES[v].nombre, r.frames,
+               r.conflados, r.cola_max, r.retraso_p50_s[CONF_OLED], r.retraso_max_s[CONF_OLED],
+               r.retraso_p50_s[CONF_LED], r.retraso_max_s[CONF_LED], r.duracion_s);
+
+        // Lo que está en la línea: un frame sin clave o el resto de un mensaje con clave
+        double en_linea = std::max(r.aire_frame_max_s, r.aire_clave_max_s);
+        double cota = solo_oled ? en_linea + r.aire_clave_max_s
+                                : en_linea + NUM_CLAVES_CONF * (r.aire_clave_max_s + r.aire_frame_max_s);
+        bool cuentas = r.conflados == r.producidos_clave - r.entregados_clave;
+        bool ultimos = true;
+        for (int k = 0; k < NUM_CLAVES_CONF; k++) {
+            if (producidos[k] > 0) ultimos = ultimos && r.ultimo_visto[k];
+        }
+        bool variante_ok = cuentas && r.incorrectos == 0;
+        if (VARIANTES[v].conflar) {
+            bool acotado = r.retraso_max_s[CONF_OLED] <= cota && r.retraso_max_s[CONF_LED] <= cota;
+            bool cola = r.cola_max <= NUM_CLAVES_CONF + r.sin_clave_max;
+            printf("  %-30s retraso máx <= %.0f s (%s): %s | cola <= %d claves + %zu sin clave: %s\n", "", cota,
+                   solo_oled ? "en la línea + el suyo" : "en la línea + clave y turno sin clave por clave",
+                   acotado ? "sí" : "NO", NUM_CLAVES_CONF, r.sin_clave_max, cola ? "sí" : "NO");
+            variante_ok = variante_ok && acotado && cola && ultimos && r.retraso_max_s[CONF_OLED] < retraso_sin;
+        } else {
+            // Hoy un CMD 3 (interactivo) puede adelantarse a un CMD 2 (masivo)
+            // más nuevo: el último valor no siempre es el que queda
+            retraso_sin = r.retraso_max_s[CONF_OLED];
+            variante_ok = variante_ok && r.conflados == 0;
+        }
+        printf("  %-30s pisados = producidos - entregados: %s | último valor de cada clave: %s%s\n", "",
+               cuentas ? "sí" : "NO", ultimos ? "sí" : "NO",
+               r.incorrectos ? " | ENTREGADOS DISTINTOS DEL ORIGINAL" : "");
+        ok = ok && variante_ok;
+    }
+    printf("\n");
+    return ok;
+}
+
+int escenarioConflacion(int argc, char** argv) {
+    double duracion_s = (argc > 0) ? atof(argv[0]) : 3600.0;
+    unsigned semilla = (argc > 1) ? (unsigned)atoi(argv[1]) : 7;
+    if (duracion_s <= 0) {
+        printf("Uso: ./simulador conflacion [segundos de tráfico] [semilla]\n");
+        return 1;
+    }
+    printf("Conflación a %d bps\n\n", SPEED);
+    bool ok = correrTrafico(duracion_s, semilla, true);
+    ok = correrTrafico(duracion_s, semilla, false) && ok;
+    printf("  La línea lleva solo el último valor de cada clave: %s\n", ok ? "sí" : "NO");
+    return ok ? 0 : 1;
+}
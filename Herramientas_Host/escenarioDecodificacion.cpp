@@ -0,0 +1,147 @@
+/**
+ * @file escenarioDecodificacion.cpp
+ * @brief Costo y memoria de la decodificación de frames en el receptor.
+ * @details Compara el camino anterior (memset del struct completo en cada
+ * recibirFrame y copia de frame[2..] a data[] en desempaquetar) con el
+ * actual (un solo buffer, payload leído en su lugar). Mide solo el trabajo
+ * de memoria y el FCS sobre frames ya recibidos, sin la temporización de
+ * los bits, y reporta la RAM que ocupan los buffers de frames.
+ */
+
+#include "escenarios.h"
+#include "recibe.h"
+#include "pipelineReceptor.h"
+#include "Arduino.h"
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+typedef std::chrono::steady_clock reloj;
+
+#define FRAMES_DISTINTOS 1024
+#define RONDAS 7 // Se alternan los dos caminos y se toma el mejor tiempo de cada uno
+
+/**
+ * El struct del receptor antes del cambio: payload copiado en data[].
+ */
+typedef struct
+{
+    BYTE cmd;
+    BYTE lng;
+    BYTE data[LARGO_DATA];
+    BYTE frame[LARGO_DATA + BYTES_EXTRA];
+    unsigned short fcs;
+} protocoloAnterior;
+
+/**
+ * Frames crudos como llegan por la línea, con largos al azar.
+ */
+static void generarFrames(std::vector<BYTE>& crudos, std::vector<int>& largos, unsigned semilla) {
+    srand(semilla);
+    crudos.assign(FRAMES_DISTINTOS * LARGO_FRAME, 0);
+    largos.resize(FRAMES_DISTINTOS);
+    for (int f = 0; f < FRAMES_DISTINTOS; f++) {
+        BYTE* frame = &crudos[f * LARGO_FRAME];
+        int lng = 1 + rand() % LARGO_DATA;
+        int cmd = 1 + rand() % 7;
+        for (int i = 0; i < lng; i++) frame[i + 2] = (BYTE)(' ' + rand() % 95);
+        largos[f] = FrameEstandar::cerrar(frame, cmd, lng);
+    }
+}
+
+/**
+ * Lo que hacían recibirFrame() (memset + un byte por readByte) y
+ * desempaquetar() (copia a data[] + FCS) con el struct anterior.
+ */
+static bool decodificarAnterior(protocoloAnterior& proto, const BYTE* linea, int largo, bool con_fcs) {
+    memset(&proto, 0, sizeof(protocoloAnterior));
+    for (int i = 0; i < largo; i++) proto.frame[i] = linea[i];
+    proto.cmd = (proto.frame[0] >> 2) & 0x0F;
+    proto.lng = (proto.frame[1] >> 1) & 0x3F;
+
+    for (int i = 0; i < proto.lng; i++) {
+        proto.data[i] = proto.frame[i + 2];
+    }
+    proto.fcs = (proto.frame[proto.lng + 2] << 8) | proto.frame[proto.lng + 3];
+    if (!con_fcs) return true;
+
+    unsigned short fcs_calculado = fcs(proto.frame, proto.lng + 2);
+    Serial.printf("FCS Recibido: %u\n", proto.fcs);
+    Serial.printf("FCS Calculado: %u\n", fcs_calculado);
+    return fcs_calculado == proto.fcs;
+}
+
+/**
+ * El camino actual. Con FCS es desempaquetar() tal cual.
+ */
+static bool decodificarActual(frameReceptor& proto, const BYTE* linea, int largo, bool con_fcs) {
+    proto.cmd = 0;
+    proto.lng = 0;
+    for (int i = 0; i < largo; i++) proto.frame[i] = linea[i];
+    proto.cmd = (proto.frame[0] >> 2) & 0x0F;
+    proto.lng = (proto.frame[1] >> 1) & 0x3F;
+
+    if (con_fcs) return desempaquetar(proto);
+    proto.fcs = (proto.frame[proto.lng + 2] << 8) | proto.frame[proto.lng + 3];
+    proto.frame[proto.lng + 2] = '\0';
+    return true;
+}
+
+/**
+ * ns por frame de cada camino. 'suma' evita que el compilador descarte el trabajo.
+ */
+template <typename T, typename F>
+static double medir(F decodificar, const std::vector<BYTE>& crudos, const std::vector<int>& largos,
+                    long frames, bool con_fcs, unsigned long& suma) {
+    static T pool[PIPE_NUM_BUFFERS];
+    reloj::time_point inicio = reloj::now();
+    for (long n = 0; n < frames; n++) {
+        int f = (int)(n % FRAMES_DISTINTOS);
+        T& proto = pool[n & (PIPE_NUM_BUFFERS - 1)];
+        if (decodificar(proto, &crudos[f * LARGO_FRAME], largos[f], con_fcs)) {
+            suma += proto.lng + proto.frame[2];
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(reloj::now() - inicio).count();
+    return ns / frames;
+}
+
+int escenarioDecodificacion(int argc, char** argv) {
+    long frames = (argc > 0) ? atol(argv[0]) : 500000;
+    if (frames <= 0) {
+        printf("Uso: ./simulador decodificacion [frames]\n");
+        return 1;
+    }
+    g_hal_serial_silencio = true; // desempaquetar() imprime los FCS
+
+    std::vector<BYTE> crudos;
+    std::vector<int> largos;
+    generarFrames(crudos, largos, 1);
+
+    unsigned long suma = 0;
+    printf("Decodificación de %ld frames (largo al azar 1..%d), ns por frame\n", frames, LARGO_DATA);
+    printf("  %-26s %10s %10s %8s\n", "", "anterior", "actual", "mejora");
+    const char* etapas[2] = {"memset + copias", "memset + copias + FCS"};
+    for (int con_fcs = 0; con_fcs <= 1; con_fcs++) {
+        double anterior = 1e18, actual = 1e18;
+        for (int ronda = 0; ronda < RONDAS; ronda++) {
+            double a = medir<protocoloAnterior>(decodificarAnterior, crudos, largos, frames, con_fcs, suma);
+            double b = medir<frameReceptor>(decodificarActual, crudos, largos, frames, con_fcs, suma);
+            if (a < anterior) anterior = a;
+            if (b < actual) actual = b;
+        }
+        printf("  %-26s %10.1f %10.1f %7.2fx\n", etapas[con_fcs], anterior, actual, anterior / actual);
+    }
+    g_hal_serial_silencio = false;
+
+    // RAM: el pool del pipeline más el frame de descarte de la tarea de recepción
+    int buffers = PIPE_NUM_BUFFERS + 1;
+    printf("\nRAM de frames en el receptor (%d del pool + 1 de descarte)\n", PIPE_NUM_BUFFERS);
+    printf("  %-26s %10s %10s\n", "", "anterior", "actual");
+    printf("  %-26s %10zu %10zu\n", "bytes por frame", sizeof(protocoloAnterior), sizeof(frameReceptor));
+    printf("  %-26s %10zu %10zu\n", "bytes en total", buffers * sizeof(protocoloAnterior),
+           buffers * sizeof(frameReceptor));
+    printf("  Ahorro: %.0f%%  (comprobación: %lu)\n",
+           100.0 * (1.0 - (double)sizeof(frameReceptor) / sizeof(protocoloAnterior)), suma % 10);
+    return 0;
+}
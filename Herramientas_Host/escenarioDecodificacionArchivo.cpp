@@ -0,0 +1,275 @@
+/**
+ * @file escenarioDecodificacionArchivo.cpp
+ * @brief El decodificador de capturas (decodificacionArchivo.h) sobre
+ * archivos escritos con la salida real del emisor.
+ * @details Se verifica:
+ * - Volcado crudo armado con nivelesFrame(), la línea en un bit y ruido en
+ *   los otros siete: los frames decodificados son los enviados, con 1 hilo
+ *   y con varios (los bloques cortan frames por la mitad). En un frame, un
+ *   byte sale con el bit de inicio atrasado 0,7 bits: el receptor lo lee
+ *   igual y el error de flanco tiene que dar ese 70% (medido desde el bit
+ *   de inicio anterior), no el 30% de la grilla de bits más cercana.
+ * - La búsqueda de flancos de a 8 muestras por palabra (la de las
+ *   arquitecturas sin SSE2) contra la que usa el decodificador, en todos
+ *   los canales y con bloques desalineados.
+ * - VCD escrito con los flancos que deja enviarFrame() en una línea
+ *   virtual, con otra señal antes que la de la línea (--senal).
+ */
+
+#include "escenarios.h"
+#include "decodificacionArchivo.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <string>
+#include <thread>
+#include <random>
+#include <vector>
+
+#define PIN_SIMULADO 0
+#define SPEED_LINEA 250
+#define MUESTRAS_POR_BIT 40
+#define CANAL 5
+#define PAUSA_MS 50
+#define FRAMES 40
+#define FRAME_ATRASADO 5             // El frame con un inicio atrasado ...
+#define BYTE_ATRASADO 3              // ... en este byte ...
+#define ATRASO_BIT 0.7               // ... en esta fracción de bit
+#define TOLERANCIA_PCT 3.0           // Una muestra es el 2,5% del bit
+
+typedef struct
+{
+    int64_t inicio_ns;
+    protocolo proto;
+} frameEnviado;
+
+static void armarFrame(std::mt19937& rng, protocolo& proto) {
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = 1 + rng() % 7;
+    proto.lng = 5 + rng() % 36;
+    for (int k = 0; k < proto.lng; k++) proto.data[k] = (BYTE)('a' + rng() % 26);
+}
+
+/**
+ * Agrega 'cantidad' muestras con la línea en 'nivel' y ruido en los otros bits.
+ */
+static void agregarMuestras(std::mt19937& rng, std::vector<uint8_t>& muestras, int nivel, int cantidad) {
+    for (int i = 0; i < cantidad; i++) {
+        uint8_t ruido = (uint8_t)(rng() & ~(1u << CANAL));
+        muestras.push_back((uint8_t)(ruido | (nivel << CANAL)));
+    }
+}
+
+/**
+ * Volcado crudo: los frames de nivelesFrame() con PAUSA_MS entre uno y otro.
+ */
+static void armarCrudo(std::mt19937& rng, std::vector<uint8_t>& muestras, std::vector<frameEnviado>& enviados) {
+    const int ns_por_muestra = 1000000000 / (SPEED_LINEA * MUESTRAS_POR_BIT);
+    const int pausa = PAUSA_MS * 1000000 / ns_por_muestra;
+    const int bits_byte = 9 + FORMATO_LINEA_ESTANDAR.bits_parada;
+    BYTE niveles[BITS_FRAME(LARGO_DATA + BYTES_EXTRA, 2)];
+    agregarMuestras(rng, muestras, HIGH, pausa);
+    for (int f = 0; f < FRAMES; f++) {
+        frameEnviado e;
+        armarFrame(rng, e.proto);
+        protocolo tx = e.proto;
+        int largo = empaquetar(tx);
+        e.inicio_ns = (int64_t)muestras.size() * ns_por_muestra;
+        enviados.push_back(e);
+
+        int n = nivelesFrame(tx, largo, niveles);
+        for (int b = 0; b < n; b++) {
+            if (f == FRAME_ATRASADO && b == BYTE_ATRASADO * bits_byte) {
+                agregarMuestras(rng, muestras, HIGH, (int)(ATRASO_BIT * MUESTRAS_POR_BIT));
+            }
+            agregarMuestras(rng, muestras, niveles[b], MUESTRAS_POR_BIT);
+        }
+        agregarMuestras(rng, muestras, HIGH, pausa);
+    }
+}
+
+/**
+ * VCD: los flancos que escribe enviarFrame() en una línea virtual, en us.
+ */
+static void armarVcd(std::mt19937& rng, std::string& vcd, std::vector<frameEnviado>& enviados) {
+    lineaVirtual linea;
+    linea.ahora_ns = (int64_t)PAUSA_MS * 1000000;
+    halUsarLinea(&linea);
+    for (int f = 0; f < FRAMES; f++) {
+        frameEnviado e;
+        armarFrame(rng, e.proto);
+        protocolo tx = e.proto;
+        int largo = empaquetar(tx);
+        e.inicio_ns = linea.ahora_ns;
+        enviados.push_back(e);
+        enviarFrame(PIN_SIMULADO, SPEED_LINEA, tx, largo);
+        delay(PAUSA_MS);
+    }
+    halUsarLinea(NULL);
+
+    char renglon[64];
+    vcd = "$timescale 1us $end\n$scope module analizador $end\n"
+          "$var wire 1 ! reloj $end\n$var wire 1 \" gpio17 $end\n$upscope $end\n$enddefinitions $end\n"
+          "#0\n$dumpvars\n0!\n1\"\n$end\n";
+    for (size_t i = 0; i < linea.flancos.size(); i++) {
+        snprintf(renglon, sizeof(renglon), "#%lld\n%d\"\n", (long long)(linea.flancos[i].t_ns / 1000),
+                 linea.flancos[i].nivel);
+        vcd += renglon;
+        if (i % 8 == 0) vcd += "1!\n0!\n"; // La otra señal cambia en el mismo instante
+    }
+    snprintf(renglon, sizeof(renglon), "#%lld\n", (long long)(linea.ahora_ns / 1000));
+    vcd += renglon;
+}
+
+static bool escribirArchivo(char* ruta, const void* datos, size_t n) {
+    int fd = mkstemp(ruta);
+    if (fd < 0) return false;
+    bool ok = write(fd, datos, n) == (ssize_t)n;
+    close(fd);
+    return ok;
+}
+
+/**
+ * Los frames decodificados contra los enviados: mismos datos, mismo inicio
+ * (hasta una muestra) y sin errores.
+ */
+static int compararFrames(const std::vector<frameDecodificado>& frames, const std::vector<frameEnviado>& enviados,
+                          int64_t tolerancia_ns) {
+    int iguales = 0;
+    for (size_t i = 0; i < frames.size() && i < enviados.size(); i++) {
+        const frameDecodificado& d = frames[i];
+        const protocolo& p = enviados[i].proto;
+        if (d.estado == DECODIFICADO_OK && d.cmd == p.cmd && d.lng == p.lng && memcmp(d.datos, p.data, d.lng) == 0 &&
+            llabs(d.inicio_ns - enviados[i].inicio_ns) <= tolerancia_ns) {
+            iguales++;
+        }
+    }
+    return (frames.size() == enviados.size()) ? iguales : -1;
+}
+
+static double peorError(const std::vector<frameDecodificado>& frames, size_t salvo) {
+    double peor = 0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (i != salvo && frames[i].error_max_pct > peor) peor = frames[i].error_max_pct;
+    }
+    return peor;
+}
+
+static bool verificarCrudo(const std::vector<uint8_t>& muestras, const std::vector<frameEnviado>& enviados) {
+    char ruta[] = "/tmp/decodificacion_XXXXXX";
+    if (!escribirArchivo(ruta, muestras.data(), muestras.size())) {
+        printf("No se pudo escribir el volcado en /tmp.\n");
+        return false;
+    }
+    opcionesDecodificador op;
+    memset(&op, 0, sizeof(op));
+    op.ruta = ruta;
+    op.vcd = false;
+    op.frecuencia_hz = SPEED_LINEA * MUESTRAS_POR_BIT;
+    op.canal = CANAL;
+    op.speed = SPEED_LINEA;
+
+    int hilos_max = std::max(4, (int)std::thread::hardware_concurrency());
+    const int HILOS[] = {1, hilos_max};
+    const int64_t muestra_ns = 1000000000LL / (SPEED_LINEA * MUESTRAS_POR_BIT);
+    bool ok = true;
+    size_t flancos_1 = 0;
+    for (int h = 0; h < 2; h++) {
+        op.hilos = HILOS[h];
+        lineaVirtual linea;
+        std::vector<frameDecodificado> frames;
+        bool leido = leerFlancos(op, linea, NULL);
+        if (h == 0) flancos_1 = linea.flancos.size();
+        decodificarLinea(linea, op.speed, frames);
+        int iguales = compararFrames(frames, enviados, muestra_ns);
+        double atrasado = frames.size() > FRAME_ATRASADO ? frames[FRAME_ATRASADO].error_max_pct : 0;
+        double resto = peorError(frames, FRAME_ATRASADO);
+        printf("  Crudo, %2d hilo(s): %zu flancos, %d/%d frames iguales; error del inicio atrasado %.1f%%, "
+               "peor del resto %.1f%%\n", op.hilos, linea.flancos.size(), iguales, FRAMES, atrasado, resto);
+        ok = ok && leido && iguales == FRAMES && linea.flancos.size() == flancos_1 &&
+             fabs(atrasado - 100.0 * ATRASO_BIT) <= TOLERANCIA_PCT && resto <= TOLERANCIA_PCT;
+    }
+    unlink(ruta);
+    return ok;
+}
+
+/**
+ * Las dos búsquedas de flancos sobre el mismo volcado, en bloques que no
+ * empiezan alineados a 8 ni a 16 muestras.
+ */
+static bool verificarBusquedas(const std::vector<uint8_t>& muestras) {
+    const size_t CORTES[] = {0, 3, 17, 4099};
+    bool ok = true;
+    for (int canal = 0; canal < 8; canal++) {
+        for (size_t c = 0; c < sizeof(CORTES) / sizeof(CORTES[0]); c++) {
+            size_t ini = CORTES[c], fin = muestras.size() - CORTES[c] / 2;
+            int previo = (muestras[ini > 0 ? ini - 1 : 0] >> canal) & 1;
+            std::vector<uint64_t> a, b;
+            buscarFlancos(muestras.data(), ini, fin, canal, previo, a);
+            buscarFlancosPalabra(muestras.data(), ini, fin, canal, previo, b);
+            if (a != b) ok = false;
+        }
+    }
+#if defined(__SSE2__) && !defined(SIN_SSE2)
+    const char* version = "SSE2";
+#else
+    const char* version = "palabras de 64 bits";
+#endif
+    printf("  Búsqueda por palabras igual a la del decodificador (%s), 8 canales: %s\n", version, ok ? "sí" : "NO");
+    return ok;
+}
+
+static bool verificarVcd(const std::string& vcd, const std::vector<frameEnviado>& enviados) {
+    char ruta[] = "/tmp/decodificacion_XXXXXX";
+    if (!escribirArchivo(ruta, vcd.data(), vcd.size())) {
+        printf("No se pudo escribir el VCD en /tmp.\n");
+        return false;
+    }
+    opcionesDecodificador op;
+    memset(&op, 0, sizeof(op));
+    op.ruta = ruta;
+    op.vcd = true;
+    op.senal = "gpio17";
+    op.speed = SPEED_LINEA;
+    op.hilos = 1;
+    lineaVirtual linea;
+    std::vector<frameDecodificado> frames;
+    bool leido = leerFlancos(op, linea, NULL);
+    decodificarLinea(linea, op.speed, frames);
+    unlink(ruta);
+    int iguales = compararFrames(frames, enviados, 1000);
+    double peor = peorError(frames, frames.size());
+    printf("  VCD de enviarFrame(): %zu flancos, %d/%d frames iguales, peor error de flanco %.1f%%\n",
+           linea.flancos.size(), iguales, FRAMES, peor);
+    return leido && iguales == FRAMES && peor <= TOLERANCIA_PCT;
+}
+
+int escenarioDecodificacionArchivo(int argc, char** argv) {
+    unsigned semilla = (argc > 0) ? (unsigned)atoi(argv[0]) : 1;
+    std::mt19937 rng(semilla);
+    g_hal_serial_silencio = true;
+
+    printf("Decodificador de capturas, %d frames a %d bps\n", FRAMES, SPEED_LINEA);
+    std::vector<uint8_t> muestras;
+    std::vector<frameEnviado> enviados_crudo;
+    armarCrudo(rng, muestras, enviados_crudo);
+    printf("  Volcado crudo: %zu muestras a %d Hz, la línea en el bit %d\n", muestras.size(),
+           SPEED_LINEA * MUESTRAS_POR_BIT, CANAL);
+    bool ok_crudo = verificarCrudo(muestras, enviados_crudo);
+    bool ok_busquedas = verificarBusquedas(muestras);
+
+    std::string vcd;
+    std::vector<frameEnviado> enviados_vcd;
+    armarVcd(rng, vcd, enviados_vcd);
+    bool ok_vcd = verificarVcd(vcd, enviados_vcd);
+    g_hal_serial_silencio = false;
+
+    printf("\n  Crudo con 1 y con varios hilos, inicio atrasado medido entero: %s\n", ok_crudo ? "sí" : "NO");
+    printf("  Sin SSE2, los mismos flancos: %s\n", ok_busquedas ? "sí" : "NO");
+    printf("  VCD con los frames de enviarFrame(): %s\n", ok_vcd ? "sí" : "NO");
+    return (ok_crudo && ok_busquedas && ok_vcd) ? 0 : 1;
+}
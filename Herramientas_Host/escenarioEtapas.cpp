@@ -0,0 +1,409 @@
+/**
+ * @file escenarioEtapas.cpp
+ * @brief Latencia por etapas del menú al OLED: emparejamiento de los
+ * registros de la ESP32 con los envíos y percentiles por comando.
+ * @details El emisor arma frames con los empaquetar() y enviarFrame()
+ * reales sobre una línea virtual: cada mensaje se pide en un instante al
+ * azar, tarda un poco en armarse y espera en la cola si la línea está
+ * ocupada. El receptor lo lee con recibirFrame() y desempaquetar(), y su
+ * tarea de comandos (simulada) tarda lo que tardaría la ESP32 en tomarlo,
+ * ejecutarlo y escribir el OLED; lo anota con etapasRegistrar() con un
+ * micros() corrido (y que da la vuelta) respecto del reloj del emisor. Cada
+ * tanto el emisor pide los registros con etapasResponder() (el cuerpo de
+ * RPC_ETAPAS) y los empareja con latenciaProcesarRespuesta().
+ *
+ * Hay frames idénticos (el mismo texto o la misma frecuencia, la misma
+ * clave) y algunos llegan con un bit cambiado (el FCS los descarta y la
+ * ESP32 no los anota): emparejarlos por orden pegaría un registro al envío
+ * que se perdió. Se verifica que el promedio de cada etapa de cada comando
+ * sea exactamente el de los envíos reales de esos registros, y cuánto se
+ * aleja el total pegado en el fin de la línea del total real. Consultando
+ * de a muchos frames, la ESP32 pisa los más viejos. Un frame repetido antes
+ * del primer emparejamiento (sin desfase de referencia) queda como ambiguo,
+ * igual que uno que cae entre dos envíos con su clave que el desfase no
+ * separa (se verifica aparte, con registros armados a mano).
+ */
+
+#include "escenarios.h"
+#include "halHost.h"
+#include "recibe.h"
+#include "etapasReceptor.h"
+#include "latenciaEtapas.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <random>
+#include <vector>
+
+#define PIN_SIMULADO 0
+#define VELOCIDAD 250
+#define PAUSA_BITS 3                    // Entre frames del emisor
+#define MARGEN_NS 2000000000LL          // Línea quieta después del último frame
+#define NS_POR_MS 1000000LL
+#define INICIO_NS 1000000000LL          // Un flanco en t = 0 no se ve como bajada
+#define DESFASE_US 0xFFF00000u          // micros() de la ESP32: da la vuelta a los ~1 s
+#define PEDIDO_MEDIO_MS 800             // Entre pedidos (exponencial): a veces se encolan
+#define PREPARAR_MAX_MS 20
+#define DESPERTAR_MEDIO_US 300          // La tarea de comandos tarda en tomar el frame
+#define DECODIFICAR_US 40
+#define EJECUTAR_US 250
+#define DISPLAY_US 24000                // display.display() de 128x64 por I2C a 400 kHz
+
+typedef struct
+{
+    int cmd;
+    const char* texto;                  // NULL = uno distinto cada vez
+    bool display;
+} tipoMensaje;
+
+// CMD 3 y CMD 5 se repiten: frames idénticos, con la misma clave
+static const tipoMensaje TIPOS[] = {
+    {2, NULL, true},                    // Texto para el OLED
+    {3, "21.5", true},                  // Temperatura
+    {5, "50", false},                   // Frecuencia del LED
+    {1, "Prueba", true},                // Mensaje de prueba
+};
+static const int NUM_TIPOS = sizeof(TIPOS) / sizeof(TIPOS[0]);
+
+/**
+ * Lo que realmente pasó con un frame que la ESP32 anotó.
+ */
+typedef struct
+{
+    int cmd;
+    uint64_t ns[LAT_NUM_ETAPAS];        // Con el envío correcto
+    int64_t error_costura_ns;           // Total pegado en tx_fin - total real
+} verdadFrame;
+
+typedef struct
+{
+    lineaVirtual linea;
+    int64_t reloj_emisor;               // Línea libre desde acá
+    int64_t reloj_receptor;             // Hasta dónde leyó el receptor
+    int64_t comandos_libre_ns;          // La tarea de comandos termina lo anterior
+    etapasReceptor etapas;
+    std::vector<verdadFrame> verdad;    // Por número de registro
+    std::vector<bool> entregado;
+    std::mt19937 rng;
+    double perdida;
+    unsigned long danados;
+    unsigned long recibidos;
+
+    // Pendientes de leer por el receptor, en orden
+    std::vector<uint64_t> pedido_ns;
+    std::vector<uint64_t> encolado_ns;
+    std::vector<uint64_t> tx_inicio_ns;
+    std::vector<uint64_t> tx_fin_ns;
+    size_t leidos;
+} simulacion;
+
+static uint32_t microsReceptor(int64_t ns) {
+    return (uint32_t)(ns / 1000) + DESFASE_US;
+}
+
+/**
+ * Lee lo que el emisor ya escribió, como la tarea de recepción y la de
+ * comandos de la ESP32.
+ */
+static void avanzarReceptor(simulacion& s) {
+    halUsarLinea(&s.linea);
+    std::exponential_distribution<double> despertar(1.0 / DESPERTAR_MEDIO_US);
+    try {
+        for (;;) {
+            s.linea.ahora_ns = s.reloj_receptor;
+            while (digitalRead(RX_PIN) == HIGH);
+            int64_t inicio_ns = s.linea.ahora_ns;
+            frameReceptor rx;
+            bool sincronizado = recibirFrame(RX_PIN, VELOCIDAD, rx);
+            s.reloj_receptor = s.linea.ahora_ns;
+            size_t envio = s.leidos++;
+            if (!sincronizado || !desempaquetar(rx)) continue;
+            s.recibidos++;
+            rx.t_inicio_us = microsReceptor(inicio_ns);
+            rx.t_fin_us = microsReceptor(s.reloj_receptor);
+
+            const tipoMensaje* tipo = NULL;
+            for (int i = 0; i < NUM_TIPOS; i++) {
+                if (TIPOS[i].cmd == rx.cmd) tipo = &TIPOS[i];
+            }
+            int64_t decodificar_ns = std::max<int64_t>(s.reloj_receptor + (int64_t)(despertar(s.rng) * 1000),
+                                                       s.comandos_libre_ns);
+            int64_t ejecutar_ns = decodificar_ns + DECODIFICAR_US * 1000;
+            uint32_t display_us = (tipo != NULL && tipo->display) ? DISPLAY_US + s.rng() % 2000 : 0;
+            int64_t terminado_ns = ejecutar_ns + (EJECUTAR_US + display_us) * 1000LL;
+            s.comandos_libre_ns = terminado_ns;
+
+            uint16_t numero = s.etapas.proximo;
+            s.etapas.display_us = display_us;
+            etapasRegistrar(s.etapas, etapasClave(rx.cmd, payload(rx), rx.fcs), rx.cmd, rx.cmd, rx,
+                            microsReceptor(decodificar_ns), microsReceptor(ejecutar_ns),
+                            microsReceptor(terminado_ns));
+
+            const registroEtapas& r = s.etapas.registros[numero % ETAPAS_REGISTROS];
+            verdadFrame v;
+            v.cmd = rx.cmd;
+            v.ns[LAT_PREPARAR] = s.encolado_ns[envio] - s.pedido_ns[envio];
+            v.ns[LAT_COLA] = s.tx_inicio_ns[envio] - s.encolado_ns[envio];
+            v.ns[LAT_LINEA] = s.tx_fin_ns[envio] - s.tx_inicio_ns[envio];
+            v.ns[LAT_PIPELINE] = (uint64_t)r.pipeline_us * 1000;
+            v.ns[LAT_DECODIFICAR] = (uint64_t)r.decodificar_us * 1000;
+            v.ns[LAT_EJECUTAR] = (uint64_t)r.ejecutar_us * 1000;
+            v.ns[LAT_DISPLAY] = (uint64_t)r.display_us * 1000;
+            v.ns[LAT_TOTAL] = 0;
+            for (int i = 0; i < LAT_TOTAL; i++) v.ns[LAT_TOTAL] += v.ns[i];
+            v.error_costura_ns = (int64_t)v.ns[LAT_TOTAL] - (terminado_ns - (int64_t)s.pedido_ns[envio]);
+            s.verdad.push_back(v);
+            s.entregado.push_back(false);
+        }
+    } catch (const finDeLinea&) {
+        // Se leyó todo lo escrito hasta ahora
+    }
+    halUsarLinea(NULL);
+}
+
+/**
+ * El menú pide un mensaje: se arma, espera la línea y sale.
+ */
+static void enviarMensaje(simulacion& s, medicionLatencia& m, int64_t pedido_ns, int numero) {
+    const tipoMensaje& tipo = TIPOS[s.rng() % NUM_TIPOS];
+    protocolo proto;
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = (BYTE)tipo.cmd;
+    if (tipo.texto != NULL) {
+        proto.lng = (BYTE)snprintf((char*)proto.data, LARGO_DATA, "%s", tipo.texto);
+    } else {
+        proto.lng = (BYTE)snprintf((char*)proto.data, LARGO_DATA, "Mensaje %d", numero);
+    }
+    int largo = empaquetar(proto);
+
+    proto.t_pedido_ns = (uint64_t)pedido_ns;
+    proto.t_encolado_ns = (uint64_t)(pedido_ns + (int64_t)(s.rng() % (PREPARAR_MAX_MS * NS_POR_MS)));
+    int64_t inicio_ns = std::max<int64_t>(s.reloj_emisor, (int64_t)proto.t_encolado_ns);
+
+    // El primero sale siempre bien: da la primera referencia entre los relojes
+    protocolo enviado = proto;
+    if (numero > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(s.rng) < s.perdida) {
+        enviado.frame[FrameEstandar::BYTES_CABECERA + s.rng() % enviado.lng] ^= (BYTE)(1 << (s.rng() % 8));
+        s.danados++;
+    }
+    halUsarLinea(&s.linea);
+    s.linea.ahora_ns = inicio_ns;
+    enviarFrame(PIN_SIMULADO, VELOCIDAD, enviado, largo);
+    int64_t fin_ns = s.linea.ahora_ns;
+    delay(PAUSA_BITS * 1000 / VELOCIDAD);
+    s.reloj_emisor = s.linea.ahora_ns;
+    s.linea.fin_ns = s.reloj_emisor + MARGEN_NS;
+    halUsarLinea(NULL);
+
+    latenciaRegistrarEnvio(m, proto, (uint64_t)inicio_ns, (uint64_t)fin_ns);
+    s.pedido_ns.push_back(proto.t_pedido_ns);
+    s.encolado_ns.push_back(proto.t_encolado_ns);
+    s.tx_inicio_ns.push_back((uint64_t)inicio_ns);
+    s.tx_fin_ns.push_back((uint64_t)fin_ns);
+}
+
+/**
+ * La opción 16: pide registros hasta que la respuesta no viene llena.
+ */
+static void consultar(simulacion& s, medicionLatencia& m) {
+    for (;;) {
+        BYTE args[2] = {(BYTE)(m.desde >> 8), (BYTE)m.desde};
+        BYTE datos[LARGO_DATA];
+        int lng = etapasResponder(s.etapas, args, sizeof(args), datos);
+        int cantidad = datos[0];
+        uint16_t primero = (uint16_t)((datos[1] << 8) | datos[2]);
+        for (int i = 0; i < cantidad; i++) {
+            s.entregado[(uint16_t)(primero + i)] = true;
+        }
+        if (latenciaProcesarRespuesta(m, datos, lng) < ETAPAS_POR_RESPUESTA) break;
+    }
+}
+
+typedef struct
+{
+    unsigned long entregados;
+    double error_promedio_ms;           // La peor diferencia de promedios entre etapa y verdad
+    double costura_max_ms;
+    bool cuentas_ok;
+} resultadoEtapas;
+
+/**
+ * Compara el promedio de cada etapa de cada comando con el de los envíos reales.
+ */
+static void comparar(const simulacion& s, const medicionLatencia& m, resultadoEtapas& res) {
+    res.entregados = 0;
+    res.error_promedio_ms = 0;
+    res.costura_max_ms = 0;
+    res.cuentas_ok = true;
+    // Los ambiguos son los primeros entregados: todavía no había referencia
+    std::vector<bool> contado(s.entregado);
+    unsigned long ambiguos = 0;
+    for (size_t i = 0; i < contado.size() && ambiguos < m.ambiguos; i++) {
+        if (contado[i]) {
+            contado[i] = false;
+            ambiguos++;
+        }
+    }
+    for (int t = 0; t < NUM_TIPOS; t++) {
+        int cmd = TIPOS[t].cmd;
+        double suma[LAT_NUM_ETAPAS] = {0};
+        uint64_t n = 0;
+        for (size_t i = 0; i < s.verdad.size(); i++) {
+            if (!contado[i] || s.verdad[i].cmd != cmd) continue;
+            n++;
+            for (int e = 0; e < LAT_NUM_ETAPAS; e++) suma[e] += (double)s.verdad[i].ns[e];
+            res.costura_max_ms = std::max(res.costura_max_ms, fabs((double)s.verdad[i].error_costura_ns) / 1e6);
+        }
+        res.entregados += n;
+        for (int e = 0; e < LAT_NUM_ETAPAS; e++) {
+            const histogramaNs* h = latenciaEtapa(m, cmd, e);
+            resumenHistograma r;
+            if (h != NULL) histogramaResumir(*h, r);
+            uint64_t total = (h != NULL) ? r.total : 0;
+            if (total != n) {
+                res.cuentas_ok = false;
+                continue;
+            }
+            if (n == 0) continue;
+            double error = fabs(r.promedio_ns - suma[e] / n) / 1e6;
+            res.error_promedio_ms = std::max(res.error_promedio_ms, error);
+        }
+    }
+}
+
+/**
+ * Una corrida: 'mensajes' pedidos, consultando cada 'cada' mensajes.
+ */
+static void correr(simulacion& s, medicionLatencia& m, int mensajes, int cada, double perdida, unsigned semilla) {
+    s.linea = lineaVirtual();
+    s.reloj_emisor = INICIO_NS;
+    s.reloj_receptor = 0;
+    s.comandos_libre_ns = 0;
+    etapasIniciar(s.etapas);
+    s.verdad.clear();
+    s.entregado.clear();
+    s.pedido_ns.clear();
+    s.encolado_ns.clear();
+    s.tx_inicio_ns.clear();
+    s.tx_fin_ns.clear();
+    s.leidos = 0;
+    s.rng.seed(semilla);
+    s.perdida = perdida;
+    s.danados = s.recibidos = 0;
+    latenciaIniciar(m);
+
+    std::exponential_distribution<double> entre_pedidos(1.0 / PEDIDO_MEDIO_MS);
+    int64_t pedido_ns = INICIO_NS;
+    for (int i = 0; i < mensajes; i++) {
+        enviarMensaje(s, m, pedido_ns, i);
+        pedido_ns += (int64_t)(entre_pedidos(s.rng) * NS_POR_MS);
+        if ((i + 1) % cada == 0 || i == mensajes - 1) {
+            avanzarReceptor(s);
+            consultar(s, m);
+        }
+    }
+}
+
+/**
+ * Un registro de la ESP32 con la clave 'clave' que terminó 'fin_us' (en el
+ * reloj del emisor) después de INICIO_NS.
+ */
+static registroEtapas registroArmado(uint16_t clave, uint32_t fin_us) {
+    registroEtapas r;
+    memset(&r, 0, sizeof(r));
+    r.clave = clave;
+    r.cmd_linea = r.cmd = 2;
+    r.fin_us = microsReceptor(INICIO_NS + (int64_t)fin_us * 1000);
+    return r;
+}
+
+static void envioArmado(medicionLatencia& m, uint16_t clave, uint32_t fin_us) {
+    protocolo proto;
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = 2;
+    proto.fcs = clave;
+    uint64_t fin_ns = (uint64_t)(INICIO_NS + (int64_t)fin_us * 1000);
+    latenciaRegistrarEnvio(m, proto, fin_ns - 100 * 1000, fin_ns);
+}
+
+/**
+ * Dos envíos distintos con el mismo FCS: el registro que cae en el medio
+ * (el desfase no dice cuál es) se cuenta como ambiguo; el que cae sobre
+ * uno de ellos se empareja con ese.
+ */
+static bool verificarAmbiguos(medicionLatencia& m) {
+    latenciaIniciar(m);
+    envioArmado(m, 0x10, 0);
+    bool referencia = latenciaEmparejar(m, registroArmado(0x10, 0));
+    envioArmado(m, 0x20, 100000);
+    envioArmado(m, 0x20, 300000);
+    bool en_el_medio = latenciaEmparejar(m, registroArmado(0x20, 200000));
+    unsigned long ambiguos = m.ambiguos;
+    bool sobre_el_segundo = latenciaEmparejar(m, registroArmado(0x20, 300000 + 3000));
+    printf("  Misma clave a 100 y 300 ms: registro a 200 ms %s, a 303 ms %s\n",
+           en_el_medio ? "emparejado" : "ambiguo", sobre_el_segundo ? "emparejado" : "sin emparejar");
+    return referencia && !en_el_medio && ambiguos == 1 && sobre_el_segundo && m.ambiguos == 1;
+}
+
+int escenarioEtapas(int argc, char** argv) {
+    int mensajes = (argc > 0) ? atoi(argv[0]) : 300;
+    double perdida_pct = (argc > 1) ? atof(argv[1]) : 10.0;
+    unsigned semilla = (argc > 2) ? (unsigned)atoi(argv[2]) : 1;
+    if (mensajes <= 0 || mensajes > 20000 || perdida_pct < 0 || perdida_pct >= 100) {
+        printf("Uso: ./simulador etapas [mensajes] [%% de frames dañados] [semilla]\n");
+        return 1;
+    }
+
+    simulacion* sim = new simulacion();
+    medicionLatencia* m = new medicionLatencia();
+    g_hal_serial_silencio = true;
+    printf("%d mensajes a %d bps (CMD 1, 2, 3 y 5; el 3 y el 5 siempre iguales), %.0f%% dañados\n",
+           mensajes, VELOCIDAD, perdida_pct);
+    printf("Reloj de la ESP32 corrido %u us respecto del emisor (micros() da la vuelta)\n\n", DESFASE_US);
+
+    // Consultando seguido, todos los registros llegan; cada 48 frames la
+    // ESP32 ya pisó los más viejos (guarda ETAPAS_REGISTROS)
+    const int CADA[] = {8, 48};
+    bool correcto = true;
+    printf("  %-18s %7s %8s %9s %7s %8s %9s %8s %12s %9s\n", "consulta", "envíos", "dañados", "anotados",
+           "empar.", "pisados", "ambiguos", "sin env.", "error prom.", "costura");
+    for (int c = 0; c < 2; c++) {
+        correr(*sim, *m, mensajes, CADA[c], perdida_pct / 100.0, semilla);
+        resultadoEtapas r;
+        comparar(*sim, *m, r);
+        char nombre[32];
+        snprintf(nombre, sizeof(nombre), "cada %d mensajes", CADA[c]);
+        printf("  %-18s %7lu %7lu %9lu %7lu %8lu %9lu %8lu %9.4f ms %6.1f ms\n", nombre, m->num_envios, sim->danados,
+               sim->recibidos, m->emparejados, m->perdidos, m->ambiguos, m->sin_envio, r.error_promedio_ms,
+               r.costura_max_ms);
+
+        // Cada registro entregado se empareja con SU envío: los promedios
+        // coinciden (salvo redondeo) y lo pisado es lo que no se entregó.
+        // La ESP32 termina de leer el frame hasta 1,5 bits después del emisor.
+        double bit_ms = 1000.0 / VELOCIDAD;
+        if (!r.cuentas_ok || r.error_promedio_ms > 1e-6 || m->sin_envio != 0 ||
+            m->emparejados != r.entregados || m->emparejados + m->perdidos + m->ambiguos != sim->recibidos ||
+            r.costura_max_ms > 2 * bit_ms || (c == 0 && m->perdidos != 0)) {
+            correcto = false;
+        }
+        if (c == 0) {
+            printf("\n");
+            latenciaImprimir(*m);
+            printf("\n");
+        }
+    }
+    g_hal_serial_silencio = false;
+    printf("\n");
+    bool ambiguos_ok = verificarAmbiguos(*m);
+
+    printf("\n  Cada registro con su envío (promedios exactos por etapa): %s\n", correcto ? "sí" : "NO");
+    printf("  Misma clave que el desfase no separa, contada como ambigua: %s\n", ambiguos_ok ? "sí" : "NO");
+    printf("  La costura en el fin de la línea se aleja del total real menos de dos bits (%.0f ms)\n",
+           2000.0 / VELOCIDAD);
+    delete m;
+    delete sim;
+    return (correcto && ambiguos_ok) ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file escenarioFlancos.cpp
+ * @brief Instrumentación de flancos (histogramaFlancos.cpp): costo y publicación.
+ * @details Se verifica:
+ * - El costo de registrar un flanco (lectura del reloj + dos histogramas)
+ *   contra el presupuesto de PRESUPUESTO_NS: enviarFrame() lo paga en cada
+ *   flanco, dentro del tiempo de bit.
+ * - El resumen del último frame mientras otro hilo lo lee sin parar, como
+ *   hace el menú (opción 12) durante una transmisión: cada lectura tiene
+ *   que ser de un solo frame, nunca una mezcla de dos.
+ */
+
+#include "escenarios.h"
+#include "histogramaFlancos.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <atomic>
+#include <thread>
+
+#define FLANCOS_MEDIDOS 2000000
+#define RONDAS_COSTO 5
+#define PRESUPUESTO_NS 100.0
+
+#define FRAMES_PUBLICADOS 20000
+#define FLANCOS_POR_BIT 4 // Frame con 'b' bits de desvío: b * FLANCOS_POR_BIT flancos
+#define BITS_DISTINTOS 7
+
+static uint64_t ahoraNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Costo de un flanco: la misma vuelta con y sin flancosRegistrar(), con un
+ * flancosInicioByte() cada 11 como en un byte con 2 bits de parada.
+ * Se queda con la mejor ronda para no contar las interrupciones del host.
+ */
+static double medirCosto() {
+    double mejor = 1e9;
+    for (int ronda = 0; ronda < RONDAS_COSTO; ronda++) {
+        volatile uint32_t suma = 0;
+        flancosInicioFrame(9600, 2);
+        uint64_t t0 = ahoraNs();
+        for (int i = 0; i < FLANCOS_MEDIDOS; i++) {
+            suma = suma + i;
+        }
+        uint64_t t1 = ahoraNs();
+        for (int i = 0; i < FLANCOS_MEDIDOS; i++) {
+            int bit = i % 11;
+            if (bit == 0) flancosInicioByte();
+            else flancosRegistrar(bit);
+            suma = suma + i;
+        }
+        uint64_t t2 = ahoraNs();
+        flancosFinFrame();
+        double costo = ((double)(t2 - t1) - (double)(t1 - t0)) / FLANCOS_MEDIDOS;
+        if (costo < mejor) mejor = costo;
+    }
+    return mejor;
+}
+
+/**
+ * Un frame a 1 bps con todos los flancos 'bits' tiempos de bit después del
+ * inicio: el desvío de cada uno es ~bits segundos, así que el resumen dice
+ * de qué frame salió (total y percentiles tienen que coincidir).
+ */
+static void enviarFrameMarcado(int bits) {
+    flancosInicioFrame(1, 2);
+    flancosInicioByte();
+    for (int i = 0; i < bits * FLANCOS_POR_BIT; i++) {
+        flancosRegistrar(bits);
+    }
+    flancosFinFrame();
+}
+
+static bool resumenDeUnFrame(const resumenHistograma& r) {
+    int bits = (int)((r.maximo_ns + 500000000ULL) / 1000000000ULL);
+    int bits_p50 = (int)((r.p50_ns + 500000000ULL) / 1000000000ULL);
+    return bits >= 1 && bits <= BITS_DISTINTOS && bits_p50 == bits &&
+           r.total == (uint64_t)(bits * FLANCOS_POR_BIT);
+}
+
+/**
+ * El hilo que transmite publica frames de tamaños distintos mientras este
+ * hilo lee el último sin parar.
+ */
+static bool verificarPublicacion() {
+    std::atomic<bool> terminado(false);
+    unsigned long lecturas = 0, mezcladas = 0;
+
+    enviarFrameMarcado(1); // Pisa el frame que dejó medirCosto()
+    std::thread transmisor([&terminado] {
+        for (int f = 0; f < FRAMES_PUBLICADOS; f++) {
+            enviarFrameMarcado(1 + f % BITS_DISTINTOS);
+        }
+        terminado.store(true);
+    });
+    while (!terminado.load()) {
+        resumenHistograma r;
+        flancosUltimoFrame(r);
+        lecturas++;
+        if (!resumenDeUnFrame(r)) mezcladas++;
+    }
+    transmisor.join();
+
+    printf("  %d frames publicados, %lu lecturas concurrentes, %lu mezcladas\n", FRAMES_PUBLICADOS,
+           lecturas, mezcladas);
+    return mezcladas == 0 && lecturas > 0;
+}
+
+int escenarioFlancos(int argc, char** argv) {
+    printf("Instrumentación de flancos de enviarFrame()\n");
+    double costo = medirCosto();
+    bool ok_costo = costo < PRESUPUESTO_NS;
+    printf("  Costo por flanco: %.1f ns (presupuesto %.0f ns, mejor de %d rondas de %d)\n", costo,
+           PRESUPUESTO_NS, RONDAS_COSTO, FLANCOS_MEDIDOS);
+
+    bool ok_publicacion = verificarPublicacion();
+
+    // El escenario ensucia el acumulado con desvíos de segundos
+    histogramaReiniciar(g_flancos_acumulado);
+
+    printf("\n  Flanco dentro del presupuesto: %s\n", ok_costo ? "sí" : "NO");
+    printf("  Último frame siempre de un solo frame: %s\n", ok_publicacion ? "sí" : "NO");
+    return (ok_costo && ok_publicacion) ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file escenarioGpiomem.cpp
+ * @brief Salida por registros GPIO mapeados (gpioMapeado.cpp) sobre un archivo común.
+ * @details En lugar de /dev/gpiomem se mapea un archivo temporal de
+ * GPIO_BLOQUE_BYTES bytes: el código es el mismo que en la Raspberry, solo
+ * que GPSET0/GPCLR0 guardan la última máscara. Se verifica:
+ * - gpioModoSalida(): los 3 bits de cada pin en GPFSELn, sin tocar los vecinos.
+ * - gpioEscribir(): una máscara de varios pines queda en un solo store.
+ * - El costo de una escritura (varios pines juntos vs un store por pin).
+ * - enviarFrameGpio() con el reloj real: una escritura por cambio de nivel
+ *   y el desvío de cada flanco respecto de su instante ideal.
+ */
+
+#include "escenarios.h"
+#include "gpioMapeado.h"
+#include "histogramaFlancos.h"
+#include "funcionesProtocolo.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#define ESCRITURAS_MEDIDAS 10000000
+
+static const int PINES[] = {17, 22, 23, 24, 5, 6, 12, 16};
+#define NUM_PINES (int)(sizeof(PINES) / sizeof(PINES[0]))
+
+static uint64_t ahoraNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Crea el archivo que hace de bloque de registros. Retorna false si no se pudo.
+ */
+static bool crearBloque(char* ruta, bool completo) {
+    int fd = mkstemp(ruta);
+    if (fd < 0) return false;
+    bool ok = ftruncate(fd, completo ? GPIO_BLOQUE_BYTES : GPIO_BLOQUE_BYTES / 2) == 0;
+    close(fd);
+    return ok;
+}
+
+static bool verificarModos(bloqueGpio& g) {
+    // Otro pin del mismo registro en una función alternativa: no se tiene que tocar
+    g.registros[GPIO_GPFSEL0 + 1] = 4u << ((15 % 10) * 3); // GPIO15 en ALT0 (UART)
+    for (int i = 0; i < NUM_PINES; i++) gpioModoSalida(g, PINES[i]);
+
+    bool ok = true;
+    for (int i = 0; i < NUM_PINES; i++) {
+        int pin = PINES[i];
+        uint32_t funcion = (g.registros[GPIO_GPFSEL0 + pin / 10] >> ((pin % 10) * 3)) & 7;
+        if (funcion != GPIO_FUNCION_SALIDA) ok = false;
+    }
+    uint32_t gpio15 = (g.registros[GPIO_GPFSEL0 + 1] >> ((15 % 10) * 3)) & 7;
+    printf("  GPFSEL: %d pines como salida, GPIO15 sigue en ALT0: %s\n", NUM_PINES,
+           (ok && gpio15 == 4) ? "sí" : "NO");
+    return ok && gpio15 == 4;
+}
+
+static bool verificarMascaras(bloqueGpio& g) {
+    uint32_t mascara = 0;
+    for (int i = 0; i < NUM_PINES; i++) mascara |= 1u << PINES[i];
+    uint32_t poner = mascara & 0x00FF00FF;
+    uint32_t borrar = mascara & ~poner;
+
+    g.registros[GPIO_GPSET0] = 0;
+    g.registros[GPIO_GPCLR0] = 0;
+    gpioEscribir(g, poner, borrar);
+    bool ok = g.registros[GPIO_GPSET0] == poner && g.registros[GPIO_GPCLR0] == borrar;
+    printf("  GPSET0 = 0x%08x, GPCLR0 = 0x%08x en un store cada uno: %s\n", g.registros[GPIO_GPSET0],
+           g.registros[GPIO_GPCLR0], ok ? "sí" : "NO");
+    return ok;
+}
+
+static void medirCosto(bloqueGpio& g) {
+    uint32_t mascara = 0;
+    for (int i = 0; i < NUM_PINES; i++) mascara |= 1u << PINES[i];
+
+    uint64_t t0 = ahoraNs();
+    for (int i = 0; i < ESCRITURAS_MEDIDAS; i++) {
+        if (i & 1) gpioEscribir(g, mascara, 0);
+        else gpioEscribir(g, 0, mascara);
+    }
+    uint64_t t1 = ahoraNs();
+    for (int i = 0; i < ESCRITURAS_MEDIDAS; i++) {
+        for (int p = 0; p < NUM_PINES; p++) {
+            uint32_t bit = 1u << PINES[p];
+            if (i & 1) gpioEscribir(g, bit, 0);
+            else gpioEscribir(g, 0, bit);
+        }
+    }
+    uint64_t t2 = ahoraNs();
+    printf("  Cambiar %d pines: %.1f ns con una máscara, %.1f ns con un store por pin\n", NUM_PINES,
+           (double)(t1 - t0) / ESCRITURAS_MEDIDAS, (double)(t2 - t1) / ESCRITURAS_MEDIDAS);
+    printf("  (en la Raspberry se suma el acceso al periférico; digitalWrite() de wiringPi\n"
+           "   pasa además por su tabla de pines y un store por pin)\n");
+}
+
+/**
+ * Transmite con el reloj real y compara con los cambios de nivel del frame.
+ */
+static bool verificarFrame(bloqueGpio& g, int speed, int frames) {
+    protocolo proto;
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = 1;
+    proto.lng = 10;
+    memcpy(proto.data, "gpiomem OK", 10);
+    int largo = empaquetar(proto);
+
+    BYTE niveles[BITS_FRAME(FrameEstandar::LARGO_MAX, 4)];
+    int n = nivelesFrame(proto, largo, niveles);
+    int cambios = 0;
+    BYTE anterior = 1;
+    for (int i = 0; i < n; i++) {
+        if (niveles[i] != anterior) cambios++;
+        anterior = niveles[i];
+    }
+
+    g_flancos_activos = true;
+    histogramaReiniciar(g_flancos_acumulado);
+    int pin = PINES[0];
+    bool ok = true;
+    uint64_t t0 = ahoraNs();
+    for (int f = 0; f < frames; f++) {
+        int escrituras = enviarFrameGpio(g, pin, speed, proto, largo);
+        if (escrituras != cambios) ok = false;
+    }
+    double ms_por_frame = (ahoraNs() - t0) / 1e6 / frames;
+    ok = ok && g.registros[GPIO_GPSET0] == (1u << pin); // Termina en reposo (HIGH)
+
+    printf("  %d frames de %d bits a %d bps: %d escrituras por frame (%d cambios de nivel), "
+           "%.1f ms por frame (ideal %.1f)\n",
+           frames, n, speed, cambios, cambios, ms_por_frame, (n - 1) * 1000.0 / speed);
+    resumenHistograma r;
+    histogramaResumir(g_flancos_acumulado, r);
+    flancosImprimir("  Desvío de los flancos", r, speed);
+    return ok;
+}
+
+int escenarioGpiomem(int argc, char** argv) {
+    int speed = (argc > 0) ? atoi(argv[0]) : 250;
+    int frames = (argc > 1) ? atoi(argv[1]) : 5;
+    if (speed <= 0 || frames <= 0) {
+        printf("Uso: ./simulador gpiomem [bps] [frames]\n");
+        return 1;
+    }
+
+    char ruta_corta[] = "/tmp/gpiomem_corto_XXXXXX";
+    char ruta[] = "/tmp/gpiomem_XXXXXX";
+    if (!crearBloque(ruta_corta, false) || !crearBloque(ruta, true)) {
+        printf("No se pudieron crear los archivos de prueba en /tmp.\n");
+        return 1;
+    }
+
+    printf("Registros GPIO mapeados desde un archivo común (%d bytes)\n", GPIO_BLOQUE_BYTES);
+    bloqueGpio g = {NULL, -1};
+    bool rechaza_corto = !gpioAbrir(g, ruta_corta);
+    printf("  Un archivo más chico que el bloque se rechaza: %s\n", rechaza_corto ? "sí" : "NO");
+    unlink(ruta_corta);
+
+    if (!gpioAbrir(g, ruta)) {
+        unlink(ruta);
+        return 1;
+    }
+    bool ok = rechaza_corto;
+    ok = verificarModos(g) && ok;
+    ok = verificarMascaras(g) && ok;
+    medirCosto(g);
+    ok = verificarFrame(g, speed, frames) && ok;
+
+    gpioCerrar(g);
+    unlink(ruta);
+    printf("\n  Todo como en los registros reales: %s\n", ok ? "sí" : "NO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,319 @@
+/**
+ * @file escenarioIngesta.cpp
+ * @brief Prueba de carga de la ingesta por socket Unix (ingestaSocket.cpp).
+ * @details Tres partes, con el reloj y los sockets reales:
+ * - La cola sin locks sola: varios hilos publican a la vez y el consumidor
+ *   verifica que no falte, sobre ni se desordene nada de cada productor.
+ * - Muchos clientes locales a la vez, cada uno con su conexión, mandan
+ *   lotes y esperan el acuse: latencia de cada lote (envío -> acuse),
+ *   mensajes aceptados por segundo y acuses ING_LLENO.
+ * - Reparto con un empaquetador lento: un cliente manda lotes grandes sin
+ *   pausa y otros lotes chicos; se mide qué parte de lo entregado le tocó
+ *   a cada uno.
+ */
+
+#include "escenarios.h"
+#include "ingestaSocket.h"
+#include "histogramaFlancos.h"
+#include "funcionesProtocolo.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define MPSC_PRODUCTORES 8
+#define MPSC_MENSAJES 200000     // Por productor
+#define REGISTROS_LOTE 16
+#define LNG_REGISTRO 20
+#define REINTENTO_US 200         // Pausa del cliente tras un ING_LLENO
+#define REPARTO_CLIENTES 8
+#define REPARTO_MS 2000
+#define REPARTO_COSTO_US 50      // Del empaquetador lento, por mensaje
+#define REPARTO_LOTE_VORAZ 40
+#define REPARTO_LOTE 4
+
+static uint64_t ahoraNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// --- Cola sola ---
+
+static colaIngesta s_cola_prueba;
+
+static bool probarCola() {
+    colaIngestaIniciar(s_cola_prueba);
+    std::atomic<bool> largar(false);
+    std::vector<std::thread> productores;
+    std::atomic<unsigned long> llena(0);
+    for (int p = 0; p < MPSC_PRODUCTORES; p++) {
+        productores.push_back(std::thread([p, &largar, &llena]() {
+            while (!largar.load()) std::this_thread::yield();
+            mensajeIngesta m;
+            m.cmd = 1;
+            m.lng = 4;
+            m.cliente = p;
+            for (uint32_t i = 0; i < MPSC_MENSAJES; i++) {
+                memcpy(m.data, &i, 4);
+                while (!colaIngestaPublicar(s_cola_prueba, m)) {
+                    llena++;
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+
+    uint32_t proximo[MPSC_PRODUCTORES] = {0};
+    unsigned long recibidos = 0, desordenados = 0;
+    uint64_t t0 = ahoraNs();
+    largar.store(true);
+    while (recibidos < (unsigned long)MPSC_PRODUCTORES * MPSC_MENSAJES) {
+        mensajeIngesta m;
+        if (!colaIngestaTomar(s_cola_prueba, m)) {
+            std::this_thread::yield(); // Con pocos cores, los productores necesitan el CPU
+            continue;
+        }
+        uint32_t i;
+        memcpy(&i, m.data, 4);
+        if (i != proximo[m.cliente]) desordenados++;
+        proximo[m.cliente] = i + 1;
+        recibidos++;
+    }
+    double segundos = (ahoraNs() - t0) / 1e9;
+    for (size_t p = 0; p < productores.size(); p++) productores[p].join();
+    mensajeIngesta sobra;
+    bool ok = desordenados == 0 && !colaIngestaTomar(s_cola_prueba, sobra);
+
+    printf("Cola sin locks: %d productores x %d mensajes, un consumidor\n", MPSC_PRODUCTORES, MPSC_MENSAJES);
+    printf("  %.2f M mensajes/s | cola llena al publicar: %lu veces | fuera de orden: %lu | "
+           "completo: %s\n\n", recibidos / segundos / 1e6, llena.load(), desordenados, ok ? "sí" : "NO");
+    return ok;
+}
+
+// --- Clientes ---
+
+static std::atomic<uint64_t> s_costo_ns(0);
+static std::atomic<unsigned long> s_entregados_cliente[ING_MAX_CLIENTES];
+
+static void entregarPrueba(protocolo& proto, int largo) {
+    // El primer byte de cada mensaje dice de qué cliente de la prueba es
+    s_entregados_cliente[proto.data[0] % ING_MAX_CLIENTES]++;
+    uint64_t costo = s_costo_ns.load();
+    if (costo > 0) {
+        uint64_t fin = ahoraNs() + costo;
+        while (ahoraNs() < fin);
+    }
+}
+
+static int conectar(const char* ruta) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un dir;
+    memset(&dir, 0, sizeof(dir));
+    dir.sun_family = AF_UNIX;
+    strcpy(dir.sun_path, ruta);
+    for (int intento = 0; intento < 100; intento++) {
+        if (connect(fd, (struct sockaddr*)&dir, sizeof(dir)) == 0) return fd;
+        usleep(1000);
+    }
+    close(fd);
+    return -1;
+}
+
+static bool leerTodo(int fd, BYTE* p, int n) {
+    while (n > 0) {
+        ssize_t r = read(fd, p, n);
+        if (r <= 0) return false;
+        p += r;
+        n -= (int)r;
+    }
+    return true;
+}
+
+/**
+ * Un lote de 'registros' mensajes CMD 2 de 'id'. Retorna su largo total.
+ */
+static int armarLote(BYTE* lote, int id, int registros) {
+    int largo = registros * (2 + LNG_REGISTRO);
+    lote[0] = largo & 0xFF;
+    lote[1] = largo >> 8;
+    BYTE* p = lote + 2;
+    for (int r = 0; r < registros; r++) {
+        p[0] = 2;
+        p[1] = LNG_REGISTRO;
+        memset(p + 2, 'a' + r % 26, LNG_REGISTRO);
+        p[2] = (BYTE)id;
+        p += 2 + LNG_REGISTRO;
+    }
+    return 2 + largo;
+}
+
+typedef struct
+{
+    unsigned long aceptados;
+    unsigned long llenos;
+    bool error;
+} resultadoCliente;
+
+/**
+ * Manda 'lotes' lotes (o hasta 'fin_ns') reenviando lo rechazado.
+ */
+static void cliente(const char* ruta, int id, int lotes, int registros, uint64_t fin_ns, bool pausa,
+                    histogramaNs* latencia, resultadoCliente* res) {
+    res->aceptados = res->llenos = 0;
+    res->error = false;
+    int fd = conectar(ruta);
+    if (fd < 0) {
+        res->error = true;
+        return;
+    }
+    BYTE lote[2 + ING_LOTE_MAX];
+    for (int l = 0; (lotes == 0 || l < lotes) && (fin_ns == 0 || ahoraNs() < fin_ns); l++) {
+        int faltan = registros;
+        while (faltan > 0) {
+            int largo = armarLote(lote, id, faltan);
+            BYTE acuse[ING_BYTES_ACUSE];
+            uint64_t t0 = ahoraNs();
+            if (send(fd, lote, largo, MSG_NOSIGNAL) != largo || !leerTodo(fd, acuse, ING_BYTES_ACUSE)) {
+                res->error = true;
+                close(fd);
+                return;
+            }
+            if (latencia != NULL) histogramaRegistrar(*latencia, ahoraNs() - t0);
+            int aceptados = acuse[1] | (acuse[2] << 8);
+            res->aceptados += aceptados;
+            faltan -= aceptados;
+            if (acuse[0] == ING_INVALIDO) {
+                res->error = true;
+                break;
+            }
+            if (acuse[0] == ING_LLENO) {
+                res->llenos++;
+                if (fin_ns != 0 && ahoraNs() >= fin_ns) break;
+                if (pausa) usleep(REINTENTO_US);
+            }
+        }
+    }
+    close(fd);
+}
+
+static void esperarEntregados(unsigned long total) {
+    while (g_ingesta.entregados.load() < total) usleep(1000);
+}
+
+static bool cargaClientes(const char* ruta, int clientes, int lotes) {
+    histogramaNs latencia;
+    histogramaReiniciar(latencia);
+    std::vector<resultadoCliente> res(clientes);
+    std::vector<std::thread> hilos;
+    unsigned long entregados_antes = g_ingesta.entregados.load();
+    unsigned long llenos_antes = g_ingesta.rechazados.load();
+
+    uint64_t t0 = ahoraNs();
+    for (int c = 0; c < clientes; c++) {
+        hilos.push_back(std::thread(cliente, ruta, c, lotes, REGISTROS_LOTE, (uint64_t)0, true, &latencia,
+                                    &res[c]));
+    }
+    unsigned long aceptados = 0, llenos = 0;
+    bool ok = true;
+    for (int c = 0; c < clientes; c++) {
+        hilos[c].join();
+        aceptados += res[c].aceptados;
+        llenos += res[c].llenos;
+        if (res[c].error) ok = false;
+    }
+    esperarEntregados(entregados_antes + aceptados);
+    double segundos = (ahoraNs() - t0) / 1e9;
+    ok = ok && aceptados == (unsigned long)clientes * lotes * REGISTROS_LOTE;
+
+    resumenHistograma r;
+    histogramaResumir(latencia, r);
+    printf("  %8d %10lu %12.0f %9.1f %9.1f %9.1f %8lu %9lu  %s\n", clientes, aceptados, aceptados / segundos,
+           r.p50_ns / 1000.0, r.p99_ns / 1000.0, r.maximo_ns / 1000.0, llenos,
+           g_ingesta.rechazados.load() - llenos_antes, ok ? "sí" : "NO");
+    return ok;
+}
+
+static bool reparto(const char* ruta) {
+    for (int c = 0; c < ING_MAX_CLIENTES; c++) s_entregados_cliente[c] = 0;
+    s_costo_ns.store(REPARTO_COSTO_US * 1000ULL);
+
+    std::vector<resultadoCliente> res(REPARTO_CLIENTES);
+    std::vector<std::thread> hilos;
+    uint64_t fin = ahoraNs() + REPARTO_MS * 1000000ULL;
+    // El 0 manda lotes grandes y reintenta sin pausa; los demás, lotes chicos
+    for (int c = 0; c < REPARTO_CLIENTES; c++) {
+        bool voraz = (c == 0);
+        int registros = voraz ? REPARTO_LOTE_VORAZ : REPARTO_LOTE;
+        hilos.push_back(std::thread(cliente, ruta, c, 0, registros, fin, !voraz, (histogramaNs*)NULL, &res[c]));
+    }
+    for (int c = 0; c < REPARTO_CLIENTES; c++) hilos[c].join();
+    esperarEntregados(g_ingesta.aceptados.load()); // Lo que quedó en la cola se entrega igual
+    s_costo_ns.store(0);
+
+    unsigned long total = 0, minimo = (unsigned long)-1;
+    for (int c = 0; c < REPARTO_CLIENTES; c++) total += s_entregados_cliente[c];
+    printf("Reparto con un empaquetador de %d us por mensaje, %d clientes durante %d ms\n", REPARTO_COSTO_US,
+           REPARTO_CLIENTES, REPARTO_MS);
+    printf("  cliente  lote  entregados  parte\n");
+    for (int c = 0; c < REPARTO_CLIENTES; c++) {
+        unsigned long e = s_entregados_cliente[c];
+        if (c > 0 && e < minimo) minimo = e;
+        printf("  %7d %5d %11lu %5.1f%%%s\n", c, c == 0 ? REPARTO_LOTE_VORAZ : REPARTO_LOTE, e,
+               total ? 100.0 * e / total : 0.0, c == 0 ? "  (sin pausa al recibir ING_LLENO)" : "");
+    }
+    double parte_voraz = total ? (double)s_entregados_cliente[0] / total : 1.0;
+    // Sin el reparto de la cola, el cliente de lotes grandes se quedaría con casi todo
+    bool ok = parte_voraz < 2.0 / REPARTO_CLIENTES && minimo > 0;
+    printf("  El voraz no pasa de 2 partes justas (%.1f%% < %.1f%%) y nadie queda sin entregar: %s\n\n",
+           100.0 * parte_voraz, 200.0 / REPARTO_CLIENTES, ok ? "sí" : "NO");
+    return ok;
+}
+
+int escenarioIngesta(int argc, char** argv) {
+    int lotes = (argc > 0) ? atoi(argv[0]) : 200;
+    if (lotes <= 0) {
+        printf("Uso: ./simulador ingesta [lotes_por_cliente]\n");
+        return 1;
+    }
+
+    bool ok = probarCola();
+
+    char dir[] = "/tmp/ingesta_XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        printf("No se pudo crear el directorio del socket.\n");
+        return 1;
+    }
+    char ruta[64];
+    snprintf(ruta, sizeof(ruta), "%s/emisor.sock", dir);
+    // El bucle de epoll es el hilo de la ingesta: este hilo queda bloqueado
+    // en los join() como el menú en sus preguntas
+    if (!ingestaIniciar(ruta, entregarPrueba)) {
+        rmdir(dir);
+        return 1;
+    }
+
+    printf("Clientes locales, cada uno con %d lotes de %d mensajes de %d bytes (espera el acuse)\n", lotes,
+           REGISTROS_LOTE, LNG_REGISTRO);
+    printf("  %8s %10s %12s %9s %9s %9s %8s %9s  %s\n", "clientes", "aceptados", "mensajes/s", "p50 us",
+           "p99 us", "max us", "llenos", "rechazos", "completo");
+    static const int CLIENTES[] = {1, 8, 32, 64};
+    for (size_t i = 0; i < sizeof(CLIENTES) / sizeof(CLIENTES[0]); i++) {
+        ok = cargaClientes(ruta, CLIENTES[i], lotes) && ok;
+    }
+    printf("  (latencia = escribir el lote y leer su acuse; el empaquetador entrega a un envío nulo)\n\n");
+
+    ok = reparto(ruta) && ok;
+
+    ingestaImprimir();
+    ingestaDetener();
+    rmdir(dir);
+    printf("\n  Todo entregado, en orden y repartido: %s\n", ok ? "sí" : "NO");
+    return ok ? 0 : 1;
+}
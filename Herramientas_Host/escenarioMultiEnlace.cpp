@@ -0,0 +1,154 @@
+/**
+ * @file escenarioMultiEnlace.cpp
+ * @brief Varios enlaces desde un solo hilo (multiEnlace.cpp) con una salida GPIO simulada.
+ * @details La salida simulada anota cada escritura de set/clear y reparte
+ * los flancos en una línea virtual por pin; el hilo de temporización corre
+ * con el reloj virtual (sus delayMicroseconds() no esperan de verdad).
+ * Después, el recibirFrame() real del receptor decodifica la línea de cada
+ * enlace y se compara con lo encolado.
+ *
+ * Con 1, 2, 4 y 8 enlaces a la misma velocidad se reportan los frames por
+ * segundo entre todos, las escrituras por segundo (una por instante con
+ * flancos) y el CPU del hilo por segundo de línea. Con un proceso por
+ * enlace, cada flanco sería una escritura y un despertar aparte.
+ */
+
+#include "escenarios.h"
+#include "halHost.h"
+#include "recibe.h"
+#include "multiEnlace.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdlib.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define NS_POR_S 1000000000LL
+#define MARGEN_FIN_NS 500000000LL // Línea quieta asegurada tras el último frame
+
+static const int PINES[ME_MAX_ENLACES] = {17, 22, 23, 24, 5, 6, 12, 16}; // El 27 es el retorno
+
+static lineaVirtual s_reloj;       // Reloj del hilo de temporización
+static lineaVirtual s_lineas[32];  // Una por pin BCM
+static std::atomic<bool> s_largar(false);
+
+// --- Salida simulada ---
+
+static bool iniciarSimulada(const int* pines, int n) {
+    halUsarLinea(&s_reloj);
+    // Arranca cuando ya está todo encolado: la corrida no depende de cuándo
+    // le toca al hilo principal
+    while (!s_largar.load()) std::this_thread::yield();
+    return true;
+}
+
+static void escribirSimulada(uint32_t poner, uint32_t borrar) {
+    for (int pin = 0; pin < 32; pin++) {
+        uint32_t bit = 1u << pin;
+        if ((poner | borrar) & bit) {
+            flanco f = {s_reloj.ahora_ns, (uint8_t)((poner & bit) ? HIGH : LOW)};
+            s_lineas[pin].flancos.push_back(f);
+        }
+    }
+}
+
+static const salidaGpio SALIDA_SIMULADA = {"simulada", iniciarSimulada, escribirSimulada};
+
+/**
+ * Lo que encola cada enlace: el mismo texto que ve el receptor.
+ */
+static void armarFrame(std::mt19937& rng, int enlace, int numero, protocolo& proto) {
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = 1;
+    int n = snprintf(reinterpret_cast<char*>(proto.data), LARGO_DATA, "E%d M%d ", enlace, numero);
+    int largo = 10 + rng() % 31;
+    while (n < largo) proto.data[n++] = (BYTE)('a' + rng() % 26);
+    proto.lng = n;
+}
+
+/**
+ * Decodifica la línea de un pin y cuenta los frames iguales a los esperados, en orden.
+ */
+static int verificarLinea(lineaVirtual& linea, int speed, const std::vector<protocolo>& esperados) {
+    linea.ahora_ns = 0;
+    linea.fin_ns = (linea.flancos.empty() ? 0 : linea.flancos.back().t_ns) + MARGEN_FIN_NS;
+    halUsarLinea(&linea);
+    size_t siguiente = 0;
+    int correctos = 0;
+    try {
+        for (;;) {
+            while (digitalRead(RX_PIN) == HIGH);
+            frameReceptor rx;
+            if (!recibirFrame(RX_PIN, speed, rx) || !desempaquetar(rx)) continue;
+            if (siguiente < esperados.size() && rx.cmd == esperados[siguiente].cmd &&
+                rx.lng == esperados[siguiente].lng &&
+                memcmp(payload(rx), esperados[siguiente].data, rx.lng) == 0) {
+                correctos++;
+            }
+            siguiente++;
+        }
+    } catch (const finDeLinea&) {
+        // Fin de lo escrito
+    }
+    halUsarLinea(NULL);
+    return correctos;
+}
+
+int escenarioMultiEnlace(int argc, char** argv) {
+    int frames = (argc > 0) ? atoi(argv[0]) : 20;
+    int speed = (argc > 1) ? atoi(argv[1]) : 100;
+    if (frames <= 0 || frames > ME_COLA_MAX || speed <= 0 || speed > 1000 || 1000 % speed != 0) {
+        printf("Uso: ./simulador multienlace [frames por enlace, hasta %d] [bps, divisor de 1000]\n",
+               ME_COLA_MAX);
+        return 1;
+    }
+    g_hal_serial_silencio = true;
+
+    printf("%d frames de 14 a 44 bytes por enlace a %d bps, todos desde un hilo\n\n", frames, speed);
+    printf("  %-8s %10s %9s %12s %13s %14s %16s %10s\n", "enlaces", "frames/s", "x 1", "escrituras/s",
+           "flancos/escr.", "1 proc./enlace", "CPU us/s línea", "correctos");
+
+    bool correcto = true;
+    double frames_s_uno = 0;
+    for (int n = 1; n <= ME_MAX_ENLACES; n *= 2) {
+        s_reloj = lineaVirtual();
+        for (int p = 0; p < 32; p++) s_lineas[p] = lineaVirtual();
+        s_largar = false;
+        if (!multiEnlaceIniciar(PINES, n, speed, &SALIDA_SIMULADA)) return 1;
+
+        std::mt19937 rng(n);
+        std::vector<protocolo> enviados[ME_MAX_ENLACES];
+        for (int f = 0; f < frames; f++) {
+            for (int e = 0; e < n; e++) {
+                protocolo proto;
+                armarFrame(rng, e, f, proto);
+                int largo = empaquetar(proto);
+                multiEnlaceEncolar(e, proto, largo);
+                enviados[e].push_back(proto);
+            }
+        }
+        s_largar = true;
+        multiEnlaceDetener();
+
+        contadoresMultiEnlace t = multiEnlaceTotales();
+        int correctos = 0;
+        for (int e = 0; e < n; e++) {
+            correctos += verificarLinea(s_lineas[PINES[e]], speed, enviados[e]);
+        }
+        if (correctos != n * frames) correcto = false;
+
+        double segundos = t.activo_us / 1e6;
+        double frames_s = n * frames / segundos;
+        if (n == 1) frames_s_uno = frames_s;
+        printf("  %-8d %10.2f %8.2fx %12.1f %13.2f %14.1f %16.1f %6d/%-4d\n", n, frames_s,
+               frames_s / frames_s_uno, t.escrituras / segundos, (double)t.flancos / t.escrituras,
+               t.flancos / segundos, t.cpu_ns / 1e3 / segundos, correctos, n * frames);
+    }
+    g_hal_serial_silencio = false;
+
+    printf("\n  Escrituras/s: con el hilo único; \"1 proc./enlace\": una escritura por flanco.\n");
+    printf("  Todos los frames llegaron bien a su receptor: %s\n", correcto ? "sí" : "NO");
+    return correcto ? 0 : 1;
+}
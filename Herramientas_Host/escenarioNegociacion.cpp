@@ -0,0 +1,249 @@
+/**
+ * @file escenarioNegociacion.cpp
+ * @brief Negociación de los parámetros del enlace (CMD 10) con distintos receptores.
+ * @details Corre negociarEnlace() del emisor y el controlEnlace.cpp del
+ * receptor con los enviarFrame()/recibirFrame() reales sobre dos líneas
+ * virtuales, como el escenario "velocidad": el receptor lee cada frame con
+ * la trama que tenga acordada en ese momento. Después de negociar se envía
+ * una ráfaga de frames de datos y se compara el goodput con el de la
+ * configuración base, para un receptor actual, uno que no negocia (firmware
+ * anterior), uno con menos capacidades y una línea con mucho jitter, donde
+ * lo acordado no anda y las dos puntas tienen que volver a la base.
+ */
+
+#include "escenarios.h"
+#include "halHost.h"
+#include "recibe.h"
+#include "controlEnlace.h"
+#include "retorno.h"
+#include "velocidadAdaptativa.h"
+#include "negociacionEmisor.h"
+#include "transporte.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdlib.h>
+
+#define PIN_SIMULADO 0
+#define LARGO_DATOS 40
+#define PAUSA_MS 20                    // Entre frames de datos, además de la separación mínima
+#define MARGEN_RECEPTOR_NS 150000000LL // Línea quieta asegurada tras cada frame
+#define MARGEN_RECEPTOR_BITS 3         // El receptor muestrea hasta medio bit más tarde
+#define NS_POR_S 1000000000LL
+
+/**
+ * Un receptor y una línea a probar.
+ */
+typedef struct
+{
+    const char* nombre;
+    bool negocia;                 // false = firmware que no conoce NEGOCIA
+    CapacidadesEnlace capacidades;
+    int64_t jitter_ns;            // Atraso medio de cada delay() del emisor
+} casoNegociacion;
+
+static const casoNegociacion CASOS[] = {
+    {"receptor actual", true, CAPACIDADES_RECEPTOR, 20000},
+    {"sin negociación", false, CAPACIDADES_RECEPTOR, 20000},
+    {"hasta 100 bps", true, {NEGOCIACION_VERSION, 0x1F, 0x04, 1 << NEG_FCS_CONTEO, LARGO_DATA}, 20000},
+    {"línea ruidosa", true, CAPACIDADES_RECEPTOR, 2000000},
+};
+
+typedef struct
+{
+    lineaVirtual ida;
+    lineaVirtual vuelta;          // Su reloj es el del emisor cuando no escribe
+    int64_t reloj_receptor;       // Hasta dónde leyó la ida el receptor
+    bool flush_pendiente;         // El receptor quedó en flushRX
+    const casoNegociacion* caso;
+    estadoEnlace enlace;
+    bool contar;                  // Ya empezó la ráfaga de datos
+    unsigned long bytes;
+    unsigned long frames_ok;
+    unsigned long frames_error;
+} simulacion;
+
+static simulacion* s_sim = NULL;
+
+/**
+ * flushRX() del receptor: espera 1 s sin flancos de bajada.
+ */
+static void flushVirtual() {
+    unsigned long quieto_desde = millis();
+    while (millis() - quieto_desde < 1000) {
+        if (digitalRead(RX_PIN) == LOW) quieto_desde = millis();
+        delay(1);
+    }
+}
+
+/**
+ * Tarea de recepción + tarea de comandos del receptor sobre lo que el
+ * emisor ya escribió (ver escenarioVelocidad.cpp).
+ */
+static void avanzarReceptor() {
+    simulacion& s = *s_sim;
+    halUsarLinea(&s.ida);
+    s.ida.jitter_medio_ns = 0;
+
+    try {
+        for (;;) {
+            s.ida.ahora_ns = s.reloj_receptor;
+            if (s.flush_pendiente) {
+                flushVirtual();
+                s.flush_pendiente = false;
+                s.reloj_receptor = s.ida.ahora_ns;
+            }
+
+            while (digitalRead(RX_PIN) == HIGH);
+            frameReceptor rx;
+            // Como Receptor_Esp32.ino: la trama se toma al detectar el inicio
+            FormatoLinea formato = enlaceFormato(s.enlace);
+            int fcs = enlaceConfiguracion(s.enlace).fcs;
+            bool sincronizado = recibirFrame(RX_PIN, enlaceVelocidad(s.enlace), rx, formato);
+            s.reloj_receptor = s.ida.ahora_ns;
+
+            if (!sincronizado || !desempaquetar(rx, fcs)) {
+                s.frames_error++;
+                enlaceFrameInvalido(s.enlace);
+                s.flush_pendiente = !sincronizado;
+                continue;
+            }
+            enlaceFrameValido(s.enlace);
+            s.frames_ok++;
+
+            if (rx.cmd == CMD_ENLACE) {
+                if (!s.caso->negocia && payload(rx)[0] >= ENLACE_NEGOCIA) continue;
+                frameReceptor respuesta;
+                if (enlaceProcesar(s.enlace, rx, respuesta)) {
+                    int64_t reloj_emisor = s.vuelta.ahora_ns;
+                    halUsarLinea(&s.vuelta);
+                    s.vuelta.ahora_ns = s.reloj_receptor + 1000000; // 1 ms en atenderla
+                    int largo = empaquetarRetorno(respuesta);
+                    enviarFrameRetorno(TX_RETORNO_PIN, enlaceVelocidad(s.enlace), respuesta, largo);
+                    enlaceDespuesDeResponder(s.enlace, (uint32_t)(s.vuelta.ahora_ns / 1000000));
+                    s.vuelta.ahora_ns = reloj_emisor;
+                    halUsarLinea(&s.ida);
+                }
+            } else if (s.contar) {
+                s.bytes += rx.lng;
+            }
+            enlaceRevisar(s.enlace, (uint32_t)(s.reloj_receptor / 1000000));
+        }
+    } catch (const finDeLinea&) {
+        // Se leyó todo lo escrito hasta ahora
+    }
+}
+
+static bool iniciarSimulado(int pin) {
+    return true;
+}
+
+/**
+ * Transporte del emisor: como el de wiringpi, escribe con formatoIda().
+ */
+static bool enviarSimulado(int pin, int speed, protocolo& proto, int largo) {
+    simulacion& s = *s_sim;
+    int64_t reloj_emisor = s.vuelta.ahora_ns;
+
+    halUsarLinea(&s.ida);
+    s.ida.ahora_ns = reloj_emisor;
+    s.ida.jitter_medio_ns = s.caso->jitter_ns;
+    enviarFrame(pin, speed, proto, largo, formatoIda());
+    reloj_emisor = s.ida.ahora_ns;
+    s.ida.fin_ns = reloj_emisor + MARGEN_RECEPTOR_NS + MARGEN_RECEPTOR_BITS * (NS_POR_S / speed);
+
+    avanzarReceptor();
+
+    halUsarLinea(&s.vuelta);
+    s.vuelta.ahora_ns = reloj_emisor;
+    return true;
+}
+
+static const transporte TRANSPORTE_SIMULADO = {"simulado", iniciarSimulado, enviarSimulado};
+
+/**
+ * Negocia (o no) y manda 'frames' frames de datos. Retorna el goodput de la ráfaga.
+ */
+static double correr(simulacion& s, const casoNegociacion& caso, bool negociar, int frames, bool& acordado) {
+    s.ida = lineaVirtual();
+    s.vuelta = lineaVirtual();
+    s.ida.semilla_jitter = 7;
+    s.vuelta.fin_ns = 3600 * NS_POR_S; // El emisor puede esperar respuestas en silencio
+    s.reloj_receptor = 0;
+    s.flush_pendiente = false;
+    s.caso = &caso;
+    s.contar = false;
+    s.bytes = s.frames_ok = s.frames_error = 0;
+    enlaceIniciar(s.enlace);
+    s.enlace.capacidades = caso.capacidades;
+
+    g_transporte = &TRANSPORTE_SIMULADO;
+    g_adaptativo_activo = false;
+    g_velocidad = velocidadDeEscalon(0);
+    g_config_enlace = CONFIGURACION_BASE;
+
+    halUsarLinea(&s.vuelta);
+    acordado = negociar && negociarEnlace(PIN_SIMULADO);
+
+    s.contar = true;
+    int64_t inicio = s.vuelta.ahora_ns;
+    for (int i = 0; i < frames; i++) {
+        protocolo tx;
+        memset(&tx, 0, sizeof(protocolo));
+        tx.cmd = 2;
+        tx.lng = LARGO_DATOS;
+        memset(tx.data, 'a' + i % 26, LARGO_DATOS);
+        int largo = empaquetar(tx);
+        g_transporte->enviar(PIN_SIMULADO, g_velocidad, tx, largo);
+        delay(PAUSA_MS + NEG_SEPARACION_BITS * 1000 / g_velocidad);
+    }
+    double segundos = (double)(s.vuelta.ahora_ns - inicio) / NS_POR_S;
+    halUsarLinea(NULL);
+    return (segundos > 0) ? s.bytes / segundos : 0.0;
+}
+
+int escenarioNegociacion(int argc, char** argv) {
+    int frames = (argc > 0) ? atoi(argv[0]) : 20;
+    if (frames <= 0) {
+        printf("Uso: ./simulador negociacion [frames_por_caso]\n");
+        return 1;
+    }
+
+    simulacion sim;
+    s_sim = &sim;
+    g_hal_serial_silencio = true;
+
+    printf("Negociación (CMD 10) y luego %d frames de %d bytes, %d ms + 3 bits entre frames\n\n", frames, LARGO_DATOS,
+           PAUSA_MS);
+    printf("  %-16s %-9s %8s %7s %7s %6s %6s %10s %7s\n", "receptor", "acuerdo", "bps", "parada",
+           "fcs", "ok", "error", "goodput", "x base");
+
+    int fallidos = 0;
+    for (size_t c = 0; c < sizeof(CASOS) / sizeof(CASOS[0]); c++) {
+        bool acordado;
+        double base = correr(sim, CASOS[c], false, frames, acordado);
+        unsigned long ok_base = sim.frames_ok;
+        double negociado = correr(sim, CASOS[c], true, frames, acordado);
+
+        // En cualquier caso la ráfaga tiene que llegar entera y las dos
+        // puntas terminar con la misma configuración
+        ConfiguracionEnlace receptor = enlaceConfiguracion(sim.enlace);
+        bool coherente = configuracionIgual(receptor, g_config_enlace) &&
+                         enlaceVelocidad(sim.enlace) == g_velocidad;
+        bool completa = sim.bytes == (unsigned long)frames * LARGO_DATOS &&
+                        ok_base >= (unsigned long)frames;
+        if (!coherente || !completa) fallidos++;
+
+        printf("  %-16s %-9s %8d %7d %7s %6lu %6lu %10.2f %6.2fx%s\n", CASOS[c].nombre,
+               acordado ? "sí" : "no", g_velocidad, g_config_enlace.bits_parada,
+               g_config_enlace.fcs == NEG_FCS_CRC16 ? "crc16" : "conteo", sim.frames_ok, sim.frames_error,
+               negociado, base > 0 ? negociado / base : 0.0,
+               !coherente ? "  <- puntas distintas" : (!completa ? "  <- faltan frames" : ""));
+    }
+    g_hal_serial_silencio = false;
+
+    printf("\n  goodput = bytes de payload entregados por segundo durante la ráfaga\n");
+    printf("  x base  = contra la misma ráfaga sin negociar (%d bps, 2 bits de parada)\n",
+           velocidadDeEscalon(0));
+    negociacionImprimir();
+    return fallidos == 0 ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file escenarioPipeline.cpp
+ * @brief Throughput del receptor con y sin pipeline.
+ * @details El emisor escribe con enviarFrame() una línea virtual con ráfagas
+ * de frames seguidos mientras algunos comandos tardan varios frames en
+ * ejecutarse (como escribir el OLED por I2C). Las dos versiones leen esa
+ * misma línea con recibirFrame():
+ * - Secuencial: el loop() original en un solo hilo. Mientras ejecuta un
+ *   comando nadie mira la línea: al volver cae en medio de un frame, falla
+ *   la sincronización y flushRX() espera el silencio entre ráfagas.
+ * - Pipeline: la tarea de recepción (std::thread en lugar de la tarea del
+ *   core 0) llena el pool y la de comandos lo vacía. La recepción sigue el
+ *   reloj de la línea a escala (por defecto 50 veces más rápido) y los
+ *   comandos duermen su tiempo con la misma escala.
+ * Las dos se miden en tiempo de línea: frames atendidos por segundo.
+ */
+
+#include "escenarios.h"
+#include "halHost.h"
+#include "recibe.h"
+#include "pipelineReceptor.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+typedef std::chrono::steady_clock reloj;
+
+#define PIN_SIMULADO 0
+#define VELOCIDAD 1000                // Bit de 1 ms, la más rápida de enviarFrame()
+#define LARGO_DATOS 8
+#define SEPARACION_BITS 3             // Entre frames seguidos: el stop final no tiene duración
+#define RAFAGA 20                     // Frames seguidos antes de un silencio
+#define SILENCIO_MS 1500              // Entre ráfagas: más que el de flushRX()
+#define SILENCIO_FLUSH_MS 1000        // El de flushRX()
+#define RAPIDO_MS 1                   // Comando rápido (menos que la separación)
+#define INICIO_NS 1000000000LL        // Un flanco en t = 0 no se ve como bajada
+#define MARGEN_FIN_NS 2000000000LL
+
+// Cada cuántos frames llega uno "lento" (CMD 2, texto al OLED)
+#define CADA_CUANTOS_LENTO 4
+
+/**
+ * Escribe los frames en la línea con el número de secuencia en los datos,
+ * para verificar orden e integridad.
+ */
+static void escribirLinea(lineaVirtual& linea, unsigned long frames) {
+    linea.ahora_ns = INICIO_NS;
+    halUsarLinea(&linea);
+    for (unsigned long k = 0; k < frames; k++) {
+        protocolo tx;
+        memset(&tx, 0, sizeof(protocolo));
+        tx.cmd = (k % CADA_CUANTOS_LENTO == 0) ? 2 : 1;
+        tx.lng = LARGO_DATOS;
+        for (int i = 0; i < tx.lng; i++) {
+            tx.data[i] = (BYTE)(k >> (8 * (i % 4)));
+        }
+        int largo = empaquetar(tx);
+        enviarFrame(PIN_SIMULADO, VELOCIDAD, tx, largo);
+        delay(SEPARACION_BITS * 1000 / VELOCIDAD);
+        if ((k + 1) % RAFAGA == 0) delay(SILENCIO_MS);
+    }
+    halUsarLinea(NULL);
+    linea.fin_ns = (linea.flancos.empty() ? 0 : linea.flancos.back().t_ns) + MARGEN_FIN_NS;
+}
+
+static unsigned long leerSecuencia(const frameReceptor& proto) {
+    const BYTE* datos = payload(proto);
+    return (unsigned long)datos[0] | ((unsigned long)datos[1] << 8) |
+           ((unsigned long)datos[2] << 16) | ((unsigned long)datos[3] << 24);
+}
+
+static double segundosLinea(const lineaVirtual& linea) {
+    return (double)(linea.ahora_ns - INICIO_NS) / 1e9;
+}
+
+/**
+ * flushRX() del receptor: espera 1 s sin flancos de bajada.
+ */
+static void flushVirtual() {
+    unsigned long quieto_desde = millis();
+    while (millis() - quieto_desde < SILENCIO_FLUSH_MS) {
+        if (digitalRead(RX_PIN) == LOW) quieto_desde = millis();
+        delay(1);
+    }
+}
+
+typedef struct
+{
+    unsigned long atendidos;
+    unsigned long errores;       // Sincronización o FCS (el secuencial hace flushRX)
+    unsigned long desordenados;
+    double segundos;             // De línea
+} resultadoRecepcion;
+
+/**
+ * El loop() original: recibir, desempaquetar y ejecutar en el mismo hilo.
+ */
+static void correrSecuencial(lineaVirtual linea, long lento_ms, resultadoRecepcion& r) {
+    memset(&r, 0, sizeof(r));
+    linea.ahora_ns = 0;
+    halUsarLinea(&linea);
+    unsigned long esperado = 0;
+    try {
+        for (;;) {
+            while (digitalRead(RX_PIN) == HIGH);
+            frameReceptor rx;
+            if (!recibirFrame(RX_PIN, VELOCIDAD, rx) || !desempaquetar(rx)) {
+                r.errores++;
+                flushVirtual();
+                continue;
+            }
+            unsigned long secuencia = leerSecuencia(rx);
+            if (secuencia < esperado) r.desordenados++;
+            esperado = secuencia + 1;
+            delay(rx.cmd == 2 ? lento_ms : RAPIDO_MS); // ejecutarComando()
+            r.atendidos++;
+        }
+    } catch (const finDeLinea&) {
+        // Se leyó toda la línea
+    }
+    r.segundos = segundosLinea(linea);
+    halUsarLinea(NULL);
+}
+
+/**
+ * Las tareas de recepción y de comandos del receptor actual.
+ */
+static void correrPipeline(lineaVirtual linea, long lento_ms, long escala, resultadoRecepcion& r) {
+    memset(&r, 0, sizeof(r));
+    pipelineIniciar();
+    g_pipe_frames_descartados = 0;
+    g_pipe_max_ocupados = 0;
+    std::atomic<bool> fin_productor(false);
+    std::atomic<unsigned long> ejecutados(0);
+    std::atomic<unsigned long> errores(0);
+    std::atomic<unsigned long> desordenados(0);
+    reloj::time_point t0 = reloj::now();
+
+    // El reloj real alcanza al de la línea (a escala)
+    auto alcanzar = [&](const lineaVirtual& l) {
+        std::this_thread::sleep_until(t0 + std::chrono::nanoseconds((l.ahora_ns - INICIO_NS) / escala));
+    };
+
+    // --- Tarea de recepción ---
+    std::thread recepcion([&]() {
+        linea.ahora_ns = 0;
+        halUsarLinea(&linea);
+        int idx = -1;
+        frameReceptor descarte;
+        try {
+            for (;;) {
+                if (idx < 0) idx = pipelineTomarLibre();
+                while (digitalRead(RX_PIN) == HIGH);
+                alcanzar(linea);
+                frameReceptor& rx = (idx < 0) ? descarte : *pipelineBuffer(idx);
+                bool sincronizado = recibirFrame(RX_PIN, VELOCIDAD, rx);
+                alcanzar(linea);
+                if (!sincronizado) {
+                    errores++;
+                } else if (idx < 0) {
+                    g_pipe_frames_descartados++; // Pool lleno: el frame se leyó igual
+                } else {
+                    pipelinePublicar(idx);
+                    idx = -1;
+                }
+            }
+        } catch (const finDeLinea&) {
+            // Se leyó toda la línea
+        }
+        r.segundos = segundosLinea(linea);
+        halUsarLinea(NULL);
+        fin_productor = true;
+    });
+
+    // --- Tarea de comandos ---
+    std::thread comandos([&]() {
+        unsigned long esperado = 0;
+        for (;;) {
+            int idx = pipelineTomarListo();
+            if (idx < 0) {
+                if (fin_productor && (idx = pipelineTomarListo()) < 0) break;
+                if (idx < 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+            }
+            frameReceptor& proto = *pipelineBuffer(idx);
+            if (!desempaquetar(proto)) {
+                errores++;
+            } else {
+                unsigned long secuencia = leerSecuencia(proto);
+                if (secuencia < esperado) desordenados++;
+                esperado = secuencia + 1;
+                long manejo_ms = (proto.cmd == 2) ? lento_ms : RAPIDO_MS;
+                std::this_thread::sleep_for(std::chrono::microseconds(manejo_ms * 1000 / escala));
+                ejecutados++;
+            }
+            pipelineLiberar(idx);
+        }
+    });
+
+    recepcion.join();
+    comandos.join();
+    r.atendidos = ejecutados.load();
+    r.errores = errores.load();
+    r.desordenados = desordenados.load();
+}
+
+int escenarioPipeline(int argc, char** argv) {
+    unsigned long frames = (argc > 0) ? strtoul(argv[0], NULL, 10) : 1000;
+    long lento_ms = (argc > 1) ? atol(argv[1]) : 400;   // Comando lento (OLED), unos 3 frames
+    long escala = (argc > 2) ? atol(argv[2]) : 50;
+    if (frames == 0 || lento_ms < 0 || escala <= 0) {
+        printf("Uso: ./simulador pipeline [frames] [ms del comando lento] [escala]\n");
+        return 1;
+    }
+
+    g_hal_serial_silencio = true;
+    lineaVirtual linea;
+    escribirLinea(linea, frames);
+
+    resultadoRecepcion sec, pip;
+    correrSecuencial(linea, lento_ms, sec);
+    correrPipeline(linea, lento_ms, escala, pip);
+
+    printf("Frames enviados:          %lu a %d bps, en ráfagas de %d (1 de cada %d tarda %ld ms)\n", frames,
+           VELOCIDAD, RAFAGA, CADA_CUANTOS_LENTO, lento_ms);
+    printf("Secuencial (loop):        %lu atendidos, %lu perdidos, %lu flushRX, %.1f frames/s\n", sec.atendidos,
+           frames - sec.atendidos, sec.errores, sec.atendidos / sec.segundos);
+    printf("Pipeline (%d buffers):     %lu atendidos, %lu perdidos, %lu errores, %.1f frames/s\n",
+           PIPE_NUM_BUFFERS, pip.atendidos, g_pipe_frames_descartados.load(), pip.errores,
+           pip.atendidos / pip.segundos);
+    printf("Pico de buffers en uso:   %u de %d\n", g_pipe_max_ocupados.load(), PIPE_NUM_BUFFERS);
+    printf("Tiempo de línea:          %.1f s (el pipeline, a escala 1:%ld)\n", pip.segundos, escala);
+
+    bool ok = pip.atendidos == frames && g_pipe_frames_descartados.load() == 0 && pip.errores == 0 &&
+              pip.desordenados == 0 && sec.desordenados == 0;
+    return ok ? 0 : 2;
+}
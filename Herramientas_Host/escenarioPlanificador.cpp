@@ -0,0 +1,142 @@
+/**
+ * @file escenarioPlanificador.cpp
+ * @brief Error de tiempo del parpadeo del LED entre 1 y 100 Hz, con reloj virtual.
+ * @details Compara dos formas de togglear el LED con la misma carga en el core:
+ * - Sondeo: la lógica de manejarParpadeoLED() (millis() desde un loop que se
+ *   despierta cada ~1 ms y a veces queda bloqueado por el OLED/Serial).
+ * - Planificador: planificadorEjecutar() llamado por un timer al deadline,
+ *   con la latencia de despacho de esp_timer.
+ * Todo corre en tiempo virtual, así que el resultado es reproducible.
+ * Falla si el planificador se pasa de ERROR_HZ_MAX o JITTER_MAX_US en alguna
+ * frecuencia, o si pierde periodos.
+ */
+
+#include "escenarios.h"
+#include "planificador.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+
+#define DURACION_US (120UL * 1000000UL) // 2 minutos virtuales
+
+// Carga del core: probabilidad de que una vuelta del loop quede bloqueada
+// y cuánto dura el bloqueo (escritura I2C del OLED + Serial).
+#define PROB_BLOQUEO 0.03
+#define BLOQUEO_US 25000
+
+// Límites que tiene que cumplir el planificador en todo el rango 1-100 Hz.
+// El despacho de esp_timer tarda 5-40 us, así que el jitter queda acotado
+// por la latencia y no por la carga del core.
+#define ERROR_HZ_MAX 0.005  // 0.5% de la frecuencia pedida
+#define JITTER_MAX_US 100   // Por medio periodo
+
+typedef struct
+{
+    uint32_t ultimo_toggle;
+    unsigned long toggles;
+    double error_abs_total;   // Suma de |medio periodo real - ideal|
+    uint32_t error_max;
+    uint32_t ideal_us;
+} medicionLed;
+
+static void registrarToggle(medicionLed& m, uint32_t ahora) {
+    if (m.toggles > 0) {
+        uint32_t real = ahora - m.ultimo_toggle;
+        uint32_t error = (real > m.ideal_us) ? real - m.ideal_us : m.ideal_us - real;
+        m.error_abs_total += error;
+        if (error > m.error_max) m.error_max = error;
+    }
+    m.ultimo_toggle = ahora;
+    m.toggles++;
+}
+
+// Reloj virtual compartido con la tarea del planificador
+static uint32_t s_ahora_virtual;
+
+static void tareaLedVirtual(void* arg) {
+    registrarToggle(*(medicionLed*)arg, s_ahora_virtual);
+}
+
+/**
+ * Modelo del loop() con manejarParpadeoLED(): sondea millis() en cada vuelta.
+ */
+static medicionLed simularSondeo(int frecuencia_hz, std::mt19937& rng) {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    medicionLed m = {0, 0, 0.0, 0, (uint32_t)(500000UL / frecuencia_hz)};
+
+    unsigned long tiempoAnteriorLED = 0;
+    long periodo_ms = (1000 / frecuencia_hz) / 2; // Misma cuenta entera que el original
+    uint32_t ahora = 0;
+    while (ahora < DURACION_US) {
+        unsigned long tiempoActual = ahora / 1000; // millis()
+        if (tiempoActual - tiempoAnteriorLED >= (unsigned long)periodo_ms) {
+            tiempoAnteriorLED = tiempoActual;
+            registrarToggle(m, ahora);
+        }
+        // delay(1) + costo de la vuelta, y a veces un bloqueo largo
+        ahora += 1000 + (uint32_t)(u(rng) * 200);
+        if (u(rng) < PROB_BLOQUEO) ahora += BLOQUEO_US;
+    }
+    return m;
+}
+
+/**
+ * Modelo del planificador disparado por esp_timer: corre en el deadline más
+ * la latencia de despacho, sin importar los bloqueos de la tarea de comandos.
+ */
+static medicionLed simularPlanificador(int frecuencia_hz, std::mt19937& rng, unsigned& perdidos) {
+    std::uniform_int_distribution<uint32_t> latencia(5, 40);
+    medicionLed m = {0, 0, 0.0, 0, (uint32_t)(500000UL / frecuencia_hz)};
+
+    planificador p;
+    planificadorIniciar(p);
+    s_ahora_virtual = 0;
+    int id = planificadorAgregar(p, tareaLedVirtual, &m, 0, m.ideal_us, m.ideal_us);
+    while (s_ahora_virtual < DURACION_US) {
+        uint32_t espera = planificadorEjecutar(p, s_ahora_virtual);
+        if (espera == PLAN_SIN_TAREAS) break;
+        s_ahora_virtual += espera + latencia(rng);
+    }
+
+    perdidos = p.tareas[id].periodos_perdidos;
+    if (perdidos != 0) {
+        printf("  (aviso: %u periodos perdidos a %d Hz)\n", perdidos, frecuencia_hz);
+    }
+    return m;
+}
+
+static double errorHz(int hz, const medicionLed& m) {
+    double hz_real = (m.toggles / 2.0) / (DURACION_US / 1e6);
+    return fabs(hz_real - hz) / hz;
+}
+
+static void imprimirFila(const char* modo, int hz, const medicionLed& m) {
+    double hz_real = (m.toggles / 2.0) / (DURACION_US / 1e6);
+    double error_prom = m.toggles > 1 ? m.error_abs_total / (m.toggles - 1) : 0.0;
+    printf("%-13s %5d %10.3f %9.2f%% %12.0f %10u\n", modo, hz, hz_real,
+           100.0 * errorHz(hz, m), error_prom, m.error_max);
+}
+
+int escenarioPlanificador(int argc, char** argv) {
+    unsigned semilla = (argc > 0) ? (unsigned)atoi(argv[0]) : 1;
+    const int frecuencias[] = {1, 2, 5, 10, 25, 50, 100};
+
+    bool ok = true;
+    printf("%-13s %5s %10s %10s %12s %10s\n", "modo", "Hz", "Hz real", "error", "jitter prom", "jitter max");
+    for (size_t i = 0; i < sizeof(frecuencias) / sizeof(frecuencias[0]); i++) {
+        std::mt19937 rng_a(semilla), rng_b(semilla);
+        unsigned perdidos = 0;
+        imprimirFila("sondeo", frecuencias[i], simularSondeo(frecuencias[i], rng_a));
+        medicionLed m = simularPlanificador(frecuencias[i], rng_b, perdidos);
+        imprimirFila("planificador", frecuencias[i], m);
+        if (errorHz(frecuencias[i], m) > ERROR_HZ_MAX || m.error_max > JITTER_MAX_US || perdidos != 0) {
+            ok = false;
+        }
+    }
+    printf("(jitter en us por medio periodo; %d%% de vueltas bloqueadas %d ms)\n",
+           (int)(PROB_BLOQUEO * 100), BLOQUEO_US / 1000);
+    printf("\n  Planificador dentro de %.1f%% y %d us de jitter de 1 a 100 Hz: %s\n",
+           ERROR_HZ_MAX * 100, JITTER_MAX_US, ok ? "sí" : "NO");
+    return ok ? 0 : 1;
+}
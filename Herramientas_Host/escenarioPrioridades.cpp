@@ -0,0 +1,253 @@
+/**
+ * @file escenarioPrioridades.cpp
+ * @brief Clases de prioridad y fragmentos (CMD 11) con tráfico mezclado.
+ * @details Corre las colas del emisor (prioridadEnvio.cpp) sobre una línea
+ * virtual de SPEED bps: cada frame ocupa la línea (11 bits por byte + la
+ * paridad y el stop final) y recién al terminar se elige el siguiente. El
+ * tráfico llega al azar (Poisson): controles (CMD 4, 5), interactivos
+ * (CMD 3, 1) y masivos (CMD 2, 7 de 30 a 63 bytes). Todo lo transmitido
+ * pasa por desempaquetar() y reensambleProcesar() del receptor y se compara
+ * con el original.
+ *
+ * Para cada variante se reportan los percentiles de latencia por clase
+ * (de encolar a terminar el último bit del mensaje) y la espera máxima de
+ * un control por frames de OTRAS clases, que con fragmentos tiene que ser
+ * como mucho el tiempo de aire de un fragmento.
+ */
+
+#include "escenarios.h"
+#include "prioridadEnvio.h"
+#include "recibe.h"
+#include "reensambleFrames.h"
+#include "Arduino.h"
+#include <stdlib.h>
+#include <math.h>
+#include <map>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#define NS_POR_S 1000000000ULL
+#define BITS_POR_BYTE 11        // Inicio + 8 datos + 2 de parada
+#define BITS_FIN_FRAME 2        // Paridad del frame + stop final
+
+// Tiempo medio entre mensajes de cada clase (s). A 10 bps la línea queda
+// ocupada ~50% sin fragmentar y ~75% con fragmentos de 8 bytes.
+static const double INTERVALO_MEDIO_S[NUM_PRIORIDADES] = {120.0, 60.0, 250.0};
+
+static const char* NOMBRE_CLASE[NUM_PRIORIDADES] = {"control", "interactiva", "masiva"};
+
+typedef struct
+{
+    const char* nombre;
+    bool con_prioridad;
+    int frag_datos;
+} variantePrioridad;
+
+static const variantePrioridad VARIANTES[] = {
+    {"FIFO, sin fragmentar (hoy)", false, 0},
+    {"prioridad, sin fragmentar", true, 0},
+    {"prioridad, fragmentos de 32", true, 32},
+    {"prioridad, fragmentos de 16", true, 16},
+    {"prioridad, fragmentos de 8", true, 8},
+};
+
+typedef struct
+{
+    uint64_t t_ns;
+    protocolo proto;
+} llegada;
+
+typedef struct
+{
+    std::vector<double> latencia_s[NUM_PRIORIDADES];
+    double espera_ajena_max_s;     // De un control, por frames de otras clases
+    double aire_max_otras_s;       // El frame más largo de otra clase que se transmitió
+    double ocupacion;              // Fracción del tiempo con la línea ocupada
+    unsigned long entregados;
+    unsigned long incorrectos;     // Se entregó algo distinto al original (no debe pasar)
+    unsigned long descartados;     // El receptor descartó un mensaje a medias
+} resultadoPrioridad;
+
+static uint64_t aireNs(int largo) {
+    return (uint64_t)(largo * BITS_POR_BYTE + BITS_FIN_FRAME) * NS_POR_S / SPEED;
+}
+
+static void textoAleatorio(std::mt19937& rng, BYTE* destino, int largo) {
+    for (int i = 0; i < largo; i++) destino[i] = (BYTE)('a' + rng() % 26);
+}
+
+/**
+ * Genera el mismo tráfico para todas las variantes.
+ */
+static std::vector<llegada> generarTrafico(double duracion_s, unsigned semilla) {
+    std::mt19937 rng(semilla);
+    std::vector<llegada> llegadas;
+    for (int clase = 0; clase < NUM_PRIORIDADES; clase++) {
+        std::exponential_distribution<double> intervalo(1.0 / INTERVALO_MEDIO_S[clase]);
+        for (double t = intervalo(rng); t < duracion_s; t += intervalo(rng)) {
+            llegada l;
+            l.t_ns = (uint64_t)(t * NS_POR_S);
+            memset(&l.proto, 0, sizeof(protocolo));
+            bool variante = (rng() % 10) < 3;
+            if (clase == PRIO_CONTROL) {
+                l.proto.cmd = variante ? 5 : 4;
+                if (variante) { memcpy(l.proto.data, "50", 2); l.proto.lng = 2; }
+            } else if (clase == PRIO_INTERACTIVA) {
+                l.proto.cmd = variante ? 1 : 3;
+                l.proto.lng = variante ? 20 : 4;
+                textoAleatorio(rng, l.proto.data, l.proto.lng);
+            } else {
+                l.proto.cmd = variante ? 7 : 2;
+                l.proto.lng = (BYTE)(30 + rng() % (LARGO_DATA - 30 + 1));
+                textoAleatorio(rng, l.proto.data, l.proto.lng);
+            }
+            llegadas.push_back(l);
+        }
+    }
+    std::sort(llegadas.begin(), llegadas.end(),
+              [](const llegada& a, const llegada& b) { return a.t_ns < b.t_ns; });
+    return llegadas;
+}
+
+/**
+ * Lo que hace la tarea de comandos del receptor con un frame bien recibido.
+ * @return true si se completó un mensaje (queda en 'rx').
+ */
+static bool recibir(reensambleFrames& reensamble, const unidadEnvio& u, frameReceptor& rx) {
+    memcpy(rx.frame, u.proto.frame, u.largo);
+    rx.cmd = FrameEstandar::cmdDe(rx.frame);
+    rx.lng = FrameEstandar::lngDe(rx.frame);
+    if (!desempaquetar(rx)) return false;
+    resultadoFragmento r = reensambleProcesar(reensamble, rx);
+    return r == FRAG_NO_ES || r == FRAG_COMPLETO;
+}
+
+static void simular(const variantePrioridad& v, const std::vector<llegada>& llegadas, double perdida,
+                    unsigned semilla, resultadoPrioridad& r) {
+    static colaPrioridades cola; // ~3 KB de frames: mejor fuera de la pila
+    prioridadesIniciar(cola, v.frag_datos, v.con_prioridad, NULL);
+    static reensambleFrames reensamble;
+    reensambleIniciar(reensamble);
+    std::mt19937 rng(semilla);
+    std::uniform_real_distribution<double> azar(0.0, 1.0);
+
+    for (int i = 0; i < NUM_PRIORIDADES; i++) r.latencia_s[i].clear();
+    r.espera_ajena_max_s = 0;
+    r.aire_max_otras_s = 0;
+    r.entregados = r.incorrectos = 0;
+
+    // Para comparar lo entregado con el original (la hora de llegada es única)
+    std::map<uint64_t, const protocolo*> originales;
+    for (size_t i = 0; i < llegadas.size(); i++) originales[llegadas[i].t_ns] = &llegadas[i].proto;
+
+    // Controles encolados que todavía no empezaron: cuánto esperaron por otras clases
+    std::vector<std::pair<uint64_t, uint64_t> > controles; // (encolado, espera ajena)
+
+    uint64_t ahora = 0;
+    uint64_t ocupado = 0;
+    bool anterior_ajeno = false; // El último frame era de otra clase que el control
+    size_t siguiente = 0;
+    frameReceptor rx;
+    for (;;) {
+        // Lo que llegó mientras el último frame estaba en el aire se encola
+        // al terminarlo; un control ya esperó desde su llegada.
+        while (siguiente < llegadas.size() && llegadas[siguiente].t_ns <= ahora) {
+            const llegada& l = llegadas[siguiente++];
+            prioridadesEncolar(cola, l.proto, l.t_ns);
+            if (clasePorCmd(l.proto.cmd) == PRIO_CONTROL) {
+                controles.push_back(std::make_pair(l.t_ns, anterior_ajeno ? ahora - l.t_ns : 0));
+            }
+        }
+
+        unidadEnvio u;
+        if (!prioridadesSiguiente(cola, u)) {
+            if (siguiente >= llegadas.size()) break;
+            ahora = llegadas[siguiente].t_ns; // Línea en reposo hasta el próximo mensaje
+            continue;
+        }
+
+        uint64_t aire = aireNs(u.largo);
+        ahora += aire;
+        ocupado += aire;
+
+        if (u.clase == PRIO_CONTROL) {
+            // Los controles van enteros y en orden: empieza el más antiguo
+            double espera = controles.front().second / (double)NS_POR_S;
+            r.espera_ajena_max_s = std::max(r.espera_ajena_max_s, espera);
+            controles.erase(controles.begin());
+        } else {
+            r.aire_max_otras_s = std::max(r.aire_max_otras_s, aire / (double)NS_POR_S);
+            for (size_t i = 0; i < controles.size(); i++) controles[i].second += aire;
+        }
+        anterior_ajeno = (u.clase != PRIO_CONTROL);
+
+        if (u.ultimo) {
+            r.latencia_s[u.clase].push_back((ahora - u.t_encolado_ns) / (double)NS_POR_S);
+        }
+
+        if (perdida > 0 && azar(rng) < perdida) continue; // Frame perdido en la línea
+        if (recibir(reensamble, u, rx) && u.ultimo) {
+            const protocolo* original = originales[u.t_encolado_ns];
+            r.entregados++;
+            if (rx.cmd != original->cmd || rx.lng != original->lng ||
+                memcmp(payload(rx), original->data, rx.lng) != 0) {
+                r.incorrectos++;
+            }
+        }
+    }
+    r.ocupacion = ahora ? (double)ocupado / ahora : 0.0;
+    r.descartados = reensamble.descartados;
+}
+
+static double percentil(std::vector<double>& v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t i = (size_t)ceil(p / 100.0 * v.size());
+    return v[i > 0 ? i - 1 : 0];
+}
+
+int escenarioPrioridades(int argc, char** argv) {
+    double duracion_s = (argc > 0) ? atof(argv[0]) : 500000.0;
+    unsigned semilla = (argc > 1) ? (unsigned)atoi(argv[1]) : 1;
+    if (duracion_s <= 0) {
+        printf("Uso: ./simulador prioridades [segundos virtuales] [semilla]\n");
+        return 1;
+    }
+
+    std::vector<llegada> llegadas = generarTrafico(duracion_s, semilla);
+    printf("Prioridades y fragmentos: %.0f s virtuales a %d bps, %zu mensajes, semilla %u\n",
+           duracion_s, SPEED, llegadas.size(), semilla);
+    printf("Latencia en segundos (p50 / p99 / máx) de encolar a terminar el mensaje:\n");
+    printf("  %-28s %-20s %-20s %-20s %7s %14s\n", "variante", NOMBRE_CLASE[0], NOMBRE_CLASE[1],
+           NOMBRE_CLASE[2], "ocup.", "espera ctrl");
+
+    g_hal_serial_silencio = true; // desempaquetar() imprime los FCS
+    bool ok = true;
+    resultadoPrioridad r;
+    for (size_t v = 0; v < sizeof(VARIANTES) / sizeof(VARIANTES[0]); v++) {
+        simular(VARIANTES[v], llegadas, 0.0, semilla, r);
+        char columnas[NUM_PRIORIDADES][32];
+        for (int c = 0; c < NUM_PRIORIDADES; c++) {
+            snprintf(columnas[c], sizeof(columnas[c]), "%5.0f/%6.0f/%6.0f", percentil(r.latencia_s[c], 50),
+                     percentil(r.latencia_s[c], 99), percentil(r.latencia_s[c], 100));
+        }
+        printf("  %-28s %-20s %-20s %-20s %6.0f%% %6.1f/%6.1f\n", VARIANTES[v].nombre, columnas[0],
+               columnas[1], columnas[2], r.ocupacion * 100, r.espera_ajena_max_s, r.aire_max_otras_s);
+
+        // Con prioridad, un control espera a otras clases a lo sumo un frame en el aire
+        if (VARIANTES[v].con_prioridad && r.espera_ajena_max_s > r.aire_max_otras_s + 1e-6) ok = false;
+        if (r.entregados != llegadas.size() || r.incorrectos > 0) ok = false;
+    }
+    printf("  (espera ctrl = máxima espera de un control por otras clases / frame más largo de otras clases)\n");
+
+    // Con pérdidas: los mensajes incompletos se descartan, nunca se arman mal
+    simular(VARIANTES[3], llegadas, 0.05, semilla, r);
+    printf("Con 5%% de frames perdidos (%s): %lu de %zu entregados, %lu descartados a medias, %lu incorrectos\n",
+           VARIANTES[3].nombre, r.entregados, llegadas.size(), r.descartados, r.incorrectos);
+    if (r.incorrectos > 0) ok = false;
+    g_hal_serial_silencio = false;
+
+    printf("%s\n", ok ? "Prioridades OK." : "ERROR: latencia del control fuera de cota o mensajes mal armados.");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file escenarioProtocolo.cpp
+ * @brief Verificación de frameProtocolo.h contra la codificación anterior.
+ * @details Arma frames con todos los CMD y LNG posibles y payloads
+ * aleatorios, y comprueba que:
+ *  - empaquetar() del emisor deja los mismos bytes que el código a mano
+ *    que había antes en cada programa (desplazamientos + conteo de bits);
+ *  - desempaquetar() del receptor los acepta y decodifica el mismo CMD/LNG;
+ *  - cambiar un solo bit del frame siempre hace fallar el FCS;
+ *  - los frames fijos (CMD 0, 4 y 6), calculados al compilar, coinciden
+ *    con empaquetar() y con el bit de paridad que envía enviarFrame().
+ */
+
+#include "escenarios.h"
+#include "recibe.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdlib.h>
+
+// Se evalúan al compilar: si la biblioteca cambia el formato, no compila
+static constexpr FrameEstandar::Fijo FIJOS[] = {
+    FrameEstandar::fijo<0>(), FrameEstandar::fijo<4>(), FrameEstandar::fijo<6>(),
+};
+static_assert(FIJOS[1].bytes[0] == (4 << 2) && FIJOS[1].bytes[1] == 0, "Cabecera del CMD 4");
+static_assert(FIJOS[1].bytes[3] == 1 && FIJOS[2].bytes[3] == 2, "FCS de los frames fijos");
+static_assert(FrameEstandar::LARGO_MAX == LARGO_DATA + BYTES_EXTRA, "Largo del frame");
+
+/**
+ * La codificación tal como estaba escrita en el emisor y el receptor.
+ */
+static int codificarAnterior(BYTE* frame, int cmd, const BYTE* datos, int lng) {
+    frame[0] = (cmd & 0x0F) << 2;
+    frame[1] = (lng & 0x3F) << 1;
+    for (int i = 0; i < lng; i++) frame[i + 2] = datos[i];
+    unsigned short res = 0;
+    for (int i = 0; i < lng + 2; i++) {
+        for (int j = 0; j < 8; j++) res += (frame[i] >> j) & 0x01;
+    }
+    frame[lng + 2] = (res >> 8) & 0xFF;
+    frame[lng + 3] = res & 0xFF;
+    return lng + 4;
+}
+
+static bool paridadAnterior(const BYTE* frame, int largo) {
+    int unos = 0;
+    for (int j = 0; j < largo; j++) {
+        for (int i = 0; i < 8; i++) unos += (frame[j] >> i) & 0x01;
+    }
+    return unos % 2 != 0;
+}
+
+int escenarioProtocolo(int argc, char** argv) {
+    unsigned semilla = (argc > 0) ? (unsigned)atoi(argv[0]) : 1;
+    srand(semilla);
+
+    unsigned long frames = 0, distintos = 0, rechazados = 0;
+    unsigned long bits_cambiados = 0, no_detectados = 0;
+    g_hal_serial_silencio = true; // desempaquetar() imprime los FCS
+
+    for (int cmd = 0; cmd <= FrameEstandar::CMD_MAX; cmd++) {
+        for (int lng = 0; lng <= FrameEstandar::PAYLOAD_MAX; lng++) {
+            protocolo tx;
+            memset(&tx, 0, sizeof(protocolo));
+            tx.cmd = cmd;
+            tx.lng = lng;
+            for (int i = 0; i < lng; i++) tx.data[i] = (BYTE)rand();
+            int largo = empaquetar(tx);
+            frames++;
+
+            BYTE esperado[LARGO_DATA + BYTES_EXTRA];
+            int largo_esperado = codificarAnterior(esperado, cmd, tx.data, lng);
+            if (largo != largo_esperado || memcmp(esperado, tx.frame, largo) != 0) distintos++;
+
+            frameReceptor rx;
+            memcpy(rx.frame, tx.frame, largo);
+            rx.cmd = FrameEstandar::cmdDe(rx.frame);
+            rx.lng = FrameEstandar::lngDe(rx.frame);
+            if (rx.cmd != cmd || rx.lng != lng || !desempaquetar(rx) ||
+                memcmp(payload(rx), tx.data, lng) != 0) {
+                rechazados++;
+            }
+
+            // Con un bit invertido el conteo cambia en exactamente 1. Los
+            // bits de LNG se saltean: cambian dónde lee el FCS el receptor.
+            for (int b = 0; b < largo * 8; b++) {
+                BYTE copia[LARGO_DATA + BYTES_EXTRA];
+                memcpy(copia, tx.frame, largo);
+                copia[b / 8] ^= (BYTE)(1 << (b % 8));
+                if (FrameEstandar::lngDe(copia) != lng) continue;
+                bits_cambiados++;
+                if (FrameEstandar::fcsValido(copia, lng)) no_detectados++;
+            }
+        }
+    }
+    g_hal_serial_silencio = false;
+
+    unsigned long fijos_mal = 0;
+    for (size_t i = 0; i < sizeof(FIJOS) / sizeof(FIJOS[0]); i++) {
+        protocolo tx;
+        memset(&tx, 0, sizeof(protocolo));
+        tx.cmd = FIJOS[i].cmd;
+        int largo = empaquetar(tx);
+        if (largo != FIJOS[i].largo || memcmp(tx.frame, FIJOS[i].bytes, largo) != 0 ||
+            FIJOS[i].paridad != paridadAnterior(tx.frame, largo) ||
+            FIJOS[i].paridad != FrameEstandar::paridadDe(tx.frame, largo)) {
+            fijos_mal++;
+        }
+    }
+
+    printf("frameProtocolo.h: FrameEstandar (payload %d, cabecera %d, FCS %d bytes), semilla %u\n",
+           FrameEstandar::PAYLOAD_MAX, FrameEstandar::BYTES_CABECERA, FrameEstandar::BYTES_FCS, semilla);
+    printf("  Frames (CMD 0-%d x LNG 0-%d):   %lu\n", FrameEstandar::CMD_MAX, FrameEstandar::PAYLOAD_MAX, frames);
+    printf("  Distintos a la codificación anterior: %lu\n", distintos);
+    printf("  Rechazados por el receptor:       %lu\n", rechazados);
+    printf("  Bits invertidos no detectados:    %lu de %lu\n", no_detectados, bits_cambiados);
+    printf("  Frames fijos distintos:           %lu de %d\n", fijos_mal, (int)(sizeof(FIJOS) / sizeof(FIJOS[0])));
+
+    bool ok = distintos == 0 && rechazados == 0 && no_detectados == 0 && fijos_mal == 0;
+    printf("%s\n", ok ? "Formato OK." : "ERROR: frameProtocolo.h no coincide con el formato anterior.");
+    return ok ? 0 : 1;
+}
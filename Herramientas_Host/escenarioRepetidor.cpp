@@ -0,0 +1,345 @@
+/**
+ * @file escenarioRepetidor.cpp
+ * @brief Cadenas de receptores en modo repetidor (CMD 13): latencia por
+ * salto con cut-through y con store-and-forward, errores, saltos y lazos.
+ * @details El emisor escribe la primera línea con los empaquetar() y
+ * enviarFrame() reales. Cada repetidor (repetidor.cpp) lee la línea del
+ * anterior y escribe la siguiente (halUsarLineaSalida), un salto detrás
+ * del otro sobre el mismo reloj virtual. El último de la cadena es un
+ * receptor sin salida: la latencia va desde que el emisor empieza un frame
+ * hasta que el último termina de leerlo. Se verifica:
+ * - Latencia: con cut-through cada salto agrega más o menos el tiempo de
+ *   la cabecera del sobre; con store-and-forward, el del frame entero.
+ * - Errores: los frames que el emisor manda con un bit cambiado salen
+ *   envenenados y el último los descarta. Después de REP_UMBRAL_ERRORES el
+ *   primer repetidor pasa a store-and-forward y ya no los deja pasar;
+ *   vuelve al cut-through con REP_LIMPIOS_PARA_VOLVER frames buenos.
+ * - Saltos y lazos: un frame sin saltos no sigue; uno repetido (el mismo
+ *   origen y secuencia, como si volviera por un lazo) sale una sola vez;
+ *   una difusión la procesan todos y cada uno la reenvía una vez.
+ */
+
+#include "escenarios.h"
+#include "halHost.h"
+#include "recibe.h"
+#include "repetidor.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define PIN_SIMULADO 0
+#define LARGO_DATOS 20
+#define CMD_INTERNO 3              // El frame que va en el sobre: texto para el OLED
+#define FRAMES_LATENCIA 8
+#define PAUSA_BITS 3               // Entre frames del emisor: la separación mínima
+#define MARGEN_NS 3000000000LL     // Línea quieta después del último frame
+#define ALGORITMO_FCS NEG_FCS_CONTEO
+
+#define FRAMES_ERRORES 60
+#define SALTOS_ERRORES 3
+#define SALTOS_LAZOS 4
+
+typedef struct
+{
+    BYTE destino;
+    BYTE saltos;
+    BYTE secuencia;
+    bool corromper;                // Un bit de datos cambiado después del FCS
+} envioCadena;
+
+typedef struct
+{
+    int64_t inicio_ns;             // El emisor empieza el frame
+    int64_t llegada_ns;            // El último lo termina de leer (-1 = no llegó)
+} medicion;
+
+typedef struct
+{
+    std::vector<lineaVirtual> lineas;      // [0]: la del emisor; [k]: la salida del repetidor k
+    std::vector<repetidor> repetidores;    // Direcciones 1..n; el último tiene la n + 1
+    std::vector<medicion> frames;
+    repetidor ultimo;
+    unsigned long llegados;        // Válidos en el último
+    unsigned long fcs_malo;        // Llegaron al último con el FCS mal
+    unsigned long sin_sincronismo;
+    unsigned long distintos;       // Válidos, pero con otro contenido o repetidos
+} cadena;
+
+static void iniciarCadena(cadena& c, int repetidores) {
+    c.lineas.assign(repetidores + 1, lineaVirtual());
+    c.repetidores.assign(repetidores, repetidor());
+    c.frames.clear();
+    c.llegados = c.fcs_malo = c.sin_sincronismo = c.distintos = 0;
+}
+
+static void datosDe(size_t k, BYTE* datos) {
+    datos[0] = (BYTE)(k & 0xFF);
+    datos[1] = (BYTE)(k >> 8);
+    for (int i = 2; i < LARGO_DATOS; i++) datos[i] = (BYTE)('a' + (k + i) % 26);
+}
+
+/**
+ * El emisor: cada frame en su sobre, uno detrás del otro en la línea 0.
+ */
+static void emitir(cadena& c, const std::vector<envioCadena>& envios, int speed) {
+    lineaVirtual& l = c.lineas[0];
+    halUsarLinea(&l);
+    l.ahora_ns = 1000000;
+    for (size_t k = 0; k < envios.size(); k++) {
+        const envioCadena& e = envios[k];
+        BYTE datos[LARGO_DATOS];
+        datosDe(k, datos);
+        protocolo proto;
+        memset(&proto, 0, sizeof(proto));
+        proto.cmd = CMD_REENVIO;
+        proto.lng = (BYTE)reenvioEnvolver(proto.data, CMD_INTERNO, datos, LARGO_DATOS, e.destino, e.saltos,
+                                          REENVIO_ORIGEN_EMISOR, e.secuencia);
+        int largo = empaquetar(proto);
+        if (e.corromper) proto.frame[FrameEstandar::BYTES_CABECERA + REENVIO_SOBRE + 5] ^= 0x10;
+
+        medicion m = {l.ahora_ns, -1};
+        c.frames.push_back(m);
+        enviarFrame(PIN_SIMULADO, speed, proto, largo, FORMATO_LINEA_ESTANDAR);
+        delay((PAUSA_BITS + 1) * (1000 / speed)); // +1: el stop final, que enviarFrame() no espera
+    }
+    l.fin_ns = l.ahora_ns + MARGEN_NS;
+    halUsarLinea(NULL);
+}
+
+/**
+ * El repetidor 'k' (1..n) sobre toda la línea del anterior.
+ */
+static void correrRepetidor(cadena& c, int k, int speed, bool solo_almacenar) {
+    lineaVirtual& entrada = c.lineas[k - 1];
+    lineaVirtual& salida = c.lineas[k];
+    repetidor& r = c.repetidores[k - 1];
+    repetidorIniciar(r, k, PIN_SIMULADO);
+    r.solo_almacenar = solo_almacenar;
+
+    frameReceptor proto;
+    halUsarLinea(&entrada);
+    halUsarLineaSalida(&salida);
+    entrada.ahora_ns = 0;
+    try {
+        for (;;) {
+            repetidorEsperarInicio(r, PIN_SIMULADO);
+            resultadoRepetidor res = repetidorRecibir(r, PIN_SIMULADO, speed, proto, FORMATO_RECEPCION, ALGORITMO_FCS);
+            if (res == REP_ERROR) {
+                repetidorLimpiarRX(r, PIN_SIMULADO);
+            } else if (res == REP_LOCAL && desempaquetar(proto, ALGORITMO_FCS)) {
+                repetidorDesenvolver(r, proto); // Las difusiones y lo que es para él
+            }
+        }
+    } catch (const finDeLinea&) {
+    }
+    repetidorVaciar(r);
+    salida.fin_ns = entrada.ahora_ns + MARGEN_NS;
+    halUsarLineaSalida(NULL);
+    halUsarLinea(NULL);
+}
+
+/**
+ * El último de la cadena: recibe, verifica el contenido y anota la llegada.
+ */
+static void correrUltimo(cadena& c, int speed) {
+    int n = (int)c.repetidores.size();
+    lineaVirtual& entrada = c.lineas[n];
+    repetidorIniciar(c.ultimo, n + 1, -1);
+
+    frameReceptor proto;
+    halUsarLinea(&entrada);
+    entrada.ahora_ns = 0;
+    try {
+        for (;;) {
+            repetidorEsperarInicio(c.ultimo, PIN_SIMULADO);
+            resultadoRepetidor res =
+                repetidorRecibir(c.ultimo, PIN_SIMULADO, speed, proto, FORMATO_RECEPCION, ALGORITMO_FCS);
+            int64_t fin_ns = entrada.ahora_ns;
+            if (res == REP_ERROR) {
+                c.sin_sincronismo++;
+                repetidorLimpiarRX(c.ultimo, PIN_SIMULADO);
+                continue;
+            }
+            if (res != REP_LOCAL) continue;
+            if (!desempaquetar(proto, ALGORITMO_FCS)) {
+                c.fcs_malo++;
+                continue;
+            }
+            if (!repetidorDesenvolver(c.ultimo, proto)) continue;
+
+            const BYTE* d = payload(proto);
+            size_t k = d[0] | (d[1] << 8);
+            BYTE esperado[LARGO_DATOS];
+            datosDe(k, esperado);
+            if (k >= c.frames.size() || c.frames[k].llegada_ns >= 0 || proto.cmd != CMD_INTERNO ||
+                proto.lng != LARGO_DATOS || memcmp(d, esperado, LARGO_DATOS) != 0) {
+                c.distintos++;
+                continue;
+            }
+            c.frames[k].llegada_ns = fin_ns;
+            c.llegados++;
+        }
+    } catch (const finDeLinea&) {
+    }
+    halUsarLinea(NULL);
+}
+
+static void correrCadena(cadena& c, const std::vector<envioCadena>& envios, int speed, bool solo_almacenar) {
+    emitir(c, envios, speed);
+    for (int k = 1; k <= (int)c.repetidores.size(); k++) {
+        correrRepetidor(c, k, speed, solo_almacenar);
+    }
+    correrUltimo(c, speed);
+}
+
+// --- 1. Latencia por salto ---
+
+/**
+ * Latencia media (ms) de FRAMES_LATENCIA frames a través de 'saltos'
+ * repetidores, o -1 si alguno no llegó.
+ */
+static double latenciaCadena(int saltos, int speed, bool solo_almacenar) {
+    cadena c;
+    iniciarCadena(c, saltos);
+    std::vector<envioCadena> envios;
+    for (int k = 0; k < FRAMES_LATENCIA; k++) {
+        envioCadena e = {(BYTE)(saltos + 1), (BYTE)saltos, (BYTE)k, false};
+        envios.push_back(e);
+    }
+    correrCadena(c, envios, speed, solo_almacenar);
+    if (c.llegados != FRAMES_LATENCIA || c.distintos != 0) return -1;
+    double total = 0;
+    for (size_t k = 0; k < c.frames.size(); k++) total += c.frames[k].llegada_ns - c.frames[k].inicio_ns;
+    return total / c.frames.size() / 1e6;
+}
+
+static bool medirLatencias(int speed, int maximo) {
+    int p = FORMATO_LINEA_ESTANDAR.bits_parada;
+    int largo = FrameEstandar::largo(LARGO_DATOS + REENVIO_SOBRE);
+    double bit_ms = 1000.0 / speed;
+    double cabecera_ms = REENVIO_CABECERA * (9 + p) * bit_ms;
+    double frame_ms = BITS_FRAME(largo, p) * bit_ms;
+
+    printf("Latencia: frames de %d bytes (%.0f ms), cabecera del sobre de %d bytes (%.0f ms), %d bps\n",
+           largo, frame_ms, REENVIO_CABECERA, cabecera_ms, speed);
+    double directo = latenciaCadena(0, speed, false);
+    printf("  Sin repetidores: %.0f ms\n", directo);
+    printf("  Saltos | Cut-through ms | por salto | Store-and-forward ms | por salto\n");
+    bool ok = directo > 0;
+    double peor_ct = 0, mejor_sf = 1e18;
+    for (int saltos = 2; saltos <= maximo; saltos++) {
+        double ct = latenciaCadena(saltos, speed, false);
+        double sf = latenciaCadena(saltos, speed, true);
+        if (ct < 0 || sf < 0) {
+            printf("  %6d | no llegaron todos los frames\n", saltos);
+            ok = false;
+            continue;
+        }
+        double por_ct = (ct - directo) / saltos;
+        double por_sf = (sf - directo) / saltos;
+        if (por_ct > peor_ct) peor_ct = por_ct;
+        if (por_sf < mejor_sf) mejor_sf = por_sf;
+        printf("  %6d | %14.0f | %9.0f | %20.0f | %9.0f\n", saltos, ct, por_ct, sf, por_sf);
+    }
+    // Cut-through: la cabecera más el reposo. Store-and-forward: el frame
+    // entero, menos el medio stop final que falta cuando el repetidor lo vota
+    bool ok_ct = peor_ct <= cabecera_ms + (PAUSA_BITS + 1) * bit_ms;
+    bool ok_sf = mejor_sf >= frame_ms - bit_ms;
+    printf("  Cut-through: hasta %.0f ms por salto (cabecera: %.0f ms): %s\n", peor_ct, cabecera_ms,
+           ok_ct ? "sí" : "NO");
+    printf("  Store-and-forward: al menos %.0f ms por salto (frame: %.0f ms): %s\n", mejor_sf, frame_ms,
+           ok_sf ? "sí" : "NO");
+    return ok && ok_ct && ok_sf;
+}
+
+// --- 2. Errores ---
+
+static void imprimirRepetidores(const cadena& c) {
+    for (size_t i = 0; i < c.repetidores.size(); i++) {
+        const repetidor& r = c.repetidores[i];
+        printf("  Repetidor %zu: %lu cut-through, %lu store-and-forward, %lu envenenados, "
+               "%lu pasos a store-and-forward, ahora %s\n",
+               i + 1, r.cut_through, r.almacenados, r.envenenados, r.cambios_a_almacenar,
+               r.almacenar ? "store-and-forward" : "cut-through");
+    }
+}
+
+static bool probarErrores(int speed) {
+    // Tres malos seguidos pasan a store-and-forward; los dos siguientes ya no pasan
+    static const int MALOS[] = {10, 12, 14, 16, 18};
+    int num_malos = sizeof(MALOS) / sizeof(MALOS[0]);
+    cadena c;
+    iniciarCadena(c, SALTOS_ERRORES);
+    std::vector<envioCadena> envios;
+    for (int k = 0; k < FRAMES_ERRORES; k++) {
+        envioCadena e = {SALTOS_ERRORES + 1, SALTOS_ERRORES, (BYTE)k, false};
+        for (int i = 0; i < num_malos; i++) e.corromper = e.corromper || MALOS[i] == k;
+        envios.push_back(e);
+    }
+    correrCadena(c, envios, speed, false);
+
+    printf("\nErrores: %d frames por %d repetidores, %d con un bit cambiado\n", FRAMES_ERRORES, SALTOS_ERRORES,
+           num_malos);
+    imprimirRepetidores(c);
+    printf("  Último: %lu válidos, %lu con el FCS mal, %lu sin sincronismo, %lu distintos\n", c.llegados,
+           c.fcs_malo, c.sin_sincronismo, c.distintos);
+    const repetidor& primero = c.repetidores[0];
+    bool ok = c.llegados == (unsigned long)(FRAMES_ERRORES - num_malos) && c.distintos == 0 &&
+              c.fcs_malo == REP_UMBRAL_ERRORES && primero.envenenados == REP_UMBRAL_ERRORES &&
+              primero.cambios_a_almacenar == 1 && !primero.almacenar;
+    printf("  Ningún frame malo ejecutado, store-and-forward tras %d errores y vuelta al cut-through: %s\n",
+           REP_UMBRAL_ERRORES, ok ? "sí" : "NO");
+    return ok;
+}
+
+// --- 3. Saltos y lazos ---
+
+static bool probarSaltosYLazos(int speed) {
+    cadena c;
+    iniciarCadena(c, SALTOS_LAZOS);
+    BYTE ultimo = SALTOS_LAZOS + 1;
+    std::vector<envioCadena> envios;
+    envioCadena corto = {ultimo, 2, 1, false};          // Muere en el repetidor 3
+    envioCadena pedido = {ultimo, SALTOS_LAZOS, 2, false};
+    envioCadena vuelta = pedido;                        // Mismo origen y secuencia: un lazo
+    envioCadena al_segundo = {2, SALTOS_LAZOS, 3, false};
+    envioCadena difusion = {REENVIO_DIFUSION, SALTOS_LAZOS, 4, false};
+    envios.push_back(corto);
+    envios.push_back(pedido);
+    envios.push_back(vuelta);
+    envios.push_back(al_segundo);
+    envios.push_back(difusion);
+    correrCadena(c, envios, speed, false);
+
+    printf("\nSaltos y lazos: %d repetidores\n", SALTOS_LAZOS);
+    bool ok = c.llegados == 2 && c.distintos == 0 && c.frames[1].llegada_ns >= 0 && c.frames[4].llegada_ns >= 0;
+    for (size_t i = 0; i < c.repetidores.size(); i++) {
+        const repetidor& r = c.repetidores[i];
+        printf("  Repetidor %zu: %lu locales, %lu reenviados, %lu sin saltos, %lu repetidos\n", i + 1, r.locales,
+               r.cut_through + r.almacenados, r.sin_saltos, r.repetidos);
+    }
+    printf("  Último: %lu frames (el pedido y la difusión)\n", c.llegados);
+    const std::vector<repetidor>& r = c.repetidores;
+    ok = ok && r[2].sin_saltos == 1 && r[0].repetidos == 1 && r[1].locales == 2 && r[0].locales == 1 &&
+         r[2].locales == 1 && r[3].locales == 1 && c.ultimo.locales == 2;
+    printf("  Sin saltos no sigue, el repetido sale una vez, la difusión llega a todos: %s\n", ok ? "sí" : "NO");
+    return ok;
+}
+
+int escenarioRepetidor(int argc, char** argv) {
+    int speed = (argc > 0) ? atoi(argv[0]) : 100;
+    int maximo = (argc > 1) ? atoi(argv[1]) : 10;
+    if (speed <= 0 || 1000 % speed != 0 || maximo < 2) {
+        printf("Uso: ./simulador repetidor [bps, 1000/bps entero] [saltos máximos >= 2]\n");
+        return 1;
+    }
+    g_hal_serial_silencio = true;
+    bool ok = medirLatencias(speed, maximo);
+    ok = probarErrores(speed) && ok;
+    ok = probarSaltosYLazos(speed) && ok;
+    g_hal_serial_silencio = false;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,336 @@
+/**
+ * @file escenarioRpc.cpp
+ * @brief Pedidos RPC (CMD 12) en vuelo vs pedido y espera, sobre un enlace dúplex.
+ * @details Corre rpcEmisor.cpp y rpcReceptor.cpp con los enviarFrame(),
+ * recibirFrame(), enviarFrameRetorno() y recibirRetorno() reales sobre dos
+ * líneas virtuales a SPEED bps: la de ida (pedidos) y la de retorno
+ * (respuestas). El receptor atiende cada pedido apenas termina de llegar
+ * y responde por el retorno, una respuesta detrás de otra. El escenario
+ * hace de hilo lector: lee el retorno con su propio reloj y entrega cada
+ * frame a rpcProcesarRetorno().
+ *
+ * Los métodos del receptor simulado responden con el mismo largo que los
+ * de la ESP32, pero sus datos empiezan con el número de pedido y el método:
+ * así se comprueba que cada futuro recibe la respuesta de SU pedido. Con
+ * pérdidas, algunos pedidos o respuestas llegan con un bit cambiado (el
+ * FCS los descarta) y esos futuros tienen que vencer con RPC_SIN_RESPUESTA.
+ */
+
+#include "escenarios.h"
+#include "halHost.h"
+#include "recibe.h"
+#include "retorno.h"
+#include "rpcReceptor.h"
+#include "rpcEmisor.h"
+#include "funcionesProtocolo.h"
+#include "recibeRetorno.h"
+#include "velocidadAdaptativa.h"
+#include "Arduino.h"
+#include <stdlib.h>
+#include <deque>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#define PIN_SIMULADO 0
+#define ATENCION_NS 2000000LL           // La tarea de comandos tarda 2 ms en atender
+#define MARGEN_RECEPTOR_NS 150000000LL  // Línea quieta asegurada tras cada frame
+#define MARGEN_RECEPTOR_BITS 3           // El receptor muestrea hasta medio bit más tarde
+#define NS_POR_S 1000000000LL
+#define METODO_INEXISTENTE 9            // Cada tanto se pide uno que no existe
+#define CADA_INEXISTENTE 16
+#define REPOSO_INICIAL_NS NS_POR_S
+#define MARGEN_FIN_NS (MARGEN_RECEPTOR_NS + MARGEN_RECEPTOR_BITS * (NS_POR_S / SPEED))
+
+// Bytes de datos de cada método, los mismos que arma funcionesReceptor.cpp
+// (RPC_ETAPAS con la respuesta llena: dos registros)
+static const int LARGO_METODO[RPC_NUM_METODOS] = {36, 8, 9, 59};
+
+/**
+ * Estado de la simulación: las dos líneas, el reloj de cada actor y las pérdidas.
+ */
+typedef struct
+{
+    lineaVirtual ida;
+    lineaVirtual vuelta;
+    int64_t reloj_emisor;     // Dónde termina lo que el emisor escribió en la ida
+    int64_t reloj_receptor;   // Hasta dónde leyó el receptor la ida
+    int64_t retorno_libre;    // Cuándo termina la última respuesta en el retorno
+    int64_t reloj_lector;     // Hasta dónde leyó el hilo lector el retorno
+    servidorRpc servidor;
+    std::mt19937 rng;
+    double perdida;           // Probabilidad de cambiar un bit de cada frame
+    unsigned long pedidos_danados;
+    unsigned long respuestas_danadas;
+} simulacion;
+
+static simulacion* s_sim = NULL;
+
+/**
+ * Cambia un bit del payload (el FCS del otro lado lo rechaza).
+ */
+static bool danar(BYTE* frame, int lng) {
+    simulacion& s = *s_sim;
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(s.rng) >= s.perdida) return false;
+    int byte = FrameEstandar::BYTES_CABECERA + (int)(s.rng() % lng);
+    frame[byte] ^= (BYTE)(1 << (s.rng() % 8));
+    return true;
+}
+
+// --- Métodos del receptor simulado: [número de pedido][método][relleno] ---
+
+static int metodoSimulado(int metodo, const BYTE* args, int lng, BYTE* datos) {
+    if (lng != 2) return -1;
+    memset(datos, 0, LARGO_METODO[metodo]);
+    datos[0] = args[0];
+    datos[1] = args[1];
+    datos[2] = (BYTE)metodo;
+    return LARGO_METODO[metodo];
+}
+
+static int simuladoEstadisticas(const BYTE* args, int lng, BYTE* datos) {
+    return metodoSimulado(RPC_ESTADISTICAS, args, lng, datos);
+}
+
+static int simuladoConfiguracion(const BYTE* args, int lng, BYTE* datos) {
+    return metodoSimulado(RPC_CONFIGURACION, args, lng, datos);
+}
+
+static int simuladoSalud(const BYTE* args, int lng, BYTE* datos) {
+    return metodoSimulado(RPC_SALUD, args, lng, datos);
+}
+
+static int simuladoEtapas(const BYTE* args, int lng, BYTE* datos) {
+    return metodoSimulado(RPC_ETAPAS, args, lng, datos);
+}
+
+/**
+ * Tarea de recepción + tarea de comandos del receptor sobre lo que el
+ * emisor ya escribió. Cada respuesta sale por el retorno cuando la
+ * anterior terminó.
+ */
+static void avanzarReceptor() {
+    simulacion& s = *s_sim;
+    halUsarLinea(&s.ida);
+    s.ida.jitter_medio_ns = 0;
+
+    try {
+        for (;;) {
+            s.ida.ahora_ns = s.reloj_receptor;
+            while (digitalRead(RX_PIN) == HIGH);
+            frameReceptor rx;
+            bool sincronizado = recibirFrame(RX_PIN, SPEED, rx);
+            s.reloj_receptor = s.ida.ahora_ns;
+            if (!sincronizado || !desempaquetar(rx) || rx.cmd != CMD_RPC) continue;
+
+            frameReceptor respuesta;
+            if (!rpcProcesar(s.servidor, rx, respuesta)) continue;
+
+            halUsarLinea(&s.vuelta);
+            s.vuelta.ahora_ns = std::max<int64_t>(s.retorno_libre, s.reloj_receptor + ATENCION_NS);
+            int largo = empaquetarRetorno(respuesta);
+            if (danar(respuesta.frame, respuesta.lng)) s.respuestas_danadas++;
+            enviarFrameRetorno(TX_RETORNO_PIN, SPEED, respuesta, largo);
+            delay(RPC_SEPARACION_BITS * 1000 / SPEED);
+            s.retorno_libre = s.vuelta.ahora_ns;
+            s.vuelta.fin_ns = s.retorno_libre + MARGEN_FIN_NS;
+            halUsarLinea(&s.ida);
+        }
+    } catch (const finDeLinea&) {
+        // Se leyó todo lo escrito hasta ahora
+    }
+}
+
+/**
+ * Lo que rpcLlamar() usa para transmitir: escribe el pedido en la ida
+ * desde el reloj del emisor y deja avanzar al receptor.
+ */
+static void enviarPedidoSimulado(protocolo& pedido) {
+    simulacion& s = *s_sim;
+    int largo = empaquetar(pedido);
+    if (danar(pedido.frame, pedido.lng)) s.pedidos_danados++;
+
+    halUsarLinea(&s.ida);
+    s.ida.ahora_ns = s.reloj_emisor;
+    enviarFrame(PIN_SIMULADO, SPEED, pedido, largo);
+    delay(RPC_SEPARACION_BITS * 1000 / SPEED); // Como enviarPedidoRpc() del menú
+    s.reloj_emisor = s.ida.ahora_ns;
+    s.ida.fin_ns = s.reloj_emisor + MARGEN_FIN_NS;
+
+    avanzarReceptor();
+}
+
+/**
+ * Un paso del hilo lector: espera un frame del retorno (o RPC_ESPERA_LECTOR_MS)
+ * y vence los plazos. Solo lee lo que ya está escrito: el emisor no
+ * vuelve a escribir hasta que el lector lo alcance.
+ */
+static void pasoLector() {
+    simulacion& s = *s_sim;
+    halUsarLinea(&s.vuelta);
+    s.vuelta.ahora_ns = s.reloj_lector;
+    s.vuelta.fin_ns = std::max<int64_t>(s.vuelta.fin_ns, s.reloj_lector + RPC_ESPERA_LECTOR_MS * 2000000LL);
+    protocolo frame;
+    bool ok = recibirRetorno(PIN_SIMULADO, SPEED, frame, RPC_ESPERA_LECTOR_MS);
+    if (ok && frame.cmd == CMD_RPC) {
+        rpcProcesarRetorno(frame);
+    }
+    rpcVencer(millis());
+    s.reloj_lector = s.vuelta.ahora_ns;
+}
+
+typedef struct
+{
+    int numero;
+    int metodo;
+    std::future<respuestaRpc> futuro;
+} pedidoPendiente;
+
+typedef struct
+{
+    unsigned long respondidos;
+    unsigned long sin_respuesta;
+    unsigned long rechazados;     // Método desconocido (pedido a propósito)
+    unsigned long incorrectos;    // Respuesta de otro pedido o estado inesperado
+    double total_s;
+    double ida_y_vuelta_s;        // Promedio de los respondidos
+    int max_en_vuelo;
+} resultadoRpc;
+
+/**
+ * Revisa una respuesta contra su pedido.
+ */
+static void revisar(const pedidoPendiente& p, const respuestaRpc& r, resultadoRpc& res) {
+    if (r.estado == RPC_SIN_RESPUESTA) {
+        res.sin_respuesta++;
+        return;
+    }
+    if (p.metodo >= RPC_NUM_METODOS) {
+        if (r.estado == RPC_METODO_DESCONOCIDO && r.lng == 0) res.rechazados++;
+        else res.incorrectos++;
+        return;
+    }
+    bool propia = (r.estado == RPC_OK && r.lng == LARGO_METODO[p.metodo] &&
+                   r.datos[0] == (BYTE)(p.numero >> 8) && r.datos[1] == (BYTE)p.numero &&
+                   r.datos[2] == p.metodo);
+    if (!propia) {
+        res.incorrectos++;
+        return;
+    }
+    res.respondidos++;
+    res.ida_y_vuelta_s += r.ida_y_vuelta_ms / 1000.0;
+}
+
+/**
+ * Una corrida: 'pedidos' llamadas con hasta 'en_vuelo' sin respuesta a la vez.
+ */
+static void correr(simulacion& s, int pedidos, int en_vuelo, double perdida, unsigned semilla,
+                   resultadoRpc& res) {
+    s.ida = lineaVirtual();
+    s.vuelta = lineaVirtual();
+    s.reloj_receptor = s.retorno_libre = s.reloj_lector = 0;
+    s.reloj_emisor = REPOSO_INICIAL_NS; // Un flanco en t = 0 no se ve como bajada
+    s.rng.seed(semilla);
+    s.perdida = perdida;
+    s.pedidos_danados = s.respuestas_danadas = 0;
+    rpcIniciar(s.servidor);
+    rpcRegistrar(s.servidor, RPC_ESTADISTICAS, simuladoEstadisticas);
+    rpcRegistrar(s.servidor, RPC_CONFIGURACION, simuladoConfiguracion);
+    rpcRegistrar(s.servidor, RPC_SALUD, simuladoSalud);
+    rpcRegistrar(s.servidor, RPC_ETAPAS, simuladoEtapas);
+
+    g_velocidad = SPEED;
+    rpcIniciar(enviarPedidoSimulado);
+    memset(&res, 0, sizeof(res));
+
+    std::deque<pedidoPendiente> pendientes;
+    int siguiente = 0;
+    while (siguiente < pedidos || !pendientes.empty()) {
+        if (siguiente < pedidos && (int)pendientes.size() < en_vuelo) {
+            pedidoPendiente p;
+            p.numero = siguiente++;
+            p.metodo = (p.numero % CADA_INEXISTENTE == CADA_INEXISTENTE - 1)
+                           ? METODO_INEXISTENTE : p.numero % RPC_NUM_METODOS;
+            BYTE args[2] = {(BYTE)(p.numero >> 8), (BYTE)p.numero};
+
+            halUsarLinea(&s.ida); // millis() de rpcLlamar() es el reloj del emisor
+            s.ida.ahora_ns = s.reloj_emisor;
+            p.futuro = rpcLlamar((BYTE)p.metodo, args, sizeof(args));
+            pendientes.push_back(std::move(p));
+            res.max_en_vuelo = std::max(res.max_en_vuelo, (int)pendientes.size());
+            continue;
+        }
+
+        pasoLector();
+        // El emisor esperaba lugar: sigue desde donde llegó el lector
+        s.reloj_emisor = std::max(s.reloj_emisor, s.reloj_lector);
+        for (size_t i = 0; i < pendientes.size();) {
+            if (pendientes[i].futuro.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                i++;
+                continue;
+            }
+            revisar(pendientes[i], pendientes[i].futuro.get(), res);
+            pendientes.erase(pendientes.begin() + i);
+        }
+    }
+    halUsarLinea(NULL);
+
+    res.total_s = std::max(s.reloj_emisor, s.reloj_lector) / 1e9;
+    if (res.respondidos) res.ida_y_vuelta_s /= res.respondidos;
+}
+
+static void imprimir(const char* nombre, const resultadoRpc& r, int pedidos) {
+    printf("  %-30s %9.0f %10.1f %8.1f %6lu %6lu %6lu %6lu %6d\n", nombre, r.total_s,
+           pedidos * 60.0 / r.total_s, r.ida_y_vuelta_s, r.respondidos, r.rechazados,
+           r.sin_respuesta, r.incorrectos, r.max_en_vuelo);
+}
+
+int escenarioRpc(int argc, char** argv) {
+    int pedidos = (argc > 0) ? atoi(argv[0]) : 96;
+    double perdida_pct = (argc > 1) ? atof(argv[1]) : 5.0;
+    unsigned semilla = (argc > 2) ? (unsigned)atoi(argv[2]) : 1;
+    if (pedidos <= 0 || pedidos > 65535 || perdida_pct < 0 || perdida_pct >= 100) {
+        printf("Uso: ./simulador rpc [pedidos] [%% de frames dañados] [semilla]\n");
+        return 1;
+    }
+
+    simulacion sim;
+    s_sim = &sim;
+    g_hal_serial_silencio = true;
+
+    printf("%d pedidos a %d bps (estadísticas, configuración, salud y etapas; 1 de cada %d a un método inexistente)\n",
+           pedidos, SPEED, CADA_INEXISTENTE);
+    printf("\n  %-29s %9s %10s %8s %6s %6s %6s %6s %6s\n", "variante", "total s", "pedidos/min",
+           "i+v s", "ok", "desc.", "venc.", "mal", "vuelo");
+
+    const double PERDIDAS[] = {0.0, perdida_pct / 100.0};
+    const int VENTANAS[] = {1, RPC_EN_VUELO};
+    resultadoRpc r[2][2];
+    bool correcto = true;
+    for (int p = 0; p < 2; p++) {
+        if (p == 1 && perdida_pct == 0) break;
+        for (int v = 0; v < 2; v++) {
+            correr(sim, pedidos, VENTANAS[v], PERDIDAS[p], semilla, r[p][v]);
+            char nombre[64];
+            snprintf(nombre, sizeof(nombre), "%s, %.0f%% dañados",
+                     v == 0 ? "pedido y espera" : "en vuelo", PERDIDAS[p] * 100);
+            imprimir(nombre, r[p][v], pedidos);
+
+            const resultadoRpc& x = r[p][v];
+            unsigned long completados = x.respondidos + x.rechazados + x.sin_respuesta + x.incorrectos;
+            unsigned long danados = sim.pedidos_danados + sim.respuestas_danadas;
+            // Cada frame dañado deja exactamente un pedido sin respuesta (si se
+            // dañaron el pedido y su respuesta no, porque el pedido no se contesta)
+            if (x.incorrectos > 0 || completados != (unsigned long)pedidos ||
+                x.sin_respuesta > danados || (danados == 0 && x.sin_respuesta > 0)) {
+                correcto = false;
+            }
+        }
+    }
+    g_hal_serial_silencio = false;
+
+    printf("\n  En vuelo (hasta %d pedidos): %.1fx los pedidos por minuto de pedido y espera\n",
+           RPC_EN_VUELO, r[0][0].total_s / r[0][1].total_s);
+    printf("  Cada futuro recibió la respuesta de su pedido o venció: %s\n", correcto ? "sí" : "NO");
+    return correcto ? 0 : 1;
+}
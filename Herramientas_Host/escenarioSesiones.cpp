@@ -0,0 +1,352 @@
+/**
+ * @file escenarioSesiones.cpp
+ * @brief Sesiones sin pila (sesionesEmisor.cpp): costo de cambiar de
+ * sesión y cuántas conversaciones entran en un solo hilo.
+ * @details Se mide:
+ * - Una reanudación (SESION_CEDER) contra un cambio entre dos hilos que se
+ *   pasan el turno con una condition_variable (lo que costaría un hilo
+ *   por conversación), y la memoria de una sesión contra la pila de un hilo.
+ * - Conversaciones "enviar, esperar el acuse, reintentar" repartidas en
+ *   ME_MAX_ENLACES enlaces con un reloj virtual: los receptores simulados
+ *   pierden algunos pedidos y acusan los demás unos ms después de que el
+ *   frame termina. Se verifica que cada intercambio termine acusado o con
+ *   todos sus intentos vencidos, y que ningún acuse quede sin su sesión.
+ * - La opción 14 del emisor (sesionPruebaEnlace) con el bucle leyendo una
+ *   línea de retorno virtual (sesionesEsperarRetorno): el receptor del
+ *   enlace SES_ENLACE_RETORNO pierde la primera CONSULTA y contesta la
+ *   siguiente con el REPORTE de controlEnlace.cpp.
+ */
+
+#include "escenarios.h"
+#include "halHost.h"
+#include "controlEnlace.h"
+#include "retorno.h"
+#include "sesionesEmisor.h"
+#include "multiEnlace.h"
+#include "velocidadAdaptativa.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+
+#define CESIONES 10000000
+#define SESIONES_CEDIENDO 10000
+#define IDAS_Y_VUELTAS 200000
+
+#define INTERCAMBIOS 5
+#define INTENTOS 3
+#define ACUSE_MS 5          // Del fin del frame al acuse
+#define ESPERA_ACUSE_MS 50
+#define PERDIDA_PORCENTAJE 10
+
+#define PRUEBA_ENLACES 4
+#define PRUEBA_MENSAJES 10
+#define CONSULTAS_PERDIDAS 1   // El receptor no ve la primera CONSULTA
+#define ATENCION_MS 1          // Del fin de la CONSULTA al REPORTE
+
+static bucleSesiones s_bucle;
+
+static uint64_t ahoraNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// --- Costo de un cambio ---
+
+static int cediendo(sesion& s) {
+    long& restantes = *(long*)s.datos;
+    SESION_INICIO(s);
+    while (--restantes > 0) {
+        SESION_CEDER(s);
+    }
+    SESION_FIN(s);
+}
+
+/**
+ * ns por reanudación con 'n' sesiones que ceden en ronda.
+ */
+static double medirCesiones(int n, long por_sesion) {
+    std::vector<sesion> sesiones(n);
+    std::vector<long> restantes(n, por_sesion);
+    sesionesIniciar(s_bucle, sesionesRelojMs, NULL);
+    for (int i = 0; i < n; i++) sesionIniciar(s_bucle, sesiones[i], cediendo, &restantes[i], 0);
+    uint64_t t0 = ahoraNs();
+    sesionesCorrer(s_bucle);
+    return (double)(ahoraNs() - t0) / s_bucle.contadores.reanudaciones;
+}
+
+/**
+ * ns por cambio entre dos hilos que se pasan el turno.
+ */
+static double medirHilos() {
+    std::mutex m;
+    std::condition_variable cv;
+    int turno = 0;
+    std::thread otro([&] {
+        for (int i = 0; i < IDAS_Y_VUELTAS; i++) {
+            std::unique_lock<std::mutex> bloqueo(m);
+            while (turno != 1) cv.wait(bloqueo);
+            turno = 0;
+            cv.notify_one();
+        }
+    });
+    uint64_t t0 = ahoraNs();
+    for (int i = 0; i < IDAS_Y_VUELTAS; i++) {
+        std::unique_lock<std::mutex> bloqueo(m);
+        turno = 1;
+        cv.notify_one();
+        while (turno != 0) cv.wait(bloqueo);
+    }
+    uint64_t t1 = ahoraNs();
+    otro.join();
+    return (double)(t1 - t0) / (2.0 * IDAS_Y_VUELTAS);
+}
+
+// --- Conversaciones con reloj virtual ---
+
+typedef struct
+{
+    uint32_t id;
+    int intercambio;
+    int intento;
+    protocolo pedido;
+} conversacion;
+
+typedef struct
+{
+    uint64_t t_ms;
+    int enlace;
+    uint32_t clave;
+} acusePendiente;
+
+struct masTarde
+{
+    bool operator()(const acusePendiente& a, const acusePendiente& b) const { return a.t_ms > b.t_ms; }
+};
+
+static uint64_t s_virtual_ms;
+static std::priority_queue<acusePendiente, std::vector<acusePendiente>, masTarde> s_acuses;
+static uint32_t s_azar;
+static unsigned long s_vencidos;
+static unsigned long s_fallidos;
+static unsigned long s_acusados;
+
+static uint64_t relojVirtual() {
+    return s_virtual_ms;
+}
+
+static uint32_t claveDe(uint32_t id, int intercambio) {
+    return (id << 3) | (intercambio & 7);
+}
+
+/**
+ * El receptor simulado: pierde algunos pedidos y acusa los demás.
+ */
+static void enviarSimulado(int enlace, const protocolo& proto, int largo) {
+    s_azar = s_azar * 1103515245u + 12345u;
+    if ((s_azar >> 16) % 100 < PERDIDA_PORCENTAJE) return;
+    const BYTE* d = proto.frame + FrameEstandar::BYTES_CABECERA;
+    uint32_t id = d[0] | (d[1] << 8) | (d[2] << 16);
+    acusePendiente a;
+    a.t_ms = s_virtual_ms + sesionesDuracionMs(s_bucle.enlaces[enlace], largo) + ACUSE_MS;
+    a.enlace = enlace;
+    a.clave = claveDe(id, d[3]);
+    s_acuses.push(a);
+}
+
+/**
+ * Sin sesiones listas: el reloj salta al próximo acuse o al próximo vencimiento.
+ */
+static void esperarVirtual(bucleSesiones& b, uint64_t hasta_ms) {
+    if (!s_acuses.empty() && s_acuses.top().t_ms <= hasta_ms) {
+        if (s_acuses.top().t_ms > s_virtual_ms) s_virtual_ms = s_acuses.top().t_ms;
+        protocolo acuse;
+        memset(&acuse, 0, sizeof(acuse));
+        while (!s_acuses.empty() && s_acuses.top().t_ms <= s_virtual_ms) {
+            sesionesEntregar(b, s_acuses.top().enlace, s_acuses.top().clave, acuse);
+            s_acuses.pop();
+        }
+        return;
+    }
+    if (hasta_ms > s_virtual_ms) s_virtual_ms = hasta_ms;
+}
+
+static int conversar(sesion& s) {
+    conversacion& c = *(conversacion*)s.datos;
+    SESION_INICIO(s);
+    for (c.intercambio = 0; c.intercambio < INTERCAMBIOS; c.intercambio++) {
+        c.pedido.cmd = 1;
+        c.pedido.lng = 4;
+        c.pedido.data[0] = c.id & 0xFF;
+        c.pedido.data[1] = (c.id >> 8) & 0xFF;
+        c.pedido.data[2] = (c.id >> 16) & 0xFF;
+        c.pedido.data[3] = (BYTE)c.intercambio;
+        for (c.intento = 0; c.intento < INTENTOS; c.intento++) {
+            SESION_ENVIAR(s, c.pedido);
+            SESION_RECIBIR(s, claveDe(c.id, c.intercambio), ESPERA_ACUSE_MS);
+            if (s.recibio) break;
+            s_vencidos++;
+        }
+        if (s.recibio) s_acusados++;
+        else s_fallidos++;
+    }
+    SESION_FIN(s);
+}
+
+static bool correrConversaciones(int n, int speed) {
+    std::vector<sesion> sesiones(n);
+    std::vector<conversacion> conversaciones(n);
+    s_virtual_ms = 0;
+    s_azar = 12345;
+    s_vencidos = s_fallidos = s_acusados = 0;
+    while (!s_acuses.empty()) s_acuses.pop();
+
+    sesionesIniciar(s_bucle, relojVirtual, esperarVirtual);
+    for (int e = 0; e < ME_MAX_ENLACES; e++) {
+        sesionesAgregarEnlace(s_bucle, enviarSimulado, speed, FORMATO_LINEA_ESTANDAR.bits_parada);
+    }
+    for (int i = 0; i < n; i++) {
+        conversaciones[i].id = (uint32_t)i;
+        sesionIniciar(s_bucle, sesiones[i], conversar, &conversaciones[i], i % ME_MAX_ENLACES);
+    }
+
+    uint64_t t0 = ahoraNs();
+    sesionesCorrer(s_bucle);
+    double ms = (ahoraNs() - t0) / 1e6;
+
+    const contadoresSesiones& c = s_bucle.contadores;
+    bool ok = s_bucle.vivas == 0 && s_acusados + s_fallidos == (unsigned long)n * INTERCAMBIOS &&
+              c.entregadas == s_acusados && c.huerfanas == 0 &&
+              c.vencidas == s_vencidos;
+    printf("  %8d | %8.1f | %10lu | %10.0f | %8lu | %10lu | %8lu | %7.2f h | %s\n", n, ms, c.reanudaciones,
+           c.reanudaciones / (ms / 1000.0), c.enviados, s_vencidos - s_fallidos, s_fallidos,
+           s_virtual_ms / 3.6e6, ok ? "sí" : "NO");
+    return ok;
+}
+
+// --- Opción 14 con la línea de retorno virtual ---
+
+static lineaVirtual s_retorno;
+static estadoEnlace s_receptor;     // El del enlace SES_ENLACE_RETORNO
+static int s_recibidos[PRUEBA_ENLACES];
+static int s_consultas;
+static int s_ok_reportado;
+
+static uint64_t relojRetorno() {
+    return (uint64_t)(s_retorno.ahora_ns / 1000000);
+}
+
+/**
+ * Los receptores cuentan lo que les llega. El de SES_ENLACE_RETORNO pierde
+ * las primeras CONSULTAS_PERDIDAS consultas y contesta las demás por la
+ * línea de retorno cuando el frame terminó de llegar.
+ */
+static void enviarAReceptores(int enlace, const protocolo& proto, int largo) {
+    s_recibidos[enlace]++;
+    if (enlace != SES_ENLACE_RETORNO) return;
+    if (proto.cmd == CMD_ENLACE && s_consultas++ < CONSULTAS_PERDIDAS) return;
+    enlaceFrameValido(s_receptor);
+    if (proto.cmd != CMD_ENLACE) return;
+
+    frameReceptor rx, respuesta;
+    memset(&rx, 0, sizeof(rx));
+    memcpy(rx.frame, proto.frame, largo);
+    rx.cmd = proto.cmd;
+    rx.lng = proto.lng;
+    if (!enlaceProcesar(s_receptor, rx, respuesta)) return;
+    s_ok_reportado = (payload(respuesta)[2] << 8) | payload(respuesta)[3];
+
+    const enlaceSesiones& e = s_bucle.enlaces[enlace];
+    int64_t reloj_emisor = s_retorno.ahora_ns;
+    s_retorno.ahora_ns += (int64_t)(sesionesDuracionMs(e, largo) + ATENCION_MS) * 1000000;
+    int largo_respuesta = empaquetarRetorno(respuesta);
+    enviarFrameRetorno(TX_RETORNO_PIN, e.speed, respuesta, largo_respuesta);
+    s_retorno.ahora_ns = reloj_emisor;
+}
+
+static bool pruebaEnlaces(int speed) {
+    sesion sesiones[PRUEBA_ENLACES];
+    pruebaEnlace pruebas[PRUEBA_ENLACES];
+    s_retorno = lineaVirtual();
+    s_retorno.ahora_ns = 1000000000LL;
+    s_retorno.fin_ns = 3600 * 1000000000LL; // El emisor puede esperar respuestas en silencio
+    halUsarLinea(&s_retorno);
+    enlaceIniciar(s_receptor);
+    s_consultas = 0;
+    s_ok_reportado = -1;
+
+    // Como la opción 14 del emisor, con la línea de retorno virtual
+    sesionesIniciar(s_bucle, relojRetorno, sesionesEsperarRetorno);
+    for (int e = 0; e < PRUEBA_ENLACES; e++) {
+        s_recibidos[e] = 0;
+        int enlace = sesionesAgregarEnlace(s_bucle, enviarAReceptores, speed, FORMATO_LINEA_ESTANDAR.bits_parada);
+        pruebas[e].mensajes = PRUEBA_MENSAJES;
+        pruebas[e].confirmar = (enlace == SES_ENLACE_RETORNO);
+        sesionIniciar(s_bucle, sesiones[e], sesionPruebaEnlace, &pruebas[e], enlace);
+    }
+    sesionesCorrer(s_bucle);
+    halUsarLinea(NULL);
+
+    const pruebaEnlace& p = pruebas[SES_ENLACE_RETORNO];
+    bool ok = s_bucle.vivas == 0 && p.confirmado && p.intento == CONSULTAS_PERDIDAS &&
+              p.ok_receptor == s_ok_reportado && p.ok_receptor == PRUEBA_MENSAJES + 1 &&
+              s_bucle.contadores.entregadas == 1 && s_bucle.contadores.huerfanas == 0 &&
+              s_bucle.contadores.vencidas == CONSULTAS_PERDIDAS;
+    for (int e = 0; e < PRUEBA_ENLACES; e++) {
+        int esperados = PRUEBA_MENSAJES + (e == SES_ENLACE_RETORNO ? CONSULTAS_PERDIDAS + 1 : 0);
+        if (s_recibidos[e] != esperados || pruebas[e].enviados != PRUEBA_MENSAJES) ok = false;
+        if (e != SES_ENLACE_RETORNO && pruebas[e].confirmado) ok = false;
+    }
+    printf("\nOpción 14: %d mensajes por %d enlaces a %d bps y la CONSULTA por la línea de retorno\n",
+           PRUEBA_MENSAJES, PRUEBA_ENLACES, speed);
+    printf("  Enlace %d: REPORTE con %d frames válidos tras %d consulta(s) vencida(s), %.1f s virtuales\n",
+           SES_ENLACE_RETORNO, p.ok_receptor, p.intento, (s_retorno.ahora_ns - 1000000000LL) / 1e9);
+    printf("  Frames: %lu, respuestas entregadas: %lu, vencidas: %lu, sin sesión: %lu\n",
+           s_bucle.contadores.enviados, s_bucle.contadores.entregadas, s_bucle.contadores.vencidas,
+           s_bucle.contadores.huerfanas);
+    printf("  Todos los mensajes enviados y el acuse reintentado hasta llegar: %s\n", ok ? "sí" : "NO");
+    return ok;
+}
+
+int escenarioSesiones(int argc, char** argv) {
+    int speed = (argc > 0) ? atoi(argv[0]) : 250;
+    int maximo = (argc > 1) ? atoi(argv[1]) : 100000;
+    if (speed <= 0 || maximo <= 0) {
+        printf("Uso: ./simulador sesiones [bps] [sesiones máximas]\n");
+        return 1;
+    }
+
+    printf("Cambio de contexto\n");
+    // Con una sola sesión cada reanudación es una vuelta del bucle (lee el reloj)
+    printf("  Una sesión que cede %d veces:   %7.1f ns por reanudación\n", CESIONES,
+           medirCesiones(1, CESIONES));
+    printf("  %d sesiones que ceden en ronda:   %7.1f ns por reanudación\n", SESIONES_CEDIENDO,
+           medirCesiones(SESIONES_CEDIENDO, CESIONES / SESIONES_CEDIENDO));
+    printf("  Dos hilos con condition_variable:    %7.1f ns por cambio\n", medirHilos());
+    pthread_attr_t atributos;
+    size_t pila = 0;
+    pthread_attr_init(&atributos);
+    pthread_attr_getstacksize(&atributos, &pila);
+    pthread_attr_destroy(&atributos);
+    printf("  Memoria: %zu bytes por sesión (+ %zu de su conversación) contra %zu KB de pila por hilo\n",
+           sizeof(sesion), sizeof(conversacion), pila / 1024);
+
+    printf("\nConversaciones: %d intercambios de hasta %d intentos, %d enlaces a %d bps, %d%% de pérdida\n",
+           INTERCAMBIOS, INTENTOS, ME_MAX_ENLACES, speed, PERDIDA_PORCENTAJE);
+    printf("  Sesiones |  ms real | Reanudac.  |  Reanud./s |   Frames | Reintentos | Fallidos |   Virtual | OK\n");
+    bool ok = true;
+    for (int n = 100; n <= maximo; n *= 10) {
+        ok = correrConversaciones(n, speed) && ok;
+    }
+    printf("\n  Todos los intercambios acusados o vencidos, sin acuses huérfanos: %s\n", ok ? "sí" : "NO");
+
+    ok = pruebaEnlaces(speed) && ok;
+    return ok ? 0 : 1;
+}
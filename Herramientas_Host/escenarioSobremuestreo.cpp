@@ -0,0 +1,345 @@
+/**
+ * @file escenarioSobremuestreo.cpp
+ * @brief Recepción con sobremuestreo y voto de mayoría (sobremuestreo.h)
+ * contra una sola lectura por bit, con ruido de pulsos cortos.
+ * @details Dos partes:
+ *  1. El núcleo solo, con muestras sintéticas: cada byte es una señal
+ *     continua (en bits) con pulsos de ruido al azar, que el receptor
+ *     muestrea con un corrimiento de fase y un reloj un poco distinto del
+ *     emisor. Se decodifica con una lectura en el centro de cada bit (como
+ *     readByte() sin sobremuestreo) y con distintas muestras por bit y
+ *     filtro de glitches. Se reportan los bytes errados y la confianza.
+ *  2. El recibirFrame() real sobre una línea virtual (frames de
+ *     nivelesFrame() del emisor y ruido de 50 us a 1 ms, como en el
+ *     barrido): frames entregados con FORMATO_LINEA_ESTANDAR y con
+ *     FORMATO_RECEPCION, incluido el flushRX() después de un error.
+ */
+
+#include "escenarios.h"
+#include "halHost.h"
+#include "recibe.h"
+#include "sobremuestreo.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#define NS_POR_S 1000000000LL
+#define BITS_SENAL 12                // Inicio + 8 + 2 de parada + reposo
+#define PULSO_MIN_BIT 0.02           // Pulsos sintéticos: 2% ...
+#define PULSO_MAX_BIT 0.12           // ... a 12% del bit (hasta una muestra con 8 por bit)
+#define FASE_MAX_BIT 0.05            // Atraso al ver la bajada del inicio
+#define DERIVA_MAX 0.01              // Diferencia entre los relojes (1%)
+
+#define SPEED_LINEA 100
+#define PAUSA_MS 1200                // Entre frames: más que el silencio de flushRX()
+#define SILENCIO_FLUSH_MS 1000
+#define GLITCH_MIN_NS 50000LL
+#define GLITCH_MAX_NS 1000000LL
+
+// ===================== 1. Muestras sintéticas =====================
+
+/**
+ * Un byte como señal continua (t en bits desde la bajada del inicio) con pulsos invertidos.
+ */
+typedef struct
+{
+    int bits[BITS_SENAL];
+    std::vector<double> pulsos; // Pares inicio/fin
+} senalByte;
+
+static void armarSenal(std::mt19937& rng, BYTE valor, double pulsos_por_bit, senalByte& s) {
+    s.bits[0] = 0;
+    for (int i = 0; i < 8; i++) s.bits[1 + i] = (valor >> i) & 1;
+    for (int i = 9; i < BITS_SENAL; i++) s.bits[i] = 1;
+
+    s.pulsos.clear();
+    if (pulsos_por_bit <= 0) return;
+    std::exponential_distribution<double> entre(pulsos_por_bit);
+    std::uniform_real_distribution<double> ancho(PULSO_MIN_BIT, PULSO_MAX_BIT);
+    // El primer pulso no tapa la bajada: esa se vio (si no, no hay byte)
+    for (double t = 0.1 + entre(rng); t < BITS_SENAL; t += entre(rng)) {
+        double a = ancho(rng);
+        s.pulsos.push_back(t);
+        s.pulsos.push_back(t + a);
+    }
+}
+
+static int nivelSenal(const senalByte& s, double t) {
+    int i = (int)t;
+    int nivel = (i >= 0 && i < BITS_SENAL) ? s.bits[i] : 1;
+    for (size_t p = 0; p < s.pulsos.size(); p += 2) {
+        if (t >= s.pulsos[p] && t < s.pulsos[p + 1]) nivel ^= 1;
+    }
+    return nivel;
+}
+
+/**
+ * Como readByte() sin sobremuestreo: una lectura en el centro de cada bit.
+ */
+static int decodificarUnaLectura(const senalByte& s, double fase, double escala, BYTE* byte) {
+    *byte = 0;
+    if (nivelSenal(s, fase + 0.5 * escala)) return -1;
+    for (int i = 0; i < 8; i++) {
+        if (nivelSenal(s, fase + (1.5 + i) * escala)) *byte |= (BYTE)(1 << i);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (!nivelSenal(s, fase + (9.5 + i) * escala)) return -1;
+    }
+    return 0;
+}
+
+static int decodificarSobremuestreo(const senalByte& s, double fase, double escala, const FormatoLinea& f,
+                                    BYTE* byte, estadisticasSobremuestreo& e) {
+    BYTE muestras[SOBRE_MUESTRAS_BYTE_MAX];
+    int n = sobreMuestrasDeByte(f);
+    for (int k = 0; k < n; k++) {
+        muestras[k] = (BYTE)nivelSenal(s, fase + (k + 0.5) / f.muestras_por_bit * escala);
+    }
+    return sobreDecodificarByte(muestras, f, byte, &e);
+}
+
+typedef struct
+{
+    const char* nombre;
+    FormatoLinea formato; // muestras_por_bit 0 = una lectura
+} lectorSintetico;
+
+static const lectorSintetico LECTORES[] = {
+    {"1 lectura", {2, 50, 0, 0}},
+    {"8 sin filtro", {2, 50, 8, 0}},
+    {"8 + filtro 1", {2, 50, 8, 1}},
+    {"16 + filtro 2", {2, 50, 16, 2}},
+};
+#define NUM_LECTORES ((int)(sizeof(LECTORES) / sizeof(LECTORES[0])))
+
+static const double RUIDOS_POR_BIT[] = {0.0, 0.05, 0.2, 0.5};
+#define NUM_RUIDOS ((int)(sizeof(RUIDOS_POR_BIT) / sizeof(RUIDOS_POR_BIT[0])))
+
+static bool parteSintetica(int bytes) {
+    printf("1. Núcleo con muestras sintéticas: %d bytes por celda, pulsos de %.0f%% a %.0f%% del bit,\n"
+           "   fase hasta %.0f%% del bit y relojes hasta %.0f%% distintos. Bytes errados:\n\n",
+           bytes, PULSO_MIN_BIT * 100, PULSO_MAX_BIT * 100, FASE_MAX_BIT * 100, DERIVA_MAX * 100);
+    printf("  %-12s", "pulsos/bit");
+    for (int l = 0; l < NUM_LECTORES; l++) printf(" %14s", LECTORES[l].nombre);
+    printf(" %16s %10s\n", "confianza media", "dudosos");
+
+    bool correcto = true;
+    for (int r = 0; r < NUM_RUIDOS; r++) {
+        unsigned long errados[NUM_LECTORES] = {0};
+        estadisticasSobremuestreo e[NUM_LECTORES];
+        for (int l = 0; l < NUM_LECTORES; l++) sobreReiniciar(e[l]);
+
+        std::mt19937 rng(1000 + r);
+        std::uniform_real_distribution<double> fase(0.0, FASE_MAX_BIT);
+        std::uniform_real_distribution<double> deriva(-DERIVA_MAX, DERIVA_MAX);
+        senalByte s;
+        for (int b = 0; b < bytes; b++) {
+            BYTE valor = (BYTE)rng();
+            armarSenal(rng, valor, RUIDOS_POR_BIT[r], s);
+            double f = fase(rng);
+            double escala = 1.0 + deriva(rng);
+            for (int l = 0; l < NUM_LECTORES; l++) {
+                BYTE leido;
+                int res = (LECTORES[l].formato.muestras_por_bit == 0)
+                              ? decodificarUnaLectura(s, f, escala, &leido)
+                              : decodificarSobremuestreo(s, f, escala, LECTORES[l].formato, &leido, e[l]);
+                if (res < 0 || leido != valor) errados[l]++;
+            }
+        }
+
+        printf("  %-12.2f", RUIDOS_POR_BIT[r]);
+        for (int l = 0; l < NUM_LECTORES; l++) printf(" %13.3f%%", 100.0 * errados[l] / bytes);
+        // Confianza del lector de producción (8 muestras + filtro de 1)
+        const estadisticasSobremuestreo& p = e[2];
+        printf(" %15lu%% %9.2f%%\n", p.bits ? p.confianza_total / p.bits : 0,
+               p.bits ? 100.0 * p.bits_dudosos / p.bits : 0.0);
+
+        if (r == 0) {
+            for (int l = 0; l < NUM_LECTORES; l++) correcto = correcto && errados[l] == 0;
+        } else {
+            correcto = correcto && errados[2] < errados[0];
+        }
+    }
+    printf("\n  Confianza y dudosos: de \"8 + filtro 1\" (FORMATO_RECEPCION), sobre todos los bits.\n\n");
+    return correcto;
+}
+
+// ===================== 2. recibirFrame() sobre la línea virtual =====================
+
+typedef struct
+{
+    int64_t t_inicio;
+    protocolo proto;
+} frameLinea;
+
+/**
+ * Frames al azar con pausas, escritos bit a bit con nivelesFrame().
+ */
+static void armarLinea(std::mt19937& rng, int frames, lineaVirtual& linea, std::vector<frameLinea>& enviados) {
+    const int64_t bit_ns = (int64_t)(1000 / SPEED_LINEA) * 1000000;
+    BYTE niveles[BITS_FRAME(LARGO_FRAME, 2)];
+    int64_t t = (int64_t)PAUSA_MS * 1000000;
+    int nivel = HIGH;
+    for (int i = 0; i < frames; i++) {
+        frameLinea f;
+        memset(&f.proto, 0, sizeof(protocolo));
+        f.proto.cmd = 1 + rng() % 7;
+        f.proto.lng = 10 + rng() % 31;
+        for (int k = 0; k < f.proto.lng; k++) f.proto.data[k] = (BYTE)('a' + rng() % 26);
+        protocolo tx = f.proto;
+        int largo = empaquetar(tx);
+        f.t_inicio = t;
+        enviados.push_back(f);
+
+        int n = nivelesFrame(tx, largo, niveles);
+        for (int b = 0; b < n; b++) {
+            if (niveles[b] != nivel) {
+                flanco fl = {t, niveles[b]};
+                linea.flancos.push_back(fl);
+                nivel = niveles[b];
+            }
+            t += bit_ns;
+        }
+        t += (int64_t)PAUSA_MS * 1000000;
+    }
+    linea.fin_ns = t;
+}
+
+/**
+ * Invierte la línea en pulsos al azar (como agregarRuido() del barrido).
+ */
+static void agregarGlitches(std::mt19937& rng, lineaVirtual& linea, double por_s) {
+    if (por_s <= 0) return;
+    std::exponential_distribution<double> entre(por_s / NS_POR_S);
+    std::uniform_int_distribution<int64_t> ancho(GLITCH_MIN_NS, GLITCH_MAX_NS);
+    std::vector<flanco> resultado;
+    std::vector<int64_t> cambios;
+    for (double t = entre(rng); t < linea.fin_ns; t += entre(rng)) {
+        cambios.push_back((int64_t)t);
+        cambios.push_back((int64_t)t + ancho(rng));
+    }
+    std::sort(cambios.begin(), cambios.end());
+
+    int original = linea.nivel_reposo, invertido = 0, nivel = original;
+    size_t i = 0, j = 0;
+    while (i < linea.flancos.size() || j < cambios.size()) {
+        int64_t t;
+        if (j >= cambios.size() || (i < linea.flancos.size() && linea.flancos[i].t_ns <= cambios[j])) {
+            t = linea.flancos[i].t_ns;
+            original = linea.flancos[i++].nivel;
+        } else {
+            t = cambios[j++];
+            invertido ^= 1;
+        }
+        if ((original ^ invertido) != nivel) {
+            nivel = original ^ invertido;
+            flanco f = {t, (uint8_t)nivel};
+            resultado.push_back(f);
+        }
+    }
+    linea.flancos.swap(resultado);
+}
+
+/**
+ * Recibe toda la línea como el receptor: frame, y después de un error, flushRX().
+ */
+static int recibirLinea(lineaVirtual& linea, const std::vector<frameLinea>& enviados, const FormatoLinea& formato,
+                        int& no_detectados) {
+    linea.cursor = 0;
+    linea.ahora_ns = 0;
+    halUsarLinea(&linea);
+    int correctos = 0;
+    no_detectados = 0;
+    int64_t t = 0;
+    for (;;) {
+        int64_t inicio = lineaProximaBajada(linea, t);
+        if (inicio < 0) break;
+        linea.ahora_ns = inicio;
+
+        frameReceptor rx;
+        bool ok;
+        try {
+            ok = recibirFrame(RX_PIN, SPEED_LINEA, rx, formato) && desempaquetar(rx);
+        } catch (const finDeLinea&) {
+            break;
+        }
+        t = linea.ahora_ns;
+        if (ok) {
+            // El frame que terminó recién es el último que empezó antes
+            const frameLinea* tx = NULL;
+            for (size_t i = 0; i < enviados.size() && enviados[i].t_inicio < t; i++) tx = &enviados[i];
+            if (tx != NULL && rx.cmd == tx->proto.cmd && rx.lng == tx->proto.lng &&
+                memcmp(payload(rx), tx->proto.data, rx.lng) == 0) {
+                correctos++;
+            } else {
+                no_detectados++;
+            }
+            continue;
+        }
+        t = lineaFinSilencio(linea, t, (int64_t)SILENCIO_FLUSH_MS * 1000000);
+        if (t < 0) break;
+    }
+    halUsarLinea(NULL);
+    return correctos;
+}
+
+static const double GLITCHES_POR_S[] = {0, 1, 5, 20};
+#define NUM_GLITCHES ((int)(sizeof(GLITCHES_POR_S) / sizeof(GLITCHES_POR_S[0])))
+
+static bool parteLinea(int frames) {
+    printf("2. recibirFrame() en la línea virtual: %d frames de 14 a 44 bytes a %d bps,\n"
+           "   pulsos de 50 us a 1 ms. Frames entregados bien:\n\n", frames, SPEED_LINEA);
+    printf("  %-11s %14s %18s %14s %16s\n", "pulsos/s", "1 lectura", "FORMATO_RECEPCION", "glitches filt.",
+           "inicios falsos");
+
+    bool correcto = true;
+    for (int g = 0; g < NUM_GLITCHES; g++) {
+        std::mt19937 rng(2000 + g);
+        lineaVirtual limpia;
+        std::vector<frameLinea> enviados;
+        armarLinea(rng, frames, limpia, enviados);
+        agregarGlitches(rng, limpia, GLITCHES_POR_S[g]);
+
+        int nd_estandar, nd_recepcion;
+        lineaVirtual linea = limpia;
+        int ok_estandar = recibirLinea(linea, enviados, FORMATO_LINEA_ESTANDAR, nd_estandar);
+        sobreReiniciar(g_sobremuestreo);
+        linea = limpia;
+        int ok_recepcion = recibirLinea(linea, enviados, FORMATO_RECEPCION, nd_recepcion);
+
+        printf("  %-11.0f %9d/%-4d %13d/%-4d %14lu %16lu", GLITCHES_POR_S[g], ok_estandar, frames, ok_recepcion,
+               frames, g_sobremuestreo.glitches.load(), g_sobremuestreo.inicios_falsos.load());
+        if (nd_estandar + nd_recepcion > 0) printf("  (no detectados: %d / %d)", nd_estandar, nd_recepcion);
+        printf("\n");
+
+        if (g == 0) correcto = correcto && ok_estandar == frames && ok_recepcion == frames;
+        correcto = correcto && ok_recepcion >= ok_estandar;
+    }
+    printf("\n");
+    return correcto;
+}
+
+int escenarioSobremuestreo(int argc, char** argv) {
+    int bytes = (argc > 0) ? atoi(argv[0]) : 200000;
+    int frames = (argc > 1) ? atoi(argv[1]) : 40;
+    if (bytes <= 0 || frames <= 0) {
+        printf("Uso: ./simulador sobremuestreo [bytes sintéticos por celda] [frames por línea]\n");
+        return 1;
+    }
+    if (!sobremuestreoValido(FORMATO_RECEPCION)) {
+        printf("FORMATO_RECEPCION no es un sobremuestreo válido\n");
+        return 1;
+    }
+    g_hal_serial_silencio = true;
+    bool correcto = parteSintetica(bytes);
+    correcto = parteLinea(frames) && correcto;
+    g_hal_serial_silencio = false;
+
+    printf("  Sin ruido todos los lectores leen todo; con ruido el voto pierde menos: %s\n",
+           correcto ? "sí" : "NO");
+    return correcto ? 0 : 1;
+}
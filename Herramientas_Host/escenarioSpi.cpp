@@ -0,0 +1,317 @@
+/**
+ * @file escenarioSpi.cpp
+ * @brief Forma de onda del transporte "spi" (formaOndaSpi.cpp) decodificada
+ * con el receptor real.
+ * @details El ioctl de spidev solo existe en la Raspberry; todo lo demás se
+ * prueba acá:
+ * - La tabla contra nivelesFrame(): cada muestra del buffer tiene el nivel
+ *   del bit de la línea que le toca, con 8 a 64 muestras por bit, 1 a 4
+ *   bits de parada y dibujada invertida.
+ * - spiElegirMuestras(): muestras, reloj y error del bit para cada
+ *   velocidad con un núcleo de 250 y de 500 MHz.
+ * - El buffer como línea virtual, una muestra cada 1/reloj real del SPI
+ *   (con el redondeo del divisor), recibido con recibirFrame() y
+ *   desempaquetar(): todos los frames tienen que llegar iguales.
+ * - Lo que cuesta dibujar un frame con la tabla y bit a bit.
+ * - spiAbrir() rechaza un archivo que no es spidev.
+ */
+
+#include "escenarios.h"
+#include "halHost.h"
+#include "recibe.h"
+#include "formaOndaSpi.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <random>
+#include <vector>
+
+#define NS_POR_S 1000000000LL
+#define REPOSO_ENTRE_FRAMES_BITS 5  // Más que los 3 del emisor
+#define DIBUJOS_MEDIDOS 20000
+
+static const int VELOCIDADES_SPI[] = {10, 20, 25, 50, 100, 125, 200, 250, 500, 1000};
+#define NUM_VELOCIDADES_SPI (int)(sizeof(VELOCIDADES_SPI) / sizeof(VELOCIDADES_SPI[0]))
+
+static uint64_t ahoraNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static FormatoLinea formatoConParada(int bits_parada) {
+    FormatoLinea f = FORMATO_LINEA_ESTANDAR;
+    f.bits_parada = bits_parada;
+    return f;
+}
+
+/**
+ * Frame al azar, empaquetado como lo deja el emisor.
+ */
+static int frameAlAzar(std::mt19937& rng, protocolo& proto, int lng_min) {
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = 1 + rng() % 7;
+    proto.lng = lng_min + rng() % (LARGO_DATA + 1 - lng_min);
+    for (int k = 0; k < proto.lng; k++) proto.data[k] = (BYTE)rng();
+    return empaquetar(proto);
+}
+
+static int muestra(const BYTE* buffer, long i) {
+    return (buffer[i / 8] >> (7 - i % 8)) & 1; // MSB primero, como el SPI
+}
+
+// ===================== 1. La tabla contra nivelesFrame() =====================
+
+static bool parteTabla(int frames) {
+    printf("1. Cada muestra contra nivelesFrame(), %d frames por celda (muestras distintas):\n\n", frames);
+    printf("  %-8s %12s %12s %12s %12s\n", "muestras", "1 parada", "2 paradas", "3 paradas", "4 paradas");
+    static formaOndaSpi onda;
+    static BYTE buffer[SPI_BUFFER_MAX];
+    BYTE niveles[BITS_FRAME(FrameEstandar::LARGO_MAX, 4)];
+    bool ok = true;
+    for (int m = 8; m <= SPI_MUESTRAS_MAX; m += 8) {
+        printf("  %-8d", m);
+        for (int p = 1; p <= 4; p++) {
+            FormatoLinea formato = formatoConParada(p);
+            long distintas = 0;
+            std::mt19937 rng(100 * m + p);
+            for (int invertida = 0; invertida < 2; invertida++) {
+                ondaSpiPreparar(onda, m, invertida);
+                for (int f = 0; f < frames; f++) {
+                    protocolo proto;
+                    int largo = frameAlAzar(rng, proto, 0);
+                    int bytes = ondaSpiDibujar(onda, proto, largo, buffer, formato);
+                    int n = nivelesFrame(proto, largo, niveles, formato);
+                    if (bytes != SPI_BYTES_FRAME(largo, p, m)) distintas++;
+                    for (long i = 0; i < (long)bytes * 8; i++) {
+                        long bit = i / m - SPI_REPOSO_BITS;
+                        int esperado = (bit < 0) ? HIGH : niveles[bit];
+                        if (bit >= n || (muestra(buffer, i) ^ invertida) != esperado) distintas++;
+                    }
+                }
+            }
+            printf(" %12ld", distintas);
+            ok = ok && distintas == 0;
+        }
+        printf("\n");
+    }
+    printf("\n");
+    return ok;
+}
+
+// ===================== 2. Muestras por bit y reloj =====================
+
+static void parteElegir() {
+    printf("2. spiElegirMuestras() con transferencias de %d bytes (muestras / bit más largo):\n\n",
+           SPI_BUFSIZ_DEFECTO);
+    printf("  %-6s %22s %22s\n", "bps", "núcleo de 250 MHz", "núcleo de 500 MHz");
+    static const long RELOJES[] = {250000000L, 500000000L};
+    for (int v = 0; v < NUM_VELOCIDADES_SPI; v++) {
+        int speed = VELOCIDADES_SPI[v];
+        printf("  %-6d", speed);
+        for (int r = 0; r < 2; r++) {
+            uint32_t hz_real = 0;
+            int m = spiElegirMuestras(speed, RELOJES[r], SPI_BUFSIZ_DEFECTO, 2, &hz_real);
+            if (m == 0) {
+                printf(" %22s", "no entra");
+            } else {
+                printf("       %2d / %8.4f%%", m, 100.0 * ((double)speed * m / hz_real - 1.0));
+            }
+        }
+        printf("\n");
+    }
+    printf("  (el reloj más lento es núcleo / %d: las velocidades bajas van por wiringpi o gpiomem)\n\n",
+           SPI_DIVISOR_MAX);
+}
+
+// ===================== 3. recibirFrame() sobre el buffer =====================
+
+/**
+ * Agrega el buffer a la línea desde 't0', una muestra cada 1/hz_real.
+ * Con 'invertida', la línea pasa por un inversor. Retorna el fin.
+ */
+static int64_t agregarBuffer(lineaVirtual& linea, int& nivel, const BYTE* buffer, int bytes, uint32_t hz_real,
+                             bool invertida, int64_t t0) {
+    long muestras = (long)bytes * 8;
+    for (long i = 0; i < muestras; i++) {
+        int n = muestra(buffer, i) ^ (invertida ? 1 : 0);
+        if (n != nivel) {
+            flanco f = {t0 + (int64_t)(i * (double)NS_POR_S / hz_real), (uint8_t)n};
+            linea.flancos.push_back(f);
+            nivel = n;
+        }
+    }
+    return t0 + (int64_t)(muestras * (double)NS_POR_S / hz_real);
+}
+
+/**
+ * Dibuja 'frames' frames a 'speed' bps, los pone en una línea y los recibe.
+ * Retorna los que llegaron iguales, o -1 si la velocidad no entra en el SPI.
+ */
+static int recibirDibujados(int speed, const FormatoLinea& formato, bool invertida, int frames, std::mt19937& rng) {
+    uint32_t hz_real = 0;
+    int m = spiElegirMuestras(speed, SPI_RELOJ_NUCLEO_HZ, SPI_BUFSIZ_DEFECTO, formato.bits_parada, &hz_real);
+    if (m == 0) return -1;
+
+    static formaOndaSpi onda;
+    static BYTE buffer[SPI_BUFFER_MAX];
+    ondaSpiPreparar(onda, m, invertida);
+    lineaVirtual linea;
+    std::vector<protocolo> enviados;
+    int nivel = HIGH;
+    int64_t t = NS_POR_S / speed;
+    for (int f = 0; f < frames; f++) {
+        protocolo proto;
+        int largo = frameAlAzar(rng, proto, 1);
+        enviados.push_back(proto);
+        int bytes = ondaSpiDibujar(onda, proto, largo, buffer, formato);
+        t = agregarBuffer(linea, nivel, buffer, bytes, hz_real, invertida, t);
+        t += REPOSO_ENTRE_FRAMES_BITS * NS_POR_S / speed;
+    }
+    linea.fin_ns = t;
+
+    halUsarLinea(&linea);
+    int iguales = 0;
+    int64_t desde = 0;
+    for (int f = 0; f < frames; f++) {
+        int64_t inicio = lineaProximaBajada(linea, desde);
+        if (inicio < 0) break;
+        linea.ahora_ns = inicio;
+        frameReceptor rx;
+        bool ok;
+        try {
+            ok = recibirFrame(RX_PIN, speed, rx, formato) && desempaquetar(rx);
+        } catch (const finDeLinea&) {
+            break;
+        }
+        desde = linea.ahora_ns;
+        const protocolo& tx = enviados[f];
+        if (ok && rx.cmd == tx.cmd && rx.lng == tx.lng && memcmp(payload(rx), tx.data, rx.lng) == 0) {
+            iguales++;
+        }
+    }
+    halUsarLinea(NULL);
+    return iguales;
+}
+
+static bool parteRecepcion(int frames) {
+    printf("3. recibirFrame() + desempaquetar() sobre el buffer, reloj del SPI de un núcleo\n"
+           "   de 250 MHz, %d frames por celda (llegados iguales):\n\n", frames);
+    printf("  %-6s %14s %14s %14s %14s\n", "bps", "1 parada", "2 paradas", "4 paradas", "2, invertida");
+    static const int PARADAS[] = {1, 2, 4, 2};
+    bool ok = true;
+    int celdas = 0;
+    for (int v = 0; v < NUM_VELOCIDADES_SPI; v++) {
+        int speed = VELOCIDADES_SPI[v];
+        printf("  %-6d", speed);
+        for (int c = 0; c < 4; c++) {
+            std::mt19937 rng(speed * 10 + c);
+            int iguales = recibirDibujados(speed, formatoConParada(PARADAS[c]), c == 3, frames, rng);
+            if (iguales < 0) {
+                printf(" %14s", "-");
+                continue;
+            }
+            printf(" %9d/%-4d", iguales, frames);
+            ok = ok && iguales == frames;
+            celdas++;
+        }
+        printf("\n");
+    }
+    printf("  (-: la velocidad no entra en el SPI)\n\n");
+    return ok && celdas > 0;
+}
+
+// ===================== 4. Costo de dibujar =====================
+
+/**
+ * Lo mismo sin la tabla: nivelesFrame() y cada muestra por separado.
+ */
+static int dibujarBitABit(const protocolo& proto, int largo, int m, BYTE* destino) {
+    BYTE niveles[BITS_FRAME(FrameEstandar::LARGO_MAX, 4)];
+    int n = nivelesFrame(proto, largo, niveles);
+    int bytes = (SPI_REPOSO_BITS + n) * m / 8;
+    memset(destino, 0, bytes);
+    for (long i = 0; i < (long)bytes * 8; i++) {
+        long bit = i / m - SPI_REPOSO_BITS;
+        if (bit < 0 || niveles[bit]) destino[i / 8] |= (BYTE)(0x80 >> (i % 8));
+    }
+    return bytes;
+}
+
+static void parteCosto() {
+    static formaOndaSpi onda;
+    static BYTE buffer[SPI_BUFFER_MAX];
+    protocolo proto;
+    memset(&proto, 0, sizeof(protocolo));
+    proto.cmd = 1;
+    proto.lng = LARGO_DATA;
+    for (int k = 0; k < LARGO_DATA; k++) proto.data[k] = (BYTE)(k * 37);
+    int largo = empaquetar(proto);
+
+    printf("4. Dibujar un frame de %d bytes (ns por frame):\n\n", largo);
+    printf("  %-8s %10s %12s %8s\n", "muestras", "tabla", "bit a bit", "bytes");
+    unsigned suma = 0; // Que el compilador no saque los bucles
+    for (int m = 8; m <= SPI_MUESTRAS_MAX; m *= 2) {
+        uint64_t t0 = ahoraNs();
+        ondaSpiPreparar(onda, m, false);
+        uint64_t t1 = ahoraNs();
+        int bytes = 0;
+        for (int i = 0; i < DIBUJOS_MEDIDOS; i++) {
+            proto.frame[2] = (BYTE)i;
+            bytes = ondaSpiDibujar(onda, proto, largo, buffer);
+            suma += buffer[i % bytes];
+        }
+        uint64_t t2 = ahoraNs();
+        for (int i = 0; i < DIBUJOS_MEDIDOS; i++) {
+            proto.frame[2] = (BYTE)i;
+            suma += dibujarBitABit(proto, largo, m, buffer);
+        }
+        uint64_t t3 = ahoraNs();
+        printf("  %-8d %10.0f %12.0f %8d   (armar la tabla: %.0f us)\n", m, (double)(t2 - t1) / DIBUJOS_MEDIDOS,
+               (double)(t3 - t2) / DIBUJOS_MEDIDOS, bytes, (t1 - t0) / 1e3);
+    }
+    printf("  (control: %u)\n\n", suma & 1);
+}
+
+// ===================== 5. spiAbrir() =====================
+
+static bool parteAbrir() {
+    char ruta[] = "/tmp/spidev_XXXXXX";
+    int fd = mkstemp(ruta);
+    if (fd < 0) {
+        printf("5. No se pudo crear el archivo de prueba en /tmp.\n");
+        return false;
+    }
+    close(fd);
+    salidaSpi* s = new salidaSpi(g_spi);
+    s->ruta = ruta;
+    s->fd = -1;
+    bool rechaza = !spiAbrir(*s);
+    unlink(ruta);
+    s->ruta = "/tmp/no_existe_spidev";
+    bool rechaza_falta = !spiAbrir(*s);
+    delete s;
+    printf("5. spiAbrir() rechaza un archivo común y uno que no existe: %s\n",
+           (rechaza && rechaza_falta) ? "sí" : "NO");
+    return rechaza && rechaza_falta;
+}
+
+int escenarioSpi(int argc, char** argv) {
+    int frames_tabla = (argc > 0) ? atoi(argv[0]) : 50;
+    int frames_linea = (argc > 1) ? atoi(argv[1]) : 20;
+    if (frames_tabla <= 0 || frames_linea <= 0) {
+        printf("Uso: ./simulador spi [frames por celda de la tabla] [frames por celda de la línea]\n");
+        return 1;
+    }
+    bool ok = parteTabla(frames_tabla);
+    parteElegir();
+    ok = parteRecepcion(frames_linea) && ok;
+    parteCosto();
+    ok = parteAbrir() && ok;
+    printf("\n  La forma de onda del SPI se recibe igual que la de enviarFrame(): %s\n", ok ? "sí" : "NO");
+    return ok ? 0 : 1;
+}
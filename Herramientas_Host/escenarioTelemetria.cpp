@@ -0,0 +1,136 @@
+/**
+ * @file escenarioTelemetria.cpp
+ * @brief Telemetría de temperatura de punta a punta, en tiempo virtual.
+ * @details El sensor simulado del emisor se codifica en lotes (CMD 8), el
+ * enviarFrame() real del emisor los escribe en una línea virtual y el
+ * recibirFrame() real del receptor los lee y los guarda en la serie temporal.
+ * Se compara contra la opción 4 (una temperatura como texto por frame):
+ * bytes por muestra y tasa de muestreo máxima que soporta la línea.
+ */
+
+#include "escenarios.h"
+#include "serieTemporal.h"
+#include "recibe.h"
+#include "telemetria.h"
+#include "funcionesProtocolo.h"
+#include "halHost.h"
+#include "Arduino.h"
+#include <stdlib.h>
+#include <vector>
+
+#define PIN_SIMULADO 0
+#define PAUSA_ENTRE_FRAMES_MS 200
+
+// Bits en la línea de un frame de 'largo' bytes: 11 por byte + paridad
+static double segundosEnLinea(long bytes, long frames) {
+    return (bytes * 11.0 + frames) / SPEED;
+}
+
+int escenarioTelemetria(int argc, char** argv) {
+    int total = (argc > 0) ? atoi(argv[0]) : 3600;
+    float hz = (argc > 1) ? (float)atof(argv[1]) : 1.0f;
+    int perder_cada = (argc > 2) ? atoi(argv[2]) : 0; // 0 = sin pérdidas
+    if (total <= 0 || hz <= 0.0f) {
+        printf("Uso: ./simulador telemetria [muestras] [hz] [perder_cada_n_frames]\n");
+        return 1;
+    }
+
+    // --- Muestras del sensor simulado ---
+    fuenteTemperatura fuente;
+    fuenteAbrir(fuente, NULL);
+    std::vector<int16_t> muestras(total);
+    long bytes_texto = 0;
+    for (int i = 0; i < total; i++) {
+        float t;
+        fuenteLeer(fuente, hz, t);
+        muestras[i] = temperaturaAFijo(t);
+        // Lo que mandaría la opción 4: el texto "23.45" en su propio frame
+        char texto[16];
+        bytes_texto += BYTES_EXTRA + snprintf(texto, sizeof(texto), "%.2f", t);
+    }
+    fuenteCerrar(fuente);
+
+    // --- Emisor: codifica en lotes y escribe la línea virtual ---
+    lineaVirtual linea;
+    halUsarLinea(&linea);
+    g_hal_serial_silencio = true;
+
+    uint16_t periodo_ms = (uint16_t)(1000.0f / hz + 0.5f);
+    long bytes_lotes = 0, frames = 0, perdidos_a_proposito = 0;
+    protocolo tx;
+    for (int enviadas = 0; enviadas < total; frames++) {
+        memset(&tx, 0, sizeof(protocolo));
+        tx.cmd = CMD_TELEMETRIA;
+        int usadas = 0;
+        tx.lng = (BYTE)codificarTelemetria((BYTE)frames, periodo_ms, &muestras[enviadas],
+                                           total - enviadas, tx.data, LARGO_DATA, &usadas);
+        int largo = empaquetar(tx);
+        bytes_lotes += largo;
+        enviadas += usadas;
+
+        if (perder_cada > 0 && frames % perder_cada == perder_cada - 1) {
+            perdidos_a_proposito++; // Se codifica pero no llega a la línea
+            continue;
+        }
+        enviarFrame(PIN_SIMULADO, SPEED, tx, largo);
+        delay(PAUSA_ENTRE_FRAMES_MS);
+    }
+    linea.fin_ns = linea.ahora_ns;
+
+    // --- Receptor: lee la misma línea desde el principio ---
+    halUsarLinea(&linea);
+    linea.ahora_ns = 0;
+
+    serieTemporal serie;
+    serieIniciar(serie);
+    frameReceptor rx;
+    long recibidos = 0, errores = 0;
+    try {
+        for (;;) {
+            if (!recibirFrame(RX_PIN, SPEED, rx) || !desempaquetar(rx)) {
+                errores++;
+                continue;
+            }
+            if (rx.cmd == CMD_TELEMETRIA && serieAgregarFrame(serie, payload(rx), rx.lng) >= 0) {
+                recibidos++;
+            } else {
+                errores++;
+            }
+        }
+    } catch (const finDeLinea&) {
+        // Se leyó toda la línea
+    }
+    halUsarLinea(NULL);
+    g_hal_serial_silencio = false;
+
+    // Sin pérdidas, lo recibido tiene que ser exactamente lo muestreado
+    bool iguales = (perder_cada > 0) || (serie.muestras_total == (unsigned long)total);
+    for (int i = 0; iguales && i < serie.niveles[0].cantidad; i++) {
+        int original = total - serie.niveles[0].cantidad + i;
+        iguales = (seriePunto(serie, 0, i).prom == muestras[original]);
+    }
+
+    double s_texto = segundosEnLinea(bytes_texto, total);
+    double s_lotes = segundosEnLinea(bytes_lotes, frames);
+    printf("Telemetría: %d muestras a %.1f Hz, línea a %d bps\n", total, hz, SPEED);
+    printf("  %-22s %8s %10s %12s %14s\n", "", "frames", "bytes", "bytes/muestra", "max Hz linea");
+    printf("  %-22s %8d %10ld %12.2f %14.3f\n", "Texto (opción 4)", total, bytes_texto,
+           (double)bytes_texto / total, total / s_texto);
+    printf("  %-22s %8ld %10ld %12.2f %14.3f\n", "Lotes delta (CMD 8)", frames, bytes_lotes,
+           (double)bytes_lotes / total, total / s_lotes);
+    printf("  Reducción: %.1fx menos bytes en la línea\n", (double)bytes_texto / bytes_lotes);
+    printf("Receptor: %ld frames OK, %ld errores, %lu muestras, %lu frames perdidos (esperados %ld)\n",
+           recibidos, errores, serie.muestras_total, serie.frames_perdidos, perdidos_a_proposito);
+    for (int n = 0; n < SERIE_NIVELES; n++) {
+        const nivelSerie& nivel = serie.niveles[n];
+        if (nivel.cantidad == 0) continue;
+        const puntoSerie& p = seriePunto(serie, n, nivel.cantidad - 1);
+        printf("  Nivel %d: %3d puntos, último min %.2f max %.2f prom %.2f\n", n, nivel.cantidad,
+               p.min / (float)TELEMETRIA_ESCALA, p.max / (float)TELEMETRIA_ESCALA,
+               p.prom / (float)TELEMETRIA_ESCALA);
+    }
+    printf("Muestras recibidas %s a las enviadas.\n", iguales ? "idénticas" : "DISTINTAS");
+
+    bool ok = iguales && errores == 0 && (long)serie.frames_perdidos == perdidos_a_proposito;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file escenarioTrazas.cpp
+ * @brief Puntos de traza (trazas.h): costo, anillos por hilo y volcado JSON.
+ * @details Este archivo se compila siempre con -DTRAZAS (ver el makefile);
+ * el resto del simulador solo si se compila con make TRAZAS=1, y en ese
+ * caso los puntos del emisor (empaquetar, ...) también salen en el volcado.
+ * Se verifica:
+ * - El costo de un ámbito (dos lecturas del reloj y un evento al anillo).
+ * - Varios productores que publican en la cola de la ingesta y un
+ *   empaquetador que la vacía, cada uno con su anillo: cada anillo guarda
+ *   los últimos TRAZA_EVENTOS eventos de su hilo, en el orden en que terminaron.
+ * - El volcado como JSON de Chrome, que se abre en https://ui.perfetto.dev.
+ * - Los hilos que llegan con todos los anillos tomados se cuentan como perdidos.
+ */
+
+#include "escenarios.h"
+#include "trazas.h"
+#include "ingestaSocket.h"
+#include "funcionesProtocolo.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define AMBITOS_MEDIDOS 2000000
+#define PRODUCTORES 3
+#define MENSAJES_POR_PRODUCTOR 20000
+#define MENSAJES_POR_INSTANTE 1000
+
+static colaIngesta s_cola;
+
+/**
+ * Costo de un ámbito: la misma vuelta con y sin TRAZA_AMBITO.
+ */
+static double medirCosto() {
+    volatile uint32_t suma = 0;
+    uint64_t t0 = trazaAhoraNs();
+    for (int i = 0; i < AMBITOS_MEDIDOS; i++) {
+        suma = suma + i;
+    }
+    uint64_t t1 = trazaAhoraNs();
+    for (int i = 0; i < AMBITOS_MEDIDOS; i++) {
+        TRAZA_AMBITO("medida");
+        suma = suma + i;
+    }
+    uint64_t t2 = trazaAhoraNs();
+    return ((double)(t2 - t1) - (double)(t1 - t0)) / AMBITOS_MEDIDOS;
+}
+
+static void productor(int id) {
+    TRAZA_HILO("productor");
+    mensajeIngesta m;
+    memset(&m, 0, sizeof(m));
+    m.cmd = 1;
+    m.cliente = id;
+    for (int i = 0; i < MENSAJES_POR_PRODUCTOR; i++) {
+        m.lng = (BYTE)(1 + i % LARGO_DATA);
+        memset(m.data, 'a' + id, m.lng);
+        TRAZA_AMBITO_VALOR("publicar", i);
+        while (!colaIngestaPublicar(s_cola, m)) std::this_thread::yield();
+    }
+}
+
+static void empaquetador(int total) {
+    TRAZA_HILO("empaquetador");
+    mensajeIngesta m;
+    protocolo proto;
+    for (int i = 0; i < total;) {
+        if (!colaIngestaTomar(s_cola, m)) {
+            std::this_thread::yield();
+            continue;
+        }
+        {
+            TRAZA_AMBITO_VALOR("empaquetar", m.lng);
+            proto.cmd = m.cmd;
+            proto.lng = m.lng;
+            memcpy(proto.data, m.data, m.lng);
+            empaquetar(proto);
+        }
+        if (++i % MENSAJES_POR_INSTANTE == 0) TRAZA_INSTANTE("mil", i);
+    }
+}
+
+/**
+ * Cada anillo guarda los últimos eventos de su hilo, con los instantes en orden.
+ */
+static bool verificarAnillos() {
+    conjuntoTrazas& c = trazaConjunto();
+    int hilos = c.usados.load();
+    bool ok = true;
+    for (int h = 0; h < hilos && h < TRAZA_HILOS; h++) {
+        const anilloTraza& a = c.anillos[h];
+        uint32_t n = a.escritos.load();
+        uint32_t desde = (n > TRAZA_EVENTOS) ? n - TRAZA_EVENTOS : 0;
+        // Un ámbito se registra al terminar: los fines van en orden aunque haya anidados
+        bool en_orden = true;
+        uint64_t fin_anterior = 0;
+        for (uint32_t i = desde; i < n; i++) {
+            const eventoTraza& e = a.eventos[i % TRAZA_EVENTOS];
+            uint64_t fin = e.inicio_ns + e.duracion_ns;
+            if (fin < fin_anterior) en_orden = false;
+            fin_anterior = fin;
+        }
+        printf("  Hilo %d (%s): %u eventos registrados, %u guardados, en orden: %s\n", h,
+               (a.hilo != NULL) ? a.hilo : "hilo", n, n - desde, en_orden ? "sí" : "NO");
+        ok = ok && en_orden;
+    }
+    return ok;
+}
+
+/**
+ * Relee el volcado: abre y cierra como JSON de Chrome y tiene un objeto por evento.
+ */
+static bool verificarVolcado(const char* ruta, unsigned long volcados) {
+    FILE* f = fopen(ruta, "r");
+    if (f == NULL) return false;
+    char linea[256];
+    unsigned long eventos = 0, metadatos = 0;
+    bool abre = false, cierra = false;
+    while (fgets(linea, sizeof(linea), f) != NULL) {
+        if (strncmp(linea, "{\"traceEvents\":[", 16) == 0) abre = true;
+        else if (strncmp(linea, "],", 2) == 0) cierra = true;
+        if (strstr(linea, "\"ph\":\"M\"") != NULL) metadatos++;
+        else if (strstr(linea, "\"ph\":") != NULL) eventos++;
+    }
+    fclose(f);
+    printf("  %s: %lu eventos y %lu nombres de hilo, JSON completo: %s\n", ruta, eventos, metadatos,
+           (abre && cierra) ? "sí" : "NO");
+    return abre && cierra && eventos == volcados;
+}
+
+int escenarioTrazas(int argc, char** argv) {
+    const char* ruta = (argc > 0) ? argv[0] : "/tmp/trazas_simulador.json";
+
+    TRAZA_HILO("principal");
+    printf("Puntos de traza (%d eventos por anillo, %d anillos)\n", TRAZA_EVENTOS, TRAZA_HILOS);
+    printf("  Costo de un ámbito: %.1f ns (sin TRAZAS las macros no generan código)\n", medirCosto());
+    trazaDescartar();
+
+    colaIngestaIniciar(s_cola);
+    std::thread consumidor(empaquetador, PRODUCTORES * MENSAJES_POR_PRODUCTOR);
+    std::vector<std::thread> productores;
+    for (int p = 0; p < PRODUCTORES; p++) productores.push_back(std::thread(productor, p));
+    for (size_t p = 0; p < productores.size(); p++) productores[p].join();
+    consumidor.join();
+
+    bool ok = verificarAnillos();
+
+    FILE* f = fopen(ruta, "w");
+    if (f == NULL) {
+        printf("No se pudo escribir %s.\n", ruta);
+        return 1;
+    }
+    unsigned long volcados = trazaExportar(trazaEscribirArchivo, f);
+    fclose(f);
+    ok = verificarVolcado(ruta, volcados) && ok;
+    ok = ok && volcados == trazaEventosGuardados();
+
+    // Hilos de más: los que no consiguen anillo no registran
+    int libres = TRAZA_HILOS - trazaConjunto().usados.load();
+    int sobrantes = 2;
+    for (int i = 0; i < libres + sobrantes; i++) {
+        std::thread([] { TRAZA_INSTANTE("sobrante", 0); }).join();
+    }
+    unsigned long perdidos = trazaConjunto().perdidos.load();
+    printf("  %d hilos más que anillos libres: %lu eventos perdidos (esperados %d)\n", sobrantes, perdidos,
+           sobrantes);
+    ok = ok && perdidos == (unsigned long)sobrantes;
+
+    printf("\n  Abrir %s en https://ui.perfetto.dev o chrome://tracing\n", ruta);
+    printf("  Trazas completas y en orden: %s\n", ok ? "sí" : "NO");
+    return ok ? 0 : 1;
+}
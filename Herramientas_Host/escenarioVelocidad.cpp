@@ -0,0 +1,271 @@
+/**
+ * @file escenarioVelocidad.cpp
+ * @brief Velocidad adaptativa (CMD 10) con ruido que cambia en el tiempo.
+ * @details Corre el control del emisor (velocidadAdaptativa.cpp) y el del
+ * receptor (controlEnlace.cpp) con los enviarFrame()/recibirFrame() reales
+ * sobre dos líneas virtuales: la de ida, donde cada delay() del emisor se
+ * atrasa con un jitter que cambia por fase (como el sleep de Linux con más
+ * o menos carga), y la de retorno. Se mide el goodput (bytes de payload
+ * entregados por segundo) de cada velocidad fija y del control adaptativo.
+ * El adaptativo tiene que quedar en cada fase por encima de MINIMO_FASE de
+ * la mejor velocidad fija de esa fase, y en total por encima de la mejor
+ * velocidad fija (si no, convendría dejar la línea fija).
+ */
+
+#include "escenarios.h"
+#include "halHost.h"
+#include "recibe.h"
+#include "controlEnlace.h"
+#include "retorno.h"
+#include "velocidadAdaptativa.h"
+#include "transporte.h"
+#include "funcionesProtocolo.h"
+#include "Arduino.h"
+#include <stdlib.h>
+
+#define FASES 4
+#define PIN_SIMULADO 0
+#define LARGO_DATOS 40
+#define PAUSA_MS 1200           // Entre frames de datos, como la opción 2
+#define MARGEN_RECEPTOR_NS 150000000LL // Línea quieta asegurada tras cada frame
+#define MARGEN_RECEPTOR_BITS 3          // El receptor muestrea hasta medio bit más tarde
+#define NS_POR_S 1000000000LL
+
+// Lo que se le exige al adaptativo contra la mejor fija de cada fase. No
+// llega al 100%: arranca en SPEED, cada cambio de fase le cuesta una
+// resincronización y tiene que volver a probar los escalones de arriba.
+#define MINIMO_FASE 0.55
+
+// Jitter medio del emisor en cada fase (ns): limpio, cargado, muy cargado, leve
+static const int64_t JITTER_FASE[FASES] = {20000, 600000, 2000000, 150000};
+
+/**
+ * Estado de la simulación: las dos líneas, el receptor y lo medido.
+ */
+typedef struct
+{
+    lineaVirtual ida;
+    lineaVirtual vuelta;          // Su reloj es el del emisor cuando no escribe
+    int64_t reloj_receptor;       // Hasta dónde leyó el receptor la ida
+    bool flush_pendiente;         // El receptor quedó en flushRX
+    int velocidad_fija;           // 0 = la decide el control del enlace
+    estadoEnlace enlace;
+    int64_t duracion_fase_ns;
+    unsigned long bytes_fase[FASES];
+    unsigned long frames_ok;
+    unsigned long frames_error;
+} simulacion;
+
+static simulacion* s_sim = NULL;
+
+static int faseDe(int64_t t_ns) {
+    int f = (int)(t_ns / s_sim->duracion_fase_ns);
+    return (f < FASES) ? f : FASES - 1;
+}
+
+/**
+ * flushRX() del receptor: espera 1 s sin flancos de bajada.
+ */
+static void flushVirtual() {
+    unsigned long quieto_desde = millis();
+    while (millis() - quieto_desde < 1000) {
+        if (digitalRead(RX_PIN) == LOW) quieto_desde = millis();
+        delay(1);
+    }
+}
+
+/**
+ * Tarea de recepción + tarea de comandos del receptor, sobre lo que el
+ * emisor ya escribió. Si la línea se acaba a mitad de algo, se deshace
+ * y se reintenta con más línea la próxima vez (el resultado es el mismo).
+ */
+static void avanzarReceptor() {
+    simulacion& s = *s_sim;
+    halUsarLinea(&s.ida);
+    s.ida.jitter_medio_ns = 0; // El reloj de la ESP32 es preciso
+
+    try {
+        for (;;) {
+            s.ida.ahora_ns = s.reloj_receptor;
+            if (s.flush_pendiente) {
+                flushVirtual();
+                s.flush_pendiente = false;
+                s.reloj_receptor = s.ida.ahora_ns;
+            }
+
+            while (digitalRead(RX_PIN) == HIGH);
+            frameReceptor rx;
+            int velocidad = s.velocidad_fija ? s.velocidad_fija : enlaceVelocidad(s.enlace);
+            bool sincronizado = recibirFrame(RX_PIN, velocidad, rx);
+            s.reloj_receptor = s.ida.ahora_ns;
+
+            if (!sincronizado || !desempaquetar(rx)) {
+                s.frames_error++;
+                enlaceFrameInvalido(s.enlace);
+                s.flush_pendiente = !sincronizado;
+                continue;
+            }
+            enlaceFrameValido(s.enlace);
+            s.frames_ok++;
+
+            if (rx.cmd == CMD_ENLACE) {
+                frameReceptor respuesta;
+                if (enlaceProcesar(s.enlace, rx, respuesta)) {
+                    // La respuesta sale por el retorno; la ida no se deja de leer
+                    int64_t reloj_emisor = s.vuelta.ahora_ns;
+                    halUsarLinea(&s.vuelta);
+                    s.vuelta.ahora_ns = s.reloj_receptor + 1000000; // 1 ms en atenderla
+                    int largo = empaquetarRetorno(respuesta);
+                    enviarFrameRetorno(TX_RETORNO_PIN, enlaceVelocidad(s.enlace), respuesta, largo);
+                    enlaceDespuesDeResponder(s.enlace, (uint32_t)(s.vuelta.ahora_ns / 1000000));
+                    s.vuelta.ahora_ns = reloj_emisor;
+                    halUsarLinea(&s.ida);
+                }
+            } else {
+                s.bytes_fase[faseDe(s.reloj_receptor)] += rx.lng;
+            }
+            enlaceRevisar(s.enlace, (uint32_t)(s.reloj_receptor / 1000000));
+        }
+    } catch (const finDeLinea&) {
+        // Se leyó todo lo escrito hasta ahora
+    }
+}
+
+/**
+ * Transporte del emisor: escribe el frame en la ida con el jitter de la
+ * fase, deja avanzar al receptor y vuelve al reloj del emisor.
+ */
+static bool iniciarSimulado(int pin) {
+    return true;
+}
+
+static bool enviarSimulado(int pin, int speed, protocolo& proto, int largo) {
+    simulacion& s = *s_sim;
+    int64_t reloj_emisor = s.vuelta.ahora_ns;
+
+    halUsarLinea(&s.ida);
+    s.ida.ahora_ns = reloj_emisor;
+    s.ida.jitter_medio_ns = JITTER_FASE[faseDe(reloj_emisor)];
+    enviarFrame(pin, speed, proto, largo);
+    reloj_emisor = s.ida.ahora_ns;
+    s.ida.fin_ns = reloj_emisor + MARGEN_RECEPTOR_NS + MARGEN_RECEPTOR_BITS * (NS_POR_S / speed);
+
+    avanzarReceptor();
+
+    halUsarLinea(&s.vuelta);
+    s.vuelta.ahora_ns = reloj_emisor;
+    return true;
+}
+
+static const transporte TRANSPORTE_SIMULADO = {"simulado", iniciarSimulado, enviarSimulado};
+
+/**
+ * Una corrida completa. escalon < 0 = adaptativo.
+ */
+static void correr(simulacion& s, int escalon, int64_t duracion_ns, unsigned semilla) {
+    s.ida = lineaVirtual();
+    s.vuelta = lineaVirtual();
+    s.ida.semilla_jitter = semilla;
+    s.vuelta.fin_ns = duracion_ns * 2; // El emisor puede esperar respuestas en silencio
+    s.reloj_receptor = 0;
+    s.flush_pendiente = false;
+    s.duracion_fase_ns = duracion_ns / FASES;
+    memset(s.bytes_fase, 0, sizeof(s.bytes_fase));
+    s.frames_ok = s.frames_error = 0;
+    enlaceIniciar(s.enlace);
+    s.velocidad_fija = (escalon < 0) ? 0 : velocidadDeEscalon(escalon);
+
+    g_transporte = &TRANSPORTE_SIMULADO;
+    if (escalon < 0) {
+        adaptativoIniciar(PIN_SIMULADO); // En el host los pines no importan
+    } else {
+        g_adaptativo_activo = false;
+        g_velocidad = velocidadDeEscalon(escalon);
+    }
+
+    protocolo tx;
+    memset(&tx, 0, sizeof(protocolo));
+    tx.cmd = 2;
+    tx.lng = LARGO_DATOS;
+    memset(tx.data, 'x', LARGO_DATOS);
+    int largo = empaquetar(tx);
+
+    halUsarLinea(&s.vuelta);
+    while (s.vuelta.ahora_ns < duracion_ns) {
+        g_transporte->enviar(PIN_SIMULADO, g_velocidad, tx, largo);
+        adaptativoDespuesDeEnviar();
+        delay(PAUSA_MS);
+    }
+    halUsarLinea(NULL);
+    g_adaptativo_activo = false;
+}
+
+int escenarioVelocidad(int argc, char** argv) {
+    double minutos_fase = (argc > 0) ? atof(argv[0]) : 30.0;
+    unsigned semilla = (argc > 1) ? (unsigned)atoi(argv[1]) : 1;
+    if (minutos_fase <= 0) {
+        printf("Uso: ./simulador velocidad [minutos_por_fase] [semilla]\n");
+        return 1;
+    }
+    int64_t duracion_ns = (int64_t)(minutos_fase * 60 * FASES) * NS_POR_S;
+    double s_fase = minutos_fase * 60;
+
+    simulacion sim;
+    s_sim = &sim;
+    g_hal_serial_silencio = true;
+    g_enlace_avisos = false;
+
+    printf("Goodput (bytes de payload/s), %d fases de %.0f min, frames de %d bytes\n",
+           FASES, minutos_fase, LARGO_DATOS);
+    printf("  Jitter medio del emisor por fase (ms):");
+    for (int f = 0; f < FASES; f++) printf(" %.2f", JITTER_FASE[f] / 1e6);
+    printf("\n\n  %-12s", "velocidad");
+    for (int f = 0; f < FASES; f++) printf("   fase %d", f + 1);
+    printf("    total\n");
+
+    double mejor_fase[FASES] = {0};
+    double mejor_total = 0;
+    double adapt_fase[FASES];
+    double adapt_total = 0;
+
+    for (int escalon = 0; escalon <= NUM_VELOCIDADES; escalon++) {
+        bool adaptativo = (escalon == NUM_VELOCIDADES);
+        correr(sim, adaptativo ? -1 : escalon, duracion_ns, semilla);
+
+        double total = 0;
+        if (adaptativo) printf("  %-12s", "adaptativo");
+        else printf("  %4d bps    ", velocidadDeEscalon(escalon));
+        for (int f = 0; f < FASES; f++) {
+            double goodput = sim.bytes_fase[f] / s_fase;
+            total += goodput / FASES;
+            printf(" %8.2f", goodput);
+            if (adaptativo) adapt_fase[f] = goodput;
+            else if (goodput > mejor_fase[f]) mejor_fase[f] = goodput;
+        }
+        printf(" %8.2f\n", total);
+        if (adaptativo) adapt_total = total;
+        else if (total > mejor_total) mejor_total = total;
+    }
+    g_hal_serial_silencio = false;
+    g_enlace_avisos = true;
+
+    double mejor_por_fase = 0;
+    printf("\n  %-12s", "mejor fija");
+    for (int f = 0; f < FASES; f++) {
+        printf(" %8.2f", mejor_fase[f]);
+        mejor_por_fase += mejor_fase[f] / FASES;
+    }
+    printf(" %8.2f\n", mejor_por_fase);
+    bool ok = adapt_total >= mejor_total;
+    printf("  %-12s", "% adaptativo");
+    for (int f = 0; f < FASES; f++) {
+        printf(" %7.0f%%", mejor_fase[f] > 0 ? 100.0 * adapt_fase[f] / mejor_fase[f] : 0.0);
+        if (adapt_fase[f] < MINIMO_FASE * mejor_fase[f]) ok = false;
+    }
+    printf("\n");
+    printf("  Adaptativo: %.0f%% de la mejor fija en cada fase, %.0f%% de la mejor fija global\n",
+           100.0 * adapt_total / mejor_por_fase, 100.0 * adapt_total / mejor_total);
+    printf("\n  Al menos %.0f%% de la mejor fija en cada fase y más que cualquier fija en total: %s\n",
+           100.0 * MINIMO_FASE, ok ? "sí" : "NO");
+    return ok ? 0 : 1;
+}
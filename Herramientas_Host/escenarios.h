@@ -0,0 +1,35 @@
+/**
+ * @file escenarios.h
+ * @brief Escenarios del simulador de host.
+ * @details Cada escenario recibe los argumentos que siguen a su nombre
+ * (ej: "./simulador pipeline 5000") y retorna el código de salida.
+ */
+
+#ifndef ESCENARIOS_H
+#define ESCENARIOS_H
+
+int escenarioPipeline(int argc, char** argv);
+int escenarioPlanificador(int argc, char** argv);
+int escenarioTelemetria(int argc, char** argv);
+int escenarioCache(int argc, char** argv);
+int escenarioVelocidad(int argc, char** argv);
+int escenarioDecodificacion(int argc, char** argv);
+int escenarioProtocolo(int argc, char** argv);
+int escenarioPrioridades(int argc, char** argv);
+int escenarioRpc(int argc, char** argv);
+int escenarioMultiEnlace(int argc, char** argv);
+int escenarioSobremuestreo(int argc, char** argv);
+int escenarioNegociacion(int argc, char** argv);
+int escenarioGpiomem(int argc, char** argv);
+int escenarioIngesta(int argc, char** argv);
+int escenarioTrazas(int argc, char** argv);
+int escenarioSesiones(int argc, char** argv);
+int escenarioRepetidor(int argc, char** argv);
+int escenarioEtapas(int argc, char** argv);
+int escenarioSpi(int argc, char** argv);
+int escenarioConflacion(int argc, char** argv);
+int escenarioFlancos(int argc, char** argv);
+int escenarioCaptura(int argc, char** argv);
+int escenarioDecodificacionArchivo(int argc, char** argv);
+
+#endif // ESCENARIOS_H
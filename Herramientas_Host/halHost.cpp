@@ -0,0 +1,201 @@
+/**
+ * @file halHost.cpp
+ * @brief Implementación en el PC de las funciones de Arduino/wiringPi usadas por el receptor y el emisor.
+ * @details Sin línea conectada se usa el reloj real; con una línea virtual
+ * (halUsarLinea) todo corre en tiempo simulado.
+ */
+
+#include "Arduino.h"
+#include "halHost.h"
+#include <stdarg.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+
+SerialHost Serial;
+bool g_hal_serial_silencio = false;
+
+static const std::chrono::steady_clock::time_point s_inicio = std::chrono::steady_clock::now();
+static thread_local lineaVirtual* t_linea = NULL;
+static thread_local lineaVirtual* t_salida = NULL;
+
+void halUsarLinea(lineaVirtual* linea) {
+    t_linea = linea;
+    if (linea != NULL) {
+        // El cursor se conserva: al reconectar una línea larga no se la
+        // vuelve a recorrer desde el principio (lineaNivel sabe retroceder).
+        if (linea->cursor > linea->flancos.size()) linea->cursor = 0;
+        linea->lecturas_seguidas = 0;
+        linea->mira_millis = false;
+    }
+}
+
+void halUsarLineaSalida(lineaVirtual* linea) {
+    t_salida = linea;
+}
+
+int lineaNivel(lineaVirtual& linea, int64_t t_ns) {
+    const std::vector<flanco>& f = linea.flancos;
+    // El lector casi siempre avanza: se mueve el cursor desde donde quedó.
+    // Si retrocede, se busca con búsqueda binaria.
+    if (linea.cursor > 0 && f[linea.cursor - 1].t_ns > t_ns) {
+        size_t lo = 0, hi = linea.cursor;
+        while (lo < hi) {
+            size_t medio = (lo + hi) / 2;
+            if (f[medio].t_ns <= t_ns) lo = medio + 1;
+            else hi = medio;
+        }
+        linea.cursor = lo;
+    }
+    while (linea.cursor < f.size() && f[linea.cursor].t_ns <= t_ns) {
+        linea.cursor++;
+    }
+    return (linea.cursor == 0) ? linea.nivel_reposo : f[linea.cursor - 1].nivel;
+}
+
+int64_t lineaProximaBajada(lineaVirtual& linea, int64_t t_ns) {
+    lineaNivel(linea, t_ns);
+    for (size_t i = linea.cursor; i < linea.flancos.size(); i++) {
+        if (linea.flancos[i].nivel == LOW) return linea.flancos[i].t_ns;
+    }
+    return -1;
+}
+
+int64_t lineaFinSilencio(lineaVirtual& linea, int64_t t_ns, int64_t silencio_ns) {
+    for (;;) {
+        int nivel = lineaNivel(linea, t_ns);
+        size_t i = linea.cursor;
+        if (nivel == LOW) {
+            // Esperar la subida
+            while (i < linea.flancos.size() && linea.flancos[i].nivel != HIGH) i++;
+            if (i >= linea.flancos.size()) return -1;
+            t_ns = linea.flancos[i].t_ns;
+            i++;
+        }
+        // ¿Hay una bajada antes de completar el silencio?
+        while (i < linea.flancos.size() && linea.flancos[i].nivel != LOW) i++;
+        if (i >= linea.flancos.size() || linea.flancos[i].t_ns >= t_ns + silencio_ns) {
+            return t_ns + silencio_ns;
+        }
+        t_ns = linea.flancos[i].t_ns;
+    }
+}
+
+void pinMode(int pin, int modo) { (void)pin; (void)modo; }
+
+// digitalRead() seguidos que se consideran un bucle de espera activa
+#define LECTURAS_ESPERA_ACTIVA 4
+
+int digitalRead(int pin) {
+    (void)pin;
+    if (t_linea == NULL) return HIGH; // Sin línea conectada: reposo
+
+    lineaVirtual& l = *t_linea;
+    if (l.ahora_ns > l.fin_ns) throw finDeLinea();
+    int nivel = lineaNivel(l, l.ahora_ns);
+
+    // Espera activa: nada observable cambia hasta el próximo flanco
+    // (o hasta que millis() cambie, si el bucle lo está mirando)
+    if (++l.lecturas_seguidas >= LECTURAS_ESPERA_ACTIVA) {
+        int64_t siguiente = (l.cursor < l.flancos.size()) ? l.flancos[l.cursor].t_ns : l.fin_ns + 1;
+        if (l.mira_millis) {
+            int64_t proximo_ms = (l.ahora_ns / 1000000 + 1) * 1000000;
+            if (proximo_ms < siguiente) siguiente = proximo_ms;
+        }
+        if (siguiente > l.ahora_ns) l.ahora_ns = siguiente;
+        l.lecturas_seguidas = 0;
+        return nivel;
+    }
+    l.ahora_ns += l.paso_lectura_ns;
+    return nivel;
+}
+
+void digitalWrite(int pin, int nivel) {
+    (void)pin;
+    if (t_linea == NULL) return;
+
+    // El emisor escribe siempre hacia adelante: el flanco va al final
+    lineaVirtual& l = (t_salida != NULL) ? *t_salida : *t_linea;
+    int64_t ahora_ns = t_linea->ahora_ns;
+    int actual = l.flancos.empty() ? l.nivel_reposo : l.flancos.back().nivel;
+    if (nivel != actual) {
+        flanco f = {ahora_ns, (uint8_t)nivel};
+        l.flancos.push_back(f);
+    }
+    if (ahora_ns > l.fin_ns) l.fin_ns = ahora_ns;
+}
+
+/**
+ * Atraso extra de un delay(): exponencial con media 'jitter_medio_ns'.
+ */
+static int64_t jitter(lineaVirtual& l) {
+    if (l.jitter_medio_ns <= 0) return 0;
+    // xorshift64: reproducible con la semilla de la línea
+    l.semilla_jitter ^= l.semilla_jitter << 13;
+    l.semilla_jitter ^= l.semilla_jitter >> 7;
+    l.semilla_jitter ^= l.semilla_jitter << 17;
+    double u = ((l.semilla_jitter >> 11) + 0.5) / 9007199254740992.0; // (0, 1)
+    return (int64_t)(-log(u) * l.jitter_medio_ns);
+}
+
+void delay(unsigned long ms) {
+    if (t_linea != NULL) {
+        t_linea->ahora_ns += (int64_t)ms * 1000000 + jitter(*t_linea);
+        t_linea->lecturas_seguidas = 0;
+        t_linea->mira_millis = false;
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+    if (t_linea != NULL) {
+        t_linea->ahora_ns += (int64_t)us * 1000 + jitter(*t_linea);
+        t_linea->lecturas_seguidas = 0;
+        t_linea->mira_millis = false;
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+unsigned long millis() {
+    if (t_linea != NULL) {
+        t_linea->mira_millis = true;
+        return (unsigned long)(t_linea->ahora_ns / 1000000);
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - s_inicio).count();
+}
+
+unsigned long micros() {
+    if (t_linea != NULL) {
+        t_linea->lecturas_seguidas = 0;
+        t_linea->mira_millis = false;
+        return (unsigned long)(t_linea->ahora_ns / 1000);
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - s_inicio).count();
+}
+
+int wiringPiSetupGpio() {
+    return 0;
+}
+
+void pullUpDnControl(int pin, int modo) { (void)pin; (void)modo; }
+
+int SerialHost::printf(const char* formato, ...) {
+    if (g_hal_serial_silencio) return 0;
+    va_list args;
+    va_start(args, formato);
+    int n = vprintf(formato, args);
+    va_end(args);
+    return n;
+}
+
+void SerialHost::print(const char* texto) {
+    if (!g_hal_serial_silencio) fputs(texto, stdout);
+}
+
+void SerialHost::println(const char* texto) {
+    if (!g_hal_serial_silencio) puts(texto);
+}
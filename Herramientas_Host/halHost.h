@@ -0,0 +1,88 @@
+/**
+ * @file halHost.h
+ * @brief Línea de transmisión virtual para ejecutar el receptor en el PC.
+ * @details Con una línea conectada, digitalRead() devuelve el nivel de la
+ * línea en el instante virtual actual y delay()/millis()/micros() usan ese
+ * reloj virtual en lugar del reloj real. Un bucle que solo lee la línea
+ * (ej: "while (digitalRead(pin) == HIGH);") salta directo al próximo flanco,
+ * así esperar horas de reposo no cuesta nada. Si el bucle además mira
+ * millis() (un timeout), el salto no pasa del próximo cambio de milisegundo.
+ * digitalWrite() agrega un flanco en el instante virtual actual: el emisor
+ * escribe la línea que después lee el receptor. Con 'jitter_medio_ns', cada
+ * delay() se atrasa un tiempo aleatorio (exponencial), como el sleep de
+ * Linux en la RPi: los flancos del emisor se corren y a velocidades altas
+ * el receptor empieza a fallar. Cada hilo tiene su propia
+ * línea, así varios receptores simulados pueden correr en paralelo.
+ */
+
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * @brief Cambio de nivel de la línea en el instante 't_ns'.
+ */
+typedef struct
+{
+    int64_t t_ns;
+    uint8_t nivel;
+} flanco;
+
+/**
+ * @brief Línea virtual: lista de flancos ordenados en el tiempo.
+ */
+typedef struct lineaVirtual
+{
+    std::vector<flanco> flancos;
+    int nivel_reposo;        // Nivel antes del primer flanco (HIGH)
+    int64_t ahora_ns;        // Reloj virtual del lector
+    int64_t paso_lectura_ns; // Costo de un digitalRead() (1 us, como en la ESP32)
+    int64_t fin_ns;          // Leer después de este instante lanza finDeLinea
+    size_t cursor;           // Primer flanco posterior a 'ahora_ns'
+    int lecturas_seguidas;   // digitalRead() seguidos sin delay() entre medio
+    bool mira_millis;        // Hubo millis() entre esas lecturas (bucle con timeout)
+    int64_t jitter_medio_ns; // Atraso extra medio de cada delay() (0 = reloj exacto)
+    uint64_t semilla_jitter;
+
+    lineaVirtual() : nivel_reposo(1), ahora_ns(0), paso_lectura_ns(1000), fin_ns(0), cursor(0),
+                     lecturas_seguidas(0), mira_millis(false), jitter_medio_ns(0), semilla_jitter(1) {}
+} lineaVirtual;
+
+/**
+ * @brief Se lanza cuando el lector pasa del final de la línea
+ * (ej: esperando un bit de inicio que nunca llega).
+ */
+struct finDeLinea {};
+
+/**
+ * @brief Conecta una línea virtual al hilo actual (NULL = reloj real).
+ */
+void halUsarLinea(lineaVirtual* linea);
+
+/**
+ * @brief Desde ahora digitalWrite() escribe en 'linea' (NULL = la misma que
+ * se lee) con el reloj de la línea conectada: un repetidor lee una línea y
+ * escribe la siguiente.
+ */
+void halUsarLineaSalida(lineaVirtual* linea);
+
+/**
+ * @brief Nivel de la línea en el instante 't_ns' (avanza el cursor).
+ */
+int lineaNivel(lineaVirtual& linea, int64_t t_ns);
+
+/**
+ * @brief Instante del próximo flanco de bajada desde 't_ns', o -1 si no hay.
+ */
+int64_t lineaProximaBajada(lineaVirtual& linea, int64_t t_ns);
+
+/**
+ * @brief Mismo criterio que flushRX() del receptor: el primer instante desde
+ * 't_ns' en que la línea lleva 'silencio_ns' en HIGH, o -1 si no pasa.
+ */
+int64_t lineaFinSilencio(lineaVirtual& linea, int64_t t_ns, int64_t silencio_ns);
+
+#endif // HAL_HOST_H
@@ -0,0 +1,66 @@
+/**
+ * @file simulador.cpp
+ * @brief Punto de entrada del simulador de host.
+ * @details Ejecuta en el PC la lógica del emisor y del receptor que no
+ * depende del hardware, para medirla sin RPi ni ESP32.
+ */
+
+#include "escenarios.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct
+{
+    const char* nombre;
+    const char* descripcion;
+    int (*funcion)(int argc, char** argv);
+} escenario;
+
+static const escenario ESCENARIOS[] = {
+    {"pipeline", "Recepción (core 0) y comandos (core 1) con pool de frames", escenarioPipeline},
+    {"planificador", "Parpadeo del LED 1-100 Hz: sondeo de millis() vs planificador", escenarioPlanificador},
+    {"telemetria", "Lotes de temperatura codificados por diferencias vs texto", escenarioTelemetria},
+    {"cache", "Caché de frames (CMD 9) con pérdidas: ahorro y consistencia", escenarioCache},
+    {"velocidad", "Velocidad adaptativa (CMD 10) vs velocidades fijas con ruido variable", escenarioVelocidad},
+    {"decodificacion", "Decodificación en el lugar vs memset + copia: ns por frame y RAM", escenarioDecodificacion},
+    {"protocolo", "frameProtocolo.h contra la codificación anterior y frames fijos", escenarioProtocolo},
+    {"prioridades", "Clases de prioridad y fragmentos (CMD 11) con tráfico mezclado", escenarioPrioridades},
+    {"rpc", "Pedidos RPC (CMD 12) en vuelo vs pedido y espera, con pérdidas", escenarioRpc},
+    {"multienlace", "Varios enlaces desde un hilo con salida GPIO simulada", escenarioMultiEnlace},
+    {"sobremuestreo", "Sobremuestreo con voto de mayoría vs una lectura por bit, con ruido", escenarioSobremuestreo},
+    {"negociacion", "Negociación de velocidad, parada y FCS (CMD 10) con varios receptores", escenarioNegociacion},
+    {"gpiomem", "Registros GPIO mapeados (/dev/gpiomem) sobre un archivo: máscaras y flancos", escenarioGpiomem},
+    {"ingesta", "Lotes de mensajes de muchos clientes por socket Unix: latencia y reparto", escenarioIngesta},
+    {"trazas", "Puntos de traza: costo, un anillo por hilo y volcado JSON de Chrome", escenarioTrazas},
+    {"sesiones", "Sesiones sin pila en un solo hilo: costo del cambio y miles de conversaciones", escenarioSesiones},
+    {"repetidor", "Cadenas de 2 a 10 repetidores (CMD 13): cut-through, errores y lazos", escenarioRepetidor},
+    {"etapas", "Latencia por etapas del menú al OLED: emparejamiento y percentiles", escenarioEtapas},
+    {"spi", "Forma de onda del transporte spi (MOSI) recibida con recibirFrame()", escenarioSpi},
+    {"conflacion", "Conflación por clave (CMD 2, 3, 5) con un productor más rápido que la línea", escenarioConflacion},
+    {"flancos", "Desvío de flancos: costo por flanco y resumen del último frame entre hilos", escenarioFlancos},
+    {"captura", "Registro de capturas: anillo, costo por frame y reproducción por la línea", escenarioCaptura},
+    {"decodificacion-archivo", "Decodificador de capturas: crudo (1 y N hilos, sin SSE2) y VCD del emisor",
+     escenarioDecodificacionArchivo},
+};
+
+static void mostrarAyuda() {
+    printf("Uso: ./simulador <escenario> [argumentos]\n\nEscenarios:\n");
+    for (size_t i = 0; i < sizeof(ESCENARIOS) / sizeof(ESCENARIOS[0]); ++i) {
+        printf("  %-14s %s\n", ESCENARIOS[i].nombre, ESCENARIOS[i].descripcion);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        mostrarAyuda();
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(ESCENARIOS) / sizeof(ESCENARIOS[0]); ++i) {
+        if (strcmp(argv[1], ESCENARIOS[i].nombre) == 0) {
+            return ESCENARIOS[i].funcion(argc - 2, argv + 2);
+        }
+    }
+    printf("Escenario desconocido: %s\n", argv[1]);
+    mostrarAyuda();
+    return 1;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file Arduino.h
+ * @brief Reemplazo mínimo de Arduino.h para compilar la lógica del receptor en el PC.
+ * @details Solo declara lo que usan los archivos del receptor que no tocan
+ * el OLED. La implementación está en halHost.cpp.
+ */
+
+#ifndef ARDUINO_H_HOST
+#define ARDUINO_H_HOST
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+void pinMode(int pin, int modo);
+int digitalRead(int pin);
+void digitalWrite(int pin, int nivel);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+
+/**
+ * @brief Imitación del objeto 'Serial' de Arduino.
+ * @details Escribe en stdout salvo que 'g_hal_serial_silencio' esté activo
+ * (los escenarios del simulador lo activan para no medir printf).
+ */
+class SerialHost {
+public:
+    void begin(unsigned long baudios) { (void)baudios; }
+    int printf(const char* formato, ...) __attribute__((format(printf, 2, 3)));
+    void print(const char* texto);
+    void println(const char* texto = "");
+};
+
+extern SerialHost Serial;
+extern bool g_hal_serial_silencio;
+
+#endif // ARDUINO_H_HOST
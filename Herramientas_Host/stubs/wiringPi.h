@@ -0,0 +1,19 @@
+/**
+ * @file wiringPi.h
+ * @brief Reemplazo de wiringPi.h para compilar la lógica del emisor en el PC.
+ * @details El emisor usa las mismas funciones que Arduino (digitalWrite,
+ * delay...), así que comparte la implementación de halHost.cpp: con una
+ * línea virtual conectada, lo que escribe el emisor lo puede leer el receptor.
+ */
+
+#ifndef WIRINGPI_H_HOST
+#define WIRINGPI_H_HOST
+
+#include "Arduino.h"
+
+#define PUD_UP 2
+
+int wiringPiSetupGpio();
+void pullUpDnControl(int pin, int modo);
+
+#endif // WIRINGPI_H_HOST
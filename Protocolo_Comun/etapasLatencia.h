@@ -0,0 +1,122 @@
+/**
+ * @file etapasLatencia.h
+ * @brief Registros de la latencia por etapas (RPC_ETAPAS), comunes para el
+ * emisor, el receptor y las herramientas de host.
+ * @details La ESP32 anota, para cada frame válido, cuánto tardó cada etapa
+ * de su lado: la línea, la espera en el pipeline, desempaquetar, ejecutar
+ * y escribir el OLED. El emisor los pide con RPC_ETAPAS y los empareja con
+ * sus propios envíos (pedido, cola y transmisión) sin cambiar el formato
+ * del frame: la clave de un frame es su FCS tal como viajó por el cable.
+ * Los CMD 13 (reenvioFrame.h) cambian el FCS en cada salto, así que su
+ * clave es el par (origen, secuencia) del sobre. Dos frames idénticos
+ * tienen la misma clave, y con el FCS de conteo de unos también la tienen
+ * muchos frames distintos del mismo comando: el emisor elige el que
+ * coincide con el desfase entre los relojes de las dos placas y cuenta
+ * como ambiguos los que el desfase no separa (ver latenciaEtapas.h).
+ *
+ * Cada registro viaja en ETAPAS_REGISTRO_BYTES, en big endian:
+ *
+ *   [clave 2][cmd en la línea][cmd ejecutado][fin de la línea 4]
+ *   [línea 4][pipeline 4][desempaquetar 4][ejecutar 4][display 4]
+ *
+ * Los tiempos son micros() de la ESP32. Pedido [desde 2]; respuesta
+ * [cantidad][número del primero 2] y los registros. Header-only y C++11,
+ * como frameProtocolo.h.
+ */
+
+#ifndef ETAPAS_LATENCIA_H
+#define ETAPAS_LATENCIA_H
+
+#include "reenvioFrame.h"
+
+/**
+ * @brief Método RPC (CMD 12) que devuelve los registros.
+ */
+#define RPC_ETAPAS 3
+
+#define ETAPAS_REGISTRO_BYTES 28
+#define ETAPAS_CABECERA_RESPUESTA 3
+
+/**
+ * @brief Registros por respuesta: los que entran en el payload del CMD 12
+ * (FrameEstandar::PAYLOAD_MAX menos la cabecera RPC de 3 bytes).
+ */
+#define ETAPAS_POR_RESPUESTA 2
+
+/**
+ * @brief 'cmd' de un frame válido que no ejecutó nada (un fragmento que
+ * no completa su mensaje, un CMD 9 sin el payload en la caché, un CMD 13
+ * que no se puede abrir).
+ */
+#define ETAPAS_SIN_EJECUTAR 0xFF
+
+static_assert(ETAPAS_CABECERA_RESPUESTA + ETAPAS_POR_RESPUESTA * ETAPAS_REGISTRO_BYTES <=
+                  FrameEstandar::PAYLOAD_MAX - 3,
+              "Los registros de RPC_ETAPAS no entran en una respuesta");
+
+typedef struct
+{
+    uint16_t clave;
+    uint8_t cmd_linea;         // Como llegó (ej: 11, 9 o 13)
+    uint8_t cmd;               // El que se ejecutó, o ETAPAS_SIN_EJECUTAR
+    uint32_t fin_us;           // Fin de la línea, en el reloj de la ESP32
+    uint32_t linea_us;
+    uint32_t pipeline_us;      // Desde el fin de la línea hasta que lo toma la tarea de comandos
+    uint32_t decodificar_us;
+    uint32_t ejecutar_us;      // Sin el display
+    uint32_t display_us;       // En display.display()
+} registroEtapas;
+
+/**
+ * @brief Clave de un frame: el FCS escrito, o (origen, secuencia) de un CMD 13.
+ * @param datos El payload del frame.
+ */
+static inline uint16_t etapasClave(int cmd, const uint8_t* datos, uint16_t fcs) {
+    if (cmd == CMD_REENVIO) {
+        return (uint16_t)((datos[REENVIO_ORIGEN] << 8) | datos[REENVIO_SECUENCIA]);
+    }
+    return fcs;
+}
+
+static inline int etapasPoner32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+    return 4;
+}
+
+static inline uint32_t etapasLeer32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/**
+ * @brief Escribe 'r' en 'p' (ETAPAS_REGISTRO_BYTES).
+ */
+static inline void etapasPoner(uint8_t* p, const registroEtapas& r) {
+    p[0] = (uint8_t)(r.clave >> 8);
+    p[1] = (uint8_t)r.clave;
+    p[2] = r.cmd_linea;
+    p[3] = r.cmd;
+    int n = 4;
+    n += etapasPoner32(p + n, r.fin_us);
+    n += etapasPoner32(p + n, r.linea_us);
+    n += etapasPoner32(p + n, r.pipeline_us);
+    n += etapasPoner32(p + n, r.decodificar_us);
+    n += etapasPoner32(p + n, r.ejecutar_us);
+    etapasPoner32(p + n, r.display_us);
+}
+
+static inline void etapasLeer(const uint8_t* p, registroEtapas& r) {
+    r.clave = (uint16_t)((p[0] << 8) | p[1]);
+    r.cmd_linea = p[2];
+    r.cmd = p[3];
+    r.fin_us = etapasLeer32(p + 4);
+    r.linea_us = etapasLeer32(p + 8);
+    r.pipeline_us = etapasLeer32(p + 12);
+    r.decodificar_us = etapasLeer32(p + 16);
+    r.ejecutar_us = etapasLeer32(p + 20);
+    r.display_us = etapasLeer32(p + 24);
+}
+
+#endif // ETAPAS_LATENCIA_H
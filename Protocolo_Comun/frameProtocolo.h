@@ -0,0 +1,231 @@
+/**
+ * @file frameProtocolo.h
+ * @brief Formato del frame, único para el emisor (RPi), el receptor (ESP32)
+ * y las herramientas de host.
+ * @details Header-only y sin headers de hardware. Un frame es:
+ *
+ *   [CMD << 2] [LNG << 1] [payload: LNG bytes] [FCS alto] [FCS bajo]
+ *
+ * Frame<PAYLOAD_MAX, Fcs, Cabecera> fija el tamaño máximo del payload, cómo
+ * se calcula el FCS y dónde van CMD y LNG en la cabecera. Los anchos de
+ * campo, desplazamientos y tamaños de buffer se verifican al compilar.
+ *
+ * Todo lo que no escribe memoria es constexpr, así que un frame fijo (sin
+ * payload, como los CMD 0, 4 y 6) queda calculado al compilar con
+ * Frame::fijo<CMD>(). Se usa solo C++11 (constexpr de una expresión):
+ * el core de Arduino para ESP32 compila con -std=gnu++11.
+ *
+ * En la ESP32 esta carpeta se agrega como biblioteca:
+ *   arduino-cli compile --library ../Protocolo_Comun ...
+ * o copiándola a la carpeta "libraries" del IDE.
+ */
+
+#ifndef FRAME_PROTOCOLO_H
+#define FRAME_PROTOCOLO_H
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Cantidad de bits en 1 de un byte.
+ */
+static inline constexpr unsigned bitsEnUno(uint8_t b) {
+    return b == 0 ? 0 : (b & 1u) + bitsEnUno((uint8_t)(b >> 1));
+}
+
+/**
+ * @brief Política de FCS: cantidad de bits en 1 de cabecera + payload.
+ * @details Una política define el valor inicial, cómo se acumula cada
+ * byte y hasta cuántos bytes el resultado entra en 16 bits.
+ */
+struct FcsPopcount
+{
+    static constexpr uint16_t inicial() { return 0; }
+    static constexpr uint16_t acumular(uint16_t fcs, uint8_t b) {
+        return (uint16_t)(fcs + bitsEnUno(b));
+    }
+    static constexpr bool cabe(long bytes) { return 8L * bytes <= 0xFFFF; }
+};
+
+/**
+ * @brief Política de FCS: CRC-16/CCITT (polinomio 0x1021, inicial 0xFFFF).
+ * @details Detecta todos los errores de 1 y 2 bits y las ráfagas de hasta
+ * 16 bits, que el conteo de bits deja pasar cuando un 1 y un 0 se cambian
+ * de lugar. La línea de ida la usa cuando las dos puntas la acuerdan
+ * (NEG_FCS_CRC16, ver negociacionEnlace.h); el barrido de parámetros
+ * (barrido.cpp) la compara con el conteo.
+ */
+struct FcsCrc16
+{
+    static constexpr uint16_t inicial() { return 0xFFFF; }
+    static constexpr uint16_t acumular(uint16_t fcs, uint8_t b) {
+        return paso((uint16_t)(fcs ^ (b << 8)), 8);
+    }
+    static constexpr bool cabe(long bytes) { return bytes >= 0; }
+
+private:
+    static constexpr uint16_t paso(uint16_t crc, int bits) {
+        return bits == 0 ? crc
+                         : paso((uint16_t)((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1), bits - 1);
+    }
+};
+
+/**
+ * @brief Forma de la señal en la línea. No cambia el frame, solo cómo se
+ * transmite cada byte: emisor y receptor tienen que usar la misma.
+ */
+struct FormatoLinea
+{
+    int bits_parada;   // Bits en HIGH después de cada byte (el receptor verifica todos)
+    int muestreo_pct;  // Dónde se lee cada bit, en % de su duración desde el flanco
+
+    // Solo del receptor (el emisor los ignora)
+    int muestras_por_bit; // 0 = una lectura por bit; 8..16 = sobremuestreo con voto de mayoría
+    int glitch_max;       // Pulsos de hasta tantas muestras se descartan (con sobremuestreo)
+};
+
+/**
+ * @brief La de producción: 2 bits de parada y lectura en el centro del bit.
+ */
+static constexpr FormatoLinea FORMATO_LINEA_ESTANDAR = {2, 50, 0, 0};
+
+/**
+ * @brief Cabecera de dos bytes: CMD en el primero y LNG en el segundo,
+ * cada uno con su ancho en bits y su desplazamiento.
+ */
+template <int BITS_CMD, int DESP_CMD, int BITS_LNG, int DESP_LNG>
+struct CabeceraDosBytes
+{
+    static_assert(BITS_CMD > 0 && DESP_CMD >= 0 && BITS_CMD + DESP_CMD <= 8,
+                  "CMD no entra en el primer byte de la cabecera");
+    static_assert(BITS_LNG > 0 && DESP_LNG >= 0 && BITS_LNG + DESP_LNG <= 8,
+                  "LNG no entra en el segundo byte de la cabecera");
+
+    static constexpr int BYTES = 2;
+    static constexpr int CMD_MAX = (1 << BITS_CMD) - 1;
+    static constexpr int LNG_MAX = (1 << BITS_LNG) - 1;
+
+    static constexpr uint8_t byteCmd(int cmd) { return (uint8_t)((cmd & CMD_MAX) << DESP_CMD); }
+    static constexpr uint8_t byteLng(int lng) { return (uint8_t)((lng & LNG_MAX) << DESP_LNG); }
+    static constexpr int cmdDe(uint8_t b) { return (b >> DESP_CMD) & CMD_MAX; }
+    static constexpr int lngDe(uint8_t b) { return (b >> DESP_LNG) & LNG_MAX; }
+};
+
+/**
+ * @brief La cabecera del proyecto: CMD de 4 bits << 2 y LNG de 6 bits << 1.
+ */
+typedef CabeceraDosBytes<4, 2, 6, 1> CabeceraEstandar;
+
+/**
+ * @brief Codificación y decodificación de frames.
+ * @details Trabaja sobre un buffer de LARGO_MAX bytes con el frame tal
+ * como viaja por la línea; no tiene estado.
+ */
+template <int PAYLOAD, typename Fcs = FcsPopcount, typename Cabecera = CabeceraEstandar>
+struct Frame
+{
+    static_assert(PAYLOAD > 0, "El payload máximo tiene que ser positivo");
+    static_assert(PAYLOAD <= Cabecera::LNG_MAX, "El campo LNG de la cabecera no alcanza para el payload máximo");
+    static_assert(Cabecera::BYTES == 2, "El FCS va después de una cabecera de dos bytes");
+    static_assert(Fcs::cabe(PAYLOAD + Cabecera::BYTES), "El FCS no entra en 16 bits con este payload");
+
+    static constexpr int PAYLOAD_MAX = PAYLOAD;
+    static constexpr int BYTES_CABECERA = Cabecera::BYTES;
+    static constexpr int BYTES_FCS = 2;
+    // Cabecera + FCS (el nombre BYTES_EXTRA lo usan las macros de structProtocolo.h)
+    static constexpr int BYTES_CONTROL = BYTES_CABECERA + BYTES_FCS;
+    static constexpr int LARGO_MAX = PAYLOAD + BYTES_CONTROL;
+    static constexpr int CMD_MAX = Cabecera::CMD_MAX;
+
+    // --- Lectura (constexpr) ---
+
+    static constexpr int largo(int lng) { return lng + BYTES_CONTROL; }
+    static constexpr bool lngValido(int lng) { return lng >= 0 && lng <= PAYLOAD; }
+    static constexpr int cmdDe(const uint8_t* frame) { return Cabecera::cmdDe(frame[0]); }
+    static constexpr int lngDe(const uint8_t* frame) { return Cabecera::lngDe(frame[1]); }
+
+    /**
+     * @brief FCS de 'n' bytes. Es recursiva por la cola: en ejecución el
+     * compilador la convierte en un bucle.
+     */
+    static constexpr uint16_t fcsDe(const uint8_t* bytes, int n, uint16_t acumulado = Fcs::inicial()) {
+        return n <= 0 ? acumulado : fcsDe(bytes + 1, n - 1, Fcs::acumular(acumulado, bytes[0]));
+    }
+
+    /**
+     * @brief FCS escrito en el frame (big endian, después del payload).
+     */
+    static constexpr uint16_t fcsEscrito(const uint8_t* frame, int lng) {
+        return (uint16_t)((frame[BYTES_CABECERA + lng] << 8) | frame[BYTES_CABECERA + lng + 1]);
+    }
+
+    static constexpr bool fcsValido(const uint8_t* frame, int lng) {
+        return lngValido(lng) && fcsDe(frame, BYTES_CABECERA + lng) == fcsEscrito(frame, lng);
+    }
+
+    /**
+     * @brief Bit de paridad del frame: true (HIGH) si la cantidad de bits
+     * en 1 de los 'n' bytes es impar.
+     */
+    static constexpr bool paridadDe(const uint8_t* bytes, int n, unsigned unos = 0) {
+        return n <= 0 ? (unos % 2) != 0 : paridadDe(bytes + 1, n - 1, unos + bitsEnUno(bytes[0]));
+    }
+
+    // --- Escritura ---
+
+    /**
+     * @brief Completa cabecera y FCS alrededor de un payload que ya está
+     * en frame[BYTES_CABECERA..]. Retorna el largo total del frame.
+     */
+    static int cerrar(uint8_t* frame, int cmd, int lng) {
+        frame[0] = Cabecera::byteCmd(cmd);
+        frame[1] = Cabecera::byteLng(lng);
+        uint16_t fcs = fcsDe(frame, BYTES_CABECERA + lng);
+        frame[BYTES_CABECERA + lng] = (uint8_t)(fcs >> 8);
+        frame[BYTES_CABECERA + lng + 1] = (uint8_t)(fcs & 0xFF);
+        return largo(lng);
+    }
+
+    /**
+     * @brief Copia el payload al frame y lo cierra.
+     */
+    static int codificar(uint8_t* frame, int cmd, const uint8_t* payload, int lng) {
+        memmove(frame + BYTES_CABECERA, payload, lng);
+        return cerrar(frame, cmd, lng);
+    }
+
+    // --- Frames fijos (sin payload), calculados al compilar ---
+
+    struct Fijo
+    {
+        uint8_t bytes[BYTES_CONTROL];
+        int cmd;
+        int largo;
+        bool paridad;
+
+        constexpr Fijo(int c)
+            : bytes{Cabecera::byteCmd(c), Cabecera::byteLng(0),
+                    (uint8_t)(fcsVacio(c) >> 8), (uint8_t)(fcsVacio(c) & 0xFF)},
+              cmd(c), largo(BYTES_CONTROL),
+              paridad(((bitsEnUno(Cabecera::byteCmd(c)) + bitsEnUno(Cabecera::byteLng(0)) +
+                        bitsEnUno((uint8_t)(fcsVacio(c) >> 8)) + bitsEnUno((uint8_t)(fcsVacio(c) & 0xFF))) % 2) != 0) {}
+    };
+
+    template <int CMD>
+    static constexpr Fijo fijo() {
+        static_assert(CMD >= 0 && CMD <= CMD_MAX, "CMD fuera del ancho del campo");
+        return Fijo(CMD);
+    }
+
+private:
+    static constexpr uint16_t fcsVacio(int cmd) {
+        return Fcs::acumular(Fcs::acumular(Fcs::inicial(), Cabecera::byteCmd(cmd)), Cabecera::byteLng(0));
+    }
+};
+
+/**
+ * @brief El frame del proyecto: hasta 63 bytes de payload y FCS por conteo de bits.
+ */
+typedef Frame<63, FcsPopcount, CabeceraEstandar> FrameEstandar;
+
+#endif // FRAME_PROTOCOLO_H
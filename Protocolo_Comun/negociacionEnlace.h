@@ -0,0 +1,152 @@
+/**
+ * @file negociacionEnlace.h
+ * @brief Negociación de los parámetros del enlace (CMD 10), común para el
+ * emisor, el receptor y las herramientas de host.
+ * @details Cada punta anuncia lo que soporta (capacidades) y el receptor
+ * elige la mejor configuración que soportan las dos: la velocidad más alta,
+ * la menor cantidad de bits de parada, el FCS más fuerte y el payload
+ * máximo más chico. Al arrancar la negociación viaja con la configuración
+ * base, que todas las versiones conocen; pedida después, con la que esté
+ * en uso. Un receptor que no entiende el pedido no contesta y el emisor
+ * sigue como estaba.
+ *
+ *   NEGOCIA [4][seq][capacidades: versión, velocidades, paradas, fcs, lng_max]
+ *   ACUERDO [5][seq][configuración: idx, bits_parada, fcs, lng_max]
+ *
+ * 'velocidades' es una máscara sobre la escalera VELOCIDADES_BPS (bit 0 =
+ * la base), 'paradas' tiene el bit N si soporta N bits de parada y 'fcs'
+ * el bit de cada algoritmo (NEG_FCS_*). Header-only y C++11, como
+ * frameProtocolo.h.
+ */
+
+#ifndef NEGOCIACION_ENLACE_H
+#define NEGOCIACION_ENLACE_H
+
+#include "frameProtocolo.h"
+
+#define NEGOCIACION_VERSION 1
+
+#define ENLACE_NEGOCIA 4
+#define ENLACE_ACUERDO 5
+
+/**
+ * @brief Algoritmos de FCS. Los dos son de 16 bits: el frame no cambia de largo.
+ */
+#define NEG_FCS_CONTEO 0   // FrameEstandar: conteo de bits en 1
+#define NEG_FCS_CRC16 1    // CRC-16/CCITT
+
+#define NEG_BYTES_CAPACIDADES 5
+#define NEG_BYTES_CONFIGURACION 4
+
+/**
+ * @brief El frame estándar con CRC-16 en lugar del conteo de bits.
+ */
+typedef Frame<63, FcsCrc16, CabeceraEstandar> FrameEstandarCrc16;
+
+/**
+ * @brief Lo que soporta una punta.
+ */
+struct CapacidadesEnlace
+{
+    uint8_t version;
+    uint8_t velocidades;  // Bit i = escalón i de VELOCIDADES_BPS
+    uint8_t paradas;      // Bit N = N bits de parada
+    uint8_t fcs;          // Bit NEG_FCS_* = algoritmo
+    uint8_t lng_max;      // Payload máximo que acepta
+};
+
+/**
+ * @brief La configuración en uso en la línea de ida.
+ */
+struct ConfiguracionEnlace
+{
+    uint8_t idx_velocidad;
+    uint8_t bits_parada;
+    uint8_t fcs;
+    uint8_t lng_max;
+};
+
+/**
+ * @brief La que las dos puntas conocen siempre: arranque y vuelta atrás.
+ */
+static constexpr ConfiguracionEnlace CONFIGURACION_BASE = {0, 2, NEG_FCS_CONTEO, 63};
+
+static inline bool configuracionIgual(const ConfiguracionEnlace& a, const ConfiguracionEnlace& b) {
+    return a.idx_velocidad == b.idx_velocidad && a.bits_parada == b.bits_parada && a.fcs == b.fcs &&
+           a.lng_max == b.lng_max;
+}
+
+/**
+ * @brief La mejor configuración soportada por las dos puntas.
+ * @return false si no tienen en común ni la base (no debería pasar).
+ */
+static inline bool acordarEnlace(const CapacidadesEnlace& a, const CapacidadesEnlace& b,
+                                 ConfiguracionEnlace& acuerdo) {
+    uint8_t velocidades = a.velocidades & b.velocidades;
+    uint8_t paradas = a.paradas & b.paradas;
+    uint8_t fcs = a.fcs & b.fcs;
+    if (velocidades == 0 || (paradas & 0x1E) == 0 || fcs == 0) return false;
+
+    acuerdo.idx_velocidad = 0;
+    for (int i = 7; i > 0; i--) {
+        if (velocidades & (1 << i)) { acuerdo.idx_velocidad = (uint8_t)i; break; }
+    }
+    acuerdo.bits_parada = 1;
+    while (!(paradas & (1 << acuerdo.bits_parada))) acuerdo.bits_parada++;
+    acuerdo.fcs = (fcs & (1 << NEG_FCS_CRC16)) ? NEG_FCS_CRC16 : NEG_FCS_CONTEO;
+    acuerdo.lng_max = (a.lng_max < b.lng_max) ? a.lng_max : b.lng_max;
+    if (acuerdo.lng_max > FrameEstandar::PAYLOAD_MAX) acuerdo.lng_max = FrameEstandar::PAYLOAD_MAX;
+    return true;
+}
+
+// --- Payload del CMD 10 ---
+
+static inline void escribirCapacidades(uint8_t* p, const CapacidadesEnlace& c) {
+    p[0] = c.version;
+    p[1] = c.velocidades;
+    p[2] = c.paradas;
+    p[3] = c.fcs;
+    p[4] = c.lng_max;
+}
+
+static inline CapacidadesEnlace leerCapacidades(const uint8_t* p) {
+    CapacidadesEnlace c = {p[0], p[1], p[2], p[3], p[4]};
+    return c;
+}
+
+static inline void escribirConfiguracion(uint8_t* p, const ConfiguracionEnlace& c) {
+    p[0] = c.idx_velocidad;
+    p[1] = c.bits_parada;
+    p[2] = c.fcs;
+    p[3] = c.lng_max;
+}
+
+static inline ConfiguracionEnlace leerConfiguracion(const uint8_t* p) {
+    ConfiguracionEnlace c = {p[0], p[1], p[2], p[3]};
+    return c;
+}
+
+/**
+ * @brief Configuración con sentido para esta versión (la de un ACUERDO recibido).
+ */
+static inline bool configuracionValida(const ConfiguracionEnlace& c, int num_velocidades) {
+    return c.idx_velocidad < num_velocidades && c.bits_parada >= 1 && c.bits_parada <= 4 &&
+           (c.fcs == NEG_FCS_CONTEO || c.fcs == NEG_FCS_CRC16) && c.lng_max >= 1 &&
+           c.lng_max <= FrameEstandar::PAYLOAD_MAX;
+}
+
+// --- FCS según la configuración ---
+
+static inline uint16_t fcsSegun(int algoritmo, const uint8_t* bytes, int n) {
+    return (algoritmo == NEG_FCS_CRC16) ? FrameEstandarCrc16::fcsDe(bytes, n) : FrameEstandar::fcsDe(bytes, n);
+}
+
+/**
+ * @brief Como Frame::cerrar() con el FCS de 'algoritmo'.
+ */
+static inline int cerrarSegun(int algoritmo, uint8_t* frame, int cmd, int lng) {
+    return (algoritmo == NEG_FCS_CRC16) ? FrameEstandarCrc16::cerrar(frame, cmd, lng)
+                                        : FrameEstandar::cerrar(frame, cmd, lng);
+}
+
+#endif // NEGOCIACION_ENLACE_H
@@ -0,0 +1,69 @@
+/**
+ * @file reenvioFrame.h
+ * @brief Frames para repetidores (CMD 13), común para el emisor, el
+ * receptor y las herramientas de host.
+ * @details Una ESP32 en modo repetidor reenvía por un segundo GPIO los
+ * frames que no son para ella, y así la red llega más lejos que un solo
+ * cable. El frame original viaja dentro de un sobre:
+ *
+ *   [13][lng + 5] [destino][saltos][origen][secuencia][cmd original] [datos...] [FCS]
+ *
+ * Con la cabecera (los primeros REENVIO_CABECERA bytes de la línea) el
+ * repetidor ya sabe si el frame sigue: lo empieza a reenviar mientras
+ * llegan los datos, con 'saltos' uno menos y el FCS recalculado. 'destino'
+ * REENVIO_DIFUSION es para todos; un frame con 'saltos' en 0 ya no se
+ * reenvía. El par (origen, secuencia) identifica el frame: un repetidor
+ * que lo vuelve a ver (un lazo en la red) lo descarta. Header-only y
+ * C++11, como frameProtocolo.h.
+ */
+
+#ifndef REENVIO_FRAME_H
+#define REENVIO_FRAME_H
+
+#include "frameProtocolo.h"
+
+#define CMD_REENVIO 13
+
+/**
+ * @brief Posiciones del sobre dentro del payload del CMD 13.
+ */
+#define REENVIO_DESTINO 0
+#define REENVIO_SALTOS 1
+#define REENVIO_ORIGEN 2
+#define REENVIO_SECUENCIA 3
+#define REENVIO_CMD 4
+#define REENVIO_SOBRE 5
+
+/**
+ * @brief Bytes de la línea que el repetidor lee antes de decidir: cmd, lng,
+ * destino, saltos, origen y secuencia (el cmd original puede llegar después).
+ */
+#define REENVIO_CABECERA (FrameEstandar::BYTES_CABECERA + REENVIO_CMD)
+
+#define REENVIO_DIFUSION 0xFF
+#define REENVIO_ORIGEN_EMISOR 0     // Los receptores usan las direcciones 1..254
+#define REENVIO_SALTOS_DEFECTO 8
+
+/**
+ * @brief Payload máximo de un frame que viaja dentro del sobre.
+ */
+#define REENVIO_LNG_MAX (FrameEstandar::PAYLOAD_MAX - REENVIO_SOBRE)
+
+/**
+ * @brief Arma el payload del CMD 13 en 'sobre' (al menos lng + REENVIO_SOBRE
+ * bytes) alrededor del frame original 'cmd' + 'datos'.
+ * @return El lng del CMD 13, o -1 si los datos no entran en el sobre.
+ */
+static inline int reenvioEnvolver(uint8_t* sobre, int cmd, const uint8_t* datos, int lng, uint8_t destino,
+                                  uint8_t saltos, uint8_t origen, uint8_t secuencia) {
+    if (lng < 0 || lng > REENVIO_LNG_MAX) return -1;
+    sobre[REENVIO_DESTINO] = destino;
+    sobre[REENVIO_SALTOS] = saltos;
+    sobre[REENVIO_ORIGEN] = origen;
+    sobre[REENVIO_SECUENCIA] = secuencia;
+    sobre[REENVIO_CMD] = (uint8_t)cmd;
+    memmove(sobre + REENVIO_SOBRE, datos, lng);
+    return lng + REENVIO_SOBRE;
+}
+
+#endif // REENVIO_FRAME_H
@@ -0,0 +1,268 @@
+/**
+ * @file trazas.h
+ * @brief Puntos de traza que se compilan solo con -DTRAZAS, comunes al
+ * emisor, al receptor y a las herramientas de host.
+ * @details Un punto de traza guarda un evento con su instante en un anillo
+ * del hilo que lo registra; los anillos se vuelcan en el formato JSON de
+ * Chrome (chrome://tracing, https://ui.perfetto.dev):
+ *
+ *   TRAZA_AMBITO("empaquetar");               desde acá hasta el fin del bloque
+ *   TRAZA_AMBITO_VALOR("enviarFrame", largo); con un número en "args"
+ *   TRAZA_INSTANTE("frameInvalido", cmd);     un instante, sin duración
+ *   TRAZA_HILO("envío");                      nombre del hilo en el visor
+ *
+ * Sin TRAZAS las macros no generan código ni evalúan sus argumentos, y el
+ * resto de este archivo no se usa: no ocupa memoria ni tiempo.
+ *
+ * Cada hilo toma un anillo del conjunto (TRAZA_HILOS) la primera vez que
+ * registra algo, y es el único que escribe en él: registrar un evento es
+ * leer el reloj y escribir unos bytes, sin locks ni atómicas de
+ * lectura-modificación-escritura. Cuando el anillo da la vuelta se pisan
+ * los eventos más viejos. Los hilos que llegan con el conjunto lleno no
+ * registran (se cuentan como perdidos).
+ *
+ * trazaExportar() lee los anillos sin detener a los hilos: conviene volcar
+ * con los hilos quietos, porque un evento que se escribe mientras se lee
+ * puede salir a medio escribir. Los nombres tienen que ser literales (se
+ * guarda solo el puntero) y no llevar comillas. Header-only y C++11, como
+ * frameProtocolo.h.
+ */
+
+#ifndef TRAZAS_H
+#define TRAZAS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+
+#if defined(ESP_PLATFORM)
+#include "esp_timer.h"
+#elif defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <time.h>
+#endif
+
+/**
+ * @brief Eventos por anillo (los más viejos se pisan).
+ */
+#ifndef TRAZA_EVENTOS
+#ifdef ARDUINO
+#define TRAZA_EVENTOS 256
+#else
+#define TRAZA_EVENTOS 4096
+#endif
+#endif
+
+/**
+ * @brief Hilos (o tareas) que pueden registrar eventos.
+ */
+#ifndef TRAZA_HILOS
+#ifdef ARDUINO
+#define TRAZA_HILOS 4
+#else
+#define TRAZA_HILOS 16
+#endif
+#endif
+
+#define TRAZA_AMBITO_TIPO 'X'
+#define TRAZA_INSTANTE_TIPO 'i'
+
+/**
+ * @brief Un evento: 'X' con duración o 'i' (instante).
+ */
+struct eventoTraza
+{
+    const char* nombre;    // Literal: se guarda solo el puntero
+    uint64_t inicio_ns;
+    uint32_t duracion_ns;
+    int32_t valor;         // Va en "args": {"v": valor}
+    char tipo;
+};
+
+/**
+ * @brief Los eventos de un hilo. Solo el hilo dueño escribe.
+ */
+struct anilloTraza
+{
+    eventoTraza eventos[TRAZA_EVENTOS];
+    std::atomic<uint32_t> escritos;  // Total registrado (el índice es escritos % TRAZA_EVENTOS)
+    const char* hilo;                // Nombre para el visor (NULL = "hilo N")
+};
+
+struct conjuntoTrazas
+{
+    anilloTraza anillos[TRAZA_HILOS];
+    std::atomic<int> usados;              // Puede pasar de TRAZA_HILOS: los de más no tienen anillo
+    std::atomic<unsigned long> perdidos;  // Eventos de hilos sin anillo
+};
+
+/**
+ * @brief El conjunto de anillos del programa (uno solo aunque se incluya en varios .cpp).
+ */
+inline conjuntoTrazas& trazaConjunto() {
+    static conjuntoTrazas c; // Memoria estática: en cero antes de cualquier hilo
+    return c;
+}
+
+inline uint64_t trazaAhoraNs() {
+#if defined(ESP_PLATFORM)
+    return (uint64_t)esp_timer_get_time() * 1000ULL;
+#elif defined(ARDUINO)
+    return (uint64_t)micros() * 1000ULL;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+inline anilloTraza* trazaReservarAnillo() {
+    conjuntoTrazas& c = trazaConjunto();
+    int i = c.usados.fetch_add(1);
+    return (i < TRAZA_HILOS) ? &c.anillos[i] : NULL;
+}
+
+/**
+ * @brief El anillo del hilo que llama (NULL si no quedaron anillos).
+ */
+inline anilloTraza* trazaAnilloDelHilo() {
+    static thread_local anilloTraza* anillo = trazaReservarAnillo();
+    return anillo;
+}
+
+inline void trazaRegistrar(char tipo, const char* nombre, uint64_t inicio_ns, uint64_t duracion_ns,
+                           int32_t valor) {
+    anilloTraza* a = trazaAnilloDelHilo();
+    if (a == NULL) {
+        trazaConjunto().perdidos.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t n = a->escritos.load(std::memory_order_relaxed);
+    eventoTraza& e = a->eventos[n % TRAZA_EVENTOS];
+    e.nombre = nombre;
+    e.inicio_ns = inicio_ns;
+    e.duracion_ns = (duracion_ns > 0xFFFFFFFFULL) ? 0xFFFFFFFFu : (uint32_t)duracion_ns;
+    e.valor = valor;
+    e.tipo = tipo;
+    a->escritos.store(n + 1, std::memory_order_release); // El evento queda visible para el volcado
+}
+
+inline void trazaNombrarHilo(const char* nombre) {
+    anilloTraza* a = trazaAnilloDelHilo();
+    if (a != NULL) a->hilo = nombre;
+}
+
+/**
+ * @brief Registra un evento 'X' desde su construcción hasta su destrucción.
+ */
+struct ambitoTraza
+{
+    const char* nombre;
+    int32_t valor;
+    uint64_t inicio_ns;
+
+    ambitoTraza(const char* n, int32_t v = 0) : nombre(n), valor(v), inicio_ns(trazaAhoraNs()) {}
+    ~ambitoTraza() {
+        trazaRegistrar(TRAZA_AMBITO_TIPO, nombre, inicio_ns, trazaAhoraNs() - inicio_ns, valor);
+    }
+};
+
+/**
+ * @brief Recibe el JSON de a pedazos (fputs, Serial.print...).
+ */
+typedef void (*escritorTraza)(const char* texto, void* contexto);
+
+inline void trazaEscribirArchivo(const char* texto, void* archivo) {
+    fputs(texto, (FILE*)archivo);
+}
+
+/**
+ * @brief Eventos que hay hoy en los anillos (los pisados no cuentan).
+ */
+inline unsigned long trazaEventosGuardados() {
+    conjuntoTrazas& c = trazaConjunto();
+    int hilos = c.usados.load();
+    if (hilos > TRAZA_HILOS) hilos = TRAZA_HILOS;
+    unsigned long total = 0;
+    for (int h = 0; h < hilos; h++) {
+        uint32_t n = c.anillos[h].escritos.load(std::memory_order_acquire);
+        total += (n < TRAZA_EVENTOS) ? n : TRAZA_EVENTOS;
+    }
+    return total;
+}
+
+/**
+ * @brief Vacía los anillos (con los hilos quietos). Cada hilo conserva el suyo.
+ */
+inline void trazaDescartar() {
+    conjuntoTrazas& c = trazaConjunto();
+    for (int h = 0; h < TRAZA_HILOS; h++) c.anillos[h].escritos.store(0);
+    c.perdidos.store(0);
+}
+
+/**
+ * @brief Vuelca los anillos como JSON de Chrome: {"traceEvents": [...]}.
+ * @details Los instantes van en microsegundos con decimales (el formato no
+ * admite otra unidad en "ts" y "dur"); 'pid' separa las puntas si se
+ * juntan los volcados del emisor y del receptor en un mismo archivo.
+ * @return La cantidad de eventos volcados.
+ */
+inline unsigned long trazaExportar(escritorTraza escribir, void* contexto, int pid = 1) {
+    conjuntoTrazas& c = trazaConjunto();
+    int hilos = c.usados.load();
+    if (hilos > TRAZA_HILOS) hilos = TRAZA_HILOS;
+
+    char linea[192];
+    unsigned long volcados = 0;
+    escribir("{\"traceEvents\":[\n", contexto);
+    for (int h = 0; h < hilos; h++) {
+        const anilloTraza& a = c.anillos[h];
+        snprintf(linea, sizeof(linea),
+                 "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                 (h > 0) ? ",\n" : "", pid, h, (a.hilo != NULL) ? a.hilo : "hilo");
+        escribir(linea, contexto);
+
+        uint32_t n = a.escritos.load(std::memory_order_acquire);
+        uint32_t desde = (n > TRAZA_EVENTOS) ? n - TRAZA_EVENTOS : 0;
+        for (uint32_t i = desde; i < n; i++) {
+            const eventoTraza& e = a.eventos[i % TRAZA_EVENTOS];
+            int largo = snprintf(linea, sizeof(linea),
+                                 ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%llu.%03u",
+                                 e.nombre, e.tipo, pid, h, (unsigned long long)(e.inicio_ns / 1000),
+                                 (unsigned)(e.inicio_ns % 1000));
+            if (e.tipo == TRAZA_AMBITO_TIPO) {
+                largo += snprintf(linea + largo, sizeof(linea) - largo, ",\"dur\":%u.%03u",
+                                  (unsigned)(e.duracion_ns / 1000), (unsigned)(e.duracion_ns % 1000));
+            } else {
+                largo += snprintf(linea + largo, sizeof(linea) - largo, ",\"s\":\"t\"");
+            }
+            snprintf(linea + largo, sizeof(linea) - largo, ",\"args\":{\"v\":%ld}}", (long)e.valor);
+            escribir(linea, contexto);
+            volcados++;
+        }
+    }
+    escribir("\n],\"displayTimeUnit\":\"ns\"}\n", contexto);
+    return volcados;
+}
+
+// --- Macros: lo único que usa el código instrumentado ---
+
+#define TRAZA_UNIR_(a, b) a##b
+#define TRAZA_UNIR(a, b) TRAZA_UNIR_(a, b)
+
+#ifdef TRAZAS
+#define TRAZA_AMBITO(nombre) ambitoTraza TRAZA_UNIR(traza_ambito_, __LINE__)(nombre)
+#define TRAZA_AMBITO_VALOR(nombre, valor) \
+    ambitoTraza TRAZA_UNIR(traza_ambito_, __LINE__)(nombre, (int32_t)(valor))
+#define TRAZA_INSTANTE(nombre, valor) \
+    trazaRegistrar(TRAZA_INSTANTE_TIPO, nombre, trazaAhoraNs(), 0, (int32_t)(valor))
+#define TRAZA_HILO(nombre) trazaNombrarHilo(nombre)
+#else
+#define TRAZA_AMBITO(nombre) ((void)0)
+#define TRAZA_AMBITO_VALOR(nombre, valor) ((void)0)
+#define TRAZA_INSTANTE(nombre, valor) ((void)0)
+#define TRAZA_HILO(nombre) ((void)0)
+#endif
+
+#endif // TRAZAS_H
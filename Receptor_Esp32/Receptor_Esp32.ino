@@ -1,7 +1,192 @@
 #include "recibe.h"
 #include "funcionesReceptor.h" // <-- ¡Nuestro nuevo archivo de lógica!
+#include "pipelineReceptor.h"
+#include "trazas.h"
 
-protocolo rx_proto;
+// Recepción en el core 0 (prioridad alta) y ejecución de comandos en el
+// core 1. Así los bytes que llegan mientras se escribe el OLED no se pierden.
+#define CORE_RECEPCION 0
+#define CORE_COMANDOS 1
+#define PRIORIDAD_RECEPCION (configMAX_PRIORITIES - 2)
+#define PRIORIDAD_COMANDOS 1
+
+TaskHandle_t g_tarea_comandos = NULL;
+
+// Frame de descarte: se usa solo cuando el pool está lleno, para seguir
+// consumiendo la línea y no perder la sincronización.
+frameReceptor rx_descarte;
+
+#ifdef TRAZAS
+static void escribirSerie(const char* texto, void* contexto) {
+    Serial.print(texto);
+}
+#endif
+
+// Con MODO_REPETIDOR, los frames para otra placa salen por TX_REENVIO_PIN
+// mientras llegan (REP_REENVIADO) y no pasan a la cola
+static resultadoRepetidor recibir(int velocidad, frameReceptor& proto, const FormatoLinea& formato) {
+#ifdef MODO_REPETIDOR
+    return repetidorRecibir(g_repetidor, RX_PIN, velocidad, proto, formato, enlaceConfiguracion(g_enlace).fcs);
+#else
+    return recibirFrame(RX_PIN, velocidad, proto, formato) ? REP_LOCAL : REP_ERROR;
+#endif
+}
+
+// flushRX() sin dejar de escribir la salida del repetidor
+static void limpiarRX() {
+#ifdef MODO_REPETIDOR
+    repetidorLimpiarRX(g_repetidor, RX_PIN);
+#else
+    flushRX();
+#endif
+}
+
+/**
+ * Tarea de recepción (core 0): llena buffers del pool y los publica
+ * en la cola lock-free sin copiarlos.
+ */
+void tareaRecepcion(void* arg) {
+    TRAZA_HILO("recepcion");
+    int idx = -1;
+    for (;;) {
+        if (idx < 0) {
+            idx = pipelineTomarLibre();
+        }
+
+        // El bit de inicio se espera acá y no dentro de recibirFrame: así la
+        // velocidad y el formato se leen recién cuando empieza el frame (el
+        // control del enlace los puede haber cambiado con la línea en reposo).
+#ifdef MODO_REPETIDOR
+        repetidorEsperarInicio(g_repetidor, RX_PIN);
+#else
+        while (digitalRead(RX_PIN) == HIGH);
+#endif
+        uint32_t t_inicio_us = micros();
+        int velocidad = enlaceVelocidad(g_enlace);
+        FormatoLinea formato = enlaceFormato(g_enlace);
+
+        if (idx < 0) {
+            // Pool lleno: el frame se lee igual, pero se descarta
+            resultadoRepetidor resultado = recibir(velocidad, rx_descarte, formato);
+            if (resultado == REP_LOCAL) {
+                g_pipe_frames_descartados++;
+            } else if (resultado == REP_ERROR) {
+                actualizarContadores(-1, false);
+                enlaceFrameInvalido(g_enlace);
+                limpiarRX();
+            }
+            continue;
+        }
+
+        frameReceptor& rx = *pipelineBuffer(idx);
+        resultadoRepetidor resultado = recibir(velocidad, rx, formato);
+        if (resultado == REP_LOCAL) {
+            // El frame se recibió bien (Stop bits y Paridad correctos)
+            rx.t_inicio_us = t_inicio_us;
+            rx.t_fin_us = micros();
+            pipelinePublicar(idx);
+            xTaskNotifyGive(g_tarea_comandos);
+            idx = -1; // El buffer ahora es del consumidor
+        } else if (resultado != REP_ERROR) {
+            // Era para otra placa: el buffer se reutiliza
+        } else {
+            // --- FALLO DE SINCRONIZACIÓN (STOP BITS / PARIDAD FRAME) ---
+            // El buffer se reutiliza en la próxima vuelta.
+            Serial.println("Error: Fallo de sincronización (Stop bits / Paridad Frame)");
+            actualizarContadores(-1, false); // -1 = Comando desconocido
+            enlaceFrameInvalido(g_enlace);
+            limpiarRX();
+        }
+    }
+}
+
+/**
+ * Tarea de comandos (core 1): valida el FCS y ejecuta cada frame
+ * directamente desde su buffer del pool.
+ */
+void tareaComandos(void* arg) {
+    TRAZA_HILO("comandos");
+    for (;;) {
+        // Despierta con cada frame o, como mucho, una vez por segundo
+        // para atender los pedidos del planificador.
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+
+        int idx;
+        while ((idx = pipelineTomarListo()) >= 0) {
+            frameReceptor& proto = *pipelineBuffer(idx);
+            uint32_t t_decodificar_us = micros();
+
+            if (desempaquetar(proto, enlaceConfiguracion(g_enlace).fcs)) {
+                // --- ¡PAQUETE VÁLIDO! (FCS COINCIDE) ---
+                uint32_t t_ejecutar_us = micros();
+                // La clave y el cmd se guardan antes de abrir el sobre, la caché o los fragmentos
+                BYTE cmd_linea = proto.cmd;
+                uint16_t clave = etapasClave(proto.cmd, payload(proto), proto.fcs);
+                BYTE ejecutado = ETAPAS_SIN_EJECUTAR;
+                g_etapas.display_us = 0;
+                enlaceFrameValido(g_enlace);
+                // Un CMD 13 para esta placa se reemplaza por el frame que
+                // lleva adentro, antes que los fragmentos y la caché; si no
+                // se puede abrir, igual se anota como válido sin ejecutar.
+                if (!repetidorDesenvolver(g_repetidor, proto)) {
+                    Serial.println("Error: CMD 13 mal formado o para otra dirección");
+                    actualizarContadores(CMD_REENVIO, false);
+                } else {
+                    // Un fragmento (CMD 11) solo se ejecuta cuando completa su
+                    // mensaje: el último se reemplaza por el frame original.
+                    resultadoFragmento frag = reensambleProcesar(g_reensamble, proto);
+                    if (frag == FRAG_INCOMPLETO || frag == FRAG_ERROR) {
+                        if (frag == FRAG_ERROR) {
+                            Serial.println("Error: fragmento CMD 11 fuera de orden, se descarta el mensaje");
+                        }
+                        actualizarContadores(CMD_FRAGMENTO, true);
+                    // Un CMD 9 se reemplaza por el frame que referencia antes
+                    // de contarlo, así una repetición de CMD 1 cuenta como prueba.
+                    } else if (!cacheProcesar(g_cache_frames, proto)) {
+                        Serial.println("Error: CMD 9 de un payload que no está en la caché");
+                        actualizarContadores(CMD_CACHE, false);
+                    } else {
+                        // Sin Serial.printf por frame: el cmd queda en la traza de ejecutarComando()
+                        actualizarContadores(proto.cmd, true);
+                        ejecutado = proto.cmd;
+                        ejecutarComando(proto);
+                    }
+                }
+                etapasRegistrar(g_etapas, clave, cmd_linea, ejecutado, proto, t_decodificar_us, t_ejecutar_us,
+                                micros());
+            } else {
+                // --- PAQUETE CORRUPTO (FCS NO COINCIDE) ---
+                // La línea sigue sincronizada (stop bits y paridad OK),
+                // por eso ya no hace falta flushRX() aquí.
+                Serial.println("Error: Paquete CORRUPTO (FCS no coincide)");
+                actualizarContadores(proto.cmd, false);
+                enlaceFrameInvalido(g_enlace);
+            }
+
+            pipelineLiberar(idx);
+        }
+
+        // Un cambio de velocidad sin ningún frame válido después vuelve a la anterior
+        if (g_revision_enlace_pendiente) {
+            g_revision_enlace_pendiente = false;
+            if (enlaceRevisar(g_enlace, millis())) {
+                Serial.printf("Enlace: sin frames a la nueva velocidad, vuelta a %d bps\n", enlaceVelocidad(g_enlace));
+            }
+        }
+
+        if (g_reporte_pendiente) {
+            g_reporte_pendiente = false;
+            imprimirEstadisticasPlanificador();
+        }
+
+#ifdef TRAZAS
+        // Una 't' por el monitor serie: las trazas como JSON de Chrome (pid 2 = receptor)
+        if (Serial.available() > 0 && Serial.read() == 't') {
+            trazaExportar(escribirSerie, NULL, 2);
+        }
+#endif
+    }
+}
 
 void setup() {
     Serial.begin(115200);
@@ -9,47 +194,27 @@ void setup() {
 
     // Llamamos a la función que inicializa el hardware (OLED, LED, etc.)
     setupHardware();
-    
+
     Serial.println("Receptor ESP32 Iniciado con PULLUP...");
     mostrarMensajeBienvenidaOLED();
+
+    pipelineIniciar();
+
+    // LED y reportes periódicos quedan a cargo del planificador (esp_timer)
+    iniciarPlanificador();
+
+    // recibirFrame espera el bit de inicio con un bucle activo, lo que
+    // deja sin CPU a la tarea IDLE del core 0.
+    disableCore0WDT();
+
+    xTaskCreatePinnedToCore(tareaComandos, "comandos", 4096, NULL,
+                            PRIORIDAD_COMANDOS, &g_tarea_comandos, CORE_COMANDOS);
+    xTaskCreatePinnedToCore(tareaRecepcion, "recepcion", 4096, NULL,
+                            PRIORIDAD_RECEPCION, NULL, CORE_RECEPCION);
 }
 
 
 void loop() {
-    Serial.println("Esperando Frame...");
-    
-    bool frame_ok = recibirFrame(RX_PIN, SPEED, rx_proto);
-
-    if (frame_ok) {
-        // El frame se recibió bien (Stop bits y Paridad correctos)
-        
-        if (desempaquetar(rx_proto)) {
-            // --- ¡PAQUETE VÁLIDO! (FCS COINCIDE) ---
-            Serial.println("¡Paquete VÁLIDO! (FCS Coincide)");
-            Serial.printf("CMD: %d, LNG: %d\n", rx_proto.cmd, rx_proto.lng);
-
-            // Actualizar contadores (true = FCS OK)
-            actualizarContadores(rx_proto.cmd, true); 
-
-            // --- Despachar el comando a nuestra lógica ---
-            ejecutarComando(rx_proto);
-            
-        } else {
-            // --- PAQUETE CORRUPTO (FCS NO COINCIDE) ---
-            Serial.println("Error: Paquete CORRUPTO (FCS no coincide)");
-            
-            // Actualizar contadores (false = FCS Error)
-            actualizarContadores(rx_proto.cmd, false);
-            flushRX();
-        }
-
-    } else {
-        // --- FALLO DE SINCRONIZACIÓN (STOP BITS / PARIDAD FRAME) ---
-        Serial.println("Error: Fallo de sincronización (Stop bits / Paridad Frame)");
-        
-        // Aquí no podemos confiar en el CMD, así que lo marcamos como error de paridad
-        actualizarContadores(-1, false); // -1 = Comando desconocido
-        flushRX();
-    }
-    
-}
\ No newline at end of file
+    // La recepción, los comandos y el LED corren en sus propias tareas
+    vTaskDelay(portMAX_DELAY);
+}
@@ -0,0 +1,112 @@
+#include "cacheFrames.h"
+#include <string.h>
+
+// FNV-1a de 32 bits sobre (cmd, lng, data)
+static uint32_t hashPayload(BYTE cmd, BYTE lng, const BYTE* data) {
+    uint32_t h = 2166136261u;
+    h = (h ^ cmd) * 16777619u;
+    h = (h ^ lng) * 16777619u;
+    for (int i = 0; i < lng; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    return h;
+}
+
+static bool esCacheable(BYTE cmd, BYTE lng) {
+    return cmd < 8 && lng > CACHE_LNG_MINIMO; // Ni telemetría ni control
+}
+
+static entradaCache* buscar(cacheFrames& cache, uint32_t hash) {
+    for (int i = 0; i < CACHE_ENTRADAS; i++) {
+        if (cache.entradas[i].ocupada && cache.entradas[i].hash == hash) {
+            return &cache.entradas[i];
+        }
+    }
+    return NULL;
+}
+
+// Inserta (o refresca) un payload. Desaloja la entrada usada hace más tiempo.
+static void insertar(cacheFrames& cache, uint32_t hash, BYTE cmd, BYTE lng, const BYTE* data) {
+    entradaCache* e = buscar(cache, hash);
+    if (e == NULL) {
+        e = &cache.entradas[0];
+        for (int i = 0; i < CACHE_ENTRADAS; i++) {
+            entradaCache& candidata = cache.entradas[i];
+            if (!candidata.ocupada) { e = &candidata; break; }
+            if (candidata.ultimo_uso < e->ultimo_uso) e = &candidata;
+        }
+        e->ocupada = true;
+        e->hash = hash;
+        e->cmd = cmd;
+        e->lng = lng;
+        memcpy(e->data, data, lng);
+    }
+    e->ultimo_uso = ++cache.reloj;
+}
+
+static uint32_t leerHash(const BYTE* origen) {
+    return ((uint32_t)origen[0] << 24) | ((uint32_t)origen[1] << 16) |
+           ((uint32_t)origen[2] << 8) | origen[3];
+}
+
+void cacheIniciar(cacheFrames& cache) {
+    memset(&cache, 0, sizeof(cacheFrames));
+}
+
+bool cacheProcesar(cacheFrames& cache, frameReceptor& proto) {
+    BYTE* datos = payload(proto);
+    if (proto.cmd != CMD_CACHE) {
+        if (esCacheable(proto.cmd, proto.lng)) {
+            insertar(cache, hashPayload(proto.cmd, proto.lng, datos), proto.cmd, proto.lng, datos);
+        }
+        return true;
+    }
+
+    if (proto.lng < 5) return false;
+    entradaCache* base = buscar(cache, leerHash(datos + 1));
+    if (base == NULL) {
+        cache.fallos++;
+        return false;
+    }
+
+    if (datos[0] == CACHE_OP_REPETIR) {
+        base->ultimo_uso = ++cache.reloj;
+        proto.cmd = base->cmd;
+        proto.lng = base->lng;
+        memcpy(datos, base->data, base->lng);
+        datos[proto.lng] = '\0'; // Los comandos de texto esperan el terminador (cae sobre el FCS)
+        cache.aciertos++;
+        return true;
+    }
+
+    if (datos[0] != CACHE_OP_DELTA || proto.lng < 7) return false;
+
+    // El parche se aplica sobre una copia: el payload se reescribe al final
+    BYTE cmd = datos[5];
+    BYTE lng = datos[6];
+    BYTE resultado[LARGO_DATA + 1];
+    if (lng > LARGO_DATA) return false;
+    memset(resultado, 0, sizeof(resultado));
+    memcpy(resultado, base->data, (base->lng < lng) ? base->lng : lng);
+
+    int pos = 7;
+    while (pos < proto.lng) {
+        if (pos + 2 > proto.lng) return false;
+        int offset = datos[pos];
+        int largo = datos[pos + 1];
+        pos += 2;
+        if (pos + largo > proto.lng || offset + largo > lng) return false;
+        memcpy(resultado + offset, datos + pos, largo);
+        pos += largo;
+    }
+
+    base->ultimo_uso = ++cache.reloj; // Igual que el emisor: se toca la base y después se inserta
+    insertar(cache, hashPayload(cmd, lng, resultado), cmd, lng, resultado);
+
+    proto.cmd = cmd;
+    proto.lng = lng;
+    memcpy(datos, resultado, lng);
+    datos[lng] = '\0';
+    cache.aciertos++;
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef CACHE_FRAMES_H
+#define CACHE_FRAMES_H
+
+#include <stdint.h>
+#include "structProtocolo.h"
+
+// Caché de los últimos payloads recibidos (CMD 9). El emisor lleva un
+// espejo con la misma política y, en lugar de repetir un frame, manda:
+//   REPETIR: [0] [hash 4B]
+//   DELTA:   [1] [hash base 4B] [cmd] [lng] [offset len bytes...]...
+// La política (hash, inserción, LRU) tiene que ser idéntica a la de
+// Emisor_Rasp_Funcional/cacheEmisor.cpp.
+#define CMD_CACHE 9
+#define CACHE_OP_REPETIR 0
+#define CACHE_OP_DELTA 1
+#define CACHE_ENTRADAS 16 // ~1.1 KB de RAM. Igual que en el emisor.
+#define CACHE_LNG_MINIMO 5
+
+typedef struct
+{
+    uint32_t hash;
+    uint32_t ultimo_uso; // Reloj lógico de la LRU
+    BYTE cmd;
+    BYTE lng;
+    bool ocupada;
+    BYTE data[LARGO_DATA];
+} entradaCache;
+
+typedef struct
+{
+    entradaCache entradas[CACHE_ENTRADAS];
+    uint32_t reloj;
+    unsigned long aciertos;
+    unsigned long fallos; // CMD 9 de una entrada que no está (se perdió un frame)
+} cacheFrames;
+
+void cacheIniciar(cacheFrames& cache);
+
+// Si 'proto' es un CMD 9, lo reemplaza (en el mismo buffer) por el frame
+// original; si no, guarda su payload. Retorna false si el CMD 9 no se
+// puede reconstruir: ese frame no se debe ejecutar.
+bool cacheProcesar(cacheFrames& cache, frameReceptor& proto);
+
+#endif
@@ -0,0 +1,182 @@
+#include "controlEnlace.h"
+#include <string.h>
+
+static const int VELOCIDADES[NUM_VELOCIDADES] = VELOCIDADES_BPS;
+
+// La parte de la configuración que no es la velocidad, en un solo atómico:
+// la tarea de recepción nunca ve media configuración
+static uint32_t empaquetarTrama(const ConfiguracionEnlace& c) {
+    return c.bits_parada | ((uint32_t)c.fcs << 8) | ((uint32_t)c.lng_max << 16);
+}
+
+static const uint32_t TRAMA_BASE = empaquetarTrama(CONFIGURACION_BASE);
+
+static bool enBase(const estadoEnlace& e) {
+    return e.idx.load() == 0 && e.trama.load() == TRAMA_BASE;
+}
+
+static void volverABase(estadoEnlace& e) {
+    if (!enBase(e)) e.vueltas_a_base++;
+    e.trama.store(TRAMA_BASE);
+    e.idx.store(0);
+    e.en_prueba.store(false);
+    e.fallos_seguidos.store(0);
+}
+
+// La configuración en prueba no anduvo: vuelve a la velocidad de antes
+// del CAMBIO, o a la base después de un acuerdo
+static void terminarPrueba(estadoEnlace& e) {
+    int8_t previo = e.idx_previo.load();
+    if (previo < 0) {
+        volverABase(e);
+        return;
+    }
+    e.idx.store((uint8_t)previo);
+    e.en_prueba.store(false);
+    e.fallos_seguidos.store(0);
+    e.vueltas_a_previo++;
+}
+
+void enlaceIniciar(estadoEnlace& e) {
+    e.idx.store(0);
+    e.trama.store(TRAMA_BASE);
+    e.en_prueba.store(false);
+    e.prueba_desde_ms.store(0);
+    e.idx_previo.store(-1);
+    e.fallos_seguidos.store(0);
+    e.ok.store(0);
+    e.errores.store(0);
+    e.idx_pendiente = -1;
+    e.acuerdo_pendiente = false;
+    e.capacidades = CAPACIDADES_RECEPTOR;
+    e.cambios = 0;
+    e.vueltas_a_base = 0;
+    e.vueltas_a_previo = 0;
+    e.negociaciones = 0;
+}
+
+int enlaceVelocidad(const estadoEnlace& e) {
+    return VELOCIDADES[e.idx.load()];
+}
+
+ConfiguracionEnlace enlaceConfiguracion(const estadoEnlace& e) {
+    uint32_t t = e.trama.load();
+    ConfiguracionEnlace c = {e.idx.load(), (uint8_t)(t & 0xFF), (uint8_t)((t >> 8) & 0xFF),
+                             (uint8_t)((t >> 16) & 0xFF)};
+    return c;
+}
+
+FormatoLinea enlaceFormato(const estadoEnlace& e) {
+    FormatoLinea f = FORMATO_RECEPCION;
+    f.bits_parada = e.trama.load() & 0xFF;
+    return f;
+}
+
+void enlaceFrameValido(estadoEnlace& e) {
+    e.ok++;
+    e.fallos_seguidos.store(0);
+    e.en_prueba.store(false); // La nueva configuración funciona
+}
+
+void enlaceFrameInvalido(estadoEnlace& e) {
+    e.errores++;
+    if (enBase(e)) return;
+    if (e.en_prueba.load()) {
+        terminarPrueba(e);
+    } else if (++e.fallos_seguidos >= ENLACE_FALLOS_PARA_VOLVER) {
+        volverABase(e);
+    }
+}
+
+bool enlaceRevisar(estadoEnlace& e, uint32_t ahora_ms) {
+    // Con signo: la respuesta pudo fechar la prueba un poco después de ahora_ms
+    if (e.en_prueba.load() && (int32_t)(ahora_ms - e.prueba_desde_ms.load()) > ENLACE_PRUEBA_MS) {
+        terminarPrueba(e);
+        return true;
+    }
+    return false;
+}
+
+bool enlaceProcesar(estadoEnlace& e, const frameReceptor& proto, frameReceptor& respuesta) {
+    if (proto.cmd != CMD_ENLACE || proto.lng < 2) return false;
+
+    const BYTE* datos = payload(proto);
+    BYTE* salida = payload(respuesta);
+    respuesta.cmd = CMD_ENLACE;
+    BYTE seq;
+
+    switch (datos[0]) {
+        case ENLACE_CAMBIO:
+            if (proto.lng < 3 || datos[1] >= NUM_VELOCIDADES) return false;
+            seq = datos[2];
+            e.idx_pendiente = datos[1];
+            e.acuerdo_pendiente = false;
+            salida[0] = ENLACE_CONFIRMA;
+            salida[1] = datos[1];
+            salida[2] = seq;
+            respuesta.lng = 3;
+            return true;
+
+        case ENLACE_CONSULTA: {
+            seq = datos[1];
+            uint16_t ok = e.ok.exchange(0);
+            uint16_t errores = e.errores.exchange(0);
+            salida[0] = ENLACE_REPORTE;
+            salida[1] = seq;
+            salida[2] = ok >> 8;
+            salida[3] = ok & 0xFF;
+            salida[4] = errores >> 8;
+            salida[5] = errores & 0xFF;
+            salida[6] = e.idx.load();
+            salida[7] = e.trama.load() & 0xFF;
+            salida[8] = (e.trama.load() >> 8) & 0xFF;
+            respuesta.lng = 9;
+            return true;
+        }
+
+        case ENLACE_NEGOCIA: {
+            if (proto.lng < 2 + NEG_BYTES_CAPACIDADES) return false;
+            seq = datos[1];
+            ConfiguracionEnlace acuerdo;
+            if (!acordarEnlace(e.capacidades, leerCapacidades(datos + 2), acuerdo)) {
+                acuerdo = CONFIGURACION_BASE;
+            }
+            e.acuerdo = acuerdo;
+            e.acuerdo_pendiente = true;
+            e.idx_pendiente = -1;
+            salida[0] = ENLACE_ACUERDO;
+            salida[1] = seq;
+            escribirConfiguracion(salida + 2, acuerdo);
+            respuesta.lng = 2 + NEG_BYTES_CONFIGURACION;
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+void enlaceDespuesDeResponder(estadoEnlace& e, uint32_t ahora_ms) {
+    if (e.acuerdo_pendiente) {
+        // Velocidad y trama juntas; la prueba vuelve a la base si no anda
+        e.acuerdo_pendiente = false;
+        e.trama.store(empaquetarTrama(e.acuerdo));
+        e.idx_previo.store(-1);
+        e.idx.store(e.acuerdo.idx_velocidad);
+        e.fallos_seguidos.store(0);
+        e.prueba_desde_ms.store(ahora_ms);
+        e.en_prueba.store(!enBase(e));
+        e.negociaciones++;
+        return;
+    }
+    if (e.idx_pendiente < 0) return;
+    if (e.idx_pendiente != e.idx.load()) {
+        e.idx_previo.store((int8_t)e.idx.load());
+        e.idx.store((uint8_t)e.idx_pendiente);
+        e.fallos_seguidos.store(0);
+        e.prueba_desde_ms.store(ahora_ms);
+        e.en_prueba.store(!enBase(e));
+        e.cambios++;
+    }
+    e.idx_pendiente = -1;
+}
@@ -0,0 +1,83 @@
+#ifndef CONTROL_ENLACE_H
+#define CONTROL_ENLACE_H
+
+#include <stdint.h>
+#include <atomic>
+#include "structProtocolo.h"
+#include "negociacionEnlace.h" // NEGOCIA / ACUERDO (../Protocolo_Comun)
+
+// Control del enlace (CMD 10). El emisor decide la velocidad; el receptor
+// confirma los cambios y le reporta cuántos frames llegaron bien.
+//   CAMBIO   [0][idx][seq]   emisor -> receptor, a la velocidad actual
+//   CONFIRMA [1][idx][seq]   receptor -> emisor, a la velocidad actual
+//   CONSULTA [2][seq]        emisor -> receptor
+//   REPORTE  [3][seq][ok 2B][errores 2B][idx][bits_parada][fcs]  receptor -> emisor
+//   NEGOCIA / ACUERDO        ver negociacionEnlace.h
+// Las respuestas viajan por la línea de retorno (ver retorno.h), siempre
+// con 2 bits de parada y el FCS por conteo: lo negociado es la línea de ida.
+#define CMD_ENLACE 10
+#define ENLACE_CAMBIO 0
+#define ENLACE_CONFIRMA 1
+#define ENLACE_CONSULTA 2
+#define ENLACE_REPORTE 3
+
+// Vuelta a SPEED (la única velocidad que las dos puntas conocen siempre,
+// junto con el resto de CONFIGURACION_BASE):
+// - tras confirmar un acuerdo, si el primer frame con la nueva
+//   configuración falla o no llega ninguno válido en ENLACE_PRUEBA_MS.
+// - fuera de la base, con ENLACE_FALLOS_PARA_VOLVER fallos seguidos.
+// El emisor hace lo mismo si no le llega la confirmación o un reporte.
+// Un CAMBIO que falla igual que arriba vuelve a la velocidad de antes del
+// cambio, no a SPEED: las dos puntas la conocen y ahí la línea andaba. Así
+// probar un escalón que no anda no cuesta una resincronización a 10 bps.
+#define ENLACE_PRUEBA_MS 20000
+#define ENLACE_FALLOS_PARA_VOLVER 2
+
+// Lo que este receptor sabe leer (recibe.cpp lee de 1 a 4 bits de parada)
+static constexpr CapacidadesEnlace CAPACIDADES_RECEPTOR = {
+    NEGOCIACION_VERSION, 0xFF, 0x1E, (1 << NEG_FCS_CONTEO) | (1 << NEG_FCS_CRC16), LARGO_DATA};
+
+typedef struct
+{
+    std::atomic<uint8_t> idx;              // Índice en VELOCIDADES_BPS
+    std::atomic<uint32_t> trama;           // Bits de parada, FCS y lng_max acordados (ver enlaceConfiguracion)
+    std::atomic<bool> en_prueba;           // Cambio confirmado, sin frame válido todavía
+    std::atomic<uint32_t> prueba_desde_ms;
+    std::atomic<int8_t> idx_previo;        // Adónde vuelve una prueba fallida (-1 = a la base)
+    std::atomic<uint8_t> fallos_seguidos;
+
+    // Desde el último reporte
+    std::atomic<uint16_t> ok;
+    std::atomic<uint16_t> errores;
+
+    int idx_pendiente;                     // Se aplica después de enviar la confirmación (-1 = ninguno)
+    bool acuerdo_pendiente;                // Ídem con 'acuerdo', después del ACUERDO
+    ConfiguracionEnlace acuerdo;
+    CapacidadesEnlace capacidades;         // Lo que se ofrece al negociar (CAPACIDADES_RECEPTOR)
+    unsigned long cambios;
+    unsigned long vueltas_a_base;
+    unsigned long vueltas_a_previo;        // Cambios que no anduvieron
+    unsigned long negociaciones;
+} estadoEnlace;
+
+void enlaceIniciar(estadoEnlace& e);
+int enlaceVelocidad(const estadoEnlace& e);
+
+// Configuración en uso y cómo se lee la línea con ella
+ConfiguracionEnlace enlaceConfiguracion(const estadoEnlace& e);
+FormatoLinea enlaceFormato(const estadoEnlace& e);
+
+// Resultado de cada frame (sincronización + FCS)
+void enlaceFrameValido(estadoEnlace& e);
+void enlaceFrameInvalido(estadoEnlace& e);
+
+// Vence la prueba de un cambio. Retorna true si dejó la configuración en prueba.
+bool enlaceRevisar(estadoEnlace& e, uint32_t ahora_ms);
+
+// Atiende un CMD 10. Retorna true si hay que enviar 'respuesta' por el retorno.
+bool enlaceProcesar(estadoEnlace& e, const frameReceptor& proto, frameReceptor& respuesta);
+
+// Aplica el cambio o el acuerdo pendiente, una vez enviada la respuesta
+void enlaceDespuesDeResponder(estadoEnlace& e, uint32_t ahora_ms);
+
+#endif
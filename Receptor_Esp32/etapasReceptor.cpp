@@ -0,0 +1,50 @@
+#include "etapasReceptor.h"
+
+#define ETAPAS_MASCARA (ETAPAS_REGISTROS - 1)
+
+static_assert((ETAPAS_REGISTROS & ETAPAS_MASCARA) == 0, "ETAPAS_REGISTROS tiene que ser potencia de 2");
+
+void etapasIniciar(etapasReceptor& e) {
+    memset(&e, 0, sizeof(etapasReceptor));
+}
+
+void etapasRegistrar(etapasReceptor& e, uint16_t clave, BYTE cmd_linea, BYTE cmd, const frameReceptor& proto,
+                     uint32_t t_decodificar_us, uint32_t t_ejecutar_us, uint32_t t_terminado_us) {
+    registroEtapas& r = e.registros[e.proximo & ETAPAS_MASCARA];
+    r.clave = clave;
+    r.cmd_linea = cmd_linea;
+    r.cmd = cmd;
+    r.fin_us = proto.t_fin_us;
+    // Restas de micros(): siguen bien aunque el contador dé la vuelta
+    r.linea_us = proto.t_fin_us - proto.t_inicio_us;
+    r.pipeline_us = t_decodificar_us - proto.t_fin_us;
+    r.decodificar_us = t_ejecutar_us - t_decodificar_us;
+    uint32_t ejecutar = t_terminado_us - t_ejecutar_us;
+    r.display_us = (e.display_us < ejecutar) ? e.display_us : ejecutar;
+    r.ejecutar_us = ejecutar - r.display_us;
+    e.proximo++;
+    e.total++;
+}
+
+int etapasResponder(const etapasReceptor& e, const BYTE* args, int lng, BYTE* datos) {
+    if (lng != 2) return -1;
+    uint16_t desde = (uint16_t)((args[0] << 8) | args[1]);
+    uint16_t pendientes = (uint16_t)(e.proximo - desde);
+    // Un 'desde' que ya se pisó (o del futuro, tras un reinicio) empieza por el más viejo
+    if (pendientes > ETAPAS_REGISTROS) {
+        uint16_t guardados = (e.total < ETAPAS_REGISTROS) ? (uint16_t)e.total : ETAPAS_REGISTROS;
+        desde = (uint16_t)(e.proximo - guardados);
+        pendientes = (uint16_t)(e.proximo - desde);
+    }
+    int cantidad = (pendientes < ETAPAS_POR_RESPUESTA) ? pendientes : ETAPAS_POR_RESPUESTA;
+
+    datos[0] = (BYTE)cantidad;
+    datos[1] = (BYTE)(desde >> 8);
+    datos[2] = (BYTE)desde;
+    int n = ETAPAS_CABECERA_RESPUESTA;
+    for (int i = 0; i < cantidad; i++) {
+        etapasPoner(datos + n, e.registros[(uint16_t)(desde + i) & ETAPAS_MASCARA]);
+        n += ETAPAS_REGISTRO_BYTES;
+    }
+    return n;
+}
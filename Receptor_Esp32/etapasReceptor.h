@@ -0,0 +1,33 @@
+#ifndef ETAPAS_RECEPTOR_H
+#define ETAPAS_RECEPTOR_H
+
+#include <stdint.h>
+#include "structProtocolo.h"
+#include "etapasLatencia.h"
+
+// Latencia por etapas (RPC_ETAPAS, ver etapasLatencia.h): la tarea de
+// comandos anota cada frame válido en un anillo y el emisor los pide de a
+// ETAPAS_POR_RESPUESTA. Si el emisor no pregunta seguido, los más viejos
+// se pisan: la respuesta dice desde qué número empieza.
+#define ETAPAS_REGISTROS 32    // Potencia de 2
+
+typedef struct
+{
+    registroEtapas registros[ETAPAS_REGISTROS];
+    uint16_t proximo;          // Número del próximo registro (da la vuelta en 65536)
+    unsigned long total;       // Registrados desde el arranque
+    uint32_t display_us;       // Lo que lleva el frame en curso en display.display()
+} etapasReceptor;
+
+void etapasIniciar(etapasReceptor& e);
+
+// Anota un frame: 'proto' trae el inicio y el fin de la línea; los demás
+// son micros() al tomarlo del pipeline, después de desempaquetar y al
+// terminar de ejecutarlo. 'cmd' es ETAPAS_SIN_EJECUTAR si no se ejecutó.
+void etapasRegistrar(etapasReceptor& e, uint16_t clave, BYTE cmd_linea, BYTE cmd, const frameReceptor& proto,
+                     uint32_t t_decodificar_us, uint32_t t_ejecutar_us, uint32_t t_terminado_us);
+
+// Cuerpo del método RPC_ETAPAS: args [desde 2]. Retorna los bytes escritos en 'datos'.
+int etapasResponder(const etapasReceptor& e, const BYTE* args, int lng, BYTE* datos);
+
+#endif
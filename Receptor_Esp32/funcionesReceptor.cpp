@@ -1,5 +1,12 @@
 #include "funcionesReceptor.h"
+#include "planificador.h"
+#include "serieTemporal.h"
+#include "retorno.h"
+#include "pipelineReceptor.h"
+#include "sobremuestreo.h"
+#include "trazas.h"
 #include <Wire.h>
+#include "esp_timer.h"
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 
@@ -24,10 +31,116 @@ int g_total_recibidos_paridad_error = 0;
 bool g_led_parpadeando = false;
 int g_led_frecuencia_hz = 1; 
 
+// --- Planificador de tareas periódicas ---
+planificador g_planificador;
+static esp_timer_handle_t s_timer_planificador;
+static int s_id_tarea_led = -1;
+static int s_id_tarea_reporte = -1;
+static int s_id_tarea_prueba_enlace = -1;
+volatile bool g_reporte_pendiente = false;
+volatile bool g_revision_enlace_pendiente = false;
+
+#define PERIODO_REPORTE_US (60UL * 1000000UL) // Reporte de jitter cada 60 s
+// enlaceRevisar() pide más de ENLACE_PRUEBA_MS; el margen cubre el redondeo de millis()
+#define PERIODO_PRUEBA_ENLACE_US ((ENLACE_PRUEBA_MS + 10UL) * 1000UL)
+
+// --- Telemetría continua (CMD 8) ---
+serieTemporal g_serie_temperatura;
+
+// --- Caché de frames (CMD 9) ---
+cacheFrames g_cache_frames;
+
+// --- Control del enlace (CMD 10) ---
+estadoEnlace g_enlace;
+
+// --- Reensamble de fragmentos (CMD 11) ---
+reensambleFrames g_reensamble;
+
+// --- Pedidos del emisor (CMD 12) ---
+servidorRpc g_servidor_rpc;
+
+// --- Repetidor (CMD 13) ---
+repetidor g_repetidor;
+
+// --- Latencia por etapas (RPC_ETAPAS) ---
+etapasReceptor g_etapas;
+
+// Medio periodo del LED (1 Hz = 500 ms ON, 500 ms OFF)
+static uint32_t periodoLedUs(int frecuencia_hz) {
+    return 500000UL / frecuencia_hz;
+}
+
+// --- Métodos RPC (CMD 12): ver rpcReceptor.h ---
+
+// Los contadores del CMD 6, en big endian
+static int rpcEstadisticas(const BYTE* args, int lng, BYTE* datos) {
+    if (lng != 0) return -1;
+    int n = 0;
+    n += rpcPoner32(datos + n, g_total_recibidos_ok);
+    n += rpcPoner32(datos + n, g_total_recibidos_fcs_error);
+    n += rpcPoner32(datos + n, g_total_recibidos_paridad_error);
+    n += rpcPoner32(datos + n, g_pipe_frames_descartados.load());
+    n += rpcPoner32(datos + n, g_cache_frames.aciertos);
+    n += rpcPoner32(datos + n, g_cache_frames.fallos);
+    n += rpcPoner32(datos + n, g_reensamble.completos);
+    n += rpcPoner32(datos + n, g_reensamble.descartados);
+    n += rpcPoner32(datos + n, g_serie_temperatura.muestras_total);
+    return n;
+}
+
+static int rpcConfiguracion(const BYTE* args, int lng, BYTE* datos) {
+    if (lng != 0) return -1;
+    int n = 0;
+    n += rpcPoner16(datos + n, SPEED);
+    n += rpcPoner16(datos + n, enlaceVelocidad(g_enlace));
+    datos[n++] = g_enlace.idx.load();
+    datos[n++] = PIPE_NUM_BUFFERS;
+    datos[n++] = (BYTE)g_led_frecuencia_hz;
+    datos[n++] = g_led_parpadeando ? 1 : 0;
+    return n;
+}
+
+static int rpcSalud(const BYTE* args, int lng, BYTE* datos) {
+    if (lng != 0) return -1;
+    int n = 0;
+    n += rpcPoner32(datos + n, millis());
+    n += rpcPoner32(datos + n, ESP.getFreeHeap());
+    datos[n++] = (BYTE)g_pipe_max_ocupados.load();
+    return n;
+}
+
+static int rpcEtapas(const BYTE* args, int lng, BYTE* datos) {
+    return etapasResponder(g_etapas, args, lng, datos);
+}
+
+// display.display() manda el buffer entero por I2C: su tiempo se cuenta
+// aparte en la latencia por etapas del frame que se está ejecutando
+static void mostrarDisplay() {
+    uint32_t inicio = micros();
+    display.display();
+    g_etapas.display_us += micros() - inicio;
+}
+
 // --- Implementación de Funciones ---
 
 void setupHardware() {
     pinMode(LED_PIN, OUTPUT);
+    serieIniciar(g_serie_temperatura);
+    cacheIniciar(g_cache_frames);
+    enlaceIniciar(g_enlace);
+    reensambleIniciar(g_reensamble);
+    rpcIniciar(g_servidor_rpc);
+#ifdef MODO_REPETIDOR
+    repetidorIniciar(g_repetidor, DIRECCION_NODO, TX_REENVIO_PIN);
+#else
+    repetidorIniciar(g_repetidor, DIRECCION_NODO, -1); // Sin salida: solo abre los CMD 13 para esta placa
+#endif
+    rpcRegistrar(g_servidor_rpc, RPC_ESTADISTICAS, rpcEstadisticas);
+    rpcRegistrar(g_servidor_rpc, RPC_CONFIGURACION, rpcConfiguracion);
+    rpcRegistrar(g_servidor_rpc, RPC_SALUD, rpcSalud);
+    rpcRegistrar(g_servidor_rpc, RPC_ETAPAS, rpcEtapas);
+    etapasIniciar(g_etapas);
+    retornoIniciar(TX_RETORNO_PIN);
     Wire.begin(OLED_SDA, OLED_SCL);
 
     if(!display.begin(SSD1306_SWITCHCAPVCC, 0x3C)) { 
@@ -36,6 +149,173 @@ void setupHardware() {
     }
 }
 
+/**
+ * Tarea periódica del LED. Debe ser corta: corre en la tarea de esp_timer.
+ */
+static void tareaLed(void* arg) {
+    if (g_led_parpadeando) {
+        digitalWrite(LED_PIN, !digitalRead(LED_PIN));
+    } else {
+        digitalWrite(LED_PIN, LOW); // Por si el toggle llegó entre medio
+    }
+}
+
+/**
+ * Tarea periódica de reporte: solo marca el pedido, la impresión
+ * por Serial la hace la tarea de comandos.
+ */
+static void tareaReporte(void* arg) {
+    g_reporte_pendiente = true;
+}
+
+/**
+ * Timeout de recepción de un cambio de enlace (CMD 10): vence si la prueba
+ * sigue abierta ENLACE_PRUEBA_MS después de aplicar la nueva velocidad.
+ * Marca la revisión para la tarea de comandos y se desactiva sola;
+ * armarPruebaEnlace() la vuelve a activar con la fase desde cero.
+ */
+static void tareaPruebaEnlace(void* arg) {
+    g_revision_enlace_pendiente = true;
+    planificadorSolicitarActiva(g_planificador, s_id_tarea_prueba_enlace, false);
+}
+
+/**
+ * Callback del timer: ejecuta lo vencido y se re-arma para el próximo
+ * deadline, así el parpadeo no depende de lo que haga la recepción.
+ */
+static void alDispararTimer(void* arg) {
+    uint32_t espera = planificadorEjecutar(g_planificador, micros());
+    if (espera != PLAN_SIN_TAREAS) {
+        esp_timer_start_once(s_timer_planificador, espera);
+    }
+}
+
+/**
+ * Fuerza una pasada inmediata del planificador para que aplique
+ * los cambios pedidos (frecuencia del LED, activar/desactivar).
+ */
+static void despertarPlanificador() {
+    esp_timer_stop(s_timer_planificador);
+    if (esp_timer_start_once(s_timer_planificador, 0) != ESP_OK) {
+        // El callback se re-armó entre medio: se reintenta una vez
+        esp_timer_stop(s_timer_planificador);
+        esp_timer_start_once(s_timer_planificador, 0);
+    }
+}
+
+/**
+ * Arma el timeout de la prueba del enlace. El periodo se vuelve a pedir
+ * para que la fase arranque ahora aunque la tarea ya estuviera activa.
+ */
+static void armarPruebaEnlace() {
+    planificadorSolicitarPeriodo(g_planificador, s_id_tarea_prueba_enlace, PERIODO_PRUEBA_ENLACE_US);
+    planificadorSolicitarActiva(g_planificador, s_id_tarea_prueba_enlace, true);
+    despertarPlanificador();
+}
+
+/**
+ * Registra las tareas del planificador: el LED, el reporte de jitter y el
+ * timeout de recepción de la prueba del enlace.
+ * El refresco del OLED no es una tarea: cada display.display() lo causa un
+ * comando (CMD 0/2/3/7/8) y la escritura I2C (~25 ms por KB a 400 kHz) no
+ * puede correr en el contexto de esp_timer sin atrasar al LED. Queda en la
+ * tarea de comandos, donde las etapas de cada frame miden su costo.
+ */
+void iniciarPlanificador() {
+    planificadorIniciar(g_planificador);
+
+    uint32_t ahora = micros();
+    s_id_tarea_led = planificadorAgregar(g_planificador, tareaLed, NULL, ahora,
+                                         periodoLedUs(g_led_frecuencia_hz),
+                                         periodoLedUs(g_led_frecuencia_hz), false);
+    s_id_tarea_reporte = planificadorAgregar(g_planificador, tareaReporte, NULL, ahora,
+                                             PERIODO_REPORTE_US, PERIODO_REPORTE_US);
+    s_id_tarea_prueba_enlace = planificadorAgregar(g_planificador, tareaPruebaEnlace, NULL, ahora,
+                                                   PERIODO_PRUEBA_ENLACE_US, PERIODO_PRUEBA_ENLACE_US, false);
+
+    esp_timer_create_args_t args = {};
+    args.callback = alDispararTimer;
+    args.name = "planificador";
+    esp_timer_create(&args, &s_timer_planificador);
+    esp_timer_start_once(s_timer_planificador, 0);
+}
+
+/**
+ * Imprime el jitter medido de las tareas del planificador.
+ */
+void imprimirEstadisticasPlanificador() {
+    const char* nombres[] = {"LED", "Reporte", "Prueba enlace"};
+    int ids[] = {s_id_tarea_led, s_id_tarea_reporte, s_id_tarea_prueba_enlace};
+    Serial.println("--- Jitter del Planificador ---");
+    for (int i = 0; i < 3; i++) {
+        if (ids[i] < 0) continue;
+        const tareaPlanificada& t = g_planificador.tareas[ids[i]];
+        unsigned long promedio = t.ejecuciones ? (unsigned long)(t.atraso_total_us / t.ejecuciones) : 0;
+        Serial.printf("  %s: %u ejec, atraso prom %lu us, max %u us, perdidos %u\n",
+                      nombres[i], t.ejecuciones, promedio, t.atraso_max_us, t.periodos_perdidos);
+    }
+}
+
+/**
+ * Imprime la confianza del sobremuestreo por bit y los glitches filtrados.
+ */
+void imprimirEstadisticasSobremuestreo() {
+    unsigned long bits = g_sobremuestreo.bits;
+    if (bits == 0) return;
+    Serial.printf("  Sobremuestreo: %lu bits, confianza media %lu%%, %lu dudosos (<%d%%)\n", bits,
+                  g_sobremuestreo.confianza_total / bits, g_sobremuestreo.bits_dudosos.load(),
+                  SOBRE_CONFIANZA_DUDOSA);
+    Serial.print("    Confianza por tramo (0-19 ... 80-100):");
+    for (int i = 0; i < SOBRE_TRAMOS_CONFIANZA; i++) {
+        Serial.printf(" %lu", g_sobremuestreo.por_tramo[i].load());
+    }
+    Serial.printf("\n    Glitches filtrados: %lu | Inicios falsos: %lu\n",
+                  g_sobremuestreo.glitches.load(), g_sobremuestreo.inicios_falsos.load());
+}
+
+/**
+ * Grafica la serie de temperatura en el OLED. Usa el nivel más grueso que
+ * tenga al menos media pantalla de puntos: al crecer la historia el gráfico
+ * se aleja solo. Cada columna es la franja min..max de un punto.
+ */
+static void graficarSerie(const serieTemporal& serie) {
+    const int Y0 = 10; // Debajo de la línea de texto
+    const int ALTO = SCREEN_HEIGHT - Y0;
+
+    int nivel = 0;
+    for (int n = SERIE_NIVELES - 1; n > 0; n--) {
+        if (serie.niveles[n].cantidad >= SERIE_PUNTOS / 2) {
+            nivel = n;
+            break;
+        }
+    }
+    int cantidad = serie.niveles[nivel].cantidad;
+
+    int16_t minimo = 32767, maximo = -32768;
+    for (int i = 0; i < cantidad; i++) {
+        const puntoSerie& p = seriePunto(serie, nivel, i);
+        if (p.min < minimo) minimo = p.min;
+        if (p.max > maximo) maximo = p.max;
+    }
+    int rango = (maximo > minimo) ? (maximo - minimo) : 1;
+
+    display.clearDisplay();
+    display.setCursor(0, 0);
+    display.printf("%.2fC %.1f..%.1f x%d", serie.ultimo / (float)TELEMETRIA_ESCALA,
+                   minimo / (float)TELEMETRIA_ESCALA, maximo / (float)TELEMETRIA_ESCALA,
+                   nivel == 0 ? 1 : (nivel == 1 ? SERIE_FACTOR : SERIE_FACTOR * SERIE_FACTOR));
+
+    // Los puntos más nuevos quedan pegados al borde derecho
+    int x0 = SCREEN_WIDTH - cantidad;
+    for (int i = 0; i < cantidad; i++) {
+        const puntoSerie& p = seriePunto(serie, nivel, i);
+        int y_alto = Y0 + (ALTO - 1) - (long)(p.max - minimo) * (ALTO - 1) / rango;
+        int y_bajo = Y0 + (ALTO - 1) - (long)(p.min - minimo) * (ALTO - 1) / rango;
+        display.drawFastVLine(x0 + i, y_alto, y_bajo - y_alto + 1, WHITE);
+    }
+    mostrarDisplay();
+}
+
 void mostrarMensajeBienvenidaOLED() {
     display.clearDisplay();
     display.setTextSize(1);
@@ -43,7 +323,7 @@ void mostrarMensajeBienvenidaOLED() {
     display.setCursor(0,0);
     display.println("Receptor ESP32");
     display.println("Listo para recibir...");
-    display.display();
+    mostrarDisplay();
 }
 
 /**
@@ -89,7 +369,8 @@ void actualizarContadores(int cmd_recibido, bool fcs_ok) {
  * Función principal que contiene el "switch" y ejecuta la lógica
  * basada en el comando recibido.
  */
-void ejecutarComando(protocolo& proto) {
+void ejecutarComando(frameReceptor& proto) {
+    TRAZA_AMBITO_VALOR("ejecutarComando", proto.cmd);
     switch (proto.cmd) {
         
         case 0: // Opción 1: Mostrar mensaje de control
@@ -98,7 +379,7 @@ void ejecutarComando(protocolo& proto) {
             display.setCursor(0,0);
             display.println("Dispositivo OK");
             display.drawRect(0, 10, 20, 20, WHITE); // Dibuja un cuadrado
-            display.display();
+            mostrarDisplay();
             break;
             
         case 1: // Opción 2: Mensaje de prueba
@@ -124,8 +405,8 @@ void ejecutarComando(protocolo& proto) {
             Serial.println("Ejecutando CMD 2: Mostrar texto OLED");
             display.clearDisplay();
             display.setCursor(0,0);
-            display.printf("Mensaje:\n%s", (char*)proto.data);
-            display.display();
+            display.printf("Mensaje:\n%s", (char*)payload(proto));
+            mostrarDisplay();
             break;
 
         case 3: // Opción 4: Enviar temperatura
@@ -133,9 +414,9 @@ void ejecutarComando(protocolo& proto) {
             display.clearDisplay();
             display.setCursor(0,0);
             display.setTextSize(2); // Letra más grande
-            display.printf("Temp:\n%s C", (char*)proto.data);
+            display.printf("Temp:\n%s C", (char*)payload(proto));
             display.setTextSize(1); // Volver a tamaño normal
-            display.display();
+            mostrarDisplay();
             break;
             
         case 4: // Opción 5: Toggle LED
@@ -146,13 +427,17 @@ void ejecutarComando(protocolo& proto) {
                 Serial.println("LED AHORA APAGADO");
                 digitalWrite(LED_PIN, LOW); // Apagarlo
             }
+            planificadorSolicitarActiva(g_planificador, s_id_tarea_led, g_led_parpadeando);
+            despertarPlanificador();
             break;
 
         case 5: {// Opción 6: Cambiar frecuencia
             Serial.println("Ejecutando CMD 5: Cambiar Freq LED");
-            int freq = atoi((char*)proto.data); // Convertir texto (ej: "50") a entero
+            int freq = atoi((char*)payload(proto)); // Convertir texto (ej: "50") a entero
             if (freq >= 1 && freq <= 100) {
                  g_led_frecuencia_hz = freq;
+                 planificadorSolicitarPeriodo(g_planificador, s_id_tarea_led, periodoLedUs(freq));
+                 despertarPlanificador();
                  Serial.printf("Nueva Freq: %d Hz\n", g_led_frecuencia_hz);
             } else {
                  Serial.printf("Freq recibida (%d) fuera de rango.\n", freq);
@@ -165,39 +450,77 @@ void ejecutarComando(protocolo& proto) {
             Serial.printf("  Paquetes OK: %d\n", g_total_recibidos_ok);
             Serial.printf("  Fallo FCS: %d\n", g_total_recibidos_fcs_error);
             Serial.printf("  Fallo Paridad/Sync: %d\n", g_total_recibidos_paridad_error);
+            imprimirEstadisticasPlanificador();
+            Serial.printf("  Telemetría: %lu muestras, %lu frames perdidos\n",
+                          g_serie_temperatura.muestras_total, g_serie_temperatura.frames_perdidos);
+            Serial.printf("  Caché CMD 9: %lu aciertos, %lu fallos\n",
+                          g_cache_frames.aciertos, g_cache_frames.fallos);
+            Serial.printf("  Enlace: %d bps, %lu cambios (%lu no anduvieron), %lu vueltas a la base\n",
+                          enlaceVelocidad(g_enlace), g_enlace.cambios, g_enlace.vueltas_a_previo,
+                          g_enlace.vueltas_a_base);
+            {
+                ConfiguracionEnlace c = enlaceConfiguracion(g_enlace);
+                Serial.printf("  Trama: %d bits de parada, FCS %s, payload hasta %d | %lu negociaciones\n",
+                              c.bits_parada, c.fcs == NEG_FCS_CRC16 ? "CRC-16" : "conteo", c.lng_max,
+                              g_enlace.negociaciones);
+            }
+            Serial.printf("  Fragmentos CMD 11: %lu mensajes armados, %lu descartados\n",
+                          g_reensamble.completos, g_reensamble.descartados);
+            Serial.printf("  Pedidos CMD 12: %lu atendidos, %lu rechazados\n",
+                          g_servidor_rpc.atendidos, g_servidor_rpc.rechazados);
+            repetidorImprimir(g_repetidor);
+            imprimirEstadisticasSobremuestreo();
             break;
             
         case 7: // Opción 8: Enviar array de temps
             Serial.println("Ejecutando CMD 7: Mostrar 8 Temps");
             display.clearDisplay();
             display.setCursor(0,0);
-            display.print((char*)proto.data); // El emisor ya formateó el string
-            display.display();
+            display.print((char*)payload(proto)); // El emisor ya formateó el string
+            mostrarDisplay();
             break;
 
-        default:
-            Serial.printf("Comando %d desconocido.\n", proto.cmd);
+        case CMD_TELEMETRIA: { // Opción 10: Telemetría continua de temperatura
+            int n = serieAgregarFrame(g_serie_temperatura, payload(proto), proto.lng);
+            if (n < 0) {
+                Serial.println("CMD 8: payload de telemetría mal formado");
+                break;
+            }
+            Serial.printf("Ejecutando CMD 8: %d muestras cada %u ms, ultima %.2f C\n", n,
+                          g_serie_temperatura.periodo_ms,
+                          g_serie_temperatura.ultimo / (float)TELEMETRIA_ESCALA);
+            graficarSerie(g_serie_temperatura);
             break;
-    }
-}
+        }
 
-/**
- * Maneja el parpadeo del LED si está activado.
- * Esta función debe llamarse en CADA loop.
- */
-void manejarParpadeoLED() {
-    if (g_led_parpadeando) {
-        // Usamos millis() para no bloquear el loop con delay()
-        static unsigned long tiempoAnteriorLED = 0;
-        unsigned long tiempoActual = millis();
-        
-        // (1Hz = 1000ms de ciclo / 2 = 500ms ON, 500ms OFF)
-        long periodo_ms = (1000 / g_led_frecuencia_hz) / 2;
+        case CMD_ENLACE: { // Control del enlace: se responde por la línea de retorno
+            frameReceptor respuesta;
+            if (enlaceProcesar(g_enlace, proto, respuesta)) {
+                int largo = empaquetarRetorno(respuesta);
+                enviarFrameRetorno(TX_RETORNO_PIN, enlaceVelocidad(g_enlace), respuesta, largo);
+                enlaceDespuesDeResponder(g_enlace, millis());
+                if (g_enlace.en_prueba.load()) armarPruebaEnlace();
+                Serial.printf("Ejecutando CMD 10: subtipo %d, enlace a %d bps\n",
+                              payload(proto)[0], enlaceVelocidad(g_enlace));
+            }
+            break;
+        }
 
-        if (tiempoActual - tiempoAnteriorLED >= periodo_ms) {
-            tiempoAnteriorLED = tiempoActual;
-            // Invertir el estado actual del LED
-            digitalWrite(LED_PIN, !digitalRead(LED_PIN)); 
+        case CMD_RPC: { // Pedido del emisor: la respuesta lleva el mismo id
+            frameReceptor respuesta;
+            if (rpcProcesar(g_servidor_rpc, proto, respuesta)) {
+                int largo = empaquetarRetorno(respuesta);
+                int velocidad = enlaceVelocidad(g_enlace);
+                enviarFrameRetorno(TX_RETORNO_PIN, velocidad, respuesta, largo);
+                delay(RPC_SEPARACION_BITS * 1000 / velocidad); // Antes de otra respuesta
+                Serial.printf("Ejecutando CMD 12: pedido %d, método %d, estado %d\n",
+                              payload(proto)[1], payload(proto)[2], payload(respuesta)[2]);
+            }
+            break;
         }
+
+        default:
+            Serial.printf("Comando %d desconocido.\n", proto.cmd);
+            break;
     }
-}
\ No newline at end of file
+}
@@ -2,18 +2,49 @@
 #define FUNCIONES_RECEPTOR_H
 
 
-#include "recibe.h" // Para acceder a 'protocolo'
+#include "recibe.h" // Para acceder a 'frameReceptor'
+#include "cacheFrames.h"
+#include "controlEnlace.h"
+#include "reensambleFrames.h"
+#include "rpcReceptor.h"
+#include "repetidor.h"
+#include "etapasReceptor.h"
 
 // --- Funciones de Inicialización ---
 void setupHardware();
 void mostrarMensajeBienvenidaOLED();
 
 // --- Función Principal de Despacho ---
-void ejecutarComando(protocolo& proto);
+void ejecutarComando(frameReceptor& proto);
 
 // --- Funciones de Lógica (Contadores, LED) ---
 void actualizarContadores(int cmd_recibido, bool fcs_ok);
-void manejarParpadeoLED();
+void iniciarPlanificador();
+void imprimirEstadisticasPlanificador();
+void imprimirEstadisticasSobremuestreo();
 void flushRX(); // Movimos esta función aquí
 
+// Lo marca la tarea periódica de reporte; lo atiende la tarea de comandos
+extern volatile bool g_reporte_pendiente;
+// Lo marca el timeout de la prueba del enlace; enlaceRevisar() corre en la tarea de comandos
+extern volatile bool g_revision_enlace_pendiente;
+
+// Últimos payloads recibidos, para los frames CMD 9 del emisor
+extern cacheFrames g_cache_frames;
+
+// Velocidad actual y contadores del control del enlace (CMD 10)
+extern estadoEnlace g_enlace;
+
+// Mensajes partidos en fragmentos (CMD 11) a medio recibir, uno por flujo
+extern reensambleFrames g_reensamble;
+
+// Métodos que el emisor puede llamar con pedidos CMD 12
+extern servidorRpc g_servidor_rpc;
+
+// Dirección de esta placa y reenvío de los CMD 13 para otras (MODO_REPETIDOR)
+extern repetidor g_repetidor;
+
+// Tiempo de cada etapa de los últimos frames, para RPC_ETAPAS
+extern etapasReceptor g_etapas;
+
 #endif
\ No newline at end of file
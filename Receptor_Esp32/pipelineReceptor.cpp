@@ -0,0 +1,76 @@
+#include "pipelineReceptor.h"
+
+// Pool fijo de buffers: es la única memoria de frames del receptor.
+static frameReceptor s_pool[PIPE_NUM_BUFFERS];
+
+// libres: consumidor -> productor | listos: productor -> consumidor
+static colaIndices s_libres;
+static colaIndices s_listos;
+
+std::atomic<unsigned long> g_pipe_frames_publicados(0);
+std::atomic<unsigned long> g_pipe_frames_descartados(0);
+std::atomic<unsigned> g_pipe_max_ocupados(0);
+
+static std::atomic<unsigned> s_ocupados(0);
+
+/**
+ * Encola un índice. Nunca puede desbordarse: en todo el sistema existen
+ * exactamente PIPE_NUM_BUFFERS índices, así que cada cola cabe completa.
+ */
+static void colaPush(colaIndices& c, BYTE idx) {
+    unsigned cabeza = c.cabeza.load(std::memory_order_relaxed);
+    c.indices[cabeza & (PIPE_NUM_BUFFERS - 1)] = idx;
+    // 'release': el contenido del buffer queda visible antes que el índice
+    c.cabeza.store(cabeza + 1, std::memory_order_release);
+}
+
+static int colaPop(colaIndices& c) {
+    unsigned cola = c.cola.load(std::memory_order_relaxed);
+    if (cola == c.cabeza.load(std::memory_order_acquire)) {
+        return -1; // Vacía
+    }
+    int idx = c.indices[cola & (PIPE_NUM_BUFFERS - 1)];
+    c.cola.store(cola + 1, std::memory_order_release);
+    return idx;
+}
+
+void pipelineIniciar() {
+    s_libres.cabeza.store(0);
+    s_libres.cola.store(0);
+    s_listos.cabeza.store(0);
+    s_listos.cola.store(0);
+    s_ocupados.store(0);
+    for (int i = 0; i < PIPE_NUM_BUFFERS; i++) {
+        colaPush(s_libres, (BYTE)i);
+    }
+}
+
+int pipelineTomarLibre() {
+    int idx = colaPop(s_libres);
+    if (idx >= 0) {
+        unsigned ocupados = s_ocupados.fetch_add(1, std::memory_order_relaxed) + 1;
+        // Solo el productor actualiza el pico, no hace falta CAS
+        if (ocupados > g_pipe_max_ocupados.load(std::memory_order_relaxed)) {
+            g_pipe_max_ocupados.store(ocupados, std::memory_order_relaxed);
+        }
+    }
+    return idx;
+}
+
+void pipelinePublicar(int idx) {
+    colaPush(s_listos, (BYTE)idx);
+    g_pipe_frames_publicados.fetch_add(1, std::memory_order_relaxed);
+}
+
+int pipelineTomarListo() {
+    return colaPop(s_listos);
+}
+
+void pipelineLiberar(int idx) {
+    s_ocupados.fetch_sub(1, std::memory_order_relaxed);
+    colaPush(s_libres, (BYTE)idx);
+}
+
+frameReceptor* pipelineBuffer(int idx) {
+    return &s_pool[idx];
+}
@@ -0,0 +1,43 @@
+#ifndef PIPELINE_RECEPTOR_H
+#define PIPELINE_RECEPTOR_H
+
+#include <atomic>
+#include "structProtocolo.h"
+
+// Cantidad de buffers del pool (debe ser potencia de 2 y <= 256).
+// Con 8 frames en vuelo la tarea de comandos puede atrasarse varios
+// frames (ej: escrituras I2C al OLED) sin que la recepción pierda bytes.
+#define PIPE_NUM_BUFFERS 8
+
+/**
+ * Cola circular lock-free de un solo productor y un solo consumidor (SPSC).
+ * Solo mueve INDICES de buffers del pool, nunca copia los frames.
+ * 'cabeza' la escribe únicamente el productor y 'cola' únicamente el consumidor.
+ */
+typedef struct
+{
+    std::atomic<unsigned> cabeza;
+    std::atomic<unsigned> cola;
+    BYTE indices[PIPE_NUM_BUFFERS];
+} colaIndices;
+
+// --- Estadísticas del pipeline ---
+extern std::atomic<unsigned long> g_pipe_frames_publicados;
+extern std::atomic<unsigned long> g_pipe_frames_descartados; // Sin buffer libre al llegar
+extern std::atomic<unsigned> g_pipe_max_ocupados;            // Pico de buffers en uso
+
+// --- Inicialización ---
+void pipelineIniciar();
+
+// --- Lado productor (tarea de recepción) ---
+int pipelineTomarLibre();           // -1 si no quedan buffers libres
+void pipelinePublicar(int idx);     // Entrega el frame completo al consumidor
+
+// --- Lado consumidor (tarea de comandos) ---
+int pipelineTomarListo();           // -1 si no hay frames pendientes
+void pipelineLiberar(int idx);      // Devuelve el buffer al pool
+
+// Acceso al buffer (sin copia) a partir de su índice
+frameReceptor* pipelineBuffer(int idx);
+
+#endif
@@ -0,0 +1,172 @@
+#include "planificador.h"
+
+// true si el instante 'a' es anterior a 'b' (seguro ante la vuelta de uint32_t)
+static inline bool antesQue(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+static bool menor(const planificador& p, int i, int j) {
+    return antesQue(p.tareas[p.heap[i]].vence_us, p.tareas[p.heap[j]].vence_us);
+}
+
+static void intercambiar(planificador& p, int i, int j) {
+    uint8_t t = p.heap[i];
+    p.heap[i] = p.heap[j];
+    p.heap[j] = t;
+}
+
+static void subir(planificador& p, int i) {
+    while (i > 0 && menor(p, i, (i - 1) / 2)) {
+        intercambiar(p, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void bajar(planificador& p, int i) {
+    for (;;) {
+        int hijo = 2 * i + 1;
+        if (hijo >= p.n_heap) return;
+        if (hijo + 1 < p.n_heap && menor(p, hijo + 1, hijo)) hijo++;
+        if (!menor(p, hijo, i)) return;
+        intercambiar(p, i, hijo);
+        i = hijo;
+    }
+}
+
+static void insertarEnHeap(planificador& p, int id) {
+    p.heap[p.n_heap] = (uint8_t)id;
+    p.n_heap++;
+    subir(p, p.n_heap - 1);
+}
+
+static void reconstruirHeap(planificador& p) {
+    p.n_heap = 0;
+    for (int id = 0; id < PLAN_MAX_TAREAS; id++) {
+        if (p.tareas[id].registrada && p.tareas[id].activa) {
+            insertarEnHeap(p, id);
+        }
+    }
+}
+
+void planificadorIniciar(planificador& p) {
+    for (int id = 0; id < PLAN_MAX_TAREAS; id++) {
+        tareaPlanificada& t = p.tareas[id];
+        t.funcion = 0;
+        t.arg = 0;
+        t.registrada = false;
+        t.activa = false;
+        t.periodo_pedido.store(0);
+        t.activa_pedida.store(-1);
+    }
+    p.n_heap = 0;
+    p.hay_pedidos.store(false);
+    planificadorReiniciarEstadisticas(p);
+}
+
+int planificadorAgregar(planificador& p, funcionTarea funcion, void* arg,
+                        uint32_t ahora_us, uint32_t retardo_us, uint32_t periodo_us, bool activa) {
+    for (int id = 0; id < PLAN_MAX_TAREAS; id++) {
+        tareaPlanificada& t = p.tareas[id];
+        if (t.registrada) continue;
+
+        t.funcion = funcion;
+        t.arg = arg;
+        t.vence_us = ahora_us + retardo_us;
+        t.periodo_us = periodo_us;
+        t.registrada = true;
+        t.activa = activa;
+        if (activa) insertarEnHeap(p, id);
+        return id;
+    }
+    return -1; // Sin espacio
+}
+
+void planificadorSolicitarPeriodo(planificador& p, int id, uint32_t periodo_us) {
+    if (id < 0 || id >= PLAN_MAX_TAREAS || periodo_us == 0) return;
+    p.tareas[id].periodo_pedido.store(periodo_us, std::memory_order_relaxed);
+    p.hay_pedidos.store(true, std::memory_order_release);
+}
+
+void planificadorSolicitarActiva(planificador& p, int id, bool activa) {
+    if (id < 0 || id >= PLAN_MAX_TAREAS) return;
+    p.tareas[id].activa_pedida.store(activa ? 1 : 0, std::memory_order_relaxed);
+    p.hay_pedidos.store(true, std::memory_order_release);
+}
+
+/**
+ * Aplica los cambios pedidos desde otras tareas. Un cambio de periodo o una
+ * reactivación reinician la fase: el próximo deadline es ahora + periodo.
+ */
+static void aplicarPedidos(planificador& p, uint32_t ahora_us) {
+    if (!p.hay_pedidos.exchange(false, std::memory_order_acquire)) return;
+
+    for (int id = 0; id < PLAN_MAX_TAREAS; id++) {
+        tareaPlanificada& t = p.tareas[id];
+        if (!t.registrada) continue;
+
+        uint32_t periodo = t.periodo_pedido.exchange(0, std::memory_order_relaxed);
+        int activa = t.activa_pedida.exchange(-1, std::memory_order_relaxed);
+
+        if (periodo != 0) {
+            t.periodo_us = periodo;
+            t.vence_us = ahora_us + periodo;
+        }
+        if (activa == 1 && !t.activa) {
+            t.activa = true;
+            t.vence_us = ahora_us + t.periodo_us;
+        } else if (activa == 0) {
+            t.activa = false;
+        }
+    }
+    reconstruirHeap(p);
+}
+
+uint32_t planificadorEjecutar(planificador& p, uint32_t ahora_us) {
+    aplicarPedidos(p, ahora_us);
+
+    while (p.n_heap > 0) {
+        int id = p.heap[0];
+        tareaPlanificada& t = p.tareas[id];
+        if (antesQue(ahora_us, t.vence_us)) {
+            return t.vence_us - ahora_us; // Aún no vence
+        }
+
+        // --- Jitter: atraso respecto al deadline ideal ---
+        uint32_t atraso = ahora_us - t.vence_us;
+        if (atraso > t.atraso_max_us) t.atraso_max_us = atraso;
+        t.atraso_total_us += atraso;
+        t.ejecuciones++;
+
+        if (t.periodo_us == 0) {
+            // Una sola vez: sale del heap y libera su lugar
+            p.heap[0] = p.heap[p.n_heap - 1];
+            p.n_heap--;
+            bajar(p, 0);
+            t.registrada = false;
+            t.activa = false;
+        } else {
+            // Periódica: el siguiente deadline se calcula desde el ideal,
+            // no desde 'ahora', para que el atraso no se acumule.
+            t.vence_us += t.periodo_us;
+            if (!antesQue(ahora_us, t.vence_us)) {
+                uint32_t saltos = (ahora_us - t.vence_us) / t.periodo_us + 1;
+                t.periodos_perdidos += saltos;
+                t.vence_us += saltos * t.periodo_us;
+            }
+            bajar(p, 0);
+        }
+
+        t.funcion(t.arg);
+    }
+    return PLAN_SIN_TAREAS;
+}
+
+void planificadorReiniciarEstadisticas(planificador& p) {
+    for (int id = 0; id < PLAN_MAX_TAREAS; id++) {
+        tareaPlanificada& t = p.tareas[id];
+        t.ejecuciones = 0;
+        t.periodos_perdidos = 0;
+        t.atraso_max_us = 0;
+        t.atraso_total_us = 0;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef PLANIFICADOR_H
+#define PLANIFICADOR_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Máximo de tareas registradas (LED, reportes, timeouts...)
+#define PLAN_MAX_TAREAS 8
+// Valor de retorno de planificadorEjecutar() cuando no queda nada agendado
+#define PLAN_SIN_TAREAS 0xFFFFFFFFUL
+
+typedef void (*funcionTarea)(void* arg);
+
+/**
+ * Tarea agendada. Los tiempos están en microsegundos (uint32_t, con vuelta
+ * cada ~71 minutos; todas las comparaciones son seguras ante esa vuelta).
+ */
+typedef struct
+{
+    funcionTarea funcion;
+    void* arg;
+    uint32_t vence_us;      // Próximo deadline ideal
+    uint32_t periodo_us;    // 0 = se ejecuta una sola vez
+    bool registrada;
+    bool activa;
+
+    // Cambios pedidos desde otra tarea/core. Se aplican dentro de
+    // planificadorEjecutar(), que es el único que toca el heap.
+    std::atomic<uint32_t> periodo_pedido; // 0 = sin cambio
+    std::atomic<int> activa_pedida;       // -1 = sin cambio
+
+    // --- Contabilidad de jitter ---
+    uint32_t ejecuciones;
+    uint32_t periodos_perdidos; // Deadlines saltados por atraso > periodo
+    uint32_t atraso_max_us;     // Peor atraso respecto al deadline ideal
+    uint64_t atraso_total_us;
+} tareaPlanificada;
+
+/**
+ * Planificador por deadlines: min-heap de índices ordenado por 'vence_us'.
+ * No depende del hardware: quien lo usa le entrega la hora actual.
+ */
+typedef struct
+{
+    tareaPlanificada tareas[PLAN_MAX_TAREAS];
+    uint8_t heap[PLAN_MAX_TAREAS];
+    int n_heap;
+    std::atomic<bool> hay_pedidos;
+} planificador;
+
+void planificadorIniciar(planificador& p);
+
+// Retorna el id de la tarea o -1 si no hay espacio.
+// periodo_us = 0 -> tarea de una sola vez (ej: timeout).
+int planificadorAgregar(planificador& p, funcionTarea funcion, void* arg,
+                        uint32_t ahora_us, uint32_t retardo_us, uint32_t periodo_us, bool activa = true);
+
+// Seguras para llamar desde otra tarea o core (solo dejan el pedido).
+void planificadorSolicitarPeriodo(planificador& p, int id, uint32_t periodo_us);
+void planificadorSolicitarActiva(planificador& p, int id, bool activa);
+
+// Ejecuta las tareas vencidas y retorna los us que faltan para el próximo
+// deadline (PLAN_SIN_TAREAS si no hay ninguna activa).
+uint32_t planificadorEjecutar(planificador& p, uint32_t ahora_us);
+
+void planificadorReiniciarEstadisticas(planificador& p);
+
+#endif
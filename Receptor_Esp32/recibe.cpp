@@ -1,14 +1,79 @@
 #include "recibe.h"
+#include "sobremuestreo.h"
+#include "trazas.h"
 #include "Arduino.h"
 
-int readByte(int pin, int speed, BYTE* byte) {
+// Espera hasta el instante 'objetivo_us' de micros(). Las muestras se toman
+// en instantes contados desde la bajada: el costo de cada lectura no se acumula.
+static void esperarHasta(unsigned long objetivo_us) {
+    long falta = (long)(objetivo_us - micros());
+    if (falta > 0) delayMicroseconds(falta);
+}
+
+// Instante de la muestra 'k' (en el centro de su tramo) desde 'inicio_us'
+static unsigned long instanteMuestra(unsigned long inicio_us, unsigned long bit_us, int k, int m) {
+    return inicio_us + ((unsigned long)k * bit_us + bit_us / 2) / m;
+}
+
+// Byte con sobremuestreo (ver sobremuestreo.h). Una bajada que no dura
+// más de glitch_max muestras, o cuyo bit de inicio vota HIGH, era ruido:
+// se vuelve a esperar el inicio sin perder el frame.
+static int readByteSobremuestreo(int pin, int speed, BYTE* byte, const FormatoLinea& formato) {
+    BYTE muestras[SOBRE_MUESTRAS_BYTE_MAX];
+    int m = formato.muestras_por_bit;
+    int n = sobreMuestrasDeByte(formato);
+    int fin_inicio = sobreFinVentana(formato);
+    unsigned long bit_us = (1000 / speed) * 1000UL;
+
+    for (;;) {
+        while (digitalRead(pin) == HIGH);
+        unsigned long inicio_us = micros();
+
+        bool inicio_valido = true;
+        for (int k = 0; k < n && inicio_valido; k++) {
+            esperarHasta(instanteMuestra(inicio_us, bit_us, k, m));
+            muestras[k] = digitalRead(pin);
+            if (k <= formato.glitch_max && muestras[k]) {
+                inicio_valido = false;
+            } else if (k == fin_inicio - 1 && sobreVotarBit(muestras, 0, formato).nivel) {
+                inicio_valido = false;
+            }
+        }
+        if (inicio_valido) {
+            return sobreDecodificarByte(muestras, formato, byte, &g_sobremuestreo);
+        }
+        g_sobremuestreo.inicios_falsos.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Paridad y stop final del frame con sobremuestreo: el bit que empieza en 'inicio_us'
+static int leerBitVotado(int pin, unsigned long inicio_us, unsigned long bit_us, const FormatoLinea& formato) {
+    BYTE muestras[SOBRE_MUESTRAS_MAX];
+    int n = sobreFinVentana(formato);
+    for (int k = 0; k < n; k++) {
+        esperarHasta(instanteMuestra(inicio_us, bit_us, k, formato.muestras_por_bit));
+        muestras[k] = digitalRead(pin);
+    }
+    int glitches = sobreFiltrarGlitches(muestras, n, formato.glitch_max);
+    if (glitches > 0) g_sobremuestreo.glitches.fetch_add(glitches, std::memory_order_relaxed);
+    votoBit v = sobreVotarBit(muestras, 0, formato);
+    sobreContarVoto(g_sobremuestreo, v);
+    return v.nivel;
+}
+
+int readByte(int pin, int speed, BYTE* byte, const FormatoLinea& formato) {
+    if (sobremuestreoValido(formato)) {
+        return readByteSobremuestreo(pin, speed, byte, formato);
+    }
+
     unsigned long msTime = 1000 / speed; // 100ms
+    unsigned long msMuestreo = msTime * formato.muestreo_pct / 100;
     
     *byte = 0;
     int paridad_byte = 0; 
 
     while (digitalRead(pin) == HIGH); 
-    delay(msTime / 2); // Esperamos 50ms (mitad del bit de inicio)
+    delay(msMuestreo); // Esperamos 50ms (mitad del bit de inicio)
 
     if (digitalRead(pin) == HIGH) {
         return -1; 
@@ -29,37 +94,43 @@ int readByte(int pin, int speed, BYTE* byte) {
         return -1; 
     }
     
-    delay(msTime); 
-    if (digitalRead(pin) == LOW) {
-        return -1; 
+    // Los demás bits de parada (con 2, como en producción, uno más)
+    for (int i = 1; i < formato.bits_parada; i++) {
+        delay(msTime); 
+        if (digitalRead(pin) == LOW) {
+            return -1; 
+        }
     }
     
     return paridad_byte;
 }
 
-bool recibirFrame(int pin, int speed, protocolo & proto) {
-    memset(&proto, 0, sizeof(protocolo)); 
+bool recibirFrame(int pin, int speed, frameReceptor & proto, const FormatoLinea& formato) {
+    TRAZA_AMBITO_VALOR("recibirFrame", speed);
+    // Sin memset: solo se usan los bytes que llegan (ver desempaquetar)
+    proto.cmd = 0;
+    proto.lng = 0;
     unsigned long msTime = 1000 / speed; // 100ms
     int paridad_frame = 0; 
     int paridad_byte = 0;
     
-    paridad_byte = readByte(pin, speed, &proto.frame[0]);
+    paridad_byte = readByte(pin, speed, &proto.frame[0], formato);
     if (paridad_byte == -1) return false; 
     paridad_frame += paridad_byte;
-    proto.cmd = (proto.frame[0] >> 2) & 0x0F; 
+    proto.cmd = FrameEstandar::cmdDe(proto.frame); 
 
-    paridad_byte = readByte(pin, speed, &proto.frame[1]);
+    paridad_byte = readByte(pin, speed, &proto.frame[1], formato);
     if (paridad_byte == -1) return false; 
     paridad_frame += paridad_byte;
-    proto.lng = (proto.frame[1] >> 1) & 0x3F; 
+    proto.lng = FrameEstandar::lngDe(proto.frame); 
 
-    if (proto.lng > LARGO_DATA) {
+    if (!FrameEstandar::lngValido(proto.lng)) {
         return false; 
     }
 
     int bytes_totales = proto.lng + 2; 
     for (int i = 0; i < bytes_totales; i++) {
-        paridad_byte = readByte(pin, speed, &proto.frame[i + 2]);
+        paridad_byte = readByte(pin, speed, &proto.frame[i + 2], formato);
         if (paridad_byte == -1) return false; 
         paridad_frame += paridad_byte;
     }
@@ -75,14 +146,25 @@ bool recibirFrame(int pin, int speed, protocolo & proto) {
     
     // Ahora estamos al inicio del bit de paridad (o hemos salido por timeout)
     
-    delay(msTime / 2); // Esperamos 50ms para ponernos en el centro
-    
-    bool paridad_recibida = digitalRead(pin); // Leemos el bit (HIGH o LOW)
-    
-    // Ahora esperamos el bit de stop final
-    delay(msTime); 
-    if (digitalRead(pin) == LOW) {
-        return false; // El bit de stop final falló
+    bool paridad_recibida;
+    if (sobremuestreoValido(formato)) {
+        // Los mismos dos bits, votados
+        unsigned long inicio_us = micros();
+        unsigned long bit_us = msTime * 1000UL;
+        paridad_recibida = leerBitVotado(pin, inicio_us, bit_us, formato);
+        if (!leerBitVotado(pin, inicio_us + bit_us, bit_us, formato)) {
+            return false; // El bit de stop final falló
+        }
+    } else {
+        delay(msTime * formato.muestreo_pct / 100); // Esperamos 50ms para ponernos en el centro
+        
+        paridad_recibida = digitalRead(pin); // Leemos el bit (HIGH o LOW)
+        
+        // Ahora esperamos el bit de stop final
+        delay(msTime); 
+        if (digitalRead(pin) == LOW) {
+            return false; // El bit de stop final falló
+        }
     }
 
     // Comparamos la paridad
@@ -95,34 +177,26 @@ bool recibirFrame(int pin, int speed, protocolo & proto) {
     }
 }
 
-bool desempaquetar(protocolo & proto) {
+bool desempaquetar(frameReceptor & proto, int algoritmo_fcs) {
+    TRAZA_AMBITO_VALOR("desempaquetar", proto.lng);
 
-    for (int i = 0; i < proto.lng; i++) {
-        proto.data[i] = proto.frame[i + 2];
-    }
-
-
-    unsigned short fcs_recibido = (proto.frame[proto.lng + 2] << 8) | (proto.frame[proto.lng + 3]);
+    // El payload se queda en frame[2..]: no se copia
+    unsigned short fcs_recibido = FrameEstandar::fcsEscrito(proto.frame, proto.lng);
     proto.fcs = fcs_recibido; // Guardamos el fcs recibido
 
     // Calcular el FCS
     // Calculamos sobre cmd, lng y data (total: proto.lng + 2 bytes)
-    unsigned short fcs_calculado = fcs(proto.frame, proto.lng + 2);
-
-    Serial.printf("FCS Recibido: %u\n", fcs_recibido);
-    Serial.printf("FCS Calculado: %u\n", fcs_calculado);
+    unsigned short fcs_calculado = fcsSegun(algoritmo_fcs, proto.frame, proto.lng + 2);
 
     // 4. Comparar
-    return (fcs_calculado == fcs_recibido);
+    if (fcs_calculado != fcs_recibido) return false;
+
+    // El FCS ya se usó: su primer byte pasa a ser el terminador del texto
+    proto.frame[proto.lng + 2] = '\0';
+    return true;
 }
 
 unsigned short fcs(BYTE * array, int tam){
-    unsigned short res = 0;
-    for (int i = 0; i < tam; i++) {
-        for (int j = 0; j < 8; j++) {
-            res += (array[i] >> j) & 0x01;  
-        }
-    }
-    return res;
+    return FrameEstandar::fcsDe(array, tam);
 }
 
@@ -1,12 +1,17 @@
 #ifndef RECIBE_H
 #define RECIBE_H
 #include "structProtocolo.h"
+#include "negociacionEnlace.h"
 
-int readByte(int pin, int speed, BYTE* byte);
+// 'formato': bits de parada, punto de muestreo y sobremuestreo (el estándar
+// por defecto; el receptor usa FORMATO_RECEPCION y el barrido de parámetros
+// de Herramientas_Host prueba otros)
+int readByte(int pin, int speed, BYTE* byte, const FormatoLinea& formato = FORMATO_LINEA_ESTANDAR);
 
-bool recibirFrame(int pin, int speed, protocolo & proto);
+bool recibirFrame(int pin, int speed, frameReceptor & proto, const FormatoLinea& formato = FORMATO_LINEA_ESTANDAR);
 
-bool desempaquetar(protocolo & proto);
+// 'algoritmo_fcs': NEG_FCS_* de la configuración del enlace (ver negociacionEnlace.h)
+bool desempaquetar(frameReceptor & proto, int algoritmo_fcs = NEG_FCS_CONTEO);
 
 unsigned short fcs(BYTE * array, int tam);
 #endif
@@ -0,0 +1,52 @@
+#include "reensambleFrames.h"
+
+void reensambleIniciar(reensambleFrames& r) {
+    memset(&r, 0, sizeof(reensambleFrames));
+}
+
+resultadoFragmento reensambleProcesar(reensambleFrames& r, frameReceptor& proto) {
+    if (proto.cmd != CMD_FRAGMENTO) return FRAG_NO_ES;
+    if (proto.lng <= FRAG_CABECERA) return FRAG_ERROR;
+
+    BYTE* datos = payload(proto);
+    int secuencia = datos[0] >> 6;
+    int flujo = (datos[0] >> 4) & 0x03;
+    int indice = datos[1] >> 4;
+    int total = (datos[1] & 0x0F) + 1;
+    int largo = proto.lng - FRAG_CABECERA;
+    if (indice >= total) return FRAG_ERROR;
+
+    flujoReensamble& f = r.flujos[flujo];
+    if (indice == 0) {
+        // Un mensaje nuevo pisa al que quedó a medias (se perdió su final)
+        if (f.siguiente != 0) r.descartados++;
+        f.cmd = datos[0] & 0x0F;
+        f.secuencia = (BYTE)secuencia;
+        f.total = (BYTE)total;
+        f.lng = 0;
+    } else if (indice != f.siguiente || total != f.total || secuencia != f.secuencia) {
+        // Se perdió un fragmento del medio: el mensaje ya no se puede armar
+        if (f.siguiente != 0) r.descartados++;
+        f.siguiente = 0;
+        return FRAG_ERROR;
+    }
+
+    if (f.lng + largo > LARGO_DATA) {
+        f.siguiente = 0;
+        r.descartados++;
+        return FRAG_ERROR;
+    }
+    memcpy(f.data + f.lng, datos + FRAG_CABECERA, largo);
+    f.lng += largo;
+    f.siguiente = (BYTE)(indice + 1);
+    if (f.siguiente < f.total) return FRAG_INCOMPLETO;
+
+    // Completo: el frame original reemplaza al último fragmento
+    proto.cmd = f.cmd;
+    proto.lng = f.lng;
+    memcpy(datos, f.data, f.lng);
+    datos[proto.lng] = '\0'; // Los comandos de texto esperan el terminador (cae sobre el FCS)
+    f.siguiente = 0;
+    r.completos++;
+    return FRAG_COMPLETO;
+}
@@ -0,0 +1,52 @@
+#ifndef REENSAMBLE_FRAMES_H
+#define REENSAMBLE_FRAMES_H
+
+#include "structProtocolo.h"
+
+// Fragmentos (CMD 11). El emisor parte los payloads largos de las clases
+// interactiva y masiva para que un comando de control pueda meterse entre
+// dos fragmentos en lugar de esperar un frame completo de 63 bytes.
+//   [sec << 6 | flujo << 4 | cmd original] [índice << 4 | total - 1] [datos...]
+// Cada flujo (una clase de prioridad del emisor, o la cola de los comandos
+// con clave cuando hay conflación) tiene a lo sumo un mensaje
+// a medio enviar, así que se reensambla en su propio buffer. 'sec' cuenta
+// los mensajes de cada flujo (2 bits): si se pierden el final de uno y el
+// principio del siguiente, los fragmentos no se pegan al mensaje equivocado.
+// Todos los fragmentos menos el último llevan la misma cantidad de datos.
+#define CMD_FRAGMENTO 11
+#define FRAG_CABECERA 2
+#define FRAG_FLUJOS 4      // 2 bits: uno por clase y el de las claves
+#define FRAG_MAX 16        // El índice ocupa 4 bits
+
+typedef struct
+{
+    BYTE cmd;
+    BYTE secuencia;
+    BYTE total;
+    BYTE siguiente;        // Índice esperado (0 = ningún mensaje a medias)
+    BYTE lng;
+    BYTE data[LARGO_DATA];
+} flujoReensamble;
+
+typedef struct
+{
+    flujoReensamble flujos[FRAG_FLUJOS];
+    unsigned long completos;
+    unsigned long descartados; // Mensajes a los que les faltó un fragmento
+} reensambleFrames;
+
+enum resultadoFragmento
+{
+    FRAG_NO_ES,            // No es un CMD 11: se procesa como siempre
+    FRAG_INCOMPLETO,       // Fragmento guardado, todavía no hay nada que ejecutar
+    FRAG_COMPLETO,         // 'proto' ahora es el frame original
+    FRAG_ERROR             // Fragmento fuera de orden o mal formado: se descarta
+};
+
+void reensambleIniciar(reensambleFrames& r);
+
+// Si 'proto' es el último fragmento de un mensaje, lo reemplaza (en el mismo
+// buffer) por el frame original, con el '\0' después del payload.
+resultadoFragmento reensambleProcesar(reensambleFrames& r, frameReceptor& proto);
+
+#endif
@@ -0,0 +1,375 @@
+#include "repetidor.h"
+#include "sobremuestreo.h"
+#include "trazas.h"
+#include "Arduino.h"
+
+// Símbolos de la cola de salida
+#define SIM_BYTE 0x000     // | byte: inicio, 8 de datos y las paradas
+#define SIM_CIERRE 0x100   // | paridad: paridad, stop final y el reposo
+#define SIM_CORTE 0x200    // Un byte en LOW más dos bits: error de sincronismo para el siguiente
+#define SIM_TIPO 0x300
+
+// --- Salida ---
+
+static int bitsSimbolo(uint16_t sim, int bits_parada) {
+    switch (sim & SIM_TIPO) {
+        case SIM_BYTE: return 9 + bits_parada;
+        case SIM_CIERRE: return 2 + REP_REPOSO_BITS;
+        default: return 11 + bits_parada + REP_REPOSO_BITS;
+    }
+}
+
+static int nivelSimbolo(uint16_t sim, int bit, int bits_parada) {
+    switch (sim & SIM_TIPO) {
+        case SIM_BYTE:
+            if (bit == 0) return LOW;
+            return (bit <= 8) ? ((sim >> (bit - 1)) & 1) : HIGH;
+        case SIM_CIERRE:
+            return (bit == 0) ? (sim & 1) : HIGH;
+        default:
+            return (bit < 11 + bits_parada) ? LOW : HIGH;
+    }
+}
+
+static int libres(const repetidor& r) {
+    return REP_COLA_SALIDA - r.salida.cantidad;
+}
+
+// Con la cola vacía, el primer símbolo sale ahora mismo
+static void encolar(repetidor& r, uint16_t sim) {
+    salidaRepetidor& s = r.salida;
+    if (s.cantidad == 0) {
+        unsigned long ahora = micros();
+        if ((long)(ahora - s.proximo_us) > 0) s.proximo_us = ahora;
+        s.bit = 0;
+    }
+    s.simbolos[(s.primero + s.cantidad) % REP_COLA_SALIDA] = sim;
+    s.cantidad++;
+}
+
+// Escribe los bits de la salida que ya tocan
+static void atenderSalida(repetidor& r) {
+    salidaRepetidor& s = r.salida;
+    unsigned long ahora = micros();
+    while (s.cantidad > 0 && (long)(ahora - s.proximo_us) >= 0) {
+        uint16_t sim = s.simbolos[s.primero];
+        int nivel = nivelSimbolo(sim, s.bit, r.bits_parada);
+        if (nivel != s.nivel) {
+            digitalWrite(r.pin_salida, nivel);
+            s.nivel = nivel;
+        }
+        s.proximo_us += r.bit_us;
+        if (++s.bit == bitsSimbolo(sim, r.bits_parada)) {
+            s.bit = 0;
+            s.primero = (s.primero + 1) % REP_COLA_SALIDA;
+            s.cantidad--;
+        }
+    }
+}
+
+static void esperarHasta(unsigned long objetivo_us) {
+    long falta = (long)(objetivo_us - micros());
+    if (falta > 0) delayMicroseconds(falta);
+}
+
+// Espera hasta 'objetivo_us' escribiendo en el medio los bits de la salida
+static void esperarAtendiendo(repetidor& r, unsigned long objetivo_us) {
+    salidaRepetidor& s = r.salida;
+    while (s.cantidad > 0 && (long)(s.proximo_us - objetivo_us) < 0) {
+        esperarHasta(s.proximo_us);
+        atenderSalida(r);
+    }
+    esperarHasta(objetivo_us);
+}
+
+// El byte 'i' del frame tal como sale: con un salto menos
+static BYTE byteSalida(const frameReceptor& proto, int i) {
+    BYTE b = proto.frame[i];
+    return (i == FrameEstandar::BYTES_CABECERA + REENVIO_SALTOS) ? (BYTE)(b - 1) : b;
+}
+
+// FCS (del frame con un salto menos), paridad y stop final. 'envenenar'
+// invierte un bit del FCS: el frame llegó mal y el siguiente lo tiene que descartar.
+static void cerrarSalida(repetidor& r, const frameReceptor& proto, int algoritmo_fcs, bool envenenar) {
+    BYTE salida[LARGO_FRAME];
+    int n = proto.lng + FrameEstandar::BYTES_CABECERA;
+    for (int i = 0; i < n; i++) salida[i] = byteSalida(proto, i);
+    unsigned short fcs = fcsSegun(algoritmo_fcs, salida, n);
+    if (envenenar) fcs ^= 1;
+    salida[n] = (BYTE)(fcs >> 8);
+    salida[n + 1] = (BYTE)(fcs & 0xFF);
+    encolar(r, SIM_BYTE | salida[n]);
+    encolar(r, SIM_BYTE | salida[n + 1]);
+    encolar(r, SIM_CIERRE | (FrameEstandar::paridadDe(salida, n + 2) ? 1 : 0));
+}
+
+// --- Entrada (como recibe.cpp, con sobremuestreo y atendiendo la salida) ---
+
+static unsigned long instanteMuestra(unsigned long inicio_us, unsigned long bit_us, int k, int m) {
+    return inicio_us + ((unsigned long)k * bit_us + bit_us / 2) / m;
+}
+
+static void esperarBajada(repetidor& r, int pin) {
+    while (r.salida.cantidad > 0) {
+        if (digitalRead(pin) == LOW) return;
+        esperarAtendiendo(r, micros() + r.bit_us / 16);
+    }
+    while (digitalRead(pin) == HIGH);
+}
+
+// readByte() con sobremuestreo. 'inicio_us' = instante de la bajada del bit de inicio
+static int leerByte(repetidor& r, int pin, unsigned long bit_us, const FormatoLinea& formato, BYTE* byte,
+                    unsigned long* inicio_us) {
+    BYTE muestras[SOBRE_MUESTRAS_BYTE_MAX];
+    int m = formato.muestras_por_bit;
+    int n = sobreMuestrasDeByte(formato);
+    int fin_inicio = sobreFinVentana(formato);
+
+    for (;;) {
+        esperarBajada(r, pin);
+        *inicio_us = micros();
+
+        bool inicio_valido = true;
+        for (int k = 0; k < n && inicio_valido; k++) {
+            esperarAtendiendo(r, instanteMuestra(*inicio_us, bit_us, k, m));
+            muestras[k] = digitalRead(pin);
+            if (k <= formato.glitch_max && muestras[k]) {
+                inicio_valido = false;
+            } else if (k == fin_inicio - 1 && sobreVotarBit(muestras, 0, formato).nivel) {
+                inicio_valido = false;
+            }
+        }
+        if (inicio_valido) {
+            return sobreDecodificarByte(muestras, formato, byte, &g_sobremuestreo);
+        }
+        g_sobremuestreo.inicios_falsos.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static int leerBitVotado(repetidor& r, int pin, unsigned long inicio_us, unsigned long bit_us,
+                         const FormatoLinea& formato) {
+    BYTE muestras[SOBRE_MUESTRAS_MAX];
+    int n = sobreFinVentana(formato);
+    for (int k = 0; k < n; k++) {
+        esperarAtendiendo(r, instanteMuestra(inicio_us, bit_us, k, formato.muestras_por_bit));
+        muestras[k] = digitalRead(pin);
+    }
+    int glitches = sobreFiltrarGlitches(muestras, n, formato.glitch_max);
+    if (glitches > 0) g_sobremuestreo.glitches.fetch_add(glitches, std::memory_order_relaxed);
+    votoBit v = sobreVotarBit(muestras, 0, formato);
+    sobreContarVoto(g_sobremuestreo, v);
+    return v.nivel;
+}
+
+// --- Decisiones ---
+
+static bool visto(const repetidor& r, BYTE origen, BYTE secuencia) {
+    for (int i = 0; i < r.num_vistos; i++) {
+        if (r.vistos[i].origen == origen && r.vistos[i].secuencia == secuencia) return true;
+    }
+    return false;
+}
+
+static void marcarVisto(repetidor& r, BYTE origen, BYTE secuencia) {
+    r.vistos[r.proximo_visto].origen = origen;
+    r.vistos[r.proximo_visto].secuencia = secuencia;
+    r.proximo_visto = (r.proximo_visto + 1) % REP_VISTOS;
+    if (r.num_vistos < REP_VISTOS) r.num_vistos++;
+}
+
+// Cut-through o store-and-forward según los errores recientes
+static void contarResultado(repetidor& r, bool valido) {
+    if (r.almacenar) {
+        r.limpios = valido ? r.limpios + 1 : 0;
+        if (r.limpios >= REP_LIMPIOS_PARA_VOLVER) {
+            r.almacenar = false;
+            r.errores_ventana = 0;
+            r.frames_ventana = 0;
+        }
+        return;
+    }
+    if (!valido && ++r.errores_ventana >= REP_UMBRAL_ERRORES) {
+        r.almacenar = true;
+        r.limpios = 0;
+        r.cambios_a_almacenar++;
+        return;
+    }
+    if (++r.frames_ventana >= REP_VENTANA) {
+        r.frames_ventana = 0;
+        r.errores_ventana = 0;
+    }
+}
+
+// --- API ---
+
+void repetidorIniciar(repetidor& r, int direccion, int pin_salida) {
+    memset(&r, 0, sizeof(r));
+    r.direccion = direccion;
+    r.pin_salida = pin_salida;
+    r.bit_us = (1000 / SPEED) * 1000;
+    r.bits_parada = FORMATO_RECEPCION.bits_parada;
+    r.salida.nivel = HIGH;
+    if (pin_salida >= 0) {
+        pinMode(pin_salida, OUTPUT);
+        digitalWrite(pin_salida, HIGH);
+    }
+}
+
+void repetidorEsperarInicio(repetidor& r, int pin) {
+    esperarBajada(r, pin);
+}
+
+resultadoRepetidor repetidorRecibir(repetidor& r, int pin, int speed, frameReceptor& proto,
+                                    const FormatoLinea& formato, int algoritmo_fcs) {
+    TRAZA_AMBITO_VALOR("repetidorRecibir", speed);
+    // La entrada se lee siempre con sobremuestreo: las esperas entre muestras
+    // son las que dejan escribir la salida
+    FormatoLinea f = formato;
+    if (!sobremuestreoValido(f)) {
+        f.muestras_por_bit = FORMATO_RECEPCION.muestras_por_bit;
+        f.glitch_max = FORMATO_RECEPCION.glitch_max;
+    }
+    unsigned long bit_us = (1000 / speed) * 1000UL;
+    proto.cmd = 0;
+    proto.lng = 0;
+
+    int paridad_frame = 0;
+    unsigned long inicio_byte = 0;
+    bool para_mi = true;
+    bool reenviar = false;
+    bool cut = false;
+    int total = FrameEstandar::BYTES_CABECERA; // Con el lng pasa a ser el frame entero
+
+    for (int i = 0; i < total; i++) {
+        int unos = leerByte(r, pin, bit_us, f, &proto.frame[i], &inicio_byte);
+        if (unos < 0) {
+            if (cut) {
+                encolar(r, SIM_CORTE);
+                r.envenenados++;
+            }
+            if (reenviar) contarResultado(r, false);
+            return REP_ERROR;
+        }
+        paridad_frame += unos;
+
+        if (i == 1) {
+            proto.cmd = FrameEstandar::cmdDe(proto.frame);
+            proto.lng = FrameEstandar::lngDe(proto.frame);
+            if (!FrameEstandar::lngValido(proto.lng)) return REP_ERROR;
+            total = FrameEstandar::largo(proto.lng);
+        }
+
+        if (cut && i < total - FrameEstandar::BYTES_FCS) {
+            encolar(r, SIM_BYTE | byteSalida(proto, i));
+        } else if (i == REENVIO_CABECERA - 1 && proto.cmd == CMD_REENVIO && proto.lng >= REENVIO_SOBRE) {
+            const BYTE* sobre = payload(proto);
+            BYTE destino = sobre[REENVIO_DESTINO];
+            para_mi = (destino == r.direccion || destino == REENVIO_DIFUSION);
+            if (destino != r.direccion && r.pin_salida >= 0) {
+                if (sobre[REENVIO_SALTOS] == 0) {
+                    if (!para_mi) r.sin_saltos++;
+                } else if (visto(r, sobre[REENVIO_ORIGEN], sobre[REENVIO_SECUENCIA])) {
+                    r.repetidos++; // Ya pasó por acá: un lazo en la red
+                    para_mi = false;
+                } else {
+                    reenviar = true;
+                }
+            }
+            // La cabecera ya llegó: lo que sigue sale a medida que llega
+            if (reenviar && !r.solo_almacenar && !r.almacenar && libres(r) >= total + 1) {
+                if (r.salida.cantidad == 0) {
+                    r.bit_us = (int)bit_us;
+                    r.bits_parada = f.bits_parada;
+                }
+                cut = true;
+                for (int j = 0; j <= i; j++) encolar(r, SIM_BYTE | byteSalida(proto, j));
+            }
+        }
+    }
+
+    // Paridad y stop final: siguen al último byte sin esperar otra bajada
+    unsigned long inicio_paridad = inicio_byte + (unsigned long)(9 + f.bits_parada) * bit_us;
+    int paridad_recibida = leerBitVotado(r, pin, inicio_paridad, bit_us, f);
+    bool sincronizado = leerBitVotado(r, pin, inicio_paridad + bit_us, bit_us, f) &&
+                        paridad_recibida == (paridad_frame % 2 != 0);
+
+    if (reenviar) {
+        bool valido = sincronizado &&
+                      fcsSegun(algoritmo_fcs, proto.frame, proto.lng + FrameEstandar::BYTES_CABECERA) ==
+                          FrameEstandar::fcsEscrito(proto.frame, proto.lng);
+        if (cut) {
+            cerrarSalida(r, proto, algoritmo_fcs, !valido);
+            if (valido) r.cut_through++;
+            else r.envenenados++;
+        } else if (valido) {
+            // Store-and-forward: sale entero, ya verificado
+            if (libres(r) >= total + 1) {
+                if (r.salida.cantidad == 0) {
+                    r.bit_us = (int)bit_us;
+                    r.bits_parada = f.bits_parada;
+                }
+                for (int j = 0; j < total - FrameEstandar::BYTES_FCS; j++) {
+                    encolar(r, SIM_BYTE | byteSalida(proto, j));
+                }
+                cerrarSalida(r, proto, algoritmo_fcs, false);
+                r.almacenados++;
+            } else {
+                r.sin_lugar++;
+            }
+        }
+        if (valido) {
+            const BYTE* sobre = payload(proto);
+            marcarVisto(r, sobre[REENVIO_ORIGEN], sobre[REENVIO_SECUENCIA]);
+        }
+        contarResultado(r, valido);
+    }
+
+    if (!sincronizado) return REP_ERROR;
+    if (para_mi) return REP_LOCAL;
+    return reenviar ? REP_REENVIADO : REP_DESCARTADO;
+}
+
+void repetidorLimpiarRX(repetidor& r, int pin) {
+    unsigned long quieto = millis();
+    while (millis() - quieto < 1000) {
+        if (digitalRead(pin) == LOW) {
+            quieto = millis();
+        }
+        esperarAtendiendo(r, micros() + 1000);
+    }
+}
+
+void repetidorVaciar(repetidor& r) {
+    while (r.salida.cantidad > 0) {
+        esperarHasta(r.salida.proximo_us);
+        atenderSalida(r);
+    }
+}
+
+bool repetidorDesenvolver(repetidor& r, frameReceptor& proto) {
+    if (proto.cmd != CMD_REENVIO) return true;
+    BYTE* datos = payload(proto);
+    BYTE destino = (proto.lng >= REENVIO_SOBRE) ? datos[REENVIO_DESTINO] : 0;
+    BYTE cmd = (proto.lng >= REENVIO_SOBRE) ? datos[REENVIO_CMD] : CMD_REENVIO;
+    if ((destino != r.direccion && destino != REENVIO_DIFUSION) || cmd == CMD_REENVIO ||
+        cmd > FrameEstandar::CMD_MAX) {
+        r.no_desenvueltos++;
+        return false;
+    }
+    proto.cmd = cmd;
+    proto.lng -= REENVIO_SOBRE;
+    memmove(datos, datos + REENVIO_SOBRE, proto.lng);
+    datos[proto.lng] = '\0'; // Los comandos de texto esperan el terminador
+    r.locales++;
+    return true;
+}
+
+void repetidorImprimir(const repetidor& r) {
+    Serial.printf("  Repetidor CMD 13 (nodo %d, %s): %lu locales, %lu cut-through, %lu store-and-forward\n",
+                  r.direccion, r.almacenar ? "store-and-forward" : "cut-through", r.locales,
+                  r.cut_through, r.almacenados);
+    Serial.printf("    Envenenados: %lu, sin saltos: %lu, repetidos: %lu, sin lugar: %lu, "
+                  "pasos a store-and-forward: %lu, mal formados: %lu\n",
+                  r.envenenados, r.sin_saltos, r.repetidos, r.sin_lugar, r.cambios_a_almacenar,
+                  r.no_desenvueltos);
+}
@@ -0,0 +1,110 @@
+#ifndef REPETIDOR_H
+#define REPETIDOR_H
+
+#include <stdint.h>
+#include "structProtocolo.h"
+#include "negociacionEnlace.h"
+#include "reenvioFrame.h"
+
+// Modo repetidor (CMD 13, ver reenvioFrame.h): los frames que no son para
+// esta placa salen por TX_REENVIO_PIN hacia la siguiente. Descomentar
+// MODO_REPETIDOR y darle a cada placa su DIRECCION_NODO.
+// #define MODO_REPETIDOR
+#define DIRECCION_NODO 1
+#define TX_REENVIO_PIN 14
+
+// Cut-through: apenas llega la cabecera del sobre (REENVIO_CABECERA bytes)
+// el frame empieza a salir, y cada byte sale mientras llega el siguiente:
+// cada salto agrega el tiempo de la cabecera y no el del frame entero. El
+// FCS y la paridad se escriben al final, cuando el frame ya se verificó:
+// si llegó mal, el FCS sale invertido (y un error de sincronismo a mitad
+// del frame sale como un corte en LOW), así el siguiente lo descarta.
+// Con REP_UMBRAL_ERRORES frames malos dentro de REP_VENTANA, el repetidor
+// pasa a store-and-forward: solo reenvía frames enteros ya verificados.
+// Vuelve al cut-through después de REP_LIMPIOS_PARA_VOLVER frames buenos.
+#define REP_UMBRAL_ERRORES 3
+#define REP_VENTANA 16
+#define REP_LIMPIOS_PARA_VOLVER 32
+#define REP_VISTOS 16          // Pares (origen, secuencia) recientes contra los lazos
+#define REP_REPOSO_BITS 3      // Reposo después de cada frame reenviado (como el emisor)
+
+// La salida es una cola de símbolos (un byte, el cierre del frame o un
+// corte) que se escriben bit a bit mientras se espera la próxima muestra
+// de la entrada. Entran dos frames: el que sale y el que llega detrás.
+#define REP_COLA_SALIDA (2 * (LARGO_FRAME + 2))
+
+enum resultadoRepetidor
+{
+    REP_LOCAL,             // Frame para esta placa (o difusión): se procesa como siempre
+    REP_REENVIADO,         // Era para otra: ya salió (o está saliendo) por la salida
+    REP_DESCARTADO,        // Para otra, pero sin saltos, repetido o sin lugar en la salida
+    REP_ERROR              // Error de sincronismo o de paridad (como recibirFrame() == false)
+};
+
+typedef struct
+{
+    uint16_t simbolos[REP_COLA_SALIDA];
+    int primero;
+    int cantidad;
+    int bit;                   // Bit del primer símbolo que sigue
+    unsigned long proximo_us;  // Instante de ese bit
+    int nivel;                 // Último nivel escrito
+} salidaRepetidor;
+
+typedef struct
+{
+    BYTE origen;
+    BYTE secuencia;
+} frameVisto;
+
+typedef struct
+{
+    int direccion;
+    int pin_salida;
+    int bit_us;                // De la velocidad del frame que está saliendo
+    int bits_parada;
+    bool solo_almacenar;       // Sin cut-through nunca (para comparar)
+    bool almacenar;            // En store-and-forward por errores
+    salidaRepetidor salida;
+    frameVisto vistos[REP_VISTOS];
+    int num_vistos;
+    int proximo_visto;
+    int errores_ventana;
+    int frames_ventana;
+    int limpios;
+
+    // La tarea de recepción suma; CMD 6 los lee
+    unsigned long locales;
+    unsigned long cut_through;
+    unsigned long almacenados;     // Reenviados enteros (store-and-forward)
+    unsigned long envenenados;     // Salieron con el FCS invertido o cortados
+    unsigned long sin_saltos;
+    unsigned long repetidos;
+    unsigned long sin_lugar;
+    unsigned long cambios_a_almacenar;
+    unsigned long no_desenvueltos; // CMD 13 mal formados o para otra dirección
+} repetidor;
+
+void repetidorIniciar(repetidor& r, int direccion, int pin_salida);
+
+// Espera el bit de inicio del próximo frame sin dejar de escribir la salida
+void repetidorEsperarInicio(repetidor& r, int pin);
+
+// Como recibirFrame(), reenviando lo que no es para esta placa. 'proto'
+// queda como lo dejaría recibirFrame() (con el sobre; lo saca repetidorDesenvolver)
+resultadoRepetidor repetidorRecibir(repetidor& r, int pin, int speed, frameReceptor& proto,
+                                    const FormatoLinea& formato, int algoritmo_fcs);
+
+// Como flushRX(): espera 1 s de silencio en 'pin', escribiendo la salida
+void repetidorLimpiarRX(repetidor& r, int pin);
+
+// Termina de escribir lo que queda en la salida
+void repetidorVaciar(repetidor& r);
+
+// Si 'proto' es un CMD 13 para esta placa (o difusión), lo reemplaza (en el
+// mismo buffer) por el frame original. Retorna false si no se debe ejecutar.
+bool repetidorDesenvolver(repetidor& r, frameReceptor& proto);
+
+void repetidorImprimir(const repetidor& r);
+
+#endif
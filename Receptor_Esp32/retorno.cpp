@@ -0,0 +1,41 @@
+#include "retorno.h"
+#include "Arduino.h"
+
+void retornoIniciar(int pin) {
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, HIGH); // Reposo
+}
+
+// Igual que empaquetar() del emisor, pero el payload ya está en su lugar
+int empaquetarRetorno(frameReceptor& proto) {
+    int largo = FrameEstandar::cerrar(proto.frame, proto.cmd, proto.lng);
+    proto.fcs = FrameEstandar::fcsEscrito(proto.frame, proto.lng);
+    return largo;
+}
+
+// Igual que enviarFrame() del emisor. Corre en la tarea de comandos, así
+// que no frena la recepción del core 0.
+void enviarFrameRetorno(int pin, int speed, frameReceptor& proto, int largo) {
+    unsigned long msTime = 1000 / speed;
+    int paridad = 0;
+
+    for (int j = 0; j < largo; j++) {
+        digitalWrite(pin, LOW); // Bit de inicio
+        delay(msTime);
+
+        BYTE b = proto.frame[j];
+        for (int i = 0; i < 8; i++) {
+            bool level = (b >> i) & 0x01;
+            digitalWrite(pin, level);
+            if (level) paridad++;
+            delay(msTime);
+        }
+
+        digitalWrite(pin, HIGH); // 2 bits de parada
+        delay(msTime * 2);
+    }
+
+    digitalWrite(pin, (paridad % 2 == 0) ? LOW : HIGH); // Paridad del frame
+    delay(msTime);
+    digitalWrite(pin, HIGH);
+}
@@ -0,0 +1,16 @@
+#ifndef RETORNO_H
+#define RETORNO_H
+
+#include "structProtocolo.h"
+
+// Línea de retorno ESP32 -> RPi: mismo formato de frame que la de ida
+// (bit de inicio, 8 bits LSB primero, 2 de parada, paridad del frame).
+// La usan las respuestas del control del enlace (CMD 10) y las de los
+// pedidos RPC (CMD 12).
+#define TX_RETORNO_PIN 23
+
+void retornoIniciar(int pin);
+int empaquetarRetorno(frameReceptor& proto);
+void enviarFrameRetorno(int pin, int speed, frameReceptor& proto, int largo);
+
+#endif
@@ -0,0 +1,40 @@
+#include "rpcReceptor.h"
+
+void rpcIniciar(servidorRpc& s) {
+    memset(&s, 0, sizeof(servidorRpc));
+}
+
+void rpcRegistrar(servidorRpc& s, int metodo, metodoRpc funcion) {
+    if (metodo >= 0 && metodo < RPC_NUM_METODOS) {
+        s.metodos[metodo] = funcion;
+    }
+}
+
+bool rpcProcesar(servidorRpc& s, const frameReceptor& pedido, frameReceptor& respuesta) {
+    const BYTE* p = payload(pedido);
+    // Sin id no hay a quién responder
+    if (pedido.lng < RPC_CABECERA || p[0] != RPC_PEDIDO) return false;
+
+    BYTE* r = payload(respuesta);
+    respuesta.cmd = CMD_RPC;
+    r[0] = RPC_RESPUESTA;
+    r[1] = p[1]; // El id vuelve tal cual
+
+    int metodo = p[2];
+    int lng_datos = -1;
+    if (metodo >= RPC_NUM_METODOS || s.metodos[metodo] == NULL) {
+        r[2] = RPC_METODO_DESCONOCIDO;
+    } else {
+        lng_datos = s.metodos[metodo](p + RPC_CABECERA, pedido.lng - RPC_CABECERA, r + RPC_CABECERA);
+        r[2] = (lng_datos < 0) ? RPC_ARGUMENTOS_INVALIDOS : RPC_OK;
+    }
+
+    if (lng_datos < 0) {
+        s.rechazados++;
+        lng_datos = 0;
+    } else {
+        s.atendidos++;
+    }
+    respuesta.lng = (BYTE)(RPC_CABECERA + lng_datos);
+    return true;
+}
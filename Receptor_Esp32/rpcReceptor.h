@@ -0,0 +1,66 @@
+#ifndef RPC_RECEPTOR_H
+#define RPC_RECEPTOR_H
+
+#include <stdint.h>
+#include "structProtocolo.h"
+
+// Pedido/respuesta (CMD 12). Cada pedido lleva un id que la respuesta
+// repite: el emisor puede tener varios pedidos en vuelo a la vez y
+// empareja cada respuesta con el suyo (los que se pierden los vence él).
+//   PEDIDO    [0][id][método][argumentos...]   emisor -> receptor
+//   RESPUESTA [1][id][estado][datos...]        receptor -> emisor
+// Las respuestas viajan por la línea de retorno (ver retorno.h) en el
+// orden en que llegaron los pedidos. Igual que en Emisor_Rasp_Funcional/rpcEmisor.h.
+#define CMD_RPC 12
+#define RPC_PEDIDO 0
+#define RPC_RESPUESTA 1
+#define RPC_CABECERA 3 // Tipo, id y método (o estado)
+#define RPC_DATOS_MAX (LARGO_DATA - RPC_CABECERA)
+
+// Métodos
+#define RPC_ESTADISTICAS 0  // Los contadores que imprime el CMD 6
+#define RPC_CONFIGURACION 1 // Velocidades y parámetros del receptor
+#define RPC_SALUD 2         // Tiempo encendido, heap libre, pico del pipeline
+#define RPC_ETAPAS 3        // Latencia por etapas de los últimos frames (etapasLatencia.h)
+#define RPC_NUM_METODOS 4
+
+// Reposo tras cada frame antes del siguiente (pedidos o respuestas seguidos):
+// el que recibe lee la paridad y el stop final hasta 3 bits después.
+#define RPC_SEPARACION_BITS 3
+
+// Estados de la respuesta
+#define RPC_OK 0
+#define RPC_METODO_DESCONOCIDO 1
+#define RPC_ARGUMENTOS_INVALIDOS 2
+
+// Un método escribe su resultado en 'datos' (hasta RPC_DATOS_MAX bytes) y
+// retorna cuántos escribió, o -1 si los argumentos no sirven.
+typedef int (*metodoRpc)(const BYTE* args, int lng, BYTE* datos);
+
+typedef struct
+{
+    metodoRpc metodos[RPC_NUM_METODOS]; // NULL = no disponible
+    unsigned long atendidos;
+    unsigned long rechazados;           // Método desconocido o argumentos inválidos
+} servidorRpc;
+
+void rpcIniciar(servidorRpc& s);
+void rpcRegistrar(servidorRpc& s, int metodo, metodoRpc funcion);
+
+// Atiende un CMD 12. Retorna true si hay que enviar 'respuesta' por el retorno.
+bool rpcProcesar(servidorRpc& s, const frameReceptor& pedido, frameReceptor& respuesta);
+
+// Enteros en big endian (como el FCS). Retornan los bytes escritos.
+static inline int rpcPoner16(BYTE* p, uint16_t v) {
+    p[0] = (BYTE)(v >> 8);
+    p[1] = (BYTE)v;
+    return 2;
+}
+
+static inline int rpcPoner32(BYTE* p, uint32_t v) {
+    rpcPoner16(p, (uint16_t)(v >> 16));
+    rpcPoner16(p + 2, (uint16_t)v);
+    return 4;
+}
+
+#endif
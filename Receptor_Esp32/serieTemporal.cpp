@@ -0,0 +1,107 @@
+#include "serieTemporal.h"
+#include <string.h>
+
+void serieIniciar(serieTemporal& serie) {
+    memset(&serie, 0, sizeof(serieTemporal));
+    serie.secuencia_esperada = -1;
+}
+
+/**
+ * Agrega un punto a un nivel y, cada SERIE_FACTOR puntos, pasa el
+ * resumen al nivel siguiente.
+ */
+static void agregarPunto(serieTemporal& serie, int nivel, const puntoSerie& p) {
+    nivelSerie& n = serie.niveles[nivel];
+
+    uint16_t pos = (n.inicio + n.cantidad) % SERIE_PUNTOS;
+    n.puntos[pos] = p;
+    if (n.cantidad < SERIE_PUNTOS) {
+        n.cantidad++;
+    } else {
+        n.inicio = (n.inicio + 1) % SERIE_PUNTOS; // Se pisa el más antiguo
+    }
+
+    if (nivel + 1 >= SERIE_NIVELES) return;
+
+    if (n.acc_n == 0 || p.min < n.acc_min) n.acc_min = p.min;
+    if (n.acc_n == 0 || p.max > n.acc_max) n.acc_max = p.max;
+    n.acc_suma = (n.acc_n == 0) ? p.prom : n.acc_suma + p.prom;
+    n.acc_n++;
+
+    if (n.acc_n == SERIE_FACTOR) {
+        puntoSerie resumen;
+        resumen.min = n.acc_min;
+        resumen.max = n.acc_max;
+        resumen.prom = (int16_t)(n.acc_suma / SERIE_FACTOR);
+        n.acc_n = 0;
+        agregarPunto(serie, nivel + 1, resumen);
+    }
+}
+
+void serieAgregar(serieTemporal& serie, int16_t valor) {
+    puntoSerie p = {valor, valor, valor};
+    agregarPunto(serie, 0, p);
+    serie.ultimo = valor;
+    serie.muestras_total++;
+}
+
+// Lee un varint (7 bits por byte, bit alto = continúa). false si se corta.
+static bool leerVarint(const BYTE* datos, int lng, int& pos, uint32_t& v) {
+    v = 0;
+    for (int corrimiento = 0; corrimiento < 35; corrimiento += 7) {
+        if (pos >= lng) return false;
+        BYTE b = datos[pos++];
+        v |= (uint32_t)(b & 0x7F) << corrimiento;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static int32_t deshacerZigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+int decodificarTelemetria(const BYTE* datos, int lng, BYTE* secuencia, uint16_t* periodo_ms,
+                          int16_t* muestras, int max_muestras) {
+    if (lng < 1) return -1;
+    int pos = 0;
+    *secuencia = datos[pos++];
+
+    uint32_t v;
+    if (!leerVarint(datos, lng, pos, v)) return -1;
+    *periodo_ms = (uint16_t)v;
+
+    int n = 0;
+    int32_t valor = 0;
+    while (pos < lng) {
+        if (n >= max_muestras || !leerVarint(datos, lng, pos, v)) return -1;
+        valor = (n == 0) ? deshacerZigzag(v) : valor + deshacerZigzag(v);
+        muestras[n++] = (int16_t)valor;
+    }
+    return n;
+}
+
+int serieAgregarFrame(serieTemporal& serie, const BYTE* datos, int lng) {
+    BYTE secuencia;
+    uint16_t periodo_ms;
+    int16_t muestras[LARGO_DATA];
+
+    int n = decodificarTelemetria(datos, lng, &secuencia, &periodo_ms, muestras, LARGO_DATA);
+    if (n < 0) return -1;
+
+    if (serie.secuencia_esperada >= 0 && secuencia != serie.secuencia_esperada) {
+        serie.frames_perdidos += (BYTE)(secuencia - serie.secuencia_esperada);
+    }
+    serie.secuencia_esperada = (BYTE)(secuencia + 1);
+    serie.periodo_ms = periodo_ms;
+
+    for (int i = 0; i < n; i++) {
+        serieAgregar(serie, muestras[i]);
+    }
+    return n;
+}
+
+const puntoSerie& seriePunto(const serieTemporal& serie, int nivel, int i) {
+    const nivelSerie& n = serie.niveles[nivel];
+    return n.puntos[(n.inicio + i) % SERIE_PUNTOS];
+}
@@ -0,0 +1,63 @@
+#ifndef SERIE_TEMPORAL_H
+#define SERIE_TEMPORAL_H
+
+#include <stdint.h>
+#include "structProtocolo.h"
+
+// Telemetría continua de temperatura (CMD 8). Formato del payload:
+//   [SEQ] [periodo_ms varint] [1ra muestra zigzag varint] [deltas zigzag varint...]
+// Las muestras vienen en centésimas de grado (2350 = 23.50 °C).
+#define CMD_TELEMETRIA 8
+#define TELEMETRIA_ESCALA 100
+
+// Cada nivel guarda SERIE_PUNTOS puntos; cada punto del nivel n+1 resume
+// SERIE_FACTOR puntos del nivel n (min/max/promedio). Con 3 niveles:
+// 128 muestras crudas, 1024 y 8192 muestras resumidas, en ~2.3 KB de RAM.
+#define SERIE_PUNTOS 128
+#define SERIE_FACTOR 8
+#define SERIE_NIVELES 3
+
+typedef struct
+{
+    int16_t min;
+    int16_t max;
+    int16_t prom;
+} puntoSerie;
+
+typedef struct
+{
+    puntoSerie puntos[SERIE_PUNTOS]; // Anillo: 'inicio' es el más antiguo
+    uint16_t inicio;
+    uint16_t cantidad;
+
+    // Punto del nivel siguiente que se está armando
+    int16_t acc_min;
+    int16_t acc_max;
+    int32_t acc_suma;
+    uint8_t acc_n;
+} nivelSerie;
+
+typedef struct
+{
+    nivelSerie niveles[SERIE_NIVELES];
+    int16_t ultimo;
+    uint16_t periodo_ms;
+    int secuencia_esperada;            // -1 = todavía no llegó ningún frame
+    unsigned long muestras_total;
+    unsigned long frames_perdidos;     // Huecos en la secuencia
+} serieTemporal;
+
+void serieIniciar(serieTemporal& serie);
+void serieAgregar(serieTemporal& serie, int16_t valor);
+
+// Devuelve cuántas muestras se decodificaron (-1 si el payload está mal formado)
+int decodificarTelemetria(const BYTE* datos, int lng, BYTE* secuencia, uint16_t* periodo_ms,
+                          int16_t* muestras, int max_muestras);
+
+// Decodifica un frame CMD 8 y agrega sus muestras. Devuelve las agregadas o -1.
+int serieAgregarFrame(serieTemporal& serie, const BYTE* datos, int lng);
+
+// i = 0 es el punto más antiguo del nivel
+const puntoSerie& seriePunto(const serieTemporal& serie, int nivel, int i);
+
+#endif
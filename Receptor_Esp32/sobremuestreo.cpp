@@ -0,0 +1,121 @@
+#include "sobremuestreo.h"
+
+estadisticasSobremuestreo g_sobremuestreo;
+
+// La ventana de voto es la mitad del bit, centrada en el punto de muestreo
+// (sin salirse del bit)
+static int anchoVentana(const FormatoLinea& formato) {
+    return formato.muestras_por_bit / 2;
+}
+
+static int inicioVentana(const FormatoLinea& formato) {
+    int m = formato.muestras_por_bit;
+    int ini = m * formato.muestreo_pct / 100 - anchoVentana(formato) / 2;
+    if (ini < 0) ini = 0;
+    if (ini > m - anchoVentana(formato)) ini = m - anchoVentana(formato);
+    return ini;
+}
+
+bool sobremuestreoValido(const FormatoLinea& formato) {
+    int m = formato.muestras_por_bit;
+    // Un glitch_max de más de 1/4 de bit podría comerse un bit real
+    // acortado por el corrimiento de los flancos
+    return m >= SOBRE_MUESTRAS_MIN && m <= SOBRE_MUESTRAS_MAX &&
+           formato.bits_parada >= 1 && formato.bits_parada <= SOBRE_BITS_BYTE_MAX - 9 &&
+           formato.glitch_max >= 0 && formato.glitch_max <= m / 4 &&
+           formato.muestreo_pct > 0 && formato.muestreo_pct < 100;
+}
+
+int sobreFinVentana(const FormatoLinea& formato) {
+    return inicioVentana(formato) + anchoVentana(formato);
+}
+
+int sobreMuestrasDeByte(const FormatoLinea& formato) {
+    return (8 + formato.bits_parada) * formato.muestras_por_bit + sobreFinVentana(formato);
+}
+
+int sobreFiltrarGlitches(BYTE* muestras, int n, int ancho_max) {
+    if (ancho_max <= 0) return 0;
+    int invertidos = 0;
+    int ini = 0;
+    while (ini < n) {
+        int fin = ini + 1;
+        while (fin < n && muestras[fin] == muestras[ini]) fin++;
+        // Solo los tramos con vecinos a los dos lados: el primero es el bit
+        // de inicio y el último puede estar cortado
+        if (ini > 0 && fin < n && fin - ini <= ancho_max) {
+            for (int k = ini; k < fin; k++) muestras[k] = !muestras[k];
+            invertidos++;
+        }
+        ini = fin;
+    }
+    return invertidos;
+}
+
+votoBit sobreVotarBit(const BYTE* muestras, int indice, const FormatoLinea& formato) {
+    int m = formato.muestras_por_bit;
+    int ancho = anchoVentana(formato);
+    const BYTE* ventana = muestras + indice * m + inicioVentana(formato);
+
+    int unos = 0;
+    for (int k = 0; k < ancho; k++) unos += ventana[k] ? 1 : 0;
+    int ceros = ancho - unos;
+
+    votoBit v;
+    if (unos != ceros) {
+        v.nivel = (unos > ceros) ? 1 : 0;
+    } else {
+        // Empate: decide la muestra del punto de muestreo
+        int centro = m * formato.muestreo_pct / 100;
+        if (centro >= m) centro = m - 1;
+        v.nivel = muestras[indice * m + centro] ? 1 : 0;
+    }
+    v.confianza = (unos > ceros ? unos - ceros : ceros - unos) * 100 / ancho;
+    return v;
+}
+
+void sobreContarVoto(estadisticasSobremuestreo& e, const votoBit& v) {
+    e.bits.fetch_add(1, std::memory_order_relaxed);
+    e.confianza_total.fetch_add(v.confianza, std::memory_order_relaxed);
+    if (v.confianza < SOBRE_CONFIANZA_DUDOSA) e.bits_dudosos.fetch_add(1, std::memory_order_relaxed);
+    int tramo = v.confianza * SOBRE_TRAMOS_CONFIANZA / 100;
+    if (tramo >= SOBRE_TRAMOS_CONFIANZA) tramo = SOBRE_TRAMOS_CONFIANZA - 1;
+    e.por_tramo[tramo].fetch_add(1, std::memory_order_relaxed);
+}
+
+int sobreDecodificarByte(BYTE* muestras, const FormatoLinea& formato, BYTE* byte,
+                         estadisticasSobremuestreo* estadisticas) {
+    int n = sobreMuestrasDeByte(formato);
+    int glitches = sobreFiltrarGlitches(muestras, n, formato.glitch_max);
+    if (estadisticas != NULL && glitches > 0) {
+        estadisticas->glitches.fetch_add(glitches, std::memory_order_relaxed);
+    }
+
+    *byte = 0;
+    int paridad_byte = 0;
+    for (int i = 0; i < 9 + formato.bits_parada; i++) {
+        votoBit v = sobreVotarBit(muestras, i, formato);
+        if (estadisticas != NULL) sobreContarVoto(*estadisticas, v);
+
+        if (i == 0) {
+            if (v.nivel) return -1; // Inicio en HIGH
+        } else if (i <= 8) {
+            if (v.nivel) {
+                *byte = *byte | (1 << (i - 1));
+                paridad_byte++;
+            }
+        } else if (!v.nivel) {
+            return -1; // Parada en LOW
+        }
+    }
+    return paridad_byte;
+}
+
+void sobreReiniciar(estadisticasSobremuestreo& e) {
+    e.bits = 0;
+    e.bits_dudosos = 0;
+    e.confianza_total = 0;
+    for (int i = 0; i < SOBRE_TRAMOS_CONFIANZA; i++) e.por_tramo[i] = 0;
+    e.glitches = 0;
+    e.inicios_falsos = 0;
+}
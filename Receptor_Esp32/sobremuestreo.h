@@ -0,0 +1,78 @@
+#ifndef SOBREMUESTREO_H
+#define SOBREMUESTREO_H
+
+#include <stdint.h>
+#include <atomic>
+#include "structProtocolo.h"
+
+// Recepción con sobremuestreo (FormatoLinea::muestras_por_bit > 0): cada bit
+// se lee 'muestras_por_bit' veces y se decide por mayoría en una ventana de
+// la mitad del bit alrededor del punto de muestreo. Antes del voto se
+// descartan los pulsos de hasta 'glitch_max' muestras (ruido más corto que
+// un bit). Con una sola lectura por bit, un pulso de ruido que cae justo en
+// el punto de muestreo cambia el bit; con el voto tiene que tapar la mitad
+// de la ventana.
+//
+// El núcleo trabaja sobre un arreglo de muestras (0/1) y no lee la línea:
+// recibe.cpp toma las muestras y Herramientas_Host lo prueba con muestras
+// sintéticas con ruido.
+#define SOBRE_MUESTRAS_MIN 8
+#define SOBRE_MUESTRAS_MAX 16
+#define SOBRE_BITS_BYTE_MAX 13 // Inicio + 8 de datos + hasta 4 de parada
+#define SOBRE_MUESTRAS_BYTE_MAX (SOBRE_BITS_BYTE_MAX * SOBRE_MUESTRAS_MAX)
+
+// Un bit con confianza menor se cuenta como dudoso
+#define SOBRE_CONFIANZA_DUDOSA 50
+#define SOBRE_TRAMOS_CONFIANZA 5 // Histograma: 0-19, 20-39, 40-59, 60-79, 80-100
+
+// La tarea de recepción suma y la de comandos lee (CMD 6): contadores atómicos
+typedef struct
+{
+    std::atomic<unsigned long> bits;
+    std::atomic<unsigned long> bits_dudosos;
+    std::atomic<unsigned long> confianza_total;   // Suma de la confianza de cada bit
+    std::atomic<unsigned long> por_tramo[SOBRE_TRAMOS_CONFIANZA];
+    std::atomic<unsigned long> glitches;          // Pulsos descartados por el filtro
+    std::atomic<unsigned long> inicios_falsos;    // Bajadas que eran ruido, no un bit de inicio
+} estadisticasSobremuestreo;
+
+extern estadisticasSobremuestreo g_sobremuestreo;
+
+// Voto de un bit: nivel decidido y confianza 0..100 (100 = todas las
+// muestras de la ventana iguales, 0 = empate)
+typedef struct
+{
+    int nivel;
+    int confianza;
+} votoBit;
+
+// true si 'formato' pide sobremuestreo y se puede hacer
+bool sobremuestreoValido(const FormatoLinea& formato);
+
+// Muestras de un bit hasta el final de su ventana de voto
+int sobreFinVentana(const FormatoLinea& formato);
+
+// Muestras de un byte: desde el bit de inicio hasta la ventana del último
+// bit de parada (después queda 1/4 de bit para ver la bajada siguiente)
+int sobreMuestrasDeByte(const FormatoLinea& formato);
+
+// Invierte los tramos interiores de hasta 'ancho_max' muestras iguales
+// (los dos vecinos tienen el otro nivel). Retorna cuántos invirtió.
+int sobreFiltrarGlitches(BYTE* muestras, int n, int ancho_max);
+
+// Voto del bit 'indice' (0 = inicio) del arreglo de muestras del byte
+votoBit sobreVotarBit(const BYTE* muestras, int indice, const FormatoLinea& formato);
+
+// Filtra y decodifica un byte ya muestreado. Retorna los bits en 1 del byte
+// (para la paridad del frame) o -1 si el inicio o una parada no son válidos.
+// Con 'estadisticas' != NULL suma la confianza de cada bit y los glitches.
+int sobreDecodificarByte(BYTE* muestras, const FormatoLinea& formato, BYTE* byte,
+                         estadisticasSobremuestreo* estadisticas);
+
+// Suma un voto a las estadísticas (la paridad y el stop final del frame
+// se votan aparte en recibe.cpp)
+void sobreContarVoto(estadisticasSobremuestreo& e, const votoBit& v);
+
+void sobreReiniciar(estadisticasSobremuestreo& e);
+
+#endif
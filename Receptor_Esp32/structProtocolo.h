@@ -1,24 +1,49 @@
-#ifndef STRUCT_PROTOCOLO_H
-#define STRUCT_PROTOCOLO_H
+#ifndef STRUCT_PROTOCOLO_RECEPTOR_H
+#define STRUCT_PROTOCOLO_RECEPTOR_H
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "frameProtocolo.h" // Formato del frame, común con el emisor (../Protocolo_Comun)
+
+// Puntos de traza (trazas.h): descomentar para compilarlos y volcarlos con
+// una 't' por el monitor serie. Sin TRAZAS no generan código.
+// #define TRAZAS
 
 #define BYTE unsigned char
 #define LARGO_DATA 63
 #define BYTES_EXTRA 4 // CMD + LNG + FCS[2]
+#define LARGO_FRAME (LARGO_DATA + BYTES_EXTRA)
+static_assert(LARGO_FRAME == FrameEstandar::LARGO_MAX, "structProtocolo.h no coincide con FrameEstandar");
 #define RX_PIN 13
-#define SPEED 10
 
+// Cómo lee la línea el receptor: la señal estándar, con 8 muestras por bit,
+// voto de mayoría y los pulsos de ruido de 1 muestra descartados (ver sobremuestreo.h)
+static constexpr FormatoLinea FORMATO_RECEPCION = {2, 50, 8, 1};
+#define SPEED 10 // Velocidad base: la de arranque y la de recuperación
+
+// Escalera de velocidades del control adaptativo (CMD 10). El índice 0 es
+// SPEED. 1000/bps tiene que ser entero (el bit se mide en ms). Igual que en el emisor.
+#define VELOCIDADES_BPS {10, 20, 25, 50, 100, 125, 200, 250}
+#define NUM_VELOCIDADES 8
+
+// Un frame es un único buffer, tal como llegó por la línea. La cabecera se
+// decodifica en cmd/lng y el payload se lee en su lugar con payload(), sin
+// copiarlo. desempaquetar() escribe un '\0' sobre el primer byte del FCS
+// (ya verificado) para que los comandos de texto tengan su terminador.
 typedef struct 
 {
+    BYTE frame[LARGO_FRAME]; // CMD | LNG | payload | FCS alto | FCS bajo
     BYTE cmd;// (0x0F)<<2  -  4 bits -> 0-0-1-1 | 1-1-0-0
     BYTE lng;// (0x3F)<<1  -  6 bits -> 0-1-1-1 | 1-1-1-0  
-    BYTE data[LARGO_DATA];
-    BYTE frame[LARGO_DATA+BYTES_EXTRA];
     unsigned short fcs;//2 Bytes -> Para poder contar los bits activos, 63 de data + 4 de bits y 6 de lng.
+    uint32_t t_inicio_us;// micros() del bit de inicio y del fin del frame (latencia por etapas)
+    uint32_t t_fin_us;
+
+}frameReceptor;
 
-}protocolo;
+// Payload dentro de frame[] (ocupa 'lng' bytes desde frame[2])
+static inline BYTE* payload(frameReceptor& f) { return f.frame + FrameEstandar::BYTES_CABECERA; }
+static inline const BYTE* payload(const frameReceptor& f) { return f.frame + FrameEstandar::BYTES_CABECERA; }
 
 
 #endif